@@ -0,0 +1,130 @@
+/*
+** luabench.c
+** Host driver for the benchmark suite
+** The core interpreter with the benchmarked C modules linked in and
+** registered in package.preload, plus a monotonic nanosecond clock:
+**
+**   luabench script.lua [args]     -- arg[0] is the script, as in lua.c
+**   require("bench.core").now()    -> nanoseconds (integer)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lua.h"
+
+#include "lauxlib.h"
+#include "lualib.h"
+
+
+int luaopen_tensor (lua_State *L);
+int luaopen_yyjson (lua_State *L);
+int luaopen_cjson (lua_State *L);
+int luaopen_lpeglabel (lua_State *L);
+int luaopen_bson (lua_State *L);
+int luaopen_pb (lua_State *L);
+int luaopen_pb_io (lua_State *L);
+int luaopen_pb_conv (lua_State *L);
+int luaopen_pb_buffer (lua_State *L);
+int luaopen_pb_slice (lua_State *L);
+int luaopen_pb_unsafe (lua_State *L);
+
+
+static int bench_now (lua_State *L) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  lua_pushinteger(L, (lua_Integer)ts.tv_sec * 1000000000 + ts.tv_nsec);
+  return 1;
+}
+
+
+static int luaopen_benchcore (lua_State *L) {
+  static const luaL_Reg funcs[] = {
+    {"now", bench_now},
+    {NULL, NULL}
+  };
+  luaL_newlib(L, funcs);
+  return 1;
+}
+
+
+static const luaL_Reg preloads[] = {
+  {"bench.core", luaopen_benchcore},
+  {"tensor", luaopen_tensor},
+  {"yyjson", luaopen_yyjson},
+  {"cjson", luaopen_cjson},
+  {"lpeglabel", luaopen_lpeglabel},
+  {"bson", luaopen_bson},
+  {"pb", luaopen_pb},
+  {"pb.io", luaopen_pb_io},
+  {"pb.conv", luaopen_pb_conv},
+  {"pb.buffer", luaopen_pb_buffer},
+  {"pb.slice", luaopen_pb_slice},
+  {"pb.unsafe", luaopen_pb_unsafe},
+  {NULL, NULL}
+};
+
+
+static int msghandler (lua_State *L) {
+  const char *msg = lua_tostring(L, 1);
+  if (msg == NULL)
+    msg = lua_pushfstring(L, "(error object is a %s value)", luaL_typename(L, 1));
+  luaL_traceback(L, L, msg, 1);
+  return 1;
+}
+
+
+static int pmain (lua_State *L) {
+  int argc = (int)lua_tointeger(L, 1);
+  char **argv = (char **)lua_touserdata(L, 2);
+  const luaL_Reg *p;
+  int i;
+  luaL_openlibs(L);
+  luaL_getsubtable(L, LUA_REGISTRYINDEX, LUA_PRELOAD_TABLE);
+  for (p = preloads; p->name != NULL; p++) {
+    lua_pushcfunction(L, p->func);
+    lua_setfield(L, -2, p->name);
+  }
+  lua_pop(L, 1);
+  lua_createtable(L, argc - 1, 1);
+  for (i = 1; i < argc; i++) {
+    lua_pushstring(L, argv[i]);
+    lua_rawseti(L, -2, i - 1);
+  }
+  lua_setglobal(L, "arg");
+  if (luaL_loadfile(L, argv[1]) != LUA_OK)
+    return lua_error(L);
+  for (i = 2; i < argc; i++)
+    lua_pushstring(L, argv[i]);
+  lua_call(L, argc - 2, 1);
+  return 1;  /* exit status, if the script returns one */
+}
+
+
+int main (int argc, char **argv) {
+  lua_State *L;
+  int status, code = EXIT_SUCCESS;
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s script.lua [args]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  L = luaL_newstate();
+  if (L == NULL) {
+    fprintf(stderr, "%s: cannot create state: not enough memory\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  lua_pushcfunction(L, msghandler);
+  lua_pushcfunction(L, pmain);
+  lua_pushinteger(L, argc);
+  lua_pushlightuserdata(L, argv);
+  status = lua_pcall(L, 2, 1, 1);
+  if (status != LUA_OK) {
+    fprintf(stderr, "%s: %s\n", argv[0], lua_tostring(L, -1));
+    code = EXIT_FAILURE;
+  }
+  else if (lua_isinteger(L, -1))
+    code = (int)lua_tointeger(L, -1);
+  lua_close(L);
+  return code;
+}
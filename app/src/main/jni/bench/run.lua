@@ -0,0 +1,209 @@
+-- run.lua
+-- Benchmark runner: times every case of the suites under suites/ and
+-- writes the results as JSON; 'compare' diffs two result files.
+--
+--   luabench run.lua [-o out.json] [-f pattern] [-t seconds] [-n samples] [suite...]
+--   luabench run.lua compare base.json new.json [-r percent]
+--
+-- A suite returns a list of { name = ..., run = function (n) end }; 'run'
+-- executes the operation n times. Each case is calibrated to about
+-- 't / samples' seconds per sample and reported as the median ns/op.
+
+local now = require("bench.core").now
+
+local dir = arg[0]:match("^(.*)/") or "."
+package.path = dir .. "/?.lua;" .. package.path
+
+local SUITES = { "vm", "string", "json", "tensor", "modules" }
+
+
+local function usage (msg)
+  io.stderr:write("run.lua: ", msg, "\n",
+    "usage: luabench run.lua [-o out.json] [-f pattern] [-t seconds] [-n samples] [suite...]\n",
+    "       luabench run.lua compare base.json new.json [-r percent]\n")
+  os.exit(2)
+end
+
+
+local function parseargs (argv, spec)
+  local opts, rest, i = {}, {}, 1
+  while i <= #argv do
+    local a = argv[i]
+    local key = a:match("^%-(%a)$")
+    if key then
+      if not spec[key] then usage("unknown option " .. a) end
+      i = i + 1
+      if argv[i] == nil then usage("missing value for " .. a) end
+      opts[spec[key]] = argv[i]
+    else
+      rest[#rest + 1] = a
+    end
+    i = i + 1
+  end
+  return opts, rest
+end
+
+
+-- {======================================================
+-- JSON output (flat records only; the runner must not depend on the
+-- modules it measures)
+-- =======================================================
+
+local function jstr (s)
+  return '"' .. s:gsub('[%c"\\]', function (c)
+    return string.format("\\u%04x", c:byte())
+  end) .. '"'
+end
+
+local function jval (v)
+  local t = type(v)
+  if t == "string" then return jstr(v)
+  elseif t == "number" then
+    if math.type(v) == "integer" then return tostring(v) end
+    return string.format("%.10g", v)
+  elseif t == "boolean" then return tostring(v)
+  else return "null"
+  end
+end
+
+local function jobject (t, keys)
+  local out = {}
+  for _, k in ipairs(keys) do
+    if t[k] ~= nil then out[#out + 1] = jstr(k) .. ": " .. jval(t[k]) end
+  end
+  return "{" .. table.concat(out, ", ") .. "}"
+end
+
+local RESULT_KEYS = { "name", "ns_per_op", "min_ns", "max_ns", "iters", "samples" }
+local META_KEYS = { "lua", "date", "os", "samples", "seconds" }
+
+local function writejson (path, meta, results)
+  local lines = { "{", '  "meta": ' .. jobject(meta, META_KEYS) .. ",", '  "results": [' }
+  for i, r in ipairs(results) do
+    lines[#lines + 1] = "    " .. jobject(r, RESULT_KEYS) .. (i < #results and "," or "")
+  end
+  lines[#lines + 1] = "  ]"
+  lines[#lines + 1] = "}"
+  local f = assert(io.open(path, "w"))
+  f:write(table.concat(lines, "\n"), "\n")
+  f:close()
+end
+
+-- }======================================================
+
+
+-- {======================================================
+-- Measurement
+-- =======================================================
+
+local function elapsed (fn, n)
+  collectgarbage()
+  local t = now()
+  fn(n)
+  return now() - t
+end
+
+-- picks n so that one sample takes about 'budget' ns
+local function calibrate (fn, budget)
+  local n = 1
+  while true do
+    local dt = elapsed(fn, n)
+    if dt >= budget / 10 or n >= 1 << 40 then
+      return math.max(1, math.floor(n * budget / math.max(dt, 1)))
+    end
+    n = n * math.max(2, math.min(100, budget // (10 * math.max(dt, 1))))
+  end
+end
+
+local function measure (c, seconds, samples)
+  local budget = math.floor(seconds * 1e9 / samples)
+  local n = calibrate(c.run, budget)
+  local ts = {}
+  for i = 1, samples do
+    ts[i] = elapsed(c.run, n) / n
+  end
+  table.sort(ts)
+  local mid = (#ts + 1) // 2
+  local median = (#ts % 2 == 1) and ts[mid] or (ts[mid] + ts[mid + 1]) / 2
+  return { name = c.name, ns_per_op = median, min_ns = ts[1], max_ns = ts[#ts],
+           iters = n, samples = samples }
+end
+
+-- }======================================================
+
+
+local function run (argv)
+  local opts, names = parseargs(argv, { o = "out", f = "filter", t = "seconds", n = "samples" })
+  local seconds = tonumber(opts.seconds or 1) or usage("bad -t")
+  local samples = math.tointeger(tonumber(opts.samples or 5)) or usage("bad -n")
+  if #names == 0 then names = SUITES end
+  local results = {}
+  for _, sname in ipairs(names) do
+    local ok, cases = pcall(dofile, dir .. "/suites/" .. sname .. ".lua")
+    if not ok then
+      io.stderr:write("skipping suite ", sname, ": ", tostring(cases), "\n")
+    else
+      for _, c in ipairs(cases) do
+        c.name = sname .. "." .. c.name
+        if not opts.filter or c.name:find(opts.filter) then
+          local r = measure(c, seconds, samples)
+          results[#results + 1] = r
+          io.stderr:write(string.format("%-32s %12.1f ns/op  (%d iters)\n",
+                                        r.name, r.ns_per_op, r.iters))
+        end
+      end
+    end
+  end
+  local meta = { lua = _VERSION, date = os.date("!%Y-%m-%dT%H:%M:%SZ"),
+                 os = package.config:sub(1, 1) == "/" and "posix" or "windows",
+                 samples = samples, seconds = seconds }
+  if opts.out then writejson(opts.out, meta, results) end
+  return 0
+end
+
+
+local function load (path)
+  local f, err = io.open(path, "r")
+  if not f then usage(err) end
+  local doc = require("cjson").decode(f:read("a"))
+  f:close()
+  local byname = {}
+  for _, r in ipairs(doc.results) do byname[r.name] = r end
+  return doc, byname
+end
+
+local function compare (argv)
+  local opts, files = parseargs(argv, { r = "threshold" })
+  if #files ~= 2 then usage("compare needs two result files") end
+  local threshold = (tonumber(opts.threshold or 5) or usage("bad -r")) / 100
+  local _, base = load(files[1])
+  local new = load(files[2])
+  local regressions = 0
+  print(string.format("%-32s %12s %12s %8s", "case", "base ns", "new ns", "delta"))
+  for _, r in ipairs(new.results) do
+    local b = base[r.name]
+    if b then
+      local delta = r.ns_per_op / b.ns_per_op - 1
+      local flag = ""
+      if delta > threshold then
+        flag = "  REGRESSION"
+        regressions = regressions + 1
+      elseif delta < -threshold then
+        flag = "  faster"
+      end
+      print(string.format("%-32s %12.1f %12.1f %+7.1f%%%s", r.name, b.ns_per_op,
+                          r.ns_per_op, delta * 100, flag))
+    else
+      print(string.format("%-32s %12s %12.1f %8s", r.name, "-", r.ns_per_op, "new"))
+    end
+  end
+  print(string.format("%d regression(s) over %g%%", regressions, threshold * 100))
+  return regressions > 0 and 1 or 0
+end
+
+
+local argv = table.pack(...)
+if argv[1] == "compare" then
+  return compare(table.move(argv, 2, argv.n, 1, {}))
+end
+return run(table.move(argv, 1, argv.n, 1, {}))
@@ -0,0 +1,59 @@
+-- suites/json.lua
+-- JSON encode/decode through cjson and yyjson on the same document.
+
+local cjson = require "cjson"
+local yyjson = require "yyjson"
+
+local cases = {}
+
+local function add (name, run)
+  cases[#cases + 1] = { name = name, run = run }
+end
+
+
+-- a typical API payload: a page of records with nested arrays
+local doc = { page = 1, total = 1000, items = {} }
+for i = 1, 50 do
+  doc.items[i] = {
+    id = i,
+    name = "user" .. i,
+    email = "user" .. i .. "@example.com",
+    score = i * 1.25,
+    active = i % 3 ~= 0,
+    tags = { "alpha", "beta", "gamma" },
+    pos = { x = i, y = -i, z = i / 7 },
+  }
+end
+
+local text = cjson.encode(doc)
+
+-- a decoder that fails fast would otherwise look like a speedup
+assert(#cjson.decode(text).items == 50)
+assert(#yyjson.decode(text).items == 50)
+assert(#yyjson.decode(text).items == 50, "yyjson.decode altered its input")
+
+add("cjson.encode", function (n)
+  local s
+  for _ = 1, n do s = cjson.encode(doc) end
+  return s
+end)
+
+add("cjson.decode", function (n)
+  local t
+  for _ = 1, n do t = cjson.decode(text) end
+  return t
+end)
+
+add("yyjson.encode", function (n)
+  local s
+  for _ = 1, n do s = yyjson.encode(doc) end
+  return s
+end)
+
+add("yyjson.decode", function (n)
+  local t
+  for _ = 1, n do t = yyjson.decode(text) end
+  return t
+end)
+
+return cases
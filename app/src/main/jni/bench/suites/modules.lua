@@ -0,0 +1,135 @@
+-- suites/modules.lua
+-- lpeglabel matching, BSON and protobuf round trips.
+
+local lpeg = require "lpeglabel"
+local bson = require "bson"
+local pb = require "pb"
+
+local cases = {}
+
+local function add (name, run)
+  cases[#cases + 1] = { name = name, run = run }
+end
+
+
+-- {======================================================
+-- lpeglabel
+-- =======================================================
+
+local P, R, S, C, Ct = lpeg.P, lpeg.R, lpeg.S, lpeg.C, lpeg.Ct
+local space = S(" \t") ^ 0
+local number = C(P("-") ^ -1 * R("09") ^ 1 * (P(".") * R("09") ^ 1) ^ -1) / tonumber
+local list = Ct(space * number * (space * P(",") * space * number) ^ 0 * space * -1)
+local line = {}
+for i = 1, 64 do line[i] = tostring(i * 3.5) end
+line = table.concat(line, ", ")
+
+add("lpeg.number_list", function (n)
+  local t
+  for _ = 1, n do t = list:match(line) end
+  return t
+end)
+
+local word = R("az", "AZ") ^ 1
+local find = (1 - P("needle")) ^ 0 * C("needle")
+local hay = string.rep("haystack ", 100) .. "needle"
+
+add("lpeg.search", function (n)
+  local s
+  for _ = 1, n do s = find:match(hay) end
+  return s
+end)
+
+add("lpeg.compile", function (n)
+  for _ = 1, n do local _ = Ct((C(word) + 1) ^ 0) end
+end)
+
+-- }======================================================
+
+
+-- {======================================================
+-- BSON
+-- =======================================================
+
+local record = {
+  name = "sensor-7", id = 7, active = true, reading = 21.75,
+  tags = { "a", "b", "c" }, loc = { lat = 48.85, lon = 2.35 },
+}
+local encoded = bson.encode(record)
+
+add("bson.encode", function (n)
+  local s
+  for _ = 1, n do s = bson.encode(record) end
+  return s
+end)
+
+add("bson.decode", function (n)
+  local t
+  for _ = 1, n do t = bson.decode(encoded) end
+  return t
+end)
+
+-- }======================================================
+
+
+-- {======================================================
+-- protobuf
+-- =======================================================
+
+-- protoc.lua does not parse in this dialect ('default' is a keyword), so
+-- the descriptor is serialized by hand: FileDescriptorSet > FileDescriptorProto
+-- > DescriptorProto > FieldDescriptorProto, field numbers from descriptor.proto
+local function varint (v)
+  local out = {}
+  repeat
+    local b = v & 0x7f
+    v = v >> 7
+    out[#out + 1] = string.char(v ~= 0 and (b | 0x80) or b)
+  until v == 0
+  return table.concat(out)
+end
+local function vfield (n, v) return varint(n << 3) .. varint(v) end
+local function sfield (n, s) return varint(n << 3 | 2) .. varint(#s) .. s end
+
+local OPTIONAL, REPEATED = 1, 3
+local DOUBLE, INT64, INT32, STRING, MESSAGE = 1, 3, 5, 9, 11
+
+local function field (name, number, label, ftype, tname)
+  local f = sfield(1, name) .. vfield(3, number) .. vfield(4, label) .. vfield(5, ftype)
+  if tname then f = f .. sfield(6, tname) end
+  return sfield(2, f)
+end
+
+local point = sfield(1, "Point") ..
+  field("x", 1, OPTIONAL, DOUBLE) .. field("y", 2, OPTIONAL, DOUBLE)
+local personmsg = sfield(1, "Person") ..
+  field("name", 1, OPTIONAL, STRING) .. field("id", 2, OPTIONAL, INT32) ..
+  field("email", 3, OPTIONAL, STRING) .. field("phones", 4, REPEATED, STRING) ..
+  field("home", 5, OPTIONAL, MESSAGE, ".Point") .. field("scores", 6, REPEATED, INT64)
+local file = sfield(1, "bench.proto") .. sfield(4, point) .. sfield(4, personmsg) ..
+  sfield(12, "proto3")
+assert(pb.load(sfield(1, file)))
+
+local person = {
+  name = "Alice", id = 12345, email = "alice@example.com",
+  phones = { "555-0100", "555-0101" }, home = { x = 1.5, y = -2.25 },
+  scores = { 1, 2, 3, 4, 5, 6, 7, 8 },
+}
+local wire = assert(pb.encode("Person", person))
+assert(pb.decode("Person", wire).home.y == -2.25)
+
+add("pb.encode", function (n)
+  local s
+  for _ = 1, n do s = pb.encode("Person", person) end
+  return s
+end)
+
+add("pb.decode", function (n)
+  local t
+  for _ = 1, n do t = pb.decode("Person", wire) end
+  return t
+end)
+
+-- }======================================================
+
+return cases
@@ -0,0 +1,84 @@
+-- suites/string.lua
+-- String library and string construction.
+
+local cases = {}
+
+local function add (name, run)
+  cases[#cases + 1] = { name = name, run = run }
+end
+
+
+local text = string.rep("The quick brown fox jumps over the lazy dog. ", 64)
+local words = {}
+for w in text:gmatch("%a+") do words[#words + 1] = w end
+
+add("concat.two", function (n)
+  local s
+  for i = 1, n do s = "id:" .. i end
+  return s
+end)
+
+add("concat.table", function (n)
+  local s
+  for _ = 1, n do s = table.concat(words, " ", 1, 16) end
+  return s
+end)
+
+add("format", function (n)
+  local s
+  for i = 1, n do s = string.format("%s=%d (%.2f)", "key", i, i / 3) end
+  return s
+end)
+
+add("find.plain", function (n)
+  local s = 0
+  for _ = 1, n do s = s + text:find("lazy dog", 1, true) end
+  return s
+end)
+
+add("find.pattern", function (n)
+  local s = 0
+  for _ = 1, n do s = s + text:find("l%a+y") end
+  return s
+end)
+
+add("gsub", function (n)
+  local s
+  for _ = 1, n do s = text:sub(1, 200):gsub("o", "0") end
+  return s
+end)
+
+add("gmatch.words", function (n)
+  local c = 0
+  local line = text:sub(1, 180)
+  for _ = 1, n do
+    for _ in line:gmatch("%a+") do c = c + 1 end
+  end
+  return c
+end)
+
+add("sub", function (n)
+  local s
+  for i = 1, n do s = text:sub(i % 64 + 1, i % 64 + 24) end
+  return s
+end)
+
+add("byte_char", function (n)
+  local s
+  for i = 1, n do s = string.char(text:byte(i % 200 + 1, i % 200 + 8)) end
+  return s
+end)
+
+add("rep", function (n)
+  local s
+  for _ = 1, n do s = ("ab"):rep(64) end
+  return s
+end)
+
+add("tostring.number", function (n)
+  local s
+  for i = 1, n do s = tostring(i + 0.5) end
+  return s
+end)
+
+return cases
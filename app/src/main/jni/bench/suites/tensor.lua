@@ -0,0 +1,57 @@
+-- suites/tensor.lua
+-- Tensor kernels on a 256x256 float64 matrix and element access from Lua.
+
+local tensor = require "tensor"
+
+local cases = {}
+
+local function add (name, run)
+  cases[#cases + 1] = { name = name, run = run }
+end
+
+
+local R, C = 256, 256
+local flat = {}
+for i = 1, R * C do flat[i] = (i % 97) / 7 end
+local a = tensor.new({ R, C }, "float64", flat)
+local b = tensor.new({ R, C }, "float64", flat)
+assert(a:get(1, 2) == flat[C + 3])  -- indices are 0-based
+
+add("new", function (n)
+  for _ = 1, n do local _ = tensor.zeros({ R, C }) end
+end)
+
+add("add", function (n)
+  for _ = 1, n do local _ = tensor.add(a, b) end
+end)
+
+add("mul", function (n)
+  for _ = 1, n do local _ = tensor.mul(a, b) end
+end)
+
+add("sum", function (n)
+  local s
+  for _ = 1, n do s = tensor.sum(a) end
+  return s
+end)
+
+add("transpose", function (n)
+  for _ = 1, n do local _ = tensor.transpose(a) end
+end)
+
+add("get", function (n)
+  local s = 0
+  for i = 1, n do s = s + a:get(i % R, i % C) end
+  return s
+end)
+
+add("set", function (n)
+  for i = 1, n do b:set(i % R, i % C, i) end
+end)
+
+add("tolist", function (n)
+  local small = tensor.new({ 32, 32 }, "float64", flat)
+  for _ = 1, n do local _ = small:tolist() end
+end)
+
+return cases
@@ -0,0 +1,202 @@
+-- suites/vm.lua
+-- Interpreter paths: class objects, tables, switch, try and coroutines.
+
+local cases = {}
+
+local function add (name, run)
+  cases[#cases + 1] = { name = name, run = run }
+end
+
+
+-- {======================================================
+-- OOP (lclass.c) against a plain metatable object
+-- =======================================================
+
+class Point
+  public x = 0
+  public y = 0
+  function set(self, x, y) self.x = x; self.y = y end
+  function len2(self) return self.x * self.x + self.y * self.y end
+end
+
+local p = onew Point()
+p:set(3, 4)
+
+local MPoint = {}
+MPoint.__index = MPoint
+function MPoint.len2 (self) return self.x * self.x + self.y * self.y end
+local mp = setmetatable({ x = 3, y = 4 }, MPoint)
+
+add("oop.field_get", function (n)
+  local s = 0
+  for _ = 1, n do s = s + p.x end
+  return s
+end)
+
+add("oop.field_set", function (n)
+  for i = 1, n do p.x = i end
+  p.x = 3
+end)
+
+add("oop.method_call", function (n)
+  local s = 0
+  for _ = 1, n do s = s + p:len2() end
+  return s
+end)
+
+add("oop.new", function (n)
+  for _ = 1, n do local _ = onew Point() end
+end)
+
+add("meta.method_call", function (n)
+  local s = 0
+  for _ = 1, n do s = s + mp:len2() end
+  return s
+end)
+
+-- }======================================================
+
+
+-- {======================================================
+-- Tables
+-- =======================================================
+
+local N = 1024
+local arr = {}
+for i = 1, N do arr[i] = i end
+
+local keys = {}
+for i = 1, N do keys[i] = "key" .. i end
+local hash = {}
+for i = 1, N do hash[keys[i]] = i end
+
+add("table.array_get", function (n)
+  local s = 0
+  for i = 1, n do s = s + arr[(i & (N - 1)) + 1] end
+  return s
+end)
+
+add("table.array_set", function (n)
+  for i = 1, n do arr[(i & (N - 1)) + 1] = i end
+end)
+
+add("table.hash_get", function (n)
+  local s = 0
+  for i = 1, n do s = s + hash[keys[(i & (N - 1)) + 1]] end
+  return s
+end)
+
+add("table.hash_set", function (n)
+  for i = 1, n do hash[keys[(i & (N - 1)) + 1]] = i end
+end)
+
+add("table.field_get", function (n)
+  local t, s = { alpha = 1, beta = 2, gamma = 3 }, 0
+  for _ = 1, n do s = s + t.beta end
+  return s
+end)
+
+add("table.append", function (n)
+  local t = {}
+  for i = 1, n do t[#t + 1] = i end
+end)
+
+add("table.constructor", function (n)
+  for i = 1, n do local _ = { i, i, x = i } end
+end)
+
+-- }======================================================
+
+
+-- {======================================================
+-- Control flow
+-- =======================================================
+
+local function sw_int (v)
+  local r
+  switch v do
+    case 1 then r = 10
+    case 2 then r = 20
+    case 3 then r = 30
+    case 4 then r = 40
+    default r = 0
+  end
+  return r
+end
+
+local function sw_str (v)
+  local r
+  switch v do
+    case "get" then r = 1
+    case "put" then r = 2
+    case "post" then r = 3
+    case "delete" then r = 4
+    default r = 0
+  end
+  return r
+end
+
+local verbs = { "get", "put", "post", "delete", "head" }
+
+add("switch.int", function (n)
+  local s = 0
+  for i = 1, n do s = s + sw_int(i % 5) end
+  return s
+end)
+
+add("switch.string", function (n)
+  local s = 0
+  for i = 1, n do s = s + sw_str(verbs[i % 5 + 1]) end
+  return s
+end)
+
+add("try.no_error", function (n)
+  local s = 0
+  for i = 1, n do
+    try
+      s = s + i
+    catch(e)
+      s = 0
+    end
+  end
+  return s
+end)
+
+add("try.catch", function (n)
+  local c = 0
+  for _ = 1, n do
+    try
+      error("x", 0)
+    catch(e)
+      c = c + 1
+    end
+  end
+  return c
+end)
+
+add("call.closure", function (n)
+  local k = 1
+  local function f (a) return a + k end
+  local s = 0
+  for i = 1, n do s = f(i) end
+  return s
+end)
+
+add("coroutine.resume_yield", function (n)
+  local co = coroutine.wrap(function ()
+    local v = 0
+    while true do v = coroutine.yield(v + 1) end
+  end)
+  local s = 0
+  for _ = 1, n do s = co(s) end
+  return s
+end)
+
+add("coroutine.create", function (n)
+  local f = function () end
+  for _ = 1, n do coroutine.resume(coroutine.create(f)) end
+end)
+
+-- }======================================================
+
+return cases
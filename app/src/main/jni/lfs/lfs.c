@@ -58,6 +58,14 @@
 #include <sys/types.h>
 #include <utime.h>
 #include <sys/param.h>          /* for MAXPATHLEN */
+#include <fnmatch.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <strings.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #ifdef MAXPATHLEN
 #define LFS_MAXPATHLEN MAXPATHLEN
@@ -1133,6 +1141,715 @@ static int link_info(lua_State * L)
 }
 
 
+#ifndef _WIN32
+/*
+** {======================================================
+** Recursive directory walker
+** Worker threads share a stack of directories to read. Entries are
+** read in large batches (getdents64 on Linux) and their type taken
+** from d_type, so an entry is only stat'ed when a filter or the
+** caller needs its stat data or the file system gives no type.
+** Matching entries are collected into batches of records that the
+** Lua thread turns into tables; the output queue is bounded so a
+** slow consumer holds the workers back instead of buffering the tree.
+** =======================================================
+*/
+
+#define WALK_METATABLE "walk metatable"
+#define WALK_BUFSIZE (64 * 1024)        /* bytes per directory read */
+#define WALK_MAXTHREADS 32
+#define WALK_DEFTHREADS 4
+#define WALK_DEFBATCH 256
+
+/* entry kinds, indexing 'walk_modes' (names as in 'mode2string') */
+enum { WK_FILE, WK_DIR, WK_LINK, WK_SOCK, WK_FIFO, WK_CHR, WK_BLK,
+  WK_OTHER, WK_UNKNOWN
+};
+
+static const char *const walk_modes[] = {
+  "file", "directory", "link", "socket", "named pipe", "char device",
+  "block device", "other", NULL
+};
+
+typedef struct walk_job {       /* a directory waiting to be read */
+  struct walk_job *next;
+  int depth;                    /* depth of its entries */
+  char path[1];
+} walk_job;
+
+typedef struct walk_rec {
+  size_t path;                  /* offset in the batch's string arena */
+  size_t pathlen;
+  int kind;
+  int err;                      /* errno for an unreadable directory */
+  int hasstat;
+  long long size;
+  long long mtime;
+} walk_rec;
+
+typedef struct walk_batch {
+  struct walk_batch *next;
+  walk_rec *recs;
+  int n, cap;
+  char *strs;
+  size_t slen, scap;
+} walk_batch;
+
+typedef struct walk_state {
+  pthread_mutex_t lock;
+  pthread_cond_t work;          /* a job was queued or the walk ended */
+  pthread_cond_t ready;         /* a batch was queued or a worker left */
+  pthread_cond_t space;         /* the output queue has room */
+  walk_job *jobs;
+  int pending;                  /* jobs queued or being read */
+  walk_batch *out, *outlast;
+  int nout, maxout;
+  int running;                  /* workers still alive */
+  volatile int stop;
+  int nthreads;
+  pthread_t threads[WALK_MAXTHREADS];
+  int started, closed;
+  /* options */
+  int batchsize;
+  int maxdepth;                 /* -1 for no limit */
+  int kind;                     /* WK_UNKNOWN for any kind */
+  int hidden;
+  int needstat;
+  char *glob;
+  char **exts;
+  int nexts;
+  long long minsize, maxsize, newer, older;
+} walk_state;
+
+
+static int walk_kindfromdtype(unsigned char t)
+{
+  switch (t) {
+    case DT_REG: return WK_FILE;
+    case DT_DIR: return WK_DIR;
+    case DT_LNK: return WK_LINK;
+    case DT_SOCK: return WK_SOCK;
+    case DT_FIFO: return WK_FIFO;
+    case DT_CHR: return WK_CHR;
+    case DT_BLK: return WK_BLK;
+    default: return WK_UNKNOWN;
+  }
+}
+
+static int walk_kindfrommode(mode_t mode)
+{
+  if (S_ISREG(mode)) return WK_FILE;
+  else if (S_ISDIR(mode)) return WK_DIR;
+  else if (S_ISLNK(mode)) return WK_LINK;
+  else if (S_ISSOCK(mode)) return WK_SOCK;
+  else if (S_ISFIFO(mode)) return WK_FIFO;
+  else if (S_ISCHR(mode)) return WK_CHR;
+  else if (S_ISBLK(mode)) return WK_BLK;
+  else return WK_OTHER;
+}
+
+
+static void walk_freebatch(walk_batch *b)
+{
+  if (b) {
+    free(b->recs);
+    free(b->strs);
+    free(b);
+  }
+}
+
+/* Only the root "/" ends in a slash: its children get "/name". */
+static size_t walk_seplen(const char *dir, size_t dlen)
+{
+  return dlen > 0 && dir[dlen - 1] == '/' ? 0 : 1;
+}
+
+/* Append a record to '*pb' (creating it); returns 0 when out of memory. */
+static int walk_addrec(walk_state *w, walk_batch **pb, const char *dir,
+                       const char *name, walk_rec *r)
+{
+  walk_batch *b = *pb;
+  size_t dlen = strlen(dir), nlen = name ? strlen(name) : 0;
+  size_t sep = walk_seplen(dir, dlen);
+  size_t len = dlen + (name ? nlen + sep : 0);
+  if (b == NULL) {
+    if ((b = (walk_batch *) calloc(1, sizeof(walk_batch))) == NULL)
+      return 0;
+    b->cap = w->batchsize;
+    b->recs = (walk_rec *) malloc(b->cap * sizeof(walk_rec));
+    b->scap = (size_t) b->cap * 48;
+    b->strs = (char *) malloc(b->scap);
+    if (b->recs == NULL || b->strs == NULL) {
+      walk_freebatch(b);
+      return 0;
+    }
+    *pb = b;
+  }
+  if (b->slen + len > b->scap) {
+    size_t ncap = b->scap * 2 + len;
+    char *s = (char *) realloc(b->strs, ncap);
+    if (s == NULL)
+      return 0;
+    b->strs = s;
+    b->scap = ncap;
+  }
+  r->path = b->slen;
+  r->pathlen = len;
+  memcpy(b->strs + b->slen, dir, dlen);
+  if (name) {
+    if (sep)
+      b->strs[b->slen + dlen] = '/';
+    memcpy(b->strs + b->slen + dlen + sep, name, nlen);
+  }
+  b->slen += len;
+  b->recs[b->n++] = *r;
+  return 1;
+}
+
+/* Queue a full or final batch; called with the lock held. */
+static void walk_publish(walk_state *w, walk_batch *b)
+{
+  while (w->nout >= w->maxout && !w->stop)
+    pthread_cond_wait(&w->space, &w->lock);
+  if (w->stop) {
+    walk_freebatch(b);
+    return;
+  }
+  b->next = NULL;
+  if (w->outlast)
+    w->outlast->next = b;
+  else
+    w->out = b;
+  w->outlast = b;
+  w->nout++;
+  pthread_cond_signal(&w->ready);
+}
+
+static void walk_flush(walk_state *w, walk_batch **pb)
+{
+  if (*pb && (*pb)->n == (*pb)->cap) {
+    pthread_mutex_lock(&w->lock);
+    walk_publish(w, *pb);
+    pthread_mutex_unlock(&w->lock);
+    *pb = NULL;
+  }
+}
+
+static void walk_pushjob(walk_state *w, const char *dir, const char *name,
+                         int depth)
+{
+  size_t dlen = strlen(dir), nlen = strlen(name);
+  size_t sep = walk_seplen(dir, dlen);
+  walk_job *job = (walk_job *) malloc(sizeof(walk_job) + dlen + nlen + sep);
+  if (job == NULL)
+    return;                     /* subtree is skipped */
+  memcpy(job->path, dir, dlen);
+  if (sep)
+    job->path[dlen] = '/';
+  memcpy(job->path + dlen + sep, name, nlen + 1);
+  job->depth = depth;
+  pthread_mutex_lock(&w->lock);
+  job->next = w->jobs;
+  w->jobs = job;
+  w->pending++;
+  pthread_cond_signal(&w->work);
+  pthread_mutex_unlock(&w->lock);
+}
+
+static int walk_hasext(walk_state *w, const char *name)
+{
+  const char *dot = strrchr(name, '.');
+  int i;
+  if (dot == NULL || dot == name)
+    return 0;
+  for (i = 0; i < w->nexts; i++)
+    if (strcasecmp(dot + 1, w->exts[i]) == 0)
+      return 1;
+  return 0;
+}
+
+static void walk_entry(walk_state *w, walk_job *job, int fd,
+                       const char *name, unsigned char dtype,
+                       walk_batch **pb)
+{
+  walk_rec r;
+  struct stat st;
+  if (name[0] == '.' && (name[1] == '\0' ||
+                         (name[1] == '.' && name[2] == '\0')))
+    return;
+  if (!w->hidden && name[0] == '.')
+    return;
+  r.kind = walk_kindfromdtype(dtype);
+  r.err = 0;
+  r.hasstat = 0;
+  if (w->needstat || r.kind == WK_UNKNOWN) {
+    if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+      return;                   /* vanished meanwhile */
+    r.kind = walk_kindfrommode(st.st_mode);
+    r.hasstat = 1;
+    r.size = (long long) st.st_size;
+    r.mtime = (long long) st.st_mtime;
+  }
+  if (r.kind == WK_DIR && (w->maxdepth < 0 || job->depth < w->maxdepth))
+    walk_pushjob(w, job->path, name, job->depth + 1);
+  if (w->kind != WK_UNKNOWN && r.kind != w->kind)
+    return;
+  if (w->glob && fnmatch(w->glob, name, 0) != 0)
+    return;
+  if (w->nexts > 0 && !walk_hasext(w, name))
+    return;
+  if (r.hasstat && (r.size < w->minsize || r.size > w->maxsize ||
+                    r.mtime < w->newer || r.mtime >= w->older))
+    return;
+  if (walk_addrec(w, pb, job->path, name, &r))
+    walk_flush(w, pb);
+}
+
+static void walk_error(walk_state *w, walk_job *job, int err,
+                       walk_batch **pb)
+{
+  walk_rec r;
+  r.kind = WK_DIR;
+  r.err = err;
+  r.hasstat = 0;
+  if (walk_addrec(w, pb, job->path, NULL, &r))
+    walk_flush(w, pb);
+}
+
+#if defined(__linux__)
+struct walk_dirent64 {          /* layout used by getdents64(2) */
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];
+};
+#endif
+
+static void walk_readdir(walk_state *w, walk_job *job, char *buf,
+                         walk_batch **pb)
+{
+  int fd = open(job->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    walk_error(w, job, errno, pb);
+    return;
+  }
+#if defined(__linux__)
+  while (!w->stop) {
+    long n = syscall(SYS_getdents64, fd, buf, WALK_BUFSIZE);
+    long off;
+    if (n <= 0) {
+      if (n < 0)
+        walk_error(w, job, errno, pb);
+      break;
+    }
+    for (off = 0; off < n;) {
+      struct walk_dirent64 *d = (struct walk_dirent64 *) (buf + off);
+      walk_entry(w, job, fd, d->d_name, d->d_type, pb);
+      off += d->d_reclen;
+    }
+  }
+  close(fd);
+#else
+  {
+    DIR *dir = fdopendir(fd);
+    struct dirent *d;
+    (void) buf;
+    if (dir == NULL) {
+      walk_error(w, job, errno, pb);
+      close(fd);
+      return;
+    }
+    while (!w->stop && (d = readdir(dir)) != NULL)
+      walk_entry(w, job, fd, d->d_name, d->d_type, pb);
+    closedir(dir);
+  }
+#endif
+}
+
+static void *walk_worker(void *arg)
+{
+  walk_state *w = (walk_state *) arg;
+  walk_batch *b = NULL;
+  char *buf = (char *) malloc(WALK_BUFSIZE);
+  pthread_mutex_lock(&w->lock);
+  while (buf != NULL) {
+    walk_job *job;
+    while (w->jobs == NULL && w->pending > 0 && !w->stop) {
+      if (b) {                  /* going idle: hand over what we have */
+        walk_publish(w, b);     /* may release the lock; check again */
+        b = NULL;
+      }
+      else
+        pthread_cond_wait(&w->work, &w->lock);
+    }
+    if (w->stop || w->jobs == NULL)
+      break;
+    job = w->jobs;
+    w->jobs = job->next;
+    pthread_mutex_unlock(&w->lock);
+    walk_readdir(w, job, buf, &b);
+    free(job);
+    pthread_mutex_lock(&w->lock);
+    if (--w->pending == 0)
+      pthread_cond_broadcast(&w->work);
+  }
+  if (b)
+    walk_publish(w, b);
+  w->running--;
+  pthread_cond_broadcast(&w->ready);
+  pthread_mutex_unlock(&w->lock);
+  free(buf);
+  return NULL;
+}
+
+/* Next batch of records, or NULL at the end; blocks while workers run. */
+static walk_batch *walk_take(walk_state *w)
+{
+  walk_batch *b;
+  pthread_mutex_lock(&w->lock);
+  while (w->out == NULL && w->running > 0)
+    pthread_cond_wait(&w->ready, &w->lock);
+  if ((b = w->out) != NULL) {
+    if ((w->out = b->next) == NULL)
+      w->outlast = NULL;
+    w->nout--;
+    pthread_cond_signal(&w->space);
+  }
+  pthread_mutex_unlock(&w->lock);
+  return b;
+}
+
+static void walk_close(walk_state *w)
+{
+  int i;
+  if (w->closed)
+    return;
+  w->closed = 1;
+  if (w->started) {
+    pthread_mutex_lock(&w->lock);
+    w->stop = 1;
+    pthread_cond_broadcast(&w->work);
+    pthread_cond_broadcast(&w->space);
+    pthread_mutex_unlock(&w->lock);
+    for (i = 0; i < w->nthreads; i++)
+      pthread_join(w->threads[i], NULL);
+    while (w->jobs) {
+      walk_job *job = w->jobs;
+      w->jobs = job->next;
+      free(job);
+    }
+    while (w->out) {
+      walk_batch *b = w->out;
+      w->out = b->next;
+      walk_freebatch(b);
+    }
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->work);
+    pthread_cond_destroy(&w->ready);
+    pthread_cond_destroy(&w->space);
+  }
+  for (i = 0; i < w->nexts; i++)
+    free(w->exts[i]);
+  free(w->exts);
+  free(w->glob);
+}
+
+/* Push a batch as an array of records */
+static void walk_pushbatch(lua_State * L, walk_batch *b)
+{
+  int i;
+  lua_createtable(L, b->n, 0);
+  for (i = 0; i < b->n; i++) {
+    walk_rec *r = &b->recs[i];
+    lua_createtable(L, 0, 4);
+    lua_pushlstring(L, b->strs + r->path, r->pathlen);
+    lua_setfield(L, -2, "path");
+    lua_pushstring(L, walk_modes[r->kind]);
+    lua_setfield(L, -2, "mode");
+    if (r->err) {
+      lua_pushstring(L, strerror(r->err));
+      lua_setfield(L, -2, "error");
+    }
+    if (r->hasstat) {
+      lua_pushinteger(L, (lua_Integer) r->size);
+      lua_setfield(L, -2, "size");
+      lua_pushinteger(L, (lua_Integer) r->mtime);
+      lua_setfield(L, -2, "modification");
+    }
+    lua_rawseti(L, -2, i + 1);
+  }
+}
+
+static char *walk_strdup(lua_State * L, const char *s)
+{
+  char *d = (char *) malloc(strlen(s) + 1);
+  if (d == NULL)
+    luaL_error(L, "not enough memory");
+  return strcpy(d, s);
+}
+
+static lua_Integer walk_optint(lua_State * L, int t, const char *field,
+                               lua_Integer def)
+{
+  lua_Integer v;
+  lua_getfield(L, t, field);
+  if (lua_isnil(L, -1))
+    v = def;
+  else if (!lua_isinteger(L, -1) && !lua_isnumber(L, -1))
+    return luaL_error(L, "option '%s' must be a number", field);
+  else
+    v = (lua_Integer) lua_tonumber(L, -1);
+  lua_pop(L, 1);
+  return v;
+}
+
+static const char *walk_optstr(lua_State * L, int t, const char *field)
+{
+  const char *s;
+  lua_getfield(L, t, field);
+  if (lua_isnil(L, -1))
+    s = NULL;
+  else if ((s = lua_tostring(L, -1)) == NULL)
+    luaL_error(L, "option '%s' must be a string", field);
+  lua_pop(L, 1);                /* still referenced by the options */
+  return s;
+}
+
+static void walk_addext(lua_State * L, walk_state *w, const char *e)
+{
+  if (*e == '.')
+    e++;
+  w->exts[w->nexts++] = walk_strdup(L, e);
+}
+
+static void walk_getopts(lua_State * L, int t, walk_state *w)
+{
+  const char *s;
+  int i;
+  w->nthreads = WALK_DEFTHREADS;
+  w->batchsize = WALK_DEFBATCH;
+  w->maxdepth = -1;
+  w->kind = WK_UNKNOWN;
+  w->hidden = 1;
+  w->minsize = w->newer = LLONG_MIN;
+  w->maxsize = w->older = LLONG_MAX;
+  if (lua_isnoneornil(L, t))
+    return;
+  luaL_checktype(L, t, LUA_TTABLE);
+  w->nthreads = (int) walk_optint(L, t, "threads", WALK_DEFTHREADS);
+  luaL_argcheck(L, w->nthreads >= 1 && w->nthreads <= WALK_MAXTHREADS, t,
+                "option 'threads' out of range");
+  w->batchsize = (int) walk_optint(L, t, "batch", WALK_DEFBATCH);
+  luaL_argcheck(L, w->batchsize >= 1 && w->batchsize <= 65536, t,
+                "option 'batch' out of range");
+  w->maxdepth = (int) walk_optint(L, t, "maxdepth", -1);
+  if ((s = walk_optstr(L, t, "type")) != NULL) {
+    for (i = 0; walk_modes[i] && strcmp(walk_modes[i], s) != 0; i++);
+    if (walk_modes[i] == NULL)
+      luaL_error(L, "invalid type '%s'", s);
+    w->kind = i;
+  }
+  lua_getfield(L, t, "hidden");
+  if (!lua_isnil(L, -1))
+    w->hidden = lua_toboolean(L, -1);
+  lua_pop(L, 1);
+  if ((s = walk_optstr(L, t, "glob")) != NULL)
+    w->glob = walk_strdup(L, s);
+  lua_getfield(L, t, "ext");
+  if (lua_istable(L, -1)) {
+    int n = (int) luaL_len(L, -1);
+    w->exts = (char **) calloc(n > 0 ? n : 1, sizeof(char *));
+    if (w->exts == NULL)
+      luaL_error(L, "not enough memory");
+    for (i = 1; i <= n; i++) {
+      lua_rawgeti(L, -1, i);
+      if ((s = lua_tostring(L, -1)) == NULL)
+        luaL_error(L, "option 'ext' must hold strings");
+      walk_addext(L, w, s);
+      lua_pop(L, 1);
+    }
+  }
+  else if (!lua_isnil(L, -1)) {
+    if ((s = lua_tostring(L, -1)) == NULL)
+      luaL_error(L, "option 'ext' must be a string or a table");
+    if ((w->exts = (char **) calloc(1, sizeof(char *))) == NULL)
+      luaL_error(L, "not enough memory");
+    walk_addext(L, w, s);
+  }
+  lua_pop(L, 1);
+  w->minsize = walk_optint(L, t, "minsize", LLONG_MIN);
+  w->maxsize = walk_optint(L, t, "maxsize", LLONG_MAX);
+  w->newer = walk_optint(L, t, "newer", LLONG_MIN);
+  w->older = walk_optint(L, t, "older", LLONG_MAX);
+  lua_getfield(L, t, "stat");
+  w->needstat = lua_toboolean(L, -1) ||
+      w->minsize != LLONG_MIN || w->maxsize != LLONG_MAX ||
+      w->newer != LLONG_MIN || w->older != LLONG_MAX;
+  lua_pop(L, 1);
+}
+
+static int walk_start(walk_state *w, const char *root)
+{
+  size_t len = strlen(root);
+  walk_job *job;
+  int i;
+  while (len > 1 && root[len - 1] == '/')   /* children get "root/name" */
+    len--;
+  if ((job = (walk_job *) malloc(sizeof(walk_job) + len)) == NULL)
+    return ENOMEM;
+  memcpy(job->path, root, len);
+  job->path[len] = '\0';
+  job->depth = 1;
+  job->next = NULL;
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->work, NULL);
+  pthread_cond_init(&w->ready, NULL);
+  pthread_cond_init(&w->space, NULL);
+  w->jobs = job;
+  w->pending = 1;
+  w->maxout = 2 * w->nthreads + 2;
+  w->started = 1;
+  pthread_mutex_lock(&w->lock);
+  for (i = 0; i < w->nthreads; i++) {
+    int res = pthread_create(&w->threads[i], NULL, walk_worker, w);
+    if (res != 0) {
+      if (i == 0) {
+        w->nthreads = 0;
+        pthread_mutex_unlock(&w->lock);
+        return res;
+      }
+      break;                    /* go on with fewer workers */
+    }
+  }
+  w->nthreads = w->running = i;
+  pthread_mutex_unlock(&w->lock);
+  return 0;
+}
+
+/*
+** Returns the next batch (an array of records) of a walk, or nil at
+** the end.
+*/
+static int walk_iter(lua_State * L)
+{
+  walk_state *w = (walk_state *) luaL_checkudata(L, 1, WALK_METATABLE);
+  walk_batch *b;
+  if (w->closed || (b = walk_take(w)) == NULL) {
+    walk_close(w);
+    return 0;
+  }
+  walk_pushbatch(L, b);
+  walk_freebatch(b);
+  return 1;
+}
+
+static int walk_gc(lua_State * L)
+{
+  walk_close((walk_state *) lua_touserdata(L, 1));
+  return 0;
+}
+
+/*
+** Walks the tree below a directory.
+** @param #1 Root directory.
+** @param #2 Options table: threads, batch, maxdepth, type, hidden,
+**   glob, ext, minsize, maxsize, newer, older, stat, callback.
+** Without a callback returns an iterator over batches of records
+** { path, mode [, size, modification] [, error] }; with one, calls
+** it with each batch (stopping if it returns false) and returns the
+** number of records delivered.
+*/
+static int walk_factory(lua_State * L)
+{
+  const char *root = luaL_checkstring(L, 1);
+  walk_state *w;
+  struct stat st;
+  int res;
+  lua_settop(L, 2);
+  w = (walk_state *) lua_newuserdata(L, sizeof(walk_state));
+  memset(w, 0, sizeof(walk_state));
+  luaL_getmetatable(L, WALK_METATABLE);
+  lua_setmetatable(L, -2);      /* state is released even on errors */
+  walk_getopts(L, 2, w);
+  if (stat(root, &st) != 0)
+    return pusherror(L, root);
+  if (!S_ISDIR(st.st_mode)) {
+    errno = ENOTDIR;
+    return pusherror(L, root);
+  }
+  if ((res = walk_start(w, root)) != 0) {
+    errno = res;
+    return pusherror(L, "cannot start walk");
+  }
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "callback");
+    if (!lua_isnil(L, -1)) {    /* stack: root, opts, state, callback */
+      lua_Integer count = 0;
+      walk_batch *b;
+      while ((b = walk_take(w)) != NULL) {
+        count += b->n;
+        lua_pushvalue(L, 4);
+        walk_pushbatch(L, b);
+        walk_freebatch(b);
+        if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
+          walk_close(w);
+          return lua_error(L);
+        }
+        if (lua_type(L, -1) == LUA_TBOOLEAN && !lua_toboolean(L, -1)) {
+          lua_pop(L, 1);
+          break;
+        }
+        lua_pop(L, 1);
+      }
+      walk_close(w);
+      lua_pushinteger(L, count);
+      return 1;
+    }
+    lua_pop(L, 1);
+  }
+  lua_pushcfunction(L, walk_iter);
+  lua_insert(L, -2);
+#if LUA_VERSION_NUM >= 504
+  lua_pushnil(L);
+  lua_pushvalue(L, -2);
+  return 4;
+#else
+  return 2;
+#endif
+}
+
+
+/*
+** Creates walk metatable.
+*/
+static int walk_create_meta(lua_State * L)
+{
+  luaL_newmetatable(L, WALK_METATABLE);
+
+  /* Method table */
+  lua_newtable(L);
+  lua_pushcfunction(L, walk_iter);
+  lua_setfield(L, -2, "next");
+  lua_pushcfunction(L, walk_gc);
+  lua_setfield(L, -2, "close");
+
+  /* Metamethods */
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, walk_gc);
+  lua_setfield(L, -2, "__gc");
+
+#if LUA_VERSION_NUM >= 504
+  lua_pushcfunction(L, walk_gc);
+  lua_setfield(L, -2, "__close");
+#endif
+  return 1;
+}
+
+/* }====================================================== */
+#endif
+
+
 /*
 ** Assumes the table is on top of the stack.
 */
@@ -1162,6 +1879,9 @@ static const struct luaL_Reg fslib[] = {
   { "touch", file_utime },
   { "unlock", file_unlock },
   { "lock_dir", lfs_lock_dir },
+#ifndef _WIN32
+  { "walk", walk_factory },
+#endif
   { NULL, NULL },
 };
 
@@ -1169,6 +1889,9 @@ LFS_EXPORT int luaopen_lfs(lua_State * L)
 {
   dir_create_meta(L);
   lock_create_meta(L);
+#ifndef _WIN32
+  walk_create_meta(L);
+#endif
   new_lib(L, fslib);
   lua_pushvalue(L, -1);
   lua_setglobal(L, LFS_LIBNAME);
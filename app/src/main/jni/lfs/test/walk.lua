@@ -0,0 +1,95 @@
+-- lfs.walk
+local lfs = require "lfs"
+
+local function collect(root, opts)
+	local out = {}
+	for batch in lfs.walk(root, opts) do
+		for _, r in ipairs(batch) do out[#out + 1] = r end
+	end
+	return out
+end
+
+local function paths(list)
+	local t = {}
+	for _, r in ipairs(list) do t[#t + 1] = r.path end
+	table.sort(t)
+	return table.concat(t, "\n")
+end
+
+local root = os.tmpname()
+os.remove(root)
+assert(lfs.mkdir(root))
+local files = { "a.txt", "b.lua", "sub/c.txt", "sub/deep/d.lua", "sub/.hidden", "e" }
+assert(lfs.mkdir(root .. "/sub"))
+assert(lfs.mkdir(root .. "/sub/deep"))
+for i, f in ipairs(files) do
+	local h = assert(io.open(root .. "/" .. f, "w"))
+	h:write(string.rep("x", i * 10))
+	h:close()
+end
+
+do print("whole tree")
+	local want = {}
+	for _, f in ipairs(files) do want[#want + 1] = root .. "/" .. f end
+	want[#want + 1] = root .. "/sub"
+	want[#want + 1] = root .. "/sub/deep"
+	table.sort(want)
+	local got = collect(root)
+	assert(paths(got) == table.concat(want, "\n"), paths(got))
+	for _, r in ipairs(got) do
+		assert(r.error == nil)
+		assert(r.mode == (r.path:find("deep$") or r.path:find("sub$")) and "directory" or "file")
+	end
+	-- trailing slashes are dropped from the root
+	assert(paths(collect(root .. "///")) == table.concat(want, "\n"))
+end
+
+do print("filters")
+	local got = collect(root, { type = "file", ext = "lua" })
+	assert(paths(got) == root .. "/b.lua\n" .. root .. "/sub/deep/d.lua")
+	got = collect(root, { maxdepth = 1, type = "directory" })
+	assert(paths(got) == root .. "/sub")
+	got = collect(root, { hidden = false, glob = "*.*", stat = true, threads = 1, batch = 1 })
+	assert(#got == 4)
+	for _, r in ipairs(got) do assert(r.size and r.modification) end
+	got = collect(root, { minsize = 30, maxsize = 39, type = "file" })
+	assert(paths(got) == root .. "/sub/c.txt")
+	local n = 0
+	assert(lfs.walk(root, { callback = function(b) n = n + #b end }) == #files + 2)
+	assert(n == #files + 2)
+end
+
+do print("the root directory")
+	-- children of "/" are "/name", and "/" itself is read
+	local want = {}
+	for name in lfs.dir("/") do
+		if name ~= "." and name ~= ".." then want[#want + 1] = "/" .. name end
+	end
+	table.sort(want)
+	for _, r in ipairs{ "/", "//" } do
+		local got = collect(r, { maxdepth = 1 })
+		for _, e in ipairs(got) do
+			assert(e.error == nil, e.path .. ": " .. tostring(e.error))
+		end
+		assert(paths(got) == table.concat(want, "\n"), paths(got))
+	end
+	-- one level further down, still without double slashes
+	local got = collect("/", { maxdepth = 2, type = "directory", threads = 2 })
+	assert(#got > #want / 2)
+	for _, e in ipairs(got) do
+		assert(e.path:sub(1, 1) == "/" and not e.path:find("//", 1, true), e.path)
+	end
+end
+
+do print("errors")
+	local none, err = lfs.walk(root .. "/missing")
+	assert(none == nil and err:find("missing", 1, true))
+	none, err = lfs.walk(root .. "/a.txt")
+	assert(none == nil and err)
+end
+
+for i = #files, 1, -1 do assert(os.remove(root .. "/" .. files[i])) end
+assert(lfs.rmdir(root .. "/sub/deep"))
+assert(lfs.rmdir(root .. "/sub"))
+assert(lfs.rmdir(root))
+print("OK")
@@ -453,7 +453,8 @@ static int needfollow (TTree *tree) {
 */
 int sizei (const Instruction *i) {
   switch((Opcode)i->i.code) {
-    case ISet: case ISpan: return CHARSETINSTSIZE;
+    case ISet: return CHARSETINSTSIZE;
+    case ISpan: return SPANINSTSIZE;
     case ITestSet: return CHARSETINSTSIZE + 1;
     case ITestChar: case ITestAny: case IChoice: case IJmp: case ICall:
     case IOpenCall: case ICommit: case IPartialCommit: case IBackCommit:
@@ -631,6 +632,22 @@ static void addcharset (CompileState *compst, const byte *cs) {
 }
 
 
+/*
+** Build the nibble table of charset 'cs' used by the vectorized ISpan:
+** byte 'tab[(c & 0xF) | ((c >> 3) & 0x10)]' has bit '(c >> 4) & 7' set
+** iff 'c' is in the set, so a byte shuffle on the low nibble (plus the
+** top bit) gives a row that a second shuffle on the high nibble tests.
+*/
+void spantable (const byte *cs, byte *tab) {
+  int c;
+  loopset(i, tab[i] = 0);
+  for (c = 0; c <= UCHAR_MAX; c++) {
+    if (testchar(cs, c))
+      tab[(c & 0xF) | ((c >> 3) & 0x10)] |= (byte)(1 << ((c >> 4) & 7));
+  }
+}
+
+
 /*
 ** code a char set, optimizing unit sets for IChar, "complete"
 ** sets for IAny, and empty sets for IFail; also use an IAny
@@ -832,8 +849,12 @@ static void coderep (CompileState *compst, TTree *tree, int opt,
                      const Charset *fl) {
   Charset st;
   if (tocharset(tree, &st)) {
+    int t;
     addinstruction(compst, ISpan, 0);
     addcharset(compst, st.cs);
+    t = gethere(compst);
+    addcharset(compst, st.cs);  /* space for the nibble table */
+    spantable(st.cs, getinstr(compst, t).buff);
   }
   else {
     int e1 = getfirst(tree, fullset, &st);
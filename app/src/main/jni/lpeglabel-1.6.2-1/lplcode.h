@@ -19,6 +19,7 @@ LUAI_FUNC int lp_gc (lua_State *L);
 LUAI_FUNC Instruction *compile (lua_State *L, Pattern *p);
 LUAI_FUNC void realloccode (lua_State *L, Pattern *p, int nsize);
 LUAI_FUNC int sizei (const Instruction *i);
+LUAI_FUNC void spantable (const byte *cs, byte *tab);
 
 
 #define PEnullable      0
@@ -1278,6 +1278,294 @@ static int lp_match (lua_State *L) {
 
 
 
+/*
+** {===========================================
+** Dump and load of compiled patterns
+** The image holds a header, the pattern's tree (so that a loaded
+** pattern can still be combined with others), its compiled code and
+** its ktable. Tree and code are stored in native layout; the header
+** records that layout and 'load' refuses images from another one.
+** Ktable values that are not nil, booleans, numbers or strings are
+** written by name, taken from the optional table given to 'dump'
+** (value -> name), and resolved by 'load' through a table name ->
+** value. Like binary chunks, images are checked for consistency but
+** should only be loaded from trusted sources.
+** ============================================
+*/
+
+#define DUMPSIGNATURE	"\x1bLPL"
+#define DUMPFORMAT	1
+#define DUMPCHECKINT	0x5678
+#define DUMPCHECKNUM	((lua_Number)370.5)
+
+/* tags for ktable entries */
+enum { KNil, KFalse, KTrue, KInt, KFloat, KStr, KExt };
+
+
+static void dumpint (luaL_Buffer *b, int v) {
+  luaL_addlstring(b, (const char *)&v, sizeof(v));
+}
+
+
+static void dumpstr (lua_State *L, luaL_Buffer *b, const char *s,
+                     size_t len) {
+  if (len > INT_MAX)
+    luaL_error(L, "string too long in pattern ktable");
+  dumpint(b, (int)len);
+  luaL_addlstring(b, s, len);
+}
+
+
+/*
+** Dump entry 'i' of the ktable at 'ktable'; 'names' is the index of the
+** table mapping external values to names (or 0). The value is popped
+** before touching the buffer, which may be using the top of the stack;
+** strings stay alive through the ktable or the names table.
+*/
+static void dumpkvalue (lua_State *L, luaL_Buffer *b, int ktable, int names,
+                        int i) {
+  const char *str = NULL;
+  size_t len = 0;
+  lua_Integer ni = 0;
+  lua_Number nf = 0;
+  int tag;
+  lua_rawgeti(L, ktable, i);
+  switch (lua_type(L, -1)) {
+    case LUA_TNIL: tag = KNil; break;
+    case LUA_TBOOLEAN: tag = lua_toboolean(L, -1) ? KTrue : KFalse; break;
+    case LUA_TNUMBER: {
+      if (lua_isinteger(L, -1)) { tag = KInt; ni = lua_tointeger(L, -1); }
+      else { tag = KFloat; nf = lua_tonumber(L, -1); }
+      break;
+    }
+    case LUA_TSTRING: tag = KStr; str = lua_tolstring(L, -1, &len); break;
+    default: {  /* replace value by its name */
+      const char *tname = luaL_typename(L, -1);
+      if (names == 0 || lua_rawget(L, names) != LUA_TSTRING)
+        luaL_error(L, "cannot dump ktable value %d (a %s) without a name",
+                   i, tname);
+      tag = KExt; str = lua_tolstring(L, -1, &len);
+      break;
+    }
+  }
+  lua_pop(L, 1);
+  luaL_addchar(b, (char)tag);
+  if (tag == KInt)
+    luaL_addlstring(b, (const char *)&ni, sizeof(ni));
+  else if (tag == KFloat)
+    luaL_addlstring(b, (const char *)&nf, sizeof(nf));
+  else if (str != NULL)
+    dumpstr(L, b, str, len);
+}
+
+
+static int lp_dump (lua_State *L) {
+  Pattern *p = getpattern(L, 1);
+  int names = lua_isnoneornil(L, 2) ? 0 : 2;
+  int treesize = getsize(L, 1);
+  int nk, i;
+  luaL_Buffer b;
+  if (names) luaL_checktype(L, 2, LUA_TTABLE);
+  if (p->code == NULL)  /* not compiled yet? */
+    prepcompile(L, p, 1);
+  lua_settop(L, 2);
+  lua_getuservalue(L, 1);  /* ktable at index 3 */
+  nk = ktablelen(L, 3);
+  luaL_buffinit(L, &b);
+  luaL_addstring(&b, DUMPSIGNATURE);
+  luaL_addchar(&b, DUMPFORMAT);
+  luaL_addchar(&b, sizeof(Instruction));
+  luaL_addchar(&b, sizeof(TTree));
+  luaL_addchar(&b, sizeof(lua_Integer));
+  luaL_addchar(&b, sizeof(lua_Number));
+  dumpint(&b, DUMPCHECKINT);
+  {
+    lua_Number n = DUMPCHECKNUM;
+    luaL_addlstring(&b, (const char *)&n, sizeof(n));
+  }
+  dumpint(&b, treesize);
+  dumpint(&b, p->codesize);
+  dumpint(&b, nk);
+  luaL_addlstring(&b, (const char *)p->tree, treesize * sizeof(TTree));
+  luaL_addlstring(&b, (const char *)p->code,
+                      p->codesize * sizeof(Instruction));
+  for (i = 1; i <= nk; i++)
+    dumpkvalue(L, &b, 3, names, i);
+  luaL_pushresult(&b);
+  return 1;
+}
+
+
+typedef struct LoadState {
+  lua_State *L;
+  const char *s;  /* current position */
+  const char *e;  /* end of image */
+} LoadState;
+
+
+static const char *loadbytes (LoadState *ls, size_t n) {
+  const char *s = ls->s;
+  if ((size_t)(ls->e - s) < n)
+    luaL_error(ls->L, "truncated pattern image");
+  ls->s += n;
+  return s;
+}
+
+
+static int loadint (LoadState *ls) {
+  int v;
+  memcpy(&v, loadbytes(ls, sizeof(v)), sizeof(v));
+  return v;
+}
+
+
+static void loadstr (LoadState *ls) {
+  int len = loadint(ls);
+  if (len < 0)
+    luaL_error(ls->L, "corrupted pattern image");
+  lua_pushlstring(ls->L, loadbytes(ls, len), len);
+}
+
+
+/*
+** Push ktable entry from the image; 'values' is the index of the table
+** resolving external names (or 0).
+*/
+static void loadkvalue (LoadState *ls, int values) {
+  lua_State *L = ls->L;
+  switch (*loadbytes(ls, 1)) {
+    case KNil: lua_pushnil(L); break;
+    case KFalse: lua_pushboolean(L, 0); break;
+    case KTrue: lua_pushboolean(L, 1); break;
+    case KInt: {
+      lua_Integer n;
+      memcpy(&n, loadbytes(ls, sizeof(n)), sizeof(n));
+      lua_pushinteger(L, n);
+      break;
+    }
+    case KFloat: {
+      lua_Number n;
+      memcpy(&n, loadbytes(ls, sizeof(n)), sizeof(n));
+      lua_pushnumber(L, n);
+      break;
+    }
+    case KStr: loadstr(ls); break;
+    case KExt: {
+      loadstr(ls);
+      lua_pushvalue(L, -1);  /* keep the name for the error message */
+      if (values == 0 || lua_rawget(L, values) == LUA_TNIL)
+        luaL_error(L, "no value for external '%s' in pattern image",
+                   lua_tostring(L, -2));
+      lua_remove(L, -2);
+      break;
+    }
+    default: luaL_error(L, "corrupted pattern image");
+  }
+}
+
+
+/*
+** Check that 'code' is a well-formed instruction sequence: known
+** opcodes, no instruction crossing the end, jumps landing on
+** instruction boundaries and a final IEnd. 'start' is scratch space
+** with one byte per element.
+*/
+static int checkcode (Instruction *code, int n, byte *start) {
+  int i, last = -1;
+  memset(start, 0, n);
+  for (i = 0; i < n; i += sizei(&code[i])) {
+    int op = code[i].i.code;
+    if (op > IEmpty || op == IOpenCall || op == IGiveup ||
+        n - i < sizei(&code[i]))
+      return 0;
+    if ((op == IFullCapture || op == IOpenCapture || op == ICloseCapture ||
+         op == ICloseRunTime) && getkind(&code[i]) > Cgroup)
+      return 0;
+    start[i] = 1;
+    last = i;
+  }
+  if (last < 0 || code[last].i.code != IEnd)
+    return 0;
+  for (i = 0; i < n; i += sizei(&code[i])) {
+    switch (code[i].i.code) {
+      case ITestAny: case ITestChar: case ITestSet: case IChoice:
+      case IPredChoice: case IJmp: case ICall: case ICommit:
+      case IPartialCommit: case IBackCommit: case IThrowRec: {
+        int t = code[i + 1].offset;
+        if (t < -i || t >= n - i || !start[i + t])
+          return 0;
+        break;
+      }
+      case ISpan:  /* rebuild nibble table from the charset */
+        spantable(code[i + 1].buff, code[i + CHARSETINSTSIZE].buff);
+        break;
+      default: break;
+    }
+  }
+  return 1;
+}
+
+
+static int lp_load (lua_State *L) {
+  LoadState ls;
+  size_t len;
+  int values, treesize, codesize, nk, i;
+  Pattern *p;
+  const char *s = luaL_checklstring(L, 1, &len);
+  const char *h;
+  values = lua_isnoneornil(L, 2) ? 0 : 2;
+  if (values) luaL_checktype(L, 2, LUA_TTABLE);
+  lua_settop(L, 2);
+  ls.L = L; ls.s = s; ls.e = s + len;
+  h = loadbytes(&ls, sizeof(DUMPSIGNATURE) - 1 + 5);
+  if (memcmp(h, DUMPSIGNATURE, sizeof(DUMPSIGNATURE) - 1) != 0)
+    return luaL_error(L, "not a pattern image");
+  h += sizeof(DUMPSIGNATURE) - 1;
+  if (h[0] != DUMPFORMAT)
+    return luaL_error(L, "pattern image format mismatch");
+  if (h[1] != sizeof(Instruction) || h[2] != sizeof(TTree) ||
+      h[3] != sizeof(lua_Integer) || h[4] != sizeof(lua_Number) ||
+      loadint(&ls) != DUMPCHECKINT)
+    return luaL_error(L, "pattern image built for another platform");
+  {
+    lua_Number n;
+    memcpy(&n, loadbytes(&ls, sizeof(n)), sizeof(n));
+    if (n != DUMPCHECKNUM)
+      return luaL_error(L, "pattern image built for another platform");
+  }
+  treesize = loadint(&ls);
+  codesize = loadint(&ls);
+  nk = loadint(&ls);
+  if (treesize <= 0 || treesize > MAXPATTSIZE || codesize <= 0 ||
+      codesize > INT_MAX / (int)sizeof(Instruction) || nk < 0 || nk > USHRT_MAX)
+    return luaL_error(L, "corrupted pattern image");
+  newtree(L, treesize);  /* pattern at index 3 */
+  p = getpattern(L, 3);
+  memcpy(p->tree, loadbytes(&ls, treesize * sizeof(TTree)),
+         treesize * sizeof(TTree));
+  realloccode(L, p, codesize);
+  memcpy(p->code, loadbytes(&ls, codesize * sizeof(Instruction)),
+         codesize * sizeof(Instruction));
+  if (!checkcode(p->code, codesize, (byte *)lua_newuserdata(L, codesize)))
+    return luaL_error(L, "corrupted pattern image");
+  lua_pop(L, 1);  /* scratch space */
+  if (nk > 0) {
+    newktable(L, nk);
+    lua_getuservalue(L, 3);
+    for (i = 1; i <= nk; i++) {
+      loadkvalue(&ls, values);
+      lua_rawseti(L, -2, i);
+    }
+    lua_pop(L, 1);  /* ktable */
+  }
+  if (ls.s != ls.e)
+    return luaL_error(L, "corrupted pattern image");
+  return 1;
+}
+
+/* }=========================================== */
+
+
 /*
 ** {===========================================
 ** Library creation and functions not related to matching
@@ -1348,6 +1636,8 @@ static int lp_locale (lua_State *L) {
 static struct luaL_Reg pattreg[] = {
   {"ptree", lp_printtree},
   {"pcode", lp_printcode},
+  {"dump", lp_dump},
+  {"load", lp_load},
   {"match", lp_match},
   {"B", lp_behind},
   {"V", lp_V},
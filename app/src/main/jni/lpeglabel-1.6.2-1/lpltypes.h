@@ -135,6 +135,10 @@ typedef struct Charset {
 /* size (in elements) for a ISet instruction */
 #define CHARSETINSTSIZE		instsize(CHARSETSIZE)
 
+/* size (in elements) for a ISpan instruction: its charset followed by
+   the same set as a nibble table (see 'spantable') */
+#define SPANINSTSIZE		(CHARSETINSTSIZE + instsize(CHARSETSIZE) - 1)
+
 /* size (in elements) for a IFunc instruction */
 #define funcinstsize(p)		((p)->i.aux + 2)
 
@@ -6,6 +6,14 @@
 #include <limits.h>
 #include <string.h>
 
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LPL_SPAN_NEON
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define LPL_SPAN_SSSE3
+#endif
+
 
 #include "lua.h"
 #include "lauxlib.h"
@@ -56,6 +64,70 @@ static const char *utf8_decode (const char *o, int *val) {
 }
 
 
+/*
+** Skip the longest prefix of [s, e) made of bytes in the set of the
+** ISpan instruction 'p'. Where the target has a byte shuffle, 16 bytes
+** are classified at a time with the nibble table that follows the
+** charset (see 'spantable'); the tail (and any other target) uses the
+** bitmap.
+*/
+static const char *spanset (const Instruction *p, const char *s,
+                            const char *e) {
+  const byte *cs = (p + 1)->buff;
+#if defined(LPL_SPAN_NEON)
+  if (e - s >= 16) {
+    static const byte bits[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                  1, 2, 4, 8, 16, 32, 64, 128};
+    const byte *tab = (p + CHARSETINSTSIZE)->buff;
+    uint8x16x2_t rows = {{vld1q_u8(tab), vld1q_u8(tab + 16)}};
+    uint8x16_t bit = vld1q_u8(bits);
+    uint8x16_t lo = vdupq_n_u8(0x0F), top = vdupq_n_u8(0x10);
+    do {
+      uint8x16_t x = vld1q_u8((const byte *)s);
+      uint8x16_t idx = vorrq_u8(vandq_u8(x, lo),
+                                vandq_u8(vshrq_n_u8(x, 3), top));
+      uint8x16_t in = vtstq_u8(vqtbl2q_u8(rows, idx),
+                               vqtbl1q_u8(bit, vshrq_n_u8(x, 4)));
+      /* 4 bits per byte: all ones while every byte is in the set */
+      uint64_t m = vget_lane_u64(vreinterpret_u64_u8(
+                     vshrn_n_u16(vreinterpretq_u16_u8(in), 4)), 0);
+      if (m != ~(uint64_t)0)
+        return s + (__builtin_ctzll(~m) >> 2);
+      s += 16;
+    } while (e - s >= 16);
+  }
+#elif defined(LPL_SPAN_SSSE3)
+  if (e - s >= 16) {
+    const byte *tab = (p + CHARSETINSTSIZE)->buff;
+    __m128i row1 = _mm_loadu_si128((const __m128i *)tab);
+    __m128i row2 = _mm_loadu_si128((const __m128i *)(tab + 16));
+    __m128i bit = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128,
+                                1, 2, 4, 8, 16, 32, 64, (char)128);
+    __m128i lo = _mm_set1_epi8(0x0F);
+    do {
+      __m128i x = _mm_loadu_si128((const __m128i *)s);
+      __m128i l = _mm_and_si128(x, lo);
+      __m128i h = _mm_and_si128(_mm_srli_epi16(x, 4), lo);
+      __m128i high = _mm_cmplt_epi8(x, _mm_setzero_si128());  /* c >= 128 */
+      __m128i row = _mm_or_si128(
+                      _mm_and_si128(high, _mm_shuffle_epi8(row2, l)),
+                      _mm_andnot_si128(high, _mm_shuffle_epi8(row1, l)));
+      __m128i b = _mm_shuffle_epi8(bit, h);
+      int m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, b), b));
+      if (m != 0xFFFF)
+        return s + __builtin_ctz(~m);
+      s += 16;
+    } while (e - s >= 16);
+  }
+#endif
+  for (; s < e; s++) {
+    int c = (byte)*s;
+    if (!testchar(cs, c)) break;
+  }
+  return s;
+}
+
+
 /*
 ** {===========================================
 ** Virtual Machine
@@ -298,11 +370,8 @@ const char *match (lua_State *L, const char *o, const char *s, const char *e,
         continue;
       }
       case ISpan: {
-        for (; s < e; s++) {
-          int c = (byte)*s;
-          if (!testchar((p+1)->buff, c)) break;
-        }
-        p += CHARSETINSTSIZE;
+        s = spanset(p, s, e);
+        p += SPANINSTSIZE;
         continue;
       }
       case IJmp: {
@@ -1605,6 +1605,122 @@ errmsg("x <- 'a'  x <- 'b'", 'already defined')
 --errmsg("'a' -", "near '-'")
 
 
+print"testing dump/load"
+
+do
+  local function reload (p, names, values)
+    local q = m.load(p:dump(names), values)
+    assert(m.type(q) == "pattern")
+    return q
+  end
+
+  -- constants of every primitive type
+  p = m.Ct(m.C(m.R"az"^1) * m.Cc(nil, true, false, 10, 2.5, "str") *
+           m.Cg(m.Cc"v", "name") * (m.Cp() * m.P"!"))
+  t = reload(p):match"abc!"
+  checkeq(t, {"abc", [3] = true, [4] = false, [5] = 10, [6] = 2.5,
+              [7] = "str", [8] = 4, name = "v"})
+  assert(math.type(t[5]) == "integer" and math.type(t[6]) == "float")
+
+  -- grammars, back references and labels survive the round trip
+  local g = m.P{ "S",
+    S = m.Cs((m.V"paren" + (1 - m.S"()"))^0),
+    paren = m.P"(" * m.V"S" * (m.P")" + m.T"close"),
+  }
+  local gl = reload(g)
+  assert(gl:match"a(b(c)d)e" == "a(b(c)d)e")
+  local r, l, pos = gl:match"a(b"
+  assert(r == nil and l == "close" and pos == 4)
+  p = reload(m.Cg(m.C(m.R"az"^1), "w") * "=" * m.Cb"w")
+  assert(p:match"abc=" == "abc")
+
+  -- functions and tables go through names and values
+  local function up (s) return s:upper() end
+  local map = { a = "1", b = "2" }
+  p = m.Cs((m.R"az"^1 / up + m.S"0123456789" / map)^0)
+  checkerr("without a name", p.dump, p)
+  local img = p:dump{ [up] = "up", [map] = "map" }
+  checkerr("no value for external 'up'", m.load, img)
+  checkerr("no value for external 'map'", m.load, img, { up = up })
+  assert(m.load(img, { up = up, map = { ["1"] = "x" } }):match"ab1" == "ABx")
+
+  -- a loaded pattern combines with others and dumps again
+  p = reload(m.C(m.R"09"^1))
+  assert((p * "," * p):match"12,34" == "12")
+  assert(reload(p + m.P"x"):match"x" == 2)
+  assert(reload(reload(m.S"ab"^1 * -1)):match"abba" == 5)
+
+  -- damaged images
+  img = m.P"abc":dump()
+  checkerr("not a pattern image", m.load, "x" .. img)
+  checkerr("truncated pattern image", m.load, img:sub(1, -2))
+  checkerr("truncated pattern image", m.load, img:sub(1, 10))
+  for i = 1, #img do  -- no single-byte change may crash the loader
+    local bad = img:sub(1, i - 1) .. string.char((img:byte(i) + 1) % 256) ..
+                img:sub(i + 1)
+    local ok, q = pcall(m.load, bad)
+    if ok then assert(m.type(q) == "pattern") end
+  end
+end
+
+
+print"testing spans over long subjects"
+
+do
+  -- against a plain loop over the same set, at every length and offset
+  -- around the 16-byte blocks the vector scan works on
+  local function check (set, inset)
+    local p = m.S(set)^0
+    for len = 0, 70 do
+      local buf = {}
+      for i = 1, len do
+        buf[i] = inset:sub((i - 1) % #inset + 1, (i - 1) % #inset + 1)
+      end
+      local s = table.concat(buf)
+      for _, tail in ipairs{ "\0", "\255", "\127", "z" } do
+        if not set:find(tail, 1, true) then
+          local subj = s .. tail .. s
+          assert(p:match(subj) == len + 1)
+          assert(p:match(subj, 2) == (len > 0 and len + 1 or 2))
+        end
+      end
+    end
+  end
+  check("abc", "abc")
+  check(" \t\n", "\t \n \n")
+  check("\128\200\255", "\255\128\200")
+  check("0123456789", "9081726354")
+  -- bytes with the same low or high nibble as members
+  local hi = {}
+  for i = 0, 15 do hi[#hi + 1] = string.char(0x40 + i) end
+  check(table.concat(hi), "OA@N")
+  for _, c in ipairs{ "P", "0", "\192" } do
+    assert((m.S(table.concat(hi))^0):match(string.rep("A", 40) .. c) == 41)
+  end
+
+  -- ranges and complements
+  p = m.R("az", "AZ", "\128\255")^0
+  local s = string.rep("aZ\200\128\255zA", 20)
+  assert(p:match(s .. "0" .. s) == #s + 1)
+  p = (1 - m.S"\n,")^0
+  s = string.rep("x\0\255", 33)
+  assert(p:match(s .. "," .. s) == #s + 1)
+  assert(p:match(s) == #s + 1)
+  -- every single-byte set, each stopping on every other byte
+  for c = 0, 255 do
+    local ch = string.char(c)
+    local sp = m.S(ch)^0
+    local run = string.rep(ch, 37)
+    assert(sp:match(run) == 38)
+    assert(sp:match(run .. string.char((c + 1) % 256) .. run) == 38)
+  end
+  -- a dumped span keeps working after load (its table is rebuilt)
+  p = m.load((m.S"\t "^0 * m.C(m.R"az"^1)):dump())
+  assert(p:match(string.rep(" \t", 30) .. "word") == "word")
+end
+
+
+
 print"OK"
 
 
@@ -42,6 +42,129 @@ static int generate_error  (lua_State *L, const TUserdata *ud, int errcode);
 #define METHOD_TFIND 3
 
 
+/* Compile cache
+ ******************************************************************************
+ * The module-level functions (find, match, gmatch, gsub, count, split) take
+ * the pattern as a string. Compiled regexes are kept in a per-state LRU cache
+ * keyed by (cf, locale, library-specific args, pattern) so that calling them
+ * in a loop compiles each pattern once. The cache lives in the function
+ * environment at ALG_CACHE_INDEX: a TCache userdata whose uservalue maps
+ * key -> slot, slot -> regex and -slot -> key. A binding may define
+ * ALG_CACHE_HIT to act on entries as they get hot.
+ */
+
+#ifndef ALG_CACHESIZE
+#  define ALG_CACHESIZE 32
+#endif
+
+#ifndef ALG_CACHE_INDEX
+#  define ALG_CACHE_INDEX 0
+#endif
+
+#ifndef ALG_CACHE_HIT
+#  define ALG_CACHE_HIT(L,ud,hits)
+#endif
+
+#if LUA_VERSION_NUM == 501
+#  define alg_getuservalue lua_getfenv
+#  define alg_setuservalue lua_setfenv
+#else
+#  define alg_getuservalue lua_getuservalue
+#  define alg_setuservalue lua_setuservalue
+#endif
+
+typedef struct {
+  unsigned tick;                   /* LRU clock */
+  int      n;                      /* number of slots in use */
+  unsigned stamp[ALG_CACHESIZE];   /* last use of each slot */
+  unsigned hits[ALG_CACHESIZE];    /* lookups served by each slot */
+} TCache;
+
+static void cache_new (lua_State *L) {
+  TCache *c = (TCache *)lua_newuserdata (L, sizeof (TCache));
+  memset (c, 0, sizeof (TCache));
+  lua_newtable (L);
+  alg_setuservalue (L, -2);
+}
+
+/* Character tables and translate strings are identified only by address,
+   which may be reused after they are collected: do not cache those. */
+static int cache_usable (const TArgComp *argC) {
+  return argC->tables == NULL && argC->translate == NULL;
+}
+
+static void cache_pushkey (lua_State *L, const TArgComp *argC) {
+  luaL_Buffer b;
+  int top = lua_gettop (L);
+  luaL_buffinit (L, &b);
+  luaL_addlstring (&b, (const char*)&argC->cflags, sizeof (argC->cflags));
+  luaL_addlstring (&b, (const char*)&argC->gnusyn, sizeof (argC->gnusyn));
+  luaL_addlstring (&b, (const char*)&argC->syntax, sizeof (argC->syntax));
+  if (argC->locale) {
+    luaL_addchar (&b, 'L');
+    luaL_addlstring (&b, argC->locale, strlen (argC->locale) + 1);
+  }
+  else
+    luaL_addchar (&b, '-');
+  luaL_addlstring (&b, argC->pattern, argC->patlen);
+  luaL_pushresult (&b);
+  lua_replace (L, top + 1);              /* drop whatever the buffer left below */
+  lua_settop (L, top + 1);
+}
+
+/* Like compile_regex, but reuses a cached regex when there is one. */
+static void compile_cached (lua_State *L, const TArgComp *argC, TUserdata **pud) {
+  TCache *c;
+  TUserdata *ud;
+  int slot;
+  if (!cache_usable (argC)) {
+    compile_regex (L, argC, pud);
+    return;
+  }
+  lua_rawgeti (L, ALG_ENVIRONINDEX, ALG_CACHE_INDEX);
+  c = (TCache *)lua_touserdata (L, -1);
+  alg_getuservalue (L, -1);
+  cache_pushkey (L, argC);                   /* stack: cache, slots, key */
+  lua_pushvalue (L, -1);
+  lua_rawget (L, -3);
+  slot = (int)lua_tointeger (L, -1);
+  lua_pop (L, 1);
+  if (slot > 0) {                            /* hit */
+    lua_rawgeti (L, -2, slot);
+    ud = (TUserdata *)lua_touserdata (L, -1);
+    c->hits[slot-1]++;
+    ALG_CACHE_HIT (L, ud, c->hits[slot-1]);
+  }
+  else {
+    compile_regex (L, argC, &ud);            /* errors leave the cache intact */
+    if (c->n < ALG_CACHESIZE)
+      slot = ++c->n;
+    else {                                   /* evict the least recently used */
+      int i;
+      slot = 1;
+      for (i = 2; i <= ALG_CACHESIZE; i++)
+        if (c->stamp[i-1] < c->stamp[slot-1])
+          slot = i;
+      lua_rawgeti (L, -3, -slot);
+      lua_pushnil (L);
+      lua_rawset (L, -5);
+    }
+    lua_pushvalue (L, -2);
+    lua_pushinteger (L, slot);
+    lua_rawset (L, -5);                      /* slots[key] = slot */
+    lua_pushvalue (L, -1);
+    lua_rawseti (L, -4, slot);               /* slots[slot] = ud */
+    lua_pushvalue (L, -2);
+    lua_rawseti (L, -4, -slot);              /* slots[-slot] = key */
+    c->hits[slot-1] = 0;
+  }
+  c->stamp[slot-1] = ++c->tick;
+  lua_replace (L, -4);                       /* leave only the regex */
+  lua_pop (L, 2);
+  if (pud) *pud = ud;
+}
+
+
 static int OptLimit (lua_State *L, int pos) {
   if (lua_isnoneornil (L, pos))
     return GSUB_UNLIMITED;
@@ -126,6 +249,7 @@ static void check_subject (lua_State *L, int pos, TArgExec *argE)
 
 static void check_pattern (lua_State *L, int pos, TArgComp *argC)
 {
+  memset (argC, 0, sizeof (TArgComp));   /* library-specific args default to none */
   if (lua_isstring (L, pos)) {
     argC->pattern = lua_tolstring (L, pos, &argC->patlen);
     argC->ud = NULL;
@@ -237,7 +361,7 @@ static int algf_gsub (lua_State *L) {
     ud = (TUserdata*) argC.ud;
     lua_pushvalue (L, 2);
   }
-  else compile_regex (L, &argC, &ud);
+  else compile_cached (L, &argC, &ud);
   freelist_init (&freelist);
   /*------------------------------------------------------------------*/
   if (argE.reptype == LUA_TSTRING) {
@@ -408,7 +532,7 @@ static int algf_count (lua_State *L) {
     ud = (TUserdata*) argC.ud;
     lua_pushvalue (L, 2);
   }
-  else compile_regex (L, &argC, &ud);
+  else compile_cached (L, &argC, &ud);
   /*------------------------------------------------------------------*/
   while (st <= (int)argE.textlen) {
     int to, res;
@@ -487,7 +611,7 @@ static int generic_find_func (lua_State *L, int method) {
     ud = (TUserdata*) argC.ud;
     lua_pushvalue (L, 2);
   }
-  else compile_regex (L, &argC, &ud);
+  else compile_cached (L, &argC, &ud);
   res = findmatch_exec (ud, &argE);
   return finish_generic_find (L, ud, &argE, method, res);
 }
@@ -611,7 +735,7 @@ static int algf_gmatch (lua_State *L)
   if (argC.ud)
     lua_pushvalue (L, 2);
   else
-    compile_regex (L, &argC, NULL);           /* 1-st upvalue: ud */
+    compile_cached (L, &argC, NULL);          /* 1-st upvalue: ud */
   gmatch_pushsubject (L, &argE);              /* 2-nd upvalue: s  */
   lua_pushinteger (L, argE.eflags);           /* 3-rd upvalue: ef */
   lua_pushinteger (L, 0);                     /* 4-th upvalue: startoffset */
@@ -628,7 +752,7 @@ static int algf_split (lua_State *L)
   if (argC.ud)
     lua_pushvalue (L, 2);
   else
-    compile_regex (L, &argC, NULL);           /* 1-st upvalue: ud */
+    compile_cached (L, &argC, NULL);          /* 1-st upvalue: ud */
   gmatch_pushsubject (L, &argE);              /* 2-nd upvalue: s  */
   lua_pushinteger (L, argE.eflags);           /* 3-rd upvalue: ef */
   lua_pushinteger (L, 0);                     /* 4-th upvalue: startoffset */
@@ -732,6 +856,8 @@ static void alg_register (lua_State *L, const luaL_Reg *r_methods,
 #endif
   lua_pushvalue(L, -1); /* mt.__index = mt */
   lua_setfield(L, -2, "__index");
+  cache_new (L);
+  lua_rawseti (L, -2, ALG_CACHE_INDEX);
 
   /* Register functions. */
   lua_createtable(L, 0, 8);
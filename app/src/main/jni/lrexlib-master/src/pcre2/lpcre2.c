@@ -63,8 +63,10 @@ typedef struct {
   pcre2_code *pr;
   pcre2_compile_context *ccontext;
   pcre2_match_data *match_data;
+  pcre2_match_data *dfa_data;    /* reused by dfa_exec while ovecsize is the same */
   PCRE2_SIZE *ovector;
   int ncapt;
+  int jit;                       /* JIT compilation was attempted */
   const unsigned char *tables;
   int freed;
 } TPcre2;
@@ -74,6 +76,15 @@ typedef struct {
 static void do_named_subpatterns (lua_State *L, TPcre2 *ud, const char *text);
 #  define DO_NAMED_SUBPATTERNS do_named_subpatterns
 
+/* Cached patterns used this many times by the module-level functions get
+   JIT-compiled; pcre2_match then runs the machine code automatically. */
+#ifndef REX_JIT_HOT
+#  define REX_JIT_HOT 4
+#endif
+
+static void jit_hot (TPcre2 *ud, unsigned hits);
+#define ALG_CACHE_HIT(L,ud,hits)  jit_hot(ud, hits)
+
 #include "../algo.h"
 
 /* Locations of the 2 permanent tables in the function environment */
@@ -252,6 +263,13 @@ static int compile_regex (lua_State *L, const TArgComp *argC, TPcre2 **pud) {
   return 1;
 }
 
+static void jit_hot (TPcre2 *ud, unsigned hits) {
+  if (hits >= REX_JIT_HOT && !ud->jit) {
+    ud->jit = 1;
+    pcre2_jit_compile (ud->pr, PCRE2_JIT_COMPLETE);  /* on failure the interpreter is used */
+  }
+}
+
 /* the target table must be on lua stack top */
 static void do_named_subpatterns (lua_State *L, TPcre2 *ud, const char *text) {
   int i, namecount, name_entry_size;
@@ -290,17 +308,24 @@ static int Lpcre2_dfa_exec (lua_State *L)
   if (!wspace)
     luaL_error (L, "malloc failed");
 
-  ud->match_data = pcre2_match_data_create(argE.ovecsize/2, NULL); //### CHECK ALL
-  if (!ud->match_data)
-    return luaL_error (L, "malloc failed");
+  /* keep ud->match_data intact for the other methods */
+  if (ud->dfa_data == NULL ||
+      pcre2_get_ovector_count (ud->dfa_data) != (argE.ovecsize/2 ? argE.ovecsize/2 : 1)) {
+    if (ud->dfa_data) pcre2_match_data_free (ud->dfa_data);
+    ud->dfa_data = pcre2_match_data_create(argE.ovecsize/2, NULL); //### CHECK ALL
+    if (!ud->dfa_data) {
+      Lfree (L, wspace, wsize);
+      return luaL_error (L, "malloc failed");
+    }
+  }
 
   res = pcre2_dfa_match (ud->pr, (PCRE2_SPTR)argE.text, argE.textlen, argE.startoffset,
-    argE.eflags, ud->match_data, NULL, wspace, argE.wscount); //### CHECK ALL
+    argE.eflags, ud->dfa_data, NULL, wspace, argE.wscount); //### CHECK ALL
 
   if (ALG_ISMATCH (res) || res == PCRE2_ERROR_PARTIAL) {
     int i;
     int max = (res>0) ? res : (res==0) ? (int)argE.ovecsize/2 : 1;
-    PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(ud->match_data);
+    PCRE2_SIZE* ovector = pcre2_get_ovector_pointer(ud->dfa_data);
 
     lua_pushinteger (L, ovector[0] + 1);         /* 1-st return value */
     lua_newtable (L);                            /* 2-nd return value */
@@ -353,6 +378,7 @@ static int Lpcre2_gc (lua_State *L) {
     //if (ud->tables)  pcre_free ((void *)ud->tables); //###
     if (ud->ccontext) pcre2_compile_context_free (ud->ccontext);
     if (ud->match_data) pcre2_match_data_free (ud->match_data);
+    if (ud->dfa_data) pcre2_match_data_free (ud->dfa_data);
   }
   return 0;
 }
@@ -0,0 +1,210 @@
+-- See Copyright Notice in the file LICENSE
+
+-- The module-level functions compile string patterns through a cache of
+-- the last 32 regexes (ALG_CACHESIZE in algo.h). These sets check that no
+-- result depends on what the cache holds.
+
+local luatest = require "luatest"
+local N = luatest.NT
+
+local CACHESIZE = 32
+
+-- subject "<1><2>...<n>" and the results of finding "<(i)>" in it
+local function numbered (n)
+  local t = {}
+  for i = 1, n do t[i] = "<" .. i .. ">" end
+  return table.concat (t)
+end
+
+local function set_f_evict (lib, flg)
+  local subj = numbered (3 * CACHESIZE)
+  -- find every pattern of 1..n three times in the given order
+  local function test_evict (s, n, order)
+    local out = {}
+    for round = 1, 3 do
+      for k = 1, n do
+        local i = k
+        if order == "down" then i = n + 1 - k
+        elseif order == "zigzag" then i = (k % 2 == 1) and (k + 1) // 2 or n + 1 - k // 2
+        end
+        local st, en, cap = lib.find (s, "<(" .. i .. ")>")
+        out[#out+1] = (cap or "-") .. "@" .. (st or 0) .. "-" .. (en or 0)
+      end
+    end
+    return table.concat (out, " ")
+  end
+  local set = {
+    Name = "Cache: eviction",
+    Func = test_evict,
+  --{ subj, n,               order      results (filled in below) }
+    { {subj, CACHESIZE - 1,  "up"    }, {} },
+    { {subj, CACHESIZE,      "up"    }, {} },
+    { {subj, CACHESIZE + 1,  "up"    }, {} },
+    { {subj, CACHESIZE + 1,  "down"  }, {} },
+    { {subj, 2 * CACHESIZE,  "zigzag"}, {} },
+    { {subj, 3 * CACHESIZE,  "up"    }, {} },
+  }
+  for _, test in ipairs (set) do
+    local s, n, order = test[1][1], test[1][2], test[1][3]
+    local out = {}
+    for round = 1, 3 do
+      for k = 1, n do
+        local i = k
+        if order == "down" then i = n + 1 - k
+        elseif order == "zigzag" then i = (k % 2 == 1) and (k + 1) // 2 or n + 1 - k // 2
+        end
+        local st, en, cap = string.find (s, "<(" .. i .. ")>")
+        out[#out+1] = cap .. "@" .. st .. "-" .. en
+      end
+    end
+    test[2] = { table.concat (out, " ") }
+  end
+  return set
+end
+
+local function set_f_evict_in_use (lib, flg)
+  -- the regex of a running gmatch is pushed out of the cache between steps
+  local function test_evict_in_use (s, patt)
+    local out = {}
+    for w in lib.gmatch (s, patt) do
+      out[#out+1] = w
+      for i = 1, CACHESIZE + 1 do
+        assert (lib.find ("<" .. i .. ">", "<(" .. i .. ")>") == 1)
+      end
+    end
+    -- and a gsub whose regex is evicted by its replacement function
+    local r, n = lib.gsub (s, patt, function (w)
+      for i = 1, CACHESIZE + 1 do lib.count ("x", "x" .. i .. "|x") end
+      return w:upper ()
+    end)
+    return table.concat (out, ","), r, n
+  end
+  return {
+    Name = "Cache: eviction while in use",
+    Func = test_evict_in_use,
+  --{ subj,             patt           results }
+    { {"ab cd ef",      "[a-z]+"},     {"ab,cd,ef", "AB CD EF", 3} },
+    { {"x1 y22 z333",   "[a-z][0-9]+"},{"x1,y22,z333", "X1 Y22 Z333", 3} },
+  }
+end
+
+local function set_f_cflags (lib, flg)
+  -- the same pattern with and without case folding, in both orders
+  local icase = flg.CASELESS or flg.ICASE + (flg.EXTENDED or 0)
+  local function test_cflags (s, patt, first)
+    local a, b
+    if first then
+      a = lib.find (s, patt, 1, icase)
+      b = lib.find (s, patt)
+    else
+      b = lib.find (s, patt)
+      a = lib.find (s, patt, 1, icase)
+    end
+    return a or N, b or N, lib.count (s, patt, icase), lib.count (s, patt)
+  end
+  return {
+    Name = "Cache: keyed by cf",
+    Func = test_cflags,
+  --{ subj,        patt,    icase first   results }
+    { {"xABCabc",  "abc",   true },       {2, 5, 2, 1} },
+    { {"xABCabc",  "abc",   false},       {2, 5, 2, 1} },
+    { {"ABC",      "a(b)c", false},       {1, N, 1, 0} },
+    { {"ABC",      "a(b)c", true },       {1, N, 1, 0} },
+  }
+end
+
+local function set_f_nosub (lib, flg)
+  -- a regex compiled with NOSUB reports no captures
+  local nosub = flg.NOSUB + (flg.EXTENDED or 0)
+  local function test_nosub (s, patt)
+    local r1 = { lib.find (s, patt, 1, nosub) }
+    local r2 = { lib.find (s, patt) }
+    local r3 = { lib.find (s, patt, 1, nosub) }
+    return #r1, #r2, #r3
+  end
+  return {
+    Name = "Cache: keyed by cf (NOSUB)",
+    Func = test_nosub,
+  --{ subj,      patt            results }
+    { {"xabc",   "a(b)(c)"},     {2, 4, 2} },
+  }
+end
+
+local function set_f_locale (lib, flg)
+  -- the locale is part of the key: an unknown one fails even when the
+  -- same pattern is cached without a locale or with another one
+  local function test_locale (s, patt)
+    local a = lib.find (s, patt)
+    local ok1 = pcall (lib.find, s, patt, 1, 0, 0, "no_such_locale")
+    local b = lib.find (s, patt, 1, 0, 0, "C")
+    local ok2 = pcall (lib.find, s, patt, 1, 0, 0, "no_such_locale")
+    local c = lib.find (s, patt, 1, 0, 0, "C")
+    return a, ok1, b, ok2, c
+  end
+  return {
+    Name = "Cache: keyed by locale",
+    Func = test_locale,
+  --{ subj,       patt        results }
+    { {"a1b2",    "\\d"},     {2, false, 2, false, 2} },
+    { {"a1b2",    "[a-z]\\d"},{1, false, 1, false, 1} },
+  }
+end
+
+local function set_f_reuse (lib, flg)
+  -- gmatch, gsub, count and split share one cached regex; each use must
+  -- read its own results before the next one runs it again
+  local function test_reuse (s, patt, times)
+    local out = {}
+    -- two iterators over the same pattern, stepped in turn
+    local it1, it2 = lib.gmatch (s, patt), lib.gmatch (s, patt)
+    for _ = 1, 2 do
+      out[#out+1] = (it1 () or "-") .. (it2 () or "-") .. (it1 () or "-")
+    end
+    -- a replacement function that runs the same pattern on other text
+    local r = lib.gsub (s, patt, function (w)
+      local inner = lib.gsub (w .. w, patt, "<%0>")
+      assert (lib.find (w, patt) == 1)
+      return inner
+    end)
+    out[#out+1] = r
+    -- enough calls to make the regex hot (PCRE2 JIT-compiles it)
+    for i = 1, times do
+      local g, n = lib.gsub (s, patt, "[%0]")
+      local parts = {}
+      for a, b in lib.split (s, patt) do parts[#parts+1] = a .. "|" .. (b or "") end
+      if i == 1 or i == times then
+        out[#out+1] = g .. " " .. n .. " " .. lib.count (s, patt) .. " " .. table.concat (parts, ";")
+      end
+    end
+    return table.concat (out, " / ")
+  end
+  return {
+    Name = "Cache: gmatch/gsub reuse",
+    Func = test_reuse,
+  --{ subj,         patt,   times  results }
+    { {"ab cd ef",  "[a-z]+", 10}, {"ababcd / efcd- / <abab> <cdcd> <efef>"
+                                 .. " / [ab] [cd] [ef] 3 3 |ab; |cd; |ef;|"
+                                 .. " / [ab] [cd] [ef] 3 3 |ab; |cd; |ef;|"} },
+    { {"12-3",      "[0-9]",  6 }, {"112 / 32- / <1><1><2><2>-<3><3>"
+                                 .. " / [1][2]-[3] 3 3 |1;|2;-|3;|"
+                                 .. " / [1][2]-[3] 3 3 |1;|2;-|3;|"} },
+  }
+end
+
+return function (libname)
+  local lib = require (libname)
+  local flags = lib.flags ()
+  local sets = {
+    set_f_evict (lib, flags),
+    set_f_evict_in_use (lib, flags),
+    set_f_cflags (lib, flags),
+    set_f_reuse (lib, flags),
+  }
+  if flags.NOSUB then
+    table.insert (sets, set_f_nosub (lib, flags))
+  end
+  if lib.maketables then
+    table.insert (sets, set_f_locale (lib, flags))
+  end
+  return sets
+end
@@ -57,13 +57,13 @@ local function test_library (libname, setfile, verbose, use_alien)
 end
 
 local avail_tests = {
-  posix     = { lib = "rex_posix",   "common_sets", "posix_sets" },
+  posix     = { lib = "rex_posix",   "common_sets", "posix_sets", "cache_sets" },
   gnu       = { lib = "rex_gnu",     "common_sets", "emacs_sets", "gnu_sets" },
   oniguruma = { lib = "rex_onig",    "common_sets", "oniguruma_sets", },
-  pcre      = { lib = "rex_pcre",    "common_sets", "pcre_sets", "pcre_sets2", },
-  pcre2     = { lib = "rex_pcre2",   "common_sets", "pcre_sets", "pcre_sets2", },
-  spencer   = { lib = "rex_spencer", "common_sets", "posix_sets", "spencer_sets" },
-  tre       = { lib = "rex_tre",     "common_sets", "posix_sets", "spencer_sets", --[["tre_sets"]] },
+  pcre      = { lib = "rex_pcre",    "common_sets", "pcre_sets", "pcre_sets2", "cache_sets", },
+  pcre2     = { lib = "rex_pcre2",   "common_sets", "pcre_sets", "pcre_sets2", "cache_sets", },
+  spencer   = { lib = "rex_spencer", "common_sets", "posix_sets", "spencer_sets", "cache_sets" },
+  tre       = { lib = "rex_tre",     "common_sets", "posix_sets", "spencer_sets", "cache_sets", --[["tre_sets"]] },
 }
 
 do
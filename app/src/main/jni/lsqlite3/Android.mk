@@ -1,7 +1,7 @@
 LOCAL_PATH := $(call my-dir)
 
 include $(CLEAR_VARS)
-LOCAL_C_INCLUDES += $(LOCAL_PATH)/../lua
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../lua $(LOCAL_PATH)/../tensor
 LOCAL_MODULE := lsqlite3
 LOCAL_SRC_FILES := \
 	lsqlite3.c \
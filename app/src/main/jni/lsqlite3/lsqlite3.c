@@ -29,6 +29,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
+#include <stdint.h>
 
 #define LUA_LIB
 #include "lua.h"
@@ -46,6 +48,7 @@
 #endif
 
 #include "sqlite3.h"
+#include "tensor_types.h"
 
 /* compile time features */
 #if !defined(SQLITE_OMIT_PROGRESS_CALLBACK)
@@ -109,6 +112,7 @@ struct sdb {
 static const char *sqlite_meta      = ":sqlite3";
 static const char *sqlite_vm_meta   = ":sqlite3:vm";
 static const char *sqlite_ctx_meta  = ":sqlite3:ctx";
+static const char *sqlite_fetch_meta = ":sqlite3:fetch";
 static int sqlite_ctx_meta_ref;
 
 /*
@@ -464,6 +468,266 @@ static int dbvm_get_named_types(lua_State *L) {
     return 1;
 }
 
+/*
+** ============================================
+** Virtual Machine - columnar fetch
+** ============================================
+**
+** stmt:fetch_columns([n]) steps up to n rows (all remaining rows when n is
+** omitted) and returns one column-oriented buffer per result column instead
+** of one table per row.  Numeric columns come back as 1-D int64/float64
+** Tensor objects that own the buffer the rows were decoded into, so no copy
+** happens between sqlite and the tensor module.  Text/blob columns come back
+** as { offsets = Tensor(int64, rows+1), bytes = string }, value i being
+** bytes:sub(offsets[i] + 1, offsets[i + 1]).
+**
+** The storage of a column is chosen by its first non-NULL value; an integer
+** column is promoted to float64 if a float shows up later.  NULL is stored as
+** NaN in float64 columns, 0 in int64 columns and "" in text columns.
+*/
+
+#define FETCH_COL_NULL   0      /* only NULLs seen so far */
+#define FETCH_COL_INT    1
+#define FETCH_COL_FLOAT  2
+#define FETCH_COL_TEXT   3
+
+#define FETCH_INIT_ROWS  256
+
+typedef struct fetch_col {
+    int kind;
+    int64_t *cells;         /* int64/double cells, or text offsets (rows+1) */
+    char *bytes;            /* text/blob payload */
+    size_t nbytes;
+    size_t bytes_cap;
+} fetch_col;
+
+/* The column buffers live in a userdata whose __gc frees whatever has not
+** been handed over to a Tensor yet, so raising an error while fetching
+** does not leak them. */
+typedef struct fetch_buf {
+    int columns;
+    fetch_col cols[];
+} fetch_buf;
+
+static int fetch_gc(lua_State *L) {
+    fetch_buf *fb = (fetch_buf*)luaL_checkudata(L, 1, sqlite_fetch_meta);
+    int i;
+    for (i = 0; i < fb->columns; ++i) {
+        free(fb->cols[i].cells);
+        free(fb->cols[i].bytes);
+        fb->cols[i].cells = NULL;
+        fb->cols[i].bytes = NULL;
+    }
+    fb->columns = 0;
+    return 0;
+}
+
+/* pushes the Tensor metatable, loading the tensor module on demand */
+static int fetch_tensor_meta(lua_State *L) {
+    luaL_getmetatable(L, "Tensor");
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_getglobal(L, "require");
+        lua_pushstring(L, "tensor");
+        lua_call(L, 1, 0);
+        luaL_getmetatable(L, "Tensor");
+        if (!lua_istable(L, -1))
+            luaL_error(L, "fetch_columns requires the tensor module");
+    }
+    return lua_gettop(L);
+}
+
+/* wraps an int64/double buffer of 'rows' cells in a 1-D Tensor, which takes
+** it over: *cells is cleared once nothing can raise any more */
+static void fetch_push_tensor(lua_State *L, int meta, TensorDataType dtype, int64_t **cells, int64_t rows) {
+    Tensor *t;
+    int i;
+
+    t = (Tensor*)lua_newuserdata(L, sizeof(Tensor));
+    for (i = 0; i < TENSOR_MAX_DIMS; i++) {
+        t->shape[i] = 1;
+        t->stride[i] = 0;
+    }
+    t->ndims = 1;
+    t->shape[0] = rows;
+    t->stride[0] = 1;
+    t->dtype = dtype;
+    t->itemsize = 8;
+    t->data = NULL;
+    t->size = rows;
+    t->owner = 1;
+    lua_pushvalue(L, meta);
+    lua_setmetatable(L, -2);
+    if (rows > 0)
+        t->data = *cells;
+    else
+        free(*cells);
+    *cells = NULL;
+}
+
+static int fetch_append_bytes(fetch_col *col, const void *p, size_t len) {
+    if (col->nbytes + len > col->bytes_cap) {
+        size_t cap = col->bytes_cap ? col->bytes_cap : 4096;
+        char *nb;
+        while (cap < col->nbytes + len) cap *= 2;
+        nb = (char*)realloc(col->bytes, cap);
+        if (nb == NULL) return 0;
+        col->bytes = nb;
+        col->bytes_cap = cap;
+    }
+    if (len > 0) memcpy(col->bytes + col->nbytes, p, len);
+    col->nbytes += len;
+    return 1;
+}
+
+/* decodes the current row into slot 'row' of every column buffer */
+static int fetch_store_row(sqlite3_stmt *vm, fetch_col *cols, int columns, int64_t row) {
+    int i;
+    for (i = 0; i < columns; ++i) {
+        fetch_col *col = &cols[i];
+        int type = sqlite3_column_type(vm, i);
+
+        if (col->kind == FETCH_COL_NULL && type != SQLITE_NULL) {
+            int64_t r;
+            switch (type) {
+                case SQLITE_INTEGER: col->kind = FETCH_COL_INT; break;
+                case SQLITE_FLOAT:
+                    col->kind = FETCH_COL_FLOAT;
+                    for (r = 0; r < row; r++) ((double*)col->cells)[r] = NAN;
+                    break;
+                default:
+                    /* every value so far is "": offsets 0..row are 0 (cell
+                    ** 'row' was never written and may come from realloc) */
+                    col->kind = FETCH_COL_TEXT;
+                    for (r = 0; r <= row; r++) col->cells[r] = 0;
+                    break;
+            }
+        }
+        else if (col->kind == FETCH_COL_INT && type == SQLITE_FLOAT) {
+            int64_t r;
+            for (r = 0; r < row; r++)
+                ((double*)col->cells)[r] = (double)col->cells[r];
+            col->kind = FETCH_COL_FLOAT;
+        }
+
+        switch (col->kind) {
+            case FETCH_COL_NULL:
+                col->cells[row] = 0;
+                break;
+            case FETCH_COL_INT:
+                col->cells[row] = type == SQLITE_NULL ? 0 : (int64_t)sqlite3_column_int64(vm, i);
+                break;
+            case FETCH_COL_FLOAT:
+                ((double*)col->cells)[row] = type == SQLITE_NULL ? NAN : sqlite3_column_double(vm, i);
+                break;
+            default: {
+                const void *p = NULL;
+                int len = 0;
+                if (type == SQLITE_BLOB) {
+                    p = sqlite3_column_blob(vm, i);
+                    len = sqlite3_column_bytes(vm, i);
+                }
+                else if (type != SQLITE_NULL) {
+                    p = sqlite3_column_text(vm, i);
+                    len = sqlite3_column_bytes(vm, i);
+                }
+                if (!fetch_append_bytes(col, p, (size_t)len)) return 0;
+                col->cells[row + 1] = (int64_t)col->nbytes;
+                break;
+            }
+        }
+    }
+    return 1;
+}
+
+static int dbvm_fetch_columns(lua_State *L) {
+    sdb_vm *svm = lsqlite_checkvm(L, 1);
+    lua_Integer limit = luaL_optinteger(L, 2, LUA_MAXINTEGER);
+    int columns = sqlite3_column_count(svm->vm);
+    int64_t rows = 0, cap = FETCH_INIT_ROWS;
+    fetch_buf *fb;
+    fetch_col *cols;
+    int meta, result = SQLITE_ROW, stepped = 0, i;
+
+    luaL_argcheck(L, limit >= 0, 2, "row count must be non-negative");
+    if (limit < cap) cap = (int64_t)limit;
+    meta = fetch_tensor_meta(L);
+
+    fb = (fetch_buf*)lua_newuserdata(L, sizeof(fetch_buf) + (size_t)columns * sizeof(fetch_col));
+    fb->columns = 0;
+    luaL_getmetatable(L, sqlite_fetch_meta);
+    lua_setmetatable(L, -2);
+    cols = fb->cols;
+    memset(cols, 0, (size_t)columns * sizeof(fetch_col));
+    fb->columns = columns;
+    for (i = 0; i < columns; ++i) {
+        /* one spare cell so text offsets can hold rows+1 entries */
+        cols[i].cells = (int64_t*)calloc((size_t)cap + 1, sizeof(int64_t));
+        if (cols[i].cells == NULL) luaL_error(L, "not enough memory");
+    }
+
+    while (rows < limit) {
+        result = stepvm(L, svm);
+        stepped = 1;
+        if (result != SQLITE_ROW) break;
+        if (rows == cap) {
+            int64_t ncap = cap * 2;
+            for (i = 0; i < columns; ++i) {
+                int64_t *nc = (int64_t*)realloc(cols[i].cells, ((size_t)ncap + 1) * sizeof(int64_t));
+                if (nc == NULL) luaL_error(L, "not enough memory");
+                cols[i].cells = nc;
+            }
+            cap = ncap;
+        }
+        if (!fetch_store_row(svm->vm, cols, columns, rows))
+            luaL_error(L, "not enough memory");
+        rows++;
+    }
+
+    /* fetch_columns(0) steps nothing and leaves the statement as it was */
+    if (stepped) {
+        svm->has_values = result == SQLITE_ROW ? 1 : 0;
+        svm->columns = sqlite3_data_count(svm->vm);
+    }
+    if (result != SQLITE_ROW) {
+        if (result == SQLITE_DONE)
+            result = sqlite3_reset(svm->vm);
+        if (result != SQLITE_OK) {
+            lua_pushstring(L, sqlite3_errmsg(svm->db->db));
+            lua_error(L);
+        }
+    }
+
+    lua_createtable(L, columns, columns);
+    for (i = 0; i < columns; ++i) {
+        fetch_col *col = &cols[i];
+        int64_t r;
+        switch (col->kind) {
+            case FETCH_COL_INT:
+                fetch_push_tensor(L, meta, TENSOR_INT64, &col->cells, rows);
+                break;
+            case FETCH_COL_TEXT:
+                lua_createtable(L, 0, 2);
+                fetch_push_tensor(L, meta, TENSOR_INT64, &col->cells, rows + 1);
+                lua_setfield(L, -2, "offsets");
+                lua_pushlstring(L, col->bytes ? col->bytes : "", col->nbytes);
+                lua_setfield(L, -2, "bytes");
+                break;
+            default:  /* float, or nothing but NULLs */
+                if (col->kind == FETCH_COL_NULL)
+                    for (r = 0; r < rows; r++) ((double*)col->cells)[r] = NAN;
+                fetch_push_tensor(L, meta, TENSOR_FLOAT64, &col->cells, rows);
+                break;
+        }
+        lua_pushstring(L, sqlite3_column_name(svm->vm, i));
+        lua_pushvalue(L, -2);
+        lua_rawset(L, -4);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_pushinteger(L, (lua_Integer)rows);
+    return 2;
+}
+
 /*
 ** ============================================
 ** Virtual Machine - Bind
@@ -2057,6 +2321,8 @@ static const luaL_Reg vmlib[] = {
     {"get_named_values",    dbvm_get_named_values   },
     {"get_named_types",     dbvm_get_named_types    },
 
+    {"fetch_columns",       dbvm_fetch_columns      },
+
     {"rows",                dbvm_rows               },
     {"urows",               dbvm_urows              },
     {"nrows",               dbvm_nrows              },
@@ -2094,6 +2360,11 @@ static const luaL_Reg ctxlib[] = {
     {NULL, NULL}
 };
 
+static const luaL_Reg fetchlib[] = {
+    {"__gc",                    fetch_gc                        },
+    {NULL, NULL}
+};
+
 static const luaL_Reg sqlitelib[] = {
     {"version",         lsqlite_version         },
     {"complete",        lsqlite_complete        },
@@ -2124,6 +2395,7 @@ LUALIB_API int luaopen_lsqlite3(lua_State *L) {
     create_meta(L, sqlite_meta, dblib);
     create_meta(L, sqlite_vm_meta, vmlib);
     create_meta(L, sqlite_ctx_meta, ctxlib);
+    create_meta(L, sqlite_fetch_meta, fetchlib);
 
     luaL_getmetatable(L, sqlite_ctx_meta);
     sqlite_ctx_meta_ref = luaL_ref(L, LUA_REGISTRYINDEX);
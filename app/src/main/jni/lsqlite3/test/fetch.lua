@@ -0,0 +1,125 @@
+-- stmt:fetch_columns([n])
+local sqlite3 = require "lsqlite3"
+
+local db = sqlite3.open_memory()
+assert(db:exec[[
+	create table t(i integer, f real, s text, b blob, n);
+	insert into t values (1, 1.5, 'one', x'00ff', NULL);
+	insert into t values (2, NULL, '', NULL, NULL);
+	insert into t values (NULL, 3, NULL, x'', NULL);
+]] == sqlite3.OK)
+
+local function isnan(x) return x ~= x end
+
+local function texts(col, rows)
+	local off, out = col.offsets:tolist(), {}
+	assert(#off == rows + 1 and off[1] == 0 and off[#off] == #col.bytes)
+	for i = 1, rows do out[i] = col.bytes:sub(off[i] + 1, off[i + 1]) end
+	return out
+end
+
+do print("column storage")
+	local st = db:prepare("select * from t")
+	local cols, rows = st:fetch_columns()
+	assert(rows == 3 and #cols == 5)
+	assert(cols[1] == cols.i and cols[5] == cols.n)
+
+	assert(cols.i:dtype() == "int64" and cols.i:size() == 3)
+	local i = cols.i:tolist()
+	assert(i[1] == 1 and i[2] == 2 and i[3] == 0)  -- NULL is 0
+
+	assert(cols.f:dtype() == "float64")
+	local f = cols.f:tolist()
+	assert(f[1] == 1.5 and isnan(f[2]) and f[3] == 3)
+
+	local s = texts(cols.s, 3)
+	assert(s[1] == "one" and s[2] == "" and s[3] == "")
+	local b = texts(cols.b, 3)
+	assert(b[1] == "\0\255" and b[2] == "" and b[3] == "")
+
+	-- nothing but NULLs: float64 NaN
+	assert(cols.n:dtype() == "float64")
+	for _, v in ipairs(cols.n:tolist()) do assert(isnan(v)) end
+	st:finalize()
+end
+
+do print("type changes between rows")
+	local st = db:prepare[[
+		select 1 union all select 2.5 union all select NULL union all select 4
+	]]
+	local cols, rows = st:fetch_columns()
+	local v = cols[1]:tolist()
+	assert(rows == 4 and cols[1]:dtype() == "float64")  -- promoted to float
+	assert(v[1] == 1 and v[2] == 2.5 and isnan(v[3]) and v[4] == 4)
+	st:finalize()
+
+	-- text after leading NULLs
+	st = db:prepare("select NULL union all select NULL union all select 'abc'")
+	cols, rows = st:fetch_columns()
+	local s = texts(cols[1], rows)
+	assert(rows == 3 and s[1] == "" and s[2] == "" and s[3] == "abc")
+	st:finalize()
+end
+
+do print("paging")
+	db:exec("create table big(k integer, v text)")
+	db:exec("begin")
+	local ins = db:prepare("insert into big values (?, ?)")
+	for k = 1, 1000 do
+		ins:bind_values(k, "v" .. k)
+		ins:step()
+		ins:reset()
+	end
+	ins:finalize()
+	db:exec("commit")
+
+	local st = db:prepare("select k, v from big order by k")
+	local seen, rows = 0, 300
+	while rows == 300 do
+		local cols
+		cols, rows = st:fetch_columns(300)
+		local k, v = cols.k:tolist(), texts(cols.v, rows)
+		for r = 1, rows do
+			seen = seen + 1
+			assert(k[r] == seen and v[r] == "v" .. seen)
+		end
+	end
+	assert(seen == 1000 and rows == 100)
+	-- the short page reset the statement, so it runs again
+	local cols, rows = st:fetch_columns()
+	assert(rows == 1000 and cols.k:tolist()[1000] == 1000)
+	st:finalize()
+end
+
+do print("a zero count steps nothing")
+	local st = db:prepare("select i from t")
+	local cols, rows = st:fetch_columns(0)
+	assert(rows == 0 and cols.i:size() == 0)
+	-- no row was stepped to, so there is no current row
+	assert(not pcall(st.get_value, st, 0))
+	assert(not pcall(st.get_values, st))
+	assert(st:step() == sqlite3.ROW and st:get_value(0) == 1)
+	-- a zero count keeps the current row
+	cols, rows = st:fetch_columns(0)
+	assert(rows == 0 and st:get_value(0) == 1)
+	cols, rows = st:fetch_columns()
+	assert(rows == 2 and cols.i:tolist()[1] == 2)
+	st:finalize()
+end
+
+do print("empty results and errors")
+	local st = db:prepare("select i, s from t where i > 100")
+	local cols, rows = st:fetch_columns()
+	assert(rows == 0 and cols.i:size() == 0)
+	-- no value decided the storage of s
+	assert(cols.s:dtype() == "float64" and cols.s:size() == 0)
+	assert(not pcall(st.fetch_columns, st, -1))
+	st:finalize()
+
+	st = db:prepare("select abs(-9223372036854775807 - 1)")
+	assert(not pcall(st.fetch_columns, st))  -- integer overflow raised
+	st:finalize()
+end
+
+db:close()
+print("OK")
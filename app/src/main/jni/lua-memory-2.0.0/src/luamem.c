@@ -113,20 +113,27 @@ LUAMEMLIB_API char *luamem_checkmemory (lua_State *L, int arg, size_t *len) {
 
 
 LUAMEMLIB_API int luamem_isarray (lua_State *L, int idx) {
-	return (lua_isstring(L, idx) || luamem_ismemory(L, idx));
+	return (lua_isstring(L, idx) || luamem_ismemory(L, idx) ||
+	        luaL_tobuffer(L, idx, NULL) != NULL);
 }
 
 LUAMEMLIB_API const char *luamem_toarray (lua_State *L, int idx, size_t *len) {
 	int type;
 	const char *s = luamem_tomemoryx(L, idx, len, NULL, &type);
-	if (type == LUAMEM_TNONE) return lua_tolstring(L, idx, len);
+	if (type == LUAMEM_TNONE) {
+		s = luaL_tobuffer(L, idx, len);  /* string buffer? */
+		if (!s) s = lua_tolstring(L, idx, len);
+	}
 	return s;
 }
 
 LUAMEMLIB_API const char *luamem_asarray (lua_State *L, int idx, size_t *len) {
 	int type;
 	const char *s = luamem_tomemoryx(L, idx, len, NULL, &type);
-	if (type == LUAMEM_TNONE) return luaL_tolstring(L, idx, len);
+	if (type == LUAMEM_TNONE) {
+		s = luaL_tobuffer(L, idx, len);  /* string buffer? */
+		if (!s) s = luaL_tolstring(L, idx, len);
+	}
 	return s;
 }
 
@@ -136,7 +143,8 @@ LUAMEMLIB_API const char *luamem_checkarray (lua_State *L,
 	int type;
 	const char *s = luamem_tomemoryx(L, arg, len, NULL, &type);
 	if (type == LUAMEM_TNONE) {
-		s = lua_tolstring(L, arg, len);
+		s = luaL_tobuffer(L, arg, len);  /* string buffer? */
+		if (!s) s = lua_tolstring(L, arg, len);
 		if (!s) luaL_typeerror(L, arg, "string or memory");
 	}
 	return s;
@@ -48,6 +48,8 @@ static size_t lpb_checkmem(lua_State *L, size_t ret)
 # define luaL_setfuncs(L,l,n) (assert(n==0), luaL_register(L,NULL,l))
 # define luaL_setmetatable(L, name) \
     (luaL_getmetatable((L), (name)), lua_setmetatable(L, -2))
+# define lua_getuservalue lua_getfenv
+# define lua_setuservalue lua_setfenv
 
 static void lua_rawgetp(lua_State *L, int idx, const void *p) {
     lua_pushlightuserdata(L, (void*)p);
@@ -131,6 +133,30 @@ static const char state_name[] = PB_STATE;
 enum lpb_Int64Mode { LPB_NUMBER, LPB_STRING, LPB_HEXSTRING };
 enum lpb_EncodeMode   { LPB_DEFDEF, LPB_COPYDEF, LPB_METADEF, LPB_NODEF };
 
+/* a compiled plan caches everything the codec needs to know about a
+ * message type: fields in number order, their names interned as Lua
+ * strings (kept alive by the keys table) and precomputed default values,
+ * plus lookup tables by field number and by interned name pointer */
+
+typedef struct lpb_FieldOp {
+    const pb_Field *f;
+    const char *key;      /* interned field name (a Lua string) */
+    const char *oneof;    /* interned oneof name, or NULL */
+    int key_ref;          /* index of the name in the keys table */
+    int oneof_ref;        /* index of the oneof name, or 0 */
+    int def_ref;          /* index of the default value, or 0 */
+} lpb_FieldOp;
+
+typedef struct lpb_Plan {
+    const pb_Type *t;
+    unsigned nops;
+    unsigned maxnum;      /* size of bynum, 0 if field numbers are sparse */
+    unsigned hmask;       /* byname has hmask+1 slots */
+    lpb_FieldOp *ops;     /* sorted by field number */
+    unsigned *bynum;      /* field number - 1 => op index + 1 */
+    unsigned *byname;     /* open addressing on key pointer => op index + 1 */
+} lpb_Plan;
+
 typedef struct lpb_State {
     const pb_State *state;
     pb_State  local;
@@ -141,6 +167,12 @@ typedef struct lpb_State {
     int defs_index;
     int enc_hooks_index;
     int dec_hooks_index;
+    int keys_index;
+    unsigned plan_gen;    /* bumped whenever cached plans are dropped */
+    unsigned plan_count;
+    unsigned plan_size;   /* slots in plans, 0 or a power of 2 */
+    lpb_Plan **plans;
+    lpb_Plan *plan_building; /* not in plans yet, freed if building it raised */
     unsigned use_dec_hooks : 1;
     unsigned use_enc_hooks : 1;
     unsigned enum_as_value : 1;
@@ -172,10 +204,28 @@ static void lpb_pushenchooktable(lua_State *L, lpb_State *LS)
 static void lpb_pushdechooktable(lua_State *L, lpb_State *LS)
 { LS->dec_hooks_index = lpb_reftable(L, LS->dec_hooks_index); }
 
+static void lpb_pushkeys(lua_State *L, lpb_State *LS)
+{ LS->keys_index = lpb_reftable(L, LS->keys_index); }
+
+static void lpb_resetplans(lua_State *L, lpb_State *LS) {
+    unsigned i;
+    for (i = 0; i < LS->plan_size; ++i)
+        free(LS->plans[i]);
+    free(LS->plans);
+    free(LS->plan_building);
+    LS->plans = NULL;
+    LS->plan_building = NULL;
+    LS->plan_count = LS->plan_size = 0;
+    LS->plan_gen++;
+    luaL_unref(L, LUA_REGISTRYINDEX, LS->keys_index);
+    LS->keys_index = LUA_NOREF;
+}
+
 static int Lpb_delete(lua_State *L) {
     lpb_State *LS = (lpb_State*)luaL_testudata(L, 1, PB_STATE);
     if (LS != NULL) {
         const pb_State *GS = global_state;
+        lpb_resetplans(L, LS);
         pb_free(&LS->local);
         if (&LS->local == GS)
             global_state = NULL;
@@ -201,6 +251,7 @@ LUALIB_API lpb_State *lpb_lstate(lua_State *L) {
         LS->defs_index = LUA_NOREF;
         LS->enc_hooks_index = LUA_NOREF;
         LS->dec_hooks_index = LUA_NOREF;
+        LS->keys_index = LUA_NOREF;
         LS->state = &LS->local;
         pb_init(&LS->local);
         pb_initbuffer(&LS->buffer);
@@ -1199,7 +1250,9 @@ static const pb_Field *lpb_field(lua_State *L, int idx, const pb_Type *t) {
 static int Lpb_load(lua_State *L) {
     lpb_State *LS = lpb_lstate(L);
     pb_Slice s = lpb_checkslice(L, 1);
-    int r = pb_load(&LS->local, &s);
+    int r;
+    lpb_resetplans(L, LS);
+    r = pb_load(&LS->local, &s);
     if (r == PB_OK) global_state = &LS->local;
     lua_pushboolean(L, r == PB_OK);
     lua_pushinteger(L, pb_pos(s)+1);
@@ -1213,6 +1266,7 @@ static int Lpb_load_unsafe(lua_State *L) {
     pb_Slice s = pb_lslice(data, size);
     int r;
     if (data == NULL) lpb_typeerror(L, 1, "userdata");
+    lpb_resetplans(L, LS);
     r = pb_load(&LS->local, &s);
     if (r == PB_OK) global_state = &LS->local;
     lua_pushboolean(L, r == PB_OK);
@@ -1239,6 +1293,7 @@ static int Lpb_loadfile(lua_State *L) {
     } while (size == BUFSIZ);
     fclose(fp);
     s = pb_result(&b);
+    lpb_resetplans(L, LS);
     ret = pb_load(&LS->local, &s);
     if (ret == PB_OK) global_state = &LS->local;
     pb_resetbuffer(&b);
@@ -1500,6 +1555,7 @@ static int Lpb_clear(lua_State *L) {
     lpb_State *LS = lpb_lstate(L);
     pb_State *S = (pb_State*)LS->state;
     pb_Type *t;
+    lpb_resetplans(L, LS);
     if (lua_isnoneornil(L, 1)) {
         pb_free(&LS->local), pb_init(&LS->local);
         luaL_unref(L, LUA_REGISTRYINDEX, LS->defs_index);
@@ -1547,6 +1603,131 @@ static int Lpb_typefmt(lua_State *L) {
     return 2;
 }
 
+/* compiled message plans */
+
+#define lpb_ptrhash(p) ((unsigned)((size_t)(p) >> 3) * 2654435761u)
+
+static const lpb_FieldOp *lpb_opbynum(const lpb_Plan *p, uint32_t number) {
+    const pb_Field *f;
+    if (number - 1 < p->maxnum) {
+        unsigned i = p->bynum[number - 1];
+        return i ? &p->ops[i - 1] : NULL;
+    }
+    if (p->maxnum || (f = pb_field(p->t, (int32_t)number)) == NULL)
+        return NULL;
+    return &p->ops[f->sorted_idx - 1];
+}
+
+static const lpb_FieldOp *lpb_opbyname(const lpb_Plan *p, const char *key) {
+    unsigned h = lpb_ptrhash(key) & p->hmask, i;
+    while ((i = p->byname[h]) != 0) {
+        if (p->ops[i - 1].key == key) return &p->ops[i - 1];
+        h = (h + 1) & p->hmask;
+    }
+    return NULL;
+}
+
+static int lpb_keyref(lua_State *L, int keys, const char **pkey) {
+    int ref = (int)lua_rawlen(L, keys) + 1;
+    if (pkey) *pkey = lua_tostring(L, -1);
+    lua_rawseti(L, keys, ref);
+    return ref;
+}
+
+static lpb_Plan *lpb_newplan(lua_State *L, lpb_State *LS, const pb_Type *t) {
+    pb_Field **list = t->field_count ? pb_sortedfields(t) : NULL;
+    unsigned i, n = t->field_count, maxnum = 0, hsize = 4;
+    int keys, top = lua_gettop(L);
+    lpb_Plan *p;
+    if (n) lpb_checkmem(L, list != NULL);
+    if (n && (unsigned)list[n-1]->number <= n*2 + 32)
+        maxnum = (unsigned)list[n-1]->number;
+    while (hsize < n*2) hsize <<= 1;
+    if (LS->plan_count*2 >= LS->plan_size) {
+        unsigned newsize = LS->plan_size ? LS->plan_size*2 : 16;
+        lpb_Plan **plans = (lpb_Plan**)calloc(newsize, sizeof(lpb_Plan*));
+        lpb_checkmem(L, plans != NULL);
+        for (i = 0; i < LS->plan_size; ++i) {
+            lpb_Plan *old = LS->plans[i];
+            unsigned h;
+            if (old == NULL) continue;
+            h = lpb_ptrhash(old->t) & (newsize - 1);
+            while (plans[h]) h = (h + 1) & (newsize - 1);
+            plans[h] = old;
+        }
+        free(LS->plans);
+        LS->plans = plans, LS->plan_size = newsize;
+    }
+    free(LS->plan_building);
+    p = LS->plan_building = (lpb_Plan*)calloc(1, sizeof(lpb_Plan)
+            + n*sizeof(lpb_FieldOp) + (maxnum + hsize)*sizeof(unsigned));
+    lpb_checkmem(L, p != NULL);
+    p->t = t, p->nops = n, p->maxnum = maxnum, p->hmask = hsize - 1;
+    p->ops = (lpb_FieldOp*)(p + 1);
+    p->bynum = (unsigned*)(p->ops + n);
+    p->byname = p->bynum + maxnum;
+    luaL_checkstack(L, 4, "not enough stack space for plan");
+    lpb_pushkeys(L, LS);
+    keys = lua_gettop(L);
+    for (i = 0; i < n; ++i) {
+        lpb_FieldOp *op = &p->ops[i];
+        const pb_Field *f = op->f = list[i];
+        unsigned h;
+        lua_pushstring(L, (const char*)f->name);
+        op->key_ref = lpb_keyref(L, keys, &op->key);
+        if (f->oneof_idx) {
+            lua_pushstring(L, (const char*)pb_oneofname(t, f->oneof_idx));
+            op->oneof_ref = lpb_keyref(L, keys, &op->oneof);
+        }
+        if (!f->repeated && !f->oneof_idx && f->type_id != PB_Tmessage
+                && lpb_pushdeffield(L, LS, f, t->is_proto3))
+            op->def_ref = lpb_keyref(L, keys, NULL);
+        if (maxnum) p->bynum[f->number - 1] = i + 1;
+        h = lpb_ptrhash(op->key) & p->hmask;
+        while (p->byname[h]) h = (h + 1) & p->hmask;
+        p->byname[h] = i + 1;
+    }
+    lua_settop(L, top);
+    /* only complete plans are visible to lookups */
+    i = lpb_ptrhash(t) & (LS->plan_size - 1);
+    while (LS->plans[i]) i = (i + 1) & (LS->plan_size - 1);
+    LS->plans[i] = p, LS->plan_count++;
+    LS->plan_building = NULL;
+    return p;
+}
+
+static const lpb_Plan *lpb_plan(lua_State *L, lpb_State *LS, const pb_Type *t) {
+    if (LS->plan_size) {
+        unsigned h = lpb_ptrhash(t) & (LS->plan_size - 1);
+        lpb_Plan *p;
+        while ((p = LS->plans[h]) != NULL) {
+            if (p->t == t) return p;
+            h = (h + 1) & (LS->plan_size - 1);
+        }
+    }
+    return lpb_newplan(L, LS, t);
+}
+
+/* enum and integer defaults are formatted by the enum_as_* and int64_*
+ * options; refresh them in place so plans and live views stay valid */
+static void lpb_refreshdefs(lua_State *L, lpb_State *LS) {
+    unsigned i, j;
+    if (LS->plan_count == 0) return;
+    lpb_pushkeys(L, LS);
+    for (i = 0; i < LS->plan_size; ++i) {
+        const lpb_Plan *p = LS->plans[i];
+        if (p == NULL) continue;
+        for (j = 0; j < p->nops; ++j) {
+            const lpb_FieldOp *op = &p->ops[j];
+            if (!op->def_ref) continue;
+            if (!lpb_pushdeffield(L, LS, op->f, p->t->is_proto3))
+                lua_pushnil(L);
+            lua_rawseti(L, -2, op->def_ref);
+        }
+    }
+    lua_pop(L, 1);
+}
+
 /* protobuf encode */
 
 typedef enum lpbE_Mode { lpbE_Raw, lpbE_NoZero, lpbE_Full } lpbE_Mode;
@@ -1556,6 +1737,7 @@ typedef struct lpb_Env {
     lpb_State *LS;
     pb_Buffer *b;
     pb_Slice  *s;
+    int keys;       /* stack index of the plan keys table when decoding */
 } lpb_Env;
 
 static void lpbE_encode (lpb_Env *e, int idx, const pb_Type *t);
@@ -1713,11 +1895,13 @@ static void lpbE_encode(lpb_Env *e, int idx, const pb_Type *t) {
             lua_pop(L, 1);
         }
     } else {
+        const lpb_Plan *p = lpb_plan(L, e->LS, t);
         lua_pushnil(L);
         while (lua_next(L, lpb_relindex(idx, 1))) {
             size_t len;
             const char *s = lua_tolstring(L, -2, &len);
-            const pb_Field *f =
+            const lpb_FieldOp *op = lpb_opbyname(p, s);
+            const pb_Field *f = op ? op->f :
                 pb_fname(t, lpb_name(e->LS, pb_lslice(s, len)));
             if (f != NULL) lpb_encode_onefield(e, -1, t, f);
             lua_pop(L, 1);
@@ -1731,7 +1915,7 @@ static int Lpb_encode(lua_State *L) {
     lpb_Env e;
     argcheck(L, t!=NULL, 1, "type '%s' does not exists", lua_tostring(L, 1));
     luaL_checktype(L, 2, LUA_TTABLE);
-    e.L = L, e.LS = LS, e.b = test_buffer(L, 3);
+    e.L = L, e.LS = LS, e.b = test_buffer(L, 3), e.keys = 0;
     if (e.b == NULL) e.b = &LS->buffer, pb_bufflen(e.b) = 0;
     if (e.LS->use_enc_hooks) lpb_useenchooks(&e, 2, t);
     lpbE_encode(&e, 2, t);
@@ -1762,7 +1946,7 @@ static int Lpb_pack(lua_State* L) {
     lpb_Env e;
     int idx = 3;
     argcheck(L, t!=NULL, 1, "type '%s' does not exists", lua_tostring(L, 1));
-    e.L = L, e.LS = LS, e.b = test_buffer(L, 2);
+    e.L = L, e.LS = LS, e.b = test_buffer(L, 2), e.keys = 0;
     if (e.b == NULL)
         idx = 2, e.b = &LS->buffer, pb_bufflen(e.b) = 0;
     lpbE_pack(&e, idx, t);
@@ -1778,6 +1962,7 @@ static int Lpb_pack(lua_State* L) {
 #define lpb_withinput(e,ns,stmt) ((e)->s = (ns), (stmt), (e)->s = s)
 
 static int lpbD_message(lpb_Env *e, const pb_Type *t);
+static void lpbD_pushtypetable(lpb_Env *e, const pb_Type *t);
 
 static void lpb_usedechooks(lua_State *L, lpb_State *LS, const pb_Type *t) {
     lpb_pushdechooktable(L, LS);
@@ -1813,6 +1998,81 @@ static void lpb_pushtypetable(lua_State *L, lpb_State *LS, const pb_Type *t) {
     }
 }
 
+static void lpbD_fetchtable(lpb_Env *e, const lpb_FieldOp *op, const pb_Type *t) {
+    lua_State *L = e->L;
+    lua_rawgeti(L, e->keys, op->key_ref);
+    lua_pushvalue(L, -1);
+    lua_gettable(L, -3);
+    if (!lua_isnil(L, -1))
+        lua_remove(L, -2);
+    else {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_insert(L, -3);
+        lua_settable(L, -4);
+    }
+    if (t->is_dead) return;
+    if (lua_getmetatable(L, -1))
+        lua_pop(L, 1);
+    else {
+        lpb_pushdefmeta(L, e->LS, t);
+        lua_setmetatable(L, -2);
+    }
+}
+
+static void lpbD_setdeffields(lpb_Env *e, const lpb_Plan *p, lpb_DefFlags flags) {
+    lua_State *L = e->L;
+    lpb_State *LS = e->LS;
+    const pb_Type *t = p->t;
+    unsigned i;
+    for (i = 0; i < p->nops; ++i) {
+        const lpb_FieldOp *op = &p->ops[i];
+        const pb_Field *f = op->f;
+        if (f->repeated) {
+            if ((flags & USE_REPEAT) && (t->is_proto3 || LS->decode_default_array)) {
+                lpbD_fetchtable(e, op, f->type && f->type->is_map ?
+                        &LS->map_type : &LS->array_type);
+                lua_pop(L, 1);
+            }
+        } else if (op->def_ref && (flags & USE_FIELD)) {
+            lua_rawgeti(L, e->keys, op->key_ref);
+            lua_rawgeti(L, e->keys, op->def_ref);
+            lua_rawset(L, -3);
+        } else if (!f->oneof_idx && f->type_id == PB_Tmessage
+                && (flags & USE_MESSAGE) && LS->decode_default_message) {
+            lua_rawgeti(L, e->keys, op->key_ref);
+            lpbD_pushtypetable(e, f->type);
+            lua_rawset(L, -3);
+        }
+    }
+}
+
+static void lpbD_pushtypetable(lpb_Env *e, const pb_Type *t) {
+    lua_State *L = e->L;
+    lpb_State *LS = e->LS;
+    int mode = LS->encode_mode;
+    const lpb_Plan *p;
+    luaL_checkstack(L, 5, "too many levels");
+    p = lpb_plan(L, LS, t);
+    lpb_newmsgtable(L, t);
+    switch (t->is_proto3 && mode == LPB_DEFDEF ? LPB_COPYDEF : mode) {
+    case LPB_COPYDEF:
+        lpbD_setdeffields(e, p,
+                (lpb_DefFlags)(USE_FIELD|USE_REPEAT|USE_MESSAGE));
+        break;
+    case LPB_METADEF:
+        lpbD_setdeffields(e, p, (lpb_DefFlags)(USE_REPEAT|USE_MESSAGE));
+        lpb_pushdefmeta(L, LS, t);
+        lua_setmetatable(L, -2);
+        break;
+    default:
+        if (LS->decode_default_array || LS->decode_default_message)
+            lpbD_setdeffields(e, p, (lpb_DefFlags)(USE_REPEAT|USE_MESSAGE));
+        break;
+    }
+}
+
 static void lpbD_field(lpb_Env *e, const pb_Field *f) {
     lua_State *L = e->L;
     pb_Slice sv, *s = e->s;
@@ -1822,10 +2082,10 @@ static void lpbD_field(lpb_Env *e, const pb_Field *f) {
     case PB_Tenum:
         if (pb_readvarint64(s, &u64) == 0)
             luaL_error(L, "invalid varint value at offset %d", pb_pos(*s)+1);
-        if (!lpb_lstate(L)->enum_as_value)
+        if (!e->LS->enum_as_value)
             ev = pb_field(f->type, (int32_t)u64);
         if (ev) lua_pushstring(L, (const char*)ev->name);
-        else lpb_pushinteger(L, (lua_Integer)u64, 1, lpb_lstate(L)->int64_mode);
+        else lpb_pushinteger(L, (lua_Integer)u64, 1, e->LS->int64_mode);
         if (e->LS->use_dec_hooks) lpb_usedechooks(L, e->LS, f->type);
         break;
     case PB_Tmessage:
@@ -1833,7 +2093,7 @@ static void lpbD_field(lpb_Env *e, const pb_Field *f) {
         if (f->type == NULL || f->type->is_dead)
             lua_pushnil(L);
         else {
-            lpb_pushtypetable(L, e->LS, f->type);
+            lpbD_pushtypetable(e, f->type);
             lpb_withinput(e, &sv, lpbD_message(e, f->type));
         }
         break;
@@ -1902,25 +2162,28 @@ static void lpbD_repeated(lpb_Env *e, const pb_Field *f, uint32_t tag) {
 static int lpbD_message(lpb_Env *e, const pb_Type *t) {
     lua_State *L = e->L;
     pb_Slice *s = e->s;
+    const lpb_Plan *p;
     uint32_t tag;
     luaL_checkstack(L, 5, "not enough stack space for fields");
+    p = lpb_plan(L, e->LS, t);
     while (pb_readvarint32(s, &tag)) {
-        const pb_Field *f = pb_field(t, pb_gettag(tag));
+        const lpb_FieldOp *op = lpb_opbynum(p, pb_gettag(tag));
+        const pb_Field *f = op ? op->f : NULL;
         if (f == NULL)
             pb_skipvalue(s, tag);
         else if (f->type && f->type->is_map) {
-            lpb_fetchtable(L, e->LS, f, &e->LS->map_type);
+            lpbD_fetchtable(e, op, &e->LS->map_type);
             lpbD_checktype(e, f, tag);
             lpbD_map(e, f);
             lua_pop(L, 1);
         } else if (f->repeated) {
-            lpb_fetchtable(L, e->LS, f, &e->LS->array_type);
+            lpbD_fetchtable(e, op, &e->LS->array_type);
             lpbD_repeated(e, f, tag);
             lua_pop(L, 1);
         } else {
-            lua_pushstring(L, (const char*)f->name);
-            if (f->oneof_idx) {
-                lua_pushstring(L, (const char*)pb_oneofname(t, f->oneof_idx));
+            lua_rawgeti(L, e->keys, op->key_ref);
+            if (op->oneof_ref) {
+                lua_rawgeti(L, e->keys, op->oneof_ref);
                 lua_pushvalue(L, -2);
                 lua_rawset(L, -4);
             }
@@ -1938,11 +2201,13 @@ static int lpbD_decode(lua_State *L, pb_Slice s, int start) {
     lpb_Env e;
     argcheck(L, t!=NULL, 1, "type '%s' does not exists", lua_tostring(L, 1));
     lua_settop(L, start);
-    if (!lua_istable(L, start)) {
+    lpb_pushkeys(L, LS);
+    lua_insert(L, start);
+    e.L = L, e.LS = LS, e.s = &s, e.keys = start;
+    if (!lua_istable(L, start+1)) {
         lua_pop(L, 1);
-        lpb_pushtypetable(L, LS, t);
+        lpbD_pushtypetable(&e, t);
     }
-    e.L = L, e.LS = LS, e.s = &s;
     return lpbD_message(&e, t);
 }
 
@@ -2009,11 +2274,155 @@ static int Lpb_unpack(lua_State* L) {
     const pb_Type* t = lpb_type(L, LS, lpb_checkslice(L, 1));
     pb_Slice s = lpb_checkslice(L, 2);
     lpb_Env e;
-    e.L = L, e.LS = LS, e.s = &s;
     argcheck(L, t != NULL, 1, "type '%s' does not exists", lua_tostring(L, 1));
+    lpb_pushkeys(L, LS);
+    e.L = L, e.LS = LS, e.s = &s, e.keys = lua_gettop(L);
     return lpbD_unpack(&e, t);
 }
 
+/* lazy message view */
+
+#define PB_VIEW "pb.View"
+
+typedef struct lpb_ViewSlot {
+    const char *p;        /* start of the last value seen, NULL if absent */
+    uint32_t tag;
+} lpb_ViewSlot;
+
+typedef struct lpb_View {
+    const lpb_Plan *plan;
+    unsigned gen;
+    int scanned;
+    pb_Slice s;
+    lpb_ViewSlot slots[1];
+} lpb_View;
+
+static void lpbV_new(lua_State *L, lpb_State *LS, const pb_Type *t, pb_Slice s, int data) {
+    const lpb_Plan *p = lpb_plan(L, LS, t);
+    size_t size = sizeof(lpb_View);
+    lpb_View *v;
+    if (p->nops > 1) size += (p->nops - 1) * sizeof(lpb_ViewSlot);
+    v = (lpb_View*)lua_newuserdata(L, size);
+    v->plan = p, v->gen = LS->plan_gen, v->scanned = 0, v->s = s;
+    luaL_setmetatable(L, PB_VIEW);
+    lua_createtable(L, 1, 0);
+    lua_pushvalue(L, lpb_relindex(data, 2));
+    lua_rawseti(L, -2, 1);
+    lua_setuservalue(L, -2);
+}
+
+static void lpbV_scan(lua_State *L, lpb_View *v) {
+    pb_Slice s = v->s;
+    uint32_t tag;
+    memset(v->slots, 0, v->plan->nops * sizeof(lpb_ViewSlot));
+    while (pb_readvarint32(&s, &tag)) {
+        const lpb_FieldOp *op = lpb_opbynum(v->plan, pb_gettag(tag));
+        if (op != NULL) {
+            lpb_ViewSlot *slot = &v->slots[op - v->plan->ops];
+            slot->p = s.p, slot->tag = tag;
+        }
+        if (pb_skipvalue(&s, tag) == 0)
+            luaL_error(L, "invalid wire data at offset %d", pb_pos(s)+1);
+    }
+    v->scanned = 1;
+}
+
+static const lpb_FieldOp *lpbV_op(lua_State *L, lpb_State *LS, lpb_View *v, int *oneof) {
+    const lpb_Plan *p = v->plan;
+    const lpb_FieldOp *op = NULL;
+    size_t len;
+    const char *name;
+    const pb_Field *f;
+    unsigned i;
+    name = lua_tolstring(L, 2, &len);
+    if ((op = lpb_opbyname(p, name)) != NULL) return op;
+    if ((f = pb_fname(p->t, lpb_name(LS, pb_lslice(name, len)))) != NULL)
+        return &p->ops[f->sorted_idx - 1];
+    /* a oneof name resolves to whichever member appears last */
+    for (i = 0; i < p->nops; ++i) {
+        if (p->ops[i].oneof == NULL || strcmp(p->ops[i].oneof, name) != 0)
+            continue;
+        *oneof = 1;
+        if (v->slots[i].p && (op == NULL || v->slots[i].p > v->slots[op - p->ops].p))
+            op = &p->ops[i];
+    }
+    return op;
+}
+
+static int Lpb_view_index(lua_State *L) {
+    lpb_View *v = (lpb_View*)luaL_checkudata(L, 1, PB_VIEW);
+    lpb_State *LS = lpb_lstate(L);
+    const lpb_FieldOp *op;
+    const lpb_ViewSlot *slot;
+    const pb_Field *f;
+    int oneof = 0, mode;
+    lpb_Env e;
+    pb_Slice s;
+    argcheck(L, v->gen == LS->plan_gen, 1, "schema changed since view was created");
+    if (lua_type(L, 2) != LUA_TSTRING) return 0;
+    lua_settop(L, 2);
+    lua_getuservalue(L, 1);
+    lua_pushvalue(L, 2);
+    lua_rawget(L, 3);
+    if (!lua_isnil(L, -1)) return 1;
+    lua_pop(L, 1);
+    if (!v->scanned) lpbV_scan(L, v);
+    if ((op = lpbV_op(L, LS, v, &oneof)) == NULL) return 0;
+    if (oneof) return lua_pushstring(L, op->key), 1;
+    lpb_pushkeys(L, LS);
+    e.L = L, e.LS = LS, e.s = &s, e.keys = 4;
+    f = op->f, slot = &v->slots[op - v->plan->ops];
+    mode = v->plan->t->is_proto3 && LS->encode_mode == LPB_DEFDEF ?
+        LPB_COPYDEF : LS->encode_mode;
+    if (f->repeated) {
+        uint32_t tag;
+        if (slot->p == NULL && !v->plan->t->is_proto3 && !LS->decode_default_array)
+            return 0;
+        lua_newtable(L);
+        s = v->s;
+        while (slot->p && pb_readvarint32(&s, &tag)) {
+            if (pb_gettag(tag) != (uint32_t)f->number)
+                pb_skipvalue(&s, tag);
+            else if (f->type && f->type->is_map)
+                lpbD_checktype(&e, f, tag), lpbD_map(&e, f);
+            else
+                lpbD_repeated(&e, f, tag);
+        }
+    } else if (slot->p == NULL) {
+        /* same defaults decode() would have stored in the table */
+        if (!op->def_ref || (mode != LPB_COPYDEF && mode != LPB_METADEF))
+            return 0;
+        lua_rawgeti(L, 4, op->def_ref);
+    } else {
+        s = pb_lslice(slot->p, v->s.end - slot->p);
+        lpbD_checktype(&e, f, slot->tag);
+        if (f->type_id != PB_Tmessage)
+            lpbD_field(&e, f);
+        else if (f->type == NULL || f->type->is_dead)
+            return 0;
+        else {
+            pb_Slice sv;
+            lpb_readbytes(L, &s, &sv);
+            lua_rawgeti(L, 3, 1);
+            lpbV_new(L, LS, f->type, sv, -1);
+            lua_remove(L, -2);
+        }
+    }
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, 3);
+    return 1;
+}
+
+static int Lpb_view(lua_State *L) {
+    lpb_State *LS = lpb_lstate(L);
+    const pb_Type *t = lpb_type(L, LS, lpb_checkslice(L, 1));
+    pb_Slice s = lpb_checkslice(L, 2);
+    argcheck(L, t != NULL, 1, "type '%s' does not exists", lua_tostring(L, 1));
+    lpbV_new(L, LS, t, s, 2);
+    return 1;
+}
+
 /* pb module interface */
 
 static int Lpb_option(lua_State *L) {
@@ -2047,11 +2456,13 @@ static int Lpb_option(lua_State *L) {
         NULL
     };
     lpb_State *LS = lpb_lstate(L);
-    switch (luaL_checkoption(L, 1, NULL, opts)) {
+    int opt = luaL_checkoption(L, 1, NULL, opts);
+    switch (opt) {
 #define X(ID,NAME,CODE) case ID: CODE; break;
         OPTS(X)
 #undef  X
     }
+    if (opt <= 4) lpb_refreshdefs(L, LS); /* enum_as_* and int64_as_* */
     return 0;
 #undef  OPTS
 }
@@ -2080,6 +2491,7 @@ LUALIB_API int luaopen_pb(lua_State *L) {
         ENTRY(state),
         ENTRY(pack),
         ENTRY(unpack),
+        ENTRY(view),
 #undef  ENTRY
         { NULL, NULL }
     };
@@ -2093,6 +2505,11 @@ LUALIB_API int luaopen_pb(lua_State *L) {
         lua_pushvalue(L, -1);
         lua_setfield(L, -2, "__index");
     }
+    if (luaL_newmetatable(L, PB_VIEW)) {
+        lua_pushcfunction(L, Lpb_view_index);
+        lua_setfield(L, -2, "__index");
+    }
+    lua_pop(L, 1);
     luaL_newlib(L, libs);
     return 1;
 }
@@ -2122,6 +2539,7 @@ static int Lpb_use(lua_State *L) {
     const char *opts[] = { "global", "local", NULL };
     lpb_State *LS = lpb_lstate(L);
     const pb_State *GS = global_state;
+    lpb_resetplans(L, LS);
     switch (luaL_checkoption(L, 1, NULL, opts)) {
     case 0: if (GS) LS->state = GS; break;
     case 1: LS->state = &LS->local; break;
@@ -1726,6 +1726,105 @@ function _G.test_extend_pack()
    eq(v2, nil)
 end
 
+function _G.test_view()
+   withstate(function()
+   protoc.reload()
+   check_load [[
+      enum Color { RED = 0; GREEN = 1; BLUE = 2; }
+      message Point { optional int32 x = 1; optional int32 y = 2; }
+      message Shape {
+         optional string   name   = 1;
+         optional int64    id     = 2 [default = 8589934592];
+         optional Color    color  = 3 [default = GREEN];
+         repeated Point    points = 4;
+         optional Point    origin = 5;
+         map<string,int32> tags   = 6;
+         oneof body {
+            string text  = 7;
+            int32  count = 8;
+         }
+         repeated int32    packed = 9 [packed = true];
+         optional int32    absent = 10;
+      } ]]
+   local data = {
+      name = "tri", id = 42, color = "BLUE",
+      points = { { x = 1, y = 2 }, { x = 3 }, { y = 4 } },
+      origin = { x = -1, y = -2 },
+      tags = { a = 1, b = 2 },
+      count = 5,
+      packed = { 1, 2, 3 },
+   }
+   local bytes = pb.encode("Shape", data)
+   local v = pb.view("Shape", bytes)
+   eq(type(v), "userdata")
+   eq(v.name, "tri")
+   eq(v.id, 42)
+   eq(v.color, "BLUE")
+   eq(v.points, { { x = 1, y = 2 }, { x = 3 }, { y = 4 } })
+   eq(v.tags, { a = 1, b = 2 })
+   eq(v.packed, { 1, 2, 3 })
+   eq(v.body, "count")
+   eq(v.count, 5)
+   eq(v.text, nil)
+   eq(v.absent, nil)
+   eq(v.unknown, nil)
+   eq(v[1], nil)
+
+   -- sub messages are views themselves, cached on first access
+   local o = v.origin
+   eq(type(o), "userdata")
+   eq(o.x, -1)
+   eq(o.y, -2)
+   eq(rawequal(v.origin, o), true)
+   eq(rawequal(v.points, v.points), true)
+
+   -- the same values decode() produces
+   local t = pb.decode("Shape", bytes)
+   for _, k in ipairs { "name", "id", "color", "points", "tags", "count", "packed" } do
+      eq(v[k], t[k])
+   end
+
+   -- defaults follow the current options, like decode()
+   eq(pb.view("Shape", "").id, pb.decode("Shape", "").id)
+   pb.option "use_default_values"
+   local e = pb.view("Shape", "")
+   eq(e.id, 8589934592)
+   eq(e.color, "GREEN")
+   eq(e.name, nil)
+   eq(e.points, nil)
+   pb.option "no_default_values"
+   eq(e.color, "GREEN") -- cached when first read
+   eq(pb.view("Shape", "").id, nil)
+   pb.option "use_default_values"
+   pb.option "decode_default_array"
+   eq(pb.view("Shape", "").points, {})
+   pb.option "no_decode_default_array"
+
+   -- options do not invalidate views created before them
+   local live = pb.view("Shape", pb.encode("Shape", { count = 1 }))
+   eq(live.name, nil)
+   pb.option "enum_as_value"
+   eq(live.color, 1)
+   eq(pb.view("Shape", bytes).color, 2)
+   pb.option "int64_as_string"
+   eq(live.id, "#8589934592")
+   pb.option "int64_as_number"
+   pb.option "enum_as_name"
+   eq(live.color, 1) -- cached when first read
+   eq(pb.view("Shape", "").color, "GREEN")
+   pb.option "auto_default_values"
+
+   -- reloading the schema does
+   check_load [[ message Other { optional int32 a = 1; } ]]
+   fail("schema changed since view was created", function() return live.count end)
+
+   -- the data is scanned on first access
+   local bad = pb.view("Shape", "\10\200")
+   fail("invalid wire data", function() return bad.name end)
+   fail("type 'NoSuchType' does not exists", function() pb.view("NoSuchType", "") end)
+   end)
+end
+
 if _VERSION == "Lua 5.1" and not _G.jit then
    lu.LuaUnit.run()
 else
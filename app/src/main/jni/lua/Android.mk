@@ -58,8 +58,14 @@ LOCAL_SRC_FILES := \
 	llibc.c \
 	logtable.c \
 	json_parser.c \
-	sha256.c \
-	lobfuscate.c
+	lhash.c \
+	lhashlib.c \
+	laes.c \
+	laeslib.c \
+	lobfuscate.c \
+	lopt.c \
+	ljit.c \
+	ljitlib.c
 
 LOCAL_CFLAGS += -DLUA_DL_DLOPEN -DLUA_COMPAT_MATHLIB -DLUA_COMPAT_MAXN -DLUA_COMPAT_MODULE
 
@@ -0,0 +1,1041 @@
+/*
+** laes.c
+** Core AES engine (see laes.h)
+** Every backend shares the FIPS-197 key schedule built here. x86 uses
+** AES-NI and PCLMULQDQ, arm64 the ARMv8 AES and PMULL instructions, both
+** chosen once at runtime. Bulk modes keep eight blocks in flight.
+*/
+
+#define laes_c
+#define LUA_LIB
+
+#include "lprefix.h"
+
+
+#include <string.h>
+
+#include "laes.h"
+
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LAES_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+#define LAES_ARM
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#endif
+
+
+static inline uint32_t load32be (const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store32be (uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+static inline uint64_t load64be (const uint8_t *p) {
+  return ((uint64_t)load32be(p) << 32) | load32be(p + 4);
+}
+
+static inline void store64be (uint8_t *p, uint64_t v) {
+  store32be(p, (uint32_t)(v >> 32));
+  store32be(p + 4, (uint32_t)v);
+}
+
+#define ror32(x,n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+#define FOR8(X)	X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7)
+
+
+/* increments a big-endian counter; GCM ('wide' == 0) wraps the low word only */
+static void ctr_inc (uint8_t c[LAES_BLOCK], int wide) {
+  int i, stop = wide ? 0 : 12;
+  for (i = 15; i >= stop; i--)
+    if (++c[i] != 0)
+      break;
+}
+
+
+/*
+** {======================================================
+** Tables and key schedule
+** =======================================================
+*/
+
+static uint8_t SB[256], ISB[256];
+static uint32_t TE[256], TD[256];  /* MixColumns(S[x]) and InvMixColumns(Si[x]) of one column */
+
+static uint8_t xt (uint8_t x) {
+  return (uint8_t)((x << 1) ^ ((x >> 7) * 0x1b));
+}
+
+static uint8_t gmul (uint8_t a, uint8_t b) {
+  uint8_t r = 0;
+  for (; b; b >>= 1, a = xt(a))
+    if (b & 1) r ^= a;
+  return r;
+}
+
+#define rotl8(x,n)	((uint8_t)(((x) << (n)) | ((x) >> (8 - (n)))))
+
+static void aes_maketables (void) {
+  uint8_t p = 1, q = 1;
+  int i;
+  do {  /* walk the multiplicative group with generator 3 */
+    p = (uint8_t)(p ^ xt(p));
+    q ^= (uint8_t)(q << 1);
+    q ^= (uint8_t)(q << 2);
+    q ^= (uint8_t)(q << 4);
+    if (q & 0x80) q ^= 0x09;
+    SB[p] = (uint8_t)(q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4) ^ 0x63);
+  } while (p != 1);
+  SB[0] = 0x63;
+  for (i = 0; i < 256; i++)
+    ISB[SB[i]] = (uint8_t)i;
+  for (i = 0; i < 256; i++) {
+    uint8_t s = SB[i], t = ISB[i];
+    TE[i] = ((uint32_t)xt(s) << 24) | ((uint32_t)s << 16) |
+            ((uint32_t)s << 8) | (uint32_t)(xt(s) ^ s);
+    TD[i] = ((uint32_t)gmul(t, 14) << 24) | ((uint32_t)gmul(t, 9) << 16) |
+            ((uint32_t)gmul(t, 13) << 8) | (uint32_t)gmul(t, 11);
+  }
+}
+
+static uint32_t subword (uint32_t w) {
+  return ((uint32_t)SB[w >> 24] << 24) | ((uint32_t)SB[(w >> 16) & 0xff] << 16) |
+         ((uint32_t)SB[(w >> 8) & 0xff] << 8) | (uint32_t)SB[w & 0xff];
+}
+
+static uint32_t invmixcol (uint32_t w) {
+  return TD[SB[w >> 24]] ^ ror32(TD[SB[(w >> 16) & 0xff]], 8) ^
+         ror32(TD[SB[(w >> 8) & 0xff]], 16) ^ ror32(TD[SB[w & 0xff]], 24);
+}
+
+/* }====================================================== */
+
+
+/*
+** {======================================================
+** Portable backend
+** =======================================================
+*/
+
+typedef void (*laes_Blocks) (const laes_Key *k, const uint8_t *in, uint8_t *out, size_t n);
+typedef void (*laes_Chain) (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                            const uint8_t *in, uint8_t *out, size_t n);
+typedef void (*laes_Ctr) (const laes_Key *k, uint8_t ctr[LAES_BLOCK],
+                          const uint8_t *in, uint8_t *out, size_t n, int wide);
+typedef void (*laes_Ghash) (uint64_t y[2], const uint64_t h[4][2], const uint8_t *p, size_t n);
+
+
+#define TROUND(t,s,a,b,c,d,k) \
+  t = T[s##a >> 24] ^ ror32(T[(s##b >> 16) & 0xff], 8) ^ \
+      ror32(T[(s##c >> 8) & 0xff], 16) ^ ror32(T[s##d & 0xff], 24) ^ load32be(k)
+
+#define TLAST(s,a,b,c,d,k,S) \
+  ((((uint32_t)S[s##a >> 24] << 24) | ((uint32_t)S[(s##b >> 16) & 0xff] << 16) | \
+    ((uint32_t)S[(s##c >> 8) & 0xff] << 8) | (uint32_t)S[s##d & 0xff]) ^ load32be(k))
+
+static void aes_block_c (const uint8_t *rk, int nr, const uint32_t *T,
+                         const uint8_t *S, int inv, const uint8_t *in, uint8_t *out) {
+  uint32_t s0 = load32be(in) ^ load32be(rk), s1 = load32be(in + 4) ^ load32be(rk + 4);
+  uint32_t s2 = load32be(in + 8) ^ load32be(rk + 8), s3 = load32be(in + 12) ^ load32be(rk + 12);
+  uint32_t t0, t1, t2, t3;
+  int r;
+  for (r = 1, rk += 16; r < nr; r++, rk += 16) {
+    if (!inv) {
+      TROUND(t0, s, 0, 1, 2, 3, rk);
+      TROUND(t1, s, 1, 2, 3, 0, rk + 4);
+      TROUND(t2, s, 2, 3, 0, 1, rk + 8);
+      TROUND(t3, s, 3, 0, 1, 2, rk + 12);
+    }
+    else {
+      TROUND(t0, s, 0, 3, 2, 1, rk);
+      TROUND(t1, s, 1, 0, 3, 2, rk + 4);
+      TROUND(t2, s, 2, 1, 0, 3, rk + 8);
+      TROUND(t3, s, 3, 2, 1, 0, rk + 12);
+    }
+    s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+  }
+  if (!inv) {
+    store32be(out, TLAST(s, 0, 1, 2, 3, rk, S));
+    store32be(out + 4, TLAST(s, 1, 2, 3, 0, rk + 4, S));
+    store32be(out + 8, TLAST(s, 2, 3, 0, 1, rk + 8, S));
+    store32be(out + 12, TLAST(s, 3, 0, 1, 2, rk + 12, S));
+  }
+  else {
+    store32be(out, TLAST(s, 0, 3, 2, 1, rk, S));
+    store32be(out + 4, TLAST(s, 1, 0, 3, 2, rk + 4, S));
+    store32be(out + 8, TLAST(s, 2, 1, 0, 3, rk + 8, S));
+    store32be(out + 12, TLAST(s, 3, 2, 1, 0, rk + 12, S));
+  }
+}
+
+static void ecb_enc_c (const laes_Key *k, const uint8_t *in, uint8_t *out, size_t n) {
+  for (; n > 0; n--, in += 16, out += 16)
+    aes_block_c(k->ek, k->rounds, TE, SB, 0, in, out);
+}
+
+static void ecb_dec_c (const laes_Key *k, const uint8_t *in, uint8_t *out, size_t n) {
+  for (; n > 0; n--, in += 16, out += 16)
+    aes_block_c(k->dk, k->rounds, TD, ISB, 1, in, out);
+}
+
+static void cbc_enc_c (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                       const uint8_t *in, uint8_t *out, size_t n) {
+  uint8_t x[LAES_BLOCK];
+  int i;
+  for (; n > 0; n--, in += 16, out += 16) {
+    for (i = 0; i < 16; i++) x[i] = in[i] ^ iv[i];
+    aes_block_c(k->ek, k->rounds, TE, SB, 0, x, iv);
+    memcpy(out, iv, 16);
+  }
+}
+
+static void cbc_dec_c (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                       const uint8_t *in, uint8_t *out, size_t n) {
+  uint8_t c[LAES_BLOCK], x[LAES_BLOCK];
+  int i;
+  for (; n > 0; n--, in += 16, out += 16) {
+    memcpy(c, in, 16);
+    aes_block_c(k->dk, k->rounds, TD, ISB, 1, c, x);
+    for (i = 0; i < 16; i++) out[i] = x[i] ^ iv[i];
+    memcpy(iv, c, 16);
+  }
+}
+
+static void ctr_c (const laes_Key *k, uint8_t ctr[LAES_BLOCK],
+                   const uint8_t *in, uint8_t *out, size_t n, int wide) {
+  uint8_t ks[LAES_BLOCK];
+  int i;
+  for (; n > 0; n--, in += 16, out += 16) {
+    aes_block_c(k->ek, k->rounds, TE, SB, 0, ctr, ks);
+    ctr_inc(ctr, wide);
+    for (i = 0; i < 16; i++) out[i] = in[i] ^ ks[i];
+  }
+}
+
+
+/*
+** GHASH works on blocks read as 128-bit big-endian numbers {low, high};
+** in that bit-reflected form a field product is a carry-less product
+** shifted left by one, then folded with x^128 = x^7 + x^2 + x + 1.
+*/
+static inline void gf_reduce (uint64_t y[2], uint64_t w0, uint64_t w1,
+                              uint64_t w2, uint64_t w3) {
+  uint64_t s;
+  w3 = (w3 << 1) | (w2 >> 63);
+  w2 = (w2 << 1) | (w1 >> 63);
+  w1 = (w1 << 1) | (w0 >> 63);
+  w0 <<= 1;
+  s = (w0 << 63) ^ (w0 << 62) ^ (w0 << 57);
+  y[1] = w3 ^ w1 ^ (w1 >> 1) ^ (w1 >> 2) ^ (w1 >> 7) ^ s ^ (s >> 1) ^ (s >> 2) ^ (s >> 7);
+  y[0] = w2 ^ w0 ^ ((w0 >> 1) | (w1 << 63)) ^ ((w0 >> 2) | (w1 << 62)) ^
+         ((w0 >> 7) | (w1 << 57));
+}
+
+/* low 64 bits of a carry-less product, without data-dependent branches */
+static uint64_t bmul64 (uint64_t x, uint64_t y) {
+  const uint64_t m0 = 0x1111111111111111ULL, m1 = 0x2222222222222222ULL;
+  const uint64_t m2 = 0x4444444444444444ULL, m3 = 0x8888888888888888ULL;
+  uint64_t x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+  uint64_t y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+  uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+  uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+  uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+  uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+  return (z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3);
+}
+
+static uint64_t rev64 (uint64_t x) {
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+  return __builtin_bswap64(x);
+}
+
+static void clmul64_c (uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
+  *lo = bmul64(a, b);
+  *hi = rev64(bmul64(rev64(a), rev64(b))) >> 1;
+}
+
+static void gf_mul_c (uint64_t r[2], const uint64_t a[2], const uint64_t b[2]) {
+  uint64_t lh, ll, hh, hl, m1h, m1l, m2h, m2l;
+  clmul64_c(a[0], b[0], &lh, &ll);
+  clmul64_c(a[1], b[1], &hh, &hl);
+  clmul64_c(a[0], b[1], &m1h, &m1l);
+  clmul64_c(a[1], b[0], &m2h, &m2l);
+  gf_reduce(r, ll, lh ^ m1l ^ m2l, hl ^ m1h ^ m2h, hh);
+}
+
+static void ghash_c (uint64_t y[2], const uint64_t h[4][2], const uint8_t *p, size_t n) {
+  for (; n > 0; n--, p += 16) {
+    uint64_t x[2];
+    x[0] = y[0] ^ load64be(p + 8);
+    x[1] = y[1] ^ load64be(p);
+    gf_mul_c(y, x, h[0]);
+  }
+}
+
+/* }====================================================== */
+
+
+#if defined(LAES_X86)
+/*
+** {======================================================
+** x86: AES-NI and PCLMULQDQ
+** =======================================================
+*/
+
+#define NI_TARGET	__attribute__((target("aes,sse4.1")))
+#define CLMUL_TARGET	__attribute__((target("pclmul,sse4.1")))
+
+#define NI_LOAD(i)	b##i = _mm_loadu_si128((const __m128i *)(in + 16 * (i)));
+#define NI_STORE(i)	_mm_storeu_si128((__m128i *)(out + 16 * (i)), b##i);
+#define NI_KEEP(i)	c##i = b##i;
+#define NI_XOR(i)	b##i = _mm_xor_si128(b##i, k_);
+#define NI_XORIN(i)	b##i = _mm_xor_si128(b##i, \
+                          _mm_loadu_si128((const __m128i *)(in + 16 * (i))));
+#define NI_ENC(i)	b##i = _mm_aesenc_si128(b##i, k_);
+#define NI_ENCLAST(i)	b##i = _mm_aesenclast_si128(b##i, k_);
+#define NI_DEC(i)	b##i = _mm_aesdec_si128(b##i, k_);
+#define NI_DECLAST(i)	b##i = _mm_aesdeclast_si128(b##i, k_);
+
+#define NI_ROUNDS8(rk, nr, OP, OPLAST) { \
+  int r_; __m128i k_ = rk[0]; FOR8(NI_XOR) \
+  for (r_ = 1; r_ < nr; r_++) { k_ = rk[r_]; FOR8(OP) } \
+  k_ = rk[nr]; FOR8(OPLAST) }
+
+NI_TARGET
+static inline void ni_loadkeys (__m128i *rk, const uint8_t *k, int nr) {
+  int i;
+  for (i = 0; i <= nr; i++)
+    rk[i] = _mm_loadu_si128((const __m128i *)(k + 16 * i));
+}
+
+NI_TARGET
+static inline __m128i ni_enc1 (__m128i s, const __m128i *rk, int nr) {
+  int r;
+  s = _mm_xor_si128(s, rk[0]);
+  for (r = 1; r < nr; r++)
+    s = _mm_aesenc_si128(s, rk[r]);
+  return _mm_aesenclast_si128(s, rk[nr]);
+}
+
+NI_TARGET
+static inline __m128i ni_dec1 (__m128i s, const __m128i *rk, int nr) {
+  int r;
+  s = _mm_xor_si128(s, rk[0]);
+  for (r = 1; r < nr; r++)
+    s = _mm_aesdec_si128(s, rk[r]);
+  return _mm_aesdeclast_si128(s, rk[nr]);
+}
+
+NI_TARGET
+static void ecb_enc_ni (const laes_Key *k, const uint8_t *in, uint8_t *out, size_t n) {
+  __m128i rk[LAES_MAXROUNDS + 1], b0, b1, b2, b3, b4, b5, b6, b7;
+  int nr = k->rounds;
+  ni_loadkeys(rk, k->ek, nr);
+  for (; n >= 8; n -= 8, in += 128, out += 128) {
+    FOR8(NI_LOAD)
+    NI_ROUNDS8(rk, nr, NI_ENC, NI_ENCLAST)
+    FOR8(NI_STORE)
+  }
+  for (; n > 0; n--, in += 16, out += 16)
+    _mm_storeu_si128((__m128i *)out, ni_enc1(_mm_loadu_si128((const __m128i *)in), rk, nr));
+}
+
+NI_TARGET
+static void ecb_dec_ni (const laes_Key *k, const uint8_t *in, uint8_t *out, size_t n) {
+  __m128i rk[LAES_MAXROUNDS + 1], b0, b1, b2, b3, b4, b5, b6, b7;
+  int nr = k->rounds;
+  ni_loadkeys(rk, k->dk, nr);
+  for (; n >= 8; n -= 8, in += 128, out += 128) {
+    FOR8(NI_LOAD)
+    NI_ROUNDS8(rk, nr, NI_DEC, NI_DECLAST)
+    FOR8(NI_STORE)
+  }
+  for (; n > 0; n--, in += 16, out += 16)
+    _mm_storeu_si128((__m128i *)out, ni_dec1(_mm_loadu_si128((const __m128i *)in), rk, nr));
+}
+
+NI_TARGET
+static void cbc_enc_ni (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                        const uint8_t *in, uint8_t *out, size_t n) {
+  __m128i rk[LAES_MAXROUNDS + 1];
+  __m128i s = _mm_loadu_si128((const __m128i *)iv);
+  int nr = k->rounds;
+  ni_loadkeys(rk, k->ek, nr);
+  for (; n > 0; n--, in += 16, out += 16) {
+    s = ni_enc1(_mm_xor_si128(s, _mm_loadu_si128((const __m128i *)in)), rk, nr);
+    _mm_storeu_si128((__m128i *)out, s);
+  }
+  _mm_storeu_si128((__m128i *)iv, s);
+}
+
+NI_TARGET
+static void cbc_dec_ni (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                        const uint8_t *in, uint8_t *out, size_t n) {
+  __m128i rk[LAES_MAXROUNDS + 1], b0, b1, b2, b3, b4, b5, b6, b7;
+  __m128i c0, c1, c2, c3, c4, c5, c6, c7;
+  __m128i prev = _mm_loadu_si128((const __m128i *)iv);
+  int nr = k->rounds;
+  ni_loadkeys(rk, k->dk, nr);
+  for (; n >= 8; n -= 8, in += 128, out += 128) {
+    FOR8(NI_LOAD)
+    FOR8(NI_KEEP)
+    NI_ROUNDS8(rk, nr, NI_DEC, NI_DECLAST)
+    b0 = _mm_xor_si128(b0, prev); b1 = _mm_xor_si128(b1, c0);
+    b2 = _mm_xor_si128(b2, c1); b3 = _mm_xor_si128(b3, c2);
+    b4 = _mm_xor_si128(b4, c3); b5 = _mm_xor_si128(b5, c4);
+    b6 = _mm_xor_si128(b6, c5); b7 = _mm_xor_si128(b7, c6);
+    prev = c7;
+    FOR8(NI_STORE)
+  }
+  for (; n > 0; n--, in += 16, out += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i *)in);
+    _mm_storeu_si128((__m128i *)out, _mm_xor_si128(ni_dec1(c, rk, nr), prev));
+    prev = c;
+  }
+  _mm_storeu_si128((__m128i *)iv, prev);
+}
+
+#define NI_CTR(i)	b##i = _mm_insert_epi32(base, (int)__builtin_bswap32(c + (i)), 3);
+#define NI_CTRSTEP(i)	b##i = _mm_loadu_si128((const __m128i *)ctr); ctr_inc(ctr, wide);
+
+NI_TARGET
+static void ctr_ni (const laes_Key *k, uint8_t ctr[LAES_BLOCK],
+                    const uint8_t *in, uint8_t *out, size_t n, int wide) {
+  __m128i rk[LAES_MAXROUNDS + 1], b0, b1, b2, b3, b4, b5, b6, b7;
+  __m128i base = _mm_loadu_si128((const __m128i *)ctr);
+  uint32_t c = load32be(ctr + 12);
+  int nr = k->rounds;
+  ni_loadkeys(rk, k->ek, nr);
+  for (; n >= 8; n -= 8, in += 128, out += 128) {
+    if (c <= 0xfffffff7u) {  /* low word does not wrap inside the batch */
+      FOR8(NI_CTR)
+      c += 8;
+    }
+    else {
+      store32be(ctr + 12, c);
+      FOR8(NI_CTRSTEP)
+      base = _mm_loadu_si128((const __m128i *)ctr);
+      c = load32be(ctr + 12);
+    }
+    NI_ROUNDS8(rk, nr, NI_ENC, NI_ENCLAST)
+    FOR8(NI_XORIN)
+    FOR8(NI_STORE)
+  }
+  store32be(ctr + 12, c);
+  for (; n > 0; n--, in += 16, out += 16) {
+    __m128i s = ni_enc1(_mm_loadu_si128((const __m128i *)ctr), rk, nr);
+    ctr_inc(ctr, wide);
+    _mm_storeu_si128((__m128i *)out, _mm_xor_si128(s, _mm_loadu_si128((const __m128i *)in)));
+  }
+}
+
+
+/* accumulates the unreduced product x*h into lo/mid/hi */
+#define CLMUL_ACC(x, hk) \
+  lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(x, hk, 0x00)); \
+  hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(x, hk, 0x11)); \
+  mid = _mm_xor_si128(mid, _mm_xor_si128(_mm_clmulepi64_si128(x, hk, 0x01), \
+                                         _mm_clmulepi64_si128(x, hk, 0x10)));
+
+CLMUL_TARGET
+static inline __m128i clmul_load (const uint8_t *p) {
+  const __m128i rev = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p), rev);
+}
+
+CLMUL_TARGET
+static void ghash_clmul (uint64_t y[2], const uint64_t h[4][2], const uint8_t *p, size_t n) {
+  const __m128i h1 = _mm_loadu_si128((const __m128i *)h[0]);
+  const __m128i h2 = _mm_loadu_si128((const __m128i *)h[1]);
+  const __m128i h3 = _mm_loadu_si128((const __m128i *)h[2]);
+  const __m128i h4 = _mm_loadu_si128((const __m128i *)h[3]);
+  __m128i acc = _mm_loadu_si128((const __m128i *)y);
+  for (; n > 0; ) {
+    __m128i lo = _mm_setzero_si128(), mid = lo, hi = lo, w;
+    if (n >= 4) {  /* (y^x0)h^4 + x1 h^3 + x2 h^2 + x3 h, one reduction */
+      w = _mm_xor_si128(acc, clmul_load(p));
+      CLMUL_ACC(w, h4)
+      w = clmul_load(p + 16);
+      CLMUL_ACC(w, h3)
+      w = clmul_load(p + 32);
+      CLMUL_ACC(w, h2)
+      w = clmul_load(p + 48);
+      CLMUL_ACC(w, h1)
+      p += 64; n -= 4;
+    }
+    else {
+      w = _mm_xor_si128(acc, clmul_load(p));
+      CLMUL_ACC(w, h1)
+      p += 16; n -= 1;
+    }
+    {
+      uint64_t r[2];
+      uint64_t m0 = (uint64_t)_mm_cvtsi128_si64(mid), m1 = (uint64_t)_mm_extract_epi64(mid, 1);
+      gf_reduce(r, (uint64_t)_mm_cvtsi128_si64(lo),
+                   (uint64_t)_mm_extract_epi64(lo, 1) ^ m0,
+                   (uint64_t)_mm_cvtsi128_si64(hi) ^ m1,
+                   (uint64_t)_mm_extract_epi64(hi, 1));
+      acc = _mm_loadu_si128((const __m128i *)r);
+    }
+  }
+  _mm_storeu_si128((__m128i *)y, acc);
+}
+
+/* }====================================================== */
+
+#elif defined(LAES_ARM)
+/*
+** {======================================================
+** ARMv8: AESE/AESD and PMULL
+** =======================================================
+*/
+
+#if defined(__clang__)
+#define CE_TARGET	__attribute__((target("aes")))
+#else
+#define CE_TARGET	__attribute__((target("+crypto")))
+#endif
+
+#ifndef HWCAP_AES
+#define HWCAP_AES	(1 << 3)
+#endif
+#ifndef HWCAP_PMULL
+#define HWCAP_PMULL	(1 << 4)
+#endif
+
+#define CE_LOAD(i)	b##i = vld1q_u8(in + 16 * (i));
+#define CE_STORE(i)	vst1q_u8(out + 16 * (i), b##i);
+#define CE_KEEP(i)	c##i = b##i;
+#define CE_XOR(i)	b##i = veorq_u8(b##i, k_);
+#define CE_XORIN(i)	b##i = veorq_u8(b##i, vld1q_u8(in + 16 * (i)));
+#define CE_ENC(i)	b##i = vaesmcq_u8(vaeseq_u8(b##i, k_));
+#define CE_ENCLAST(i)	b##i = vaeseq_u8(b##i, k_);
+#define CE_DEC(i)	b##i = vaesimcq_u8(vaesdq_u8(b##i, k_));
+#define CE_DECLAST(i)	b##i = vaesdq_u8(b##i, k_);
+
+/* AESE/AESD add the round key first, so the last key is a plain xor */
+#define CE_ROUNDS8(rk, nr, OP, OPLAST) { \
+  int r_; uint8x16_t k_; \
+  for (r_ = 0; r_ < nr - 1; r_++) { k_ = rk[r_]; FOR8(OP) } \
+  k_ = rk[nr - 1]; FOR8(OPLAST) \
+  k_ = rk[nr]; FOR8(CE_XOR) }
+
+CE_TARGET
+static inline void ce_loadkeys (uint8x16_t *rk, const uint8_t *k, int nr) {
+  int i;
+  for (i = 0; i <= nr; i++)
+    rk[i] = vld1q_u8(k + 16 * i);
+}
+
+CE_TARGET
+static inline uint8x16_t ce_enc1 (uint8x16_t s, const uint8x16_t *rk, int nr) {
+  int r;
+  for (r = 0; r < nr - 1; r++)
+    s = vaesmcq_u8(vaeseq_u8(s, rk[r]));
+  return veorq_u8(vaeseq_u8(s, rk[nr - 1]), rk[nr]);
+}
+
+CE_TARGET
+static inline uint8x16_t ce_dec1 (uint8x16_t s, const uint8x16_t *rk, int nr) {
+  int r;
+  for (r = 0; r < nr - 1; r++)
+    s = vaesimcq_u8(vaesdq_u8(s, rk[r]));
+  return veorq_u8(vaesdq_u8(s, rk[nr - 1]), rk[nr]);
+}
+
+CE_TARGET
+static void ecb_enc_ce (const laes_Key *k, const uint8_t *in, uint8_t *out, size_t n) {
+  uint8x16_t rk[LAES_MAXROUNDS + 1], b0, b1, b2, b3, b4, b5, b6, b7;
+  int nr = k->rounds;
+  ce_loadkeys(rk, k->ek, nr);
+  for (; n >= 8; n -= 8, in += 128, out += 128) {
+    FOR8(CE_LOAD)
+    CE_ROUNDS8(rk, nr, CE_ENC, CE_ENCLAST)
+    FOR8(CE_STORE)
+  }
+  for (; n > 0; n--, in += 16, out += 16)
+    vst1q_u8(out, ce_enc1(vld1q_u8(in), rk, nr));
+}
+
+CE_TARGET
+static void ecb_dec_ce (const laes_Key *k, const uint8_t *in, uint8_t *out, size_t n) {
+  uint8x16_t rk[LAES_MAXROUNDS + 1], b0, b1, b2, b3, b4, b5, b6, b7;
+  int nr = k->rounds;
+  ce_loadkeys(rk, k->dk, nr);
+  for (; n >= 8; n -= 8, in += 128, out += 128) {
+    FOR8(CE_LOAD)
+    CE_ROUNDS8(rk, nr, CE_DEC, CE_DECLAST)
+    FOR8(CE_STORE)
+  }
+  for (; n > 0; n--, in += 16, out += 16)
+    vst1q_u8(out, ce_dec1(vld1q_u8(in), rk, nr));
+}
+
+CE_TARGET
+static void cbc_enc_ce (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                        const uint8_t *in, uint8_t *out, size_t n) {
+  uint8x16_t rk[LAES_MAXROUNDS + 1];
+  uint8x16_t s = vld1q_u8(iv);
+  int nr = k->rounds;
+  ce_loadkeys(rk, k->ek, nr);
+  for (; n > 0; n--, in += 16, out += 16) {
+    s = ce_enc1(veorq_u8(s, vld1q_u8(in)), rk, nr);
+    vst1q_u8(out, s);
+  }
+  vst1q_u8(iv, s);
+}
+
+CE_TARGET
+static void cbc_dec_ce (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                        const uint8_t *in, uint8_t *out, size_t n) {
+  uint8x16_t rk[LAES_MAXROUNDS + 1], b0, b1, b2, b3, b4, b5, b6, b7;
+  uint8x16_t c0, c1, c2, c3, c4, c5, c6, c7;
+  uint8x16_t prev = vld1q_u8(iv);
+  int nr = k->rounds;
+  ce_loadkeys(rk, k->dk, nr);
+  for (; n >= 8; n -= 8, in += 128, out += 128) {
+    FOR8(CE_LOAD)
+    FOR8(CE_KEEP)
+    CE_ROUNDS8(rk, nr, CE_DEC, CE_DECLAST)
+    b0 = veorq_u8(b0, prev); b1 = veorq_u8(b1, c0);
+    b2 = veorq_u8(b2, c1); b3 = veorq_u8(b3, c2);
+    b4 = veorq_u8(b4, c3); b5 = veorq_u8(b5, c4);
+    b6 = veorq_u8(b6, c5); b7 = veorq_u8(b7, c6);
+    prev = c7;
+    FOR8(CE_STORE)
+  }
+  for (; n > 0; n--, in += 16, out += 16) {
+    uint8x16_t c = vld1q_u8(in);
+    vst1q_u8(out, veorq_u8(ce_dec1(c, rk, nr), prev));
+    prev = c;
+  }
+  vst1q_u8(iv, prev);
+}
+
+#define CE_CTR(i)	b##i = vreinterpretq_u8_u32(vsetq_lane_u32( \
+                          __builtin_bswap32(c + (i)), base, 3));
+#define CE_CTRSTEP(i)	b##i = vld1q_u8(ctr); ctr_inc(ctr, wide);
+
+CE_TARGET
+static void ctr_ce (const laes_Key *k, uint8_t ctr[LAES_BLOCK],
+                    const uint8_t *in, uint8_t *out, size_t n, int wide) {
+  uint8x16_t rk[LAES_MAXROUNDS + 1], b0, b1, b2, b3, b4, b5, b6, b7;
+  uint32x4_t base = vreinterpretq_u32_u8(vld1q_u8(ctr));
+  uint32_t c = load32be(ctr + 12);
+  int nr = k->rounds;
+  ce_loadkeys(rk, k->ek, nr);
+  for (; n >= 8; n -= 8, in += 128, out += 128) {
+    if (c <= 0xfffffff7u) {  /* low word does not wrap inside the batch */
+      FOR8(CE_CTR)
+      c += 8;
+    }
+    else {
+      store32be(ctr + 12, c);
+      FOR8(CE_CTRSTEP)
+      base = vreinterpretq_u32_u8(vld1q_u8(ctr));
+      c = load32be(ctr + 12);
+    }
+    CE_ROUNDS8(rk, nr, CE_ENC, CE_ENCLAST)
+    FOR8(CE_XORIN)
+    FOR8(CE_STORE)
+  }
+  store32be(ctr + 12, c);
+  for (; n > 0; n--, in += 16, out += 16) {
+    uint8x16_t s = ce_enc1(vld1q_u8(ctr), rk, nr);
+    ctr_inc(ctr, wide);
+    vst1q_u8(out, veorq_u8(s, vld1q_u8(in)));
+  }
+}
+
+
+#define PMULL_ACC(x, hk) { \
+  poly64x2_t xp_ = vreinterpretq_p64_u64(x), hp_ = vreinterpretq_p64_u64(hk); \
+  lo = veorq_u64(lo, vreinterpretq_u64_p128(vmull_p64(vgetq_lane_p64(xp_, 0), \
+                                                      vgetq_lane_p64(hp_, 0)))); \
+  hi = veorq_u64(hi, vreinterpretq_u64_p128(vmull_high_p64(xp_, hp_))); \
+  mid = veorq_u64(mid, vreinterpretq_u64_p128(vmull_p64(vgetq_lane_p64(xp_, 0), \
+                                                        vgetq_lane_p64(hp_, 1)))); \
+  mid = veorq_u64(mid, vreinterpretq_u64_p128(vmull_p64(vgetq_lane_p64(xp_, 1), \
+                                                        vgetq_lane_p64(hp_, 0)))); }
+
+CE_TARGET
+static inline uint64x2_t pmull_load (const uint8_t *p) {
+  uint8x16_t v = vrev64q_u8(vld1q_u8(p));
+  return vreinterpretq_u64_u8(vextq_u8(v, v, 8));
+}
+
+CE_TARGET
+static void ghash_pmull (uint64_t y[2], const uint64_t h[4][2], const uint8_t *p, size_t n) {
+  const uint64x2_t h1 = vld1q_u64(h[0]), h2 = vld1q_u64(h[1]);
+  const uint64x2_t h3 = vld1q_u64(h[2]), h4 = vld1q_u64(h[3]);
+  uint64x2_t acc = vld1q_u64(y);
+  for (; n > 0; ) {
+    uint64x2_t lo = vdupq_n_u64(0), mid = lo, hi = lo, w;
+    if (n >= 4) {  /* (y^x0)h^4 + x1 h^3 + x2 h^2 + x3 h, one reduction */
+      w = veorq_u64(acc, pmull_load(p));
+      PMULL_ACC(w, h4)
+      w = pmull_load(p + 16);
+      PMULL_ACC(w, h3)
+      w = pmull_load(p + 32);
+      PMULL_ACC(w, h2)
+      w = pmull_load(p + 48);
+      PMULL_ACC(w, h1)
+      p += 64; n -= 4;
+    }
+    else {
+      w = veorq_u64(acc, pmull_load(p));
+      PMULL_ACC(w, h1)
+      p += 16; n -= 1;
+    }
+    {
+      uint64_t r[2];
+      gf_reduce(r, vgetq_lane_u64(lo, 0),
+                   vgetq_lane_u64(lo, 1) ^ vgetq_lane_u64(mid, 0),
+                   vgetq_lane_u64(hi, 0) ^ vgetq_lane_u64(mid, 1),
+                   vgetq_lane_u64(hi, 1));
+      acc = vld1q_u64(r);
+    }
+  }
+  vst1q_u64(y, acc);
+}
+
+/* }====================================================== */
+#endif
+
+
+/*
+** {======================================================
+** Runtime selection
+** =======================================================
+*/
+
+static struct {
+  laes_Blocks enc, dec;
+  laes_Chain cbcenc, cbcdec;
+  laes_Ctr ctr;
+  laes_Ghash ghash;
+  int features;
+} impl;
+
+static int impl_ready = 0;
+
+/* idempotent; see lhash_setup */
+static void laes_setup (void) {
+  int features = 0;
+  aes_maketables();
+  impl.enc = ecb_enc_c;
+  impl.dec = ecb_dec_c;
+  impl.cbcenc = cbc_enc_c;
+  impl.cbcdec = cbc_dec_c;
+  impl.ctr = ctr_c;
+  impl.ghash = ghash_c;
+#if defined(LAES_X86)
+  {
+    unsigned int a, b, c, d;
+    if (__get_cpuid(1, &a, &b, &c, &d) && ((c >> 19) & 1)) {  /* SSE4.1 */
+      if ((c >> 25) & 1) {  /* AES-NI */
+        impl.enc = ecb_enc_ni;
+        impl.dec = ecb_dec_ni;
+        impl.cbcenc = cbc_enc_ni;
+        impl.cbcdec = cbc_dec_ni;
+        impl.ctr = ctr_ni;
+        features |= LAES_HW_AES;
+      }
+      if ((c >> 1) & 1) {  /* PCLMULQDQ */
+        impl.ghash = ghash_clmul;
+        features |= LAES_HW_GHASH;
+      }
+    }
+  }
+#elif defined(LAES_ARM)
+  {
+    unsigned long hw = getauxval(AT_HWCAP);
+    if (hw & HWCAP_AES) {
+      impl.enc = ecb_enc_ce;
+      impl.dec = ecb_dec_ce;
+      impl.cbcenc = cbc_enc_ce;
+      impl.cbcdec = cbc_dec_ce;
+      impl.ctr = ctr_ce;
+      features |= LAES_HW_AES;
+    }
+    if (hw & HWCAP_PMULL) {
+      impl.ghash = ghash_pmull;
+      features |= LAES_HW_GHASH;
+    }
+  }
+#endif
+  impl.features = features;
+  __atomic_store_n(&impl_ready, 1, __ATOMIC_RELEASE);
+}
+
+#define laes_ensure() \
+  { if (!__atomic_load_n(&impl_ready, __ATOMIC_ACQUIRE)) laes_setup(); }
+
+
+LUALIB_API int laes_features (void) {
+  laes_ensure();
+  return impl.features;
+}
+
+/* }====================================================== */
+
+
+LUALIB_API int laes_setkey (laes_Key *k, const void *key, size_t len) {
+  uint32_t w[4 * (LAES_MAXROUNDS + 1)];
+  uint32_t rcon = 1;
+  int nk = (int)(len / 4), nr, i, total;
+  if (len != 16 && len != 24 && len != 32)
+    return -1;
+  laes_ensure();
+  nr = nk + 6;
+  total = 4 * (nr + 1);
+  for (i = 0; i < nk; i++)
+    w[i] = load32be((const uint8_t *)key + 4 * i);
+  for (i = nk; i < total; i++) {
+    uint32_t t = w[i - 1];
+    if (i % nk == 0) {
+      t = subword((t << 8) | (t >> 24)) ^ (rcon << 24);
+      rcon = xt((uint8_t)rcon);
+    }
+    else if (nk > 6 && i % nk == 4)
+      t = subword(t);
+    w[i] = w[i - nk] ^ t;
+  }
+  for (i = 0; i < total; i++)
+    store32be(k->ek + 4 * i, w[i]);
+  /* equivalent inverse cipher: reversed, InvMixColumns on the inner keys */
+  for (i = 0; i <= nr; i++) {
+    int j;
+    for (j = 0; j < 4; j++) {
+      uint32_t v = w[4 * (nr - i) + j];
+      if (i > 0 && i < nr)
+        v = invmixcol(v);
+      store32be(k->dk + 16 * i + 4 * j, v);
+    }
+  }
+  k->rounds = nr;
+  return 0;
+}
+
+
+LUALIB_API void laes_ecb_encrypt (const laes_Key *k, const void *in, void *out, size_t nblocks) {
+  laes_ensure();
+  impl.enc(k, (const uint8_t *)in, (uint8_t *)out, nblocks);
+}
+
+LUALIB_API void laes_ecb_decrypt (const laes_Key *k, const void *in, void *out, size_t nblocks) {
+  laes_ensure();
+  impl.dec(k, (const uint8_t *)in, (uint8_t *)out, nblocks);
+}
+
+LUALIB_API void laes_cbc_encrypt (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                                  const void *in, void *out, size_t nblocks) {
+  laes_ensure();
+  impl.cbcenc(k, iv, (const uint8_t *)in, (uint8_t *)out, nblocks);
+}
+
+LUALIB_API void laes_cbc_decrypt (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                                  const void *in, void *out, size_t nblocks) {
+  laes_ensure();
+  impl.cbcdec(k, iv, (const uint8_t *)in, (uint8_t *)out, nblocks);
+}
+
+
+/*
+** {======================================================
+** CTR
+** =======================================================
+*/
+
+LUALIB_API void laes_ctr_init (laes_CTR *c, const laes_Key *k, const uint8_t iv[LAES_BLOCK]) {
+  c->key = *k;
+  memcpy(c->ctr, iv, LAES_BLOCK);
+  c->used = 0;
+}
+
+LUALIB_API void laes_ctr_xcrypt (laes_CTR *c, const void *vin, void *vout, size_t n) {
+  const uint8_t *in = (const uint8_t *)vin;
+  uint8_t *out = (uint8_t *)vout;
+  laes_ensure();
+  if (c->used) {  /* finish the partial block */
+    for (; n > 0 && c->used < LAES_BLOCK; n--)
+      *out++ = *in++ ^ c->ks[c->used++];
+    if (c->used == LAES_BLOCK)
+      c->used = 0;
+  }
+  if (n >= LAES_BLOCK) {
+    impl.ctr(&c->key, c->ctr, in, out, n / LAES_BLOCK, 1);
+    in += n & ~(size_t)(LAES_BLOCK - 1);
+    out += n & ~(size_t)(LAES_BLOCK - 1);
+    n &= LAES_BLOCK - 1;
+  }
+  if (n > 0) {
+    memset(c->ks, 0, LAES_BLOCK);
+    impl.ctr(&c->key, c->ctr, c->ks, c->ks, 1, 1);
+    for (c->used = 0; c->used < n; c->used++)
+      out[c->used] = in[c->used] ^ c->ks[c->used];
+  }
+}
+
+/* }====================================================== */
+
+
+/*
+** {======================================================
+** GCM
+** =======================================================
+*/
+
+/* GCM bulk work is split so the GHASH pass reads data still in L1 */
+#define GCM_CHUNK	4096
+
+static void gcm_absorb (laes_GCM *g, const uint8_t *p, size_t n) {
+  if (g->nbuf) {
+    size_t take = LAES_BLOCK - g->nbuf;
+    if (take > n) take = n;
+    memcpy(g->buf + g->nbuf, p, take);
+    g->nbuf += (unsigned)take;
+    p += take; n -= take;
+    if (g->nbuf < LAES_BLOCK)
+      return;
+    impl.ghash(g->y, (const uint64_t (*)[2])g->h, g->buf, 1);
+    g->nbuf = 0;
+  }
+  if (n >= LAES_BLOCK) {
+    impl.ghash(g->y, (const uint64_t (*)[2])g->h, p, n / LAES_BLOCK);
+    p += n & ~(size_t)(LAES_BLOCK - 1);
+    n &= LAES_BLOCK - 1;
+  }
+  if (n > 0) {
+    memcpy(g->buf, p, n);
+    g->nbuf = (unsigned)n;
+  }
+}
+
+static void gcm_pad (laes_GCM *g) {
+  if (g->nbuf) {
+    memset(g->buf + g->nbuf, 0, LAES_BLOCK - g->nbuf);
+    impl.ghash(g->y, (const uint64_t (*)[2])g->h, g->buf, 1);
+    g->nbuf = 0;
+  }
+}
+
+static void gcm_ytobytes (const uint64_t y[2], uint8_t b[LAES_BLOCK]) {
+  store64be(b, y[1]);
+  store64be(b + 8, y[0]);
+}
+
+LUALIB_API void laes_gcm_init (laes_GCM *g, const laes_Key *k, const void *iv, size_t ivlen) {
+  uint8_t hb[LAES_BLOCK];
+  int i;
+  laes_ensure();
+  g->key = *k;
+  memset(hb, 0, LAES_BLOCK);
+  impl.enc(k, hb, hb, 1);
+  g->h[0][0] = load64be(hb + 8);
+  g->h[0][1] = load64be(hb);
+  for (i = 1; i < 4; i++)
+    gf_mul_c(g->h[i], g->h[i - 1], g->h[0]);
+  g->y[0] = g->y[1] = 0;
+  g->nbuf = 0;
+  if (ivlen == 12) {
+    memcpy(g->j0, iv, 12);
+    store32be(g->j0 + 12, 1);
+  }
+  else {
+    uint8_t lenblk[LAES_BLOCK];
+    gcm_absorb(g, (const uint8_t *)iv, ivlen);
+    gcm_pad(g);
+    store64be(lenblk, 0);
+    store64be(lenblk + 8, (uint64_t)ivlen * 8);
+    impl.ghash(g->y, (const uint64_t (*)[2])g->h, lenblk, 1);
+    gcm_ytobytes(g->y, g->j0);
+    g->y[0] = g->y[1] = 0;
+  }
+  memcpy(g->ctr, g->j0, LAES_BLOCK);
+  ctr_inc(g->ctr, 0);
+  g->alen = g->clen = 0;
+  g->indata = 0;
+}
+
+LUALIB_API void laes_gcm_aad (laes_GCM *g, const void *p, size_t n) {
+  laes_ensure();
+  if (g->indata)  /* AAD after data is a caller error; ignore it */
+    return;
+  g->alen += n;
+  gcm_absorb(g, (const uint8_t *)p, n);
+}
+
+static void gcm_crypt (laes_GCM *g, const uint8_t *in, uint8_t *out, size_t n, int enc) {
+  laes_ensure();
+  if (!g->indata) {
+    gcm_pad(g);
+    g->indata = 1;
+  }
+  g->clen += n;
+  /* in the data phase 'nbuf' is also the keystream position in 'ks' */
+  if (g->nbuf) {
+    for (; n > 0 && g->nbuf < LAES_BLOCK; n--) {
+      uint8_t x = *in++, c = x ^ g->ks[g->nbuf];
+      g->buf[g->nbuf++] = enc ? c : x;
+      *out++ = c;
+    }
+    if (g->nbuf < LAES_BLOCK)
+      return;
+    impl.ghash(g->y, (const uint64_t (*)[2])g->h, g->buf, 1);
+    g->nbuf = 0;
+  }
+  while (n >= LAES_BLOCK) {
+    size_t chunk = n & ~(size_t)(LAES_BLOCK - 1);
+    if (chunk > GCM_CHUNK) chunk = GCM_CHUNK;
+    if (!enc)
+      impl.ghash(g->y, (const uint64_t (*)[2])g->h, in, chunk / LAES_BLOCK);
+    impl.ctr(&g->key, g->ctr, in, out, chunk / LAES_BLOCK, 0);
+    if (enc)
+      impl.ghash(g->y, (const uint64_t (*)[2])g->h, out, chunk / LAES_BLOCK);
+    in += chunk; out += chunk; n -= chunk;
+  }
+  if (n > 0) {
+    memset(g->ks, 0, LAES_BLOCK);
+    impl.ctr(&g->key, g->ctr, g->ks, g->ks, 1, 0);
+    for (; g->nbuf < n; g->nbuf++) {
+      uint8_t x = in[g->nbuf], c = x ^ g->ks[g->nbuf];
+      g->buf[g->nbuf] = enc ? c : x;
+      out[g->nbuf] = c;
+    }
+  }
+}
+
+LUALIB_API void laes_gcm_encrypt (laes_GCM *g, const void *in, void *out, size_t n) {
+  gcm_crypt(g, (const uint8_t *)in, (uint8_t *)out, n, 1);
+}
+
+LUALIB_API void laes_gcm_decrypt (laes_GCM *g, const void *in, void *out, size_t n) {
+  gcm_crypt(g, (const uint8_t *)in, (uint8_t *)out, n, 0);
+}
+
+LUALIB_API void laes_gcm_tag (laes_GCM *g, uint8_t tag[LAES_BLOCK]) {
+  uint8_t lenblk[LAES_BLOCK], s[LAES_BLOCK], yb[LAES_BLOCK];
+  int i;
+  laes_ensure();
+  gcm_pad(g);
+  store64be(lenblk, g->alen * 8);
+  store64be(lenblk + 8, g->clen * 8);
+  impl.ghash(g->y, (const uint64_t (*)[2])g->h, lenblk, 1);
+  impl.enc(&g->key, g->j0, s, 1);
+  gcm_ytobytes(g->y, yb);
+  for (i = 0; i < LAES_BLOCK; i++)
+    tag[i] = s[i] ^ yb[i];
+}
+
+/* }====================================================== */
@@ -0,0 +1,83 @@
+/*
+** laes.h
+** Core AES engine: ECB/CBC/CTR block modes and streaming AES-GCM
+** AES-NI/PCLMULQDQ on x86 and the ARMv8 AES/PMULL instructions are used
+** when present; otherwise a table-driven AES and a constant-time GHASH.
+*/
+
+#ifndef laes_h
+#define laes_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "luaconf.h"
+
+
+#define LAES_BLOCK	16
+#define LAES_MAXROUNDS	14
+
+
+/*
+** Round keys in FIPS-197 byte order. 'dk' holds the equivalent inverse
+** cipher schedule, shared by every backend.
+*/
+typedef struct laes_Key {
+  uint8_t ek[(LAES_MAXROUNDS + 1) * LAES_BLOCK];
+  uint8_t dk[(LAES_MAXROUNDS + 1) * LAES_BLOCK];
+  int rounds;
+} laes_Key;
+
+
+/* 'len' must be 16, 24 or 32; returns 0 on success */
+LUALIB_API int laes_setkey (laes_Key *k, const void *key, size_t len);
+
+/* whole blocks only; 'in' and 'out' may be the same buffer */
+LUALIB_API void laes_ecb_encrypt (const laes_Key *k, const void *in, void *out, size_t nblocks);
+LUALIB_API void laes_ecb_decrypt (const laes_Key *k, const void *in, void *out, size_t nblocks);
+LUALIB_API void laes_cbc_encrypt (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                                  const void *in, void *out, size_t nblocks);
+LUALIB_API void laes_cbc_decrypt (const laes_Key *k, uint8_t iv[LAES_BLOCK],
+                                  const void *in, void *out, size_t nblocks);
+
+
+/* CTR with a 128-bit big-endian counter; any length, resumable */
+typedef struct laes_CTR {
+  laes_Key key;
+  uint8_t ctr[LAES_BLOCK];
+  uint8_t ks[LAES_BLOCK];  /* keystream of the last partial block */
+  unsigned used;  /* bytes of 'ks' already consumed (0 = none left) */
+} laes_CTR;
+
+LUALIB_API void laes_ctr_init (laes_CTR *c, const laes_Key *k, const uint8_t iv[LAES_BLOCK]);
+LUALIB_API void laes_ctr_xcrypt (laes_CTR *c, const void *in, void *out, size_t n);
+
+
+/* GCM (NIST SP 800-38D); AAD first, then data, then the tag */
+typedef struct laes_GCM {
+  laes_Key key;
+  uint64_t h[4][2];  /* H^1..H^4 as {low, high} halves */
+  uint64_t y[2];  /* GHASH accumulator */
+  uint8_t j0[LAES_BLOCK];
+  uint8_t ctr[LAES_BLOCK];
+  uint8_t ks[LAES_BLOCK];  /* keystream of the last partial block */
+  uint8_t buf[LAES_BLOCK];  /* pending GHASH input */
+  uint64_t alen, clen;
+  unsigned nbuf;  /* bytes in 'buf' */
+  int indata;  /* AAD is closed */
+} laes_GCM;
+
+LUALIB_API void laes_gcm_init (laes_GCM *g, const laes_Key *k, const void *iv, size_t ivlen);
+LUALIB_API void laes_gcm_aad (laes_GCM *g, const void *p, size_t n);
+LUALIB_API void laes_gcm_encrypt (laes_GCM *g, const void *in, void *out, size_t n);
+LUALIB_API void laes_gcm_decrypt (laes_GCM *g, const void *in, void *out, size_t n);
+LUALIB_API void laes_gcm_tag (laes_GCM *g, uint8_t tag[LAES_BLOCK]);
+
+
+/* bits of laes_features() */
+#define LAES_HW_AES	1
+#define LAES_HW_GHASH	2
+
+LUALIB_API int laes_features (void);
+
+#endif
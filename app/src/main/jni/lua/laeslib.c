@@ -0,0 +1,361 @@
+/*
+** laeslib.c
+** Lua binding for the core AES engine in laes.c
+**
+**   aes.new(mode, key [, iv [, decrypt]]) -> c
+**     c:aad(s)          GCM only, before any data
+**     c:update(s)       -> output so far
+**     c:final([tag])    -> last output; GCM: the tag when encrypting,
+**                          true (or fail, msg) when decrypting
+**   aes.encrypt(mode, key, iv, data [, aad])       -> ciphertext [, tag]
+**   aes.decrypt(mode, key, iv, data [, tag [, aad]]) -> plaintext
+**   aes.features()
+**
+** Modes are "ecb", "cbc" (both with PKCS#7 padding), "ctr" and "gcm".
+** Keys are 16, 24 or 32 bytes; CBC/CTR take a 16-byte IV, GCM any
+** non-empty nonce (12 bytes is the fast path); ECB ignores 'iv'.
+** Padding and tag failures return fail plus a message; misuse raises
+** an error.
+*/
+
+#define laeslib_c
+#define LUA_LIB
+
+#include "lprefix.h"
+
+
+#include <string.h>
+
+#include "lua.h"
+
+#include "lauxlib.h"
+#include "lualib.h"
+
+#include "laes.h"
+
+
+#define AES_TYPE	"aes.Cipher"
+
+
+enum { M_ECB, M_CBC, M_CTR, M_GCM };
+
+static const char *const modenames[] = {"ecb", "cbc", "ctr", "gcm", NULL};
+
+typedef struct Cipher {
+  int mode;
+  int decrypt;
+  int done;  /* 'final' was called */
+  unsigned nbuf;  /* ECB/CBC: bytes pending in 'buf' */
+  uint8_t iv[LAES_BLOCK];  /* CBC chaining value */
+  uint8_t buf[LAES_BLOCK];
+  union {
+    laes_Key key;
+    laes_CTR ctr;
+    laes_GCM gcm;
+  } u;
+} Cipher;
+
+
+static void cipher_init (lua_State *L, Cipher *c, int mode, int arg, int decrypt) {
+  size_t klen, ivlen = 0;
+  const char *key = luaL_checklstring(L, arg, &klen);
+  const char *iv = (mode == M_ECB) ? NULL : luaL_checklstring(L, arg + 1, &ivlen);
+  laes_Key k;
+  luaL_argcheck(L, laes_setkey(&k, key, klen) == 0, arg,
+                "key must be 16, 24 or 32 bytes");
+  if (mode == M_GCM)
+    luaL_argcheck(L, ivlen > 0, arg + 1, "nonce must not be empty");
+  else if (mode != M_ECB)
+    luaL_argcheck(L, ivlen == LAES_BLOCK, arg + 1, "IV must be 16 bytes");
+  c->mode = mode;
+  c->decrypt = decrypt;
+  c->done = 0;
+  c->nbuf = 0;
+  switch (mode) {
+    case M_CTR: laes_ctr_init(&c->u.ctr, &k, (const uint8_t *)iv); break;
+    case M_GCM: laes_gcm_init(&c->u.gcm, &k, iv, ivlen); break;
+    default:
+      c->u.key = k;
+      if (mode == M_CBC) memcpy(c->iv, iv, LAES_BLOCK);
+      break;
+  }
+}
+
+
+static void blocks (Cipher *c, const uint8_t *in, uint8_t *out, size_t n) {
+  if (c->mode == M_ECB) {
+    if (c->decrypt) laes_ecb_decrypt(&c->u.key, in, out, n);
+    else laes_ecb_encrypt(&c->u.key, in, out, n);
+  }
+  else {
+    if (c->decrypt) laes_cbc_decrypt(&c->u.key, c->iv, in, out, n);
+    else laes_cbc_encrypt(&c->u.key, c->iv, in, out, n);
+  }
+}
+
+
+/*
+** Writes at most n + LAES_BLOCK bytes to 'out' and returns the count.
+** Padded modes hold back a whole block when decrypting, so 'final' can
+** strip the padding.
+*/
+static size_t cipher_update (Cipher *c, const uint8_t *in, size_t n, uint8_t *out) {
+  size_t total, nb, outn;
+  switch (c->mode) {
+    case M_CTR:
+      laes_ctr_xcrypt(&c->u.ctr, in, out, n);
+      return n;
+    case M_GCM:
+      if (c->decrypt) laes_gcm_decrypt(&c->u.gcm, in, out, n);
+      else laes_gcm_encrypt(&c->u.gcm, in, out, n);
+      return n;
+  }
+  total = c->nbuf + n;
+  nb = total / LAES_BLOCK;
+  if (c->decrypt && nb > 0 && total % LAES_BLOCK == 0)
+    nb--;
+  outn = nb * LAES_BLOCK;
+  if (nb > 0 && c->nbuf > 0) {
+    size_t take = LAES_BLOCK - c->nbuf;
+    memcpy(c->buf + c->nbuf, in, take);
+    in += take; n -= take;
+    blocks(c, c->buf, out, 1);
+    out += LAES_BLOCK; nb--;
+    c->nbuf = 0;
+  }
+  if (nb > 0) {
+    blocks(c, in, out, nb);
+    in += nb * LAES_BLOCK; n -= nb * LAES_BLOCK;
+  }
+  memcpy(c->buf + c->nbuf, in, n);
+  c->nbuf += (unsigned)n;
+  return outn;
+}
+
+
+/* pushes the output of 'cipher_update' as one string */
+static void pushupdate (lua_State *L, Cipher *c, const char *s, size_t n) {
+  luaL_Buffer b;
+  uint8_t *out = (uint8_t *)luaL_buffinitsize(L, &b, n + LAES_BLOCK);
+  luaL_pushresultsize(&b, cipher_update(c, (const uint8_t *)s, n, out));
+}
+
+
+static int tags_equal (const uint8_t *a, const uint8_t *b, size_t n) {
+  unsigned d = 0;
+  size_t i;
+  for (i = 0; i < n; i++)
+    d |= a[i] ^ b[i];
+  return d == 0;
+}
+
+
+/*
+** Pushes the final output: remaining bytes for ECB/CBC/CTR, the tag for
+** GCM encryption, true for a verified GCM decryption. Returns the number
+** of results; on a bad padding or tag that is fail plus a message.
+*/
+static int cipher_final (lua_State *L, Cipher *c, int tagarg) {
+  c->done = 1;
+  if (c->mode == M_GCM) {
+    uint8_t tag[LAES_BLOCK];
+    laes_gcm_tag(&c->u.gcm, tag);
+    if (!c->decrypt) {
+      lua_pushlstring(L, (const char *)tag, LAES_BLOCK);
+      return 1;
+    }
+    else {
+      size_t tlen;
+      const char *expect = luaL_checklstring(L, tagarg, &tlen);
+      luaL_argcheck(L, tlen >= 4 && tlen <= LAES_BLOCK, tagarg, "invalid tag length");
+      if (!tags_equal(tag, (const uint8_t *)expect, tlen)) {
+        luaL_pushfail(L);
+        lua_pushliteral(L, "authentication failed");
+        return 2;
+      }
+      lua_pushboolean(L, 1);
+      return 1;
+    }
+  }
+  else if (c->mode == M_CTR) {
+    lua_pushliteral(L, "");
+    return 1;
+  }
+  else if (!c->decrypt) {
+    uint8_t out[LAES_BLOCK];
+    memset(c->buf + c->nbuf, (int)(LAES_BLOCK - c->nbuf), LAES_BLOCK - c->nbuf);
+    blocks(c, c->buf, out, 1);
+    lua_pushlstring(L, (const char *)out, LAES_BLOCK);
+    return 1;
+  }
+  else {
+    uint8_t out[LAES_BLOCK];
+    unsigned pad, i, bad;
+    if (c->nbuf != LAES_BLOCK) {
+      luaL_pushfail(L);
+      lua_pushliteral(L, "input is not a multiple of the block size");
+      return 2;
+    }
+    blocks(c, c->buf, out, 1);
+    pad = out[LAES_BLOCK - 1];
+    bad = (pad == 0 || pad > LAES_BLOCK);
+    for (i = 0; !bad && i < pad; i++)
+      bad |= (out[LAES_BLOCK - 1 - i] != pad);
+    if (bad) {
+      luaL_pushfail(L);
+      lua_pushliteral(L, "bad padding");
+      return 2;
+    }
+    lua_pushlstring(L, (const char *)out, LAES_BLOCK - pad);
+    return 1;
+  }
+}
+
+
+static int aes_new (lua_State *L) {
+  int mode = luaL_checkoption(L, 1, NULL, modenames);
+  int decrypt = lua_toboolean(L, 4);
+  Cipher *c = (Cipher *)lua_newuserdatauv(L, sizeof(Cipher), 0);
+  cipher_init(L, c, mode, 2, decrypt);
+  luaL_setmetatable(L, AES_TYPE);
+  return 1;
+}
+
+
+/* one-shot helper; results of 'update' and 'final' are concatenated */
+static int oneshot (lua_State *L, int decrypt) {
+  int mode = luaL_checkoption(L, 1, NULL, modenames);
+  Cipher c;
+  size_t n;
+  const char *data = luaL_checklstring(L, 4, &n);
+  int aadarg = decrypt ? 6 : 5, nres;
+  cipher_init(L, &c, mode, 2, decrypt);
+  if (mode == M_GCM && !lua_isnoneornil(L, aadarg)) {
+    size_t alen;
+    const char *aad = luaL_checklstring(L, aadarg, &alen);
+    laes_gcm_aad(&c.u.gcm, aad, alen);
+  }
+  pushupdate(L, &c, data, n);
+  nres = cipher_final(L, &c, 5);
+  if (nres == 2)  /* fail, msg */
+    return 2;
+  if (mode == M_GCM) {
+    if (decrypt) {
+      lua_pop(L, 1);  /* true */
+      return 1;
+    }
+    return 2;  /* ciphertext, tag */
+  }
+  lua_concat(L, 2);
+  return 1;
+}
+
+static int aes_encrypt (lua_State *L) { return oneshot(L, 0); }
+static int aes_decrypt (lua_State *L) { return oneshot(L, 1); }
+
+
+static int aes_features (lua_State *L) {
+  int f = laes_features();
+  lua_createtable(L, 0, 2);
+  lua_pushboolean(L, f & LAES_HW_AES);
+  lua_setfield(L, -2, "aes");
+  lua_pushboolean(L, f & LAES_HW_GHASH);
+  lua_setfield(L, -2, "ghash");
+  return 1;
+}
+
+
+/*
+** {======================================================
+** Cipher objects
+** =======================================================
+*/
+
+static Cipher *tocipher (lua_State *L) {
+  Cipher *c = (Cipher *)luaL_checkudata(L, 1, AES_TYPE);
+  if (c->done)
+    luaL_error(L, "attempt to use a finalized cipher");
+  return c;
+}
+
+
+static int c_aad (lua_State *L) {
+  Cipher *c = tocipher(L);
+  size_t n;
+  const char *s = luaL_checklstring(L, 2, &n);
+  if (c->mode != M_GCM)
+    return luaL_error(L, "AAD is only supported in GCM mode");
+  if (c->u.gcm.indata)
+    return luaL_error(L, "AAD must precede the data");
+  laes_gcm_aad(&c->u.gcm, s, n);
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+static int c_update (lua_State *L) {
+  Cipher *c = tocipher(L);
+  size_t n;
+  const char *s = luaL_checklstring(L, 2, &n);
+  pushupdate(L, c, s, n);
+  return 1;
+}
+
+
+static int c_final (lua_State *L) {
+  Cipher *c = tocipher(L);
+  return cipher_final(L, c, 2);
+}
+
+
+static int c_gc (lua_State *L) {
+  Cipher *c = (Cipher *)luaL_checkudata(L, 1, AES_TYPE);
+  memset(&c->u, 0, sizeof(c->u));  /* do not leave round keys behind */
+  c->done = 1;
+  return 0;
+}
+
+
+static int c_tostring (lua_State *L) {
+  Cipher *c = (Cipher *)luaL_checkudata(L, 1, AES_TYPE);
+  lua_pushfstring(L, "aes.%s: %p", modenames[c->mode], (void *)c);
+  return 1;
+}
+
+
+static const luaL_Reg cipher_methods[] = {
+  {"aad", c_aad},
+  {"update", c_update},
+  {"final", c_final},
+  {NULL, NULL}
+};
+
+static const luaL_Reg cipher_meta[] = {
+  {"__index", NULL},  /* placeholder */
+  {"__gc", c_gc},
+  {"__close", c_gc},
+  {"__tostring", c_tostring},
+  {NULL, NULL}
+};
+
+/* }====================================================== */
+
+
+static const luaL_Reg aeslib[] = {
+  {"new", aes_new},
+  {"encrypt", aes_encrypt},
+  {"decrypt", aes_decrypt},
+  {"features", aes_features},
+  {NULL, NULL}
+};
+
+
+LUAMOD_API int luaopen_aes (lua_State *L) {
+  luaL_newmetatable(L, AES_TYPE);
+  luaL_setfuncs(L, cipher_meta, 0);
+  luaL_newlib(L, cipher_methods);
+  lua_setfield(L, -2, "__index");
+  lua_pop(L, 1);
+  luaL_newlib(L, aeslib);
+  return 1;
+}
@@ -1060,6 +1060,139 @@ LUA_API void lua_table_iextend (lua_State *L, int idx, int n) {
 }
 
 
+/*
+** 批量数组API
+** lua_createarray* 创建一个数组部分恰好为n的新表并直接填充，
+** lua_toarray* 把表的1..n元素直接读入C缓冲区。两者都绕过逐元素的
+** rawseti/rawgeti，整张表只需一次GC屏障。
+*/
+static Table *newarray (lua_State *L, size_t n) {
+  Table *t;
+  api_check(L, n <= INT_MAX, "array too large");
+  t = luaH_new(L);
+  sethvalue2s(L, L->top.p, t);
+  api_incr_top(L);
+  if (n > 0)
+    luaH_resize(L, t, cast_uint(n), 0);
+  return t;
+}
+
+
+LUA_API void lua_createarrayi (lua_State *L, const lua_Integer *v, size_t n) {
+  Table *t;
+  size_t i;
+  lua_lock(L);
+  t = newarray(L, n);
+  for (i = 0; i < n; i++)
+    setivalue(&t->array[i], v[i]);
+  luaC_checkGC(L);
+  lua_unlock(L);
+}
+
+
+LUA_API void lua_createarrayn (lua_State *L, const lua_Number *v, size_t n) {
+  Table *t;
+  size_t i;
+  lua_lock(L);
+  t = newarray(L, n);
+  for (i = 0; i < n; i++)
+    setfltvalue(&t->array[i], v[i]);
+  luaC_checkGC(L);
+  lua_unlock(L);
+}
+
+
+/*
+** 'len' may be NULL, in which case the strings are zero-terminated.
+** The table is anchored on the stack while the strings are created, so
+** an emergency collection cannot free it; one barrier covers all slots.
+*/
+LUA_API void lua_createarrays (lua_State *L, const char *const *s,
+                               const size_t *len, size_t n) {
+  Table *t;
+  size_t i;
+  lua_lock(L);
+  t = newarray(L, n);
+  for (i = 0; i < n; i++) {
+    TString *ts = luaS_newlstr(L, s[i], len ? len[i] : strlen(s[i]));
+    setsvalue(L, &t->array[i], ts);
+  }
+  if (n > 0)
+    luaC_barrierback(L, obj2gco(t), &t->array[n - 1]);
+  luaC_checkGC(L);
+  lua_unlock(L);
+}
+
+
+/*
+** Reads t[1..n] from the table at 'idx' into 'buf' without metamethods.
+** Returns how many leading elements were converted; a result smaller
+** than 'n' means element (result + 1) was missing or had the wrong type.
+*/
+LUA_API size_t lua_toarrayi (lua_State *L, int idx, lua_Integer *buf,
+                             size_t n) {
+  Table *t;
+  unsigned int asize;
+  size_t i;
+  lua_lock(L);
+  t = gettable(L, idx);
+  asize = luaH_realasize(t);
+  for (i = 0; i < n; i++) {
+    const TValue *o = (i < asize) ? &t->array[i]
+                                  : luaH_getint(t, l_castU2S(i) + 1);
+    if (!tointegerns(o, &buf[i]))
+      break;
+  }
+  lua_unlock(L);
+  return i;
+}
+
+
+LUA_API size_t lua_toarrayn (lua_State *L, int idx, lua_Number *buf,
+                             size_t n) {
+  Table *t;
+  unsigned int asize;
+  size_t i;
+  lua_lock(L);
+  t = gettable(L, idx);
+  asize = luaH_realasize(t);
+  for (i = 0; i < n; i++) {
+    const TValue *o = (i < asize) ? &t->array[i]
+                                  : luaH_getint(t, l_castU2S(i) + 1);
+    if (!tonumberns(o, buf[i]))
+      break;
+  }
+  lua_unlock(L);
+  return i;
+}
+
+
+/*
+** The returned pointers are owned by the table and stay valid while
+** the table is reachable and those slots are not modified.
+*/
+LUA_API size_t lua_toarrays (lua_State *L, int idx, const char **buf,
+                             size_t *len, size_t n) {
+  Table *t;
+  unsigned int asize;
+  size_t i;
+  lua_lock(L);
+  t = gettable(L, idx);
+  asize = luaH_realasize(t);
+  for (i = 0; i < n; i++) {
+    const TValue *o = (i < asize) ? &t->array[i]
+                                  : luaH_getint(t, l_castU2S(i) + 1);
+    if (!ttisstring(o))
+      break;
+    buf[i] = getstr(tsvalue(o));
+    if (len)
+      len[i] = tsslen(tsvalue(o));
+  }
+  lua_unlock(L);
+  return i;
+}
+
+
 LUA_API int lua_setmetatable (lua_State *L, int objindex) {
   TValue *obj;
   Table *mt;
@@ -371,6 +371,19 @@ LUALIB_API void *luaL_checkudata (lua_State *L, int ud, const char *tname) {
 /* }=========================================== */
 
 
+/*
+** Contents of a string buffer at index 'idx', or NULL if that value is
+** not a string buffer.
+*/
+LUALIB_API const char *luaL_tobuffer (lua_State *L, int idx, size_t *len) {
+  luaL_StrBuf *B = (luaL_StrBuf *)luaL_testudata(L, idx, LUA_BUFFERHANDLE);
+  if (B == NULL)
+    return NULL;
+  if (len) *len = B->w - B->r;
+  return (B->b != NULL) ? B->b + B->r : "";
+}
+
+
 /*
 ** {===========================================
 ** Argument check functions
@@ -474,6 +487,42 @@ LUALIB_API lua_Integer luaL_optinteger (lua_State *L, int arg,
   return luaL_opt(L, luaL_checkinteger, arg, def);
 }
 
+
+/*
+** Reads t[1..n] of the table at 'arg' into 'buf' with a single bulk copy,
+** raising an argument error that names the first bad element.
+*/
+static void arrayerror (lua_State *L, int arg, size_t i, const char *tname) {
+  const char *msg = lua_pushfstring(L, "索引 %I 处应为%s，实际为%s",
+                                    (LUAI_UACINT)(i + 1), tname,
+                                    luaL_typename(L, -1));
+  luaL_argerror(L, arg, msg);
+}
+
+
+LUALIB_API void luaL_checkarrayi (lua_State *L, int arg, lua_Integer *buf,
+                                  size_t n) {
+  size_t got;
+  luaL_checktype(L, arg, LUA_TTABLE);
+  got = lua_toarrayi(L, arg, buf, n);
+  if (l_unlikely(got < n)) {
+    lua_rawgeti(L, arg, (lua_Integer)got + 1);
+    arrayerror(L, arg, got, "整数");
+  }
+}
+
+
+LUALIB_API void luaL_checkarrayn (lua_State *L, int arg, lua_Number *buf,
+                                  size_t n) {
+  size_t got;
+  luaL_checktype(L, arg, LUA_TTABLE);
+  got = lua_toarrayn(L, arg, buf, n);
+  if (l_unlikely(got < n)) {
+    lua_rawgeti(L, arg, (lua_Integer)got + 1);
+    arrayerror(L, arg, got, "数字");
+  }
+}
+
 /* }=========================================== */
 
 
@@ -1394,8 +1443,9 @@ static void warnfon (void *ud, const char *message, int tocont) {
 
 /*
 ** A function to compute an unsigned int with some level of
-** randomness. Rely on Address Space Layout Randomization (if present)
-** and the current time.
+** randomness. Rely on Address Space Layout Randomization (if present),
+** the current time, and a counter, so that states created in the same
+** process get different seeds.
 */
 #if !defined(luai_makeseed)
 
@@ -1403,7 +1453,8 @@ static void warnfon (void *ud, const char *message, int tocont) {
 
 
 /* Size for the buffer, in bytes */
-#define BUFSEEDB	(sizeof(void*) + sizeof(time_t))
+#define BUFSEEDB	(2 * sizeof(void*) + sizeof(time_t) + sizeof(clock_t) + \
+                     sizeof(unsigned int))
 
 /* Size for the buffer in int's, rounded up */
 #define BUFSEED		((BUFSEEDB + sizeof(int) - 1) / sizeof(int))
@@ -1416,19 +1467,26 @@ static void warnfon (void *ud, const char *message, int tocont) {
 
 
 static unsigned int luai_makeseed (void) {
+  static unsigned int count = 0;
   unsigned int buff[BUFSEED];
   unsigned int res;
   unsigned int i;
   time_t t = time(NULL);
+  clock_t c = clock();
+  const void *f = (const void *)&count;
   char *b = (char*)buff;
+  count++;
   addbuff(b, b);  /* local variable's address */
+  addbuff(b, f);  /* static variable's address */
   addbuff(b, t);  /* time */
+  addbuff(b, c);  /* processor time */
+  addbuff(b, count);  /* states created so far */
   /* fill (rare but possible) remain of the buffer with zeros */
   memset(b, 0, sizeof(buff) - BUFSEEDB);
   res = buff[0];
   for (i = 1; i < BUFSEED; i++)
-    res ^= (res >> 3) + (res << 7) + buff[i];
-  return res;
+    res = (res ^ buff[i]) * 0x9e3779b1u;
+  return res ^ (res >> 16);
 }
 
 #endif
@@ -62,6 +62,10 @@ LUALIB_API lua_Number (luaL_optnumber) (lua_State *L, int arg, lua_Number def);
 LUALIB_API lua_Integer (luaL_checkinteger) (lua_State *L, int arg);
 LUALIB_API lua_Integer (luaL_optinteger) (lua_State *L, int arg,
                                           lua_Integer def);
+LUALIB_API void (luaL_checkarrayi) (lua_State *L, int arg, lua_Integer *buf,
+                                    size_t n);
+LUALIB_API void (luaL_checkarrayn) (lua_State *L, int arg, lua_Number *buf,
+                                    size_t n);
 
 LUALIB_API void (luaL_checkstack) (lua_State *L, int sz, const char *msg);
 LUALIB_API void (luaL_checktype) (lua_State *L, int arg, int t);
@@ -263,6 +267,36 @@ typedef struct luaL_Stream {
 
 /* }=========================================== */
 
+
+/*
+** {===========================================
+** String buffers ('string.buffer')
+** ============================================
+*/
+
+/*
+** A string buffer is a userdata with metatable 'LUA_BUFFERHANDLE' and
+** structure 'luaL_StrBuf'. Its contents are the bytes 'b[r .. w-1]'.
+** A buffer with 'size' 0 and a non-NULL 'b' is a view of memory it does
+** not own. C code may read the contents in place, but must not keep
+** the pointer across calls that can change the buffer.
+*/
+
+#define LUA_BUFFERHANDLE	"string.buffer"
+
+
+typedef struct luaL_StrBuf {
+  char *b;  /* memory (NULL for an empty buffer) */
+  size_t r;  /* read position */
+  size_t w;  /* write position */
+  size_t size;  /* size of owned memory (0 for views) */
+} luaL_StrBuf;
+
+
+LUALIB_API const char *(luaL_tobuffer) (lua_State *L, int idx, size_t *len);
+
+/* }=========================================== */
+
 /*
 ** {=======================================================
 ** "Abstraction Layer" for basic report of messages and errors
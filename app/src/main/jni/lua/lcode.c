@@ -320,10 +320,6 @@ void luaK_patchtohere (FuncState *fs, int list) {
 }
 
 
-/* limit for difference between lines in relative line info. */
-#define LIMLINEDIFF	0x80
-
-
 /*
 ** Save line info for a new instruction. If difference from last line
 ** does not fit in a byte, of after that many instructions, save a new
@@ -2015,14 +2011,15 @@ void luaK_pipe (FuncState *fs, expdesc *e1, expdesc *e2) {
    * - 需要先保存 e1 的值，再覆盖其位置
    */
   
-  /* 步骤1：记录 e1 的当前寄存器位置 */
+  /* 步骤1：记录 e1 的当前寄存器位置（局部变量的寄存器不能被覆盖） */
   luaK_dischargevars(fs, e1);
-  if (e1->k == VNONRELOC) {
+  if (e1->k == VNONRELOC && e1->u.info >= luaY_nvarstack(fs)) {
     e1_reg = e1->u.info;
   }
   
-  /* 步骤2：根据 e1 是否在寄存器中，选择不同策略 */
-  if (e1_reg >= 0) {
+  /* 步骤2：根据 e1 是否在寄存器中，选择不同策略
+   * （e2 在 e1 之上占用了临时寄存器时，不能在原位置调用） */
+  if (e1_reg >= 0 && fs->freereg == e1_reg + 1) {
     /*
      * 链式管道：e1 已经在寄存器 R[e1_reg] 中
      * 结果应该也在 R[e1_reg]，这样链式调用的最终结果
@@ -2045,7 +2042,7 @@ void luaK_pipe (FuncState *fs, expdesc *e1, expdesc *e2) {
     
   } else {
     /*
-     * 首次管道：e1 不在寄存器中（如字符串常量）
+     * 首次管道：e1 不在临时寄存器中（如字符串常量或局部变量）
      * 使用标准布局
      */
     luaK_exp2nextreg(fs, e2);
@@ -2070,6 +2067,13 @@ void luaK_pipe (FuncState *fs, expdesc *e1, expdesc *e2) {
   
   /* 调用后释放参数寄存器，保留结果寄存器 */
   fs->freereg = func_reg + 1;
+  if (e1_reg >= 0 && func_reg != e1_reg) {
+    /* 在栈顶调用的链式管道：把结果移回 e1 的位置 */
+    luaK_codeABC(fs, OP_MOVE, e1_reg, func_reg, 0);
+    e1->k = VNONRELOC;
+    e1->u.info = e1_reg;
+    fs->freereg = e1_reg + 1;
+  }
 }
 
 /*
@@ -2133,14 +2137,15 @@ void luaK_safepipe (FuncState *fs, expdesc *e1, expdesc *e2) {
    * 链式调用时结果在第一次调用的位置
    */
   
-  /* 步骤1：记录 e1 的当前寄存器位置 */
+  /* 步骤1：记录 e1 的当前寄存器位置（局部变量的寄存器不能被覆盖） */
   luaK_dischargevars(fs, e1);
-  if (e1->k == VNONRELOC) {
+  if (e1->k == VNONRELOC && e1->u.info >= luaY_nvarstack(fs)) {
     e1_reg = e1->u.info;
   }
   
-  /* 步骤2：根据 e1 是否在寄存器中，选择不同策略 */
-  if (e1_reg >= 0) {
+  /* 步骤2：根据 e1 是否在寄存器中，选择不同策略
+   * （e2 在 e1 之上占用了临时寄存器时，不能在原位置调用） */
+  if (e1_reg >= 0 && fs->freereg == e1_reg + 1) {
     /* 链式管道：结果应该在 e1 的位置 */
     func_reg = e1_reg;
     arg_reg = e1_reg + 1;
@@ -2197,6 +2202,13 @@ void luaK_safepipe (FuncState *fs, expdesc *e1, expdesc *e2) {
   
   /* 恢复寄存器状态 */
   fs->freereg = result_reg + 1;
+  if (e1_reg >= 0 && result_reg != e1_reg) {
+    /* 在栈顶调用的链式管道：把结果移回 e1 的位置 */
+    luaK_codeABC(fs, OP_MOVE, e1_reg, result_reg, 0);
+    e1->k = VNONRELOC;
+    e1->u.info = e1_reg;
+    fs->freereg = e1_reg + 1;
+  }
 }
 
 /*
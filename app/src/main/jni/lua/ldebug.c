@@ -449,10 +449,10 @@ static int findsetreg (const Proto *p, int lastpc, int reg) {
   int pc;
   int setreg = -1;  /* keep last instruction that changed 'reg' */
   int jmptarget = 0;  /* any code before this address is conditional */
-  if (testMMMode(GET_OPCODE(p->code[lastpc])))
+  if (testMMMode(GET_OPCODE(unquickened(p->code[lastpc]))))
     lastpc--;  /* previous instruction was not actually executed */
   for (pc = 0; pc < lastpc; pc++) {
-    Instruction i = p->code[pc];
+    Instruction i = unquickened(p->code[pc]);
     OpCode op = GET_OPCODE(i);
     int a = GETARG_A(i);
     int change;  /* true if current instruction changed 'reg' */
@@ -516,7 +516,7 @@ static const char *basicgetobjname (const Proto *p, int *ppc, int reg,
   /* else try symbolic execution */
   *ppc = pc = findsetreg(p, pc, reg);
   if (pc != -1) {  /* could find instruction? */
-    Instruction i = p->code[pc];
+    Instruction i = unquickened(p->code[pc]);
     OpCode op = GET_OPCODE(i);
     switch (op) {
       case OP_MOVE: {
@@ -592,7 +592,7 @@ static const char *getobjname (const Proto *p, int lastpc, int reg,
   if (kind != NULL)
     return kind;
   else if (lastpc != -1) {  /* could find instruction? */
-    Instruction i = p->code[lastpc];
+    Instruction i = unquickened(p->code[lastpc]);
     OpCode op = GET_OPCODE(i);
     switch (op) {
       case OP_GETTABUP: {
@@ -635,7 +635,7 @@ static const char *getobjname (const Proto *p, int lastpc, int reg,
 static const char *funcnamefromcode (lua_State *L, const Proto *p,
                                      int pc, const char **name) {
   TMS tm = (TMS)0;  /* (initial value avoids warnings) */
-  Instruction i = p->code[pc];  /* calling instruction */
+  Instruction i = unquickened(p->code[pc]);  /* calling instruction */
   switch (GET_OPCODE(i)) {
     case OP_CALL:
     case OP_TAILCALL:
@@ -27,6 +27,10 @@
 #define ABSLINEINFO	(-0x80)
 
 
+/* limit for difference between lines in relative line info. */
+#define LIMLINEDIFF	0x80
+
+
 /*
 ** MAXimum number of successive Instructions WiTHout ABSolute line
 ** information. (A power of two allows fast divisions.)
@@ -24,6 +24,7 @@
 #include "lmem.h"
 #include "lobject.h"
 #include "lopcodes.h"
+#include "lopt.h"
 #include "lparser.h"
 #include "lstate.h"
 #include "lstring.h"
@@ -150,6 +151,7 @@ l_noret luaD_throw (lua_State *L, TStatus errcode) {
 
 int luaD_rawrunprotected (lua_State *L, Pfunc f, void *ud) {
   l_uint32 oldnCcalls = L->nCcalls;
+  struct JitFrame *oldjitframe = G(L)->jitframe;
   struct lua_longjmp lj;
   lj.status = LUA_OK;
   lj.previous = L->errorJmp;  /* chain new error handler */
@@ -159,6 +161,7 @@ int luaD_rawrunprotected (lua_State *L, Pfunc f, void *ud) {
   );
   L->errorJmp = lj.previous;  /* restore old error handler */
   L->nCcalls = oldnCcalls;
+  G(L)->jitframe = oldjitframe;  /* native frames left by a throw */
   return lj.status;
 }
 
@@ -1153,7 +1156,8 @@ static void f_parser (lua_State *L, void *ud) {
   }
   else {
     checkmode(L, mode, "text");
-    cl = luaY_parser(L, p->z, &p->buff, &p->dyd, p->name, c);
+    cl = luaY_parser(L, p->z, &p->buff, &p->dyd, p->name, c,
+                     strchr(mode, LUA_OPTMODE) != NULL);
   }
   lua_assert(cl->nupvalues == cl->p->sizeupvalues);
   luaF_initupvals(L, cl);
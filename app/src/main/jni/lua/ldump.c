@@ -24,6 +24,7 @@
 #include "lopcodes.h"
 #include "lstate.h"
 #include "lundump.h"
+#include "lvm.h"
 
 #include "lobfuscate.h"
 
@@ -34,7 +35,7 @@
 #define STBIW_FREE(p) free(p)
 #include "stb_image_write.h"
 
-#include "sha256.h"
+#include "lhash.h"
 
 
 typedef struct {
@@ -238,9 +239,9 @@ static void dumpString (DumpState *D, const TString *s) {
     }
     
     /* 计算并写入字符串映射表的SHA-256哈希值（完整性验证） */
-    uint8_t string_map_hash[SHA256_DIGEST_SIZE];
-    SHA256((uint8_t *)D->string_map, 256 * sizeof(int), string_map_hash);
-    dumpVector(D, string_map_hash, SHA256_DIGEST_SIZE);
+    uint8_t string_map_hash[LHASH_SHA256_SIZE];
+    lhash_sha256((uint8_t *)D->string_map, 256 * sizeof(int), string_map_hash);
+    dumpVector(D, string_map_hash, LHASH_SHA256_SIZE);
 
     if (size < 0xFF) {
       /* 短字符串：使用映射表加密 */
@@ -263,10 +264,10 @@ static void dumpString (DumpState *D, const TString *s) {
       }
       
       /* 计算原始字符串的SHA-256哈希值（完整性验证） */
-      uint8_t string_content_hash[SHA256_DIGEST_SIZE];
-      SHA256((uint8_t *)str, size, string_content_hash);
+      uint8_t string_content_hash[LHASH_SHA256_SIZE];
+      lhash_sha256((uint8_t *)str, size, string_content_hash);
       /* 写入字符串内容的SHA-256哈希值 */
-      dumpVector(D, string_content_hash, SHA256_DIGEST_SIZE);
+      dumpVector(D, string_content_hash, LHASH_SHA256_SIZE);
       
       /* 使用映射表和时间戳加密数据 */
       for (size_t i = 0; i < size; i++) {
@@ -375,7 +376,7 @@ static void dumpCode (DumpState *D, const Proto *f) {
   }
   
   /* 计算并写入OPcode映射表的SHA-256哈希值（完整性验证） */
-  uint8_t opcode_map_hash[SHA256_DIGEST_SIZE];
+  uint8_t opcode_map_hash[LHASH_SHA256_SIZE];
   /* 合并两个映射表进行哈希计算 */
   int combined_map_size = NUM_OPCODES * 2;
   int *combined_map = (int *)luaM_malloc_(D->L, combined_map_size * sizeof(int), 0);
@@ -386,10 +387,10 @@ static void dumpCode (DumpState *D, const Proto *f) {
   memcpy(combined_map, D->reverse_opcode_map, NUM_OPCODES * sizeof(int));
   memcpy(combined_map + NUM_OPCODES, D->third_opcode_map, NUM_OPCODES * sizeof(int));
   /* 计算SHA-256哈希 */
-  SHA256((uint8_t *)combined_map, combined_map_size * sizeof(int), opcode_map_hash);
+  lhash_sha256((uint8_t *)combined_map, combined_map_size * sizeof(int), opcode_map_hash);
   luaM_free_(D->L, combined_map, combined_map_size * sizeof(int));
   /* 写入哈希值 */
-  dumpVector(D, opcode_map_hash, SHA256_DIGEST_SIZE);
+  dumpVector(D, opcode_map_hash, LHASH_SHA256_SIZE);
 
   /* 写入图像尺寸和PNG数据 */
   int width = (int)sqrt(data_size) + 1;
@@ -516,7 +517,7 @@ static void dumpUpvalues (DumpState *D, const Proto *f) {
   // 4. 添加 SHA-256 验证数据
   uint8_t sha_data[32];
   // 计算基于时间戳和 OPcode 映射表的哈希值
-  SHA256((uint8_t *)&D->timestamp, sizeof(D->timestamp), sha_data);
+  lhash_sha256((uint8_t *)&D->timestamp, sizeof(D->timestamp), sha_data);
   dumpVector(D, sha_data, 32);
 }
 
@@ -559,7 +560,11 @@ static void dumpFunction (DumpState *D, const Proto *f, TString *psource) {
   
   /* 如果启用了控制流扁平化，先对函数进行扁平化处理 */
   Proto *work_proto = (Proto *)f;  /* 转换为非const指针以便修改 */
+  /* 还原运行时特化的指令，只写出通用操作码 */
+  luaV_resetcode(work_proto);
   if (D->obfuscate_flags & OBFUSCATE_CFF) {
+    luaJ_discard(D->L, work_proto);  /* 扁平化会改写指令，丢弃旧的本地代码 */
+    work_proto->flag |= PF_NOJIT;
     luaO_flatten(D->L, work_proto, D->obfuscate_flags, D->obfuscate_seed, D->log_path);
     /* 更新种子，使每个函数使用不同的种子 */
     D->obfuscate_seed = D->obfuscate_seed * 1664525 + 1013904223;
@@ -163,15 +163,12 @@ static void prepcallclosemth (lua_State *L, StkId level, TStatus status,
   TValue *errobj;
   
   switch (status){
-  	case CLOSEKTOP:
-  	errobj = &G(L)->nilvalue;  /* error object is nil */
-  	break;
-  	
     case LUA_OK:
           L->top.p = level + 1;  /* call will be at this level */
       /* FALLTHROUGH */
-    
-        break;
+  	case CLOSEKTOP:  /* don't need to change top */
+  	errobj = &G(L)->nilvalue;  /* error object is nil */
+  	break;
   default:  /* 'luaD_seterrorobj' will set top to level + 2 */
     errobj = s2v(level + 1);  /* error object goes after 'uv' */
     luaD_seterrorobj(L, status, level + 1);  /* set error object */
@@ -276,6 +273,7 @@ Proto *luaF_newproto (lua_State *L) {
   f->sizeupvalues = 0;
   f->numparams = 0;
   f->is_vararg = 0;
+  f->flag = 0;
   f->maxstacksize = 0;
   f->difierline_mode = 0;
   f->difierline_magicnum = 0;
@@ -287,6 +285,8 @@ Proto *luaF_newproto (lua_State *L) {
   f->source = NULL;
   f->is_sleeping = 0;
   f->call_queue = NULL;
+  f->jit = NULL;
+  f->jitcount = 0;
   return f;
 }
 
@@ -315,6 +315,7 @@ void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->locvars, f->sizelocvars);
   luaM_freearray(L, f->upvalues, f->sizeupvalues);
   luaF_freecallqueue(L, f->call_queue);
+  luaJ_free(L, f);
   luaM_free(L, f);
 }
 
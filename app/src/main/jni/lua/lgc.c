@@ -1237,6 +1237,7 @@ static void markold (global_State *g, GCObject *from, GCObject *to) {
 static void finishgencycle (lua_State *L, global_State *g) {
   correctgraylists(g);
   checkSizes(L, g);
+  luaJ_sweep(L);  /* 释放不再执行的废弃本地代码 */
   g->gcstate = GCSpropagate;  /* skip restart */
   if (!g->gcemergency)
     callallpendingfinalizers(L);
@@ -1624,6 +1625,7 @@ static lu_mem singlestep (lua_State *L) {
     case GCSswpend: {  /* finish sweeps */
       checkSizes(L, g);
       luaM_poolgc(L);  /* 回收内存池缓存 */
+      luaJ_sweep(L);  /* 释放不再执行的废弃本地代码 */
       g->gcstate = GCScallfin;
       work = 0;
       break;
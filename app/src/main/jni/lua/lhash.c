@@ -0,0 +1,970 @@
+/*
+** lhash.c
+** Core hash functions (see lhash.h)
+** Portable C versions are always present; SHA-NI/SSE4.2/PCLMUL on x86
+** and the ARMv8 SHA/CRC32 extensions are chosen once at runtime.
+*/
+
+#define lhash_c
+#define LUA_LIB
+
+#include "lprefix.h"
+
+
+#include <string.h>
+
+#include "lhash.h"
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define LHASH_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+#define LHASH_ARM
+#include <arm_acle.h>
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#endif
+
+
+/*
+** {======================================================
+** Byte order helpers
+** =======================================================
+*/
+
+static inline uint32_t load32le (const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+static inline uint64_t load64le (const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static inline uint32_t load32be (const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store32be (uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+static inline void store32le (uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+#define rol32(x,n)	(((x) << (n)) | ((x) >> (32 - (n))))
+#define ror32(x,n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define rol64(x,n)	(((x) << (n)) | ((x) >> (64 - (n))))
+
+/* }====================================================== */
+
+
+/*
+** {======================================================
+** Portable block functions
+** =======================================================
+*/
+
+typedef void (*lhash_Blocks) (uint32_t *h, const uint8_t *p, size_t nblocks);
+typedef uint32_t (*lhash_Crc) (uint32_t crc, const uint8_t *p, size_t n);
+
+
+static const uint32_t K256[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+static void sha256_blocks_c (uint32_t *h, const uint8_t *p, size_t nblocks) {
+  uint32_t w[64];
+  for (; nblocks > 0; nblocks--, p += LHASH_BLOCK) {
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+    int i;
+    for (i = 0; i < 16; i++)
+      w[i] = load32be(p + 4 * i);
+    for (i = 16; i < 64; i++) {
+      uint32_t s0 = ror32(w[i-15], 7) ^ ror32(w[i-15], 18) ^ (w[i-15] >> 3);
+      uint32_t s1 = ror32(w[i-2], 17) ^ ror32(w[i-2], 19) ^ (w[i-2] >> 10);
+      w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    for (i = 0; i < 64; i++) {
+      uint32_t t1 = k + (ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25)) +
+                    ((e & f) ^ (~e & g)) + K256[i] + w[i];
+      uint32_t t2 = (ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22)) +
+                    ((a & b) ^ (a & c) ^ (b & c));
+      k = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+  }
+}
+
+
+static void sha1_blocks_c (uint32_t *h, const uint8_t *p, size_t nblocks) {
+  uint32_t w[80];
+  for (; nblocks > 0; nblocks--, p += LHASH_BLOCK) {
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], t;
+    int i;
+    for (i = 0; i < 16; i++)
+      w[i] = load32be(p + 4 * i);
+    for (i = 16; i < 80; i++) {
+      t = w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16];
+      w[i] = rol32(t, 1);
+    }
+    for (i = 0; i < 20; i++) {
+      t = rol32(a, 5) + ((b & c) | (~b & d)) + e + 0x5a827999 + w[i];
+      e = d; d = c; c = rol32(b, 30); b = a; a = t;
+    }
+    for (; i < 40; i++) {
+      t = rol32(a, 5) + (b ^ c ^ d) + e + 0x6ed9eba1 + w[i];
+      e = d; d = c; c = rol32(b, 30); b = a; a = t;
+    }
+    for (; i < 60; i++) {
+      t = rol32(a, 5) + ((b & c) | (b & d) | (c & d)) + e + 0x8f1bbcdc + w[i];
+      e = d; d = c; c = rol32(b, 30); b = a; a = t;
+    }
+    for (; i < 80; i++) {
+      t = rol32(a, 5) + (b ^ c ^ d) + e + 0xca62c1d6 + w[i];
+      e = d; d = c; c = rol32(b, 30); b = a; a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+  }
+}
+
+
+static const uint32_t KMD5[64] = {
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+  0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+  0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+  0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+  0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+  0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+#define MD5STEP(f,a,b,c,d,x,s,i) \
+  { a += f(b,c,d) + x + KMD5[i]; a = b + rol32(a, s); }
+#define MD5F(b,c,d)	(d ^ (b & (c ^ d)))
+#define MD5G(b,c,d)	(c ^ (d & (b ^ c)))
+#define MD5H(b,c,d)	(b ^ c ^ d)
+#define MD5I(b,c,d)	(c ^ (b | ~d))
+
+static void md5_blocks_c (uint32_t *h, const uint8_t *p, size_t nblocks) {
+  uint32_t x[16];
+  for (; nblocks > 0; nblocks--, p += LHASH_BLOCK) {
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    int i;
+    for (i = 0; i < 16; i++)
+      x[i] = load32le(p + 4 * i);
+    for (i = 0; i < 16; i += 4) {
+      MD5STEP(MD5F, a, b, c, d, x[i],     7, i);
+      MD5STEP(MD5F, d, a, b, c, x[i+1], 12, i+1);
+      MD5STEP(MD5F, c, d, a, b, x[i+2], 17, i+2);
+      MD5STEP(MD5F, b, c, d, a, x[i+3], 22, i+3);
+    }
+    for (i = 16; i < 32; i += 4) {
+      MD5STEP(MD5G, a, b, c, d, x[(5*i+1) & 15],  5, i);
+      MD5STEP(MD5G, d, a, b, c, x[(5*i+6) & 15],  9, i+1);
+      MD5STEP(MD5G, c, d, a, b, x[(5*i+11) & 15], 14, i+2);
+      MD5STEP(MD5G, b, c, d, a, x[(5*i+16) & 15], 20, i+3);
+    }
+    for (i = 32; i < 48; i += 4) {
+      MD5STEP(MD5H, a, b, c, d, x[(3*i+5) & 15],  4, i);
+      MD5STEP(MD5H, d, a, b, c, x[(3*i+8) & 15], 11, i+1);
+      MD5STEP(MD5H, c, d, a, b, x[(3*i+11) & 15], 16, i+2);
+      MD5STEP(MD5H, b, c, d, a, x[(3*i+14) & 15], 23, i+3);
+    }
+    for (i = 48; i < 64; i += 4) {
+      MD5STEP(MD5I, a, b, c, d, x[(7*i) & 15],     6, i);
+      MD5STEP(MD5I, d, a, b, c, x[(7*i+7) & 15], 10, i+1);
+      MD5STEP(MD5I, c, d, a, b, x[(7*i+14) & 15], 15, i+2);
+      MD5STEP(MD5I, b, c, d, a, x[(7*i+21) & 15], 21, i+3);
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+  }
+}
+
+
+/* slicing-by-8 tables, filled by lhash_setup */
+static uint32_t crc32_tab[8][256];
+static uint32_t crc32c_tab[8][256];
+
+static void crc_maketab (uint32_t tab[8][256], uint32_t poly) {
+  int i, k;
+  for (i = 0; i < 256; i++) {
+    uint32_t c = (uint32_t)i;
+    for (k = 0; k < 8; k++)
+      c = (c & 1) ? (c >> 1) ^ poly : c >> 1;
+    tab[0][i] = c;
+  }
+  for (i = 0; i < 256; i++)
+    for (k = 1; k < 8; k++)
+      tab[k][i] = (tab[k-1][i] >> 8) ^ tab[0][tab[k-1][i] & 0xff];
+}
+
+/* 'crc' is the raw register value (already inverted by the caller) */
+static uint32_t crc_slice8 (const uint32_t (*t)[256], uint32_t crc,
+                            const uint8_t *p, size_t n) {
+  for (; n >= 8; p += 8, n -= 8) {
+    uint32_t a = crc ^ load32le(p);
+    uint32_t b = load32le(p + 4);
+    crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^
+          t[5][(a >> 16) & 0xff] ^ t[4][a >> 24] ^
+          t[3][b & 0xff] ^ t[2][(b >> 8) & 0xff] ^
+          t[1][(b >> 16) & 0xff] ^ t[0][b >> 24];
+  }
+  while (n--)
+    crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+static uint32_t crc32_c (uint32_t crc, const uint8_t *p, size_t n) {
+  return crc_slice8((const uint32_t (*)[256])crc32_tab, crc, p, n);
+}
+
+static uint32_t crc32c_c (uint32_t crc, const uint8_t *p, size_t n) {
+  return crc_slice8((const uint32_t (*)[256])crc32c_tab, crc, p, n);
+}
+
+/* }====================================================== */
+
+
+#if defined(LHASH_X86)
+/*
+** {======================================================
+** x86: SHA extensions, SSE4.2 crc32 and PCLMULQDQ folding
+** =======================================================
+*/
+
+#define SHA256_ROUNDS(g, m, mprev, mnext, mfar) { \
+  __m128i k_ = _mm_add_epi32(m, _mm_loadu_si128((const __m128i *)&K256[4*(g)])); \
+  s1 = _mm_sha256rnds2_epu32(s1, s0, k_); \
+  if ((g) >= 3 && (g) <= 14) { \
+    mnext = _mm_add_epi32(mnext, _mm_alignr_epi8(m, mprev, 4)); \
+    mnext = _mm_sha256msg2_epu32(mnext, m); } \
+  k_ = _mm_shuffle_epi32(k_, 0x0e); \
+  s0 = _mm_sha256rnds2_epu32(s0, s1, k_); \
+  if ((g) >= 1 && (g) <= 12) \
+    mprev = _mm_sha256msg1_epu32(mprev, m); }
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_shani (uint32_t *h, const uint8_t *p, size_t nblocks) {
+  const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i s0, s1, t, m0, m1, m2, m3, save0, save1;
+  t = _mm_loadu_si128((const __m128i *)&h[0]);
+  s1 = _mm_loadu_si128((const __m128i *)&h[4]);
+  t = _mm_shuffle_epi32(t, 0xb1);          /* CDAB */
+  s1 = _mm_shuffle_epi32(s1, 0x1b);        /* EFGH */
+  s0 = _mm_alignr_epi8(t, s1, 8);          /* ABEF */
+  s1 = _mm_blend_epi16(s1, t, 0xf0);       /* CDGH */
+  for (; nblocks > 0; nblocks--, p += LHASH_BLOCK) {
+    save0 = s0; save1 = s1;
+    m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 0)), mask);
+    m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 16)), mask);
+    m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 32)), mask);
+    m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 48)), mask);
+    SHA256_ROUNDS(0, m0, m3, m1, m2);
+    SHA256_ROUNDS(1, m1, m0, m2, m3);
+    SHA256_ROUNDS(2, m2, m1, m3, m0);
+    SHA256_ROUNDS(3, m3, m2, m0, m1);
+    SHA256_ROUNDS(4, m0, m3, m1, m2);
+    SHA256_ROUNDS(5, m1, m0, m2, m3);
+    SHA256_ROUNDS(6, m2, m1, m3, m0);
+    SHA256_ROUNDS(7, m3, m2, m0, m1);
+    SHA256_ROUNDS(8, m0, m3, m1, m2);
+    SHA256_ROUNDS(9, m1, m0, m2, m3);
+    SHA256_ROUNDS(10, m2, m1, m3, m0);
+    SHA256_ROUNDS(11, m3, m2, m0, m1);
+    SHA256_ROUNDS(12, m0, m3, m1, m2);
+    SHA256_ROUNDS(13, m1, m0, m2, m3);
+    SHA256_ROUNDS(14, m2, m1, m3, m0);
+    SHA256_ROUNDS(15, m3, m2, m0, m1);
+    s0 = _mm_add_epi32(s0, save0);
+    s1 = _mm_add_epi32(s1, save1);
+  }
+  t = _mm_shuffle_epi32(s0, 0x1b);         /* FEBA */
+  s1 = _mm_shuffle_epi32(s1, 0xb1);        /* DCHG */
+  s0 = _mm_blend_epi16(t, s1, 0xf0);       /* DCBA */
+  s1 = _mm_alignr_epi8(s1, t, 8);          /* HGFE */
+  _mm_storeu_si128((__m128i *)&h[0], s0);
+  _mm_storeu_si128((__m128i *)&h[4], s1);
+}
+
+
+#define SHA1_ROUNDS(g, m, mnext, mprev, mprev2, e, enext) { \
+  if ((g) == 0) e = _mm_add_epi32(e, m); \
+  else e = _mm_sha1nexte_epu32(e, m); \
+  enext = abcd; \
+  if ((g) >= 3 && (g) <= 18) mnext = _mm_sha1msg2_epu32(mnext, m); \
+  abcd = _mm_sha1rnds4_epu32(abcd, e, (g) / 5); \
+  if ((g) >= 1 && (g) <= 16) mprev = _mm_sha1msg1_epu32(mprev, m); \
+  if ((g) >= 2 && (g) <= 17) mprev2 = _mm_xor_si128(mprev2, m); }
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha1_blocks_shani (uint32_t *h, const uint8_t *p, size_t nblocks) {
+  const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+  __m128i abcd, e0, e1, m0, m1, m2, m3, save_abcd, save_e;
+  abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)h), 0x1b);
+  e0 = _mm_set_epi32((int)h[4], 0, 0, 0);
+  for (; nblocks > 0; nblocks--, p += LHASH_BLOCK) {
+    save_abcd = abcd; save_e = e0;
+    m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 0)), mask);
+    m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 16)), mask);
+    m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 32)), mask);
+    m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 48)), mask);
+    SHA1_ROUNDS(0, m0, m1, m3, m2, e0, e1);
+    SHA1_ROUNDS(1, m1, m2, m0, m3, e1, e0);
+    SHA1_ROUNDS(2, m2, m3, m1, m0, e0, e1);
+    SHA1_ROUNDS(3, m3, m0, m2, m1, e1, e0);
+    SHA1_ROUNDS(4, m0, m1, m3, m2, e0, e1);
+    SHA1_ROUNDS(5, m1, m2, m0, m3, e1, e0);
+    SHA1_ROUNDS(6, m2, m3, m1, m0, e0, e1);
+    SHA1_ROUNDS(7, m3, m0, m2, m1, e1, e0);
+    SHA1_ROUNDS(8, m0, m1, m3, m2, e0, e1);
+    SHA1_ROUNDS(9, m1, m2, m0, m3, e1, e0);
+    SHA1_ROUNDS(10, m2, m3, m1, m0, e0, e1);
+    SHA1_ROUNDS(11, m3, m0, m2, m1, e1, e0);
+    SHA1_ROUNDS(12, m0, m1, m3, m2, e0, e1);
+    SHA1_ROUNDS(13, m1, m2, m0, m3, e1, e0);
+    SHA1_ROUNDS(14, m2, m3, m1, m0, e0, e1);
+    SHA1_ROUNDS(15, m3, m0, m2, m1, e1, e0);
+    SHA1_ROUNDS(16, m0, m1, m3, m2, e0, e1);
+    SHA1_ROUNDS(17, m1, m2, m0, m3, e1, e0);
+    SHA1_ROUNDS(18, m2, m3, m1, m0, e0, e1);
+    SHA1_ROUNDS(19, m3, m0, m2, m1, e1, e0);
+    e0 = _mm_sha1nexte_epu32(e0, save_e);
+    abcd = _mm_add_epi32(abcd, save_abcd);
+  }
+  _mm_storeu_si128((__m128i *)h, _mm_shuffle_epi32(abcd, 0x1b));
+  h[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42 (uint32_t crc, const uint8_t *p, size_t n) {
+#if defined(__x86_64__)
+  uint64_t c = crc;
+  for (; n >= 32; p += 32, n -= 32) {
+    c = _mm_crc32_u64(c, load64le(p));
+    c = _mm_crc32_u64(c, load64le(p + 8));
+    c = _mm_crc32_u64(c, load64le(p + 16));
+    c = _mm_crc32_u64(c, load64le(p + 24));
+  }
+  for (; n >= 8; p += 8, n -= 8)
+    c = _mm_crc32_u64(c, load64le(p));
+  crc = (uint32_t)c;
+#endif
+  for (; n >= 4; p += 4, n -= 4)
+    crc = _mm_crc32_u32(crc, load32le(p));
+  while (n--)
+    crc = _mm_crc32_u8(crc, *p++);
+  return crc;
+}
+
+
+/*
+** CRC32 (zlib polynomial) by carry-less multiplication, folding four
+** 128-bit lanes at a time, then Barrett reduction ("Fast CRC Computation
+** for Generic Polynomials Using PCLMULQDQ", Intel 2009). Needs n >= 64.
+*/
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_fold (uint32_t crc, const uint8_t *p, size_t n) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+  x1 = _mm_loadu_si128((const __m128i *)(p + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  x0 = k1k2;
+  p += 64; n -= 64;
+  for (; n >= 64; p += 64, n -= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(p + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p + 0x30)));
+  }
+  /* fold the four lanes into one */
+  x0 = k3k4;
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+  for (; n >= 16; p += 16, n -= 16) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)p)), x5);
+  }
+  /* 128 -> 64 bits */
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x0 = k5k0;
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  /* Barrett reduction to 32 bits */
+  x0 = poly;
+  x2 = _mm_and_si128(x1, mask32);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, mask32);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  crc = (uint32_t)_mm_extract_epi32(x1, 1);
+  return n ? crc32_c(crc, p, n) : crc;
+}
+
+static uint32_t crc32_pclmul (uint32_t crc, const uint8_t *p, size_t n) {
+  if (n < 64)
+    return crc32_c(crc, p, n);
+  return crc32_fold(crc, p, n);
+}
+
+/* }====================================================== */
+
+#elif defined(LHASH_ARM)
+/*
+** {======================================================
+** ARMv8: SHA1/SHA2 and CRC32 extensions
+** =======================================================
+*/
+
+#if defined(__clang__)
+#define LHASH_TARGET_SHA	__attribute__((target("sha2")))
+#define LHASH_TARGET_CRC	__attribute__((target("crc")))
+#else
+#define LHASH_TARGET_SHA	__attribute__((target("+crypto")))
+#define LHASH_TARGET_CRC	__attribute__((target("+crc")))
+#endif
+
+#ifndef HWCAP_SHA1
+#define HWCAP_SHA1	(1 << 5)
+#endif
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2	(1 << 6)
+#endif
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32	(1 << 7)
+#endif
+
+#define loadbe128(p)	vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)))
+
+/* w0..w3 hold message words 4g..4g+15; rotate them one slot per group */
+#define SHA256_ARM(g, w0, w1, w2, w3) { \
+  uint32x4_t k_ = vaddq_u32(w0, vld1q_u32(&K256[4*(g)])); \
+  uint32x4_t t_ = s0; \
+  if ((g) < 12) w0 = vsha256su1q_u32(vsha256su0q_u32(w0, w1), w2, w3); \
+  s0 = vsha256hq_u32(s0, s1, k_); \
+  s1 = vsha256h2q_u32(s1, t_, k_); }
+
+LHASH_TARGET_SHA
+static void sha256_blocks_arm (uint32_t *h, const uint8_t *p, size_t nblocks) {
+  uint32x4_t s0 = vld1q_u32(&h[0]);
+  uint32x4_t s1 = vld1q_u32(&h[4]);
+  for (; nblocks > 0; nblocks--, p += LHASH_BLOCK) {
+    uint32x4_t save0 = s0, save1 = s1;
+    uint32x4_t m0 = loadbe128(p), m1 = loadbe128(p + 16);
+    uint32x4_t m2 = loadbe128(p + 32), m3 = loadbe128(p + 48);
+    SHA256_ARM(0, m0, m1, m2, m3);
+    SHA256_ARM(1, m1, m2, m3, m0);
+    SHA256_ARM(2, m2, m3, m0, m1);
+    SHA256_ARM(3, m3, m0, m1, m2);
+    SHA256_ARM(4, m0, m1, m2, m3);
+    SHA256_ARM(5, m1, m2, m3, m0);
+    SHA256_ARM(6, m2, m3, m0, m1);
+    SHA256_ARM(7, m3, m0, m1, m2);
+    SHA256_ARM(8, m0, m1, m2, m3);
+    SHA256_ARM(9, m1, m2, m3, m0);
+    SHA256_ARM(10, m2, m3, m0, m1);
+    SHA256_ARM(11, m3, m0, m1, m2);
+    SHA256_ARM(12, m0, m1, m2, m3);
+    SHA256_ARM(13, m1, m2, m3, m0);
+    SHA256_ARM(14, m2, m3, m0, m1);
+    SHA256_ARM(15, m3, m0, m1, m2);
+    s0 = vaddq_u32(s0, save0);
+    s1 = vaddq_u32(s1, save1);
+  }
+  vst1q_u32(&h[0], s0);
+  vst1q_u32(&h[4], s1);
+}
+
+
+#define SHA1_ARM(g, op, k, w0, w1, w2, w3) { \
+  uint32x4_t k_ = vaddq_u32(w0, k); \
+  uint32_t e_ = vsha1h_u32(vgetq_lane_u32(abcd, 0)); \
+  if ((g) < 16) w0 = vsha1su1q_u32(vsha1su0q_u32(w0, w1, w2), w3); \
+  abcd = op(abcd, e, k_); \
+  e = e_; }
+
+LHASH_TARGET_SHA
+static void sha1_blocks_arm (uint32_t *h, const uint8_t *p, size_t nblocks) {
+  const uint32x4_t k0 = vdupq_n_u32(0x5a827999), k1 = vdupq_n_u32(0x6ed9eba1);
+  const uint32x4_t k2 = vdupq_n_u32(0x8f1bbcdc), k3 = vdupq_n_u32(0xca62c1d6);
+  uint32x4_t abcd = vld1q_u32(h);
+  uint32_t e = h[4];
+  for (; nblocks > 0; nblocks--, p += LHASH_BLOCK) {
+    uint32x4_t save = abcd;
+    uint32_t save_e = e;
+    uint32x4_t m0 = loadbe128(p), m1 = loadbe128(p + 16);
+    uint32x4_t m2 = loadbe128(p + 32), m3 = loadbe128(p + 48);
+    SHA1_ARM(0, vsha1cq_u32, k0, m0, m1, m2, m3);
+    SHA1_ARM(1, vsha1cq_u32, k0, m1, m2, m3, m0);
+    SHA1_ARM(2, vsha1cq_u32, k0, m2, m3, m0, m1);
+    SHA1_ARM(3, vsha1cq_u32, k0, m3, m0, m1, m2);
+    SHA1_ARM(4, vsha1cq_u32, k0, m0, m1, m2, m3);
+    SHA1_ARM(5, vsha1pq_u32, k1, m1, m2, m3, m0);
+    SHA1_ARM(6, vsha1pq_u32, k1, m2, m3, m0, m1);
+    SHA1_ARM(7, vsha1pq_u32, k1, m3, m0, m1, m2);
+    SHA1_ARM(8, vsha1pq_u32, k1, m0, m1, m2, m3);
+    SHA1_ARM(9, vsha1pq_u32, k1, m1, m2, m3, m0);
+    SHA1_ARM(10, vsha1mq_u32, k2, m2, m3, m0, m1);
+    SHA1_ARM(11, vsha1mq_u32, k2, m3, m0, m1, m2);
+    SHA1_ARM(12, vsha1mq_u32, k2, m0, m1, m2, m3);
+    SHA1_ARM(13, vsha1mq_u32, k2, m1, m2, m3, m0);
+    SHA1_ARM(14, vsha1mq_u32, k2, m2, m3, m0, m1);
+    SHA1_ARM(15, vsha1pq_u32, k3, m3, m0, m1, m2);
+    SHA1_ARM(16, vsha1pq_u32, k3, m0, m1, m2, m3);
+    SHA1_ARM(17, vsha1pq_u32, k3, m1, m2, m3, m0);
+    SHA1_ARM(18, vsha1pq_u32, k3, m2, m3, m0, m1);
+    SHA1_ARM(19, vsha1pq_u32, k3, m3, m0, m1, m2);
+    abcd = vaddq_u32(abcd, save);
+    e += save_e;
+  }
+  vst1q_u32(h, abcd);
+  h[4] = e;
+}
+
+
+LHASH_TARGET_CRC
+static uint32_t crc32_arm (uint32_t crc, const uint8_t *p, size_t n) {
+  for (; n >= 32; p += 32, n -= 32) {
+    crc = __crc32d(crc, load64le(p));
+    crc = __crc32d(crc, load64le(p + 8));
+    crc = __crc32d(crc, load64le(p + 16));
+    crc = __crc32d(crc, load64le(p + 24));
+  }
+  for (; n >= 8; p += 8, n -= 8)
+    crc = __crc32d(crc, load64le(p));
+  while (n--)
+    crc = __crc32b(crc, *p++);
+  return crc;
+}
+
+LHASH_TARGET_CRC
+static uint32_t crc32c_arm (uint32_t crc, const uint8_t *p, size_t n) {
+  for (; n >= 32; p += 32, n -= 32) {
+    crc = __crc32cd(crc, load64le(p));
+    crc = __crc32cd(crc, load64le(p + 8));
+    crc = __crc32cd(crc, load64le(p + 16));
+    crc = __crc32cd(crc, load64le(p + 24));
+  }
+  for (; n >= 8; p += 8, n -= 8)
+    crc = __crc32cd(crc, load64le(p));
+  while (n--)
+    crc = __crc32cb(crc, *p++);
+  return crc;
+}
+
+/* }====================================================== */
+#endif
+
+
+/*
+** {======================================================
+** Runtime selection
+** =======================================================
+*/
+
+static struct {
+  lhash_Blocks sha256;
+  lhash_Blocks sha1;
+  lhash_Crc crc32;
+  lhash_Crc crc32c;
+  int features;
+} impl;
+
+static int impl_ready = 0;
+
+/*
+** Idempotent: racing threads compute the same values, and readers only
+** trust 'impl' after seeing 'impl_ready' with acquire ordering.
+*/
+static void lhash_setup (void) {
+  int features = 0;
+  crc_maketab(crc32_tab, 0xedb88320);
+  crc_maketab(crc32c_tab, 0x82f63b78);
+  impl.sha256 = sha256_blocks_c;
+  impl.sha1 = sha1_blocks_c;
+  impl.crc32 = crc32_c;
+  impl.crc32c = crc32c_c;
+#if defined(LHASH_X86)
+  {
+    unsigned int a, b, c, d;
+    int sse41 = 0, ssse3 = 0;
+    if (__get_cpuid(1, &a, &b, &c, &d)) {
+      ssse3 = (c >> 9) & 1;
+      sse41 = (c >> 19) & 1;
+      if ((c >> 20) & 1) {  /* SSE4.2 */
+        impl.crc32c = crc32c_sse42;
+        features |= LHASH_HW_CRC32C;
+      }
+      if (((c >> 1) & 1) && sse41) {  /* PCLMULQDQ */
+        impl.crc32 = crc32_pclmul;
+        features |= LHASH_HW_CRC32;
+      }
+    }
+    if (__get_cpuid_max(0, NULL) >= 7) {
+      __cpuid_count(7, 0, a, b, c, d);
+      if (((b >> 29) & 1) && sse41 && ssse3) {  /* SHA */
+        impl.sha256 = sha256_blocks_shani;
+        impl.sha1 = sha1_blocks_shani;
+        features |= LHASH_HW_SHA256 | LHASH_HW_SHA1;
+      }
+    }
+  }
+#elif defined(LHASH_ARM)
+  {
+    unsigned long hw = getauxval(AT_HWCAP);
+    if (hw & HWCAP_SHA2) {
+      impl.sha256 = sha256_blocks_arm;
+      features |= LHASH_HW_SHA256;
+    }
+    if (hw & HWCAP_SHA1) {
+      impl.sha1 = sha1_blocks_arm;
+      features |= LHASH_HW_SHA1;
+    }
+    if (hw & HWCAP_CRC32) {
+      impl.crc32 = crc32_arm;
+      impl.crc32c = crc32c_arm;
+      features |= LHASH_HW_CRC32 | LHASH_HW_CRC32C;
+    }
+  }
+#endif
+  impl.features = features;
+  __atomic_store_n(&impl_ready, 1, __ATOMIC_RELEASE);
+}
+
+#define lhash_ensure() \
+  { if (!__atomic_load_n(&impl_ready, __ATOMIC_ACQUIRE)) lhash_setup(); }
+
+
+LUALIB_API int lhash_features (void) {
+  lhash_ensure();
+  return impl.features;
+}
+
+/* }====================================================== */
+
+
+/*
+** {======================================================
+** Merkle-Damgard buffering shared by SHA-256, SHA-1 and MD5
+** =======================================================
+*/
+
+static void md_update (uint32_t *h, uint64_t *len, uint8_t *buf,
+                       lhash_Blocks fn, const uint8_t *p, size_t n) {
+  size_t used = (size_t)(*len & (LHASH_BLOCK - 1));
+  *len += n;
+  if (used) {
+    size_t room = LHASH_BLOCK - used;
+    if (n < room) {
+      memcpy(buf + used, p, n);
+      return;
+    }
+    memcpy(buf + used, p, room);
+    fn(h, buf, 1);
+    p += room; n -= room;
+  }
+  if (n >= LHASH_BLOCK) {
+    fn(h, p, n / LHASH_BLOCK);
+    p += n & ~(size_t)(LHASH_BLOCK - 1);
+    n &= LHASH_BLOCK - 1;
+  }
+  if (n)
+    memcpy(buf, p, n);
+}
+
+/* appends 0x80, zeros and the bit length; 'be' selects the length byte order */
+static void md_pad (uint32_t *h, uint64_t len, uint8_t *buf,
+                    lhash_Blocks fn, int be) {
+  size_t used = (size_t)(len & (LHASH_BLOCK - 1));
+  uint64_t bits = len << 3;
+  int i;
+  buf[used++] = 0x80;
+  if (used > LHASH_BLOCK - 8) {
+    memset(buf + used, 0, LHASH_BLOCK - used);
+    fn(h, buf, 1);
+    used = 0;
+  }
+  memset(buf + used, 0, LHASH_BLOCK - 8 - used);
+  for (i = 0; i < 8; i++)
+    buf[LHASH_BLOCK - 8 + i] = (uint8_t)(be ? bits >> (56 - 8 * i) : bits >> (8 * i));
+  fn(h, buf, 1);
+}
+
+/* }====================================================== */
+
+
+LUALIB_API void lhash_sha256_init (lhash_SHA256 *c) {
+  static const uint32_t iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+  memcpy(c->h, iv, sizeof(iv));
+  c->len = 0;
+}
+
+LUALIB_API void lhash_sha256_update (lhash_SHA256 *c, const void *p, size_t n) {
+  lhash_ensure();
+  md_update(c->h, &c->len, c->buf, impl.sha256, (const uint8_t *)p, n);
+}
+
+LUALIB_API void lhash_sha256_final (lhash_SHA256 *c, uint8_t out[LHASH_SHA256_SIZE]) {
+  int i;
+  lhash_ensure();
+  md_pad(c->h, c->len, c->buf, impl.sha256, 1);
+  for (i = 0; i < 8; i++)
+    store32be(out + 4 * i, c->h[i]);
+}
+
+LUALIB_API void lhash_sha256 (const void *p, size_t n, uint8_t out[LHASH_SHA256_SIZE]) {
+  lhash_SHA256 c;
+  lhash_sha256_init(&c);
+  lhash_sha256_update(&c, p, n);
+  lhash_sha256_final(&c, out);
+}
+
+
+LUALIB_API void lhash_sha1_init (lhash_SHA1 *c) {
+  c->h[0] = 0x67452301;
+  c->h[1] = 0xefcdab89;
+  c->h[2] = 0x98badcfe;
+  c->h[3] = 0x10325476;
+  c->h[4] = 0xc3d2e1f0;
+  c->len = 0;
+}
+
+LUALIB_API void lhash_sha1_update (lhash_SHA1 *c, const void *p, size_t n) {
+  lhash_ensure();
+  md_update(c->h, &c->len, c->buf, impl.sha1, (const uint8_t *)p, n);
+}
+
+LUALIB_API void lhash_sha1_final (lhash_SHA1 *c, uint8_t out[LHASH_SHA1_SIZE]) {
+  int i;
+  lhash_ensure();
+  md_pad(c->h, c->len, c->buf, impl.sha1, 1);
+  for (i = 0; i < 5; i++)
+    store32be(out + 4 * i, c->h[i]);
+}
+
+LUALIB_API void lhash_sha1 (const void *p, size_t n, uint8_t out[LHASH_SHA1_SIZE]) {
+  lhash_SHA1 c;
+  lhash_sha1_init(&c);
+  lhash_sha1_update(&c, p, n);
+  lhash_sha1_final(&c, out);
+}
+
+
+LUALIB_API void lhash_md5_init (lhash_MD5 *c) {
+  c->h[0] = 0x67452301;
+  c->h[1] = 0xefcdab89;
+  c->h[2] = 0x98badcfe;
+  c->h[3] = 0x10325476;
+  c->len = 0;
+}
+
+LUALIB_API void lhash_md5_update (lhash_MD5 *c, const void *p, size_t n) {
+  md_update(c->h, &c->len, c->buf, md5_blocks_c, (const uint8_t *)p, n);
+}
+
+LUALIB_API void lhash_md5_final (lhash_MD5 *c, uint8_t out[LHASH_MD5_SIZE]) {
+  int i;
+  md_pad(c->h, c->len, c->buf, md5_blocks_c, 0);
+  for (i = 0; i < 4; i++)
+    store32le(out + 4 * i, c->h[i]);
+}
+
+LUALIB_API void lhash_md5 (const void *p, size_t n, uint8_t out[LHASH_MD5_SIZE]) {
+  lhash_MD5 c;
+  lhash_md5_init(&c);
+  lhash_md5_update(&c, p, n);
+  lhash_md5_final(&c, out);
+}
+
+
+LUALIB_API uint32_t lhash_crc32 (uint32_t crc, const void *p, size_t n) {
+  lhash_ensure();
+  return ~impl.crc32(~crc, (const uint8_t *)p, n);
+}
+
+LUALIB_API uint32_t lhash_crc32c (uint32_t crc, const void *p, size_t n) {
+  lhash_ensure();
+  return ~impl.crc32c(~crc, (const uint8_t *)p, n);
+}
+
+
+/*
+** {======================================================
+** xxHash64
+** =======================================================
+*/
+
+#define XXP1	0x9e3779b185ebca87ULL
+#define XXP2	0xc2b2ae3d27d4eb4fULL
+#define XXP3	0x165667b19e3779f9ULL
+#define XXP4	0x85ebca77c2b2ae63ULL
+#define XXP5	0x27d4eb2f165667c5ULL
+
+static inline uint64_t xxh_round (uint64_t acc, uint64_t in) {
+  acc += in * XXP2;
+  acc = rol64(acc, 31);
+  return acc * XXP1;
+}
+
+static inline uint64_t xxh_merge (uint64_t h, uint64_t v) {
+  h ^= xxh_round(0, v);
+  return h * XXP1 + XXP4;
+}
+
+static const uint8_t *xxh_stripes (uint64_t v[4], const uint8_t *p, size_t n) {
+  uint64_t v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+  for (; n >= 32; p += 32, n -= 32) {
+    v1 = xxh_round(v1, load64le(p));
+    v2 = xxh_round(v2, load64le(p + 8));
+    v3 = xxh_round(v3, load64le(p + 16));
+    v4 = xxh_round(v4, load64le(p + 24));
+  }
+  v[0] = v1; v[1] = v2; v[2] = v3; v[3] = v4;
+  return p;
+}
+
+LUALIB_API void lhash_xxh64_init (lhash_XXH64 *c, uint64_t seed) {
+  c->v[0] = seed + XXP1 + XXP2;
+  c->v[1] = seed + XXP2;
+  c->v[2] = seed;
+  c->v[3] = seed - XXP1;
+  c->len = 0;
+  c->seed = seed;
+}
+
+LUALIB_API void lhash_xxh64_update (lhash_XXH64 *c, const void *data, size_t n) {
+  const uint8_t *p = (const uint8_t *)data;
+  size_t used = (size_t)(c->len & 31);
+  c->len += n;
+  if (used) {
+    size_t room = 32 - used;
+    if (n < room) {
+      memcpy(c->buf + used, p, n);
+      return;
+    }
+    memcpy(c->buf + used, p, room);
+    xxh_stripes(c->v, c->buf, 32);
+    p += room; n -= room;
+  }
+  p = xxh_stripes(c->v, p, n);
+  n &= 31;
+  if (n)
+    memcpy(c->buf, p, n);
+}
+
+LUALIB_API uint64_t lhash_xxh64_digest (const lhash_XXH64 *c) {
+  const uint8_t *p = c->buf;
+  size_t n = (size_t)(c->len & 31);
+  uint64_t h;
+  if (c->len >= 32) {
+    h = rol64(c->v[0], 1) + rol64(c->v[1], 7) + rol64(c->v[2], 12) + rol64(c->v[3], 18);
+    h = xxh_merge(h, c->v[0]);
+    h = xxh_merge(h, c->v[1]);
+    h = xxh_merge(h, c->v[2]);
+    h = xxh_merge(h, c->v[3]);
+  }
+  else
+    h = c->seed + XXP5;
+  h += c->len;
+  for (; n >= 8; p += 8, n -= 8) {
+    h ^= xxh_round(0, load64le(p));
+    h = rol64(h, 27) * XXP1 + XXP4;
+  }
+  if (n >= 4) {
+    h ^= (uint64_t)load32le(p) * XXP1;
+    h = rol64(h, 23) * XXP2 + XXP3;
+    p += 4; n -= 4;
+  }
+  for (; n > 0; p++, n--) {
+    h ^= *p * XXP5;
+    h = rol64(h, 11) * XXP1;
+  }
+  h ^= h >> 33;
+  h *= XXP2;
+  h ^= h >> 29;
+  h *= XXP3;
+  h ^= h >> 32;
+  return h;
+}
+
+LUALIB_API uint64_t lhash_xxh64 (const void *p, size_t n, uint64_t seed) {
+  lhash_XXH64 c;
+  lhash_xxh64_init(&c, seed);
+  lhash_xxh64_update(&c, p, n);
+  return lhash_xxh64_digest(&c);
+}
+
+/* }====================================================== */
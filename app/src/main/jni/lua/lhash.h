@@ -0,0 +1,87 @@
+/*
+** lhash.h
+** Core hash functions: SHA-256, SHA-1, MD5, CRC32, CRC32C, xxHash64
+** All contexts live on the caller's stack; nothing here allocates.
+** SHA and CRC instructions are picked at runtime when the CPU has them.
+*/
+
+#ifndef lhash_h
+#define lhash_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "luaconf.h"
+
+
+#define LHASH_SHA256_SIZE	32
+#define LHASH_SHA1_SIZE		20
+#define LHASH_MD5_SIZE		16
+#define LHASH_BLOCK		64
+
+
+/* shared shape of the Merkle-Damgard contexts */
+typedef struct lhash_SHA256 {
+  uint32_t h[8];
+  uint64_t len;  /* total bytes fed so far */
+  uint8_t buf[LHASH_BLOCK];
+} lhash_SHA256;
+
+typedef struct lhash_SHA1 {
+  uint32_t h[5];
+  uint64_t len;
+  uint8_t buf[LHASH_BLOCK];
+} lhash_SHA1;
+
+typedef struct lhash_MD5 {
+  uint32_t h[4];
+  uint64_t len;
+  uint8_t buf[LHASH_BLOCK];
+} lhash_MD5;
+
+typedef struct lhash_XXH64 {
+  uint64_t v[4];
+  uint64_t len;
+  uint64_t seed;
+  uint8_t buf[32];
+} lhash_XXH64;
+
+
+LUALIB_API void lhash_sha256_init (lhash_SHA256 *c);
+LUALIB_API void lhash_sha256_update (lhash_SHA256 *c, const void *p, size_t n);
+LUALIB_API void lhash_sha256_final (lhash_SHA256 *c, uint8_t out[LHASH_SHA256_SIZE]);
+LUALIB_API void lhash_sha256 (const void *p, size_t n, uint8_t out[LHASH_SHA256_SIZE]);
+
+LUALIB_API void lhash_sha1_init (lhash_SHA1 *c);
+LUALIB_API void lhash_sha1_update (lhash_SHA1 *c, const void *p, size_t n);
+LUALIB_API void lhash_sha1_final (lhash_SHA1 *c, uint8_t out[LHASH_SHA1_SIZE]);
+LUALIB_API void lhash_sha1 (const void *p, size_t n, uint8_t out[LHASH_SHA1_SIZE]);
+
+LUALIB_API void lhash_md5_init (lhash_MD5 *c);
+LUALIB_API void lhash_md5_update (lhash_MD5 *c, const void *p, size_t n);
+LUALIB_API void lhash_md5_final (lhash_MD5 *c, uint8_t out[LHASH_MD5_SIZE]);
+LUALIB_API void lhash_md5 (const void *p, size_t n, uint8_t out[LHASH_MD5_SIZE]);
+
+/*
+** CRCs use the zlib convention: start from 0 and pass the previous
+** result back in to continue.
+*/
+LUALIB_API uint32_t lhash_crc32 (uint32_t crc, const void *p, size_t n);
+LUALIB_API uint32_t lhash_crc32c (uint32_t crc, const void *p, size_t n);
+
+LUALIB_API void lhash_xxh64_init (lhash_XXH64 *c, uint64_t seed);
+LUALIB_API void lhash_xxh64_update (lhash_XXH64 *c, const void *p, size_t n);
+/* does not modify the context, so more data may follow */
+LUALIB_API uint64_t lhash_xxh64_digest (const lhash_XXH64 *c);
+LUALIB_API uint64_t lhash_xxh64 (const void *p, size_t n, uint64_t seed);
+
+
+/* bits of lhash_features() */
+#define LHASH_HW_SHA256	1
+#define LHASH_HW_SHA1	2
+#define LHASH_HW_CRC32	4
+#define LHASH_HW_CRC32C	8
+
+LUALIB_API int lhash_features (void);
+
+#endif
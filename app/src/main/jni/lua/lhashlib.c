@@ -0,0 +1,325 @@
+/*
+** lhashlib.c
+** Lua binding for the core hash functions in lhash.c
+**
+**   hash.sha256(s [, raw])   hash.sha1(s [, raw])   hash.md5(s [, raw])
+**   hash.crc32(s [, crc])    hash.crc32c(s [, crc]) hash.xxh64(s [, seed])
+**   hash.new(alg [, seed])   -> h; h:update(s|file), h:digest([raw]), h:reset()
+**   hash.file(alg, path|file [, raw])
+**   hash.features()
+**
+** Digests are lowercase hex unless 'raw' is true; CRCs and xxh64 are
+** integers. Files are read in fixed chunks through a stack buffer.
+*/
+
+#define lhashlib_c
+#define LUA_LIB
+
+#include "lprefix.h"
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lua.h"
+
+#include "lauxlib.h"
+#include "lualib.h"
+
+#include "lhash.h"
+
+
+#define HASH_TYPE	"hash.Hash"
+
+#define HASH_CHUNK	16384
+
+
+enum { H_SHA256, H_SHA1, H_MD5, H_CRC32, H_CRC32C, H_XXH64 };
+
+static const char *const algnames[] = {
+  "sha256", "sha1", "md5", "crc32", "crc32c", "xxh64", NULL
+};
+
+typedef struct Hash {
+  int alg;
+  uint64_t seed;
+  union {
+    lhash_SHA256 sha256;
+    lhash_SHA1 sha1;
+    lhash_MD5 md5;
+    lhash_XXH64 xxh64;
+    uint32_t crc;
+  } u;
+} Hash;
+
+
+static void hash_init (Hash *h, int alg, uint64_t seed) {
+  h->alg = alg;
+  h->seed = seed;
+  switch (alg) {
+    case H_SHA256: lhash_sha256_init(&h->u.sha256); break;
+    case H_SHA1: lhash_sha1_init(&h->u.sha1); break;
+    case H_MD5: lhash_md5_init(&h->u.md5); break;
+    case H_XXH64: lhash_xxh64_init(&h->u.xxh64, seed); break;
+    default: h->u.crc = (uint32_t)seed; break;
+  }
+}
+
+
+static void hash_update (Hash *h, const void *p, size_t n) {
+  switch (h->alg) {
+    case H_SHA256: lhash_sha256_update(&h->u.sha256, p, n); break;
+    case H_SHA1: lhash_sha1_update(&h->u.sha1, p, n); break;
+    case H_MD5: lhash_md5_update(&h->u.md5, p, n); break;
+    case H_CRC32: h->u.crc = lhash_crc32(h->u.crc, p, n); break;
+    case H_CRC32C: h->u.crc = lhash_crc32c(h->u.crc, p, n); break;
+    case H_XXH64: lhash_xxh64_update(&h->u.xxh64, p, n); break;
+  }
+}
+
+
+static void pushdigest (lua_State *L, const uint8_t *d, size_t n, int raw) {
+  static const char digits[] = "0123456789abcdef";
+  char hex[2 * LHASH_SHA256_SIZE];
+  size_t i;
+  if (raw) {
+    lua_pushlstring(L, (const char *)d, n);
+    return;
+  }
+  for (i = 0; i < n; i++) {
+    hex[2 * i] = digits[d[i] >> 4];
+    hex[2 * i + 1] = digits[d[i] & 15];
+  }
+  lua_pushlstring(L, hex, 2 * n);
+}
+
+
+/* finalizes a copy, so 'h' can keep absorbing data */
+static int hash_push (lua_State *L, const Hash *h, int raw) {
+  Hash c = *h;
+  uint8_t d[LHASH_SHA256_SIZE];
+  switch (c.alg) {
+    case H_SHA256:
+      lhash_sha256_final(&c.u.sha256, d);
+      pushdigest(L, d, LHASH_SHA256_SIZE, raw);
+      break;
+    case H_SHA1:
+      lhash_sha1_final(&c.u.sha1, d);
+      pushdigest(L, d, LHASH_SHA1_SIZE, raw);
+      break;
+    case H_MD5:
+      lhash_md5_final(&c.u.md5, d);
+      pushdigest(L, d, LHASH_MD5_SIZE, raw);
+      break;
+    case H_XXH64:
+      lua_pushinteger(L, (lua_Integer)lhash_xxh64_digest(&c.u.xxh64));
+      break;
+    default:
+      lua_pushinteger(L, (lua_Integer)c.u.crc);
+      break;
+  }
+  return 1;
+}
+
+
+/* reads 'f' to end of file; returns 0 on a read error */
+static int hash_feedfile (Hash *h, FILE *f) {
+  char buf[HASH_CHUNK];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    hash_update(h, buf, n);
+  return !ferror(f);
+}
+
+
+static FILE *tofile (lua_State *L, int arg) {
+  luaL_Stream *p = (luaL_Stream *)luaL_testudata(L, arg, LUA_FILEHANDLE);
+  if (p == NULL)
+    return NULL;
+  if (p->closef == NULL)
+    luaL_error(L, "attempt to use a closed file");
+  return p->f;
+}
+
+
+static int oneshot (lua_State *L, int alg) {
+  size_t n;
+  const char *s = luaL_checklstring(L, 1, &n);
+  uint8_t d[LHASH_SHA256_SIZE];
+  switch (alg) {
+    case H_SHA256:
+      lhash_sha256(s, n, d);
+      pushdigest(L, d, LHASH_SHA256_SIZE, lua_toboolean(L, 2));
+      break;
+    case H_SHA1:
+      lhash_sha1(s, n, d);
+      pushdigest(L, d, LHASH_SHA1_SIZE, lua_toboolean(L, 2));
+      break;
+    case H_MD5:
+      lhash_md5(s, n, d);
+      pushdigest(L, d, LHASH_MD5_SIZE, lua_toboolean(L, 2));
+      break;
+    case H_CRC32:
+      lua_pushinteger(L, lhash_crc32((uint32_t)luaL_optinteger(L, 2, 0), s, n));
+      break;
+    case H_CRC32C:
+      lua_pushinteger(L, lhash_crc32c((uint32_t)luaL_optinteger(L, 2, 0), s, n));
+      break;
+    case H_XXH64:
+      lua_pushinteger(L, (lua_Integer)lhash_xxh64(s, n,
+                         (uint64_t)luaL_optinteger(L, 2, 0)));
+      break;
+  }
+  return 1;
+}
+
+static int hash_sha256 (lua_State *L) { return oneshot(L, H_SHA256); }
+static int hash_sha1 (lua_State *L) { return oneshot(L, H_SHA1); }
+static int hash_md5 (lua_State *L) { return oneshot(L, H_MD5); }
+static int hash_crc32 (lua_State *L) { return oneshot(L, H_CRC32); }
+static int hash_crc32c (lua_State *L) { return oneshot(L, H_CRC32C); }
+static int hash_xxh64 (lua_State *L) { return oneshot(L, H_XXH64); }
+
+
+static int hash_new (lua_State *L) {
+  int alg = luaL_checkoption(L, 1, NULL, algnames);
+  uint64_t seed = (uint64_t)luaL_optinteger(L, 2, 0);
+  Hash *h = (Hash *)lua_newuserdatauv(L, sizeof(Hash), 0);
+  hash_init(h, alg, seed);
+  luaL_setmetatable(L, HASH_TYPE);
+  return 1;
+}
+
+
+static int hash_file (lua_State *L) {
+  int alg = luaL_checkoption(L, 1, NULL, algnames);
+  Hash h;
+  FILE *f = tofile(L, 2);
+  hash_init(&h, alg, 0);
+  if (f != NULL) {
+    if (!hash_feedfile(&h, f))
+      return luaL_fileresult(L, 0, NULL);
+  }
+  else {
+    const char *path = luaL_checkstring(L, 2);
+    int ok, en;
+    f = fopen(path, "rb");
+    if (f == NULL)
+      return luaL_fileresult(L, 0, path);
+    ok = hash_feedfile(&h, f);
+    en = errno;
+    fclose(f);
+    if (!ok) {
+      errno = en;
+      return luaL_fileresult(L, 0, path);
+    }
+  }
+  return hash_push(L, &h, lua_toboolean(L, 3));
+}
+
+
+static int hash_features (lua_State *L) {
+  int f = lhash_features();
+  lua_createtable(L, 0, 4);
+  lua_pushboolean(L, f & LHASH_HW_SHA256);
+  lua_setfield(L, -2, "sha256");
+  lua_pushboolean(L, f & LHASH_HW_SHA1);
+  lua_setfield(L, -2, "sha1");
+  lua_pushboolean(L, f & LHASH_HW_CRC32);
+  lua_setfield(L, -2, "crc32");
+  lua_pushboolean(L, f & LHASH_HW_CRC32C);
+  lua_setfield(L, -2, "crc32c");
+  return 1;
+}
+
+
+/*
+** {======================================================
+** Hash objects
+** =======================================================
+*/
+
+#define tohash(L)	((Hash *)luaL_checkudata(L, 1, HASH_TYPE))
+
+
+static int h_update (lua_State *L) {
+  Hash *h = tohash(L);
+  int i, top = lua_gettop(L);
+  for (i = 2; i <= top; i++) {
+    FILE *f = tofile(L, i);
+    if (f != NULL) {
+      if (!hash_feedfile(h, f))
+        return luaL_fileresult(L, 0, NULL);
+    }
+    else {
+      size_t n;
+      const char *s = luaL_checklstring(L, i, &n);
+      hash_update(h, s, n);
+    }
+  }
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+static int h_digest (lua_State *L) {
+  Hash *h = tohash(L);
+  return hash_push(L, h, lua_toboolean(L, 2));
+}
+
+
+static int h_reset (lua_State *L) {
+  Hash *h = tohash(L);
+  hash_init(h, h->alg, h->seed);
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+static int h_tostring (lua_State *L) {
+  Hash *h = tohash(L);
+  lua_pushfstring(L, "hash.%s: %p", algnames[h->alg], (void *)h);
+  return 1;
+}
+
+
+static const luaL_Reg hash_methods[] = {
+  {"update", h_update},
+  {"digest", h_digest},
+  {"reset", h_reset},
+  {NULL, NULL}
+};
+
+static const luaL_Reg hash_meta[] = {
+  {"__index", NULL},  /* placeholder */
+  {"__tostring", h_tostring},
+  {NULL, NULL}
+};
+
+/* }====================================================== */
+
+
+static const luaL_Reg hashlib[] = {
+  {"sha256", hash_sha256},
+  {"sha1", hash_sha1},
+  {"md5", hash_md5},
+  {"crc32", hash_crc32},
+  {"crc32c", hash_crc32c},
+  {"xxh64", hash_xxh64},
+  {"new", hash_new},
+  {"file", hash_file},
+  {"features", hash_features},
+  {NULL, NULL}
+};
+
+
+LUAMOD_API int luaopen_hash (lua_State *L) {
+  luaL_newmetatable(L, HASH_TYPE);
+  luaL_setfuncs(L, hash_meta, 0);
+  luaL_newlib(L, hash_methods);
+  lua_setfield(L, -2, "__index");
+  lua_pop(L, 1);
+  luaL_newlib(L, hashlib);
+  return 1;
+}
@@ -73,6 +73,9 @@ static const luaL_Reg stdlibs[] = {
   {"translator", luaopen_translator},
   {"libc", luaopen_libc},
   {"logtable", luaopen_logtable},
+  {LUA_HASHLIBNAME, luaopen_hash},
+  {LUA_AESLIBNAME, luaopen_aes},
+  {LUA_JITLIBNAME, luaopen_jit},
 
   {NULL, NULL}
 };
@@ -118,6 +121,9 @@ static const luaL_Reg loadedlibs[] = {
   {LUA_DBLIBNAME, luaopen_debug},
   {LUA_BITLIBNAME, luaopen_bit},
   {LUA_PTRLIBNAME, luaopen_ptr},
+  {LUA_HASHLIBNAME, luaopen_hash},
+  {LUA_AESLIBNAME, luaopen_aes},
+  {LUA_JITLIBNAME, luaopen_jit},
 #ifndef _WIN32
   {LUA_SMGRNAME, luaopen_smgr},
   {"translator", luaopen_translator},
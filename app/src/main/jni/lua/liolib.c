@@ -680,7 +680,9 @@ static int g_write (lua_State *L, FILE *f, int arg) {
     }
     else {
       size_t l;
-      const char *s = luaL_checklstring(L, arg, &l);
+      const char *s = luaL_tobuffer(L, arg, &l);  /* string buffer? */
+      if (s == NULL)
+        s = luaL_checklstring(L, arg, &l);
       status = status && (fwrite(s, sizeof(char), l, f) == l);
     }
   }
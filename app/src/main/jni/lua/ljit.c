@@ -0,0 +1,1313 @@
+/*
+** $Id: ljit.c $
+** Baseline JIT: native code stitched from per-opcode templates
+** See Copyright Notice in lua.h
+*/
+
+#define ljit_c
+#define LUA_CORE
+
+#include "lprefix.h"
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lua.h"
+
+#include "ldebug.h"
+#include "ljit.h"
+#include "lobject.h"
+#include "lopcodes.h"
+#include "lstate.h"
+
+
+/*
+** The compiler translates a prototype instruction by instruction. For
+** each instruction with a template (see 'luaV_jitop'), the native code
+** calls the template and then compares the instruction it returns with
+** the few that can follow it in the bytecode (the next instruction,
+** jump targets, the instruction after a skipped one); each of them is
+** a direct native jump. Any other result, or an instruction without a
+** template, leaves the native code and gives the instruction back to
+** the interpreter, so the interpreter can resume at any instruction.
+** Templates mark a result with 'jitexit' (low bit set) to force such
+** an exit, e.g., when a hook was set.
+**
+** Native code and its tables live outside the Lua allocator, so that
+** compiling a function never raises errors: when anything fails, the
+** function just stays interpreted.
+*/
+
+
+void luaJ_init (lua_State *L) {
+  global_State *g = G(L);
+  g->jiton = 0;  /* off until 'jit.on' */
+  g->jitthreshold = LUAI_JITTHRESHOLD;
+  memset(&g->jitstats, 0, sizeof(g->jitstats));
+  g->jitdead = NULL;
+  g->jitframe = NULL;
+}
+
+
+#if defined(LUA_USE_JIT)
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+/* native code of a function: 'entry(J, start)' runs from 'start' */
+typedef const Instruction *(*JitEntry) (JitFrame *J, void *start);
+
+
+/*
+** Code buffer. The first pass runs with 'buf' NULL only to measure the
+** code and find its labels; the second one writes it. Every instruction
+** has a fixed size, so both passes agree.
+*/
+typedef struct Emitter {
+  unsigned char *buf;
+  size_t pos;
+} Emitter;
+
+
+static void emitbytes (Emitter *e, const void *b, size_t n) {
+  if (e->buf != NULL)
+    memcpy(e->buf + e->pos, b, n);
+  e->pos += n;
+}
+
+
+/* offsets from the base of the value and of the tag of register 'r' */
+#define valoffset(r)	(cast_sizet(r) * sizeof(StackValue))
+#define tagoffset(r)	(valoffset(r) + offsetof(TValue, tt_))
+
+/* operations of 'genarith'/'genfarith' and conditions of 'gencmp' */
+enum { JA_ADD, JA_SUB, JA_MUL, JA_DIV };
+enum { JC_EQ, JC_NE, JC_LT, JC_LE, JC_GT, JC_GE };
+
+
+/*
+** {==================================================================
+** x86-64 (System V ABI)
+** ===================================================================
+*/
+#if defined(__x86_64__)
+
+#define JIT_ARCH	"x64"
+
+/* largest native function the branches can address */
+#define MAXMCODE	((size_t)0x7fffffff)
+
+
+static void emit8 (Emitter *e, int b) {
+  unsigned char c = cast(unsigned char, b);
+  emitbytes(e, &c, 1);
+}
+
+
+static void emit32 (Emitter *e, l_uint32 v) {
+  unsigned char b[4];
+  int i;
+  for (i = 0; i < 4; i++) b[i] = cast(unsigned char, v >> (8 * i));
+  emitbytes(e, b, 4);
+}
+
+
+static void emit64 (Emitter *e, L_P2I v) {
+  l_uint64 u = cast(l_uint64, v);
+  unsigned char b[8];
+  int i;
+  for (i = 0; i < 8; i++) b[i] = cast(unsigned char, u >> (8 * i));
+  emitbytes(e, b, 8);
+}
+
+
+/* mov reg, imm64 ('reg' is the register number, 0-7) */
+static void genmovimm (Emitter *e, int reg, L_P2I v) {
+  emit8(e, 0x48); emit8(e, 0xb8 + reg);
+  emit64(e, v);
+}
+
+
+/* relative 32-bit displacement to 'label' from the end of the field */
+static void genrel32 (Emitter *e, size_t label) {
+  emit32(e, cast(l_uint32, label - (e->pos + 4)));  /* modulo 2^32 */
+}
+
+
+/*
+** Registers: rbx (callee saved) keeps the frame and r12 (callee saved)
+** the base of the function; rax and rcx are scratch ('t' 0 and 1).
+*/
+
+/* r12 = frame->ci->func.p + 1 */
+static void genloadbase (Emitter *e) {
+  emit8(e, 0x48); emit8(e, 0x8b); emit8(e, 0x8b);  /* mov rcx, [rbx+d] */
+  emit32(e, offsetof(JitFrame, ci));
+  emit8(e, 0x4c); emit8(e, 0x8b); emit8(e, 0xa1);  /* mov r12, [rcx+d] */
+  emit32(e, offsetof(CallInfo, func));
+  emit8(e, 0x49); emit8(e, 0x83); emit8(e, 0xc4);  /* add r12, imm8 */
+  emit8(e, sizeof(StackValue));
+}
+
+
+/*
+** Entry: save the registers, load the base and jump to 'start'. The
+** three pushes keep the stack aligned for the template calls.
+*/
+static void genprologue (Emitter *e) {
+  static const unsigned char code[] = {
+    0x55,  /* push rbp */
+    0x53,  /* push rbx */
+    0x41, 0x54,  /* push r12 */
+    0x48, 0x89, 0xfb  /* mov rbx, rdi */
+  };
+  emitbytes(e, code, sizeof(code));
+  genloadbase(e);
+  emit8(e, 0xff); emit8(e, 0xe6);  /* jmp rsi */
+}
+
+
+/* return the next instruction, which is in rax */
+static void genepilogue (Emitter *e) {
+  static const unsigned char code[] = {
+    0x41, 0x5c,  /* pop r12 */
+    0x5b,  /* pop rbx */
+    0x5d,  /* pop rbp */
+    0xc3  /* ret */
+  };
+  emitbytes(e, code, sizeof(code));
+}
+
+
+/* rax = f(frame, i, next) */
+static void gencall (Emitter *e, JitOp f, Instruction i,
+                     const Instruction *next) {
+  emit8(e, 0x48); emit8(e, 0x89); emit8(e, 0xdf);  /* mov rdi, rbx */
+  genmovimm(e, 6, cast(L_P2I, i));  /* rsi */
+  genmovimm(e, 2, cast(L_P2I, next));  /* rdx */
+  genmovimm(e, 0, cast(L_P2I, f));  /* rax */
+  emit8(e, 0xff); emit8(e, 0xd0);  /* call rax */
+}
+
+
+/* if rax == 'target', jump to 'label' (or, if 'neg', when it differs) */
+static void genbranch (Emitter *e, const Instruction *target, size_t label,
+                       int neg) {
+  genmovimm(e, 1, cast(L_P2I, target));  /* rcx */
+  emit8(e, 0x48); emit8(e, 0x39); emit8(e, 0xc8);  /* cmp rax, rcx */
+  emit8(e, 0x0f); emit8(e, neg ? 0x85 : 0x84);  /* jne/je rel32 */
+  genrel32(e, label);
+}
+
+
+static void genjump (Emitter *e, size_t label) {
+  emit8(e, 0xe9);  /* jmp rel32 */
+  genrel32(e, label);
+}
+
+
+/* leave the native code to run instruction 'pc' in the interpreter */
+static void genexit (Emitter *e, const Instruction *pc, size_t label) {
+  genmovimm(e, 0, cast(L_P2I, pc));  /* rax */
+  genjump(e, label);
+}
+
+
+/*
+** Inline code works with scratch registers rax, rcx and rdx ('t' 0 to
+** 2) and xmm0 and xmm1 ('f' 0 and 1).
+*/
+
+/* t = 'v' */
+#define genloadimm(e,t,v)	genmovimm(e, t, v)
+
+
+/* 'op' with register 't' and memory operand [r12 + 'd'] */
+static void genmem (Emitter *e, int rex, int op, int t, size_t d) {
+  emit8(e, rex);
+  if (op > 0xff) emit8(e, op >> 8);
+  emit8(e, op & 0xff);
+  emit8(e, 0x84 | (t << 3)); emit8(e, 0x24);  /* [r12 + disp32] */
+  emit32(e, cast(l_uint32, d));
+}
+
+
+/* 'op' with register 't' and memory operand [register 's' + 'd'] */
+static void genmemreg (Emitter *e, int rex, int op, int t, int s,
+                       size_t d) {
+  if (rex != 0) emit8(e, rex);
+  if (op > 0xff) emit8(e, op >> 8);
+  emit8(e, op & 0xff);
+  emit8(e, 0x80 | (t << 3) | s);  /* [s + disp32] */
+  emit32(e, cast(l_uint32, d));
+}
+
+
+/* t = value of R[r] */
+static void genldval (Emitter *e, int t, int r) {
+  genmem(e, 0x49, 0x8b, t, valoffset(r));  /* mov */
+}
+
+
+/* value of R[r] = t */
+static void genstval (Emitter *e, int t, int r) {
+  genmem(e, 0x49, 0x89, t, valoffset(r));  /* mov */
+}
+
+
+/* f = value of R[r] (a float) */
+static void genldfval (Emitter *e, int f, int r) {
+  emit8(e, 0xf2);
+  genmem(e, 0x41, 0x0f10, f, valoffset(r));  /* movsd */
+}
+
+
+/* value of R[r] = f */
+static void genstfval (Emitter *e, int f, int r) {
+  emit8(e, 0xf2);
+  genmem(e, 0x41, 0x0f11, f, valoffset(r));  /* movsd */
+}
+
+
+/* tag of R[r] = 'tag' */
+static void gensettag (Emitter *e, int r, int tag) {
+  genmem(e, 0x41, 0xc6, 0, tagoffset(r));  /* mov byte */
+  emit8(e, tag);
+}
+
+
+/* t = tag of R[r] */
+static void genldtag (Emitter *e, int t, int r) {
+  genmem(e, 0x41, 0x0fb6, t, tagoffset(r));  /* movzx */
+}
+
+
+/* tag of R[r] = t */
+static void gensttag (Emitter *e, int t, int r) {
+  genmem(e, 0x41, 0x88, t, tagoffset(r));  /* mov byte */
+}
+
+
+/* if the tag of R[r] is not 'tag', jump to 'label' */
+static void genguard (Emitter *e, int r, int tag, size_t label) {
+  genmem(e, 0x41, 0x80, 7, tagoffset(r));  /* cmp byte */
+  emit8(e, tag);
+  emit8(e, 0x0f); emit8(e, 0x85);  /* jne rel32 */
+  genrel32(e, label);
+}
+
+
+/* t = 64-bit word at [register 's' + 'd'] */
+static void genload (Emitter *e, int t, int s, size_t d) {
+  genmemreg(e, 0x48, 0x8b, t, s, d);  /* mov */
+}
+
+
+/* t = byte at [register 's' + 'd'] */
+static void genloadb (Emitter *e, int t, int s, size_t d) {
+  genmemreg(e, 0, 0x0fb6, t, s, d);  /* movzx */
+}
+
+
+/* 64-bit word at [register 's' + 'd'] = t */
+static void genstore (Emitter *e, int t, int s, size_t d) {
+  genmemreg(e, 0x48, 0x89, t, s, d);  /* mov */
+}
+
+
+/* byte at [register 's' + 'd'] = t */
+static void genstoreb (Emitter *e, int t, int s, size_t d) {
+  genmemreg(e, 0, 0x88, t, s, d);  /* mov */
+}
+
+
+/* t = field at offset 'd' of the frame */
+static void genloadframe (Emitter *e, int t, size_t d) {
+  genmemreg(e, 0x48, 0x8b, t, 3, d);  /* mov t, [rbx + d] */
+}
+
+
+/* t += 'v' */
+static void genaddimm (Emitter *e, int t, size_t v) {
+  emit8(e, 0x48); emit8(e, 0x81); emit8(e, 0xc0 | t);  /* add t, imm32 */
+  emit32(e, cast(l_uint32, v));
+}
+
+
+/* t0 = t0 'op' t1 */
+static void genarith (Emitter *e, int op) {
+  switch (op) {
+    case JA_ADD: emit8(e, 0x48); emit8(e, 0x01); emit8(e, 0xc8); break;
+    case JA_SUB: emit8(e, 0x48); emit8(e, 0x29); emit8(e, 0xc8); break;
+    default: emit8(e, 0x48); emit8(e, 0x0f); emit8(e, 0xaf);  /* imul */
+             emit8(e, 0xc1); break;
+  }
+}
+
+
+/* f0 = f0 'op' f1 */
+static void genfarith (Emitter *e, int op) {
+  static const unsigned char code[] = {  /* order of JA_* */
+    0x58, 0x5c, 0x59, 0x5e  /* addsd, subsd, mulsd, divsd */
+  };
+  emit8(e, 0xf2); emit8(e, 0x0f); emit8(e, code[op]);
+  emit8(e, 0xc1);  /* xmm0, xmm1 */
+}
+
+
+/* f = bits of t */
+static void genmovf (Emitter *e, int f, int t) {
+  emit8(e, 0x66); emit8(e, 0x48); emit8(e, 0x0f); emit8(e, 0x6e);  /* movq */
+  emit8(e, 0xc0 | (f << 3) | t);
+}
+
+
+static void genjcc (Emitter *e, int cond, size_t label) {
+  static const unsigned char jcc[] = {  /* order of JC_* */
+    0x84, 0x85, 0x8c, 0x8e, 0x8f, 0x8d
+  };
+  emit8(e, 0x0f); emit8(e, jcc[cond]);
+  genrel32(e, label);
+}
+
+
+/* if 'ta' 'cond' 'tb' (signed), jump to 'label' */
+static void gencmp (Emitter *e, int ta, int tb, int cond, size_t label) {
+  emit8(e, 0x48); emit8(e, 0x39); emit8(e, 0xc0 | (tb << 3) | ta);  /* cmp */
+  genjcc(e, cond, label);
+}
+
+
+/* if t 'cond' 'v' (a small constant), jump to 'label' */
+static void gencmpimm (Emitter *e, int t, int v, int cond, size_t label) {
+  emit8(e, 0x48); emit8(e, 0x83); emit8(e, 0xf8 | t);  /* cmp t, imm8 */
+  emit8(e, v);
+  genjcc(e, cond, label);
+}
+
+
+/* if 't & mask' is zero (or, if not 'iszero', non zero), jump to 'label' */
+static void genmaskjump (Emitter *e, int t, int mask, int iszero,
+                         size_t label) {
+  emit8(e, 0xf6); emit8(e, 0xc0 | t); emit8(e, mask);  /* test t8, imm8 */
+  genjcc(e, iszero ? JC_EQ : JC_NE, label);
+}
+
+
+/*
+** Backward jump to instruction 'target' (at 'label'), unless the
+** interpreter must take over (e.g., a hook was set): then leave.
+*/
+static void genbackedge (Emitter *e, const Instruction *target,
+                         size_t label, size_t exitlabel) {
+  genloadframe(e, 1, offsetof(JitFrame, ci));
+  emit8(e, 0x83); emit8(e, 0xb9);  /* cmp dword [rcx+d], 0 */
+  emit32(e, offsetof(CallInfo, u.l.trap)); emit8(e, 0);
+  emit8(e, 0x75); emit8(e, 5);  /* jne over the next jump */
+  genjump(e, label);
+  genexit(e, target, exitlabel);
+}
+
+/* }================================================================== */
+
+
+/*
+** {==================================================================
+** arm64 (AAPCS64)
+** ===================================================================
+*/
+#elif defined(__aarch64__)
+
+#define JIT_ARCH	"arm64"
+
+/* conditional branches reach +-1MB */
+#define MAXMCODE	((size_t)1 << 20)
+
+
+static void emitins (Emitter *e, l_uint32 ins) {
+  unsigned char b[4];
+  int i;
+  for (i = 0; i < 4; i++) b[i] = cast(unsigned char, ins >> (8 * i));
+  emitbytes(e, b, 4);
+}
+
+
+/* movz/movk xreg, v (always four instructions) */
+static void genmovimm (Emitter *e, int reg, L_P2I v) {
+  l_uint64 u = cast(l_uint64, v);
+  int hw;
+  for (hw = 0; hw < 4; hw++) {
+    l_uint32 op = (hw == 0) ? 0xd2800000u : 0xf2800000u;  /* movz : movk */
+    emitins(e, op | (cast(l_uint32, hw) << 21) |
+               (cast(l_uint32, (u >> (16 * hw)) & 0xffff) << 5) |
+               cast(l_uint32, reg));
+  }
+}
+
+
+/* word offset to 'label' from the current instruction (modulo 2^32) */
+static l_uint32 wordoffset (Emitter *e, size_t label) {
+  return cast(l_uint32, (label >> 2) - (e->pos >> 2));
+}
+
+
+/*
+** Registers: x19 (callee saved) keeps the frame and x20 (callee saved)
+** the base of the function; x9 and x10 are scratch ('t' 0 and 1), as
+** are x11 and x16.
+*/
+
+/* ldr/str/ldrb/strb 'rt', ['rn' + 'd'] ('op' has the scale 'sh') */
+static void genldst (Emitter *e, l_uint32 op, int sh, int rt, int rn,
+                     size_t d) {
+  emitins(e, op | (cast(l_uint32, d >> sh) << 10) |
+             (cast(l_uint32, rn) << 5) | cast(l_uint32, rt));
+}
+
+#define LDRX	0xf9400000u
+#define STRX	0xf9000000u
+#define LDRW	0xb9400000u
+#define LDRB	0x39400000u
+#define STRB	0x39000000u
+
+
+/* x20 = frame->ci->func.p + 1 */
+static void genloadbase (Emitter *e) {
+  genldst(e, LDRX, 3, 11, 19, offsetof(JitFrame, ci));
+  genldst(e, LDRX, 3, 20, 11, offsetof(CallInfo, func));
+  emitins(e, 0x91000294u | (sizeof(StackValue) << 10));  /* add x20, x20, #n */
+}
+
+
+/* entry: save the registers, load the base and jump to 'start' */
+static void genprologue (Emitter *e) {
+  emitins(e, 0xa9be7bfd);  /* stp x29, x30, [sp, #-32]! */
+  emitins(e, 0x910003fd);  /* mov x29, sp */
+  emitins(e, 0xa90153f3);  /* stp x19, x20, [sp, #16] */
+  emitins(e, 0xaa0003f3);  /* mov x19, x0 */
+  genloadbase(e);
+  emitins(e, 0xd61f0020);  /* br x1 */
+}
+
+
+/* return the next instruction, which is in x0 */
+static void genepilogue (Emitter *e) {
+  emitins(e, 0xa94153f3);  /* ldp x19, x20, [sp, #16] */
+  emitins(e, 0xa8c27bfd);  /* ldp x29, x30, [sp], #32 */
+  emitins(e, 0xd65f03c0);  /* ret */
+}
+
+
+/* x0 = f(frame, i, next) */
+static void gencall (Emitter *e, JitOp f, Instruction i,
+                     const Instruction *next) {
+  emitins(e, 0xaa1303e0);  /* mov x0, x19 */
+  genmovimm(e, 1, cast(L_P2I, i));
+  genmovimm(e, 2, cast(L_P2I, next));
+  genmovimm(e, 16, cast(L_P2I, f));
+  emitins(e, 0xd63f0200);  /* blr x16 */
+}
+
+
+/* if x0 == 'target', branch to 'label' (or, if 'neg', when it differs) */
+static void genbranch (Emitter *e, const Instruction *target, size_t label,
+                       int neg) {
+  genmovimm(e, 9, cast(L_P2I, target));
+  emitins(e, 0xeb09001f);  /* cmp x0, x9 */
+  emitins(e, 0x54000000 | ((wordoffset(e, label) & 0x7ffff) << 5) |
+             (neg ? 1 : 0));  /* b.ne/b.eq */
+}
+
+
+static void genjump (Emitter *e, size_t label) {
+  emitins(e, 0x14000000 | (wordoffset(e, label) & 0x3ffffff));  /* b */
+}
+
+
+/* leave the native code to run instruction 'pc' in the interpreter */
+static void genexit (Emitter *e, const Instruction *pc, size_t label) {
+  genmovimm(e, 0, cast(L_P2I, pc));
+  genjump(e, label);
+}
+
+
+/*
+** Inline code works with scratch registers x9, x10 and x11 ('t' 0 to 2),
+** x16, and d0 and d1 ('f' 0 and 1).
+*/
+
+#define XT(t)	((t) + 9)
+
+/* t = 'v' */
+#define genloadimm(e,t,v)	genmovimm(e, XT(t), v)
+
+#define LDRD	0xfd400000u
+#define STRD	0xfd000000u
+
+
+/* b.'cond' to 'label' */
+static void genbcond (Emitter *e, int cond, size_t label) {
+  emitins(e, 0x54000000 | ((wordoffset(e, label) & 0x7ffff) << 5) |
+             cast(l_uint32, cond));
+}
+
+
+static void genjcc (Emitter *e, int cond, size_t label) {
+  static const unsigned char cc[] = {  /* order of JC_* */
+    0x0, 0x1, 0xb, 0xd, 0xc, 0xa  /* eq, ne, lt, le, gt, ge */
+  };
+  genbcond(e, cc[cond], label);
+}
+
+
+/* t = value of R[r] */
+static void genldval (Emitter *e, int t, int r) {
+  genldst(e, LDRX, 3, XT(t), 20, valoffset(r));
+}
+
+
+/* value of R[r] = t */
+static void genstval (Emitter *e, int t, int r) {
+  genldst(e, STRX, 3, XT(t), 20, valoffset(r));
+}
+
+
+/* f = value of R[r] (a float) */
+static void genldfval (Emitter *e, int f, int r) {
+  genldst(e, LDRD, 3, f, 20, valoffset(r));
+}
+
+
+/* value of R[r] = f */
+static void genstfval (Emitter *e, int f, int r) {
+  genldst(e, STRD, 3, f, 20, valoffset(r));
+}
+
+
+/* tag of R[r] = 'tag' */
+static void gensettag (Emitter *e, int r, int tag) {
+  emitins(e, 0x52800010u | (cast(l_uint32, tag) << 5));  /* mov w16, #tag */
+  genldst(e, STRB, 0, 16, 20, tagoffset(r));
+}
+
+
+/* t = tag of R[r] */
+static void genldtag (Emitter *e, int t, int r) {
+  genldst(e, LDRB, 0, XT(t), 20, tagoffset(r));
+}
+
+
+/* tag of R[r] = t */
+static void gensttag (Emitter *e, int t, int r) {
+  genldst(e, STRB, 0, XT(t), 20, tagoffset(r));
+}
+
+
+/* if the tag of R[r] is not 'tag', jump to 'label' */
+static void genguard (Emitter *e, int r, int tag, size_t label) {
+  genldst(e, LDRB, 0, 16, 20, tagoffset(r));
+  emitins(e, 0x7100021fu | (cast(l_uint32, tag) << 10));  /* cmp w16, #tag */
+  genbcond(e, 1, label);  /* b.ne */
+}
+
+
+/* t = 64-bit word at [register 's' + 'd'] */
+static void genload (Emitter *e, int t, int s, size_t d) {
+  genldst(e, LDRX, 3, XT(t), XT(s), d);
+}
+
+
+/* t = byte at [register 's' + 'd'] */
+static void genloadb (Emitter *e, int t, int s, size_t d) {
+  genldst(e, LDRB, 0, XT(t), XT(s), d);
+}
+
+
+/* 64-bit word at [register 's' + 'd'] = t */
+static void genstore (Emitter *e, int t, int s, size_t d) {
+  genldst(e, STRX, 3, XT(t), XT(s), d);
+}
+
+
+/* byte at [register 's' + 'd'] = t */
+static void genstoreb (Emitter *e, int t, int s, size_t d) {
+  genldst(e, STRB, 0, XT(t), XT(s), d);
+}
+
+
+/* t = field at offset 'd' of the frame */
+static void genloadframe (Emitter *e, int t, size_t d) {
+  genldst(e, LDRX, 3, XT(t), 19, d);
+}
+
+
+/* t += 'v' ('v' below 2^24) */
+static void genaddimm (Emitter *e, int t, size_t v) {
+  l_uint32 r = cast(l_uint32, XT(t) * 33);  /* Rd and Rn */
+  emitins(e, 0x91400000u | (cast(l_uint32, (v >> 12) & 0xfff) << 10) | r);
+  emitins(e, 0x91000000u | (cast(l_uint32, v & 0xfff) << 10) | r);
+}
+
+
+/* t0 = t0 'op' t1 */
+static void genarith (Emitter *e, int op) {
+  switch (op) {
+    case JA_ADD: emitins(e, 0x8b0a0129); break;  /* add x9, x9, x10 */
+    case JA_SUB: emitins(e, 0xcb0a0129); break;  /* sub x9, x9, x10 */
+    default: emitins(e, 0x9b0a7d29); break;  /* mul x9, x9, x10 */
+  }
+}
+
+
+/* f0 = f0 'op' f1 */
+static void genfarith (Emitter *e, int op) {
+  static const l_uint32 code[] = {  /* order of JA_* */
+    0x1e612800, 0x1e613800, 0x1e610800, 0x1e611800  /* fadd ... fdiv */
+  };
+  emitins(e, code[op]);  /* d0, d0, d1 */
+}
+
+
+/* f = bits of t */
+static void genmovf (Emitter *e, int f, int t) {
+  emitins(e, 0x9e670000u | (cast(l_uint32, XT(t)) << 5) |
+             cast(l_uint32, f));  /* fmov */
+}
+
+
+/* if 'ta' 'cond' 'tb' (signed), jump to 'label' */
+static void gencmp (Emitter *e, int ta, int tb, int cond, size_t label) {
+  emitins(e, 0xeb00001fu | (cast(l_uint32, XT(tb)) << 16) |
+             (cast(l_uint32, XT(ta)) << 5));  /* cmp */
+  genjcc(e, cond, label);
+}
+
+
+/* if t 'cond' 'v' (a small constant), jump to 'label' */
+static void gencmpimm (Emitter *e, int t, int v, int cond, size_t label) {
+  emitins(e, 0xf100001fu | (cast(l_uint32, v) << 10) |
+             (cast(l_uint32, XT(t)) << 5));  /* cmp t, #v */
+  genjcc(e, cond, label);
+}
+
+
+/* if 't & mask' is zero (or, if not 'iszero', non zero), jump to 'label' */
+static void genmaskjump (Emitter *e, int t, int mask, int iszero,
+                         size_t label) {
+  /* 'tst' encodes a run of 'ones' bits rotated right by 'rot' */
+  int ones = 0, low = 0;
+  while (!(mask & (1 << low))) low++;
+  while (mask & (1 << (low + ones))) ones++;
+  emitins(e, 0x7200001fu | (cast(l_uint32, (32 - low) & 31) << 16) |
+             (cast(l_uint32, ones - 1) << 10) |
+             (cast(l_uint32, XT(t)) << 5));  /* tst w_t, #mask */
+  genjcc(e, iszero ? JC_EQ : JC_NE, label);
+}
+
+
+/*
+** Backward jump to instruction 'target' (at 'label'), unless the
+** interpreter must take over (e.g., a hook was set): then leave.
+*/
+static void genbackedge (Emitter *e, const Instruction *target,
+                         size_t label, size_t exitlabel) {
+  genldst(e, LDRX, 3, 16, 19, offsetof(JitFrame, ci));
+  genldst(e, LDRW, 2, 16, 16, offsetof(CallInfo, u.l.trap));
+  emitins(e, 0x35000050);  /* cbnz w16, over the next branch */
+  genjump(e, label);
+  genexit(e, target, exitlabel);
+}
+
+#endif
+/* }================================================================== */
+
+
+/*
+** Instructions that can follow instruction 'pc' when it does not leave
+** the native code; returns how many were put in 's'.
+*/
+static int successors (const Proto *p, int pc, int *s) {
+  const Instruction *code = p->code;
+  Instruction i = unquickened(code[pc]);
+  OpCode op = GET_OPCODE(i);
+  int n = 0;
+  switch (op) {
+    case OP_JMP:
+      s[n++] = pc + 1 + GETARG_sJ(i);
+      break;
+    case OP_LFALSESKIP: case OP_NEWTABLE: case OP_LOADKX:
+      s[n++] = pc + 2;
+      break;
+    case OP_SETLIST:  /* may take an extra argument */
+      s[n++] = TESTARG_k(i) ? pc + 2 : pc + 1;
+      break;
+    case OP_FORLOOP: case OP_TFORLOOP:
+      s[n++] = pc + 1 - GETARG_Bx(i);
+      s[n++] = pc + 1;
+      break;
+    case OP_FORPREP:
+      s[n++] = pc + 2 + GETARG_Bx(i);
+      s[n++] = pc + 1;
+      break;
+    case OP_TFORPREP:
+      s[n++] = pc + 1 + GETARG_Bx(i);
+      break;
+    case OP_TESTNIL: case OP_INSTANCEOF:  /* skip the jump or fall into it */
+      s[n++] = pc + 2;
+      s[n++] = pc + 1;
+      break;
+    default:
+      if (testTMode(op)) {  /* test: skip or do the jump after it */
+        s[n++] = pc + 2;
+        if (pc + 1 < p->sizecode)
+          s[n++] = pc + 2 + GETARG_sJ(code[pc + 1]);
+      }
+      else {
+        if (pc + 1 < p->sizecode && testMMMode(GET_OPCODE(code[pc + 1])))
+          s[n++] = pc + 2;  /* arithmetic done; skip its metamethod */
+        s[n++] = pc + 1;
+      }
+      break;
+  }
+  return n;
+}
+
+
+/* jump to instruction 'target' of 'p' */
+static void genjumpto (Emitter *e, const Proto *p, int pc, int target,
+                       const size_t *label) {
+  lua_assert(0 <= target && target < p->sizecode);
+  if (target > pc)
+    genjump(e, label[target]);
+  else  /* a loop */
+    genbackedge(e, &p->code[target], label[target], label[p->sizecode]);
+}
+
+
+/*
+** Conditional jump of a test instruction at 'pc' comparing t0 and t1
+** with 'cond': like 'docondjump', skip the jump after it when the result
+** differs from 'k', otherwise do that jump.
+*/
+static void gentest (Emitter *e, const Proto *p, int pc, int cond, int k,
+                     const size_t *label) {
+  static const int negate[] = { JC_NE, JC_EQ, JC_GE, JC_GT, JC_LE, JC_LT };
+  gencmp(e, 0, 1, k ? negate[cond] : cond, label[pc + 2]);
+  genjumpto(e, p, pc + 1, pc + 2 + GETARG_sJ(p->code[pc + 1]), label);
+}
+
+
+/* number of bits needed by 'n' */
+static int bitsof (unsigned int n) {
+  int b = 0;
+  while (n != 0) { b++; n >>= 1; }
+  return b;
+}
+
+
+/*
+** With t0 pointing to a table, make it point to node 'n' when that node
+** still holds 'key' (see 'cachedslot'), or jump to 'slow'. Uses t1, t2.
+*/
+static void gennode (Emitter *e, unsigned int n, TString *key, size_t slow) {
+  genloadb(e, 1, 0, offsetof(Table, lsizenode));
+  gencmpimm(e, 1, bitsof(n), JC_LT, slow);  /* node out of the table? */
+  genload(e, 0, 0, offsetof(Table, node));
+  genaddimm(e, 0, n * sizeof(Node));
+  genloadb(e, 1, 0, offsetof(Node, u.key_tt));
+  gencmpimm(e, 1, ctb(LUA_VSHRSTR), JC_NE, slow);
+  genload(e, 1, 0, offsetof(Node, u.key_val));
+  genloadimm(e, 2, cast(L_P2I, key));
+  gencmp(e, 1, 2, JC_NE, slow);
+  genloadb(e, 1, 0, offsetof(TValue, tt_));
+  genmaskjump(e, 1, 0x0f, 1, slow);  /* empty value? */
+}
+
+
+/* t0 = table in upvalue 'u', or jump to 'slow' */
+static void genupvaltable (Emitter *e, int u, size_t slow) {
+  genloadframe(e, 0, offsetof(JitFrame, cl));
+  genload(e, 0, 0, offsetof(LClosure, upvals) + u * sizeof(UpVal *));
+  genload(e, 0, 0, offsetof(UpVal, v.p));
+  genloadb(e, 1, 0, offsetof(TValue, tt_));
+  gencmpimm(e, 1, ctb(LUA_VTABLE), JC_NE, slow);
+  genload(e, 0, 0, offsetof(TValue, value_));
+}
+
+
+/*
+** Inline code for the common cases of some instructions: moves, integer
+** and float arithmetic, integer comparisons and loops, jumps and cached
+** field accesses. Returns 0 if it emits nothing, FAST_ONLY if that code
+** does the whole instruction, or FAST_SLOW if a guard may fail, going to
+** the template call at 'slow'.
+*/
+#define FAST_ONLY	1
+#define FAST_SLOW	2
+
+static int genfast (Emitter *e, const Proto *p, int pc, const size_t *label,
+                    size_t slow) {
+  static const int arith[] = { JA_ADD, JA_SUB, JA_MUL, JA_DIV };
+  Instruction i = p->code[pc];
+  OpCode op = GET_OPCODE(i);
+  int n = p->sizecode;
+  int a = GETARG_A(i);
+  switch (op) {
+    case OP_MOVE: {
+      genldval(e, 0, GETARG_B(i));
+      genstval(e, 0, a);
+      genldtag(e, 1, GETARG_B(i));
+      gensttag(e, 1, a);
+      return FAST_ONLY;
+    }
+    case OP_LOADI: case OP_LOADF: {
+      TValue v;
+      if (op == OP_LOADI) {
+        setivalue(&v, GETARG_sBx(i));
+      }
+      else {
+        setfltvalue(&v, cast_num(GETARG_sBx(i)));
+      }
+      genloadimm(e, 0, cast(L_P2I, v.value_.i));
+      genstval(e, 0, a);
+      gensettag(e, a, rawtt(&v));
+      return FAST_ONLY;
+    }
+    case OP_LOADK: {
+      const TValue *v = &p->k[GETARG_Bx(i)];
+      if (!ttisnumber(v))
+        return 0;
+      genloadimm(e, 0, cast(L_P2I, v->value_.i));
+      genstval(e, 0, a);
+      gensettag(e, a, rawtt(v));
+      return FAST_ONLY;
+    }
+    case OP_LOADFALSE: case OP_LOADTRUE: {
+      gensettag(e, a, (op == OP_LOADTRUE) ? LUA_VTRUE : LUA_VFALSE);
+      return FAST_ONLY;
+    }
+    case OP_JMP: {
+      genjumpto(e, p, pc, pc + 1 + GETARG_sJ(i), label);
+      return FAST_ONLY;
+    }
+    case OP_ADD_II: case OP_SUB_II: case OP_MUL_II: case OP_ADDI: {
+      int b = GETARG_B(i);
+      if (pc + 2 >= n)
+        return 0;
+      genguard(e, b, LUA_VNUMINT, slow);
+      if (op == OP_ADDI)
+        genloadimm(e, 1, cast(L_P2I, cast(lua_Integer, GETARG_sC(i))));
+      else {
+        genguard(e, GETARG_C(i), LUA_VNUMINT, slow);
+        genldval(e, 1, GETARG_C(i));
+      }
+      genldval(e, 0, b);
+      genarith(e, (op == OP_ADDI) ? JA_ADD : arith[(op - OP_ADD_II) / 2]);
+      genstval(e, 0, a);
+      gensettag(e, a, LUA_VNUMINT);
+      genjump(e, label[pc + 2]);  /* skip the metamethod instruction */
+      return FAST_SLOW;
+    }
+    case OP_ADD_FF: case OP_SUB_FF: case OP_MUL_FF: case OP_DIV: {
+      int b = GETARG_B(i);
+      if (pc + 2 >= n)
+        return 0;
+      genguard(e, b, LUA_VNUMFLT, slow);
+      genguard(e, GETARG_C(i), LUA_VNUMFLT, slow);
+      genldfval(e, 0, b);
+      genldfval(e, 1, GETARG_C(i));
+      genfarith(e, (op == OP_DIV) ? JA_DIV : arith[(op - OP_ADD_II) / 2]);
+      genstfval(e, 0, a);
+      gensettag(e, a, LUA_VNUMFLT);
+      genjump(e, label[pc + 2]);  /* skip the metamethod instruction */
+      return FAST_SLOW;
+    }
+    case OP_ADDK: case OP_SUBK: case OP_MULK: case OP_DIVK: {
+      const TValue *kc = &p->k[GETARG_C(i)];
+      int b = GETARG_B(i);
+      int o = arith[(op == OP_DIVK) ? 3 : op - OP_ADDK];
+      if (pc + 2 >= n || !ttisnumber(kc))
+        return 0;
+      if (ttisinteger(kc) && op != OP_DIVK) {  /* integer arithmetic */
+        genguard(e, b, LUA_VNUMINT, slow);
+        genloadimm(e, 1, cast(L_P2I, ivalue(kc)));
+        genldval(e, 0, b);
+        genarith(e, o);
+        genstval(e, 0, a);
+        gensettag(e, a, LUA_VNUMINT);
+      }
+      else {  /* float arithmetic */
+        TValue v;
+        setfltvalue(&v, nvalue(kc));
+        if (!ttisfloat(kc) && op != OP_DIVK)
+          return 0;  /* float register with integer constant: rare */
+        genguard(e, b, LUA_VNUMFLT, slow);
+        genloadimm(e, 1, cast(L_P2I, v.value_.i));
+        genmovf(e, 1, 1);
+        genldfval(e, 0, b);
+        genfarith(e, o);
+        genstfval(e, 0, a);
+        gensettag(e, a, LUA_VNUMFLT);
+      }
+      genjump(e, label[pc + 2]);  /* skip the metamethod instruction */
+      return FAST_SLOW;
+    }
+    case OP_LT_II: case OP_LE_II: {
+      if (pc + 2 >= n)
+        return 0;
+      genguard(e, a, LUA_VNUMINT, slow);
+      genguard(e, GETARG_B(i), LUA_VNUMINT, slow);
+      genldval(e, 0, a);
+      genldval(e, 1, GETARG_B(i));
+      gentest(e, p, pc, (op == OP_LT_II) ? JC_LT : JC_LE, GETARG_k(i), label);
+      return FAST_SLOW;
+    }
+    case OP_EQI: case OP_LTI: case OP_LEI: case OP_GTI: case OP_GEI: {
+      static const int conds[] = { JC_EQ, JC_LT, JC_LE, JC_GT, JC_GE };
+      if (pc + 2 >= n)
+        return 0;
+      genguard(e, a, LUA_VNUMINT, slow);
+      genldval(e, 0, a);
+      genloadimm(e, 1, cast(L_P2I, cast(lua_Integer, GETARG_sB(i))));
+      gentest(e, p, pc, conds[op - OP_EQI], GETARG_k(i), label);
+      return FAST_SLOW;
+    }
+    case OP_FORLOOP: {  /* integer loop */
+      if (pc + 1 >= n)
+        return 0;
+      genguard(e, a + 2, LUA_VNUMINT, slow);
+      genldval(e, 0, a + 1);  /* count */
+      gencmpimm(e, 0, 0, JC_EQ, label[pc + 1]);  /* no more iterations? */
+      genloadimm(e, 1, 1);
+      genarith(e, JA_SUB);
+      genstval(e, 0, a + 1);
+      genldval(e, 0, a);  /* internal index */
+      genldval(e, 1, a + 2);  /* step */
+      genarith(e, JA_ADD);
+      genstval(e, 0, a);
+      genstval(e, 0, a + 3);  /* control variable */
+      gensettag(e, a + 3, LUA_VNUMINT);
+      genjumpto(e, p, pc, pc + 1 - GETARG_Bx(i), label);
+      return FAST_SLOW;
+    }
+    case OP_GETFIELD_N: case OP_GETTABUP_N: {
+      int r = GETARG_A(i) & 0xff;  /* see 'qreg' */
+      unsigned int nd = cast_uint(GETARG_Q(i) | ((GETARG_A(i) >> 8) << SIZE_Q));
+      if (op == OP_GETFIELD_N) {
+        genguard(e, GETARG_B(i), ctb(LUA_VTABLE), slow);
+        genldval(e, 0, GETARG_B(i));
+      }
+      else
+        genupvaltable(e, GETARG_B(i), slow);
+      gennode(e, nd, tsvalue(&p->k[GETARG_C(i)]), slow);
+      genload(e, 2, 0, offsetof(TValue, value_));
+      genstval(e, 2, r);
+      gensttag(e, 1, r);
+      genjump(e, label[pc + 1]);
+      return FAST_SLOW;
+    }
+    case OP_SETFIELD_N: {
+      int r = GETARG_A(i) & 0xff;  /* see 'qreg' */
+      unsigned int nd = cast_uint(GETARG_Q(i) | ((GETARG_A(i) >> 8) << SIZE_Q));
+      const TValue *kc = &p->k[GETARG_C(i)];
+      if (GETARG_k(i) && iscollectable(kc))
+        return 0;  /* would need a barrier */
+      if (!GETARG_k(i)) {  /* value in a register? */
+        genldtag(e, 1, GETARG_C(i));
+        genmaskjump(e, 1, BIT_ISCOLLECTABLE, 0, slow);  /* needs barrier */
+      }
+      genguard(e, r, ctb(LUA_VTABLE), slow);
+      genldval(e, 0, r);
+      gennode(e, nd, tsvalue(&p->k[GETARG_B(i)]), slow);
+      if (GETARG_k(i)) {
+        genloadimm(e, 2, cast(L_P2I, kc->value_.i));
+        genloadimm(e, 1, rawtt(kc));
+      }
+      else {
+        genldval(e, 2, GETARG_C(i));
+        genldtag(e, 1, GETARG_C(i));
+      }
+      genstore(e, 2, 0, offsetof(TValue, value_));
+      genstoreb(e, 1, 0, offsetof(TValue, tt_));
+      genjump(e, label[pc + 1]);
+      return FAST_SLOW;
+    }
+    default:
+      return 0;
+  }
+}
+
+
+/*
+** Generate the native code of 'p' ('label[pc]' is the offset of the
+** code for instruction 'pc'; 'label[sizecode]' is the exit code;
+** 'label[sizecode + 1 + pc]' is the template call for instruction 'pc'
+** when it also has inline code).
+*/
+static void generate (Emitter *e, const Proto *p, size_t *label) {
+  const Instruction *code = p->code;
+  int n = p->sizecode;
+  int pc;
+  genprologue(e);
+  for (pc = 0; pc < n; pc++) {
+    Instruction i = code[pc];  /* quickened forms have their templates */
+    JitOp f = luaV_jitop(GET_OPCODE(i));
+    label[pc] = e->pos;
+    if (f == NULL)
+      genexit(e, &code[pc], label[n]);
+    else if (genfast(e, p, pc, label, label[n + 1 + pc]) != FAST_ONLY) {
+      int s[3];
+      int ns = successors(p, pc, s);
+      int j, fall = 0;
+      label[n + 1 + pc] = e->pos;
+      gencall(e, f, i, &code[pc + 1]);
+      genloadbase(e);  /* the stack may have been reallocated */
+      for (j = 0; j < ns; j++) {
+        if (s[j] == pc + 1)
+          fall = 1;  /* handled last */
+        else if (0 <= s[j] && s[j] < n)
+          genbranch(e, &code[s[j]], label[s[j]], 0);
+      }
+      if (fall && pc + 1 < n)  /* go on unless something else came */
+        genbranch(e, &code[pc + 1], label[n], 1);
+      else
+        genjump(e, label[n]);
+    }
+  }
+  label[n] = e->pos;
+  genepilogue(e);
+}
+
+
+static void *allocmcode (size_t size) {
+  void *m = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return (m == MAP_FAILED) ? NULL : m;
+}
+
+
+/*
+** Compile 'p'. The code is written into fresh pages that become
+** executable (and read-only) only after that.
+*/
+int luaJ_compile (lua_State *L, Proto *p) {
+  global_State *g = G(L);
+  int n = p->sizecode;
+  size_t *label = NULL;
+  JitCode *jc = NULL;
+  void *m = NULL;
+  size_t size = 0;
+  Emitter e;
+  int pc;
+  if (p->jit != NULL)
+    return 1;
+  if (n == 0 || (p->flag & PF_NOJIT))
+    return 0;
+  label = cast(size_t *, calloc(2 * n + 1, sizeof(size_t)));
+  jc = cast(JitCode *, malloc(sizeof(JitCode)));
+  if (jc != NULL)
+    jc->entry = NULL;
+  if (label == NULL || jc == NULL ||
+      (jc->entry = cast(void **, malloc(n * sizeof(void *)))) == NULL)
+    goto fail;
+  e.buf = NULL; e.pos = 0;
+  generate(&e, p, label);  /* measure the code and find its labels */
+  if (e.pos > MAXMCODE)
+    goto fail;
+  size = cast_sizet(sysconf(_SC_PAGESIZE));
+  size = (e.pos + size - 1) / size * size;
+  if ((m = allocmcode(size)) == NULL)
+    goto fail;
+  e.buf = cast(unsigned char *, m); e.pos = 0;
+  generate(&e, p, label);
+  if (mprotect(m, size, PROT_READ | PROT_EXEC) != 0)
+    goto fail;
+  __builtin___clear_cache(cast_charp(m), cast_charp(m) + e.pos);
+  jc->mcode = m;
+  jc->msize = size;
+  jc->sizeentry = n;
+  jc->next = NULL;
+  for (pc = 0; pc < n; pc++) {
+    OpCode op = GET_OPCODE(p->code[pc]);
+    jc->entry[pc] = (luaV_jitop(op) != NULL) ? cast_charp(m) + label[pc]
+                                              : NULL;
+  }
+  free(label);
+  p->jit = jc;
+  g->jitstats.compiled++;
+  g->jitstats.mcode += size;
+  return 1;
+ fail:
+  if (m != NULL)
+    munmap(m, size);
+  if (jc != NULL)
+    free(jc->entry);
+  free(jc);
+  free(label);
+  p->flag |= PF_NOJIT;
+  g->jitstats.failed++;
+  return 0;
+}
+
+
+static void freecode (lua_State *L, JitCode *jc) {
+  munmap(jc->mcode, jc->msize);
+  G(L)->jitstats.mcode -= jc->msize;
+  free(jc->entry);
+  free(jc);
+}
+
+
+void luaJ_free (lua_State *L, Proto *p) {
+  if (p->jit != NULL) {
+    freecode(L, p->jit);
+    p->jit = NULL;
+  }
+}
+
+
+/* is 'jc' running somewhere in the C stack? */
+static int isrunning (lua_State *L, JitCode *jc) {
+  JitFrame *J;
+  for (J = G(L)->jitframe; J != NULL; J = J->previous) {
+    if (J->code == jc)
+      return 1;
+  }
+  return 0;
+}
+
+
+/*
+** Detach the native code of a live function. Code still running below
+** us in the C stack goes to 'jitdead' until it returns.
+*/
+void luaJ_discard (lua_State *L, Proto *p) {
+  JitCode *jc = p->jit;
+  if (jc != NULL) {
+    p->jit = NULL;
+    if (!isrunning(L, jc))
+      freecode(L, jc);
+    else {
+      jc->next = G(L)->jitdead;
+      G(L)->jitdead = jc;
+    }
+  }
+}
+
+
+/*
+** Free the discarded code that is not running anymore. It is called
+** when native code returns and by the collector (errors and yields
+** leave native code without returning; 'luaD_rawrunprotected' unlinks
+** their frames).
+*/
+void luaJ_sweep (lua_State *L) {
+  JitCode **p = &G(L)->jitdead;
+  while (*p != NULL) {
+    JitCode *jc = *p;
+    if (isrunning(L, jc))
+      p = &jc->next;
+    else {
+      *p = jc->next;
+      freecode(L, jc);
+    }
+  }
+}
+
+
+void luaJ_close (lua_State *L) {
+  global_State *g = G(L);
+  while (g->jitdead != NULL) {
+    JitCode *jc = g->jitdead;
+    g->jitdead = jc->next;
+    freecode(L, jc);
+  }
+}
+
+
+/*
+** Run the native code of the function in 'ci' from instruction 'pc';
+** returns the instruction where the interpreter must go on.
+*/
+const Instruction *luaJ_run (lua_State *L, CallInfo *ci,
+                             const Instruction *pc) {
+  Proto *p = ci_func(ci)->p;
+  JitCode *jc = p->jit;
+  void *start = jc->entry[pc - p->code];
+  JitFrame J;
+  if (start == NULL || !G(L)->jiton)
+    return pc;
+  J.L = L;
+  J.ci = ci;
+  J.cl = ci_func(ci);
+  J.code = jc;
+  J.previous = G(L)->jitframe;
+  G(L)->jitframe = &J;
+  G(L)->jitstats.entries++;
+  pc = cast(JitEntry, jc->mcode)(&J, start);
+  G(L)->jitframe = J.previous;
+  if (l_unlikely(G(L)->jitdead != NULL))
+    luaJ_sweep(L);  /* code discarded while running may go now */
+  return cast(const Instruction *, cast(L_P2I, pc) & ~cast(L_P2I, 1));
+}
+
+
+const char *luaJ_arch (void) {
+  return JIT_ARCH;
+}
+
+
+#else  /* }{ */
+
+
+int luaJ_compile (lua_State *L, Proto *p) {
+  UNUSED(L); UNUSED(p);
+  return 0;
+}
+
+
+void luaJ_free (lua_State *L, Proto *p) {
+  UNUSED(L); UNUSED(p);
+}
+
+
+void luaJ_discard (lua_State *L, Proto *p) {
+  UNUSED(L); UNUSED(p);
+}
+
+
+void luaJ_sweep (lua_State *L) {
+  UNUSED(L);
+}
+
+
+void luaJ_close (lua_State *L) {
+  UNUSED(L);
+}
+
+
+const Instruction *luaJ_run (lua_State *L, CallInfo *ci,
+                             const Instruction *pc) {
+  UNUSED(L); UNUSED(ci);
+  return pc;
+}
+
+
+const char *luaJ_arch (void) {
+  return NULL;
+}
+
+#endif  /* } */
+
+
+/*
+** Function 'p' got hot: compile it, unless the JIT is off.
+*/
+void luaJ_hot (lua_State *L, Proto *p) {
+  p->jitcount = 0;
+  if (G(L)->jiton && p->jit == NULL && !(p->flag & PF_NOJIT))
+    luaJ_compile(L, p);
+}
+
@@ -0,0 +1,109 @@
+/*
+** $Id: ljit.h $
+** Baseline JIT: native code stitched from per-opcode templates
+** See Copyright Notice in lua.h
+*/
+
+#ifndef ljit_h
+#define ljit_h
+
+#include "lobject.h"
+#include "lopcodes.h"
+
+
+/*
+** The JIT needs a code generator for the machine (x86-64 with the
+** System V ABI or arm64) and a way to get executable memory (mmap).
+** It is only built when the build defines LUA_USE_JIT, and even then
+** it starts off until 'jit.on' is called. Other targets are always
+** pure interpreters.
+*/
+#if defined(LUA_USE_JIT)
+#if !((defined(__x86_64__) || defined(__aarch64__)) && defined(__linux__))
+#undef LUA_USE_JIT
+#endif
+#endif
+
+
+/* calls plus loop iterations that make a function hot */
+#if !defined(LUAI_JITTHRESHOLD)
+#define LUAI_JITTHRESHOLD	1000
+#endif
+
+
+/*
+** Calls made from native code nest C frames (see OP_CALL in lvm.c);
+** beyond this depth the interpreter makes the calls instead.
+*/
+#if !defined(LUAI_JITMAXCCALLS)
+#define LUAI_JITMAXCCALLS	100
+#endif
+
+
+/*
+** Frame of a function running native code, as seen by the templates.
+** The frames of all native code running in the C stack are linked from
+** 'jitframe' in the global state.
+*/
+typedef struct JitFrame {
+  struct lua_State *L;
+  struct CallInfo *ci;
+  LClosure *cl;
+  struct JitCode *code;  /* code being run */
+  struct JitFrame *previous;  /* native frame below this one */
+} JitFrame;
+
+
+/*
+** A template executes one instruction 'i' exactly as 'luaV_execute'
+** does, with 'pc' pointing to the instruction after it, and returns
+** the next instruction to be executed.
+*/
+typedef const Instruction *(*JitOp) (JitFrame *J, Instruction i,
+                                     const Instruction *pc);
+
+
+/*
+** Native code of a function. 'entry[pc]' is the address of the code for
+** instruction 'pc', or NULL if that instruction is left to the
+** interpreter.
+*/
+typedef struct JitCode {
+  void *mcode;  /* executable memory */
+  size_t msize;  /* size of 'mcode' */
+  void **entry;
+  int sizeentry;
+  struct JitCode *next;  /* in list of discarded code */
+} JitCode;
+
+
+typedef struct JitStats {
+  l_uint32 compiled;  /* functions compiled */
+  l_uint32 failed;  /* functions that could not be compiled */
+  size_t mcode;  /* bytes of native code alive */
+  lu_mem entries;  /* times native code was entered */
+} JitStats;
+
+
+/* count one call or loop iteration of 'p'; compile it when it gets hot */
+#define luaJ_count(L,p)  \
+	{ if (l_unlikely(++(p)->jitcount >= G(L)->jitthreshold))  \
+	    luaJ_hot(L, p); }
+
+
+LUAI_FUNC void luaJ_init (struct lua_State *L);
+LUAI_FUNC void luaJ_hot (struct lua_State *L, Proto *p);
+LUAI_FUNC int luaJ_compile (struct lua_State *L, Proto *p);
+LUAI_FUNC void luaJ_free (struct lua_State *L, Proto *p);
+LUAI_FUNC void luaJ_discard (struct lua_State *L, Proto *p);
+LUAI_FUNC void luaJ_sweep (struct lua_State *L);
+LUAI_FUNC void luaJ_close (struct lua_State *L);
+LUAI_FUNC const Instruction *luaJ_run (struct lua_State *L,
+                                       struct CallInfo *ci,
+                                       const Instruction *pc);
+LUAI_FUNC const char *luaJ_arch (void);
+
+/* provided by lvm.c */
+LUAI_FUNC JitOp luaV_jitop (OpCode op);
+
+#endif
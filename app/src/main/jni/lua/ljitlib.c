@@ -0,0 +1,133 @@
+/*
+** $Id: ljitlib.c $
+** Control of the baseline JIT
+** See Copyright Notice in lua.h
+*/
+
+#define ljitlib_c
+#define LUA_LIB
+
+#include "lprefix.h"
+
+
+#include "lua.h"
+
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lstate.h"
+#include "ljit.h"
+
+
+/*
+** Prototype of the Lua function at index 'arg'.
+*/
+static Proto *checkproto (lua_State *L, int arg) {
+  luaL_argcheck(L, lua_isfunction(L, arg) && !lua_iscfunction(L, arg),
+                arg, "Lua function expected");
+  return cast(LClosure *, lua_topointer(L, arg))->p;
+}
+
+
+static int jit_on (lua_State *L) {
+  G(L)->jiton = (luaJ_arch() != NULL);
+  lua_pushboolean(L, G(L)->jiton);
+  return 1;
+}
+
+
+static int jit_off (lua_State *L) {
+  G(L)->jiton = 0;
+  return 0;
+}
+
+
+static int jit_status (lua_State *L) {
+  lua_pushboolean(L, G(L)->jiton);
+  return 1;
+}
+
+
+static int jit_threshold (lua_State *L) {
+  global_State *g = G(L);
+  lua_Integer old = g->jitthreshold;
+  if (!lua_isnoneornil(L, 1)) {
+    lua_Integer n = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, 0 < n && n <= MAX_INT, 1, "out of range");
+    g->jitthreshold = cast(l_uint32, n);
+  }
+  lua_pushinteger(L, old);
+  return 1;
+}
+
+
+static int jit_stats (lua_State *L) {
+  JitStats *s = &G(L)->jitstats;
+  lua_createtable(L, 0, 4);
+  lua_pushinteger(L, s->compiled);
+  lua_setfield(L, -2, "compiled");
+  lua_pushinteger(L, s->failed);
+  lua_setfield(L, -2, "failed");
+  lua_pushinteger(L, cast(lua_Integer, s->mcode));
+  lua_setfield(L, -2, "mcode");
+  lua_pushinteger(L, cast(lua_Integer, s->entries));
+  lua_setfield(L, -2, "entries");
+  return 1;
+}
+
+
+/*
+** Compile a function now, without waiting for it to get hot.
+*/
+static int jit_compile (lua_State *L) {
+  Proto *p = checkproto(L, 1);
+  if (p->jit != NULL)
+    lua_pushboolean(L, 1);
+  else if (luaJ_arch() == NULL)
+    luaL_pushfail(L);
+  else
+    lua_pushboolean(L, luaJ_compile(L, p));
+  if (!lua_toboolean(L, -1)) {
+    lua_pushliteral(L, "cannot compile function");
+    return 2;
+  }
+  return 1;
+}
+
+
+/*
+** Throw away the native code of a function, letting it be compiled
+** again when it gets hot.
+*/
+static int jit_flush (lua_State *L) {
+  Proto *p = checkproto(L, 1);
+  luaJ_discard(L, p);
+  p->flag &= cast_byte(~PF_NOJIT);
+  p->jitcount = 0;
+  return 0;
+}
+
+
+static const luaL_Reg jit_funcs[] = {
+  {"on", jit_on},
+  {"off", jit_off},
+  {"status", jit_status},
+  {"threshold", jit_threshold},
+  {"stats", jit_stats},
+  {"compile", jit_compile},
+  {"flush", jit_flush},
+  {"arch", NULL},
+  {NULL, NULL}
+};
+
+
+LUAMOD_API int luaopen_jit (lua_State *L) {
+  const char *arch = luaJ_arch();
+  luaL_newlib(L, jit_funcs);
+  if (arch != NULL)
+    lua_pushstring(L, arch);
+  else
+    lua_pushboolean(L, 0);
+  lua_setfield(L, -2, "arch");
+  return 1;
+}
+
@@ -16,7 +16,7 @@
 #define vmbreak		vmfetch(); vmdispatch(GET_OPCODE(i));
 
 
-static const void *const disptab[NUM_OPCODES] = {
+static const void *const disptab[NUM_ALLOPCODES] = {
 
 #if 0
 ** you can update the following list with this command:
@@ -57,8 +57,8 @@ static const void *const disptab[NUM_OPCODES] = {
 &&L_OP_BANDK,
 &&L_OP_BORK,
 &&L_OP_BXORK,
-&&L_OP_SHRI,
 &&L_OP_SHLI,
+&&L_OP_SHRI,
 &&L_OP_ADD,
 &&L_OP_SUB,
 &&L_OP_MUL,
@@ -122,7 +122,25 @@ static const void *const disptab[NUM_OPCODES] = {
 &&L_OP_GETPROP,
 &&L_OP_SETPROP,
 &&L_OP_INSTANCEOF,
+&&L_OP_IMPLEMENT,
+&&L_OP_SETIFACEFLAG,
+&&L_OP_ADDMETHOD,
 &&L_OP_SLICE,
-&&L_OP_EXTRAARG
+&&L_OP_NOP,
+&&L_OP_EXTRAARG,
+/* 特化操作码 */
+&&L_OP_ADD_II,
+&&L_OP_ADD_FF,
+&&L_OP_SUB_II,
+&&L_OP_SUB_FF,
+&&L_OP_MUL_II,
+&&L_OP_MUL_FF,
+&&L_OP_LT_II,
+&&L_OP_LT_FF,
+&&L_OP_LE_II,
+&&L_OP_LE_FF,
+&&L_OP_GETTABUP_N,
+&&L_OP_GETFIELD_N,
+&&L_OP_SETFIELD_N
 
 };
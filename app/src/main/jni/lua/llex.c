@@ -238,6 +238,8 @@ void luaX_setinput (lua_State *L, LexState *ls, ZIO *z, TString *source,
   ls->linenumber = 1;
   ls->lastline = 1;
   ls->source = source;
+  ls->optimize = 0;
+  ls->pragma = 0;
   ls->envn = luaS_newliteral(L, LUA_ENV);  /* get env name */
 
 #if defined(LUA_COMPAT_GLOBAL)
@@ -623,6 +625,25 @@ static void read_raw_long_string (LexState *ls, SemInfo *seminfo, size_t sep) {
 }
 
 
+/*
+** 读取 '--@' 之后的编译指示；目前只识别 '--@optimize'，
+** 它让之后结束的函数都经过字节码优化（见 lopt.c）。
+** 注释是在读取下一个记号时读到的，那时前一个函数可能还没关闭，
+** 所以先记下来，等 luaX_next 越过这个记号时才生效。
+** 不认识的指示当作普通注释忽略。
+*/
+static void read_pragma (LexState *ls) {
+  const char *p = "optimize";
+  next(ls);  /* skip '@' */
+  while (*p != '\0' && ls->current == cast_uchar(*p)) {
+    next(ls);
+    p++;
+  }
+  if (*p == '\0' && !lislalnum(ls->current))
+    ls->pragma = 1;
+}
+
+
 static int llex (LexState *ls, SemInfo *seminfo) {
   luaZ_resetbuffer(ls->buff);
   for (;;) {
@@ -658,6 +679,8 @@ static int llex (LexState *ls, SemInfo *seminfo) {
           }
         }
         /* else short comment */
+        if (ls->current == '@')
+          read_pragma(ls);
         while (!currIsNewline(ls) && ls->current != EOZ)
           next(ls);  /* skip until end of line (or end of file) */
         break;
@@ -865,6 +888,8 @@ static int llex (LexState *ls, SemInfo *seminfo) {
 
 
 void luaX_next (LexState *ls) {
+  if (ls->pragma)  /* leaving the token that follows '--@optimize'? */
+    ls->optimize = 1;
   ls->lastline = ls->linenumber;
   ls->lasttoken = ls->t.token;
   ls->lastbuff = ls->buff;
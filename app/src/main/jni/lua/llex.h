@@ -102,6 +102,8 @@ typedef struct LexState {
   struct Dyndata *dyd;  /* dynamic structures used by the parser */
   TString *source;  /* current source name */
   TString *envn;  /* environment variable name */
+  lu_byte optimize;  /* run the bytecode optimizer on closed functions */
+  lu_byte pragma;  /* '--@optimize' read before the current token */
 } LexState;
 
 
@@ -712,93 +712,68 @@ static int math_log10 (lua_State *L) {
 
 
 
+/*
+** Builds one level of a math.array result. Rows of the innermost
+** dimension are filled in bulk when the initial value is a number
+** ('row' holds it replicated); nil rows only need the pre-sized table.
+*/
+static void array_build (lua_State *L, int dim, int ndims, int init,
+                         const lua_Number *row) {
+  lua_Integer size = lua_tointeger(L, dim);
+  lua_Integer i;
+  if (dim == ndims) {
+    if (row != NULL)
+      lua_createarrayn(L, row, (size_t)size);
+    else {
+      lua_createtable(L, (int)size, 0);
+      if (init != 0 && !lua_isnil(L, init)) {
+        for (i = 1; i <= size; i++) {
+          lua_pushvalue(L, init);
+          lua_rawseti(L, -2, i);
+        }
+      }
+    }
+    return;
+  }
+  luaL_checkstack(L, 2, "array too deep");
+  lua_createtable(L, (int)size, 0);
+  for (i = 1; i <= size; i++) {
+    array_build(L, dim + 1, ndims, init, row);
+    lua_rawseti(L, -2, i);
+  }
+}
+
+
 static int math_array (lua_State *L) {
   int n = lua_gettop(L);
+  int num_dims, init;
+  const lua_Number *row = NULL;
   if (n < 1) {
     lua_newtable(L);
     return 1;
   }
-  
-  /* Check if all dimensions are positive integers */
-  for (int i = 1; i <= n; i++) {
-    if (lua_isinteger(L, i)) {
-      lua_Integer dim = lua_tointeger(L, i);
-      if (dim <= 0) {
-        luaL_argerror(L, i, "dimensions must be positive integers");
-      }
-    } else if (i < n) {
-      luaL_argerror(L, i, "dimensions must be positive integers");
-    }
+  /* the last argument is the initial value when it is not an integer */
+  num_dims = lua_isinteger(L, n) ? n : n - 1;
+  init = (num_dims < n) ? n : 0;
+  for (int i = 1; i <= num_dims; i++) {
+    lua_Integer dim = lua_isinteger(L, i) ? lua_tointeger(L, i) : 0;
+    luaL_argcheck(L, dim > 0 && dim <= INT_MAX, i,
+                  "dimensions must be positive integers");
   }
-  
-  /* The last argument is the initial value (optional) */
-  int num_dims = (lua_isinteger(L, n)) ? n : n - 1;
-  
-  /* Create a stack to keep track of tables and their dimensions */
-  typedef struct {
-    lua_Integer index;
-    lua_Integer size;
-  } StackElem;
-  
-  StackElem *stack = luaM_newvector(L, num_dims, StackElem);
-  
-  /* Initialize stack */
-  for (int i = 0; i < num_dims; i++) {
-    stack[i].index = 1;
-    stack[i].size = lua_tointeger(L, i + 1);
+  if (num_dims == 0) {
+    lua_newtable(L);
+    return 1;
   }
-  
-  /* Create the root table */
-  lua_newtable(L);
-  
-  int stack_pos = 0;
-  while (stack_pos >= 0) {
-    if (stack_pos == num_dims - 1) {
-      /* We're at the innermost dimension, fill with value */
-      if (lua_isinteger(L, n)) {
-        /* No initial value provided, use nil */
-        lua_pushnil(L);
-      } else {
-        /* Use the provided initial value */
-        lua_pushvalue(L, n);
-      }
-      lua_rawseti(L, -2, stack[stack_pos].index);
-      
-      /* Move to next index */
-      stack[stack_pos].index++;
-      
-      /* Check if we've filled this dimension */
-      if (stack[stack_pos].index > stack[stack_pos].size) {
-        /* Move up one level */
-        stack_pos--;
-        if (stack_pos >= 0) {
-          /* Remove the filled table from the stack */
-          lua_remove(L, -1);
-          /* Move to next index in parent dimension */
-          stack[stack_pos].index++;
-        }
-      }
-    } else {
-      /* We need to create a new table for the next dimension */
-      if (stack[stack_pos].index > stack[stack_pos].size) {
-        /* This dimension is filled, move up */
-        stack_pos--;
-        if (stack_pos >= 0) {
-          lua_remove(L, -1);
-          stack[stack_pos].index++;
-        }
-      } else {
-        /* Create a new table for the next dimension */
-        lua_newtable(L);
-        /* Set it in the current table */
-        lua_rawseti(L, -2, stack[stack_pos].index);
-        /* Move down to fill the new table */
-        stack_pos++;
-      }
-    }
+  if (init != 0 && lua_type(L, init) == LUA_TNUMBER) {
+    lua_Integer size = lua_tointeger(L, num_dims);
+    lua_Number v = lua_tonumber(L, init);
+    lua_Number *buf = (lua_Number *)lua_newuserdatauv(L,
+                          (size_t)size * sizeof(lua_Number), 0);
+    for (lua_Integer i = 0; i < size; i++)
+      buf[i] = v;
+    row = buf;
   }
-  
-  luaM_freearray(L, stack, num_dims);
+  array_build(L, 1, num_dims, init, row);
   return 1;
 }
 
@@ -407,7 +407,7 @@ typedef struct GCObject {
 typedef struct TString {
   CommonHeader;
   lu_byte extra;  /* reserved words for short strings; "has hash" for longs */
-  lu_byte shrlen;  /* length for short strings, 0xFF for long strings */
+  lu_byte shrlen;  /* length for short strings; kind (as ls_byte) for longs */
   unsigned int hash;
   union {
     size_t lnglen;  /* length for long strings */
@@ -419,8 +419,8 @@ typedef struct TString {
 } TString;
 
 
-#define strisshr(ts)	((ts)->shrlen >= 0)
-#define isextstr(ts)	(ttislngstring(ts) && tsvalue(ts)->shrlen != LSTRREG)
+#define strisshr(ts)	(cast(ls_byte, (ts)->shrlen) >= 0)
+#define isextstr(ts)	(ttislngstring(ts) && cast(ls_byte, tsvalue(ts)->shrlen) != LSTRREG)
 
 /*
 ** Get the actual string (array of bytes) from a 'TString'. (Generic
@@ -434,7 +434,7 @@ typedef struct TString {
 
 /* get string length from 'TString *s' */
 #define tsslen(s)  \
-	((s)->shrlen != 0xFF ? (s)->shrlen : (s)->u.lnglen)
+	(strisshr(s) ? cast_sizet((s)->shrlen) : (s)->u.lnglen)
 /*
 ** Get string and length */
 #define getlstr(ts, len)  \
@@ -594,6 +594,7 @@ typedef struct AbsLineInfo {
 #define PF_VAHID	1  /* function has hidden vararg arguments */
 #define PF_VATAB	2  /* function has vararg table */
 #define PF_FIXED	4  /* prototype has parts in fixed memory */
+#define PF_NOJIT	8  /* prototype could not be compiled to native code */
 
 /* a vararg function either has hidden args. or a vararg table */
 #define isvararg(p)	((p)->flag & (PF_VAHID | PF_VATAB))
@@ -663,6 +664,8 @@ typedef struct Proto {
   int is_sleeping;
   CallQueue *call_queue;
   struct VMCodeTable *vm_code_table;  /* VM保护代码表指针 */
+  struct JitCode *jit;  /* 基线JIT生成的本地代码（见 ljit.c） */
+  l_uint32 jitcount;  /* 调用与循环回跳计数，用于发现热点函数 */
 } Proto;
 
 /* }======================================================= */
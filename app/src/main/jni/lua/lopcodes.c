@@ -19,7 +19,7 @@
 
 /* ORDER OP */
 
-LUAI_DDEF const lu_byte luaP_opmodes[NUM_OPCODES] = {
+LUAI_DDEF const lu_byte luaP_opmodes[NUM_ALLOPCODES] = {
 /*       MM OT IT T  A  mode		   opcode  */
   opmode(0, 0, 0, 0, 1, iABC)		/* OP_MOVE */
  ,opmode(0, 0, 0, 0, 1, iAsBx)		/* OP_LOADI */
@@ -40,7 +40,7 @@ LUAI_DDEF const lu_byte luaP_opmodes[NUM_OPCODES] = {
  ,opmode(0, 0, 0, 0, 0, iABC)		/* OP_SETTABLE */
  ,opmode(0, 0, 0, 0, 0, iABC)		/* OP_SETI */
  ,opmode(0, 0, 0, 0, 0, iABC)		/* OP_SETFIELD */
- ,opmode(0, 0, 0, 0, 1, ivABC)		/* OP_NEWTABLE */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_NEWTABLE */
  ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_SELF */
  ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_ADDI */
  ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_ADDK */
@@ -100,7 +100,7 @@ LUAI_DDEF const lu_byte luaP_opmodes[NUM_OPCODES] = {
  ,opmode(0, 0, 0, 0, 0, iABx)		/* OP_TFORPREP */
  ,opmode(0, 0, 0, 0, 0, iABC)		/* OP_TFORCALL */
  ,opmode(0, 0, 0, 0, 1, iABx)		/* OP_TFORLOOP */
- ,opmode(0, 0, 1, 0, 0, ivABC)		/* OP_SETLIST */
+ ,opmode(0, 0, 1, 0, 0, iABC)		/* OP_SETLIST */
  ,opmode(0, 0, 0, 0, 1, iABx)		/* OP_CLOSURE */
  ,opmode(0, 1, 0, 0, 1, iABC)		/* OP_VARARG */
  ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_GETVARG */
@@ -124,6 +124,27 @@ LUAI_DDEF const lu_byte luaP_opmodes[NUM_OPCODES] = {
  ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_SLICE */
  ,opmode(0, 0, 0, 0, 0, iABC)		/* OP_NOP - 空操作，不设置任何寄存器 */
  ,opmode(0, 0, 0, 0, 0, iAx)		/* OP_EXTRAARG */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_ADD_II */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_ADD_FF */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_SUB_II */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_SUB_FF */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_MUL_II */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_MUL_FF */
+ ,opmode(0, 0, 0, 1, 0, iABC)		/* OP_LT_II */
+ ,opmode(0, 0, 0, 1, 0, iABC)		/* OP_LT_FF */
+ ,opmode(0, 0, 0, 1, 0, iABC)		/* OP_LE_II */
+ ,opmode(0, 0, 0, 1, 0, iABC)		/* OP_LE_FF */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_GETTABUP_N */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_GETFIELD_N */
+ ,opmode(0, 0, 0, 0, 0, iABC)		/* OP_SETFIELD_N */
+};
+
+
+/* generic opcode of each quickened opcode (ORDER OP) */
+static const lu_byte qbase[NUM_ALLOPCODES - NUM_OPCODES] = {
+  OP_ADD, OP_ADD, OP_SUB, OP_SUB, OP_MUL, OP_MUL,
+  OP_LT, OP_LT, OP_LE, OP_LE,
+  OP_GETTABUP, OP_GETFIELD, OP_SETFIELD
 };
 
 
@@ -147,12 +168,24 @@ int luaP_isOT (Instruction i) {
 ** it accepts multiple results.
 */
 int luaP_isIT (Instruction i) {
+  return testITMode(GET_OPCODE(i)) && GETARG_B(i) == 0;
+}
+
+
+/*
+** Undo the quickening of an instruction: give back the generic opcode,
+** clear the cache bits, and, for node caches, the high byte of A.
+*/
+Instruction luaP_unquicken (Instruction i) {
   OpCode op = GET_OPCODE(i);
-  switch (op) {
-    case OP_SETLIST:
-      return testITMode(GET_OPCODE(i)) && GETARG_vB(i) == 0;
-    default:
-      return testITMode(GET_OPCODE(i)) && GETARG_B(i) == 0;
+  if (isquickened(op)) {
+    OpCode base = cast(OpCode, qbase[op - NUM_OPCODES]);
+    if (op >= OP_GETTABUP_N)  /* node cache? */
+      SETARG_A(i, GETARG_A(i) & 0xFF);
+    SET_OPCODE(i, base);
   }
+  else if (getOpMode(op) != iABC)
+    return i;  /* no 'Q' bits */
+  SETARG_Q(i, 0);
+  return i;
 }
-
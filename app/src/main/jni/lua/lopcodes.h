@@ -64,6 +64,10 @@ enum OpMode {iABC, ivABC, iABx, iAsBx, iAx, isJ};
 
 #define POS_sJ		POS_A
 
+/* bits above C, unused by the iABC format (see "quickening" below) */
+#define POS_Q		(POS_C + SIZE_C)
+#define SIZE_Q		6
+
 
 /*
 ** limits for opcode arguments.
@@ -107,6 +111,7 @@ enum OpMode {iABC, ivABC, iABx, iAsBx, iAx, isJ};
 #define MAXARG_vB	((1<<SIZE_vB)-1)
 #define MAXARG_C	((1<<SIZE_C)-1)
 #define MAXARG_vC	((1<<SIZE_vC)-1)
+#define MAXARG_Q	((1<<SIZE_Q)-1)
 #define OFFSET_sC	(MAXARG_C >> 1)
 
 #define int2sC(i)	((i) + OFFSET_sC)
@@ -157,6 +162,9 @@ enum OpMode {iABC, ivABC, iABx, iAsBx, iAx, isJ};
 #define GETARG_k(i)	check_exp(checkopm(i, iABC), getarg(i, POS_k, 1))
 #define SETARG_k(i,v)	setarg(i, v, POS_k, 1)
 
+#define GETARG_Q(i)	check_exp(checkopm(i, iABC), getarg(i, POS_Q, SIZE_Q))
+#define SETARG_Q(i,v)	setarg(i, v, POS_Q, SIZE_Q)
+
 #define GETARG_Bx(i)	check_exp(checkopm(i, iABx), getarg(i, POS_Bx, SIZE_Bx))
 #define SETARG_Bx(i,v)	setarg(i, v, POS_Bx, SIZE_Bx)
 
@@ -382,12 +390,36 @@ OP_NOP,/*	A B C	空操作指令 - 不执行任何操作
 			B = 虚假操作数1（被忽略）
 			C = 虚假操作数2（被忽略）			*/
 
-OP_EXTRAARG/*	Ax	extra (larger) argument for previous opcode	*/
+OP_EXTRAARG,/*	Ax	extra (larger) argument for previous opcode	*/
+
+/*----------------------------------------------------------------------
+  特化（quickened）操作码 - 只由 luaV_execute 在运行时写入代码，
+  从不出现在编译结果和二进制 chunk 中（见下方 "quickening" 说明）
+------------------------------------------------------------------------*/
+OP_ADD_II,/*	A B C	R[A] := R[B] + R[C] (integers)			*/
+OP_ADD_FF,/*	A B C	R[A] := R[B] + R[C] (floats)			*/
+OP_SUB_II,/*	A B C	R[A] := R[B] - R[C] (integers)			*/
+OP_SUB_FF,/*	A B C	R[A] := R[B] - R[C] (floats)			*/
+OP_MUL_II,/*	A B C	R[A] := R[B] * R[C] (integers)			*/
+OP_MUL_FF,/*	A B C	R[A] := R[B] * R[C] (floats)			*/
+OP_LT_II,/*	A B k	if ((R[A] <  R[B]) ~= k) then pc++ (integers)	*/
+OP_LT_FF,/*	A B k	if ((R[A] <  R[B]) ~= k) then pc++ (floats)	*/
+OP_LE_II,/*	A B k	if ((R[A] <= R[B]) ~= k) then pc++ (integers)	*/
+OP_LE_FF,/*	A B k	if ((R[A] <= R[B]) ~= k) then pc++ (floats)	*/
+OP_GETTABUP_N,/* A B C	OP_GETTABUP with a cached node index		*/
+OP_GETFIELD_N,/* A B C	OP_GETFIELD with a cached node index		*/
+OP_SETFIELD_N/*	A B C	OP_SETFIELD with a cached node index		*/
 } OpCode;
 
 
+/* opcodes produced by the code generator (and saved in binary chunks) */
 #define NUM_OPCODES	((int)(OP_EXTRAARG) + 1)
 
+/* all opcodes, including the quickened ones */
+#define NUM_ALLOPCODES	((int)(OP_SETFIELD_N) + 1)
+
+#define isquickened(o)	((o) >= NUM_OPCODES)
+
 
 
 /*================================================================
@@ -447,6 +479,17 @@ OP_EXTRAARG/*	Ax	extra (larger) argument for previous opcode	*/
   original operand was a float. (It must be corrected in case of
   metamethods.)
 
+  (*) Quickening: the interpreter rewrites hot instructions in place
+  into the OP_*_II/OP_*_FF/OP_*_N variants once their operands have
+  shown stable types, and back when a guard fails. Generic forms of
+  these instructions keep a warm-up counter in 'Q' (the bits above C).
+  The _N forms keep a node index into the hash part of the table in
+  'Q' plus the high byte of A (their A is always a register, and
+  registers fit in a byte). 'luaP_unquicken' gives back the generic
+  instruction; everything that inspects code outside the interpreter
+  loop (debug information, dumps) must go through it, or through the
+  cheaper 'unquickened' when it does not care about 'Q'.
+
 ================================================================*/
 
 
@@ -460,7 +503,7 @@ OP_EXTRAARG/*	Ax	extra (larger) argument for previous opcode	*/
 ** bit 7: instruction is an MM instruction (call a metamethod)
 */
 
-LUAI_DDEC(const lu_byte luaP_opmodes[NUM_OPCODES];)
+LUAI_DDEC(const lu_byte luaP_opmodes[NUM_ALLOPCODES];)
 
 #define getOpMode(m)	(cast(enum OpMode, luaP_opmodes[m] & 7))
 #define testAMode(m)	(luaP_opmodes[m] & (1 << 3))
@@ -482,6 +525,11 @@ LUAI_DDEC(const lu_byte luaP_opmodes[NUM_OPCODES];)
 
 LUAI_FUNC int luaP_isOT (Instruction i);
 LUAI_FUNC int luaP_isIT (Instruction i);
+LUAI_FUNC Instruction luaP_unquicken (Instruction i);
+
+/* generic opcode and arguments of 'i' ('Q' is left as is) */
+#define unquickened(i)  \
+	(isquickened(GET_OPCODE(i)) ? luaP_unquicken(i) : (i))
 
 /* number of list items to accumulate before a SETLIST instruction */
 #define LFIELDS_PER_FLUSH	50
@@ -45,8 +45,8 @@ static const char *const opnames[] = {
   "BANDK",
   "BORK",
   "BXORK",
-  "SHRI",
   "SHLI",
+  "SHRI",
   "ADD",
   "SUB",
   "MUL",
@@ -110,9 +110,26 @@ static const char *const opnames[] = {
   "GETPROP",
   "SETPROP",
   "INSTANCEOF",
+  "IMPLEMENT",
+  "SETIFACEFLAG",
+  "ADDMETHOD",
   "SLICE",
   "NOP",
   "EXTRAARG",
+  /* 特化操作码名称 */
+  "ADD_II",
+  "ADD_FF",
+  "SUB_II",
+  "SUB_FF",
+  "MUL_II",
+  "MUL_FF",
+  "LT_II",
+  "LT_FF",
+  "LE_II",
+  "LE_FF",
+  "GETTABUP_N",
+  "GETFIELD_N",
+  "SETFIELD_N",
   NULL
 };
 
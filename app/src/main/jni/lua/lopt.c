@@ -0,0 +1,1308 @@
+/*
+** $Id: lopt.c $
+** Bytecode optimizer for finished function prototypes
+** See Copyright Notice in lua.h
+*/
+
+#define lopt_c
+#define LUA_CORE
+
+#include "lprefix.h"
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lua.h"
+
+#include "ldebug.h"
+#include "ldo.h"
+#include "lgc.h"
+#include "lmem.h"
+#include "lobject.h"
+#include "lopcodes.h"
+#include "lopt.h"
+#include "lstate.h"
+#include "lstring.h"
+#include "ltm.h"
+
+
+/*
+** The optimizer works on a function whose code generation is complete
+** ('luaK_finish' already ran), so jumps are absolute and the code is
+** final. Instructions it deletes are first turned into OP_NOP, so that
+** addresses stay valid while the passes run; 'compact' removes them at
+** the end and fixes jumps, line information, and local-variable ranges.
+**
+** All passes rely on a conservative model of the registers each
+** instruction reads and writes ('usedef'). Anything not modeled there
+** is assumed to read and possibly write every register.
+*/
+
+
+/* 'maxstacksize' is a byte, so a function never has more registers */
+#define MAXREGS		256
+
+#define NREGWORDS	(MAXREGS / 32)
+
+/* maximum number of rounds over a function */
+#define MAXROUNDS	4
+
+
+typedef struct RegSet {
+  l_uint32 w[NREGWORDS];
+} RegSet;
+
+
+/* per-instruction flags */
+#define F_TARGET	1  /* reached by something other than the previous one */
+#define F_FALL		2  /* may continue with the next instruction */
+#define F_REACH		4  /* reachable from the entry point */
+#define F_TOUCHED	8  /* changed by the current pass */
+
+
+/* no explicit successor */
+#define NOTARGET	(-1)
+
+
+typedef struct OptState {
+  lua_State *L;
+  Proto *f;
+  Instruction *code;
+  int n;  /* number of instructions */
+  int *jt;  /* explicit successor of each instruction (or NOTARGET) */
+  int *nact;  /* number of active local variables at each pc */
+  int *lvreg;  /* register of each local variable */
+  int *lvload;  /* instruction that loads a constant local (cache) */
+  int *aux;  /* work area with '2 * (n + 1) + sizelocvars' entries */
+  lu_byte *flags;
+  RegSet *live;  /* registers live at the entry of each instruction */
+  RegSet pinned;  /* registers that must never be touched */
+} OptState;
+
+
+
+/*
+** {======================================================
+** Register sets
+** =======================================================
+*/
+
+static void addrange (RegSet *s, int from, int to) {
+  if (to > MAXREGS - 1)
+    to = MAXREGS - 1;
+  for (; from <= to; from++)
+    s->w[from >> 5] |= cast(l_uint32, 1) << (from & 31);
+}
+
+#define addreg(s,r)	addrange(s, r, r)
+
+#define addall(s)	addrange(s, 0, MAXREGS - 1)
+
+
+static int hasreg (const RegSet *s, int r) {
+  return (s->w[r >> 5] >> (r & 31)) & 1;
+}
+
+
+static void setunion (RegSet *s, const RegSet *o) {
+  int i;
+  for (i = 0; i < NREGWORDS; i++)
+    s->w[i] |= o->w[i];
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Instruction model
+** =======================================================
+*/
+
+static int isarith (OpCode op) {
+  return (OP_ADDI <= op && op <= OP_SHR);
+}
+
+
+static int isreturn (Instruction i) {
+  switch (GET_OPCODE(i)) {
+    case OP_RETURN0: case OP_RETURN1: return 1;
+    case OP_RETURN: return (GETARG_B(i) != 0);  /* fixed results */
+    default: return 0;
+  }
+}
+
+
+/*
+** Explicit successor of instruction 'pc', other than 'pc + 1', or
+** NOTARGET; '*fall' tells whether execution may also continue with
+** 'pc + 1'. (OP_TAILCALL and OP_LFALSESKIP are treated as falling
+** through; that is only conservative. For OP_LFALSESKIP it also keeps
+** alive the instruction it skips.)
+*/
+static int successor (const Instruction *code, int pc, int *fall) {
+  Instruction i = code[pc];
+  OpCode op = GET_OPCODE(i);
+  *fall = 1;
+  switch (op) {
+    case OP_JMP:
+      *fall = 0;
+      return pc + 1 + GETARG_sJ(i);
+    case OP_LFALSESKIP:
+      return pc + 2;
+    case OP_FORPREP:
+      return pc + GETARG_Bx(i) + 2;
+    case OP_FORLOOP: case OP_TFORLOOP:
+      return pc + 1 - GETARG_Bx(i);
+    case OP_TFORPREP:
+      *fall = 0;
+      return pc + 1 + GETARG_Bx(i);
+    case OP_RETURN: case OP_RETURN0: case OP_RETURN1:
+      *fall = 0;
+      return NOTARGET;
+    default:
+      return testTMode(op) ? pc + 2 : NOTARGET;
+  }
+}
+
+
+/*
+** Registers read ('use'), always written ('def'), and possibly written
+** ('maydef', a superset of 'def') by instruction 'pc'. Instructions
+** that use or set 'top' read or write everything above their base.
+*/
+static void usedef (const Instruction *code, int pc, RegSet *use,
+                    RegSet *def, RegSet *maydef) {
+  Instruction i = code[pc];
+  OpCode op = GET_OPCODE(i);
+  int a = GETARG_A(i);
+  memset(use, 0, sizeof(*use));
+  memset(def, 0, sizeof(*def));
+  memset(maydef, 0, sizeof(*maydef));
+  switch (op) {
+    case OP_MOVE: case OP_UNM: case OP_BNOT: case OP_NOT: case OP_LEN:
+    case OP_GETI: case OP_GETFIELD:
+      addreg(use, GETARG_B(i));
+      addreg(def, a);
+      break;
+    case OP_LOADI: case OP_LOADF: case OP_LOADK: case OP_LOADKX:
+    case OP_LOADFALSE: case OP_LFALSESKIP: case OP_LOADTRUE:
+    case OP_GETUPVAL: case OP_GETTABUP: case OP_NEWTABLE: case OP_CLOSURE:
+      addreg(def, a);
+      break;
+    case OP_LOADNIL:
+      addrange(def, a, a + GETARG_B(i));
+      break;
+    case OP_SETUPVAL: case OP_TBC: case OP_ERRNNIL: case OP_TEST:
+    case OP_RETURN1: case OP_EQK: case OP_EQI: case OP_LTI: case OP_LEI:
+    case OP_GTI: case OP_GEI: case OP_IS:
+      addreg(use, a);
+      break;
+    case OP_GETTABLE: case OP_GETVARG:
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_MOD: case OP_POW:
+    case OP_DIV: case OP_IDIV: case OP_BAND: case OP_BOR: case OP_BXOR:
+    case OP_SHL: case OP_SHR: case OP_SPACESHIP:
+      addreg(use, GETARG_B(i));
+      addreg(use, GETARG_C(i));
+      addreg(def, a);
+      break;
+    case OP_ADDI: case OP_ADDK: case OP_SUBK: case OP_MULK: case OP_MODK:
+    case OP_POWK: case OP_DIVK: case OP_IDIVK: case OP_BANDK: case OP_BORK:
+    case OP_BXORK: case OP_SHLI: case OP_SHRI:
+      addreg(use, GETARG_B(i));
+      addreg(def, a);
+      break;
+    case OP_SETTABUP:
+      if (!GETARG_k(i)) addreg(use, GETARG_C(i));
+      break;
+    case OP_SETTABLE:
+      addreg(use, GETARG_B(i));
+      /* FALLTHROUGH */
+    case OP_SETI: case OP_SETFIELD:
+      addreg(use, a);
+      if (!GETARG_k(i)) addreg(use, GETARG_C(i));
+      break;
+    case OP_SELF:
+      addreg(use, GETARG_B(i));
+      if (!GETARG_k(i)) addreg(use, GETARG_C(i));
+      addrange(def, a, a + 1);
+      break;
+    case OP_MMBIN:
+      addreg(use, GETARG_B(i));
+      /* FALLTHROUGH */
+    case OP_MMBINI: case OP_MMBINK:
+      addreg(use, a);
+      if (pc > 0)  /* result goes to the arithmetic instruction's target */
+        addreg(maydef, GETARG_A(code[pc - 1]));
+      break;
+    case OP_CONCAT:
+      addrange(use, a, a + GETARG_B(i) - 1);
+      addrange(maydef, a, a + GETARG_B(i) - 1);  /* used as work area */
+      addreg(def, a);
+      break;
+    case OP_CLOSE:
+      addrange(use, a, MAXREGS - 1);
+      break;
+    case OP_JMP: case OP_RETURN0: case OP_NOP: case OP_EXTRAARG:
+      break;
+    case OP_EQ: case OP_LT: case OP_LE:
+      addreg(use, a);
+      addreg(use, GETARG_B(i));
+      break;
+    case OP_TESTSET: case OP_TESTNIL:
+      addreg(use, GETARG_B(i));
+      addreg(maydef, a);
+      break;
+    case OP_CALL: case OP_TAILCALL: {
+      int b = GETARG_B(i);
+      int c = GETARG_C(i);
+      addrange(use, a, (b != 0) ? a + b - 1 : MAXREGS - 1);
+      if (op == OP_CALL && c != 0)
+        addrange(def, a, a + c - 2);
+      addrange(maydef, a, MAXREGS - 1);  /* callee frame reuses the stack */
+      break;
+    }
+    case OP_RETURN: {
+      int b = GETARG_B(i);
+      addrange(use, a, (b != 0) ? a + b - 2 : MAXREGS - 1);
+      break;
+    }
+    case OP_FORPREP: case OP_FORLOOP:
+      addrange(use, a, a + 3);
+      addrange(maydef, a, a + 3);
+      break;
+    case OP_TFORPREP:
+      addrange(use, a, a + 3);
+      break;
+    case OP_TFORCALL:
+      addrange(use, a, a + 3);
+      addrange(maydef, a + 4, MAXREGS - 1);
+      break;
+    case OP_TFORLOOP:
+      addrange(use, a, a + 4);
+      addrange(maydef, a, a + 4);
+      break;
+    case OP_SETLIST: {
+      int b = GETARG_B(i);
+      addrange(use, a, (b != 0) ? a + b : MAXREGS - 1);
+      break;
+    }
+    case OP_VARARG: {
+      int c = GETARG_C(i);
+      if (GETARG_k(i)) addreg(use, GETARG_B(i));  /* vararg table */
+      if (c != 0)
+        addrange(def, a, a + c - 2);
+      else
+        addrange(maydef, a, MAXREGS - 1);
+      break;
+    }
+    default:  /* not modeled */
+      addall(use);
+      addall(maydef);
+      break;
+  }
+  setunion(maydef, def);
+}
+
+
+static int fitsC (lua_Integer i) {
+  return (l_castS2U(i) + OFFSET_sC <= cast_uint(MAXARG_C));
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Flow information
+** =======================================================
+*/
+
+static void computeflow (OptState *o) {
+  int pc;
+  for (pc = 0; pc < o->n; pc++)
+    o->flags[pc] &= ~(F_TARGET | F_FALL);
+  for (pc = 0; pc < o->n; pc++) {
+    int fall;
+    int t = successor(o->code, pc, &fall);
+    o->jt[pc] = t;
+    if (fall)
+      o->flags[pc] |= F_FALL;
+    if (t != NOTARGET)
+      o->flags[t] |= F_TARGET;
+    if (GET_OPCODE(o->code[pc]) == OP_LFALSESKIP && pc + 1 < o->n)
+      o->flags[pc + 1] |= F_TARGET;  /* only reachable through jumps */
+  }
+}
+
+
+/*
+** Mark reachable instructions; unreachable ones become OP_NOP.
+*/
+static int prune (OptState *o) {
+  int *stack = o->aux;
+  int sp = 0;
+  int pc, changed = 0;
+  for (pc = 0; pc < o->n; pc++)
+    o->flags[pc] &= ~F_REACH;
+  o->flags[0] |= F_REACH;
+  stack[sp++] = 0;
+  while (sp > 0) {
+    int succ[2];
+    int i;
+    pc = stack[--sp];
+    succ[0] = (o->flags[pc] & F_FALL) ? pc + 1 : NOTARGET;
+    succ[1] = o->jt[pc];
+    for (i = 0; i < 2; i++) {
+      int s = succ[i];
+      if (s != NOTARGET && s < o->n && !(o->flags[s] & F_REACH)) {
+        o->flags[s] |= F_REACH;
+        stack[sp++] = s;
+      }
+    }
+  }
+  for (pc = 0; pc < o->n; pc++) {
+    if (!(o->flags[pc] & F_REACH) && GET_OPCODE(o->code[pc]) != OP_NOP) {
+      o->code[pc] = CREATE_ABCk(OP_NOP, 0, 0, 0, 0);
+      changed = 1;
+    }
+  }
+  return changed;
+}
+
+
+/*
+** Registers that other functions capture as upvalues, and to-be-closed
+** variables: their values are observable outside the code of the
+** function.
+*/
+static void pinregs (OptState *o) {
+  Proto *f = o->f;
+  int i, j;
+  memset(&o->pinned, 0, sizeof(o->pinned));
+  for (i = 0; i < f->sizep; i++) {
+    Proto *p = f->p[i];
+    for (j = 0; j < p->sizeupvalues; j++) {
+      if (p->upvalues[j].instack)
+        addreg(&o->pinned, p->upvalues[j].idx);
+    }
+  }
+  for (i = 0; i < o->n; i++) {
+    Instruction inst = o->code[i];
+    if (GET_OPCODE(inst) == OP_TBC)
+      addreg(&o->pinned, GETARG_A(inst));
+    else if (GET_OPCODE(inst) == OP_TFORPREP)
+      addreg(&o->pinned, GETARG_A(inst) + 3);
+  }
+}
+
+
+/*
+** First instruction after the store of the value of a variable in
+** register 'r' that starts at 'startpc'. A multiple assignment stores
+** all its values before any of its variables starts.
+*/
+static int namedfrom (OptState *o, int startpc, int r) {
+  int pc;
+  for (pc = startpc - 1; pc >= 0; pc--) {
+    RegSet use, def, maydef;
+    usedef(o->code, pc, &use, &def, &maydef);
+    if (hasreg(&maydef, r))
+      break;
+  }
+  return pc + 1;
+}
+
+
+/*
+** Compute 'nact' (number of named registers at each pc) and the
+** register of each local variable. Variables are properly nested, so
+** the register of a variable is the number of variables still active
+** when it starts. A register counts as named from the store of its
+** variable's value on.
+*/
+static void localregs (OptState *o) {
+  Proto *f = o->f;
+  int *stack = o->aux;
+  int sp = 0;
+  int i, pc, count = 0;
+  memset(o->nact, 0, (o->n + 1) * sizeof(int));
+  for (i = 0; i < f->sizelocvars; i++) {
+    LocVar *v = &f->locvars[i];
+    while (sp > 0 && f->locvars[stack[sp - 1]].endpc <= v->startpc)
+      sp--;
+    o->lvreg[i] = sp;
+    stack[sp++] = i;
+    if (0 <= v->startpc && v->startpc < v->endpc && v->endpc <= o->n) {
+      o->nact[namedfrom(o, v->startpc, o->lvreg[i])]++;
+      o->nact[v->endpc]--;
+    }
+  }
+  for (pc = 0; pc <= o->n; pc++) {  /* prefix sums */
+    count += o->nact[pc];
+    o->nact[pc] = count;
+  }
+}
+
+
+#define isnamed(o,pc,r)	((r) < (o)->nact[pc])
+
+
+static void liveness (OptState *o) {
+  int changed;
+  memset(o->live, 0, o->n * sizeof(RegSet));
+  do {
+    int pc;
+    changed = 0;
+    for (pc = o->n - 1; pc >= 0; pc--) {
+      RegSet in, use, def, maydef;
+      int w;
+      usedef(o->code, pc, &use, &def, &maydef);
+      memset(&in, 0, sizeof(in));
+      if ((o->flags[pc] & F_FALL) && pc + 1 < o->n)
+        setunion(&in, &o->live[pc + 1]);
+      if (o->jt[pc] != NOTARGET)
+        setunion(&in, &o->live[o->jt[pc]]);
+      for (w = 0; w < NREGWORDS; w++)
+        in.w[w] = use.w[w] | (in.w[w] & ~def.w[w]) | o->pinned.w[w];
+      if (memcmp(&in, &o->live[pc], sizeof(in)) != 0) {
+        o->live[pc] = in;
+        changed = 1;
+      }
+    }
+  } while (changed);
+}
+
+
+/* whether register 'r' may be read after instruction 'pc' */
+static int liveafter (OptState *o, int pc, int r) {
+  if ((o->flags[pc] & F_FALL) && pc + 1 < o->n && hasreg(&o->live[pc + 1], r))
+    return 1;
+  return (o->jt[pc] != NOTARGET && hasreg(&o->live[o->jt[pc]], r));
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Jump threading
+** =======================================================
+*/
+
+static int finaltarget (const Instruction *code, int n, int i) {
+  int count;
+  for (count = 0; count < 100; count++) {  /* avoid infinite loops */
+    int j = i;
+    while (j < n && GET_OPCODE(code[j]) == OP_NOP)
+      j++;
+    if (j >= n)
+      break;
+    i = j;
+    if (GET_OPCODE(code[i]) != OP_JMP)
+      break;
+    i += GETARG_sJ(code[i]) + 1;
+  }
+  return i;
+}
+
+
+/*
+** Make jumps go straight to their final destination, and replace a
+** jump to a return by a copy of that return. (A jump that follows a
+** test is left a jump; the test relies on it.)
+*/
+static int threadjumps (OptState *o) {
+  Instruction *code = o->code;
+  int pc, changed = 0;
+  for (pc = 0; pc < o->n; pc++) {
+    Instruction i = code[pc];
+    int dest, target;
+    if (GET_OPCODE(i) != OP_JMP)
+      continue;
+    dest = pc + 1 + GETARG_sJ(i);
+    target = finaltarget(code, o->n, dest);
+    if (target != dest) {
+      SETARG_sJ(code[pc], target - (pc + 1));
+      changed = 1;
+    }
+    if (isreturn(code[target]) &&
+        !(pc > 0 && testTMode(GET_OPCODE(code[pc - 1])))) {
+      code[pc] = code[target];
+      changed = 1;
+    }
+  }
+  return changed;
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Constant propagation
+** =======================================================
+*/
+
+/* kinds of known register contents */
+#define CNONE	0
+#define CINT	1  /* integer loaded by OP_LOADI */
+#define CK	2  /* constant loaded by OP_LOADK */
+
+
+static int loadconst (Instruction i, int r, lua_Integer *v) {
+  if (GETARG_A(i) != r)
+    return CNONE;
+  switch (GET_OPCODE(i)) {
+    case OP_LOADI: *v = GETARG_sBx(i); return CINT;
+    case OP_LOADK: *v = GETARG_Bx(i); return CK;
+    default: return CNONE;
+  }
+}
+
+
+/*
+** Walk back from 'pc' while the code runs straight (each instruction
+** can only be reached from the previous one) and return the last
+** instruction before 'pc' that may write register 'r', or -1. 'pc'
+** itself may be a jump target when 'anyentry' is true.
+*/
+static int lastdef (OptState *o, int pc, int r, int anyentry) {
+  if (!anyentry && (o->flags[pc] & F_TARGET))
+    return -1;
+  while (pc > 0 && (o->flags[pc - 1] & F_FALL)) {
+    RegSet use, def, maydef;
+    pc--;
+    usedef(o->code, pc, &use, &def, &maydef);
+    if (hasreg(&maydef, r))
+      return pc;
+    if (o->flags[pc] & F_TARGET)
+      break;
+  }
+  return -1;
+}
+
+
+/*
+** Check whether local variable 'lv' keeps, over its whole scope, the
+** constant it receives right before the scope starts: nothing inside
+** the scope may write its register, and the scope can only be entered
+** through its first instruction. Returns the loading instruction or -1.
+*/
+static int constlocal (OptState *o, int lv) {
+  LocVar *v = &o->f->locvars[lv];
+  int s = v->startpc, e = v->endpc;
+  int r = o->lvreg[lv];
+  int d, pc;
+  lua_Integer dummy;
+  if (o->lvload[lv] != -2)  /* already computed? */
+    return o->lvload[lv];
+  o->lvload[lv] = -1;
+  if (r >= MAXREGS || hasreg(&o->pinned, r) || s <= 0 || s >= e || e > o->n)
+    return -1;
+  d = lastdef(o, s, r, 1);
+  if (d < 0 || loadconst(o->code[d], r, &dummy) == CNONE)
+    return -1;
+  for (pc = s; pc < e; pc++) {
+    RegSet use, def, maydef;
+    usedef(o->code, pc, &use, &def, &maydef);
+    if (hasreg(&maydef, r))
+      return -1;
+  }
+  for (pc = 0; pc < o->n; pc++) {
+    int t = o->jt[pc];
+    if ((pc < s || pc >= e) && s <= t && t < e)
+      return -1;  /* scope entered from outside */
+  }
+  return (o->lvload[lv] = d);
+}
+
+
+/*
+** Constant known to be in register 'r' when instruction 'pc' runs.
+*/
+static int getconst (OptState *o, int pc, int r, lua_Integer *v) {
+  Proto *f = o->f;
+  int d, lv;
+  if (hasreg(&o->pinned, r))
+    return CNONE;
+  d = lastdef(o, pc, r, 0);
+  if (d >= 0)
+    return loadconst(o->code[d], r, v);
+  for (lv = 0; lv < f->sizelocvars; lv++) {
+    LocVar *var = &f->locvars[lv];
+    if (o->lvreg[lv] == r && var->startpc <= pc && pc < var->endpc) {
+      d = constlocal(o, lv);
+      return (d >= 0) ? loadconst(o->code[d], r, v) : CNONE;
+    }
+  }
+  return CNONE;
+}
+
+
+static int isnumK (OptState *o, int kind, lua_Integer v, int maxarg) {
+  return (kind == CK && v <= maxarg && ttisnumber(&o->f->k[v]));
+}
+
+
+static int isintK (OptState *o, int kind, lua_Integer v, int maxarg) {
+  return (kind == CK && v <= maxarg && ttisinteger(&o->f->k[v]));
+}
+
+
+static int isstrK (OptState *o, int kind, lua_Integer v, int maxarg) {
+  return (kind == CK && v <= maxarg && ttisshrstring(&o->f->k[v]));
+}
+
+
+/*
+** Rewrite an arithmetic instruction over two registers (at 'pc', with
+** its OP_MMBIN at 'pc + 1') when one of them holds a constant, the
+** same way 'codearith', 'codecommutative', and 'codebitwise' would
+** have coded it had the constant been written in the expression.
+*/
+static int constarith (OptState *o, int pc) {
+  Instruction *ip = &o->code[pc];
+  Instruction *mm = &o->code[pc + 1];
+  OpCode op = GET_OPCODE(*ip);
+  int a = GETARG_A(*ip), b = GETARG_B(*ip), c = GETARG_C(*ip);
+  TMS event = cast(TMS, GETARG_C(*mm));
+  lua_Integer vb = 0, vc = 0;
+  int kb, kc;
+  int commut = (op == OP_ADD || op == OP_MUL || op == OP_BAND ||
+                op == OP_BOR || op == OP_BXOR);
+  if (GET_OPCODE(*mm) != OP_MMBIN || GETARG_A(*mm) != b || GETARG_B(*mm) != c)
+    return 0;
+  kb = getconst(o, pc, b, &vb);
+  kc = getconst(o, pc, c, &vc);
+  if (op == OP_ADD && kc == CINT && fitsC(vc)) {
+    *ip = CREATE_ABCk(OP_ADDI, a, b, int2sC(cast_int(vc)), 0);
+    *mm = CREATE_ABCk(OP_MMBINI, b, int2sC(cast_int(vc)), event, 0);
+  }
+  else if (op == OP_ADD && kb == CINT && fitsC(vb)) {
+    *ip = CREATE_ABCk(OP_ADDI, a, c, int2sC(cast_int(vb)), 0);
+    *mm = CREATE_ABCk(OP_MMBINI, c, int2sC(cast_int(vb)), event, 1);
+  }
+  else if ((op == OP_SUB || op == OP_SHL) &&
+           kc == CINT && fitsC(vc) && fitsC(-vc)) {  /* negated operand */
+    OpCode nop = (op == OP_SUB) ? OP_ADDI : OP_SHRI;
+    *ip = CREATE_ABCk(nop, a, b, int2sC(-cast_int(vc)), 0);
+    *mm = CREATE_ABCk(OP_MMBINI, b, int2sC(cast_int(vc)), event, 0);
+  }
+  else if (op == OP_SHR && kc == CINT && fitsC(vc)) {
+    *ip = CREATE_ABCk(OP_SHRI, a, b, int2sC(cast_int(vc)), 0);
+    *mm = CREATE_ABCk(OP_MMBINI, b, int2sC(cast_int(vc)), event, 0);
+  }
+  else if (op == OP_SHL && kb == CINT && fitsC(vb)) {
+    *ip = CREATE_ABCk(OP_SHLI, a, c, int2sC(cast_int(vb)), 0);
+    *mm = CREATE_ABCk(OP_MMBINI, c, int2sC(cast_int(vb)), event, 1);
+  }
+  else if (op <= OP_IDIV ? isnumK(o, kc, vc, MAXARG_C)
+                         : (op <= OP_BXOR && isintK(o, kc, vc, MAXARG_C))) {
+    OpCode kop = cast(OpCode, op - OP_ADD + OP_ADDK);
+    *ip = CREATE_ABCk(kop, a, b, cast_int(vc), 0);
+    *mm = CREATE_ABCk(OP_MMBINK, b, cast_int(vc), event, 0);
+  }
+  else if (commut && (op <= OP_IDIV ? isnumK(o, kb, vb, MAXARG_C)
+                                    : isintK(o, kb, vb, MAXARG_C))) {
+    OpCode kop = cast(OpCode, op - OP_ADD + OP_ADDK);
+    *ip = CREATE_ABCk(kop, a, c, cast_int(vb), 0);
+    *mm = CREATE_ABCk(OP_MMBINK, c, cast_int(vb), event, 1);
+  }
+  else
+    return 0;
+  return 1;
+}
+
+
+/*
+** Put a constant value operand 'C' of a table store in K.
+*/
+static int constvalue (OptState *o, int pc) {
+  Instruction *ip = &o->code[pc];
+  lua_Integer v;
+  int kind;
+  if (GETARG_k(*ip))
+    return 0;
+  kind = getconst(o, pc, GETARG_C(*ip), &v);
+  if (kind == CK && v <= MAXARG_C) {
+    SETARG_C(*ip, cast_int(v));
+    SETARG_k(*ip, 1);
+    return 1;
+  }
+  return 0;
+}
+
+
+static int constoperands (OptState *o, int pc) {
+  Instruction *ip = &o->code[pc];
+  Instruction i = *ip;
+  OpCode op = GET_OPCODE(i);
+  lua_Integer v;
+  int kind;
+  switch (op) {
+    case OP_EQ: {
+      int a = GETARG_A(i), b = GETARG_B(i), k = GETARG_k(i);
+      int r = a;  /* register operand */
+      kind = getconst(o, pc, b, &v);
+      if (kind == CNONE) {  /* try the other operand ('==' commutes) */
+        kind = getconst(o, pc, a, &v);
+        r = b;
+      }
+      if (kind == CINT && fitsC(v))
+        *ip = CREATE_ABCk(OP_EQI, r, int2sC(cast_int(v)), 0, k);
+      else if (kind == CK && v <= MAXARG_B)
+        *ip = CREATE_ABCk(OP_EQK, r, cast_int(v), 0, k);
+      else
+        return 0;
+      return 1;
+    }
+    case OP_LT: case OP_LE: {
+      int a = GETARG_A(i), b = GETARG_B(i), k = GETARG_k(i);
+      if (getconst(o, pc, b, &v) == CINT && fitsC(v))
+        *ip = CREATE_ABCk(op == OP_LT ? OP_LTI : OP_LEI, a,
+                          int2sC(cast_int(v)), 0, k);
+      else if (getconst(o, pc, a, &v) == CINT && fitsC(v))  /* b > a */
+        *ip = CREATE_ABCk(op == OP_LT ? OP_GTI : OP_GEI, b,
+                          int2sC(cast_int(v)), 0, k);
+      else
+        return 0;
+      return 1;
+    }
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_MOD: case OP_POW:
+    case OP_DIV: case OP_IDIV: case OP_BAND: case OP_BOR: case OP_BXOR:
+    case OP_SHL: case OP_SHR:
+      return (pc + 1 < o->n && constarith(o, pc));
+    case OP_GETTABLE: {
+      kind = getconst(o, pc, GETARG_C(i), &v);
+      if (isstrK(o, kind, v, MAXARG_C))
+        *ip = CREATE_ABCk(OP_GETFIELD, GETARG_A(i), GETARG_B(i),
+                          cast_int(v), 0);
+      else if (kind == CINT && 0 <= v && v <= MAXARG_C)
+        *ip = CREATE_ABCk(OP_GETI, GETARG_A(i), GETARG_B(i), cast_int(v), 0);
+      else
+        return 0;
+      return 1;
+    }
+    case OP_SETTABLE: {
+      int changed = 0;
+      kind = getconst(o, pc, GETARG_B(i), &v);
+      if (isstrK(o, kind, v, MAXARG_B)) {
+        SET_OPCODE(*ip, OP_SETFIELD);
+        SETARG_B(*ip, cast_int(v));
+        changed = 1;
+      }
+      else if (kind == CINT && 0 <= v && v <= MAXARG_B) {
+        SET_OPCODE(*ip, OP_SETI);
+        SETARG_B(*ip, cast_int(v));
+        changed = 1;
+      }
+      return constvalue(o, pc) || changed;
+    }
+    case OP_SETI: case OP_SETFIELD: case OP_SETTABUP:
+      return constvalue(o, pc);
+    default:
+      return 0;
+  }
+}
+
+
+static int constprop (OptState *o) {
+  int pc, changed = 0;
+  int i;
+  for (i = 0; i < o->f->sizelocvars; i++)
+    o->lvload[i] = -2;  /* not computed */
+  for (pc = 0; pc < o->n; pc++) {
+    if (constoperands(o, pc))
+      changed = 1;
+  }
+  return changed;
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Register copies
+** =======================================================
+*/
+
+#define renamefield(i,F,t,x)  \
+	{ if (GETARG_##F(*(i)) == (t)) SETARG_##F(*(i), (x)); }
+
+
+/*
+** Make instruction 'i' read register 'x' instead of register 't'.
+** Returns 0 if 'i' is not an instruction whose operands can be
+** renamed.
+*/
+static int renameuses (Instruction *i, int t, int x) {
+  switch (GET_OPCODE(*i)) {
+    case OP_MOVE: case OP_UNM: case OP_BNOT: case OP_NOT: case OP_LEN:
+    case OP_GETI: case OP_GETFIELD: case OP_TESTSET:
+    case OP_ADDI: case OP_ADDK: case OP_SUBK: case OP_MULK: case OP_MODK:
+    case OP_POWK: case OP_DIVK: case OP_IDIVK: case OP_BANDK: case OP_BORK:
+    case OP_BXORK: case OP_SHLI: case OP_SHRI:
+      renamefield(i, B, t, x);
+      return 1;
+    case OP_GETTABLE:
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_MOD: case OP_POW:
+    case OP_DIV: case OP_IDIV: case OP_BAND: case OP_BOR: case OP_BXOR:
+    case OP_SHL: case OP_SHR:
+      renamefield(i, B, t, x);
+      renamefield(i, C, t, x);
+      return 1;
+    case OP_SETUPVAL: case OP_TEST: case OP_RETURN1: case OP_EQK:
+    case OP_EQI: case OP_LTI: case OP_LEI: case OP_GTI: case OP_GEI:
+    case OP_MMBINI: case OP_MMBINK:
+      renamefield(i, A, t, x);
+      return 1;
+    case OP_EQ: case OP_LT: case OP_LE: case OP_MMBIN:
+      renamefield(i, A, t, x);
+      renamefield(i, B, t, x);
+      return 1;
+    case OP_SETTABUP:
+      if (!GETARG_k(*i)) renamefield(i, C, t, x);
+      return 1;
+    case OP_SETTABLE:
+      renamefield(i, B, t, x);
+      /* FALLTHROUGH */
+    case OP_SETI: case OP_SETFIELD:
+      renamefield(i, A, t, x);
+      if (!GETARG_k(*i)) renamefield(i, C, t, x);
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+
+/*
+** Forward copy propagation: in 'MOVE t x; J', make 'J' (and its
+** OP_MMBIN) read 'x' directly, when that leaves the MOVE dead.
+*/
+static int copyforward (OptState *o) {
+  Instruction *code = o->code;
+  int pc, changed = 0;
+  for (pc = 0; pc < o->n; pc++)
+    o->flags[pc] &= ~F_TOUCHED;
+  for (pc = 0; pc + 1 < o->n; pc++) {
+    Instruction i = code[pc];
+    int t = GETARG_A(i), x, j = pc + 1, last = pc + 1;
+    RegSet use, def, maydef;
+    Instruction nj, nl;
+    if (GET_OPCODE(i) != OP_MOVE)
+      continue;
+    x = GETARG_B(i);
+    if (t == x || hasreg(&o->pinned, t) || isnamed(o, pc + 1, t) ||
+        ((o->flags[pc] | o->flags[j]) & F_TOUCHED) ||
+        (o->flags[j] & F_TARGET))
+      continue;
+    if (isarith(GET_OPCODE(code[j])))
+      last = j + 1;  /* OP_MMBIN reads the same operands */
+    nj = code[j];
+    nl = code[last];
+    if (!renameuses(&nj, t, x) || (last != j && !renameuses(&nl, t, x)))
+      continue;
+    usedef(code, j, &use, &def, &maydef);
+    if (liveafter(o, last, t) && !hasreg(&def, t))
+      continue;  /* someone else still reads the copy */
+    code[j] = nj;
+    code[last] = nl;
+    code[pc] = CREATE_ABCk(OP_NOP, 0, 0, 0, 0);
+    o->flags[pc] |= F_TOUCHED;
+    o->flags[j] |= F_TOUCHED;
+    o->flags[last] |= F_TOUCHED;
+    changed = 1;
+  }
+  return changed;
+}
+
+
+/*
+** Instructions that write only register A, read their operands before
+** that, and do not use A as a stack limit (as those that run the
+** collector with 'checkGC(L, ra + 1)' do).
+*/
+static int retargetable (OpCode op) {
+  switch (op) {
+    case OP_MOVE: case OP_LOADI: case OP_LOADF: case OP_LOADK:
+    case OP_LOADFALSE: case OP_LOADTRUE: case OP_GETUPVAL:
+    case OP_GETTABUP: case OP_GETTABLE: case OP_GETI: case OP_GETFIELD:
+    case OP_UNM: case OP_BNOT: case OP_NOT: case OP_LEN:
+      return 1;
+    default:
+      return isarith(op);
+  }
+}
+
+
+/*
+** Backward coalescing: in 'I t ...; [MMBIN]; MOVE x t', make 'I' write
+** 'x' directly when 't' is not read after the MOVE.
+*/
+static int copybackward (OptState *o) {
+  Instruction *code = o->code;
+  int pc, changed = 0;
+  for (pc = 0; pc < o->n; pc++)
+    o->flags[pc] &= ~F_TOUCHED;
+  for (pc = 1; pc < o->n; pc++) {
+    Instruction i = code[pc];
+    int x = GETARG_A(i), t, p = pc - 1;
+    if (GET_OPCODE(i) != OP_MOVE || (o->flags[pc] & (F_TARGET | F_TOUCHED)))
+      continue;
+    t = GETARG_B(i);
+    if (t == x || hasreg(&o->pinned, t) || isnamed(o, pc, t))
+      continue;
+    if (testMMMode(GET_OPCODE(code[p]))) {
+      if (o->flags[p] & F_TARGET)
+        continue;
+      p--;  /* skip OP_MMBIN to its arithmetic instruction */
+      if (p < 0 || !isarith(GET_OPCODE(code[p])))
+        continue;
+    }
+    else if (isarith(GET_OPCODE(code[p])))
+      continue;  /* (cannot happen: MMBIN always follows) */
+    if (!retargetable(GET_OPCODE(code[p])) || GETARG_A(code[p]) != t ||
+        (o->flags[p] & F_TOUCHED) || isnamed(o, p + 1, t) ||
+        liveafter(o, pc, t))
+      continue;
+    SETARG_A(code[p], x);
+    code[pc] = CREATE_ABCk(OP_NOP, 0, 0, 0, 0);
+    o->flags[p] |= F_TOUCHED;
+    o->flags[pc] |= F_TOUCHED;
+    changed = 1;
+  }
+  return changed;
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Dead stores
+** =======================================================
+*/
+
+static int puredef (Instruction i, int *first, int *last) {
+  *first = *last = GETARG_A(i);
+  switch (GET_OPCODE(i)) {
+    case OP_MOVE: case OP_LOADI: case OP_LOADF: case OP_LOADK:
+    case OP_LOADFALSE: case OP_LOADTRUE: case OP_GETUPVAL:
+      return 1;
+    case OP_LOADNIL:
+      *last += GETARG_B(i);
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+
+/*
+** Remove loads and copies into temporary registers that nobody reads,
+** and copies of a register into itself. Named variables keep their
+** stores so that the debug library still sees their values.
+*/
+static int deadstores (OptState *o) {
+  Instruction *code = o->code;
+  int pc, changed = 0;
+  for (pc = 0; pc < o->n; pc++) {
+    Instruction i = code[pc];
+    int first, last, r;
+    if (!puredef(i, &first, &last))
+      continue;
+    if (pc > 0 && GET_OPCODE(code[pc - 1]) == OP_LFALSESKIP)
+      continue;  /* skipped instruction must stay there */
+    if (!(GET_OPCODE(i) == OP_MOVE && first == GETARG_B(i))) {
+      for (r = first; r <= last; r++) {
+        if (r >= MAXREGS || hasreg(&o->pinned, r) ||
+            isnamed(o, pc + 1, r) || liveafter(o, pc, r))
+          break;
+      }
+      if (r <= last)
+        continue;  /* some register is still needed */
+    }
+    code[pc] = CREATE_ABCk(OP_NOP, 0, 0, 0, 0);
+    changed = 1;
+  }
+  return changed;
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Compaction
+** =======================================================
+*/
+
+/*
+** Drop jumps to the instruction that would run next anyway (except
+** those that follow a test).
+*/
+static void dropnextjumps (OptState *o) {
+  Instruction *code = o->code;
+  int *next = o->aux;
+  int changed;
+  do {
+    int pc;
+    changed = 0;
+    next[o->n] = o->n;
+    for (pc = o->n - 1; pc >= 0; pc--)
+      next[pc] = (GET_OPCODE(code[pc]) != OP_NOP) ? pc : next[pc + 1];
+    for (pc = 0; pc < o->n; pc++) {
+      Instruction i = code[pc];
+      if (GET_OPCODE(i) == OP_JMP &&
+          !(pc > 0 && testTMode(GET_OPCODE(code[pc - 1]))) &&
+          next[pc + 1 + GETARG_sJ(i)] == next[pc + 1]) {
+        code[pc] = CREATE_ABCk(OP_NOP, 0, 0, 0, 0);
+        changed = 1;
+      }
+    }
+  } while (changed);
+}
+
+
+/*
+** Re-encode line information for the instructions that remain, with
+** the same rules used by 'savelineinfo'.
+*/
+static void fixlines (OptState *o, const int *lines, int newn) {
+  lua_State *L = o->L;
+  Proto *f = o->f;
+  AbsLineInfo *newabs;
+  int nabs = 0, iwthabs = 0;
+  int previousline = f->linedefined;
+  int pc;
+  for (pc = 0; pc < newn; pc++) {  /* count absolute entries */
+    if (abs(lines[pc] - previousline) >= LIMLINEDIFF ||
+        iwthabs++ >= MAXIWTHABS) {
+      nabs++;
+      iwthabs = 1;
+    }
+    previousline = lines[pc];
+  }
+  newabs = luaM_newvector(L, nabs, AbsLineInfo);
+  nabs = iwthabs = 0;
+  previousline = f->linedefined;
+  for (pc = 0; pc < newn; pc++) {
+    int linedif = lines[pc] - previousline;
+    if (abs(linedif) >= LIMLINEDIFF || iwthabs++ >= MAXIWTHABS) {
+      newabs[nabs].pc = pc;
+      newabs[nabs++].line = lines[pc];
+      linedif = ABSLINEINFO;
+      iwthabs = 1;
+    }
+    f->lineinfo[pc] = cast(ls_byte, linedif);
+    previousline = lines[pc];
+  }
+  luaM_freearray(L, f->abslineinfo, f->sizeabslineinfo);
+  f->abslineinfo = newabs;
+  f->sizeabslineinfo = nabs;
+}
+
+
+static void compact (OptState *o) {
+  lua_State *L = o->L;
+  Proto *f = o->f;
+  Instruction *code = o->code;
+  int *newpc = o->jt;  /* flow information is not needed anymore */
+  int *lines = o->aux;
+  int pc, newn = 0, absi = 0, line = f->linedefined;
+  dropnextjumps(o);
+  /* decode current lines (before code moves) */
+  for (pc = 0; pc < o->n; pc++) {
+    if (f->lineinfo[pc] != ABSLINEINFO)
+      line += f->lineinfo[pc];
+    else {
+      lua_assert(absi < f->sizeabslineinfo &&
+                 f->abslineinfo[absi].pc == pc);
+      line = f->abslineinfo[absi++].line;
+    }
+    lines[pc] = line;
+  }
+  for (pc = 0; pc < o->n; pc++) {  /* new address of each instruction */
+    newpc[pc] = newn;
+    if (GET_OPCODE(code[pc]) != OP_NOP)
+      newn++;
+  }
+  newpc[o->n] = newn;  /* ('jt' has room for that) */
+  for (pc = 0; pc < o->n; pc++) {
+    Instruction i = code[pc];
+    int np = newpc[pc];
+    if (GET_OPCODE(i) == OP_NOP)
+      continue;
+    switch (GET_OPCODE(i)) {
+      case OP_JMP:
+        SETARG_sJ(i, newpc[pc + 1 + GETARG_sJ(i)] - (np + 1));
+        break;
+      case OP_FORPREP:
+        SETARG_Bx(i, newpc[pc + GETARG_Bx(i) + 2] - np - 2);
+        break;
+      case OP_FORLOOP: case OP_TFORLOOP:
+        SETARG_Bx(i, np + 1 - newpc[pc + 1 - GETARG_Bx(i)]);
+        break;
+      case OP_TFORPREP:
+        SETARG_Bx(i, newpc[pc + 1 + GETARG_Bx(i)] - np - 1);
+        break;
+      default: break;
+    }
+    code[np] = i;
+    lines[np] = lines[pc];
+  }
+  for (pc = 0; pc < f->sizelocvars; pc++) {
+    LocVar *v = &f->locvars[pc];
+    if (0 <= v->startpc && v->startpc <= o->n)
+      v->startpc = newpc[v->startpc];
+    if (0 <= v->endpc && v->endpc <= o->n)
+      v->endpc = newpc[v->endpc];
+  }
+  fixlines(o, lines, newn);
+  luaM_shrinkvector(L, f->code, f->sizecode, newn, Instruction);
+  luaM_shrinkvector(L, f->lineinfo, f->sizelineinfo, newn, ls_byte);
+  o->code = f->code;
+  o->n = newn;
+}
+
+/* }====================================================== */
+
+
+
+/*
+** Optimize the code of function 'f', whose code generation is complete.
+** Work memory lives in a userdata anchored on the stack, so that it is
+** collected if some allocation raises an error.
+*/
+void luaK_optimize (lua_State *L, Proto *f) {
+  OptState o;
+  Udata *u;
+  char *mem;
+  int n = f->sizecode;
+  int nlv = f->sizelocvars;
+  int round, changed;
+  size_t size;
+  if (n == 0 || f->sizelineinfo != n)  /* nothing to do or no line info? */
+    return;
+  size = n * sizeof(RegSet) + (4 * (n + 1) + 3 * nlv) * sizeof(int) + n;
+  u = luaS_newudata(L, size, 0);
+  setuvalue(L, s2v(L->top.p), u);  /* anchor it */
+  luaD_inctop(L);
+  mem = cast_charp(getudatamem(u));
+  o.L = L;
+  o.f = f;
+  o.code = f->code;
+  o.n = n;
+  o.live = cast(RegSet *, mem); mem += n * sizeof(RegSet);
+  o.jt = cast(int *, mem); mem += (n + 1) * sizeof(int);
+  o.nact = cast(int *, mem); mem += (n + 1) * sizeof(int);
+  o.aux = cast(int *, mem); mem += (2 * (n + 1) + nlv) * sizeof(int);
+  o.lvreg = cast(int *, mem); mem += nlv * sizeof(int);
+  o.lvload = cast(int *, mem); mem += nlv * sizeof(int);
+  o.flags = cast(lu_byte *, mem);
+  memset(o.flags, 0, n);
+  pinregs(&o);
+  localregs(&o);
+  round = 0;
+  do {
+    changed = threadjumps(&o);
+    computeflow(&o);
+    if (prune(&o))
+      changed = 1;
+    computeflow(&o);  /* NOPs have no explicit successors */
+    if (constprop(&o))
+      changed = 1;
+    liveness(&o);
+    if (copyforward(&o))
+      changed = 1;
+    liveness(&o);
+    if (copybackward(&o))
+      changed = 1;
+    liveness(&o);
+    if (deadstores(&o))
+      changed = 1;
+  } while (changed && ++round < MAXROUNDS);
+  compact(&o);
+  L->top.p--;  /* remove work memory */
+  lua_assert(luaK_checkcode(f) == NULL);
+}
+
+
+
+#if defined(LUA_DEBUG)
+
+/*
+** Structural checks over the code of a finished function: jumps land
+** inside the function, tests are followed by jumps, instructions with
+** an extra argument have it, metamethod calls follow their arithmetic
+** instruction, multiple results are produced right before they are
+** consumed, and debug information matches the code. Returns a message
+** for the first problem found, or NULL.
+*/
+const char *luaK_checkcode (const Proto *f) {
+  const Instruction *code = f->code;
+  int n = f->sizecode;
+  int pc, absi = 0;
+  if (n == 0)
+    return "empty code";
+  for (pc = 0; pc < n; pc++) {
+    Instruction i;
+    OpCode op;
+    int fall, t;
+    if (GET_OPCODE(code[pc]) >= NUM_ALLOPCODES)
+      return "invalid opcode";
+    i = unquickened(code[pc]);  /* code may be running */
+    op = GET_OPCODE(i);
+    t = successor(code, pc, &fall);
+    if (t != NOTARGET && (t < 0 || t >= n))
+      return "jump out of the function";
+    if (testTMode(op) && (pc + 1 >= n || GET_OPCODE(code[pc + 1]) != OP_JMP))
+      return "test not followed by a jump";
+    if ((op == OP_LOADKX || op == OP_NEWTABLE ||
+         (op == OP_SETLIST && TESTARG_k(i))) &&
+        (pc + 1 >= n || GET_OPCODE(code[pc + 1]) != OP_EXTRAARG))
+      return "missing extra argument";
+    if (testMMMode(op) &&
+        (pc == 0 || !isarith(GET_OPCODE(unquickened(code[pc - 1])))))
+      return "metamethod call without arithmetic instruction";
+    if (op == OP_TFORPREP &&
+        (t + 1 >= n || GET_OPCODE(code[t]) != OP_TFORCALL ||
+         GET_OPCODE(code[t + 1]) != OP_TFORLOOP))
+      return "malformed generic for";
+    if (pc > 0 && op != OP_NEWOBJ &&
+        luaP_isOT(code[pc - 1]) != luaP_isIT(i))
+      return "unpaired multiple results";
+  }
+  for (pc = 0; pc < f->sizelocvars; pc++) {
+    const LocVar *v = &f->locvars[pc];
+    if (v->startpc < 0 || v->startpc > v->endpc || v->endpc > n)
+      return "bad local variable range";
+  }
+  if (f->sizelineinfo != 0) {
+    if (f->sizelineinfo != n)
+      return "line information does not match code";
+    for (pc = 0; pc < n; pc++) {
+      if (f->lineinfo[pc] == ABSLINEINFO) {
+        if (absi >= f->sizeabslineinfo || f->abslineinfo[absi].pc != pc)
+          return "bad absolute line information";
+        absi++;
+      }
+    }
+    if (absi != f->sizeabslineinfo)
+      return "bad absolute line information";
+  }
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,28 @@
+/*
+** $Id: lopt.h $
+** Bytecode optimizer for finished function prototypes
+** See Copyright Notice in lua.h
+*/
+
+#ifndef lopt_h
+#define lopt_h
+
+#include "lobject.h"
+
+
+/*
+** Load-mode character that asks the parser to optimize every function
+** of a text chunk (e.g., mode "tO").  A chunk can also ask for it by
+** itself with a '--@optimize' comment; functions that end after that
+** comment are optimized.
+*/
+#define LUA_OPTMODE	'O'
+
+
+LUAI_FUNC void luaK_optimize (lua_State *L, Proto *f);
+
+#if defined(LUA_DEBUG)
+LUAI_FUNC const char *luaK_checkcode (const Proto *f);
+#endif
+
+#endif
@@ -25,6 +25,7 @@
 #include "lmem.h"
 #include "lobject.h"
 #include "lopcodes.h"
+#include "lopt.h"
 #include "lparser.h"
 #include "lstate.h"
 #include "lstring.h"
@@ -1173,6 +1174,8 @@ static void close_func (LexState *ls) {
   luaM_shrinkvector(L, f->p, f->sizep, fs->np, Proto *);
   luaM_shrinkvector(L, f->locvars, f->sizelocvars, fs->ndebugvars, LocVar);
   luaM_shrinkvector(L, f->upvalues, f->sizeupvalues, fs->nups, Upvaldesc);
+  if (ls->optimize)
+    luaK_optimize(L, f);
   ls->fs = fs->prev;
   luaC_checkGC(L);
 }
@@ -2300,6 +2303,7 @@ static void suffixedexp (LexState *ls, expdesc *v) {
         break;
       }
       case TK_PIPE: {  /* '|>' */
+        luaK_dischargevars(fs, v);  /* 先取出 x，不让它的临时寄存器留在 f 之下 */
         luaX_next(ls);
         expdesc e;
         /* 支持管道符右侧直接使用字面量和匿名函数 */
@@ -2425,6 +2429,7 @@ static void suffixedexp (LexState *ls, expdesc *v) {
         ** 功能描述：如果 x 为 nil，则结果为 nil；否则结果为 f(x)
         ** 用于避免 nil 值导致的错误
         */
+        luaK_dischargevars(fs, v);  /* 先取出 x，不让它的临时寄存器留在 f 之下 */
         luaX_next(ls);
         expdesc e;
         /* 支持管道符右侧直接使用字面量和匿名函数 */
@@ -8747,7 +8752,8 @@ static void mainfunc (LexState *ls, FuncState *fs) {
 
 
 LClosure *luaY_parser (lua_State *L, ZIO *z, Mbuffer *buff,
-                       Dyndata *dyd, const char *name, int firstchar) {
+                       Dyndata *dyd, const char *name, int firstchar,
+                       int optimize) {
   LexState lexstate;
   FuncState funcstate;
   LClosure *cl = luaF_newLclosure(L, 1);  /* create main closure */
@@ -8766,6 +8772,7 @@ LClosure *luaY_parser (lua_State *L, ZIO *z, Mbuffer *buff,
   lexstate.tokpos=0;
   dyd->actvar.n = dyd->gt.n = dyd->label.n = 0;
   luaX_setinput(L, &lexstate, z, funcstate.f->source, firstchar);
+  lexstate.optimize = cast_byte(optimize);
   mainfunc(&lexstate, &funcstate);
   lua_assert(!funcstate.prev && funcstate.nups == 1 && !lexstate.fs);
   /* all scopes should be correctly finished */
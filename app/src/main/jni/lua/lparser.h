@@ -176,7 +176,8 @@ typedef struct FuncState {
 
 LUAI_FUNC int luaY_nvarstack (FuncState *fs);
 LUAI_FUNC LClosure *luaY_parser (lua_State *L, ZIO *z, Mbuffer *buff,
-                                 Dyndata *dyd, const char *name, int firstchar);
+                                 Dyndata *dyd, const char *name, int firstchar,
+                                 int optimize);
 
 
 #endif
@@ -24,6 +24,8 @@
 /* 引入luajava头文件 */
 #ifdef __ANDROID__
 #include "../luajava/luajava.h"
+#else
+#define isJavaObject(L,idx)	0  /* 宿主机构建没有 Java 桥 */
 #endif
 
 
@@ -273,6 +273,7 @@ static void close_state (lua_State *L) {
     luai_userstateclose(L);
   }
   luaM_freearray(L, G(L)->strt.hash, G(L)->strt.size);
+  luaJ_close(L);  /* 释放废弃的本地代码 */
   luaM_poolshutdown(L);  /* 关闭内存池 */
   freestack(L);
   lua_assert(gettotalbytes(g) == sizeof(LG));
@@ -404,6 +405,7 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud, unsigned seed) {
   for (i=0; i < LUA_NUMTAGS; i++) g->mt[i] = NULL;
   g->vm_code_list = NULL;  /* 初始化VM代码表链表 */
   luaM_poolinit(L);  /* 初始化内存池 */
+  luaJ_init(L);  /* 初始化基线JIT */
   if (luaD_rawrunprotected(L, f_luaopen, NULL) != LUA_OK) {
     /* memory allocation error: free partial state */
     close_state(L);
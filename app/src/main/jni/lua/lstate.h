@@ -17,6 +17,7 @@ typedef struct CallInfo CallInfo;
 #include "lobject.h"
 #include "ltm.h"
 #include "lzio.h"
+#include "ljit.h"
 
 
 /*
@@ -351,6 +352,12 @@ typedef struct global_State {
   MemPoolArena mempool;  /* 内存池管理 */
   /* VM保护代码表链表 */
   struct VMCodeTable *vm_code_list;  /* VM代码表链表头 */
+  /* 基线JIT */
+  lu_byte jiton;  /* 是否启用本地代码 */
+  l_uint32 jitthreshold;  /* 热点阈值 */
+  JitStats jitstats;  /* 统计信息 */
+  struct JitCode *jitdead;  /* 已废弃但可能仍在执行的本地代码 */
+  struct JitFrame *jitframe;  /* C 栈上最近的本地代码帧 */
 } global_State;
 
 
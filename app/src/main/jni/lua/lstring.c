@@ -41,21 +41,131 @@
 ** generic equality for strings
 */
 int luaS_eqlngstr (TString *a, TString *b) {
-  size_t len = a->u.lnglen;
-  lua_assert(a->tt == LUA_VLNGSTR && b->tt == LUA_VLNGSTR);
+  size_t len1, len2;
+  const char *s1 = getlstr(a, len1);
+  const char *s2 = getlstr(b, len2);
+  lua_assert(a->tt == LUA_VLNGSTR);  /* 'b' may be a short-string key */
   return (a == b) ||  /* same instance or... */
-    ((len == b->u.lnglen) &&  /* equal length and ... */
-     (memcmp(getlngstr(a), getlngstr(b), len) == 0));  /* equal contents */
+    ((len1 == len2) &&  /* equal length and ... */
+     (memcmp(s1, s2, len1) == 0));  /* equal contents */
+}
+
+
+/*
+** {======================================================
+** Hash for strings
+** =======================================================
+*/
+
+/*
+** Strings are hashed with a variant of wyhash: the contents are read
+** 8 bytes at a time and mixed into the state with 64x64->128-bit
+** multiplications. Strings longer than 48 bytes are consumed by three
+** independent lanes, so that the multiplications of one round can run
+** in parallel. The state starts from the per-state random seed, so the
+** positions of strings in the string table (and in tables) cannot be
+** predicted from outside.
+*/
+
+static const l_uint64 hsecret[4] = {
+  0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+  0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+
+/* 'a * b' as a 128-bit value: low half in 'a', high half in 'b' */
+#if defined(__SIZEOF_INT128__)
+
+#define hmum(a,b)  \
+  { unsigned __int128 r_ = (unsigned __int128)(a) * (b);  \
+    (a) = cast(l_uint64, r_); (b) = cast(l_uint64, r_ >> 64); }
+
+#else
+
+#define hmum(a,b)  { l_uint64 lo_, hi_; mul128(a, b, &lo_, &hi_);  \
+                     (a) = lo_; (b) = hi_; }
+
+static void mul128 (l_uint64 a, l_uint64 b, l_uint64 *lo, l_uint64 *hi) {
+  l_uint64 ha = a >> 32, hb = b >> 32;
+  l_uint64 la = cast(l_uint32, a), lb = cast(l_uint32, b);
+  l_uint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  l_uint64 t = rl + (rm0 << 32);
+  l_uint64 c = (t < rl);
+  *lo = t + (rm1 << 32);
+  c += (*lo < t);
+  *hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+}
+
+#endif
+
+
+static l_uint64 hmix (l_uint64 a, l_uint64 b) {
+  hmum(a, b);
+  return a ^ b;
+}
+
+
+static l_uint64 hread8 (const char *p) {
+  l_uint64 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+
+static l_uint64 hread4 (const char *p) {
+  l_uint32 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
 }
 
 
 static unsigned luaS_hash (const char *str, size_t l, unsigned seed) {
-  unsigned int h = seed ^ cast_uint(l);
-  for (; l > 0; l--)
-    h ^= ((h<<5) + (h>>2) + cast_byte(str[l - 1]));
-  return h;
+  l_uint64 h = hmix(seed ^ hsecret[0], hsecret[1]);
+  l_uint64 a, b;
+  if (l <= 16) {
+    if (l >= 4) {  /* two (possibly overlapping) pairs of 4-byte words */
+      size_t d = (l >> 3) << 2;
+      a = (hread4(str) << 32) | hread4(str + d);
+      b = (hread4(str + l - 4) << 32) | hread4(str + l - 4 - d);
+    }
+    else if (l > 0) {  /* first, middle, and last bytes */
+      a = (cast(l_uint64, cast_byte(str[0])) << 16) |
+          (cast(l_uint64, cast_byte(str[l >> 1])) << 8) |
+          cast_byte(str[l - 1]);
+      b = 0;
+    }
+    else
+      a = b = 0;
+  }
+  else {
+    const char *p = str;
+    size_t i = l;
+    if (i > 48) {
+      l_uint64 h1 = h, h2 = h;
+      do {
+        h = hmix(hread8(p) ^ hsecret[1], hread8(p + 8) ^ h);
+        h1 = hmix(hread8(p + 16) ^ hsecret[2], hread8(p + 24) ^ h1);
+        h2 = hmix(hread8(p + 32) ^ hsecret[3], hread8(p + 40) ^ h2);
+        p += 48; i -= 48;
+      } while (i > 48);
+      h ^= h1 ^ h2;
+    }
+    while (i > 16) {
+      h = hmix(hread8(p) ^ hsecret[1], hread8(p + 8) ^ h);
+      p += 16; i -= 16;
+    }
+    a = hread8(p + i - 16);  /* last 16 bytes (may overlap consumed ones) */
+    b = hread8(p + i - 8);
+  }
+  a ^= hsecret[1];
+  b ^= h;
+  hmum(a, b);
+  h = hmix(a ^ hsecret[0] ^ l, b ^ hsecret[1]);
+  return cast_uint(h ^ (h >> 32));
 }
 
+/* }====================================================== */
+
 
 unsigned luaS_hashlongstr (TString *ts) {
   lua_assert(ts->tt == LUA_VLNGSTR);
@@ -196,6 +306,12 @@ void luaS_remove (lua_State *L, TString *ts) {
 }
 
 
+/*
+** The table grows when it has as many strings as buckets (load factor
+** 1). With a well-mixed hash, chains then average about one string, and
+** a smaller load factor does not make interning measurably faster while
+** doubling the bucket array.
+*/
 static void growstrtab (lua_State *L, stringtable *tb) {
   if (l_unlikely(tb->nuse == MAX_INT)) {  /* too many strings? */
     luaC_fullgc(L, 1);  /* try to free some... */
@@ -2563,6 +2563,599 @@ static int str_data (lua_State *L) {
   return lua_pcall(L, 0, LUA_MULTRET, 0);
 }
 
+/*
+** {======================================================
+** STRING BUFFERS
+** =======================================================
+*/
+
+/* minimum size of the memory owned by a buffer */
+#if !defined(SBUF_MINSIZE)
+#define SBUF_MINSIZE	32
+#endif
+
+/* maximum nesting of tables in serialized values */
+#if !defined(SBUF_MAXDEPTH)
+#define SBUF_MAXDEPTH	100
+#endif
+
+
+/* tags of serialized values */
+#define SBT_NIL		0
+#define SBT_FALSE	1
+#define SBT_TRUE	2
+#define SBT_INT		3
+#define SBT_FLOAT	4
+#define SBT_STR		5
+#define SBT_TABLE	6
+
+
+#define checkstrbuf(L,i)  \
+	((luaL_StrBuf *)luaL_checkudata(L, i, LUA_BUFFERHANDLE))
+
+/* is the buffer a view of memory it does not own? */
+#define isview(B)	((B)->size == 0 && (B)->b != NULL)
+
+#define sbuflen(B)	((B)->w - (B)->r)
+
+
+static void *sbuf_realloc (lua_State *L, void *p, size_t osize,
+                                                  size_t nsize) {
+  void *ud;
+  lua_Alloc allocf = lua_getallocf(L, &ud);
+  void *np = allocf(ud, p, osize, nsize);
+  if (l_unlikely(np == NULL && nsize > 0))
+    luaL_error(L, "not enough memory");
+  return np;
+}
+
+
+/* drop the contents and the memory of buffer 'B' at index 'idx' */
+static void sbuf_release (lua_State *L, luaL_StrBuf *B, int idx) {
+  if (isview(B)) {
+    lua_pushnil(L);
+    lua_setiuservalue(L, idx, 1);  /* release viewed object */
+  }
+  else if (B->b != NULL)
+    sbuf_realloc(L, B->b, B->size, 0);
+  B->b = NULL;
+  B->r = B->w = B->size = 0;
+}
+
+
+/*
+** Make room for 'n' more bytes after the contents of buffer 'B' (at
+** index 'idx'). The unread bytes are moved to the start of the memory
+** when that makes enough room; otherwise the memory (at least) doubles.
+** A view gets memory of its own.
+*/
+static char *sbuf_grow (lua_State *L, luaL_StrBuf *B, int idx,
+                                   size_t n) {
+  size_t len = sbuflen(B);
+  if (l_unlikely(n > MAX_SIZE - len))
+    luaL_error(L, "buffer too large");
+  if (!isview(B) && B->size - len >= n && B->r > 0) {
+    memmove(B->b, B->b + B->r, len);
+  }
+  else {
+    size_t nsize = (B->size < SBUF_MINSIZE) ? SBUF_MINSIZE : B->size;
+    char *nb;
+    while (nsize - len < n)
+      nsize = (nsize <= MAX_SIZE / 2) ? nsize * 2 : len + n;
+    if (!isview(B) && B->r == 0)
+      nb = (char *)sbuf_realloc(L, B->b, B->size, nsize);
+    else {
+      nb = (char *)sbuf_realloc(L, NULL, 0, nsize);
+      if (len > 0)
+        memcpy(nb, B->b + B->r, len);
+      sbuf_release(L, B, idx);
+    }
+    B->b = nb;
+    B->size = nsize;
+  }
+  B->r = 0;
+  B->w = len;
+  return B->b + B->w;
+}
+
+
+static char *sbuf_reserve (lua_State *L, luaL_StrBuf *B, int idx,
+                           size_t n) {
+  if (l_likely(B->size - B->w >= n && !isview(B)))
+    return B->b + B->w;
+  return sbuf_grow(L, B, idx, n);
+}
+
+
+static void sbuf_addlstring (lua_State *L, luaL_StrBuf *B, int idx,
+                             const char *s, size_t l) {
+  if (l > 0) {
+    char *p;
+    if (s >= B->b + B->r && s < B->b + B->w) {  /* from the buffer itself? */
+      size_t off = s - (B->b + B->r);
+      p = sbuf_reserve(L, B, idx, l);
+      s = B->b + B->r + off;  /* contents may have moved */
+    }
+    else
+      p = sbuf_reserve(L, B, idx, l);
+    memcpy(p, s, l);
+    B->w += l;
+  }
+}
+
+
+static void sbuf_consume (luaL_StrBuf *B, size_t n) {
+  B->r += n;
+  if (B->r == B->w && !isview(B))
+    B->r = B->w = 0;  /* buffer is empty; reuse all its memory */
+}
+
+
+static luaL_StrBuf *sbuf_new (lua_State *L, size_t size) {
+  luaL_StrBuf *B = (luaL_StrBuf *)lua_newuserdatauv(L, sizeof(luaL_StrBuf), 1);
+  B->b = NULL;
+  B->r = B->w = B->size = 0;
+  luaL_setmetatable(L, LUA_BUFFERHANDLE);
+  if (size > 0)
+    sbuf_grow(L, B, lua_gettop(L), size);
+  return B;
+}
+
+
+/* push all the contents of buffer 'B' as a string and empty the buffer */
+static void sbuf_pushall (lua_State *L, luaL_StrBuf *B) {
+  size_t len = sbuflen(B);
+  lua_pushlstring(L, (B->b != NULL) ? B->b + B->r : "", len);
+  sbuf_consume(B, len);
+}
+
+
+static int sbuf_lnew (lua_State *L) {
+  lua_Integer size = luaL_optinteger(L, 1, 0);
+  luaL_argcheck(L, 0 <= size && (lua_Unsigned)size <= MAX_SIZE, 1,
+                   "invalid size");
+  sbuf_new(L, (size_t)size);
+  return 1;
+}
+
+
+static int sbuf_put (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  int n = lua_gettop(L);
+  int i;
+  for (i = 2; i <= n; i++) {
+    size_t l;
+    const char *s;
+    if (lua_type(L, i) == LUA_TSTRING || lua_type(L, i) == LUA_TNUMBER)
+      s = lua_tolstring(L, i, &l);
+    else if ((s = luaL_tobuffer(L, i, &l)) == NULL) {
+      if (!luaL_callmeta(L, i, "__tostring") || !lua_isstring(L, -1))
+        return luaL_typeerror(L, i, "string, number or buffer");
+      lua_replace(L, i);
+      s = lua_tolstring(L, i, &l);
+    }
+    sbuf_addlstring(L, B, 1, s, l);
+  }
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+static int sbuf_putf (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  int n = lua_gettop(L);
+  size_t l;
+  const char *s;
+  luaL_checkstring(L, 2);
+  lua_pushcfunction(L, str_format);
+  lua_rotate(L, 2, 1);  /* put 'format' below its arguments */
+  lua_call(L, n - 1, 1);
+  s = lua_tolstring(L, 2, &l);
+  sbuf_addlstring(L, B, 1, s, l);
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* reserve(n): pointer to and size of writable space of at least n bytes */
+static int sbuf_reserve_ (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  lua_Integer n = luaL_checkinteger(L, 2);
+  char *p;
+  luaL_argcheck(L, 0 <= n && (lua_Unsigned)n <= MAX_SIZE, 2, "invalid size");
+  p = sbuf_reserve(L, B, 1, (size_t)n);
+  lua_pushlightuserdata(L, p);
+  lua_pushinteger(L, (lua_Integer)(B->size - B->w));
+  return 2;
+}
+
+
+/* commit(n): append n bytes written into the space from 'reserve' */
+static int sbuf_commit (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  lua_Integer n = luaL_checkinteger(L, 2);
+  luaL_argcheck(L, 0 <= n && !isview(B) &&
+                   (lua_Unsigned)n <= B->size - B->w, 2, "invalid size");
+  B->w += (size_t)n;
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+static int sbuf_skip (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  lua_Integer n = luaL_checkinteger(L, 2);
+  luaL_argcheck(L, n >= 0, 2, "invalid size");
+  sbuf_consume(B, ((lua_Unsigned)n < sbuflen(B)) ? (size_t)n : sbuflen(B));
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* get([n1, n2, ...]): remove and return the first bytes (all by default) */
+static int sbuf_get (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  int n = lua_gettop(L);
+  int i;
+  if (n == 1) {
+    sbuf_pushall(L, B);
+    return 1;
+  }
+  luaL_checkstack(L, n, "too many results");
+  for (i = 2; i <= n; i++) {
+    lua_Integer l = luaL_checkinteger(L, i);
+    size_t len = sbuflen(B);
+    luaL_argcheck(L, l >= 0, i, "invalid size");
+    if ((lua_Unsigned)l < len)
+      len = (size_t)l;
+    lua_pushlstring(L, (B->b != NULL) ? B->b + B->r : "", len);
+    sbuf_consume(B, len);
+  }
+  return n - 1;
+}
+
+
+static int sbuf_tostring (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  lua_pushlstring(L, (B->b != NULL) ? B->b + B->r : "", sbuflen(B));
+  return 1;
+}
+
+
+static int sbuf_len (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  lua_pushinteger(L, (lua_Integer)sbuflen(B));
+  return 1;
+}
+
+
+/* ref(): pointer to and length of the contents */
+static int sbuf_ref (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  lua_pushlightuserdata(L, (B->b != NULL) ? B->b + B->r : NULL);
+  lua_pushinteger(L, (lua_Integer)sbuflen(B));
+  return 2;
+}
+
+
+/* set(s): make the buffer a view of string 's', without copying it */
+static int sbuf_set (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  size_t l;
+  const char *s = luaL_checklstring(L, 2, &l);
+  sbuf_release(L, B, 1);
+  lua_pushvalue(L, 2);
+  lua_setiuservalue(L, 1, 1);  /* keep the string alive */
+  B->b = (char *)s;
+  B->w = l;
+  if (B->b == NULL) B->b = (char *)"";  /* (just in case) */
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* reset(): empty the buffer, keeping its memory */
+static int sbuf_reset (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  if (isview(B))
+    sbuf_release(L, B, 1);
+  B->r = B->w = 0;
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+static int sbuf_free (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  sbuf_release(L, B, 1);
+  return 0;
+}
+
+
+/*
+** Serialization: each value is a tag byte followed by its payload.
+** Integers are zigzag varints, floats are 8 bytes in the machine
+** order, strings a varint length followed by their bytes, and tables
+** the length of their array part, its values, and then key-value pairs
+** ended by a nil key. Metatables are not serialized.
+*/
+
+static void sbuf_putvarint (lua_State *L, luaL_StrBuf *B, int idx,
+                            lua_Unsigned u) {
+  char *p = sbuf_reserve(L, B, idx, 10);
+  char *p0 = p;
+  while (u >= 0x80) {
+    *p++ = (char)(u | 0x80);
+    u >>= 7;
+  }
+  *p++ = (char)u;
+  B->w += p - p0;
+}
+
+
+static void sbuf_puttag (lua_State *L, luaL_StrBuf *B, int idx, int tag) {
+  *sbuf_reserve(L, B, idx, 1) = (char)tag;
+  B->w++;
+}
+
+
+static void sbuf_encode (lua_State *L, luaL_StrBuf *B, int idx, int v,
+                         int depth) {
+  switch (lua_type(L, v)) {
+    case LUA_TNIL:
+      sbuf_puttag(L, B, idx, SBT_NIL);
+      break;
+    case LUA_TBOOLEAN:
+      sbuf_puttag(L, B, idx, lua_toboolean(L, v) ? SBT_TRUE : SBT_FALSE);
+      break;
+    case LUA_TNUMBER: {
+      if (lua_isinteger(L, v)) {
+        lua_Unsigned u = (lua_Unsigned)lua_tointeger(L, v);
+        sbuf_puttag(L, B, idx, SBT_INT);
+        sbuf_putvarint(L, B, idx, (u << 1) ^ (0 - (u >> (sizeof(u) * 8 - 1))));
+      }
+      else {
+        lua_Number n = lua_tonumber(L, v);
+        char *p = sbuf_reserve(L, B, idx, 1 + sizeof(n));
+        *p = (char)SBT_FLOAT;
+        memcpy(p + 1, &n, sizeof(n));
+        B->w += 1 + sizeof(n);
+      }
+      break;
+    }
+    case LUA_TSTRING: {
+      size_t l;
+      const char *s = lua_tolstring(L, v, &l);
+      sbuf_puttag(L, B, idx, SBT_STR);
+      sbuf_putvarint(L, B, idx, (lua_Unsigned)l);
+      sbuf_addlstring(L, B, idx, s, l);
+      break;
+    }
+    case LUA_TTABLE: {
+      lua_Integer narr = (lua_Integer)lua_rawlen(L, v);
+      lua_Integer i;
+      if (l_unlikely(depth >= SBUF_MAXDEPTH))
+        luaL_error(L, "table too deep (or cyclic) to encode");
+      luaL_checkstack(L, 3, "table too deep to encode");
+      sbuf_puttag(L, B, idx, SBT_TABLE);
+      sbuf_putvarint(L, B, idx, (lua_Unsigned)narr);
+      for (i = 1; i <= narr; i++) {
+        lua_rawgeti(L, v, i);
+        sbuf_encode(L, B, idx, lua_gettop(L), depth + 1);
+        lua_pop(L, 1);
+      }
+      lua_pushnil(L);
+      while (lua_next(L, v)) {
+        if (!(lua_isinteger(L, -2) && 1 <= lua_tointeger(L, -2) &&
+              lua_tointeger(L, -2) <= narr)) {  /* not in array part? */
+          int top = lua_gettop(L);
+          sbuf_encode(L, B, idx, top - 1, depth + 1);
+          sbuf_encode(L, B, idx, top, depth + 1);
+        }
+        lua_pop(L, 1);
+      }
+      sbuf_puttag(L, B, idx, SBT_NIL);
+      break;
+    }
+    default:
+      luaL_error(L, "cannot encode a %s value", luaL_typename(L, v));
+  }
+}
+
+
+typedef struct SBufReader {
+  const char *p;
+  const char *end;
+} SBufReader;
+
+
+static const char *sbuf_need (lua_State *L, SBufReader *R, size_t n) {
+  const char *p = R->p;
+  if (l_unlikely((size_t)(R->end - p) < n))
+    luaL_error(L, "malformed buffer data (truncated)");
+  R->p += n;
+  return p;
+}
+
+
+static lua_Unsigned sbuf_getvarint (lua_State *L, SBufReader *R) {
+  lua_Unsigned u = 0;
+  int shift = 0;
+  for (;;) {
+    unsigned char c = (unsigned char)*sbuf_need(L, R, 1);
+    if (l_unlikely(shift >= (int)(sizeof(u) * 8)))
+      luaL_error(L, "malformed buffer data (bad integer)");
+    u |= (lua_Unsigned)(c & 0x7f) << shift;
+    if (c < 0x80) return u;
+    shift += 7;
+  }
+}
+
+
+/* push the next value of 'R'; return its tag */
+static int sbuf_decode (lua_State *L, SBufReader *R, int depth) {
+  int tag = (unsigned char)*sbuf_need(L, R, 1);
+  switch (tag) {
+    case SBT_NIL: lua_pushnil(L); break;
+    case SBT_FALSE: lua_pushboolean(L, 0); break;
+    case SBT_TRUE: lua_pushboolean(L, 1); break;
+    case SBT_INT: {
+      lua_Unsigned u = sbuf_getvarint(L, R);
+      lua_pushinteger(L, (lua_Integer)((u >> 1) ^ (0 - (u & 1))));
+      break;
+    }
+    case SBT_FLOAT: {
+      lua_Number n;
+      memcpy(&n, sbuf_need(L, R, sizeof(n)), sizeof(n));
+      lua_pushnumber(L, n);
+      break;
+    }
+    case SBT_STR: {
+      lua_Unsigned l = sbuf_getvarint(L, R);
+      if (l_unlikely(l > (lua_Unsigned)(R->end - R->p)))
+        luaL_error(L, "malformed buffer data (truncated)");
+      lua_pushlstring(L, sbuf_need(L, R, (size_t)l), (size_t)l);
+      break;
+    }
+    case SBT_TABLE: {
+      lua_Unsigned narr = sbuf_getvarint(L, R);
+      lua_Integer i;
+      if (l_unlikely(depth >= SBUF_MAXDEPTH))
+        luaL_error(L, "malformed buffer data (too deep)");
+      if (l_unlikely(narr > (lua_Unsigned)(R->end - R->p)))
+        luaL_error(L, "malformed buffer data (truncated)");
+      luaL_checkstack(L, 3, "table too deep to decode");
+      lua_createtable(L, (narr <= INT_MAX) ? (int)narr : 0, 0);
+      for (i = 1; (lua_Unsigned)i <= narr; i++) {
+        sbuf_decode(L, R, depth + 1);
+        lua_rawseti(L, -2, i);
+      }
+      while (sbuf_decode(L, R, depth + 1) != SBT_NIL) {
+        sbuf_decode(L, R, depth + 1);
+        lua_rawset(L, -3);
+      }
+      lua_pop(L, 1);  /* pop final nil */
+      break;
+    }
+    default:
+      luaL_error(L, "malformed buffer data (bad tag %d)", tag);
+  }
+  return tag;
+}
+
+
+static int sbuf_encode_ (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  luaL_checkany(L, 2);
+  sbuf_encode(L, B, 1, 2, 0);
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* decode(): remove and return the first serialized value */
+static int sbuf_decode_ (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  SBufReader R;
+  R.p = (B->b != NULL) ? B->b + B->r : "";
+  R.end = R.p + sbuflen(B);
+  if (R.p == R.end)
+    return 0;  /* no more values */
+  sbuf_decode(L, &R, 0);
+  sbuf_consume(B, R.p - (B->b + B->r));
+  return 1;
+}
+
+
+/* string.buffer.encode(v): serialized value as a string */
+static int sbuf_lencode (lua_State *L) {
+  luaL_StrBuf *B;
+  luaL_checkany(L, 1);
+  lua_settop(L, 1);
+  B = sbuf_new(L, 0);
+  sbuf_encode(L, B, 2, 1, 0);
+  sbuf_pushall(L, B);
+  sbuf_release(L, B, 2);  /* do not wait for the collector */
+  return 1;
+}
+
+
+/* string.buffer.decode(s): value serialized in string 's' */
+static int sbuf_ldecode (lua_State *L) {
+  size_t l;
+  SBufReader R;
+  R.p = luaL_checklstring(L, 1, &l);
+  R.end = R.p + l;
+  sbuf_decode(L, &R, 0);
+  if (R.p != R.end)
+    return luaL_error(L, "malformed buffer data (extra bytes)");
+  return 1;
+}
+
+
+static int sbuf_gc (lua_State *L) {
+  luaL_StrBuf *B = checkstrbuf(L, 1);
+  if (!isview(B) && B->b != NULL)
+    sbuf_realloc(L, B->b, B->size, 0);
+  B->b = NULL;
+  B->r = B->w = B->size = 0;
+  return 0;
+}
+
+
+static const luaL_Reg sbuf_meth[] = {
+  {"put", sbuf_put},
+  {"putf", sbuf_putf},
+  {"reserve", sbuf_reserve_},
+  {"commit", sbuf_commit},
+  {"skip", sbuf_skip},
+  {"get", sbuf_get},
+  {"tostring", sbuf_tostring},
+  {"ref", sbuf_ref},
+  {"set", sbuf_set},
+  {"reset", sbuf_reset},
+  {"free", sbuf_free},
+  {"encode", sbuf_encode_},
+  {"decode", sbuf_decode_},
+  {NULL, NULL}
+};
+
+
+static const luaL_Reg sbuf_metameth[] = {
+  {"__index", NULL},  /* place holder */
+  {"__tostring", sbuf_tostring},
+  {"__len", sbuf_len},
+  {"__gc", sbuf_gc},
+  {"__close", sbuf_gc},
+  {NULL, NULL}
+};
+
+
+static const luaL_Reg sbuf_funcs[] = {
+  {"new", sbuf_lnew},
+  {"encode", sbuf_lencode},
+  {"decode", sbuf_ldecode},
+  {NULL, NULL}
+};
+
+
+/*
+** Open 'string.buffer' (also available through 'require')
+*/
+static int luaopen_strbuf (lua_State *L) {
+  luaL_newmetatable(L, LUA_BUFFERHANDLE);
+  luaL_setfuncs(L, sbuf_metameth, 0);
+  luaL_newlibtable(L, sbuf_meth);
+  luaL_setfuncs(L, sbuf_meth, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pop(L, 1);  /* pop metatable */
+  luaL_newlib(L, sbuf_funcs);
+  return 1;
+}
+
+/* }====================================================== */
+
+
 static const luaL_Reg strlib[] = {
   {"byte", str_byte},
   {"char", str_char},
@@ -2612,6 +3205,8 @@ static void createmetatable (lua_State *L) {
 LUAMOD_API int luaopen_string (lua_State *L) {
   luaL_newlib(L, strlib);
   createmetatable(L);
+  luaL_requiref(L, LUA_STRLIBNAME ".buffer", luaopen_strbuf, 0);
+  lua_setfield(L, -2, "buffer");
   return 1;
 }
 
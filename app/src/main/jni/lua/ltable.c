@@ -1484,7 +1484,7 @@ static unsigned int binsearch (const TValue *array, unsigned int i,
 
 /* return a border, saving it as a hint for next call */
 static lua_Unsigned newhint (Table *t, unsigned hint) {
-  lua_assert(hint <= t->asize);
+  lua_assert(hint <= luaH_realasize(t));
   *lenhint(t) = hint;
   return hint;
 }
@@ -28,6 +28,7 @@
 #include "lmem.h"
 #include "lopcodes.h"
 #include "lopnames.h"
+#include "lopt.h"
 #include "lstate.h"
 #include "lstring.h"
 #include "ltable.h"
@@ -746,6 +747,31 @@ static int listcode (lua_State *L) {
 }
 
 
+/* check the code of 'p' and of all functions nested in it */
+static const char *checkprotocode (const Proto *p) {
+  const char *msg = luaK_checkcode(p);
+  int i;
+  for (i = 0; msg == NULL && i < p->sizep; i++)
+    msg = checkprotocode(p->p[i]);
+  return msg;
+}
+
+
+static int checkcode (lua_State *L) {
+  const char *msg;
+  luaL_argcheck(L, lua_isfunction(L, 1) && !lua_iscfunction(L, 1),
+                 1, "Lua function expected");
+  msg = checkprotocode(getproto(obj_at(L, 1)));
+  if (msg == NULL) {
+    lua_pushboolean(L, 1);
+    return 1;
+  }
+  luaL_pushfail(L);
+  lua_pushstring(L, msg);
+  return 2;
+}
+
+
 static int printcode (lua_State *L) {
   int pc;
   Proto *p;
@@ -1151,7 +1177,7 @@ static int num2int (lua_State *L) {
 static int newstate (lua_State *L) {
   void *ud;
   lua_Alloc f = lua_getallocf(L, &ud);
-  lua_State *L1 = lua_newstate(f, ud);
+  lua_State *L1 = lua_newstate(f, ud, 0);
   if (L1) {
     lua_atpanic(L1, tpanic);
     lua_pushlightuserdata(L, L1);
@@ -1260,7 +1286,7 @@ static int checkpanic (lua_State *L) {
   lua_Alloc f = lua_getallocf(L, &ud);
   b.paniccode = luaL_optstring(L, 2, "");
   b.L = L;
-  L1 = lua_newstate(f, ud);  /* create new state */
+  L1 = lua_newstate(f, ud, 0);  /* create new state */
   if (L1 == NULL) {  /* error? */
     lua_pushnil(L);
     return 1;
@@ -1931,6 +1957,7 @@ static const struct luaL_Reg tests_funcs[] = {
   {"log2", log2_aux},
   {"limits", get_limits},
   {"listcode", listcode},
+  {"checkcode", checkcode},
   {"printcode", printcode},
   {"listk", listk},
   {"listabslineinfo", listabslineinfo},
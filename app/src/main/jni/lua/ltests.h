@@ -102,7 +102,8 @@ LUA_API void *debug_realloc (void *ud, void *block,
                              size_t osize, size_t nsize);
 
 #if defined(lua_c)
-#define luaL_newstate()		lua_newstate(debug_realloc, &l_memcontrol)
+#define luaL_newstate()  \
+	lua_newstate(debug_realloc, &l_memcontrol, luaL_makeseed(NULL))
 #define luaL_openlibs(L)  \
   { (luaL_openlibs)(L); \
      luaL_requiref(L, "T", luaB_opentests, 1); \
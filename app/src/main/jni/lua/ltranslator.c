@@ -155,7 +155,7 @@ static int l_gfi(lua_State *L) {
     /* 遍历所有指令 */
     int pc;
     for (pc = 0; pc < f->sizecode; pc++) {
-        Instruction i = f->code[pc];
+        Instruction i = unquickened(f->code[pc]);  /* 通用形式 */
         OpCode o = GET_OPCODE(i);
         
         /* 创建一个表来存储当前指令的信息 */
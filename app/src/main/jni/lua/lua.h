@@ -415,6 +415,18 @@ LUA_API lua_Integer (lua_tointeger_safe) (lua_State *L, int idx, int *isnum, int
 */
 LUA_API void (lua_table_iextend) (lua_State *L, int idx, int n);
 
+/*
+** 批量数组API
+*/
+LUA_API void   (lua_createarrayi) (lua_State *L, const lua_Integer *v, size_t n);
+LUA_API void   (lua_createarrayn) (lua_State *L, const lua_Number *v, size_t n);
+LUA_API void   (lua_createarrays) (lua_State *L, const char *const *s,
+                                   const size_t *len, size_t n);
+LUA_API size_t (lua_toarrayi) (lua_State *L, int idx, lua_Integer *buf, size_t n);
+LUA_API size_t (lua_toarrayn) (lua_State *L, int idx, lua_Number *buf, size_t n);
+LUA_API size_t (lua_toarrays) (lua_State *L, int idx, const char **buf,
+                               size_t *len, size_t n);
+
 #define LUA_N2SBUFFSZ	64
 LUA_API unsigned  (lua_numbertocstring) (lua_State *L, int idx, char *buff);
 LUA_API size_t  (lua_stringtonumber) (lua_State *L, const char *s);
@@ -35,6 +35,7 @@ static void PrintFunction(const Proto* f, int full);
 static int listing=0;			/* list bytecodes? */
 static int dumping=1;			/* dump bytecodes? */
 static int stripping=0;			/* strip debug information? */
+static int optimizing=0;		/* optimize bytecodes? */
 static char Output[]={ OUTPUT };	/* default output file name */
 static const char* output=Output;	/* actual output file name */
 static const char* progname=PROGNAME;	/* actual program name */
@@ -63,6 +64,7 @@ static void usage(const char* message)
   "Available options are:\n"
   "  -l       list (use -l -l for full listing)\n"
   "  -o name  output to file 'name' (default is \"%s\")\n"
+  "  -O       optimize bytecode\n"
   "  -p       parse only\n"
   "  -s       strip debug information\n"
   "  -v       show version information\n"
@@ -100,6 +102,8 @@ static int doargs(int argc, char* argv[])
     usage("'-o' needs argument");
    if (IS("-")) output=NULL;
   }
+  else if (IS("-O"))			/* optimize */
+   optimizing=1;
   else if (IS("-p"))			/* parse only */
    dumping=0;
   else if (IS("-s"))			/* strip debug information */
@@ -177,7 +181,8 @@ static int pmain(lua_State* L)
  for (i=0; i<argc; i++)
  {
   const char* filename=IS("-") ? NULL : argv[i];
-  if (luaL_loadfile(L,filename)!=LUA_OK) fatal(lua_tostring(L,-1));
+  if (luaL_loadfilex(L,filename,optimizing ? "btO" : NULL)!=LUA_OK)
+   fatal(lua_tostring(L,-1));
  }
  f=combine(L,argc);
  if (listing) luaU_print(f,listing>1);
@@ -331,6 +336,7 @@ static void PrintConstant(const Proto* f, int i)
 #define EXTRAARG	GETARG_Ax(code[pc+1])
 #define EXTRAARGC	(EXTRAARG*(MAXARG_C+1))
 #define ISK		(isk ? "k" : "")
+#define QNODE(i)	(GETARG_Q(i) | ((GETARG_A(i) >> 8) << SIZE_Q))
 
 static void PrintCode(const Proto* f)
 {
@@ -347,8 +353,6 @@ static void PrintCode(const Proto* f)
   int bx=GETARG_Bx(i);
   int sb=GETARG_sB(i);
   int sc=GETARG_sC(i);
-  int vb=GETARG_vB(i);
-  int vc=GETARG_vC(i);
   int sbx=GETARG_sBx(i);
   int isk=GETARG_k(i);
   int line=luaG_getfuncline(f,pc);
@@ -430,8 +434,8 @@ static void PrintCode(const Proto* f)
 	if (isk) { printf(" "); PrintConstant(f,c); }
 	break;
    case OP_NEWTABLE:
-	printf("%d %d %d%s",a,vb,vc,ISK);
-	printf(COMMENT "%d",vc+EXTRAARGC);
+	printf("%d %d %d%s",a,b,c,ISK);
+	printf(COMMENT "%d",c+EXTRAARGC);
 	break;
    case OP_SELF:
 	printf("%d %d %d%s",a,b,c,ISK);
@@ -635,7 +639,7 @@ static void PrintCode(const Proto* f)
 	printf(COMMENT "to %d",pc-bx+2);
 	break;
    case OP_SETLIST:
-	printf("%d %d %d%s",a,vb,vc,ISK);
+	printf("%d %d %d%s",a,b,c,ISK);
 	if (isk) printf(COMMENT "%d",c+EXTRAARGC);
 	break;
    case OP_CLOSURE:
@@ -661,6 +665,57 @@ static void PrintCode(const Proto* f)
    case OP_EXTRAARG:
 	printf("%d",ax);
 	break;
+   case OP_ADD_II:
+   case OP_ADD_FF:
+   case OP_SUB_II:
+   case OP_SUB_FF:
+   case OP_MUL_II:
+   case OP_MUL_FF:
+	printf("%d %d %d",a,b,c);
+	break;
+   case OP_LT_II:
+   case OP_LT_FF:
+   case OP_LE_II:
+   case OP_LE_FF:
+	printf("%d %d %d",a,b,isk);
+	break;
+   case OP_SPACESHIP:
+   case OP_IS:
+   case OP_TESTNIL:
+   case OP_NEWCLASS:
+   case OP_INHERIT:
+   case OP_GETSUPER:
+   case OP_SETMETHOD:
+   case OP_SETSTATIC:
+   case OP_NEWOBJ:
+   case OP_GETPROP:
+   case OP_SETPROP:
+   case OP_INSTANCEOF:
+   case OP_IMPLEMENT:
+   case OP_SETIFACEFLAG:
+   case OP_ADDMETHOD:
+   case OP_SLICE:
+   case OP_NOP:
+	printf("%d %d %d%s",a,b,c,ISK);
+	break;
+   /* quickened field accesses keep a node index in Q and the high byte of A */
+   case OP_GETTABUP_N:
+	printf("%d %d %d",a&0xFF,b,c);
+	printf(COMMENT "%s",UPVALNAME(b));
+	printf(" "); PrintConstant(f,c);
+	printf(" node %d",QNODE(i));
+	break;
+   case OP_GETFIELD_N:
+	printf("%d %d %d",a&0xFF,b,c);
+	printf(COMMENT); PrintConstant(f,c);
+	printf(" node %d",QNODE(i));
+	break;
+   case OP_SETFIELD_N:
+	printf("%d %d %d%s",a&0xFF,b,c,ISK);
+	printf(COMMENT); PrintConstant(f,b);
+	if (isk) { printf(" "); PrintConstant(f,c); }
+	printf(" node %d",QNODE(i));
+	break;
 #if 0
    default:
 	printf("%d %d %d",a,b,c);
@@ -60,6 +60,15 @@ LUAMOD_API int (luaopen_ptr) (lua_State *L);
 #define LUA_TRANSLATORLIBNAME	"translator"
 LUAMOD_API int (luaopen_translator) (lua_State *L);
 
+#define LUA_HASHLIBNAME	"hash"
+LUAMOD_API int (luaopen_hash) (lua_State *L);
+
+#define LUA_AESLIBNAME	"aes"
+LUAMOD_API int (luaopen_aes) (lua_State *L);
+
+#define LUA_JITLIBNAME	"jit"
+LUAMOD_API int (luaopen_jit) (lua_State *L);
+
 #define LUA_SMGRNAME	"smgr"
 LUAMOD_API int (luaopen_smgr) (lua_State *L);
 
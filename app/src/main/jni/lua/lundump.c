@@ -27,7 +27,7 @@
 #include "lundump.h"
 #include "lzio.h"
 
-#include "sha256.h"
+#include "lhash.h"
 
 #include "stb_image.h"
 
@@ -132,13 +132,13 @@ static TString *loadStringN (LoadState *S, Proto *p) {
     }
     
     /* 读取并验证字符串映射表的SHA-256哈希值（完整性验证） */
-    uint8_t expected_hash[SHA256_DIGEST_SIZE];
-    loadVector(S, expected_hash, SHA256_DIGEST_SIZE);
+    uint8_t expected_hash[LHASH_SHA256_SIZE];
+    loadVector(S, expected_hash, LHASH_SHA256_SIZE);
     /* 计算字符串映射表的SHA-256哈希 */
-    uint8_t actual_hash[SHA256_DIGEST_SIZE];
-    SHA256((uint8_t *)S->string_map, 256 * sizeof(int), actual_hash);
+    uint8_t actual_hash[LHASH_SHA256_SIZE];
+    lhash_sha256((uint8_t *)S->string_map, 256 * sizeof(int), actual_hash);
     /* 验证哈希值 */
-    if (memcmp(actual_hash, expected_hash, SHA256_DIGEST_SIZE) != 0) {
+    if (memcmp(actual_hash, expected_hash, LHASH_SHA256_SIZE) != 0) {
       error(S, "string map integrity verification failed");
       return NULL;
     }
@@ -168,13 +168,13 @@ static TString *loadStringN (LoadState *S, Proto *p) {
     }
     
     /* 读取并验证字符串映射表的SHA-256哈希值（完整性验证） */
-    uint8_t expected_hash[SHA256_DIGEST_SIZE];
-    loadVector(S, expected_hash, SHA256_DIGEST_SIZE);
+    uint8_t expected_hash[LHASH_SHA256_SIZE];
+    loadVector(S, expected_hash, LHASH_SHA256_SIZE);
     /* 计算字符串映射表的SHA-256哈希 */
-    uint8_t actual_hash[SHA256_DIGEST_SIZE];
-    SHA256((uint8_t *)S->string_map, 256 * sizeof(int), actual_hash);
+    uint8_t actual_hash[LHASH_SHA256_SIZE];
+    lhash_sha256((uint8_t *)S->string_map, 256 * sizeof(int), actual_hash);
     /* 验证哈希值 */
-    if (memcmp(actual_hash, expected_hash, SHA256_DIGEST_SIZE) != 0) {
+    if (memcmp(actual_hash, expected_hash, LHASH_SHA256_SIZE) != 0) {
       error(S, "string map integrity verification failed");
       return NULL;
     }
@@ -188,8 +188,8 @@ static TString *loadStringN (LoadState *S, Proto *p) {
     if (size >= 0xFF) {
       /* 长字符串：使用图片加密 */
       // 读取字符串内容的SHA-256哈希值（完整性验证）
-      uint8_t expected_content_hash[SHA256_DIGEST_SIZE];
-      loadVector(S, expected_content_hash, SHA256_DIGEST_SIZE);
+      uint8_t expected_content_hash[LHASH_SHA256_SIZE];
+      loadVector(S, expected_content_hash, LHASH_SHA256_SIZE);
       
       // 读取图像尺寸
       int width = loadInt(S);
@@ -242,9 +242,9 @@ static TString *loadStringN (LoadState *S, Proto *p) {
       }
       
       // 验证字符串内容的SHA-256哈希值（完整性验证）
-      uint8_t actual_content_hash[SHA256_DIGEST_SIZE];
-      SHA256((uint8_t *)str, size, actual_content_hash);
-      if (memcmp(actual_content_hash, expected_content_hash, SHA256_DIGEST_SIZE) != 0) {
+      uint8_t actual_content_hash[LHASH_SHA256_SIZE];
+      lhash_sha256((uint8_t *)str, size, actual_content_hash);
+      if (memcmp(actual_content_hash, expected_content_hash, LHASH_SHA256_SIZE) != 0) {
         error(S, "string content integrity verification failed");
         return NULL;
       }
@@ -307,8 +307,8 @@ static void loadCode (LoadState *S, Proto *f) {
   }
   
   // 读取并验证OPcode映射表的SHA-256哈希值（完整性验证）
-  uint8_t expected_hash[SHA256_DIGEST_SIZE];
-  loadVector(S, expected_hash, SHA256_DIGEST_SIZE);
+  uint8_t expected_hash[LHASH_SHA256_SIZE];
+  loadVector(S, expected_hash, LHASH_SHA256_SIZE);
   /* 合并两个映射表进行哈希计算 */
   int combined_map_size = NUM_OPCODES * 2;
   int *combined_map = (int *)luaM_malloc_(S->L, combined_map_size * sizeof(int), 0);
@@ -319,11 +319,11 @@ static void loadCode (LoadState *S, Proto *f) {
   memcpy(combined_map, S->opcode_map, NUM_OPCODES * sizeof(int));
   memcpy(combined_map + NUM_OPCODES, S->third_opcode_map, NUM_OPCODES * sizeof(int));
   /* 计算SHA-256哈希 */
-  uint8_t actual_hash[SHA256_DIGEST_SIZE];
-  SHA256((uint8_t *)combined_map, combined_map_size * sizeof(int), actual_hash);
+  uint8_t actual_hash[LHASH_SHA256_SIZE];
+  lhash_sha256((uint8_t *)combined_map, combined_map_size * sizeof(int), actual_hash);
   luaM_free_(S->L, combined_map, combined_map_size * sizeof(int));
   /* 验证哈希值 */
-  if (memcmp(actual_hash, expected_hash, SHA256_DIGEST_SIZE) != 0) {
+  if (memcmp(actual_hash, expected_hash, LHASH_SHA256_SIZE) != 0) {
     error(S, "OPcode map integrity verification failed");
     return;
   }
@@ -514,7 +514,7 @@ static void loadUpvalues (LoadState *S, Proto *f) {
     
     // 计算基于时间戳的哈希值进行验证
     uint8_t expected_sha[32];
-    SHA256((uint8_t *)&S->timestamp, sizeof(S->timestamp), expected_sha);
+    lhash_sha256((uint8_t *)&S->timestamp, sizeof(S->timestamp), expected_sha);
     
     // 验证 SHA-256 数据
     if (memcmp(sha_data, expected_sha, 32) != 0) {
@@ -60,6 +60,7 @@
 #include "ltm.h"
 #include "lvm.h"
 #include "lclass.h"
+#include "ljit.h"
 
 
 /*
@@ -604,6 +605,60 @@ int luaV_lessequal (lua_State *L, const TValue *l, const TValue *r) {
 }
 
 
+/*
+** 三路比较 (spaceship operator): a <=> b
+** 返回: -1 如果 a < b, 0 如果 a == b, 1 如果 a > b
+** 支持数字和字符串的比较，其他类型报错
+*/
+static lua_Integer spaceship (lua_State *L, const TValue *a,
+                              const TValue *b) {
+  if (ttisinteger(a) && ttisinteger(b)) {
+    /* 整数比较 */
+    lua_Integer ia = ivalue(a);
+    lua_Integer ib = ivalue(b);
+    return (ia < ib) ? -1 : ((ia > ib) ? 1 : 0);
+  }
+  else if (ttisnumber(a) && ttisnumber(b)) {
+    /* 数字比较（至少有一个是浮点数） */
+    lua_Number na = ttisinteger(a) ? cast_num(ivalue(a)) : fltvalue(a);
+    lua_Number nb = ttisinteger(b) ? cast_num(ivalue(b)) : fltvalue(b);
+    return (na < nb) ? -1 : ((na > nb) ? 1 : 0);
+  }
+  else if (ttisstring(a) && ttisstring(b)) {
+    /* 字符串比较 */
+    int cmp = l_strcmp(tsvalue(a), tsvalue(b));
+    return (cmp < 0) ? -1 : ((cmp > 0) ? 1 : 0);
+  }
+  else {
+    /* 类型不同或不支持的类型 */
+    luaG_ordererror(L, a, b);
+    return 0;  /* 不会到达这里 */
+  }
+}
+
+
+/*
+** 类型判断: 'o' 的类型名是否等于字符串 'name'
+** 支持__type元方法自定义类型名称
+*/
+static int istype (lua_State *L, const TValue *o, const TValue *name) {
+  const char *typename_expected;
+  const char *typename_actual;
+  const TValue *tm;
+  /* 获取期望的类型名（必须是字符串） */
+  lua_assert(ttisstring(name));
+  typename_expected = getstr(tsvalue(name));
+  /* 尝试获取__type元方法 */
+  tm = luaT_gettmbyobj(L, o, TM_TYPE);
+  if (!notm(tm) && ttisstring(tm))
+    typename_actual = getstr(tsvalue(tm));  /* 使用__type元方法返回的类型名 */
+  else
+    typename_actual = luaT_objtypename(L, o);  /* 使用标准类型名 */
+  /* 比较类型名 */
+  return (strcmp(typename_actual, typename_expected) == 0);
+}
+
+
 /*
 ** Main operation for equality of Lua values; return 't1 == t2'.
 ** L == LUA_NULLPTR means raw equality (no metamethods)
@@ -856,7 +911,8 @@ static void pushclosure (lua_State *L, Proto *p, UpVal **encup, StkId base,
 void luaV_finishOp (lua_State *L) {
   CallInfo *ci = L->ci;
   StkId base = ci->func.p + 1;
-  Instruction inst = *(ci->u.l.savedpc - 1);  /* interrupted instruction */
+  /* interrupted instruction (in its generic form) */
+  Instruction inst = unquickened(*(ci->u.l.savedpc - 1));
   OpCode op = GET_OPCODE(inst);
   switch (op) {  /* finish its execution */
     case OP_MMBIN: case OP_MMBINI: case OP_MMBINK: {
@@ -1096,6 +1152,123 @@ void luaV_finishOp (lua_State *L) {
 /* }======================================================= */
 
 
+/*
+** {==================================================================
+** Quickening
+** ===================================================================
+*/
+
+/*
+** Number of executions with stable operand types after which a generic
+** instruction is rewritten into its specialized form.
+*/
+#if !defined(LUAI_QUICKENWARMUP)
+#define LUAI_QUICKENWARMUP	8
+#endif
+
+/* value of 'Q' in a generic instruction that must not be quickened */
+#define QBLOCKED	MAXARG_Q
+
+/*
+** A quickened field access keeps the index of the cached node in 'Q'
+** plus the high byte of 'A' (its register always fits in the low byte).
+*/
+#define MAXQNODE	((1 << (SIZE_Q + 8)) - 1)
+#define qreg(i)		(GETARG_A(i) & 0xFF)
+#define qnode(i)	(GETARG_Q(i) | ((GETARG_A(i) >> 8) << SIZE_Q))
+#define setqnode(i,n)  \
+	(SETARG_Q(i, (n) & MAXARG_Q),  \
+	 SETARG_A(i, (GETARG_A(i) & 0xFF) | (((n) >> SIZE_Q) << 8)))
+
+/* index of the node holding 'slot' in table 'h' */
+#define nodeindex(h,slot)	cast_int(cast(const Node *, slot) - (h)->node)
+
+
+/*
+** Count one execution of the generic instruction at 'ip' whose operands
+** suit quickened opcode 'q' ('n' is the node for field accesses); once
+** warmed up, rewrite the instruction. Code in fixed memory is read-only.
+*/
+static void quicken (const Proto *p, Instruction *ip, OpCode q, int n) {
+  Instruction i = *ip;
+  int count = GETARG_Q(i);
+  if (p->flag & PF_FIXED)
+    return;
+  if (count < LUAI_QUICKENWARMUP)
+    SETARG_Q(i, count + 1);
+  else {
+    SET_OPCODE(i, q);
+    setqnode(i, n);
+  }
+  *ip = i;
+}
+
+
+/*
+** Turn the instruction at 'ip' back into its generic form for good.
+*/
+static void noquicken (const Proto *p, Instruction *ip) {
+  if (!(p->flag & PF_FIXED)) {
+    Instruction i = luaP_unquicken(*ip);
+    SETARG_Q(i, QBLOCKED);
+    *ip = i;
+  }
+}
+
+
+/*
+** Point the quickened field access at 'ip' to the node holding 'slot';
+** a node out of reach blocks the instruction.
+*/
+static void recache (Instruction *ip, Table *h, const TValue *slot) {
+  int n = nodeindex(h, slot);
+  if (n <= MAXQNODE) {
+    Instruction i = *ip;
+    setqnode(i, n);
+    *ip = i;
+  }
+  else {
+    Instruction i = luaP_unquicken(*ip);
+    SETARG_Q(i, QBLOCKED);
+    *ip = i;
+  }
+}
+
+
+/*
+** Slot for short-string 'key' in node 'n' of table 'h', or NULL when that
+** node does not hold it anymore (table resized or rebuilt, key removed,
+** different table).
+*/
+static l_inline const TValue *cachedslot (Table *h, unsigned int n,
+                                          TString *key) {
+  if (n < cast_uint(sizenode(h))) {
+    Node *nd = gnode(h, n);
+    if (keyisshrstr(nd) && keystrval(nd) == key && !isempty(gval(nd)))
+      return gval(nd);
+  }
+  return NULL;
+}
+
+
+/*
+** Undo all quickening in the code of 'p', so that it holds only generic
+** instructions (e.g., before being dumped).
+*/
+void luaV_resetcode (Proto *p) {
+  int pc;
+  if (p->flag & PF_FIXED)
+    return;
+  for (pc = 0; pc < p->sizecode; pc++) {
+    Instruction i = luaP_unquicken(p->code[pc]);
+    if (i != p->code[pc])
+      p->code[pc] = i;
+  }
+}
+
+/* }================================================================== */
+
+
 /*
 ** {=======================================================
 ** Function 'luaV_execute': main interpreter loop
@@ -1198,11 +1371,723 @@ void luaV_finishOp (lua_State *L) {
   i = *(pc++); \
 }
 
+/*
+** Baseline JIT: 'jithot' counts a call or a backward jump towards
+** compiling the running function; 'jitenter' runs its native code (if
+** it has any) from 'pc' for as long as it can.
+*/
+#if defined(LUA_USE_JIT)
+#define jithot()  \
+	{ Proto *p_ = cl->p; if (p_->jit == NULL) luaJ_count(L, p_); }
+#define jitenter()  \
+	{ if (l_unlikely(cl->p->jit != NULL) && !trap) {  \
+	    pc = luaJ_run(L, ci, pc); updatetrap(ci); updatebase(ci); } }
+#else
+#define jithot()	((void)0)
+#define jitenter()	((void)0)
+#endif
+
+
 #define vmdispatch(o)	switch(o)
 #define vmcase(l)	case l:
 #define vmbreak		break
 
 
+/*
+** Quickening inside 'luaV_execute': 'curinst' is the instruction being
+** executed, as stored in the code of the running function.
+*/
+#define curinst()	cast(Instruction *, pc - 1)
+
+/* count a generic instruction towards its integer or float form */
+#define warmup2(v1,v2,qi,qf)  \
+  { if (ttisinteger(v1) && ttisinteger(v2))  \
+      quicken(cl->p, curinst(), qi, 0);  \
+    else if (ttisfloat(v1) && ttisfloat(v2))  \
+      quicken(cl->p, curinst(), qf, 0);  \
+    else noquicken(cl->p, curinst()); }
+
+/* count a generic field access that found its key in a hash node */
+#define warmupnode(h,slot,q)  \
+  { int n_ = nodeindex(h, slot);  \
+    if (n_ <= MAXQNODE) quicken(cl->p, curinst(), q, n_);  \
+    else noquicken(cl->p, curinst()); }
+
+
+/*
+** Generic arithmetic with register operands that can be quickened.
+*/
+#define op_arithQ(L,iop,fop,qi,qf) {  \
+  TValue *v1 = vRB(i);  \
+  TValue *v2 = vRC(i);  \
+  if (GETARG_Q(i) != QBLOCKED)  \
+    warmup2(v1, v2, qi, qf);  \
+  op_arith_aux(L, v1, v2, iop, fop); }
+
+
+/*
+** Quickened arithmetic over two integers or two floats. When the guard
+** fails, the instruction goes back to its generic form.
+*/
+#define op_arithII(L,iop,fop) {  \
+  TValue *v1 = vRB(i);  \
+  TValue *v2 = vRC(i);  \
+  if (l_likely(ttisinteger(v1) && ttisinteger(v2))) {  \
+    StkId ra = RA(i);  \
+    pc++; setivalue(s2v(ra), iop(L, ivalue(v1), ivalue(v2)));  \
+  }  \
+  else {  \
+    noquicken(cl->p, curinst());  \
+    op_arith_aux(L, v1, v2, iop, fop);  \
+  }}
+
+#define op_arithFF(L,iop,fop) {  \
+  TValue *v1 = vRB(i);  \
+  TValue *v2 = vRC(i);  \
+  if (l_likely(ttisfloat(v1) && ttisfloat(v2))) {  \
+    StkId ra = RA(i);  \
+    pc++; setfltvalue(s2v(ra), fop(L, fltvalue(v1), fltvalue(v2)));  \
+  }  \
+  else {  \
+    noquicken(cl->p, curinst());  \
+    op_arith_aux(L, v1, v2, iop, fop);  \
+  }}
+
+
+/*
+** Generic and quickened order operations with register operands.
+*/
+#define op_orderQ(L,opi,opn,other,qi,qf) {  \
+  if (GETARG_Q(i) != QBLOCKED)  \
+    warmup2(vRA(i), vRB(i), qi, qf);  \
+  op_order(L, opi, opn, other); }
+
+#define op_orderII(L,opi,opn,other) {  \
+  TValue *v1 = vRA(i);  \
+  TValue *v2 = vRB(i);  \
+  if (l_likely(ttisinteger(v1) && ttisinteger(v2))) {  \
+    int cond = opi(ivalue(v1), ivalue(v2));  \
+    docondjump();  \
+  }  \
+  else {  \
+    noquicken(cl->p, curinst());  \
+    op_order(L, opi, opn, other);  \
+  }}
+
+#define op_orderFF(L,opi,opf,opn,other) {  \
+  TValue *v1 = vRA(i);  \
+  TValue *v2 = vRB(i);  \
+  if (l_likely(ttisfloat(v1) && ttisfloat(v2))) {  \
+    int cond = opf(fltvalue(v1), fltvalue(v2));  \
+    docondjump();  \
+  }  \
+  else {  \
+    noquicken(cl->p, curinst());  \
+    op_order(L, opi, opn, other);  \
+  }}
+
+
+/*
+** Quickened read of field 'kv' (a short string) from table 't'. On a
+** cache miss, a key found in another node is cached instead; otherwise
+** the instruction goes back to its generic form.
+*/
+#define op_getfieldN(L,t,kv) {  \
+  const TValue *slot;  \
+  TString *key = tsvalue(kv);  \
+  if (l_likely(ttistable(t)) &&  \
+      (slot = cachedslot(hvalue(t), qnode(i), key)) != NULL) {  \
+    setobj2s(L, base + qreg(i), slot);  \
+  }  \
+  else {  /* cache miss */  \
+    StkId ra;  \
+    i = luaP_unquicken(i);  \
+    ra = RA(i);  \
+    if (luaV_fastget(L, t, key, slot, luaH_getshortstr)) {  \
+      recache(curinst(), hvalue(t), slot);  \
+      setobj2s(L, ra, slot);  \
+    }  \
+    else {  \
+      noquicken(cl->p, curinst());  \
+      Protect(luaV_finishget(L, t, kv, ra, slot));  \
+    }  \
+  }}
+
+
+/*
+** A call to a sleeping Lua function goes to the function's call queue
+** instead, and all its results are nil. Returns true if the call at
+** 'ra' was queued.
+*/
+static int queuecall (lua_State *L, StkId ra, int nresults) {
+  if (ra <= L->top.p && ttisLclosure(s2v(ra))) {
+    Proto *p = clLvalue(s2v(ra))->p;
+    if (p->is_sleeping) {
+      int nargs = cast_int(L->top.p - ra) - 1;
+      if (p->call_queue == NULL) {
+        p->call_queue = luaF_newcallqueue(L);
+      }
+      luaF_callqueuepush(L, p->call_queue, nargs);
+      L->top.p = ra + nresults + 1;
+      if (nresults >= 0) {
+        for (int j = 1; j <= nresults; j++) {
+          setnilvalue(s2v(ra + j - 1));
+        }
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+/*
+** Bodies of the instructions that 'luaV_execute' shares with the
+** templates of the baseline JIT (see the end of this file). They use
+** the interpreter's 'L', 'ci', 'cl', 'k', 'base', 'pc', 'i' and 'trap'.
+*/
+#define op_move(L) {  \
+  StkId ra = RA(i);  \
+  setobjs2s(L, ra, RB(i)); }
+
+#define op_loadi(L) {  \
+  StkId ra = RA(i);  \
+  lua_Integer b = GETARG_sBx(i);  \
+  setivalue(s2v(ra), b); }
+
+#define op_loadf(L) {  \
+  StkId ra = RA(i);  \
+  int b = GETARG_sBx(i);  \
+  setfltvalue(s2v(ra), cast_num(b)); }
+
+#define op_loadk(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = k + GETARG_Bx(i);  \
+  setobj2s(L, ra, rb); }
+
+#define op_loadkx(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb;  \
+  rb = k + GETARG_Ax(*pc); pc++;  \
+  setobj2s(L, ra, rb); }
+
+#define op_loadfalse(L) {  \
+  StkId ra = RA(i);  \
+  setbfvalue(s2v(ra)); }
+
+#define op_lfalseskip(L) {  \
+  StkId ra = RA(i);  \
+  setbfvalue(s2v(ra));  \
+  pc++;  /* skip next instruction */ }
+
+#define op_loadtrue(L) {  \
+  StkId ra = RA(i);  \
+  setbtvalue(s2v(ra)); }
+
+#define op_loadnil(L) {  \
+  StkId ra = RA(i);  \
+  int b = GETARG_B(i);  \
+  do {  \
+    setnilvalue(s2v(ra++));  \
+  } while (b--); }
+
+#define op_getupval(L) {  \
+  StkId ra = RA(i);  \
+  int b = GETARG_B(i);  \
+  setobj2s(L, ra, cl->upvals[b]->v.p); }
+
+#define op_setupval(L) {  \
+  StkId ra = RA(i);  \
+  UpVal *uv = cl->upvals[GETARG_B(i)];  \
+  setobj(L, uv->v.p, s2v(ra));  \
+  luaC_barrier(L, uv, s2v(ra)); }
+
+#define op_gettabup(L) {  \
+  StkId ra = RA(i);  \
+  const TValue *slot;  \
+  TValue *upval = cl->upvals[GETARG_B(i)]->v.p;  \
+  TValue *rc = KC(i);  \
+  TString *key = tsvalue(rc);  /* key must be a short string */  \
+  if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {  \
+    if (GETARG_Q(i) != QBLOCKED)  \
+      warmupnode(hvalue(upval), slot, OP_GETTABUP_N);  \
+    setobj2s(L, ra, slot);  \
+  }  \
+  else  \
+    Protect(luaV_finishget(L, upval, rc, ra, slot)); }
+
+#define op_gettable(L) {  \
+  StkId ra = RA(i);  \
+  const TValue *slot;  \
+  TValue *rb = vRB(i);  \
+  TValue *rc = vRC(i);  \
+  lua_Unsigned n;  \
+  if (ttisinteger(rc)  /* fast track for integers? */  \
+      ? (cast_void(n = ivalue(rc)), luaV_fastgeti(L, rb, n, slot))  \
+      : luaV_fastget(L, rb, rc, slot, luaH_get)) {  \
+    setobj2s(L, ra, slot);  \
+  }  \
+  else  \
+    Protect(luaV_finishget(L, rb, rc, ra, slot)); }
+
+#define op_geti(L) {  \
+  StkId ra = RA(i);  \
+  const TValue *slot;  \
+  TValue *rb = vRB(i);  \
+  int c = GETARG_C(i);  \
+  if (luaV_fastgeti(L, rb, c, slot)) {  \
+    setobj2s(L, ra, slot);  \
+  }  \
+  else {  \
+    TValue key;  \
+    setivalue(&key, c);  \
+    Protect(luaV_finishget(L, rb, &key, ra, slot));  \
+  }}
+
+#define op_getfield(L) {  \
+  StkId ra = RA(i);  \
+  const TValue *slot;  \
+  TValue *rb = vRB(i);  \
+  TValue *rc = KC(i);  \
+  TString *key = tsvalue(rc);  /* key must be a short string */  \
+  if (luaV_fastget(L, rb, key, slot, luaH_getshortstr)) {  \
+    if (GETARG_Q(i) != QBLOCKED)  /* before 'ra' may overwrite 'rb' */  \
+      warmupnode(hvalue(rb), slot, OP_GETFIELD_N);  \
+    setobj2s(L, ra, slot);  \
+  }  \
+  else  \
+    Protect(luaV_finishget(L, rb, rc, ra, slot)); }
+
+#define op_settabup(L) {  \
+  const TValue *slot;  \
+  TValue *upval = cl->upvals[GETARG_A(i)]->v.p;  \
+  TValue *rb = KB(i);  \
+  TValue *rc = RKC(i);  \
+  TString *key = tsvalue(rb);  /* key must be a short string */  \
+  if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {  \
+    luaV_finishfastset(L, upval, slot, rc);  \
+  }  \
+  else  \
+    Protect(luaV_finishset(L, upval, rb, rc, slot)); }
+
+#define op_settable(L) {  \
+  StkId ra = RA(i);  \
+  const TValue *slot;  \
+  TValue *rb = vRB(i);  /* key (table is in 'ra') */  \
+  TValue *rc = RKC(i);  /* value */  \
+  lua_Unsigned n;  \
+  if (ttisinteger(rb)  /* fast track for integers? */  \
+      ? (cast_void(n = ivalue(rb)), luaV_fastgeti(L, s2v(ra), n, slot))  \
+      : luaV_fastget(L, s2v(ra), rb, slot, luaH_get)) {  \
+    luaV_finishfastset(L, s2v(ra), slot, rc);  \
+  }  \
+  else  \
+    Protect(luaV_finishset(L, s2v(ra), rb, rc, slot)); }
+
+#define op_seti(L) {  \
+  StkId ra = RA(i);  \
+  const TValue *slot;  \
+  int c = GETARG_B(i);  \
+  TValue *rc = RKC(i);  \
+  if (luaV_fastgeti(L, s2v(ra), c, slot)) {  \
+    luaV_finishfastset(L, s2v(ra), slot, rc);  \
+  }  \
+  else {  \
+    TValue key;  \
+    setivalue(&key, c);  \
+    Protect(luaV_finishset(L, s2v(ra), &key, rc, slot));  \
+  }}
+
+#define op_setfield(L) {  \
+  StkId ra = RA(i);  \
+  const TValue *slot;  \
+  TValue *rb = KB(i);  \
+  TValue *rc = RKC(i);  \
+  TString *key = tsvalue(rb);  /* key must be a short string */  \
+  if (luaV_fastget(L, s2v(ra), key, slot, luaH_getshortstr)) {  \
+    if (GETARG_Q(i) != QBLOCKED)  \
+      warmupnode(hvalue(s2v(ra)), slot, OP_SETFIELD_N);  \
+    luaV_finishfastset(L, s2v(ra), slot, rc);  \
+  }  \
+  else  \
+    Protect(luaV_finishset(L, s2v(ra), rb, rc, slot)); }
+
+#define op_newtable(L) {  \
+  StkId ra = RA(i);  \
+  unsigned b = cast_uint(GETARG_B(i));  /* log2(hash size) + 1 */  \
+  unsigned c = cast_uint(GETARG_C(i));  /* array size */  \
+  Table *t;  \
+  if (b > 0)  \
+    b = 1u << (b - 1);  /* hash size is 2^(b - 1) */  \
+  if (TESTARG_k(i)) {  /* non-zero extra argument? */  \
+    lua_assert(GETARG_Ax(*pc) != 0);  \
+    /* add it to array size */  \
+    c += cast_uint(GETARG_Ax(*pc)) * (MAXARG_C + 1);  \
+  }  \
+  pc++;  /* skip extra argument */  \
+  L->top.p = ra + 1;  /* correct top in case of emergency GC */  \
+  t = luaH_new(L);  /* memory allocation */  \
+  sethvalue2s(L, ra, t);  \
+  if (b != 0 || c != 0)  \
+    luaH_resize(L, t, c, b);  /* idem */  \
+  checkGC(L, ra + 1); }
+
+#define op_self(L) {  \
+  StkId ra = RA(i);  \
+  const TValue *slot;  \
+  TValue *rb = vRB(i);  \
+  TValue *rc = RKC(i);  \
+  TString *key = tsvalue(rc);  /* key must be a string */  \
+  setobj2s(L, ra + 1, rb);  \
+  if (luaV_fastget(L, rb, key, slot, luaH_getstr)) {  \
+    setobj2s(L, ra, slot);  \
+  }  \
+  else  \
+    Protect(luaV_finishget(L, rb, rc, ra, slot)); }
+
+#define op_shli(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  int ic = GETARG_sC(i);  \
+  lua_Integer ib;  \
+  if (tointegerns(rb, &ib)) {  \
+    pc++; setivalue(s2v(ra), luaV_shiftl(ic, ib));  \
+  }}
+
+#define op_shri(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  int ic = GETARG_sC(i);  \
+  lua_Integer ib;  \
+  if (tointegerns(rb, &ib)) {  \
+    pc++; setivalue(s2v(ra), luaV_shiftl(ib, -ic));  \
+  }}
+
+#define op_spaceship(L) {  \
+  StkId ra = RA(i);  \
+  lua_Integer result;  \
+  halfProtect(result = spaceship(L, vRB(i), vRC(i)));  \
+  setivalue(s2v(ra), result); }
+
+#define op_mmbin(L) {  \
+  StkId ra = RA(i);  \
+  Instruction pi = *(pc - 2);  /* original arith. expression */  \
+  TValue *rb = vRB(i);  \
+  TMS tm = (TMS)GETARG_C(i);  \
+  StkId result = RA(pi);  \
+  lua_assert(OP_ADD <= GET_OPCODE(pi) && GET_OPCODE(pi) <= OP_SHR);  \
+  Protect(luaT_trybinTM(L, s2v(ra), rb, result, tm)); }
+
+#define op_mmbini(L) {  \
+  StkId ra = RA(i);  \
+  Instruction pi = *(pc - 2);  /* original arith. expression */  \
+  int imm = GETARG_sB(i);  \
+  TMS tm = (TMS)GETARG_C(i);  \
+  int flip = GETARG_k(i);  \
+  StkId result = RA(pi);  \
+  Protect(luaT_trybiniTM(L, s2v(ra), imm, flip, result, tm)); }
+
+#define op_mmbink(L) {  \
+  StkId ra = RA(i);  \
+  Instruction pi = *(pc - 2);  /* original arith. expression */  \
+  TValue *imm = KB(i);  \
+  TMS tm = (TMS)GETARG_C(i);  \
+  int flip = GETARG_k(i);  \
+  StkId result = RA(pi);  \
+  Protect(luaT_trybinassocTM(L, s2v(ra), imm, flip, result, tm)); }
+
+#define op_unm(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  lua_Number nb;  \
+  if (ttisinteger(rb)) {  \
+    lua_Integer ib = ivalue(rb);  \
+    setivalue(s2v(ra), intop(-, 0, ib));  \
+  }  \
+  else if (tonumberns(rb, nb)) {  \
+    setfltvalue(s2v(ra), luai_numunm(L, nb));  \
+  }  \
+  else  \
+    Protect(luaT_trybinTM(L, rb, rb, ra, TM_UNM)); }
+
+#define op_bnot(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  lua_Integer ib;  \
+  if (tointegerns(rb, &ib)) {  \
+    setivalue(s2v(ra), intop(^, ~l_castS2U(0), ib));  \
+  }  \
+  else  \
+    Protect(luaT_trybinTM(L, rb, rb, ra, TM_BNOT)); }
+
+#define op_not(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  if (l_isfalse(rb))  \
+    setbtvalue(s2v(ra));  \
+  else  \
+    setbfvalue(s2v(ra)); }
+
+#define op_len(L) {  \
+  StkId ra = RA(i);  \
+  Protect(luaV_objlen(L, ra, vRB(i))); }
+
+#define op_concat(L) {  \
+  StkId ra = RA(i);  \
+  int n = GETARG_B(i);  /* number of elements to concatenate */  \
+  L->top.p = ra + n;  /* mark the end of concat operands */  \
+  ProtectNT(luaV_concat(L, n));  \
+  checkGC(L, L->top.p); /* 'luaV_concat' ensures correct top */ }
+
+#define op_close(L) {  \
+  StkId ra = RA(i);  \
+  lua_assert(!GETARG_B(i));  /* 'close must be alive */  \
+  Protect(luaF_close(L, ra, LUA_OK, 1)); }
+
+#define op_tbc(L) {  \
+  StkId ra = RA(i);  \
+  /* create new to-be-closed upvalue */  \
+  halfProtect(luaF_newtbcupval(L, ra)); }
+
+#define op_eq(L) {  \
+  StkId ra = RA(i);  \
+  int cond;  \
+  TValue *rb = vRB(i);  \
+  Protect(cond = luaV_equalobj(L, s2v(ra), rb));  \
+  docondjump(); }
+
+#define op_eqk(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = KB(i);  \
+  /* basic types do not use '__eq'; we can use raw equality */  \
+  int cond = luaV_rawequalobj(s2v(ra), rb);  \
+  docondjump(); }
+
+#define op_eqi(L) {  \
+  StkId ra = RA(i);  \
+  int cond;  \
+  int im = GETARG_sB(i);  \
+  if (ttisinteger(s2v(ra)))  \
+    cond = (ivalue(s2v(ra)) == im);  \
+  else if (ttisfloat(s2v(ra)))  \
+    cond = luai_numeq(fltvalue(s2v(ra)), cast_num(im));  \
+  else  \
+    cond = 0;  /* other types cannot be equal to a number */  \
+  docondjump(); }
+
+#define op_test(L) {  \
+  StkId ra = RA(i);  \
+  int cond = !l_isfalse(s2v(ra));  \
+  docondjump(); }
+
+#define op_testset(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  if (l_isfalse(rb) == GETARG_k(i))  \
+    pc++;  \
+  else {  \
+    setobj2s(L, ra, rb);  \
+    donextjump(ci);  \
+  }}
+
+#define op_forloop(L) {  \
+  StkId ra = RA(i);  \
+  if (ttisinteger(s2v(ra + 2))) {  /* integer loop? */  \
+    lua_Unsigned count = l_castS2U(ivalue(s2v(ra + 1)));  \
+    if (count > 0) {  /* still more iterations? */  \
+      lua_Integer step = ivalue(s2v(ra + 2));  \
+      lua_Integer idx = ivalue(s2v(ra));  /* internal index */  \
+      chgivalue(s2v(ra + 1), count - 1);  /* update counter */  \
+      idx = intop(+, idx, step);  /* add step to index */  \
+      chgivalue(s2v(ra), idx);  /* update internal index */  \
+      setivalue(s2v(ra + 3), idx);  /* and control variable */  \
+      pc -= GETARG_Bx(i);  /* jump back */  \
+    }  \
+  }  \
+  else if (floatforloop(ra))  /* float loop */  \
+    pc -= GETARG_Bx(i);  /* jump back */  \
+  updatetrap(ci);  /* allows a signal to break the loop */  \
+  jithot();  \
+  jitenter(); }
+
+#define op_forprep(L) {  \
+  StkId ra = RA(i);  \
+  savestate(L, ci);  /* in case of errors */  \
+  if (forprep(L, ra))  \
+    pc += GETARG_Bx(i) + 1;  /* skip the loop */ }
+
+#define op_tforprep(L) {  \
+  StkId ra = RA(i);  \
+  /* create to-be-closed upvalue (if needed) */  \
+  halfProtect(luaF_newtbcupval(L, ra + 3));  \
+  pc += GETARG_Bx(i); }
+
+#define op_tforcall(L) {  \
+  StkId ra = RA(i);  \
+  /* 'ra' has the iterator function, 'ra + 1' has the state,  \
+     'ra + 2' has the control variable, and 'ra + 3' has the  \
+     to-be-closed variable. The call will use the stack after  \
+     these values (starting at 'ra + 4')  \
+  */  \
+  /* push function, state, and control variable */  \
+  memcpy(ra + 4, ra, 3 * sizeof(*ra));  \
+  L->top.p = ra + 4 + 3;  \
+  ProtectNT(luaD_call(L, ra + 4, GETARG_C(i)));  /* do the call */  \
+  updatestack(ci);  /* stack may have changed */ }
+
+#define op_tforloop(L) {  \
+  StkId ra = RA(i);  \
+  if (!ttisnil(s2v(ra + 4))) {  /* continue loop? */  \
+    setobjs2s(L, ra + 2, ra + 4);  /* save control variable */  \
+    pc -= GETARG_Bx(i);  /* jump back */  \
+    jithot();  \
+    jitenter();  \
+  }}
+
+#define op_setlist(L) {  \
+  StkId ra = RA(i);  \
+  int n = GETARG_B(i);  \
+  unsigned int last = GETARG_C(i);  \
+  Table *h = hvalue(s2v(ra));  \
+  if (n == 0)  \
+    n = cast_int(L->top.p - ra) - 1;  /* get up to the top */  \
+  else  \
+    L->top.p = ci->top.p;  /* correct top in case of emergency GC */  \
+  last += n;  \
+  if (TESTARG_k(i)) {  \
+    last += GETARG_Ax(*pc) * (MAXARG_C + 1);  \
+    pc++;  \
+  }  \
+  if (last > luaH_realasize(h))  /* needs more space? */  \
+    luaH_resizearray(L, h, last);  /* preallocate it at once */  \
+  for (; n > 0; n--) {  \
+    TValue *val = s2v(ra + n);  \
+    setobj2t(L, &h->array[last - 1], val);  \
+    last--;  \
+    luaC_barrierback(L, obj2gco(h), val);  \
+  }}
+
+#define op_closure(L) {  \
+  StkId ra = RA(i);  \
+  Proto *p = cl->p->p[GETARG_Bx(i)];  \
+  halfProtect(pushclosure(L, p, cl->upvals, base, ra));  \
+  checkGC(L, ra + 1); }
+
+#define op_vararg(L) {  \
+  StkId ra = RA(i);  \
+  int n = GETARG_C(i) - 1;  /* required results (-1 means all) */  \
+  Protect(luaT_getvarargs(L, ci, ra, n)); }
+
+#define op_getvarg(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rc = vRC(i);  \
+  luaT_getvararg(L, ci, ra, rc); }
+
+#define op_errnnil(L) {  \
+  TValue *ra = vRA(i);  \
+  if (!ttisnil(ra))  \
+    halfProtect(luaG_errnnil(L, cl, GETARG_Bx(i))); }
+
+#define op_getsuper(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  TString *key = tsvalue(&k[GETARG_C(i)]);  \
+  savestate(L, ci);  \
+  setobj2s(L, L->top.p, rb);  \
+  L->top.p++;  \
+  luaC_super(L, -1, key);  \
+  setobj2s(L, ra, s2v(L->top.p - 1));  \
+  L->top.p -= 2;  \
+  updatetrap(ci); }
+
+#define op_newobj(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  int nargs = GETARG_C(i) - 1;  \
+  savestate(L, ci);  \
+  setobj2s(L, L->top.p, rb);  \
+  L->top.p++;  \
+  for (int j = 0; j < nargs; j++) {  \
+    setobj2s(L, L->top.p, s2v(ra + 1 + j));  \
+    L->top.p++;  \
+  }  \
+  luaC_newobject(L, -(nargs + 1), nargs);  \
+  setobj2s(L, ra, s2v(L->top.p - 1));  \
+  L->top.p -= (nargs + 2);  \
+  updatetrap(ci);  \
+  checkGC(L, ra + 1); }
+
+#define op_getprop(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  TString *key = tsvalue(&k[GETARG_C(i)]);  \
+  savestate(L, ci);  \
+  setobj2s(L, L->top.p, rb);  \
+  L->top.p++;  \
+  luaC_getprop(L, -1, key);  \
+  setobj2s(L, ra, s2v(L->top.p - 1));  \
+  L->top.p -= 2;  \
+  updatetrap(ci); }
+
+#define op_setprop(L) {  \
+  StkId ra = RA(i);  \
+  TString *key = tsvalue(&k[GETARG_B(i)]);  \
+  TValue *rc = RKC(i);  \
+  savestate(L, ci);  \
+  setobj2s(L, L->top.p, s2v(ra));  \
+  L->top.p++;  \
+  setobj2s(L, L->top.p, rc);  \
+  L->top.p++;  \
+  luaC_setprop(L, -2, key, -1);  \
+  L->top.p -= 2;  \
+  updatetrap(ci); }
+
+#define op_instanceof(L) {  \
+  StkId ra = RA(i);  \
+  TValue *rb = vRB(i);  \
+  int result;  \
+  savestate(L, ci);  \
+  setobj2s(L, L->top.p, s2v(ra));  \
+  L->top.p++;  \
+  setobj2s(L, L->top.p, rb);  \
+  L->top.p++;  \
+  result = luaC_instanceof(L, -2, -1);  \
+  L->top.p -= 2;  \
+  updatetrap(ci);  \
+  if (result != GETARG_k(i))  \
+    pc++;  /* 条件不满足，跳过下一条指令 */ }
+
+#define op_is(L) {  \
+  int cond = istype(L, vRA(i), KB(i));  \
+  docondjump(); }
+
+#define op_testnil(L) {  \
+  TValue *rb = vRB(i);  \
+  if (ttisnil(rb) != GETARG_k(i))  \
+    pc++;  /* skip the jump */ }
+
+#define op_setfieldN(L) {  \
+  StkId ra = base + qreg(i);  \
+  const TValue *slot;  \
+  TValue *rb = KB(i);  \
+  TValue *rc = RKC(i);  \
+  TString *key = tsvalue(rb);  \
+  if (l_likely(ttistable(s2v(ra))) &&  \
+      (slot = cachedslot(hvalue(s2v(ra)), qnode(i), key)) != NULL) {  \
+    luaV_finishfastset(L, s2v(ra), slot, rc);  \
+  }  \
+  else {  /* cache miss */  \
+    if (luaV_fastget(L, s2v(ra), key, slot, luaH_getshortstr)) {  \
+      recache(curinst(), hvalue(s2v(ra)), slot);  \
+      luaV_finishfastset(L, s2v(ra), slot, rc);  \
+    }  \
+    else {  \
+      noquicken(cl->p, curinst());  \
+      Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));  \
+    }  \
+  }}
+
+
 void luaV_execute (lua_State *L, CallInfo *ci) {
   LClosure *cl;
   TValue *k;
@@ -1221,6 +2106,9 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
   if (l_unlikely(trap))
     trap = luaG_tracecall(L);
   base = ci->func.p + 1;
+  if (pc == cl->p->code)  /* a new call? */
+    jithot();
+  jitenter();
   /* main loop of interpreter */
   for (;;) {
     Instruction i;  /* instruction being executed */
@@ -1239,217 +2127,87 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
     lua_assert(isIT(i) || (cast_void(L->top.p = base), 1));
     vmdispatch (GET_OPCODE(i)) {
       vmcase(OP_MOVE) {
-        StkId ra = RA(i);
-        setobjs2s(L, ra, RB(i));
+        op_move(L);
         vmbreak;
       }
       vmcase(OP_LOADI) {
-        StkId ra = RA(i);
-        lua_Integer b = GETARG_sBx(i);
-        setivalue(s2v(ra), b);
+        op_loadi(L);
         vmbreak;
       }
       vmcase(OP_LOADF) {
-        StkId ra = RA(i);
-        int b = GETARG_sBx(i);
-        setfltvalue(s2v(ra), cast_num(b));
+        op_loadf(L);
         vmbreak;
       }
       vmcase(OP_LOADK) {
-        StkId ra = RA(i);
-        TValue *rb = k + GETARG_Bx(i);
-        setobj2s(L, ra, rb);
+        op_loadk(L);
         vmbreak;
       }
       vmcase(OP_LOADKX) {
-        StkId ra = RA(i);
-        TValue *rb;
-        rb = k + GETARG_Ax(*pc); pc++;
-        setobj2s(L, ra, rb);
+        op_loadkx(L);
         vmbreak;
       }
       vmcase(OP_LOADFALSE) {
-        StkId ra = RA(i);
-        setbfvalue(s2v(ra));
+        op_loadfalse(L);
         vmbreak;
       }
       vmcase(OP_LFALSESKIP) {
-        StkId ra = RA(i);
-        setbfvalue(s2v(ra));
-        pc++;  /* skip next instruction */
+        op_lfalseskip(L);
         vmbreak;
       }
       vmcase(OP_LOADTRUE) {
-        StkId ra = RA(i);
-        setbtvalue(s2v(ra));
+        op_loadtrue(L);
         vmbreak;
       }
       vmcase(OP_LOADNIL) {
-        StkId ra = RA(i);
-        int b = GETARG_B(i);
-        do {
-          setnilvalue(s2v(ra++));
-        } while (b--);
+        op_loadnil(L);
         vmbreak;
       }
       vmcase(OP_GETUPVAL) {
-        StkId ra = RA(i);
-        int b = GETARG_B(i);
-        setobj2s(L, ra, cl->upvals[b]->v.p);
+        op_getupval(L);
         vmbreak;
       }
       vmcase(OP_SETUPVAL) {
-        StkId ra = RA(i);
-        UpVal *uv = cl->upvals[GETARG_B(i)];
-        setobj(L, uv->v.p, s2v(ra));
-        luaC_barrier(L, uv, s2v(ra));
+        op_setupval(L);
         vmbreak;
       }
       vmcase(OP_GETTABUP) {
-        StkId ra = RA(i);
-        const TValue *slot;
-        TValue *upval = cl->upvals[GETARG_B(i)]->v.p;
-        TValue *rc = KC(i);
-        TString *key = tsvalue(rc);  /* key must be a short string */
-        if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, upval, rc, ra, slot));
+        op_gettabup(L);
         vmbreak;
       }
       vmcase(OP_GETTABLE) {
-        StkId ra = RA(i);
-        const TValue *slot;
-        TValue *rb = vRB(i);
-        TValue *rc = vRC(i);
-        lua_Unsigned n;
-        if (ttisinteger(rc)  /* fast track for integers? */
-            ? (cast_void(n = ivalue(rc)), luaV_fastgeti(L, rb, n, slot))
-            : luaV_fastget(L, rb, rc, slot, luaH_get)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, rb, rc, ra, slot));
+        op_gettable(L);
         vmbreak;
       }
       vmcase(OP_GETI) {
-        StkId ra = RA(i);
-        const TValue *slot;
-        TValue *rb = vRB(i);
-        int c = GETARG_C(i);
-        if (luaV_fastgeti(L, rb, c, slot)) {
-          setobj2s(L, ra, slot);
-        }
-        else {
-          TValue key;
-          setivalue(&key, c);
-          Protect(luaV_finishget(L, rb, &key, ra, slot));
-        }
+        op_geti(L);
         vmbreak;
       }
       vmcase(OP_GETFIELD) {
-        StkId ra = RA(i);
-        const TValue *slot;
-        TValue *rb = vRB(i);
-        TValue *rc = KC(i);
-        TString *key = tsvalue(rc);  /* key must be a short string */
-        if (luaV_fastget(L, rb, key, slot, luaH_getshortstr)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, rb, rc, ra, slot));
+        op_getfield(L);
         vmbreak;
       }
       vmcase(OP_SETTABUP) {
-        const TValue *slot;
-        TValue *upval = cl->upvals[GETARG_A(i)]->v.p;
-        TValue *rb = KB(i);
-        TValue *rc = RKC(i);
-        TString *key = tsvalue(rb);  /* key must be a short string */
-        if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {
-          luaV_finishfastset(L, upval, slot, rc);
-        }
-        else
-          Protect(luaV_finishset(L, upval, rb, rc, slot));
+        op_settabup(L);
         vmbreak;
       }
       vmcase(OP_SETTABLE) {
-        StkId ra = RA(i);
-        const TValue *slot;
-        TValue *rb = vRB(i);  /* key (table is in 'ra') */
-        TValue *rc = RKC(i);  /* value */
-        lua_Unsigned n;
-        if (ttisinteger(rb)  /* fast track for integers? */
-            ? (cast_void(n = ivalue(rb)), luaV_fastgeti(L, s2v(ra), n, slot))
-            : luaV_fastget(L, s2v(ra), rb, slot, luaH_get)) {
-          luaV_finishfastset(L, s2v(ra), slot, rc);
-        }
-        else
-          Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));
+        op_settable(L);
         vmbreak;
       }
       vmcase(OP_SETI) {
-        StkId ra = RA(i);
-        const TValue *slot;
-        int c = GETARG_B(i);
-        TValue *rc = RKC(i);
-        if (luaV_fastgeti(L, s2v(ra), c, slot)) {
-          luaV_finishfastset(L, s2v(ra), slot, rc);
-        }
-        else {
-          TValue key;
-          setivalue(&key, c);
-          Protect(luaV_finishset(L, s2v(ra), &key, rc, slot));
-        }
+        op_seti(L);
         vmbreak;
       }
       vmcase(OP_SETFIELD) {
-        StkId ra = RA(i);
-        const TValue *slot;
-        TValue *rb = KB(i);
-        TValue *rc = RKC(i);
-        TString *key = tsvalue(rb);  /* key must be a short string */
-        if (luaV_fastget(L, s2v(ra), key, slot, luaH_getshortstr)) {
-          luaV_finishfastset(L, s2v(ra), slot, rc);
-        }
-        else
-          Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));
+        op_setfield(L);
         vmbreak;
       }
       vmcase(OP_NEWTABLE) {
-        StkId ra = RA(i);
-        unsigned b = cast_uint(GETARG_B(i));  /* log2(hash size) + 1 */
-        unsigned c = cast_uint(GETARG_C(i));  /* array size */
-        Table *t;
-        if (b > 0)
-          b = 1u << (b - 1);  /* hash size is 2^(b - 1) */
-        if (TESTARG_k(i)) {  /* non-zero extra argument? */
-          lua_assert(GETARG_Ax(*pc) != 0);
-          /* add it to array size */
-          c += cast_uint(GETARG_Ax(*pc)) * (MAXARG_C + 1);
-        }
-        pc++;  /* skip extra argument */
-        L->top.p = ra + 1;  /* correct top in case of emergency GC */
-        t = luaH_new(L);  /* memory allocation */
-        sethvalue2s(L, ra, t);
-        if (b != 0 || c != 0)
-          luaH_resize(L, t, c, b);  /* idem */
-        checkGC(L, ra + 1);
+        op_newtable(L);
         vmbreak;
       }
       vmcase(OP_SELF) {
-        StkId ra = RA(i);
-        const TValue *slot;
-        TValue *rb = vRB(i);
-        TValue *rc = RKC(i);
-        TString *key = tsvalue(rc);  /* key must be a string */
-        setobj2s(L, ra + 1, rb);
-        if (luaV_fastget(L, rb, key, slot, luaH_getstr)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, rb, rc, ra, slot));
+        op_self(L);
         vmbreak;
       }
       vmcase(OP_ADDI) {
@@ -1499,35 +2257,23 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         vmbreak;
       }
       vmcase(OP_SHLI) {
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        int ic = GETARG_sC(i);
-        lua_Integer ib;
-        if (tointegerns(rb, &ib)) {
-          pc++; setivalue(s2v(ra), luaV_shiftl(ic, ib));
-        }
+        op_shli(L);
         vmbreak;
       }
       vmcase(OP_SHRI) {
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        int ic = GETARG_sC(i);
-        lua_Integer ib;
-        if (tointegerns(rb, &ib)) {
-          pc++; setivalue(s2v(ra), luaV_shiftl(ib, -ic));
-        }
+        op_shri(L);
         vmbreak;
       }
       vmcase(OP_ADD) {
-        op_arith(L, l_addi, luai_numadd);
+        op_arithQ(L, l_addi, luai_numadd, OP_ADD_II, OP_ADD_FF);
         vmbreak;
       }
       vmcase(OP_SUB) {
-        op_arith(L, l_subi, luai_numsub);
+        op_arithQ(L, l_subi, luai_numsub, OP_SUB_II, OP_SUB_FF);
         vmbreak;
       }
       vmcase(OP_MUL) {
-        op_arith(L, l_muli, luai_nummul);
+        op_arithQ(L, l_muli, luai_nummul, OP_MUL_II, OP_MUL_FF);
         vmbreak;
       }
       vmcase(OP_MOD) {
@@ -1574,175 +2320,75 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         ** 返回: -1 如果 a < b, 0 如果 a == b, 1 如果 a > b
         ** 支持数字和字符串的比较
         */
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        TValue *rc = vRC(i);
-        lua_Integer result;
-        
-        if (ttisinteger(rb) && ttisinteger(rc)) {
-          /* 整数比较 */
-          lua_Integer ib = ivalue(rb);
-          lua_Integer ic = ivalue(rc);
-          result = (ib < ic) ? -1 : ((ib > ic) ? 1 : 0);
-        }
-        else if (ttisnumber(rb) && ttisnumber(rc)) {
-          /* 数字比较（至少有一个是浮点数） */
-          lua_Number nb, nc;
-          if (ttisinteger(rb)) {
-            nb = cast_num(ivalue(rb));
-          } else {
-            nb = fltvalue(rb);
-          }
-          if (ttisinteger(rc)) {
-            nc = cast_num(ivalue(rc));
-          } else {
-            nc = fltvalue(rc);
-          }
-          result = (nb < nc) ? -1 : ((nb > nc) ? 1 : 0);
-        }
-        else if (ttisstring(rb) && ttisstring(rc)) {
-          /* 字符串比较 */
-          int cmp = l_strcmp(tsvalue(rb), tsvalue(rc));
-          result = (cmp < 0) ? -1 : ((cmp > 0) ? 1 : 0);
-        }
-        else {
-          /* 类型不同或不支持的类型 */
-          Protect(luaG_ordererror(L, rb, rc));
-          result = 0;  /* 不会到达这里 */
-        }
-        
-        setivalue(s2v(ra), result);
+        op_spaceship(L);
         vmbreak;
       }
       vmcase(OP_MMBIN) {
-        StkId ra = RA(i);
-        Instruction pi = *(pc - 2);  /* original arith. expression */
-        TValue *rb = vRB(i);
-        TMS tm = (TMS)GETARG_C(i);
-        StkId result = RA(pi);
-        lua_assert(OP_ADD <= GET_OPCODE(pi) && GET_OPCODE(pi) <= OP_SHR);
-        Protect(luaT_trybinTM(L, s2v(ra), rb, result, tm));
+        op_mmbin(L);
         vmbreak;
       }
       vmcase(OP_MMBINI) {
-        StkId ra = RA(i);
-        Instruction pi = *(pc - 2);  /* original arith. expression */
-        int imm = GETARG_sB(i);
-        TMS tm = (TMS)GETARG_C(i);
-        int flip = GETARG_k(i);
-        StkId result = RA(pi);
-        Protect(luaT_trybiniTM(L, s2v(ra), imm, flip, result, tm));
+        op_mmbini(L);
         vmbreak;
       }
       vmcase(OP_MMBINK) {
-        StkId ra = RA(i);
-        Instruction pi = *(pc - 2);  /* original arith. expression */
-        TValue *imm = KB(i);
-        TMS tm = (TMS)GETARG_C(i);
-        int flip = GETARG_k(i);
-        StkId result = RA(pi);
-        Protect(luaT_trybinassocTM(L, s2v(ra), imm, flip, result, tm));
+        op_mmbink(L);
         vmbreak;
       }
       vmcase(OP_UNM) {
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        lua_Number nb;
-        if (ttisinteger(rb)) {
-          lua_Integer ib = ivalue(rb);
-          setivalue(s2v(ra), intop(-, 0, ib));
-        }
-        else if (tonumberns(rb, nb)) {
-          setfltvalue(s2v(ra), luai_numunm(L, nb));
-        }
-        else
-          Protect(luaT_trybinTM(L, rb, rb, ra, TM_UNM));
+        op_unm(L);
         vmbreak;
       }
       vmcase(OP_BNOT) {
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        lua_Integer ib;
-        if (tointegerns(rb, &ib)) {
-          setivalue(s2v(ra), intop(^, ~l_castS2U(0), ib));
-        }
-        else
-          Protect(luaT_trybinTM(L, rb, rb, ra, TM_BNOT));
+        op_bnot(L);
         vmbreak;
       }
       vmcase(OP_NOT) {
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        if (l_isfalse(rb))
-          setbtvalue(s2v(ra));
-        else
-          setbfvalue(s2v(ra));
+        op_not(L);
         vmbreak;
       }
       vmcase(OP_LEN) {
-        StkId ra = RA(i);
-        Protect(luaV_objlen(L, ra, vRB(i)));
+        op_len(L);
         vmbreak;
       }
       vmcase(OP_CONCAT) {
-        StkId ra = RA(i);
-        int n = GETARG_B(i);  /* number of elements to concatenate */
-        L->top.p = ra + n;  /* mark the end of concat operands */
-        ProtectNT(luaV_concat(L, n));
-        checkGC(L, L->top.p); /* 'luaV_concat' ensures correct top */
+        op_concat(L);
         vmbreak;
       }
       vmcase(OP_CLOSE) {
-        StkId ra = RA(i);
-        lua_assert(!GETARG_B(i));  /* 'close must be alive */
-        Protect(luaF_close(L, ra, LUA_OK, 1));
+        op_close(L);
         vmbreak;
       }
       vmcase(OP_TBC) {
-        StkId ra = RA(i);
-        /* create new to-be-closed upvalue */
-        halfProtect(luaF_newtbcupval(L, ra));
+        op_tbc(L);
         vmbreak;
       }
       vmcase(OP_JMP) {
         dojump(ci, i, 0);
+        if (GETARG_sJ(i) < 0) {  /* loop? */
+          jithot();
+          jitenter();
+        }
         vmbreak;
       }
       vmcase(OP_EQ) {
-        StkId ra = RA(i);
-        int cond;
-        TValue *rb = vRB(i);
-        Protect(cond = luaV_equalobj(L, s2v(ra), rb));
-        docondjump();
+        op_eq(L);
         vmbreak;
       }
       vmcase(OP_LT) {
-        op_order(L, l_lti, LTnum, lessthanothers);
+        op_orderQ(L, l_lti, LTnum, lessthanothers, OP_LT_II, OP_LT_FF);
         vmbreak;
       }
       vmcase(OP_LE) {
-        op_order(L, l_lei, LEnum, lessequalothers);
+        op_orderQ(L, l_lei, LEnum, lessequalothers, OP_LE_II, OP_LE_FF);
         vmbreak;
       }
       vmcase(OP_EQK) {
-        StkId ra = RA(i);
-        TValue *rb = KB(i);
-        /* basic types do not use '__eq'; we can use raw equality */
-        int cond = luaV_rawequalobj(s2v(ra), rb);
-        docondjump();
+        op_eqk(L);
         vmbreak;
       }
       vmcase(OP_EQI) {
-        StkId ra = RA(i);
-        int cond;
-        int im = GETARG_sB(i);
-        if (ttisinteger(s2v(ra)))
-          cond = (ivalue(s2v(ra)) == im);
-        else if (ttisfloat(s2v(ra)))
-          cond = luai_numeq(fltvalue(s2v(ra)), cast_num(im));
-        else
-          cond = 0;  /* other types cannot be equal to a number */
-        docondjump();
+        op_eqi(L);
         vmbreak;
       }
       vmcase(OP_LTI) {
@@ -1762,20 +2408,11 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         vmbreak;
       }
       vmcase(OP_TEST) {
-        StkId ra = RA(i);
-        int cond = !l_isfalse(s2v(ra));
-        docondjump();
+        op_test(L);
         vmbreak;
       }
       vmcase(OP_TESTSET) {
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        if (l_isfalse(rb) == GETARG_k(i))
-          pc++;
-        else {
-          setobj2s(L, ra, rb);
-          donextjump(ci);
-        }
+        op_testset(L);
         vmbreak;
       }
       vmcase(OP_CALL) {
@@ -1787,26 +2424,9 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
           L->top.p = ra + b;  /* top signals number of arguments */
         /* else previous instruction set top */
         savepc(L);  /* in case of errors */
-        
-        if (ra <= L->top.p && ttisLclosure(s2v(ra))) {
-          LClosure *cl = clLvalue(s2v(ra));
-          Proto *p = cl->p;
-          if (p->is_sleeping) {
-            int nargs = cast_int(L->top.p - ra) - 1;
-            if (p->call_queue == NULL) {
-              p->call_queue = luaF_newcallqueue(L);
-            }
-            luaF_callqueuepush(L, p->call_queue, nargs);
-            L->top.p = ra + nresults + 1;
-            if (nresults >= 0) {
-              for (int j = 1; j <= nresults; j++) {
-                setnilvalue(s2v(ra + j - 1));
-              }
-            }
-            vmbreak;
-          }
+        if (queuecall(L, ra, nresults)) {
+          vmbreak;
         }
-        
         if ((newci = luaD_precall(L, ra, nresults)) == LUA_NULLPTR)
           updatetrap(ci);  /* C call; nothing else to be done */
         else {  /* Lua call: run function in this same C frame */
@@ -1910,114 +2530,49 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         }
       }
       vmcase(OP_FORLOOP) {
-        StkId ra = RA(i);
-        if (ttisinteger(s2v(ra + 2))) {  /* integer loop? */
-          lua_Unsigned count = l_castS2U(ivalue(s2v(ra + 1)));
-          if (count > 0) {  /* still more iterations? */
-            lua_Integer step = ivalue(s2v(ra + 2));
-            lua_Integer idx = ivalue(s2v(ra));  /* internal index */
-            chgivalue(s2v(ra + 1), count - 1);  /* update counter */
-            idx = intop(+, idx, step);  /* add step to index */
-            chgivalue(s2v(ra), idx);  /* update internal index */
-            setivalue(s2v(ra + 3), idx);  /* and control variable */
-            pc -= GETARG_Bx(i);  /* jump back */
-          }
-        }
-        else if (floatforloop(ra))  /* float loop */
-          pc -= GETARG_Bx(i);  /* jump back */
-        updatetrap(ci);  /* allows a signal to break the loop */
+        op_forloop(L);
         vmbreak;
       }
       vmcase(OP_FORPREP) {
-        StkId ra = RA(i);
-        savestate(L, ci);  /* in case of errors */
-        if (forprep(L, ra))
-          pc += GETARG_Bx(i) + 1;  /* skip the loop */
+        op_forprep(L);
         vmbreak;
       }
       vmcase(OP_TFORPREP) {
-       StkId ra = RA(i);
-        /* create to-be-closed upvalue (if needed) */
-        halfProtect(luaF_newtbcupval(L, ra + 3));
-        pc += GETARG_Bx(i);
+        op_tforprep(L);
         i = *(pc++);  /* go to next instruction */
-        lua_assert(GET_OPCODE(i) == OP_TFORCALL && ra == RA(i));
+        lua_assert(GET_OPCODE(i) == OP_TFORCALL);
         goto l_tforcall;
       }
       vmcase(OP_TFORCALL) {
        l_tforcall: {
-        StkId ra = RA(i);
-        /* 'ra' has the iterator function, 'ra + 1' has the state,
-           'ra + 2' has the control variable, and 'ra + 3' has the
-           to-be-closed variable. The call will use the stack after
-           these values (starting at 'ra + 4')
-        */
-        /* push function, state, and control variable */
-        memcpy(ra + 4, ra, 3 * sizeof(*ra));
-        L->top.p = ra + 4 + 3;
-        ProtectNT(luaD_call(L, ra + 4, GETARG_C(i)));  /* do the call */
-        updatestack(ci);  /* stack may have changed */
+        op_tforcall(L);
         i = *(pc++);  /* go to next instruction */
-        lua_assert(GET_OPCODE(i) == OP_TFORLOOP && ra == RA(i));
+        lua_assert(GET_OPCODE(i) == OP_TFORLOOP);
         goto l_tforloop;
       }}
       vmcase(OP_TFORLOOP) {
        l_tforloop: {
-        StkId ra = RA(i);
-        if (!ttisnil(s2v(ra + 4))) {  /* continue loop? */
-          setobjs2s(L, ra + 2, ra + 4);  /* save control variable */
-          pc -= GETARG_Bx(i);  /* jump back */
-        }
+        op_tforloop(L);
         vmbreak;
       }}
       vmcase(OP_SETLIST) {
-        StkId ra = RA(i);
-        int n = GETARG_B(i);
-        unsigned int last = GETARG_C(i);
-        Table *h = hvalue(s2v(ra));
-        if (n == 0)
-          n = cast_int(L->top.p - ra) - 1;  /* get up to the top */
-        else
-          L->top.p = ci->top.p;  /* correct top in case of emergency GC */
-        last += n;
-        if (TESTARG_k(i)) {
-          last += GETARG_Ax(*pc) * (MAXARG_C + 1);
-          pc++;
-        }
-        if (last > luaH_realasize(h))  /* needs more space? */
-          luaH_resizearray(L, h, last);  /* preallocate it at once */
-        for (; n > 0; n--) {
-          TValue *val = s2v(ra + n);
-          setobj2t(L, &h->array[last - 1], val);
-          last--;
-          luaC_barrierback(L, obj2gco(h), val);
-        }
+        op_setlist(L);
         vmbreak;
       }
       vmcase(OP_CLOSURE) {
-        StkId ra = RA(i);
-        Proto *p = cl->p->p[GETARG_Bx(i)];
-        halfProtect(pushclosure(L, p, cl->upvals, base, ra));
-        checkGC(L, ra + 1);
+        op_closure(L);
         vmbreak;
       }
       vmcase(OP_VARARG) {
-        StkId ra = RA(i);
-        int n = GETARG_C(i) - 1;  /* required results (-1 means all) */
-        int vatab = GETARG_k(i) ? GETARG_B(i) : -1;
-        Protect(luaT_getvarargs(L, ci, ra, n));
+        op_vararg(L);
         vmbreak;
       }
       vmcase(OP_GETVARG) {
-        StkId ra = RA(i);
-        TValue *rc = vRC(i);
-        luaT_getvararg(L, ci, ra, rc);
+        op_getvarg(L);
         vmbreak;
       }
       vmcase(OP_ERRNNIL) {
-        TValue *ra = vRA(i);
-        if (!ttisnil(ra))
-          halfProtect(luaG_errnnil(L, cl, GETARG_Bx(i)));
+        op_errnnil(L);
         vmbreak;
       }
       vmcase(OP_VARARGPREP) {
@@ -2035,30 +2590,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         ** R[A] is K[B] - 检查R[A]的类型是否与K[B]字符串匹配
         ** 支持__type元方法自定义类型名称
         */
-        TValue *ra = vRA(i);
-        TValue *rb = KB(i);
-        const char *typename_expected;
-        const char *typename_actual;
-        int cond;
-        
-        /* 获取期望的类型名（必须是字符串） */
-        lua_assert(ttisstring(rb));
-        typename_expected = getstr(tsvalue(rb));
-        
-        /* 尝试获取__type元方法 */
-        const TValue *tm = luaT_gettmbyobj(L, ra, TM_TYPE);
-        if (!notm(tm) && ttisstring(tm)) {
-          /* 使用__type元方法返回的类型名 */
-          typename_actual = getstr(tsvalue(tm));
-        }
-        else {
-          /* 使用标准类型名 */
-          typename_actual = luaT_objtypename(L, ra);
-        }
-        
-        /* 比较类型名 */
-        cond = (strcmp(typename_actual, typename_expected) == 0);
-        docondjump();
+        op_is(L);
         vmbreak;
       }
       vmcase(OP_TESTNIL) {
@@ -2074,9 +2606,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         **   k=1 用于可选链: a?.b 时，非nil跳过JMP继续执行GETFIELD
         **   k=0 用于空值合并: a ?? b 时，nil跳过JMP继续执行b的计算
         */
-        TValue *rb = vRB(i);
-        if (ttisnil(rb) != GETARG_k(i))
-          pc++;  /* 条件不满足，跳过下一条指令 */
+        op_testnil(L);
         vmbreak;
       }
       /*
@@ -2135,18 +2665,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         ** 格式: OP_GETSUPER A B C
         ** 功能: R[A] := R[B].__parent[K[C]:shortstring]
         */
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        TString *key = tsvalue(&k[GETARG_C(i)]);
-        /* 保护调用 */
-        savestate(L, ci);
-        setobj2s(L, L->top.p, rb);
-        L->top.p++;
-        /* 调用super获取函数 */
-        luaC_super(L, -1, key);
-        setobj2s(L, ra, s2v(L->top.p - 1));
-        L->top.p -= 2;
-        updatetrap(ci);
+        op_getsuper(L);
         vmbreak;
       }
       vmcase(OP_SETMETHOD) {
@@ -2197,25 +2716,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         ** 格式: OP_NEWOBJ A B C
         ** 功能: R[A] := R[B]()，使用R[B]类创建新对象，C-1个参数
         */
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        int nargs = GETARG_C(i) - 1;
-        /* 保护调用 */
-        savestate(L, ci);
-        /* 将类压入栈 */
-        setobj2s(L, L->top.p, rb);
-        L->top.p++;
-        /* 复制参数 */
-        for (int j = 0; j < nargs; j++) {
-          setobj2s(L, L->top.p, s2v(ra + 1 + j));
-          L->top.p++;
-        }
-        /* 调用创建对象函数 */
-        luaC_newobject(L, -(nargs + 1), nargs);
-        setobj2s(L, ra, s2v(L->top.p - 1));
-        L->top.p -= (nargs + 2);
-        updatetrap(ci);
-        checkGC(L, ra + 1);
+        op_newobj(L);
         vmbreak;
       }
       vmcase(OP_GETPROP) {
@@ -2224,18 +2725,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         ** 格式: OP_GETPROP A B C
         ** 功能: R[A] := R[B][K[C]:shortstring]，从对象获取属性
         */
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        TString *key = tsvalue(&k[GETARG_C(i)]);
-        /* 保护调用 */
-        savestate(L, ci);
-        setobj2s(L, L->top.p, rb);
-        L->top.p++;
-        /* 调用获取属性函数 */
-        luaC_getprop(L, -1, key);
-        setobj2s(L, ra, s2v(L->top.p - 1));
-        L->top.p -= 2;
-        updatetrap(ci);
+        op_getprop(L);
         vmbreak;
       }
       vmcase(OP_SETPROP) {
@@ -2244,19 +2734,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         ** 格式: OP_SETPROP A B C
         ** 功能: R[A][K[B]:shortstring] := RK(C)
         */
-        StkId ra = RA(i);
-        TString *key = tsvalue(&k[GETARG_B(i)]);
-        TValue *rc = RKC(i);
-        /* 保护调用 */
-        savestate(L, ci);
-        setobj2s(L, L->top.p, s2v(ra));
-        L->top.p++;
-        setobj2s(L, L->top.p, rc);
-        L->top.p++;
-        /* 调用设置属性函数 */
-        luaC_setprop(L, -2, key, -1);
-        L->top.p -= 2;
-        updatetrap(ci);
+        op_setprop(L);
         vmbreak;
       }
       vmcase(OP_INSTANCEOF) {
@@ -2265,21 +2743,7 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         ** 格式: OP_INSTANCEOF A B C k
         ** 功能: if ((R[A] instanceof R[B]) ~= k) then pc++
         */
-        StkId ra = RA(i);
-        TValue *rb = vRB(i);
-        int result;
-        /* 保护调用 */
-        savestate(L, ci);
-        setobj2s(L, L->top.p, s2v(ra));
-        L->top.p++;
-        setobj2s(L, L->top.p, rb);
-        L->top.p++;
-        /* 检查instanceof */
-        result = luaC_instanceof(L, -2, -1);
-        L->top.p -= 2;
-        updatetrap(ci);
-        if (result != GETARG_k(i))
-          pc++;  /* 条件不满足，跳过下一条指令 */
+        op_instanceof(L);
         vmbreak;
       }
       vmcase(OP_IMPLEMENT) {
@@ -2519,17 +2983,605 @@ void luaV_execute (lua_State *L, CallInfo *ci) {
         ** 3. 增加代码体积，提高分析难度
         */
         /* 获取虚假参数（仅为了触发反编译器解析，实际不使用） */
-        UNUSED(GETARG_A(i));
-        UNUSED(GETARG_B(i));
-        UNUSED(GETARG_C(i));
+        (void)GETARG_A(i);
+        (void)GETARG_B(i);
+        (void)GETARG_C(i);
         vmbreak;
       }
       vmcase(OP_EXTRAARG) {
         lua_assert(0);
         vmbreak;
       }
+      vmcase(OP_ADD_II) {
+        op_arithII(L, l_addi, luai_numadd);
+        vmbreak;
+      }
+      vmcase(OP_ADD_FF) {
+        op_arithFF(L, l_addi, luai_numadd);
+        vmbreak;
+      }
+      vmcase(OP_SUB_II) {
+        op_arithII(L, l_subi, luai_numsub);
+        vmbreak;
+      }
+      vmcase(OP_SUB_FF) {
+        op_arithFF(L, l_subi, luai_numsub);
+        vmbreak;
+      }
+      vmcase(OP_MUL_II) {
+        op_arithII(L, l_muli, luai_nummul);
+        vmbreak;
+      }
+      vmcase(OP_MUL_FF) {
+        op_arithFF(L, l_muli, luai_nummul);
+        vmbreak;
+      }
+      vmcase(OP_LT_II) {
+        op_orderII(L, l_lti, LTnum, lessthanothers);
+        vmbreak;
+      }
+      vmcase(OP_LT_FF) {
+        op_orderFF(L, l_lti, luai_numlt, LTnum, lessthanothers);
+        vmbreak;
+      }
+      vmcase(OP_LE_II) {
+        op_orderII(L, l_lei, LEnum, lessequalothers);
+        vmbreak;
+      }
+      vmcase(OP_LE_FF) {
+        op_orderFF(L, l_lei, luai_numle, LEnum, lessequalothers);
+        vmbreak;
+      }
+      vmcase(OP_GETTABUP_N) {
+        TValue *upval = cl->upvals[GETARG_B(i)]->v.p;
+        op_getfieldN(L, upval, KC(i));
+        vmbreak;
+      }
+      vmcase(OP_GETFIELD_N) {
+        TValue *rb = vRB(i);
+        op_getfieldN(L, rb, KC(i));
+        vmbreak;
+      }
+      vmcase(OP_SETFIELD_N) {
+        op_setfieldN(L);
+        vmbreak;
+      }
     }
   }
 }
 
 /* }======================================================= */
+
+
+/*
+** {==================================================================
+** Templates for the baseline JIT (see ljit.c)
+** ===================================================================
+*/
+#if defined(LUA_USE_JIT)
+
+/*
+** A template runs one instruction with the same 'op_' body as
+** 'luaV_execute' and returns the next instruction. Its frame is rebuilt
+** from 'J' at each call, so it never works with a stale 'base'. Whenever
+** 'trap' is set (hooks, a signal, a reallocated stack), it asks to go
+** back to the interpreter. Compiled code neither counts towards
+** compiling, nor enters native code again, nor quickens the
+** instructions it runs.
+*/
+#undef jithot
+#define jithot()	((void)0)
+#undef jitenter
+#define jitenter()	((void)0)
+#undef warmupnode
+#define warmupnode(h,slot,q)	((void)0)
+
+#define jitexit(pc)	cast(const Instruction *, cast(L_P2I, pc) | 1)
+
+#define jitop(op)  \
+static const Instruction *jit_##op (JitFrame *J, Instruction i,  \
+                                    const Instruction *pc) {  \
+  lua_State *L = J->L;  \
+  CallInfo *ci = J->ci;  \
+  LClosure *cl = J->cl;  \
+  TValue *k = cl->p->k;  \
+  StkId base = ci->func.p + 1;  \
+  int trap = 0;  \
+  UNUSED(L); UNUSED(ci); UNUSED(k); UNUSED(base); UNUSED(i);  \
+  {
+
+#define jitend  \
+  }  \
+  return (l_unlikely(trap)) ? jitexit(pc) : pc;  \
+}
+
+
+jitop(MOVE)
+  op_move(L);
+jitend
+
+jitop(LOADI)
+  op_loadi(L);
+jitend
+
+jitop(LOADF)
+  op_loadf(L);
+jitend
+
+jitop(LOADK)
+  op_loadk(L);
+jitend
+
+jitop(LOADKX)
+  op_loadkx(L);
+jitend
+
+jitop(LOADFALSE)
+  op_loadfalse(L);
+jitend
+
+jitop(LFALSESKIP)
+  op_lfalseskip(L);
+jitend
+
+jitop(LOADTRUE)
+  op_loadtrue(L);
+jitend
+
+jitop(LOADNIL)
+  op_loadnil(L);
+jitend
+
+jitop(GETUPVAL)
+  op_getupval(L);
+jitend
+
+jitop(SETUPVAL)
+  op_setupval(L);
+jitend
+
+jitop(GETTABUP)
+  op_gettabup(L);
+jitend
+
+jitop(GETTABLE)
+  op_gettable(L);
+jitend
+
+jitop(GETI)
+  op_geti(L);
+jitend
+
+jitop(GETFIELD)
+  op_getfield(L);
+jitend
+
+jitop(SETTABUP)
+  op_settabup(L);
+jitend
+
+jitop(SETTABLE)
+  op_settable(L);
+jitend
+
+jitop(SETI)
+  op_seti(L);
+jitend
+
+jitop(SETFIELD)
+  op_setfield(L);
+jitend
+
+jitop(NEWTABLE)
+  op_newtable(L);
+jitend
+
+jitop(SELF)
+  op_self(L);
+jitend
+
+jitop(ADDI)
+  op_arithI(L, l_addi, luai_numadd);
+jitend
+
+jitop(ADDK)
+  op_arithK(L, l_addi, luai_numadd);
+jitend
+
+jitop(SUBK)
+  op_arithK(L, l_subi, luai_numsub);
+jitend
+
+jitop(MULK)
+  op_arithK(L, l_muli, luai_nummul);
+jitend
+
+jitop(MODK)
+  savestate(L, ci);  /* in case of division by 0 */
+  op_arithK(L, luaV_mod, luaV_modf);
+jitend
+
+jitop(POWK)
+  op_arithfK(L, luai_numpow);
+jitend
+
+jitop(DIVK)
+  op_arithfK(L, luai_numdiv);
+jitend
+
+jitop(IDIVK)
+  savestate(L, ci);  /* in case of division by 0 */
+  op_arithK(L, luaV_idiv, luai_numidiv);
+jitend
+
+jitop(BANDK)
+  op_bitwiseK(L, l_band);
+jitend
+
+jitop(BORK)
+  op_bitwiseK(L, l_bor);
+jitend
+
+jitop(BXORK)
+  op_bitwiseK(L, l_bxor);
+jitend
+
+jitop(SHLI)
+  op_shli(L);
+jitend
+
+jitop(SHRI)
+  op_shri(L);
+jitend
+
+jitop(ADD)
+  op_arith(L, l_addi, luai_numadd);
+jitend
+
+jitop(SUB)
+  op_arith(L, l_subi, luai_numsub);
+jitend
+
+jitop(MUL)
+  op_arith(L, l_muli, luai_nummul);
+jitend
+
+jitop(MOD)
+  savestate(L, ci);  /* in case of division by 0 */
+  op_arith(L, luaV_mod, luaV_modf);
+jitend
+
+jitop(POW)
+  op_arithf(L, luai_numpow);
+jitend
+
+jitop(DIV)
+  op_arithf(L, luai_numdiv);
+jitend
+
+jitop(IDIV)
+  savestate(L, ci);  /* in case of division by 0 */
+  op_arith(L, luaV_idiv, luai_numidiv);
+jitend
+
+jitop(BAND)
+  op_bitwise(L, l_band);
+jitend
+
+jitop(BOR)
+  op_bitwise(L, l_bor);
+jitend
+
+jitop(BXOR)
+  op_bitwise(L, l_bxor);
+jitend
+
+jitop(SHL)
+  op_bitwise(L, luaV_shiftl);
+jitend
+
+jitop(SHR)
+  op_bitwise(L, luaV_shiftr);
+jitend
+
+jitop(SPACESHIP)
+  op_spaceship(L);
+jitend
+
+jitop(MMBIN)
+  op_mmbin(L);
+jitend
+
+jitop(MMBINI)
+  op_mmbini(L);
+jitend
+
+jitop(MMBINK)
+  op_mmbink(L);
+jitend
+
+jitop(UNM)
+  op_unm(L);
+jitend
+
+jitop(BNOT)
+  op_bnot(L);
+jitend
+
+jitop(NOT)
+  op_not(L);
+jitend
+
+jitop(LEN)
+  op_len(L);
+jitend
+
+jitop(CONCAT)
+  op_concat(L);
+jitend
+
+jitop(CLOSE)
+  op_close(L);
+jitend
+
+jitop(TBC)
+  op_tbc(L);
+jitend
+
+jitop(JMP)
+  dojump(ci, i, 0);
+jitend
+
+jitop(EQ)
+  op_eq(L);
+jitend
+
+jitop(LT)
+  op_order(L, l_lti, LTnum, lessthanothers);
+jitend
+
+jitop(LE)
+  op_order(L, l_lei, LEnum, lessequalothers);
+jitend
+
+jitop(EQK)
+  op_eqk(L);
+jitend
+
+jitop(EQI)
+  op_eqi(L);
+jitend
+
+jitop(LTI)
+  op_orderI(L, l_lti, luai_numlt, 0, TM_LT);
+jitend
+
+jitop(LEI)
+  op_orderI(L, l_lei, luai_numle, 0, TM_LE);
+jitend
+
+jitop(GTI)
+  op_orderI(L, l_gti, luai_numgt, 1, TM_LT);
+jitend
+
+jitop(GEI)
+  op_orderI(L, l_gei, luai_numge, 1, TM_LE);
+jitend
+
+jitop(TEST)
+  op_test(L);
+jitend
+
+jitop(TESTSET)
+  op_testset(L);
+jitend
+
+/*
+** C functions run here directly. Other calls go through 'luaD_call', as
+** in OP_TFORCALL, nesting a C frame; past LUAI_JITMAXCCALLS nested C
+** calls the interpreter makes the call instead, without using C stack.
+*/
+jitop(CALL)
+  StkId ra = RA(i);
+  int b = GETARG_B(i);
+  int nresults = GETARG_C(i) - 1;
+  int isC = ttisCclosure(s2v(ra)) || ttislcf(s2v(ra));
+  if (!isC && getCcalls(L) >= LUAI_JITMAXCCALLS)
+    return jitexit(pc - 1);  /* let the interpreter do the call */
+  if (b != 0)  /* fixed number of arguments? */
+    L->top.p = ra + b;  /* top signals number of arguments */
+  /* else previous instruction set top */
+  savepc(L);  /* in case of errors */
+  if (queuecall(L, ra, nresults))
+    return pc;
+  if (isC)
+    luaD_precall(L, ra, nresults);
+  else
+    luaD_call(L, ra, nresults);
+  updatetrap(ci);
+jitend
+
+jitop(FORLOOP)
+  op_forloop(L);
+jitend
+
+jitop(FORPREP)
+  op_forprep(L);
+jitend
+
+jitop(TFORPREP)
+  op_tforprep(L);
+jitend
+
+jitop(TFORCALL)
+  op_tforcall(L);
+jitend
+
+jitop(TFORLOOP)
+  op_tforloop(L);
+jitend
+
+jitop(SETLIST)
+  op_setlist(L);
+jitend
+
+jitop(CLOSURE)
+  op_closure(L);
+jitend
+
+jitop(VARARG)
+  op_vararg(L);
+jitend
+
+jitop(GETVARG)
+  op_getvarg(L);
+jitend
+
+jitop(ERRNNIL)
+  op_errnnil(L);
+jitend
+
+/* 类相关指令：与解释器相同，经栈顶调用 lclass.c */
+jitop(GETSUPER)
+  op_getsuper(L);
+jitend
+
+jitop(NEWOBJ)
+  op_newobj(L);
+jitend
+
+jitop(GETPROP)
+  op_getprop(L);
+jitend
+
+jitop(SETPROP)
+  op_setprop(L);
+jitend
+
+jitop(INSTANCEOF)
+  op_instanceof(L);
+jitend
+
+jitop(IS)
+  op_is(L);
+jitend
+
+jitop(TESTNIL)
+  op_testnil(L);
+jitend
+
+jitop(NOP)
+jitend
+
+
+/*
+** Quickened instructions keep their fast paths. The template works on
+** the instruction as it was when the function was compiled; when the
+** interpreter later changes it in the code, the template only misses
+** its guard and takes the generic path.
+*/
+jitop(ADD_II)
+  op_arithII(L, l_addi, luai_numadd);
+jitend
+
+jitop(ADD_FF)
+  op_arithFF(L, l_addi, luai_numadd);
+jitend
+
+jitop(SUB_II)
+  op_arithII(L, l_subi, luai_numsub);
+jitend
+
+jitop(SUB_FF)
+  op_arithFF(L, l_subi, luai_numsub);
+jitend
+
+jitop(MUL_II)
+  op_arithII(L, l_muli, luai_nummul);
+jitend
+
+jitop(MUL_FF)
+  op_arithFF(L, l_muli, luai_nummul);
+jitend
+
+jitop(LT_II)
+  op_orderII(L, l_lti, LTnum, lessthanothers);
+jitend
+
+jitop(LT_FF)
+  op_orderFF(L, l_lti, luai_numlt, LTnum, lessthanothers);
+jitend
+
+jitop(LE_II)
+  op_orderII(L, l_lei, LEnum, lessequalothers);
+jitend
+
+jitop(LE_FF)
+  op_orderFF(L, l_lei, luai_numle, LEnum, lessequalothers);
+jitend
+
+jitop(GETTABUP_N)
+  TValue *upval = cl->upvals[GETARG_B(i)]->v.p;
+  op_getfieldN(L, upval, KC(i));
+jitend
+
+jitop(GETFIELD_N)
+  TValue *rb = vRB(i);
+  op_getfieldN(L, rb, KC(i));
+jitend
+
+jitop(SETFIELD_N)
+  op_setfieldN(L);
+jitend
+
+
+#define jitcase(op)	case OP_##op: return jit_##op;
+
+/*
+** Template for opcode 'op', or NULL if the interpreter must run it.
+*/
+JitOp luaV_jitop (OpCode op) {
+  switch (op) {
+    jitcase(MOVE) jitcase(LOADI) jitcase(LOADF) jitcase(LOADK)
+    jitcase(LOADKX) jitcase(LOADFALSE) jitcase(LFALSESKIP) jitcase(LOADTRUE)
+    jitcase(LOADNIL) jitcase(GETUPVAL) jitcase(SETUPVAL)
+    jitcase(GETTABUP) jitcase(GETTABLE) jitcase(GETI) jitcase(GETFIELD)
+    jitcase(SETTABUP) jitcase(SETTABLE) jitcase(SETI) jitcase(SETFIELD)
+    jitcase(NEWTABLE) jitcase(SELF)
+    jitcase(ADDI) jitcase(ADDK) jitcase(SUBK) jitcase(MULK) jitcase(MODK)
+    jitcase(POWK) jitcase(DIVK) jitcase(IDIVK) jitcase(BANDK)
+    jitcase(BORK) jitcase(BXORK) jitcase(SHLI) jitcase(SHRI)
+    jitcase(ADD) jitcase(SUB) jitcase(MUL) jitcase(MOD) jitcase(POW)
+    jitcase(DIV) jitcase(IDIV) jitcase(BAND) jitcase(BOR) jitcase(BXOR)
+    jitcase(SHL) jitcase(SHR) jitcase(SPACESHIP)
+    jitcase(MMBIN) jitcase(MMBINI) jitcase(MMBINK)
+    jitcase(UNM) jitcase(BNOT) jitcase(NOT) jitcase(LEN) jitcase(CONCAT)
+    jitcase(CLOSE) jitcase(TBC)
+    jitcase(JMP) jitcase(EQ) jitcase(LT) jitcase(LE) jitcase(EQK)
+    jitcase(EQI) jitcase(LTI) jitcase(LEI) jitcase(GTI) jitcase(GEI)
+    jitcase(TEST) jitcase(TESTSET) jitcase(CALL)
+    jitcase(FORLOOP) jitcase(FORPREP)
+    jitcase(TFORPREP) jitcase(TFORCALL) jitcase(TFORLOOP)
+    jitcase(SETLIST) jitcase(CLOSURE) jitcase(VARARG) jitcase(GETVARG)
+    jitcase(ERRNNIL) jitcase(IS) jitcase(TESTNIL)
+    jitcase(GETSUPER) jitcase(NEWOBJ) jitcase(GETPROP) jitcase(SETPROP)
+    jitcase(INSTANCEOF)
+    jitcase(NOP)
+    jitcase(ADD_II) jitcase(ADD_FF) jitcase(SUB_II) jitcase(SUB_FF)
+    jitcase(MUL_II) jitcase(MUL_FF) jitcase(LT_II) jitcase(LT_FF)
+    jitcase(LE_II) jitcase(LE_FF)
+    jitcase(GETTABUP_N) jitcase(GETFIELD_N) jitcase(SETFIELD_N)
+    default: return NULL;
+  }
+}
+
+#else
+
+JitOp luaV_jitop (OpCode op) {
+  UNUSED(op);
+  return NULL;
+}
+
+#endif
+
+/* }================================================================== */
@@ -0,0 +1,259 @@
+-- The bytecode optimizer (load mode "O", '--@optimize'); needs the T library
+if T == nil then
+	print("T not available: build with -DLUA_USER_H='\"ltests.h\"'")
+	return
+end
+
+-- instructions of 'f' as { op = name, args... }
+local function code(f)
+	local list = {}
+	for _, line in ipairs(T.listcode(f)) do
+		local op, args = line:match("^%(.-%)%s*%d+ %- (%u[%u%d_]*)%s*(.*)$")
+		local ins = { op = op }
+		for n in args:gmatch("%-?%d+") do ins[#ins + 1] = tonumber(n) end
+		list[#list + 1] = ins
+	end
+	return list
+end
+
+local function count(f, op)
+	local n = 0
+	for _, ins in ipairs(code(f)) do
+		if ins.op == op then n = n + 1 end
+	end
+	return n
+end
+
+-- every jump goes straight to its final target
+local function threaded(f)
+	local c = code(f)
+	for pc, ins in ipairs(c) do
+		if ins.op == "JMP" and c[pc + 1 + ins[1]].op == "JMP" then
+			return false
+		end
+	end
+	return true
+end
+
+local function ops(f)
+	local t = {}
+	for i, ins in ipairs(code(f)) do t[i] = ins.op end
+	return table.concat(t, " ")
+end
+
+-- compile 'src' plainly and optimized; the optimized code must be valid
+local function both(src)
+	local plain = assert(load(src, "=src", "t"))
+	local opt = assert(load(src, "=src", "tO"))
+	assert(T.checkcode(plain))
+	local ok, msg = T.checkcode(opt)
+	assert(ok, msg)
+	return plain, opt
+end
+
+local function sameresults(plain, opt, ...)
+	local a = table.pack(pcall(plain, ...))
+	local b = table.pack(pcall(opt, ...))
+	assert(a.n == b.n, "different number of results")
+	for i = 1, a.n do
+		if type(a[i]) == "string" and not a[1] then
+			-- errors name the same place
+			assert(a[i]:gsub("^.-:%d+: ", "") == b[i]:gsub("^.-:%d+: ", ""), b[i])
+		else
+			assert(a[i] == b[i] or (a[i] ~= a[i] and b[i] ~= b[i]), i)
+		end
+	end
+end
+
+do print("jump threading")
+	local plain, opt = both[[
+		local a, r = ...
+		when a > 2 r = 1 case a > 1 r = 2 case a > 0 r = 3 else r = 4
+		return r
+	]]
+	-- the jumps out of each arm become copies of the return
+	assert(threaded(opt), ops(opt))
+	assert(count(opt, "JMP") == count(plain, "JMP") - 3, ops(opt))
+	assert(count(opt, "RETURN") == 4, ops(opt))
+	for a = -1, 3 do sameresults(plain, opt, a) end
+
+	plain, opt = both[[
+		local a = ...
+		if a then a = 1 else a = 2 end
+		return a
+	]]
+	assert(count(opt, "JMP") == count(plain, "JMP") - 1)
+	assert(count(opt, "RETURN") == 2)
+	sameresults(plain, opt, true)
+	sameresults(plain, opt, false)
+end
+
+do print("unreachable code")
+	local plain, opt = both[[
+		local a = ...
+		do return a end
+		local b = a + 1
+		return b
+	]]
+	assert(ops(opt) == "VARARGPREP VARARG RETURN", ops(opt))
+	sameresults(plain, opt, 10)
+	-- the final return after an explicit one goes too
+	plain, opt = both("local a = ... return a")
+	assert(count(plain, "RETURN") == 2 and count(opt, "RETURN") == 1)
+end
+
+do print("register copies")
+	-- compound assignment works on a copy of the local
+	local plain, opt = both[[
+		local a = ...
+		a += 1
+		a *= 3
+		return a
+	]]
+	assert(count(plain, "MOVE") > 0 and count(opt, "MOVE") == 0, ops(opt))
+	sameresults(plain, opt, 4)
+	sameresults(plain, opt, "x")
+
+	-- pipes, which must not overwrite the local they start from
+	plain, opt = both[[
+		local a = ...
+		local r = a |> tostring |> string.upper
+		local s = a |?> tostring
+		local u = s |?> string.upper |?> string.lower
+		return a, r, s, u
+	]]
+	assert(threaded(opt), ops(opt))
+	sameresults(plain, opt, "abc")
+	sameresults(plain, opt, nil)
+	assert(select("#", opt("abc")) == 4)
+	local a, r, s, u = opt("abc")
+	assert(a == "abc" and r == "ABC" and s == "abc" and u == "abc")
+	a, r, s, u = opt(nil)
+	assert(a == nil and r == "NIL" and s == nil and u == nil)
+
+	-- named locals keep their stores for the debug library
+	plain, opt = both("local x = ... local y = x return y")
+	assert(count(opt, "MOVE") == 1)
+end
+
+do print("constant locals")
+	local plain, opt = both[[
+		local t, x = ...
+		local n, k, s = 3, "key", 2.5
+		return t[n], t[k], x == n, x < n, x * s, x + n
+	]]
+	local o = ops(opt)
+	-- the locals keep their values, although nothing reads them
+	assert(count(opt, "LOADI") == 1 and count(opt, "LOADK") == 2, o)
+	assert(count(plain, "GETTABLE") == 2 and count(opt, "GETTABLE") == 0, o)
+	assert(count(opt, "GETI") == 1 and count(opt, "GETFIELD") == 1, o)
+	assert(count(opt, "EQI") == 1 and count(opt, "LTI") == 1, o)
+	assert(count(opt, "MULK") == 1 and count(opt, "ADDI") == 1, o)
+	sameresults(plain, opt, { 10, 20, 30, key = "v" }, 5)
+	sameresults(plain, opt, { 10, 20, 30, key = "v" }, 3.0)
+	sameresults(plain, opt, { }, "7")
+
+	-- stores with a constant value
+	plain, opt = both[[
+		local t = {}
+		local v, i = 42, 2
+		t.a = v
+		t[i] = v
+		return t.a, t[2]
+	]]
+	assert(count(opt, "SETFIELD") == 1 and count(opt, "SETI") == 1)
+	sameresults(plain, opt)
+	-- and the debug library still sees them
+	plain, opt = both[[
+		local t = ...
+		local n, k = 3, "key"
+		t[n] = k
+		return select(2, debug.getlocal(1, 2)), select(2, debug.getlocal(1, 3))
+	]]
+	assert(count(opt, "SETI") == 1, ops(opt))
+	sameresults(plain, opt, {})
+	assert(select(2, opt({})) == "key")
+
+	-- a local that is reassigned is not a constant
+	plain, opt = both[[
+		local t, c = ...
+		local n = 1
+		if c then n = 2 end
+		return t[n]
+	]]
+	assert(count(opt, "GETTABLE") == 1)
+	sameresults(plain, opt, { 1, 2 }, true)
+	sameresults(plain, opt, { 1, 2 }, false)
+
+	-- nor is one captured by a closure
+	plain, opt = both[[
+		local t = ...
+		local n = 1
+		local function set (v) n = v end
+		set(2)
+		return t[n]
+	]]
+	assert(count(opt, "GETTABLE") == 1)
+	sameresults(plain, opt, { 1, 2 })
+end
+
+do print("destructuring")
+	local plain, opt = both[[
+		local t = ...
+		local take {a, b = 5} = t
+		return a, b
+	]]
+	sameresults(plain, opt, { a = 1 })
+	sameresults(plain, opt, { a = 1, b = 2 })
+	sameresults(plain, opt, nil)
+end
+
+do print("nested functions and loops")
+	local plain, opt = both[[
+		local n = ...
+		local function fib (k)
+			if k < 2 then return k end
+			return fib(k - 1) + fib(k - 2)
+		end
+		local s = 0
+		for i = 1, n do
+			local step = 2
+			if i % step == 0 then s += fib(i) else s -= i end
+		end
+		for _, v in ipairs{ 1, 2, 3 } do s = s + v end
+		local i = 0
+		repeat i += 1 until i >= n
+		return s, i
+	]]
+	sameresults(plain, opt, 10)
+	sameresults(plain, opt, 0)
+	-- errors come from the same place
+	plain, opt = both[[
+		local a = ...
+		local k = 1
+		return a[k] + a.x
+	]]
+	sameresults(plain, opt, nil)
+	sameresults(plain, opt, { 1 })
+end
+
+do print("enabling")
+	local src = "local t = ... local n = 1 return t[n]"
+	assert(count(load(src, "=src", "t"), "GETTABLE") == 1)
+	assert(count(load(src, "=src", "tO"), "GETI") == 1)
+	-- functions that end after the comment are optimized
+	local f = load("local function g (t) local n = 1 return t[n] end\n" ..
+		"--@optimize\n" ..
+		"local function h (t) local n = 1 return t[n] end\n" ..
+		"return g, h")
+	local g, h = f()
+	assert(count(g, "GETTABLE") == 1 and count(h, "GETI") == 1)
+	assert(T.checkcode(f))
+	-- optimized code survives a dump
+	local opt = load(src, "=src", "tO")
+	local again = load(string.dump(opt), "=src", "b")
+	assert(T.checkcode(again) and ops(again) == ops(opt))
+	assert(again({ "one" }) == "one")
+end
+
+print("OK")
@@ -0,0 +1,174 @@
+local buffer = string.buffer
+
+local function asserterr(msg, f, ...)
+	local ok, err = pcall(f, ...)
+	assert(not ok)
+	assert(string.find(err, msg, 1, true) ~= nil, err)
+end
+
+local function assertret(expected, ...)
+	for i, v in ipairs(expected) do
+		assert(v == select(i, ...), string.format("%s ~= %s", tostring(v), tostring(select(i,...))))
+	end
+	assert(#expected == select("#", ...))
+end
+
+local function sameval(a, b)
+	if type(a) ~= "table" or type(b) ~= "table" then
+		if a ~= a then return b ~= b end  -- NaN
+		return a == b and math.type(a) == math.type(b)
+	end
+	for k, v in pairs(a) do
+		if not sameval(v, b[k]) then return false end
+	end
+	for k in pairs(b) do
+		if a[k] == nil then return false end
+	end
+	return true
+end
+
+do print("append")
+	local b = buffer.new()
+	assert(#b == 0 and b:tostring() == "")
+	assert(b:put("abc", 12, "", 1.5) == b)
+	assert(tostring(b) == "abc121.5")
+	b:putf("%d-%s", 7, "x")
+	assert(b:tostring() == "abc121.57-x")
+	local other = buffer.new():put("<", b, ">")
+	assert(other:get() == "<abc121.57-x>")
+	assert(#other == 0)
+	b:put(setmetatable({}, { __tostring = function () return "obj" end }))
+	assert(b:tostring():sub(-3) == "obj")
+	asserterr("string, number or buffer", b.put, b, {})
+	asserterr("string, number or buffer", b.put, b, true)
+	b:reset()
+	assert(#b == 0)
+	local big = string.rep("0123456789", 10000)
+	for _ = 1, 10 do b:put(big) end
+	assert(#b == 10 * #big and b:get(#big) == big)
+	assert(#b == 9 * #big)
+	b:free()
+	assert(#b == 0 and b:get() == "")
+	b:put("again")
+	assert(b:get() == "again")
+	asserterr("invalid size", buffer.new, -1)
+end
+
+do print("get and skip")
+	local b = buffer.new(64):put("hello world")
+	assertret({ "he", "llo", "" }, b:get(2, 3, 0))
+	assert(b:skip(1) == b)
+	assert(b:tostring() == "world")
+	b:skip(100)
+	assert(#b == 0 and b:get(5) == "")
+	b:put("abc")
+	assertret({ "abc", "" }, b:get(10, 10))
+	asserterr("invalid size", b.skip, b, -1)
+	asserterr("invalid size", b.get, b, -1)
+end
+
+do print("reserve and commit")
+	local b = buffer.new():put("ab")
+	local p, n = b:reserve(8)
+	assert(type(p) == "userdata" and n >= 8)
+	for i = 0, 7 do
+		ptr.write(ptr.add(p, i), "char", string.byte("c") + i)
+	end
+	assert(b:commit(3) == b)
+	assert(b:tostring() == "abcde")
+	p, n = b:reserve(0)
+	assert(n >= 0)
+	b:commit(0)
+	assert(b:tostring() == "abcde")
+	p, n = b:reserve(4)
+	asserterr("invalid size", b.commit, b, n + 1)
+	asserterr("invalid size", b.commit, b, -1)
+	asserterr("invalid size", b.reserve, b, -1)
+	b:skip(2)
+	p = b:reserve(1000)
+	ptr.write(p, "char", string.byte("!"))
+	b:commit(1)
+	assert(b:get() == "cde!")
+end
+
+do print("view")
+	local s = "view data"
+	local b = buffer.new():set(s)
+	assert(b:get(4) == "view")
+	assert(b:tostring() == " data")
+	asserterr("invalid size", b.commit, b, 0)
+	b:put("!")  -- writing copies the view
+	assert(b:get() == " data!")
+	assert(s == "view data")
+end
+
+do print("encode and decode")
+	local values = {
+		nil, false, true, 0, 1, -1, 63, 64, -65, 1000000,
+		math.maxinteger, math.mininteger, 0.0, -0.0, 1.5, -2.25, 1e300,
+		math.huge, -math.huge, 0/0, "", "x", string.rep("\0\255", 1000),
+		{}, { 1, 2, 3 }, { a = 1, b = { c = "d" } },
+		{ 1, nil, 3, n = 3 }, { [1.5] = true, [false] = "f", [-1] = {} },
+		{ { { { "deep" } } }, list = { 10, 20, x = { y = { z = 0.5 } } } },
+	}
+	for i = 1, 29 do
+		local v = values[i]
+		local s = buffer.encode(v)
+		assert(type(s) == "string")
+		assert(sameval(buffer.decode(s), v), i)
+	end
+	local b = buffer.new()
+	for i = 1, 29 do b:encode(values[i]) end
+	for i = 1, 29 do
+		assert(sameval(b:decode(), values[i]), i)
+	end
+	assert(#b == 0 and b:decode() == nil)
+	assert(select("#", b:decode()) == 0)
+	-- mixed with plain data
+	b:put("hdr"):encode({ k = "v" }):put("tail")
+	assert(b:get(3) == "hdr")
+	assert(b:decode().k == "v")
+	assert(b:get() == "tail")
+	-- metatables are not kept
+	local t = buffer.decode(buffer.encode(setmetatable({ 1 }, {})))
+	assert(getmetatable(t) == nil and t[1] == 1)
+	-- the decoded array part is a real sequence
+	t = buffer.decode(buffer.encode({ "a", "b", "c", "d" }))
+	assert(#t == 4 and t[4] == "d")
+	asserterr("cannot encode a function value", buffer.encode, print)
+	asserterr("cannot encode a userdata value", buffer.encode, b)
+	asserterr("cannot encode a thread value", b.encode, b, coroutine.create(print))
+	local cyclic = {}
+	cyclic.self = cyclic
+	asserterr("too deep (or cyclic)", buffer.encode, cyclic)
+	local deep = {}
+	for _ = 1, 200 do deep = { deep } end
+	asserterr("too deep (or cyclic)", buffer.encode, deep)
+end
+
+do print("malformed input")
+	local s = buffer.encode({ 1, "two", x = 3.0 })
+	for i = 0, #s - 1 do
+		asserterr("malformed buffer data", buffer.decode, s:sub(1, i))
+	end
+	asserterr("(truncated)", buffer.decode, "")
+	asserterr("(truncated)", buffer.decode, "\5\10abc")
+	asserterr("(truncated)", buffer.decode, "\4\0\0")
+	asserterr("(truncated)", buffer.decode, "\6\255\255\255\1")
+	asserterr("(truncated)", buffer.decode, "\3\128")
+	asserterr("(bad integer)", buffer.decode, "\3" .. string.rep("\255", 11))
+	asserterr("(bad tag 7)", buffer.decode, "\7")
+	asserterr("(bad tag 255)", buffer.decode, "\6\0\255")
+	asserterr("(extra bytes)", buffer.decode, s .. "\0")
+	asserterr("(too deep)", buffer.decode, string.rep("\6\0", 200))
+	assert(not pcall(buffer.decode, "\6\0\4" .. string.pack("n", 0/0) .. "\2\0"))  -- NaN key
+	-- a failed decode leaves the buffer untouched
+	local b = buffer.new():put("\6\1\3")
+	asserterr("(truncated)", b.decode, b)
+	assert(#b == 3)
+	b:put("\2\0")
+	local t = b:decode()
+	assert(t[1] == 1 and #b == 0)
+end
+
+print("OK")
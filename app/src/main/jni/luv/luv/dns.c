@@ -202,7 +202,7 @@ static int luv_getaddrinfo(lua_State* L) {
     uv_freeaddrinfo(req->addrinfo);
     luv_cleanup_req(L, (luv_req_t*)req->data);
   }
-  return 1;
+  return luv_await(L, (luv_req_t*)req->data, 1);
 }
 
 static void luv_getnameinfo_cb(uv_getnameinfo_t* req, int status, const char* hostname, const char* service) {
@@ -297,5 +297,5 @@ static int luv_getnameinfo(lua_State* L) {
     luv_cleanup_req(L, (luv_req_t*)req->data);
     return 2;
   }
-  return 1;
+  return luv_await(L, (luv_req_t*)req->data, 1);
 }
@@ -258,12 +258,27 @@ static void luv_fs_cb(uv_fs_t* req) {
   }
   luv_fulfill_req(L, (luv_req_t*)req->data, nargs);
   if (req->fs_type != UV_FS_SCANDIR) {
+    if (req->fs_type == UV_FS_READ) luv_ring_release(req);
     luv_cleanup_req(L, (luv_req_t*)req->data);
     req->data = NULL;
     uv_fs_req_cleanup(req);
   }
 }
 
+/* Async requests the io_uring engine can take go there (see lring.h) */
+#ifdef LUV_RING
+#define FS_RING(func, req, ...) {                         \
+  luv_req_t* data = (luv_req_t*)req->data;                \
+  if (data->callback_ref != LUA_NOREF &&                  \
+      luv_ring_##func(luv_loop(L), req, __VA_ARGS__) == 0) { \
+    lua_rawgeti(L, LUA_REGISTRYINDEX, data->req_ref);     \
+    return luv_await(L, data, 1);                         \
+  }                                                       \
+}
+#else
+#define FS_RING(func, req, ...)
+#endif
+
 #define FS_CALL(func, req, ...) {                         \
   int ret, sync;                                          \
   luv_req_t* data = (luv_req_t*)req->data;                            \
@@ -294,7 +309,7 @@ static void luv_fs_cb(uv_fs_t* req) {
     return nargs;                                         \
   }                                                       \
   lua_rawgeti(L, LUA_REGISTRYINDEX, data->req_ref);       \
-  return 1;                                               \
+  return luv_await(L, data, 1);                           \
 }
 
 static int luv_fs_close(lua_State* L) {
@@ -302,6 +317,7 @@ static int luv_fs_close(lua_State* L) {
   int ref = luv_check_continuation(L, 2);
   uv_fs_t* req = (uv_fs_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
+  FS_RING(close, req, file);
   FS_CALL(close, req, file);
 }
 
@@ -312,6 +328,7 @@ static int luv_fs_open(lua_State* L) {
   int ref = luv_check_continuation(L, 4);
   uv_fs_t* req = (uv_fs_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
+  FS_RING(open, req, path, flags, mode);
   FS_CALL(open, req, path, flags, mode);
 }
 
@@ -322,12 +339,17 @@ static int luv_fs_read(lua_State* L) {
   uv_buf_t buf;
   int ref;
   uv_fs_t* req;
-  char* data = (char*)malloc(len);
-  if (!data) return luaL_error(L, "Failure to allocate buffer");
-  buf = uv_buf_init(data, len);
+  char* data;
   ref = luv_check_continuation(L, 4);
   req = (uv_fs_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
+  FS_RING(read, req, file, len, offset);
+  data = (char*)malloc(len);
+  if (!data) {
+    luv_cleanup_req(L, (luv_req_t*)req->data);
+    return luaL_error(L, "Failure to allocate buffer");
+  }
+  buf = uv_buf_init(data, len);
   // TODO: find out why we can't just use req->ptr for the base
   ((luv_req_t*)req->data)->data = buf.base;
   FS_CALL(read, req, file, &buf, 1, offset);
@@ -368,6 +390,12 @@ static int luv_fs_write(lua_State* L) {
   req->data = luv_setup_req(L, ref);
   req->ptr = buf.base;
   ((luv_req_t*)req->data)->data = bufs;
+  if (ref != LUA_NOREF) {
+    // Keep the data alive until the write is done
+    lua_pushvalue(L, 2);
+    ((luv_req_t*)req->data)->data_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  }
+  FS_RING(write, req, file, bufs ? bufs : &buf, count, offset);
   FS_CALL(write, req, file, bufs ? bufs : &buf, count, offset);
 }
 
@@ -438,6 +466,7 @@ static int luv_fs_stat(lua_State* L) {
   int ref = luv_check_continuation(L, 2);
   uv_fs_t* req = (uv_fs_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
+  FS_RING(stat, req, path);
   FS_CALL(stat, req, path);
 }
 
@@ -446,6 +475,7 @@ static int luv_fs_fstat(lua_State* L) {
   int ref = luv_check_continuation(L, 2);
   uv_fs_t* req = (uv_fs_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
+  FS_RING(fstat, req, file);
   FS_CALL(fstat, req, file);
 }
 
@@ -454,6 +484,7 @@ static int luv_fs_lstat(lua_State* L) {
   int ref = luv_check_continuation(L, 2);
   uv_fs_t* req = (uv_fs_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
+  FS_RING(lstat, req, path);
   FS_CALL(lstat, req, path);
 }
 
@@ -471,6 +502,7 @@ static int luv_fs_fsync(lua_State* L) {
   int ref = luv_check_continuation(L, 2);
   uv_fs_t* req = (uv_fs_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
+  FS_RING(fsync, req, file);
   FS_CALL(fsync, req, file);
 }
 
@@ -479,6 +511,7 @@ static int luv_fs_fdatasync(lua_State* L) {
   int ref = luv_check_continuation(L, 2);
   uv_fs_t* req = (uv_fs_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
+  FS_RING(fdatasync, req, file);
   FS_CALL(fdatasync, req, file);
 }
 
@@ -642,3 +675,23 @@ static int luv_fs_copyfile(lua_State*L) {
   FS_CALL(copyfile, req, path, new_path, flags);
 }
 #endif
+
+static int luv_fs_engine(lua_State* L) {
+  static const char* const engines[] = {"threadpool", "io_uring", NULL};
+  uv_loop_t* loop = luv_loop(L);
+  luv_loop_t* lp = (luv_loop_t*)loop;
+  int ret = 0;
+  if (!lua_isnoneornil(L, 1)) {
+    lp->fs_ring = 0;
+    if (luaL_checkoption(L, 1, NULL, engines) == 1) {
+      ret = luv_ring_init(loop);
+      lp->fs_ring = ret == 0;
+    }
+  }
+  lua_pushstring(L, lp->fs_ring ? "io_uring" : "threadpool");
+  if (ret < 0) {
+    lua_pushstring(L, uv_err_name(ret));
+    return 2;
+  }
+  return 1;
+}
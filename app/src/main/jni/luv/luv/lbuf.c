@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2014 The Luvit Authors. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+#include "lbuf.h"
+
+static void luv_buf_get(uv_loop_t* loop, uv_buf_t* buf) {
+  luv_loop_t* lp = (luv_loop_t*)loop;
+  if (lp->npool > 0) {
+    buf->base = lp->pool[--lp->npool];
+  }
+  else {
+    buf->base = (char*)malloc(LUV_BUF_SIZE);
+  }
+  buf->len = buf->base ? LUV_BUF_SIZE : 0;
+}
+
+static void luv_buf_put(uv_loop_t* loop, char* base) {
+  luv_loop_t* lp = (luv_loop_t*)loop;
+  if (!base) return;
+  if (lp->npool < LUV_BUF_POOL) {
+    lp->pool[lp->npool++] = base;
+  }
+  else {
+    free(base);
+  }
+}
+
+static void luv_buf_close(uv_loop_t* loop) {
+  luv_loop_t* lp = (luv_loop_t*)loop;
+  while (lp->npool > 0) {
+    free(lp->pool[--lp->npool]);
+  }
+}
+
+static void luv_new_view(lua_State* L) {
+  luaL_StrBuf* B = (luaL_StrBuf*)lua_newuserdatauv(L, sizeof(*B), 1);
+  B->b = NULL;
+  B->r = B->w = B->size = 0;
+  luaL_setmetatable(L, LUA_BUFFERHANDLE);
+}
+
+static void luv_set_view(lua_State* L, luv_handle_t* data, int mode) {
+  if (!mode) {
+    luaL_unref(L, LUA_REGISTRYINDEX, data->view);
+    data->view = LUA_NOREF;
+  }
+  else if (data->view == LUA_NOREF) {
+    if (luaL_getmetatable(L, LUA_BUFFERHANDLE) != LUA_TTABLE) {
+      luaL_error(L, "string.buffer is not available");
+    }
+    lua_pop(L, 1);
+    luv_new_view(L);
+    data->view = luaL_ref(L, LUA_REGISTRYINDEX);
+  }
+}
+
+static void luv_push_view(lua_State* L, luv_handle_t* data, char* base, size_t len) {
+  luaL_StrBuf* B;
+  lua_rawgeti(L, LUA_REGISTRYINDEX, data->view);
+  B = (luaL_StrBuf*)lua_touserdata(L, -1);
+  if (B->size != 0) {
+    // The callback wrote into the buffer, which now owns memory of its own.
+    // Leave it to the callback and show the data in a new one.
+    lua_pop(L, 1);
+    luv_new_view(L);
+    lua_pushvalue(L, -1);
+    lua_rawseti(L, LUA_REGISTRYINDEX, data->view);
+    B = (luaL_StrBuf*)lua_touserdata(L, -1);
+  }
+  else if (B->b && B->b != base) {
+    // Drop a string the callback may have set as the contents
+    lua_pushnil(L);
+    lua_setiuservalue(L, -2, 1);
+  }
+  B->b = base;
+  B->r = 0;
+  B->w = len;
+}
+
+static void luv_clear_view(lua_State* L, luv_handle_t* data, char* base) {
+  luaL_StrBuf* B;
+  if (data->view == LUA_NOREF) return;
+  lua_rawgeti(L, LUA_REGISTRYINDEX, data->view);
+  B = (luaL_StrBuf*)lua_touserdata(L, -1);
+  if (B->size == 0 && B->b >= base && B->b <= base + LUV_BUF_SIZE) {
+    B->b = NULL;
+    B->r = B->w = 0;
+  }
+  lua_pop(L, 1);
+}
@@ -0,0 +1,50 @@
+/*
+ *  Copyright 2014 The Luvit Authors. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+#ifndef LUV_LBUF_H
+#define LUV_LBUF_H
+
+#include "luv.h"
+
+/* Size of the blocks handed to libuv for stream and udp reads */
+#define LUV_BUF_SIZE 65536
+
+/* Most free blocks a loop keeps around for later reads */
+#define LUV_BUF_POOL 16
+
+/* Get a read block from the pool of the loop (or malloc a new one) */
+static void luv_buf_get(uv_loop_t* loop, uv_buf_t* buf);
+
+/* Give a read block back to the pool of the loop (or free it) */
+static void luv_buf_put(uv_loop_t* loop, char* base);
+
+/* Free all the pooled blocks of a closed loop */
+static void luv_buf_close(uv_loop_t* loop);
+
+/* Make reads on the handle arrive in a string.buffer instead of a string
+   (or go back to strings when mode is 0).
+*/
+static void luv_set_view(lua_State* L, luv_handle_t* data, int mode);
+
+/* Push the string.buffer of the handle, showing len bytes at base */
+static void luv_push_view(lua_State* L, luv_handle_t* data, char* base, size_t len);
+
+/* Empty the string.buffer of the handle if it still shows base, since the
+   block is about to be reused.
+*/
+static void luv_clear_view(lua_State* L, luv_handle_t* data, char* base);
+
+#endif
@@ -49,6 +49,8 @@ static luv_handle_t* luv_setup_handle(lua_State* L) {
   data->ref = luaL_ref(L, LUA_REGISTRYINDEX);
   data->callbacks[0] = LUA_NOREF;
   data->callbacks[1] = LUA_NOREF;
+  data->view = LUA_NOREF;
+  data->batch = 0;
   data->extra = NULL;
   return data;
 }
@@ -156,6 +158,7 @@ static void luv_unref_handle(lua_State* L, luv_handle_t* data) {
   luaL_unref(L, LUA_REGISTRYINDEX, data->ref);
   luaL_unref(L, LUA_REGISTRYINDEX, data->callbacks[0]);
   luaL_unref(L, LUA_REGISTRYINDEX, data->callbacks[1]);
+  luaL_unref(L, LUA_REGISTRYINDEX, data->view);
 }
 
 static void luv_find_handle(lua_State* L, luv_handle_t* data) {
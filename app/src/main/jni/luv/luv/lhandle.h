@@ -42,6 +42,8 @@
 typedef struct {
   int ref;
   int callbacks[2];
+  int view; /* string.buffer for reads (see lbuf.h), or LUA_NOREF */
+  int batch; /* most datagrams per udp recv callback, or 0 for one */
   void* extra;
 } luv_handle_t;
 
@@ -30,7 +30,15 @@ static const char *const luv_runmodes[] = {
 
 static int luv_run(lua_State* L) {
   int mode = luaL_checkoption(L, 1, "default", luv_runmodes);
-  int ret = uv_run(luv_loop(L), (uv_run_mode)mode);
+  luv_loop_t* lp = (luv_loop_t*)luv_loop(L);
+  int ret = uv_run(&lp->loop, (uv_run_mode)mode);
+  if (lp->error_ref != LUA_NOREF) {
+    // An awaiting coroutine failed and stopped the loop (see luv_resume_req)
+    lua_rawgeti(L, LUA_REGISTRYINDEX, lp->error_ref);
+    luaL_unref(L, LUA_REGISTRYINDEX, lp->error_ref);
+    lp->error_ref = LUA_NOREF;
+    return lua_error(L);
+  }
   if (ret < 0) return luv_error(L, ret);
   lua_pushboolean(L, ret);
   return 1;
@@ -43,6 +51,15 @@ static int luv_loop_alive(lua_State* L) {
   return 1;
 }
 
+static int luv_await_mode(lua_State* L) {
+  luv_loop_t* lp = (luv_loop_t*)luv_loop(L);
+  lua_pushboolean(L, lp->await);
+  if (!lua_isnoneornil(L, 1)) {
+    lp->await = lua_toboolean(L, 1);
+  }
+  return 1;
+}
+
 static int luv_stop(lua_State* L) {
   uv_stop(luv_loop(L));
   return 0;
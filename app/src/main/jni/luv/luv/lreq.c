@@ -18,21 +18,52 @@
 
 
 static int luv_check_continuation(lua_State* L, int index) {
-  if (lua_isnoneornil(L, index)) return LUA_NOREF;
+  if (lua_isnoneornil(L, index)) {
+    if (lua_isyieldable(L) && ((luv_loop_t*)luv_loop(L))->await) {
+      return LUV_AWAIT;
+    }
+    return LUA_NOREF;
+  }
   luaL_checktype(L, index, LUA_TFUNCTION);
   lua_pushvalue(L, index);
   return luaL_ref(L, LUA_REGISTRYINDEX);
 }
 
+// Continuation of an awaiting coroutine, run whoever resumes it.  The
+// request it waited on is the context: from now on its completion must not
+// resume the coroutine any more.
+static int luv_await_k(lua_State* L, int status, lua_KContext ctx) {
+  (void)status;
+  ((luv_req_t*)ctx)->co = NULL;
+  return lua_gettop(L);
+}
+
+static int luv_await(lua_State* L, luv_req_t* data, int nresults) {
+  if (data->callback_ref == LUV_AWAIT) {
+    // The request is kept alive by req_ref, the resume values are returned
+    lua_settop(L, 0);
+    return lua_yieldk(L, 0, (lua_KContext)data, luv_await_k);
+  }
+  return nresults;
+}
+
 // Store a lua callback in a luv_req for the continuation.
 // The uv_req_t is assumed to be at the top of the stack
 static luv_req_t* luv_setup_req(lua_State* L, int callback_ref) {
+  luv_loop_t* lp = (luv_loop_t*)luv_loop(L);
   luv_req_t* data;
 
   luaL_checktype(L, -1, LUA_TUSERDATA);
 
-  data = (luv_req_t*)malloc(sizeof(*data));
-  if (!data) luaL_error(L, "Problem allocating luv request");
+  if (lp->freereqs) {
+    data = lp->freereqs;
+    lp->freereqs = (luv_req_t*)data->data;
+    lp->nfreereqs--;
+  }
+  else {
+    data = (luv_req_t*)malloc(sizeof(*data));
+    if (!data) luaL_error(L, "Problem allocating luv request");
+  }
 
   luaL_getmetatable(L, "uv_req");
   lua_setmetatable(L, -2);
@@ -42,15 +73,61 @@ static luv_req_t* luv_setup_req(lua_State* L, int callback_ref) {
   data->callback_ref = callback_ref;
   data->data_ref = LUA_NOREF;
   data->data = NULL;
+  data->co = NULL;
+
+  if (callback_ref == LUV_AWAIT) {
+    // The request userdata keeps the waiting coroutine alive
+    lua_pushthread(L);
+    lua_setiuservalue(L, -2, 1);
+    data->co = L;
+  }
 
   return data;
 }
 
+static void luv_resume_req(lua_State* L, luv_req_t* data, int nargs) {
+  lua_State* co = data->co;
+  int ret, nres;
+  if (co == NULL || lua_status(co) != LUA_YIELD || !lua_checkstack(co, nargs)) {
+    // The coroutine no longer waits for this request: it was resumed by
+    // someone else (see luv_await_k) or closed.  Drop the results, the
+    // caller releases the request.
+    lua_pop(L, nargs);
+    return;
+  }
+  lua_xmove(L, co, nargs);
+  ret = lua_resume(co, L, nargs, &nres);
+  if (ret == LUA_OK || ret == LUA_YIELD) {
+    lua_pop(co, nres);
+  }
+  else {
+    luv_loop_t* lp = (luv_loop_t*)luv_loop(L);
+    if (lua_type(co, -1) == LUA_TSTRING) {
+      luaL_traceback(L, co, lua_tostring(co, -1), 0);
+    }
+    else {
+      lua_xmove(co, L, 1);
+    }
+    // Raised by uv.run once the loop stops, as for an error in a callback.
+    // Unwinding from here would skip the cleanup of the request.
+    if (lp->error_ref == LUA_NOREF) {
+      lp->error_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+      uv_stop(&lp->loop);
+    }
+    else {
+      fprintf(stderr, "Uncaught Error: %s\n", luaL_tolstring(L, -1, NULL));
+      lua_pop(L, 2);
+    }
+  }
+}
 
 static void luv_fulfill_req(lua_State* L, luv_req_t* data, int nargs) {
   if (data->callback_ref == LUA_NOREF) {
     lua_pop(L, nargs);
   }
+  else if (data->callback_ref == LUV_AWAIT) {
+    luv_resume_req(L, data, nargs);
+  }
   else {
     // Get the callback
     lua_rawgeti(L, LUA_REGISTRYINDEX, data->callback_ref);
@@ -67,5 +144,25 @@ static void luv_cleanup_req(lua_State* L, luv_req_t* data) {
   luaL_unref(L, LUA_REGISTRYINDEX, data->callback_ref);
   luaL_unref(L, LUA_REGISTRYINDEX, data->data_ref);
   free(data->data);
-  free(data);
+  {
+    luv_loop_t* lp = (luv_loop_t*)luv_loop(L);
+    if (lp->nfreereqs < LUV_REQ_POOL) {
+      data->data = lp->freereqs;
+      lp->freereqs = data;
+      lp->nfreereqs++;
+    }
+    else {
+      free(data);
+    }
+  }
+}
+
+static void luv_req_close(uv_loop_t* loop) {
+  luv_loop_t* lp = (luv_loop_t*)loop;
+  while (lp->freereqs) {
+    luv_req_t* data = lp->freereqs;
+    lp->freereqs = (luv_req_t*)data->data;
+    free(data);
+  }
+  lp->nfreereqs = 0;
 }
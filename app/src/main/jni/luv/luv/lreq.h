@@ -21,16 +21,33 @@
 
 typedef struct {
   int req_ref; /* ref for uv_req_t's userdata */
-  int callback_ref; /* ref for callback */
+  int callback_ref; /* ref for callback, or LUV_AWAIT */
   int data_ref; /* ref for write data */
-  void* data; /* extra data */
+  void* data; /* extra data (next free request when in the free list) */
+  lua_State* co; /* coroutine waiting for the request */
 } luv_req_t;
 
+/* Most free luv_req_t a loop keeps around for later requests */
+#define LUV_REQ_POOL 64
+
+/* Callback ref of a request that resumes the coroutine that made it */
+#define LUV_AWAIT (LUA_NOREF - 1)
+
 /* Used in the top of a setup function to check the arg
    and ref the callback to an integer.
+   In await mode (uv.await_mode) a missing callback in a coroutine that can
+   yield gives LUV_AWAIT: the coroutine yields until the request completes
+   and is then resumed with the arguments the callback would have got.
 */
 static int luv_check_continuation(lua_State* L, int index);
 
+/* Return from a setup function: nresults values, or yield for LUV_AWAIT.
+   Only the completion of this request resumes the coroutine; once anyone
+   else resumes it the completion is dropped.  An error in the resumed
+   coroutine is raised by uv.run.
+*/
+static int luv_await(lua_State* L, luv_req_t* data, int nresults);
+
 /* setup a luv_req_t.  The userdata is assumed to be at the
    top of the stack.
 */
@@ -40,4 +57,7 @@ static void luv_fulfill_req(lua_State* L, luv_req_t* data, int nargs);
 
 static void luv_cleanup_req(lua_State* L, luv_req_t* data);
 
+/* Free the pooled request data of a closed loop */
+static void luv_req_close(uv_loop_t* loop);
+
 #endif
@@ -0,0 +1,529 @@
+/*
+ *  Copyright 2014 The Luvit Authors. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+#include "lring.h"
+
+#ifdef LUV_RING
+
+#include "uv-common.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+#ifndef __NR_io_uring_setup
+# define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+# define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+# define __NR_io_uring_register 427
+#endif
+
+#ifndef AT_EMPTY_PATH
+# define AT_EMPTY_PATH 0x1000
+#endif
+
+#define LUV_STATX_BASIC_STATS 0x7ffU
+
+/* Layout of the kernel's struct statx, which libc headers may not have */
+typedef struct {
+  int64_t tv_sec;
+  uint32_t tv_nsec;
+  int32_t reserved;
+} luv_statx_time_t;
+
+typedef struct {
+  uint32_t stx_mask;
+  uint32_t stx_blksize;
+  uint64_t stx_attributes;
+  uint32_t stx_nlink;
+  uint32_t stx_uid;
+  uint32_t stx_gid;
+  uint16_t stx_mode;
+  uint16_t spare0;
+  uint64_t stx_ino;
+  uint64_t stx_size;
+  uint64_t stx_blocks;
+  uint64_t stx_attributes_mask;
+  luv_statx_time_t stx_atime;
+  luv_statx_time_t stx_btime;
+  luv_statx_time_t stx_ctime;
+  luv_statx_time_t stx_mtime;
+  uint32_t stx_rdev_major;
+  uint32_t stx_rdev_minor;
+  uint32_t stx_dev_major;
+  uint32_t stx_dev_minor;
+  uint64_t spare2[14];
+} luv_statx_t;
+
+struct luv_ring_s {
+  int fd;
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  unsigned sq_entries;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  unsigned cq_entries;
+  struct io_uring_sqe* sqes;
+  struct io_uring_cqe* cqes;
+  void* sq_ring;
+  size_t sq_size;
+  void* cq_ring; /* same as sq_ring with IORING_FEAT_SINGLE_MMAP */
+  size_t cq_size;
+  size_t sqes_size;
+  unsigned queued; /* sqes not submitted yet */
+  unsigned inflight; /* sqes not completed yet */
+  unsigned char ops[32]; /* bit set of the ops the kernel supports */
+  char* bufs; /* registered read blocks, or NULL */
+  uint32_t freebufs; /* bit set of the free ones */
+  int closing;
+  uv_poll_t poll; /* readable when there are completions */
+  uv_prepare_t prepare; /* submits the queued sqes before the loop polls */
+};
+
+static int luv_ring_enter(int fd, unsigned submit) {
+  return syscall(__NR_io_uring_enter, fd, submit, 0, 0, NULL, 0);
+}
+
+static int luv_ring_register(int fd, unsigned op, void* arg, unsigned n) {
+  return syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+static int luv_ring_supports(luv_ring_t* ring, int op) {
+  return op < 256 && (ring->ops[op >> 3] & (1 << (op & 7)));
+}
+
+static void luv_ring_submit(luv_ring_t* ring) {
+  while (ring->queued > 0) {
+    int ret = luv_ring_enter(ring->fd, ring->queued);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      // Try again on the next loop iteration
+      return;
+    }
+    ring->queued -= ret;
+  }
+  uv_prepare_stop(&ring->prepare);
+}
+
+static void luv_ring_prepare_cb(uv_prepare_t* handle) {
+  luv_ring_submit((luv_ring_t*)handle->data);
+}
+
+static void luv_statx_to_stat(uv_stat_t* s, const luv_statx_t* x) {
+  s->st_dev = makedev(x->stx_dev_major, x->stx_dev_minor);
+  s->st_mode = x->stx_mode;
+  s->st_nlink = x->stx_nlink;
+  s->st_uid = x->stx_uid;
+  s->st_gid = x->stx_gid;
+  s->st_rdev = makedev(x->stx_rdev_major, x->stx_rdev_minor);
+  s->st_ino = x->stx_ino;
+  s->st_size = x->stx_size;
+  s->st_blksize = x->stx_blksize;
+  s->st_blocks = x->stx_blocks;
+  s->st_flags = 0;
+  s->st_gen = 0;
+  s->st_atim.tv_sec = x->stx_atime.tv_sec;
+  s->st_atim.tv_nsec = x->stx_atime.tv_nsec;
+  s->st_mtim.tv_sec = x->stx_mtime.tv_sec;
+  s->st_mtim.tv_nsec = x->stx_mtime.tv_nsec;
+  s->st_ctim.tv_sec = x->stx_ctime.tv_sec;
+  s->st_ctim.tv_nsec = x->stx_ctime.tv_nsec;
+  // As uv_fs_stat does on linux
+  s->st_birthtim = s->st_ctim;
+}
+
+/* Complete the requests in the completion queue.  With cancel, the loop is
+   closing: every request fails with UV_ECANCELED and its result is dropped.
+*/
+static void luv_ring_reap(luv_ring_t* ring, int cancel) {
+  for (;;) {
+    unsigned head = *ring->cq_head;
+    struct io_uring_cqe cqe;
+    uv_fs_t* req;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) break;
+    cqe = ring->cqes[head & *ring->cq_mask];
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    ring->inflight--;
+    req = (uv_fs_t*)(uintptr_t)cqe.user_data;
+    if (cancel) {
+      // Nobody gets the file an open returned
+      if (cqe.res >= 0 && req->fs_type == UV_FS_OPEN) close(cqe.res);
+      cqe.res = UV_ECANCELED;
+    }
+    req->result = cqe.res;
+    if (cqe.res == 0 && (req->fs_type == UV_FS_STAT ||
+        req->fs_type == UV_FS_LSTAT || req->fs_type == UV_FS_FSTAT)) {
+      luv_statx_to_stat(&req->statbuf, (luv_statx_t*)((luv_req_t*)req->data)->data);
+      req->ptr = &req->statbuf;
+    }
+    // Calls into lua, which may queue more requests
+    luv_fs_cb(req);
+  }
+}
+
+static void luv_ring_poll_cb(uv_poll_t* handle, int status, int events) {
+  luv_ring_t* ring = (luv_ring_t*)handle->data;
+  (void)status;
+  (void)events;
+  luv_ring_reap(ring, 0);
+  if (ring->inflight == 0) uv_poll_stop(&ring->poll);
+}
+
+static void luv_ring_free(luv_ring_t* ring) {
+  if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_size);
+  if (ring->sq_ring) munmap(ring->sq_ring, ring->sq_size);
+  if (ring->fd >= 0) close(ring->fd);
+  free(ring->bufs);
+  free(ring);
+}
+
+static int luv_ring_map(luv_ring_t* ring, struct io_uring_params* p) {
+  struct io_uring_probe* probe;
+  struct iovec iov[LUV_RING_BUFS];
+  char* sq;
+  char* cq;
+  int i;
+
+  ring->sq_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+  ring->cq_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+  if (p->features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+    ring->cq_size = ring->sq_size;
+  }
+  ring->sq_ring = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    ring->sq_ring = NULL;
+    return -errno;
+  }
+  if (p->features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ring = ring->sq_ring;
+  }
+  else {
+    ring->cq_ring = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) {
+      ring->cq_ring = NULL;
+      return -errno;
+    }
+  }
+  ring->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    ring->sqes = NULL;
+    return -errno;
+  }
+
+  sq = (char*)ring->sq_ring;
+  ring->sq_head = (unsigned*)(sq + p->sq_off.head);
+  ring->sq_tail = (unsigned*)(sq + p->sq_off.tail);
+  ring->sq_mask = (unsigned*)(sq + p->sq_off.ring_mask);
+  ring->sq_array = (unsigned*)(sq + p->sq_off.array);
+  ring->sq_entries = p->sq_entries;
+  cq = (char*)ring->cq_ring;
+  ring->cq_head = (unsigned*)(cq + p->cq_off.head);
+  ring->cq_tail = (unsigned*)(cq + p->cq_off.tail);
+  ring->cq_mask = (unsigned*)(cq + p->cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*)(cq + p->cq_off.cqes);
+  ring->cq_entries = p->cq_entries;
+
+  // Without a probe (before 5.6) the ring lacks the ops we need anyway
+  probe = (struct io_uring_probe*)calloc(1, sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op));
+  if (!probe) return UV_ENOMEM;
+  if (luv_ring_register(ring->fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+    free(probe);
+    return UV_ENOSYS;
+  }
+  for (i = 0; i < probe->ops_len; i++) {
+    if (probe->ops[i].flags & IO_URING_OP_SUPPORTED) {
+      ring->ops[probe->ops[i].op >> 3] |= 1 << (probe->ops[i].op & 7);
+    }
+  }
+  free(probe);
+
+  // Reads go to plain buffers when the blocks cannot be registered,
+  // e.g. over RLIMIT_MEMLOCK on older kernels.
+  ring->bufs = (char*)malloc((size_t)LUV_RING_BUFS * LUV_BUF_SIZE);
+  if (ring->bufs) {
+    for (i = 0; i < LUV_RING_BUFS; i++) {
+      iov[i].iov_base = ring->bufs + (size_t)i * LUV_BUF_SIZE;
+      iov[i].iov_len = LUV_BUF_SIZE;
+    }
+    if (luv_ring_register(ring->fd, IORING_REGISTER_BUFFERS, iov, LUV_RING_BUFS) < 0) {
+      free(ring->bufs);
+      ring->bufs = NULL;
+    }
+    else {
+      ring->freebufs = LUV_RING_BUFS == 32 ? 0xffffffffU : (1U << LUV_RING_BUFS) - 1;
+    }
+  }
+  return 0;
+}
+
+static int luv_ring_init(uv_loop_t* loop) {
+  luv_loop_t* lp = (luv_loop_t*)loop;
+  struct io_uring_params p;
+  luv_ring_t* ring;
+  int ret;
+
+  if (lp->ring) return 0;
+  ring = (luv_ring_t*)calloc(1, sizeof(*ring));
+  if (!ring) return UV_ENOMEM;
+  memset(&p, 0, sizeof(p));
+  ring->fd = syscall(__NR_io_uring_setup, LUV_RING_ENTRIES, &p);
+  if (ring->fd < 0) {
+    // ENOSYS on old kernels, EPERM where it is disabled or filtered
+    ret = -errno;
+    luv_ring_free(ring);
+    return ret;
+  }
+  ret = luv_ring_map(ring, &p);
+  if (ret == 0) ret = uv_poll_init(loop, &ring->poll, ring->fd);
+  if (ret < 0) {
+    luv_ring_free(ring);
+    return ret;
+  }
+  uv_prepare_init(loop, &ring->prepare);
+  // Hide both from uv.walk and from the closing walk of the loop
+  ring->poll.flags |= UV__HANDLE_INTERNAL;
+  ring->prepare.flags |= UV__HANDLE_INTERNAL;
+  ring->poll.data = ring;
+  ring->prepare.data = ring;
+  lp->ring = ring;
+  return 0;
+}
+
+static void luv_ring_close_cb(uv_handle_t* handle) {
+  luv_ring_t* ring = (luv_ring_t*)handle->data;
+  if (--ring->closing == 0) luv_ring_free(ring);
+}
+
+static void luv_ring_shutdown(uv_loop_t* loop) {
+  luv_loop_t* lp = (luv_loop_t*)loop;
+  luv_ring_t* ring = lp->ring;
+  if (!ring) return;
+  // Requests made by the callbacks below go to the threadpool
+  lp->fs_ring = 0;
+  // Fs requests always finish, so wait for those in flight (submitting the
+  // queued ones first) and fail each with UV_ECANCELED.  Their callbacks and
+  // awaiting coroutines get the error and their refs are released.
+  while (ring->inflight > 0) {
+    int ret = syscall(__NR_io_uring_enter, ring->fd, ring->queued, 1,
+                      IORING_ENTER_GETEVENTS, NULL, 0);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      // The ring is unusable: what is left leaks with it
+      break;
+    }
+    ring->queued -= ret;
+    luv_ring_reap(ring, 1);
+    lp->fs_ring = 0;
+  }
+  lp->ring = NULL;
+  ring->closing = 2;
+  uv_close((uv_handle_t*)&ring->poll, luv_ring_close_cb);
+  uv_close((uv_handle_t*)&ring->prepare, luv_ring_close_cb);
+}
+
+static void luv_ring_release(uv_fs_t* req) {
+  luv_ring_t* ring = ((luv_loop_t*)req->loop)->ring;
+  luv_req_t* data = (luv_req_t*)req->data;
+  char* base = (char*)data->data;
+  if (ring && ring->bufs && base >= ring->bufs &&
+      base < ring->bufs + (size_t)LUV_RING_BUFS * LUV_BUF_SIZE) {
+    ring->freebufs |= 1U << ((base - ring->bufs) / LUV_BUF_SIZE);
+    data->data = NULL;
+  }
+}
+
+/* Get a clean sqe for op, or NULL when the request should use the threadpool */
+static struct io_uring_sqe* luv_ring_get(uv_loop_t* loop, int op) {
+  luv_loop_t* lp = (luv_loop_t*)loop;
+  luv_ring_t* ring = lp->ring;
+  struct io_uring_sqe* sqe;
+  if (!lp->fs_ring || !ring || !luv_ring_supports(ring, op)) return NULL;
+  // Every completion must fit in the completion queue
+  if (ring->inflight >= ring->cq_entries) return NULL;
+  if (ring->queued >= ring->sq_entries) {
+    luv_ring_submit(ring);
+    if (ring->queued >= ring->sq_entries) return NULL;
+  }
+  sqe = &ring->sqes[*ring->sq_tail & *ring->sq_mask];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = op;
+  return sqe;
+}
+
+/* Queue the sqe from luv_ring_get for req */
+static int luv_ring_push(uv_loop_t* loop, uv_fs_t* req, uv_fs_type type,
+                         struct io_uring_sqe* sqe, const char* path) {
+  luv_ring_t* ring = ((luv_loop_t*)loop)->ring;
+  unsigned tail = *ring->sq_tail;
+  req->type = UV_FS;
+  req->fs_type = type;
+  req->loop = loop;
+  req->result = 0;
+  req->ptr = NULL;
+  // uv_fs_req_cleanup frees path, as for a request with a callback
+  req->path = path;
+  req->new_path = NULL;
+  req->bufs = NULL;
+  req->cb = luv_fs_cb;
+  sqe->user_data = (uintptr_t)req;
+  ring->sq_array[tail & *ring->sq_mask] = tail & *ring->sq_mask;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  if (ring->queued++ == 0) uv_prepare_start(&ring->prepare, luv_ring_prepare_cb);
+  if (ring->inflight++ == 0) uv_poll_start(&ring->poll, UV_READABLE, luv_ring_poll_cb);
+  return 0;
+}
+
+static int luv_ring_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags, int mode) {
+  struct io_uring_sqe* sqe = luv_ring_get(loop, IORING_OP_OPENAT);
+  char* copy;
+  if (!sqe || !(copy = strdup(path))) return UV_ENOSYS;
+  sqe->fd = AT_FDCWD;
+  sqe->addr = (uintptr_t)copy;
+  sqe->len = mode;
+  sqe->open_flags = flags | O_CLOEXEC;
+  return luv_ring_push(loop, req, UV_FS_OPEN, sqe, copy);
+}
+
+static int luv_ring_close(uv_loop_t* loop, uv_fs_t* req, uv_file file) {
+  struct io_uring_sqe* sqe = luv_ring_get(loop, IORING_OP_CLOSE);
+  if (!sqe) return UV_ENOSYS;
+  sqe->fd = file;
+  return luv_ring_push(loop, req, UV_FS_CLOSE, sqe, NULL);
+}
+
+static int luv_ring_read(uv_loop_t* loop, uv_fs_t* req, uv_file file, int64_t len, int64_t offset) {
+  luv_ring_t* ring = ((luv_loop_t*)loop)->ring;
+  luv_req_t* data = (luv_req_t*)req->data;
+  struct io_uring_sqe* sqe;
+  // Reads at the file position (offset -1) stay on the threadpool
+  if (offset < 0 || len < 0 || len > UINT32_MAX) return UV_EINVAL;
+  if (ring && ring->freebufs && len <= LUV_BUF_SIZE &&
+      (sqe = luv_ring_get(loop, IORING_OP_READ_FIXED))) {
+    int i = __builtin_ctz(ring->freebufs);
+    ring->freebufs &= ~(1U << i);
+    data->data = ring->bufs + (size_t)i * LUV_BUF_SIZE;
+    sqe->buf_index = i;
+  }
+  else if ((sqe = luv_ring_get(loop, IORING_OP_READ))) {
+    data->data = malloc(len ? len : 1);
+    if (!data->data) return UV_ENOMEM;
+  }
+  else {
+    return UV_ENOSYS;
+  }
+  sqe->fd = file;
+  sqe->addr = (uintptr_t)data->data;
+  sqe->len = (uint32_t)len;
+  sqe->off = offset;
+  return luv_ring_push(loop, req, UV_FS_READ, sqe, NULL);
+}
+
+static int luv_ring_write(uv_loop_t* loop, uv_fs_t* req, uv_file file, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset) {
+  struct io_uring_sqe* sqe;
+  if (offset < 0) return UV_EINVAL;
+  // A single buffer is copied into the request, since the ring reads the
+  // iovecs only when the loop submits them
+  if (nbufs == 1) {
+    req->bufsml[0] = bufs[0];
+    bufs = req->bufsml;
+  }
+  sqe = luv_ring_get(loop, IORING_OP_WRITEV);
+  if (!sqe) return UV_ENOSYS;
+  sqe->fd = file;
+  sqe->addr = (uintptr_t)bufs; // uv_buf_t has the layout of struct iovec
+  sqe->len = nbufs;
+  sqe->off = offset;
+  return luv_ring_push(loop, req, UV_FS_WRITE, sqe, NULL);
+}
+
+/* Queue a statx; a NULL path is the empty path of fstat */
+static int luv_ring_statx(uv_loop_t* loop, uv_fs_t* req, uv_fs_type type, int dirfd, const char* path, int flags) {
+  luv_req_t* data = (luv_req_t*)req->data;
+  struct io_uring_sqe* sqe = luv_ring_get(loop, IORING_OP_STATX);
+  char* copy = NULL;
+  if (!sqe) return UV_ENOSYS;
+  if (path && !(copy = strdup(path))) return UV_ENOMEM;
+  data->data = malloc(sizeof(luv_statx_t));
+  if (!data->data) {
+    free(copy);
+    return UV_ENOMEM;
+  }
+  sqe->fd = dirfd;
+  sqe->addr = (uintptr_t)(copy ? copy : "");
+  sqe->len = LUV_STATX_BASIC_STATS;
+  sqe->off = (uintptr_t)data->data;
+  sqe->statx_flags = flags;
+  return luv_ring_push(loop, req, type, sqe, copy);
+}
+
+static int luv_ring_stat(uv_loop_t* loop, uv_fs_t* req, const char* path) {
+  return luv_ring_statx(loop, req, UV_FS_STAT, AT_FDCWD, path, 0);
+}
+
+static int luv_ring_lstat(uv_loop_t* loop, uv_fs_t* req, const char* path) {
+  return luv_ring_statx(loop, req, UV_FS_LSTAT, AT_FDCWD, path, AT_SYMLINK_NOFOLLOW);
+}
+
+static int luv_ring_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file) {
+  return luv_ring_statx(loop, req, UV_FS_FSTAT, file, NULL, AT_EMPTY_PATH);
+}
+
+static int luv_ring_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file file) {
+  struct io_uring_sqe* sqe = luv_ring_get(loop, IORING_OP_FSYNC);
+  if (!sqe) return UV_ENOSYS;
+  sqe->fd = file;
+  return luv_ring_push(loop, req, UV_FS_FSYNC, sqe, NULL);
+}
+
+static int luv_ring_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file file) {
+  struct io_uring_sqe* sqe = luv_ring_get(loop, IORING_OP_FSYNC);
+  if (!sqe) return UV_ENOSYS;
+  sqe->fd = file;
+  sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+  return luv_ring_push(loop, req, UV_FS_FDATASYNC, sqe, NULL);
+}
+
+#else
+
+static int luv_ring_init(uv_loop_t* loop) {
+  (void)loop;
+  return UV_ENOSYS;
+}
+
+static void luv_ring_shutdown(uv_loop_t* loop) {
+  (void)loop;
+}
+
+static void luv_ring_release(uv_fs_t* req) {
+  (void)req;
+}
+
+#endif
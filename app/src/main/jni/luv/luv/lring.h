@@ -0,0 +1,72 @@
+/*
+ *  Copyright 2014 The Luvit Authors. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+#ifndef LUV_LRING_H
+#define LUV_LRING_H
+
+#include "luv.h"
+
+/* The io_uring fs engine (see uv.fs_engine) runs async fs requests on a
+   per-loop io_uring instead of the libuv threadpool.  Requests queued during
+   a loop iteration are submitted together just before the loop polls, and
+   the ring fd is polled with the other fds for completions.  Requests the
+   ring cannot take (unsupported op, ring full, no io_uring in the kernel)
+   silently go to the threadpool.
+*/
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+#  ifdef IORING_FEAT_FAST_POLL /* header new enough for openat, statx, probe */
+#   define LUV_RING
+#  endif
+# endif
+#endif
+
+/* Entries of the submission queue */
+#define LUV_RING_ENTRIES 256
+
+/* Registered blocks of LUV_BUF_SIZE for reads (at most 32) */
+#define LUV_RING_BUFS 16
+
+typedef struct luv_ring_s luv_ring_t;
+
+/* Create the ring of a loop if it does not have one yet: 0 or a uv error */
+static int luv_ring_init(uv_loop_t* loop);
+
+/* Close the ring of a loop; the loop must run to finish it.  Requests in
+   flight complete first, with UV_ECANCELED.
+*/
+static void luv_ring_shutdown(uv_loop_t* loop);
+
+/* Give the registered block of a finished read back to the ring */
+static void luv_ring_release(uv_fs_t* req);
+
+#ifdef LUV_RING
+/* Queue a request on the ring: 0, or nonzero to use the threadpool.
+   The arguments are those of the matching uv_fs_* function.
+*/
+static int luv_ring_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags, int mode);
+static int luv_ring_close(uv_loop_t* loop, uv_fs_t* req, uv_file file);
+static int luv_ring_read(uv_loop_t* loop, uv_fs_t* req, uv_file file, int64_t len, int64_t offset);
+static int luv_ring_write(uv_loop_t* loop, uv_fs_t* req, uv_file file, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset);
+static int luv_ring_stat(uv_loop_t* loop, uv_fs_t* req, const char* path);
+static int luv_ring_lstat(uv_loop_t* loop, uv_fs_t* req, const char* path);
+static int luv_ring_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file);
+static int luv_ring_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file file);
+static int luv_ring_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file file);
+#endif
+
+#endif
@@ -19,6 +19,7 @@
 #include "util.c"
 #include "lhandle.c"
 #include "lreq.c"
+#include "lbuf.c"
 #include "loop.c"
 #include "req.c"
 #include "handle.c"
@@ -38,6 +39,7 @@
 #include "fs_event.c"
 #include "fs_poll.c"
 #include "fs.c"
+#include "lring.c"
 #include "dns.c"
 #include "thread.c"
 #include "work.c"
@@ -49,6 +51,7 @@ static const luaL_Reg luv_functions[] = {
   {"loop_close", luv_loop_close},
   {"run", luv_run},
   {"loop_alive", luv_loop_alive},
+  {"await_mode", luv_await_mode},
   {"stop", luv_stop},
   {"backend_fd", luv_backend_fd},
   {"backend_timeout", luv_backend_timeout},
@@ -174,6 +177,7 @@ static const luaL_Reg luv_functions[] = {
   {"udp_set_ttl", luv_udp_set_ttl},
   {"udp_send", luv_udp_send},
   {"udp_try_send", luv_udp_try_send},
+  {"udp_send_batch", luv_udp_send_batch},
   {"udp_recv_start", luv_udp_recv_start},
   {"udp_recv_stop", luv_udp_recv_stop},
 
@@ -221,6 +225,7 @@ static const luaL_Reg luv_functions[] = {
   {"fs_fchown", luv_fs_fchown},
 #if LUV_UV_VERSION_GEQ(1, 14, 0)
   {"fs_copyfile", luv_fs_copyfile },
+  {"fs_engine", luv_fs_engine},
 #endif
 
   // dns.c
@@ -424,6 +429,7 @@ static const luaL_Reg luv_udp_methods[] = {
   {"set_ttl", luv_udp_set_ttl},
   {"send", luv_udp_send},
   {"try_send", luv_udp_try_send},
+  {"send_batch", luv_udp_send_batch},
   {"recv_start", luv_udp_recv_start},
   {"recv_stop", luv_udp_recv_stop},
   {NULL, NULL}
@@ -504,12 +510,16 @@ static void walk_cb(uv_handle_t *handle, void *arg)
 
 static int loop_gc(lua_State *L) {
   uv_loop_t* loop = luv_loop(L);
+  luv_ring_shutdown(loop);
   // Call uv_close on every active handle
   uv_walk(loop, walk_cb, NULL);
   // Run the event loop until all handles are successfully closed
   while (uv_loop_close(loop)) {
     uv_run(loop, UV_RUN_DEFAULT);
   }
+  luv_buf_close(loop);
+  luv_req_close(loop);
+  luaL_unref(L, LUA_REGISTRYINDEX, ((luv_loop_t*)loop)->error_ref);
   return 0;
 }
 
@@ -524,7 +534,14 @@ LUALIB_API int luaopen_luv (lua_State *L) {
   lua_pushcfunction(L, loop_gc);
   lua_settable(L, -3);
 
-  loop = (uv_loop_t*)lua_newuserdata(L, sizeof(*loop));
+  loop = (uv_loop_t*)lua_newuserdata(L, sizeof(luv_loop_t));
+  ((luv_loop_t*)loop)->npool = 0;
+  ((luv_loop_t*)loop)->freereqs = NULL;
+  ((luv_loop_t*)loop)->nfreereqs = 0;
+  ((luv_loop_t*)loop)->await = 0;
+  ((luv_loop_t*)loop)->error_ref = LUA_NOREF;
+  ((luv_loop_t*)loop)->ring = NULL;
+  ((luv_loop_t*)loop)->fs_ring = 0;
   ret = uv_loop_init(loop);
   if (ret < 0) {
     return luaL_error(L, "%s: %s\n", uv_err_name(ret), uv_strerror(ret));
@@ -73,6 +73,21 @@ LUALIB_API int luaopen_luv (lua_State *L);
 #include "util.h"
 #include "lhandle.h"
 #include "lreq.h"
+#include "lbuf.h"
+#include "lring.h"
+
+/* The loop userdata: the libuv loop followed by per-loop state */
+typedef struct {
+  uv_loop_t loop; /* must be first, see luv_loop */
+  char* pool[LUV_BUF_POOL]; /* free read blocks (see lbuf.h) */
+  int npool;
+  luv_req_t* freereqs; /* free list of request data (see lreq.h) */
+  int nfreereqs;
+  int await; /* requests without a callback yield (see luv_check_continuation) */
+  int error_ref; /* error of an awaiting coroutine, raised by uv.run */
+  luv_ring_t* ring; /* io_uring for fs requests (see lring.h), or NULL */
+  int fs_ring; /* send fs requests to the ring */
+} luv_loop_t;
 
 /* From stream.c */
 static uv_stream_t* luv_check_stream(lua_State* L, int index);
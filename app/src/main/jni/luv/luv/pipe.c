@@ -62,7 +62,7 @@ static int luv_pipe_connect(lua_State* L) {
   uv_connect_t* req = (uv_connect_t*)lua_newuserdata(L, sizeof(*req));
   req->data = luv_setup_req(L, ref);
   uv_pipe_connect(req, handle, name, luv_connect_cb);
-  return 1;
+  return luv_await(L, (luv_req_t*)req->data, 1);
 }
 
 static int luv_pipe_getsockname(lua_State* L) {
@@ -59,7 +59,7 @@ static int luv_shutdown(lua_State* L) {
     lua_pop(L, 1);
     return luv_error(L, ret);
   }
-  return 1;
+  return luv_await(L, (luv_req_t*)req->data, 1);
 }
 
 static void luv_connection_cb(uv_stream_t* handle, int status) {
@@ -89,40 +89,60 @@ static int luv_accept(lua_State* L) {
 }
 
 static void luv_alloc_cb(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf) {
-  (void)handle;
-  buf->base = (char*)malloc(suggested_size);
-  assert(buf->base);
-  buf->len = suggested_size;
+  (void)suggested_size;
+  luv_buf_get(handle->loop, buf);
 }
 
 static void luv_read_cb(uv_stream_t* handle, ssize_t nread, const uv_buf_t* buf) {
   lua_State* L = luv_state(handle->loop);
+  luv_handle_t* data = (luv_handle_t*)handle->data;
   int nargs;
 
   if (nread > 0) {
     lua_pushnil(L);
-    lua_pushlstring(L, buf->base, nread);
+    if (data->view != LUA_NOREF) {
+      luv_push_view(L, data, buf->base, nread);
+    }
+    else {
+      lua_pushlstring(L, buf->base, nread);
+    }
     nargs = 2;
   }
-
-  free(buf->base);
-  if (nread == 0) return;
-
-  if (nread == UV_EOF) {
+  else if (nread == 0) {
+    luv_buf_put(handle->loop, buf->base);
+    return;
+  }
+  else if (nread == UV_EOF) {
     nargs = 0;
   }
-  else if (nread < 0) {
+  else {
     luv_status(L, nread);
     nargs = 1;
   }
 
-  luv_call_callback(L, (luv_handle_t*)handle->data, LUV_READ, nargs);
+  luv_call_callback(L, data, LUV_READ, nargs);
+  if (nread > 0) luv_clear_view(L, data, buf->base);
+  luv_buf_put(handle->loop, buf->base);
+}
+
+/* Reads are delivered as strings, or with {buffer = true} in a string.buffer
+   that shows the data in place and is only valid during the callback.
+*/
+static void luv_check_read_opts(lua_State* L, luv_handle_t* data, int index) {
+  int view = 0;
+  if (lua_type(L, index) == LUA_TTABLE) {
+    lua_getfield(L, index, "buffer");
+    view = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+  }
+  luv_set_view(L, data, view);
 }
 
 static int luv_read_start(lua_State* L) {
   uv_stream_t* handle = luv_check_stream(L, 1);
   int ret;
   luv_check_callback(L, (luv_handle_t*)handle->data, LUV_READ, 2);
+  luv_check_read_opts(L, (luv_handle_t*)handle->data, 3);
   ret = uv_read_start(handle, luv_alloc_cb, luv_read_cb);
   if (ret < 0) return luv_error(L, ret);
   lua_pushinteger(L, ret);
@@ -186,7 +206,7 @@ static int luv_write(lua_State* L) {
   }
   lua_pushvalue(L, 2);
   ((luv_req_t*)req->data)->data_ref = luaL_ref(L, LUA_REGISTRYINDEX);
-  return 1;
+  return luv_await(L, (luv_req_t*)req->data, 1);
 }
 
 static int luv_write2(lua_State* L) {
@@ -219,7 +239,7 @@ static int luv_write2(lua_State* L) {
   }
   lua_pushvalue(L, 2);
   ((luv_req_t*)req->data)->data_ref = luaL_ref(L, LUA_REGISTRYINDEX);
-  return 1;
+  return luv_await(L, (luv_req_t*)req->data, 1);
 }
 
 static int luv_try_write(lua_State* L) {
@@ -187,5 +187,5 @@ static int luv_tcp_connect(lua_State* L) {
     lua_pop(L, 1);
     return luv_error(L, ret);
   }
-  return 1;
+  return luv_await(L, (luv_req_t*)req->data, 1);
 }
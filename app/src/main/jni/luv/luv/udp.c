@@ -15,6 +15,12 @@
  *
  */
 #include "luv.h"
+#if defined(__linux__)
+#include "unix/linux-syscalls.h"
+#endif
+
+/* Most datagrams per batched recv callback or send_batch call */
+#define LUV_UDP_BATCH 64
 
 static uv_udp_t* luv_check_udp(lua_State* L, int index) {
   uv_udp_t* handle = (uv_udp_t*)luv_checkudata(L, index, "uv_udp");
@@ -200,7 +206,7 @@ static int luv_udp_send(lua_State* L) {
   ((luv_req_t*)req->data)->data_ref = luaL_ref(L, LUA_REGISTRYINDEX);
   lua_pop(L, 1);
 
-  return 1;
+  return luv_await(L, (luv_req_t*)req->data, 1);
 
 }
 
@@ -223,8 +229,205 @@ static int luv_udp_try_send(lua_State* L) {
   return 1;
 }
 
+static int luv_udp_send_batch(lua_State* L) {
+  uv_udp_t* handle = luv_check_udp(L, 1);
+  uv_buf_t bufs[LUV_UDP_BATCH];
+  struct sockaddr_storage addrs[LUV_UDP_BATCH];
+  socklen_t lens[LUV_UDP_BATCH];
+  uv_os_fd_t fd;
+  int i, n, sent, ret;
+  luaL_checktype(L, 2, LUA_TTABLE);
+  n = lua_rawlen(L, 2);
+  luaL_argcheck(L, n <= LUV_UDP_BATCH, 2, "too many datagrams");
+  luaL_checkstack(L, n + 4, "too many datagrams");
+  // The data of each datagram stays on the stack until it is sent, since
+  // lua_tolstring may have converted a number there
+  for (i = 0; i < n; i++) {
+    const char* host;
+    int port;
+    lua_rawgeti(L, 2, i + 1);
+    luaL_argcheck(L, lua_istable(L, -1), 2, "datagrams must be {data, host, port} tables");
+    lua_rawgeti(L, -1, 1);
+    lua_rawgeti(L, -2, 2);
+    lua_rawgeti(L, -3, 3);
+    bufs[i].base = (char*)lua_tolstring(L, -3, &bufs[i].len);
+    host = lua_tostring(L, -2);
+    port = lua_tointeger(L, -1);
+    luaL_argcheck(L, bufs[i].base && host, 2, "datagrams must be {data, host, port} tables");
+    if (uv_ip4_addr(host, port, (struct sockaddr_in*)&addrs[i]) == 0) {
+      lens[i] = sizeof(struct sockaddr_in);
+    }
+    else if (uv_ip6_addr(host, port, (struct sockaddr_in6*)&addrs[i]) == 0) {
+      lens[i] = sizeof(struct sockaddr_in6);
+    }
+    else {
+      return luaL_error(L, "Invalid IP address or port [%s:%d]", host, port);
+    }
+    lua_pop(L, 2);
+    lua_remove(L, -2);
+  }
+  // Like try_send, do not overtake datagrams queued by send
+  if (handle->send_queue_count > 0) return luv_error(L, UV_EAGAIN);
+  ret = uv_fileno((uv_handle_t*)handle, &fd);
+  if (ret < 0) return luv_error(L, ret);
+  sent = 0;
+#if defined(__linux__)
+  if (n > 0) {
+    struct uv__mmsghdr msgs[LUV_UDP_BATCH];
+    struct iovec iov[LUV_UDP_BATCH];
+    memset(msgs, 0, n * sizeof(msgs[0]));
+    for (i = 0; i < n; i++) {
+      iov[i].iov_base = bufs[i].base;
+      iov[i].iov_len = bufs[i].len;
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = lens[i];
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    do {
+      ret = uv__sendmmsg(fd, msgs, n, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret >= 0) sent = n = ret;
+    else if (errno != ENOSYS) return luv_error(L, -errno);
+  }
+#endif
+  // One sendto per datagram where sendmmsg is missing
+  for (; sent < n; sent++) {
+    do {
+      ret = sendto(fd, bufs[sent].base, bufs[sent].len, 0, (struct sockaddr*)&addrs[sent], lens[sent]);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+      if (sent > 0) break;
+      return luv_error(L, -errno);
+    }
+  }
+  lua_pushinteger(L, sent);
+  return 1;
+}
+
+static void luv_udp_push_dgram(lua_State* L, const char* base, size_t len, const struct sockaddr* addr, int partial, int i) {
+  lua_createtable(L, 2, partial);
+  lua_pushlstring(L, base, len);
+  lua_rawseti(L, -2, 1);
+  parse_sockaddr(L, (struct sockaddr_storage*)addr);
+  lua_rawseti(L, -2, 2);
+  if (partial) {
+    lua_pushboolean(L, 1);
+    lua_setfield(L, -2, "partial");
+  }
+  lua_rawseti(L, -2, i);
+}
+
+/* Read up to n queued datagrams (at most LUV_BUF_POOL) into blocks of the
+   loop pool and add them to the list at the top of the stack, starting at
+   index i.  Returns how many were added.
+*/
+static int luv_udp_recv_round(lua_State* L, uv_udp_t* handle, uv_os_fd_t fd, int n, int i) {
+  uv_buf_t bufs[LUV_BUF_POOL];
+  struct sockaddr_storage addrs[LUV_BUF_POOL];
+  int j, got = 0, done = 0;
+  for (j = 0; j < n; j++) {
+    luv_buf_get(handle->loop, &bufs[j]);
+    if (!bufs[j].base) break;
+  }
+  n = j;
+#if defined(__linux__)
+  if (n > 0) {
+    struct uv__mmsghdr msgs[LUV_BUF_POOL];
+    struct iovec iov[LUV_BUF_POOL];
+    int ret;
+    memset(msgs, 0, n * sizeof(msgs[0]));
+    for (j = 0; j < n; j++) {
+      iov[j].iov_base = bufs[j].base;
+      iov[j].iov_len = bufs[j].len;
+      msgs[j].msg_hdr.msg_name = &addrs[j];
+      msgs[j].msg_hdr.msg_namelen = sizeof(addrs[j]);
+      msgs[j].msg_hdr.msg_iov = &iov[j];
+      msgs[j].msg_hdr.msg_iovlen = 1;
+    }
+    do {
+      ret = uv__recvmmsg(fd, msgs, n, 0, NULL);
+    } while (ret < 0 && errno == EINTR);
+    for (j = 0; j < ret; j++) {
+      luv_udp_push_dgram(L, bufs[j].base, msgs[j].msg_len, (struct sockaddr*)&addrs[j],
+                         (msgs[j].msg_hdr.msg_flags & MSG_TRUNC) != 0, i + j);
+    }
+    if (ret >= 0) got = ret;
+    done = ret >= 0 || errno != ENOSYS;
+  }
+#endif
+  // One recvfrom per datagram where recvmmsg is missing
+  for (; !done && got < n; got++) {
+    socklen_t len = sizeof(addrs[0]);
+    ssize_t nread;
+    do {
+      nread = recvfrom(fd, bufs[got].base, bufs[got].len, 0, (struct sockaddr*)&addrs[0], &len);
+    } while (nread < 0 && errno == EINTR);
+    if (nread < 0) break;
+    luv_udp_push_dgram(L, bufs[got].base, nread, (struct sockaddr*)&addrs[0], 0, i + got);
+  }
+  for (j = 0; j < n; j++) {
+    luv_buf_put(handle->loop, bufs[j].base);
+  }
+  return got;
+}
+
+/* Add up to n more queued datagrams to the list at the top of the stack,
+   starting at index i.  The socket is non-blocking, so this stops at the
+   first EAGAIN.  Rounds start small and double while they come back full,
+   but never take more blocks than the loop pool keeps: a batch reuses the
+   pool instead of allocating 64 KB per datagram.
+*/
+static void luv_udp_recv_more(lua_State* L, uv_udp_t* handle, int n, int i) {
+  uv_os_fd_t fd;
+  int round = LUV_BUF_POOL < 4 ? LUV_BUF_POOL : 4;
+  if (uv_fileno((uv_handle_t*)handle, &fd) < 0) return;
+  while (n > 0) {
+    int want = round < n ? round : n;
+    int got = luv_udp_recv_round(L, handle, fd, want, i);
+    if (got < want) break;
+    n -= got;
+    i += got;
+    round = round * 2 < LUV_BUF_POOL ? round * 2 : LUV_BUF_POOL;
+  }
+}
+
+/* With {batch = n}, the recv callback gets (err, list) with up to n
+   {data, addr} pairs: the datagram libuv read plus those already queued.
+*/
+static void luv_udp_recv_batch(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf, const struct sockaddr* addr, unsigned flags) {
+  lua_State* L = luv_state(handle->loop);
+  luv_handle_t* data = (luv_handle_t*)handle->data;
+
+  if (nread < 0) {
+    luv_buf_put(handle->loop, buf->base);
+    luv_status(L, nread);
+    luv_call_callback(L, data, LUV_RECV, 1);
+    return;
+  }
+  if (!addr) {
+    // Nothing left to read
+    luv_buf_put(handle->loop, buf->base);
+    return;
+  }
+  lua_pushnil(L);
+  lua_createtable(L, data->batch, 0);
+  luv_udp_push_dgram(L, buf->base, nread, addr, flags & UV_UDP_PARTIAL, 1);
+  luv_buf_put(handle->loop, buf->base);
+  if (data->batch > 1) {
+    luv_udp_recv_more(L, handle, data->batch - 1, 2);
+  }
+  luv_call_callback(L, data, LUV_RECV, 2);
+}
+
 static void luv_udp_recv_cb(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf, const struct sockaddr* addr, unsigned flags) {
   lua_State* L = luv_state(handle->loop);
+  luv_handle_t* data = (luv_handle_t*)handle->data;
+
+  if (data->batch) {
+    luv_udp_recv_batch(handle, nread, buf, addr, flags);
+    return;
+  }
 
   // err
   if (nread < 0) {
@@ -244,12 +447,16 @@ static void luv_udp_recv_cb(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf
     }
   }
   else if (nread > 0) {
-    lua_pushlstring(L, buf->base, nread);
+    if (data->view != LUA_NOREF) {
+      luv_push_view(L, data, buf->base, nread);
+    }
+    else {
+      lua_pushlstring(L, buf->base, nread);
+    }
   }
   else {
     lua_pushnil(L);
   }
-  if (buf) free(buf->base);
 
   // address
   if (addr) {
@@ -266,13 +473,28 @@ static void luv_udp_recv_cb(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf
     lua_setfield(L, -2, "partial");
   }
 
-  luv_call_callback(L, (luv_handle_t*)handle->data, LUV_RECV, 4);
+  luv_call_callback(L, data, LUV_RECV, 4);
+  if (buf) {
+    if (nread > 0) luv_clear_view(L, data, buf->base);
+    luv_buf_put(handle->loop, buf->base);
+  }
 }
 
 static int luv_udp_recv_start(lua_State* L) {
   uv_udp_t* handle = luv_check_udp(L, 1);
+  luv_handle_t* data = (luv_handle_t*)handle->data;
   int ret;
-  luv_check_callback(L, (luv_handle_t*)handle->data, LUV_RECV, 2);
+  luv_check_callback(L, data, LUV_RECV, 2);
+  luv_check_read_opts(L, data, 3);
+  data->batch = 0;
+  if (lua_type(L, 3) == LUA_TTABLE) {
+    lua_getfield(L, 3, "batch");
+    if (!lua_isnil(L, -1)) {
+      data->batch = luaL_checkinteger(L, -1);
+      luaL_argcheck(L, data->batch > 0 && data->batch <= LUV_UDP_BATCH, 3, "batch out of range");
+    }
+    lua_pop(L, 1);
+  }
   ret = uv_udp_recv_start(handle, luv_alloc_cb, luv_udp_recv_cb);
   if (ret < 0) return luv_error(L, ret);
   lua_pushinteger(L, ret);
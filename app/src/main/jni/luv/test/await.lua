@@ -0,0 +1,171 @@
+-- Requests without a callback in uv.await_mode(true) yield the coroutine
+local uv = require "luv"
+
+local tmp = os.tmpname()
+
+local function go(f, ...)
+	local co = coroutine.create(f)
+	assert(coroutine.resume(co, ...))
+	return co
+end
+
+do print("sync outside coroutines")
+	assert(uv.await_mode(true) == false)
+	assert(uv.await_mode() == true)
+	assert(uv.fs_stat("/").type == "directory")
+	local co = coroutine.wrap(function()
+		-- a callback keeps the request asynchronous
+		uv.fs_stat("/", function(err, st)
+			assert(not err and st.type == "directory")
+		end)
+		return "not yielded"
+	end)
+	assert(co() == "not yielded")
+	uv.run()
+end
+
+do print("fs, tcp and dns")
+	local done = false
+	go(function()
+		local err, st = uv.fs_stat("/")
+		assert(err == nil and st.type == "directory")
+		err, st = uv.fs_stat("/nonexistent/file")
+		assert(err:find("ENOENT", 1, true) and st == nil)
+		local fd
+		err, fd = uv.fs_open(tmp, "w", 420)
+		assert(not err, err)
+		assert(select(2, uv.fs_write(fd, "awaited", 0)) == 7)
+		uv.fs_close(fd)
+		err, fd = uv.fs_open(tmp, "r", 420)
+		assert(not err, err)
+		assert(select(2, uv.fs_read(fd, 100, 0)) == "awaited")
+		uv.fs_close(fd)
+		for _ = 1, 1000 do
+			assert(select(2, uv.fs_stat(tmp)).size == 7)
+		end
+
+		local server = uv.new_tcp()
+		assert(server:bind("127.0.0.1", 0))
+		local port = server:getsockname().port
+		local got = {}
+		server:listen(8, function()
+			local c = uv.new_tcp()
+			server:accept(c)
+			c:read_start(function(e, d)
+				assert(not e, e)
+				if d then got[#got + 1] = d else c:close() end
+			end)
+		end)
+		local client = uv.new_tcp()
+		assert(client:connect("127.0.0.1", port) == nil)
+		assert(client:write("hello ") == nil)
+		assert(client:write({ "wor", "ld" }) == nil)
+		assert(client:shutdown() == nil)
+		client:close()
+		server:close()
+
+		local res
+		err, res = uv.getaddrinfo("127.0.0.1", nil, { family = "inet" })
+		assert(not err and res[1].addr == "127.0.0.1")
+		done = got
+	end)
+	uv.run()
+	assert(table.concat(done) == "hello world")
+end
+
+do print("completions only resume their own waiter")
+	local log = {}
+	local co = go(function()
+		local r = table.pack(uv.fs_stat("/"))
+		-- resumed by hand before the stat completed
+		assert(r.n == 1 and r[1] == "by hand")
+		local x = coroutine.yield("waiting")
+		-- the stale stat completion did not resume us
+		assert(x == "second")
+		local err, st = uv.fs_stat("/")
+		assert(not err and st.type == "directory")
+		log.done = true
+	end)
+	assert(coroutine.status(co) == "suspended")
+	local ok, v = coroutine.resume(co, "by hand")
+	assert(ok and v == "waiting")
+	uv.run()
+	assert(coroutine.status(co) == "suspended" and not log.done)
+	assert(coroutine.resume(co, "second"))
+	uv.run()
+	assert(coroutine.status(co) == "dead" and log.done)
+
+	-- a completion for a closed coroutine is dropped
+	co = go(function()
+		uv.fs_stat("/")
+		error("not reached")
+	end)
+	assert(coroutine.close(co))
+	uv.run()
+
+	-- a completion after the coroutine died is dropped
+	co = go(function()
+		return uv.fs_stat("/")
+	end)
+	assert(coroutine.resume(co))
+	assert(coroutine.status(co) == "dead")
+	uv.run()
+
+	-- many waiters, each gets its own result
+	local results = {}
+	for i = 1, 50 do
+		go(function()
+			local path = (i % 2 == 0) and "/" or "/nonexistent" .. i
+			local err, st = uv.fs_stat(path)
+			results[i] = st and st.type or err
+		end)
+	end
+	uv.run()
+	for i = 1, 50 do
+		if i % 2 == 0 then
+			assert(results[i] == "directory")
+		else
+			assert(results[i]:find("/nonexistent" .. i, 1, true))
+		end
+	end
+end
+
+do print("errors propagate out of uv.run")
+	go(function()
+		uv.fs_stat("/")
+		error("boom")
+	end)
+	local ok, err = pcall(uv.run)
+	assert(not ok and err:find("boom", 1, true))
+	assert(err:find("traceback", 1, true))
+
+	local obj = {}
+	go(function()
+		uv.fs_stat("/")
+		error(obj)
+	end)
+	ok, err = pcall(uv.run)
+	assert(not ok and err == obj)
+
+	-- the loop is usable afterwards
+	local done
+	go(function()
+		local e, st = uv.fs_stat("/")
+		done = st.type
+	end)
+	uv.run()
+	assert(done == "directory")
+end
+
+assert(uv.await_mode(false) == true)
+do print("await mode off")
+	local r
+	local co = coroutine.wrap(function()
+		r = uv.fs_stat("/").type
+		return "returned"
+	end)
+	assert(co() == "returned" and r == "directory")
+end
+
+os.remove(tmp)
+print("OK")
@@ -0,0 +1,172 @@
+-- Reads delivered in a string.buffer ({buffer = true}) from the block pool
+local uv = require "luv"
+
+local function isbuffer(v)
+	local mt = getmetatable(v)
+	return type(v) == "userdata" and mt ~= nil and mt.__name == "string.buffer"
+end
+
+local function after(ms, f)
+	local t = uv.new_timer()
+	t:start(ms, 0, function()
+		t:close()
+		f()
+	end)
+end
+
+local function tcppair(onaccept)
+	local server = uv.new_tcp()
+	assert(server:bind("127.0.0.1", 0))
+	local port = server:getsockname().port
+	server:listen(8, function(err)
+		assert(not err, err)
+		local c = uv.new_tcp()
+		server:accept(c)
+		server:close()
+		onaccept(c)
+	end)
+	local client = uv.new_tcp()
+	return client, port
+end
+
+do print("stream reads")
+	local payload = string.rep("0123456789abcdef", 4096)  -- more than one block
+	local N = 50
+	for _, mode in ipairs{ false, true } do
+		local chunks, got, seen = {}, 0, {}
+		local kept
+		local client, port = tcppair(function(c)
+			c:read_start(function(err, data)
+				assert(not err, err)
+				if data == nil then
+					c:close()
+					return
+				end
+				if mode then
+					assert(isbuffer(data))
+					assert(#data > 0 and #data <= 65536)
+					seen[data] = true
+					kept = data
+				else
+					assert(type(data) == "string")
+				end
+				got = got + #data
+				chunks[#chunks + 1] = tostring(data)
+			end, mode and { buffer = true } or nil)
+		end)
+		client:connect("127.0.0.1", port, function(err)
+			assert(not err, err)
+			for _ = 1, N do client:write(payload) end
+			client:shutdown(function() client:close() end)
+		end)
+		uv.run()
+		assert(got == #payload * N)
+		assert(table.concat(chunks) == string.rep(payload, N))
+		if mode then
+			-- one buffer is reused for every read and emptied after the callback
+			assert(next(seen) == kept and next(seen, kept) == nil)
+			assert(#kept == 0 and kept:tostring() == "")
+		end
+	end
+end
+
+do print("callback owns a buffer it writes into")
+	local bufs, texts = {}, {}
+	local client, port = tcppair(function(c)
+		c:read_start(function(err, data)
+			assert(not err, err)
+			if data == nil then
+				c:close()
+				return
+			end
+			bufs[#bufs + 1] = data
+			if #bufs == 1 then
+				data:put("!")  -- copies the data out of the read block
+			elseif #bufs == 2 then
+				data:get(1)  -- consuming in place keeps it a view
+			end
+			texts[#texts + 1] = tostring(data)
+		end, { buffer = true })
+	end)
+	client:connect("127.0.0.1", port, function(err)
+		assert(not err, err)
+		client:write("one", function()
+			after(20, function()
+				client:write("two", function()
+					after(20, function()
+						client:write("three")
+						client:shutdown(function() client:close() end)
+					end)
+				end)
+			end)
+		end)
+	end)
+	uv.run()
+	assert(#bufs == 3, #bufs)
+	assert(texts[1] == "one!" and texts[2] == "wo" and texts[3] == "three")
+	assert(bufs[1]:tostring() == "one!")  -- still valid, it is not a view
+	assert(bufs[2] ~= bufs[1] and bufs[3] == bufs[2])
+	assert(#bufs[3] == 0)
+end
+
+do print("back to strings")
+	local got = {}
+	local client, port = tcppair(function(c)
+		c:read_start(function(err, data)
+			assert(not err, err)
+			if data == nil then c:close() return end
+			got[#got + 1] = data
+			c:read_stop()
+			c:read_start(function(err2, data2)
+				assert(not err2, err2)
+				if data2 == nil then c:close() return end
+				got[#got + 1] = data2
+			end)
+		end, { buffer = true })
+	end)
+	client:connect("127.0.0.1", port, function(err)
+		assert(not err, err)
+		client:write("a", function()
+			after(20, function()
+				client:write("b")
+				client:shutdown(function() client:close() end)
+			end)
+		end)
+	end)
+	uv.run()
+	assert(isbuffer(got[1]) and got[2] == "b")
+end
+
+do print("udp reads")
+	local server = uv.new_udp()
+	assert(server:bind("127.0.0.1", 0))
+	local port = server:getsockname().port
+	local client = uv.new_udp()
+	local N = 100
+	local texts, buf = {}, nil
+	server:recv_start(function(err, data, addr)
+		assert(not err, err)
+		if data == nil then return end
+		assert(isbuffer(data) and addr.ip == "127.0.0.1")
+		assert(buf == nil or buf == data)
+		buf = data
+		texts[#texts + 1] = data:tostring()
+		if #texts == N then
+			server:close()
+			client:close()
+		end
+	end, { buffer = true })
+	local i = 0
+	local function sendnext()
+		i = i + 1
+		if i <= N then
+			client:send("dgram" .. i, "127.0.0.1", port, sendnext)
+		end
+	end
+	sendnext()
+	uv.run()
+	for k = 1, N do assert(texts[k] == "dgram" .. k) end
+	assert(#buf == 0)
+end
+
+print("OK")
@@ -0,0 +1,172 @@
+-- The io_uring fs engine (uv.fs_engine("io_uring"))
+local uv = require "luv"
+
+local engine, err = uv.fs_engine("io_uring")
+if engine ~= "io_uring" then
+	print("io_uring not available: " .. tostring(err))
+	assert(uv.fs_engine() == "threadpool")
+	return
+end
+
+local dir = os.tmpname()
+os.remove(dir)
+assert(uv.fs_mkdir(dir, 448))
+local content = string.rep("0123456789", 10000)  -- more than a registered block
+local file = dir .. "/data"
+local f = assert(io.open(file, "wb"))
+f:write(content)
+f:close()
+
+local function same(a, b)
+	for k, v in pairs(a) do
+		if type(v) == "table" then
+			for k2, v2 in pairs(v) do assert(b[k][k2] == v2, k .. "." .. k2) end
+		else
+			assert(b[k] == v, k)
+		end
+	end
+end
+
+do print("results match the threadpool")
+	local done = 0
+	uv.fs_stat(file, function(e, st)
+		assert(not e, e)
+		same(uv.fs_stat(file), st)
+		done = done + 1
+	end)
+	uv.fs_lstat(dir, function(e, st)
+		assert(not e and st.type == "directory")
+		done = done + 1
+	end)
+	uv.fs_stat(dir .. "/missing", function(e, st)
+		assert(e == "ENOENT: no such file or directory: " .. dir .. "/missing", e)
+		assert(st == nil)
+		done = done + 1
+	end)
+	uv.fs_close(99999, function(e)
+		assert(e:find("EBADF", 1, true), e)
+		done = done + 1
+	end)
+	uv.fs_open(file, "r", 0, function(e, fd)
+		assert(not e, e)
+		uv.fs_fstat(fd, function(e2, st)
+			assert(not e2, e2)
+			same(uv.fs_fstat(fd), st)
+			uv.fs_read(fd, 1000, 5, function(e3, data)
+				-- small reads use a registered block
+				assert(not e3 and data == content:sub(6, 1005))
+				uv.fs_read(fd, #content + 10, 0, function(e4, data2)
+					assert(not e4 and data2 == content)
+					uv.fs_close(fd, function(e5, ok)
+						assert(not e5 and ok)
+						done = done + 1
+					end)
+				end)
+			end)
+		end)
+	end)
+	local out = dir .. "/out"
+	uv.fs_open(out, "w", 420, function(e, fd)
+		assert(not e, e)
+		uv.fs_write(fd, { "hello ", "world" }, 0, function(e2, n)
+			assert(not e2 and n == 11)
+			uv.fs_write(fd, "!", 11, function(e3, n2)
+				assert(not e3 and n2 == 1)
+				uv.fs_fsync(fd, function(e4)
+					assert(not e4, e4)
+					uv.fs_fdatasync(fd, function(e5)
+						assert(not e5, e5)
+						uv.fs_close(fd, function()
+							local o = assert(io.open(out))
+							assert(o:read("a") == "hello world!")
+							o:close()
+							done = done + 1
+						end)
+					end)
+				end)
+			end)
+		end)
+	end)
+	uv.run()
+	assert(done == 6, done)
+	os.remove(out)
+end
+
+do print("many requests in flight")
+	local n = 0
+	for _ = 1, 1000 do
+		uv.fs_stat(file, function(e, st)
+			assert(not e and st.size == #content)
+			n = n + 1
+		end)
+	end
+	uv.run()
+	assert(n == 1000)
+end
+
+do print("await")
+	uv.await_mode(true)
+	local ok
+	coroutine.wrap(function()
+		local e, fd = uv.fs_open(file, "r", 0)
+		assert(not e, e)
+		local _, st = uv.fs_fstat(fd)
+		local _, data = uv.fs_read(fd, st.size, 0)
+		assert(data == content)
+		uv.fs_close(fd)
+		e = uv.fs_stat(dir .. "/missing")
+		ok = e:find("ENOENT", 1, true) ~= nil
+	end)()
+	uv.run()
+	uv.await_mode(false)
+	assert(ok)
+end
+
+do print("closing the loop cancels requests in flight")
+	-- A child interpreter queues requests and exits without running the loop
+	local script = dir .. "/child.lua"
+	local c = assert(io.open(script, "w"))
+	c:write(string.format([[
+		local uv = require "luv"
+		assert(uv.fs_engine("io_uring") == "io_uring")
+		for i = 1, 50 do
+			uv.fs_stat(%q, function(err, st)
+				print("callback", err and err:match("^%%u+"), st)
+			end)
+		end
+		uv.fs_open(%q, "r", 0, function(err, fd)
+			print("open", err and err:match("^%%u+"), fd)
+			-- made while closing: goes to the threadpool and completes
+			uv.fs_stat(%q, function(err2, st)
+				print("after", err2, st and st.type)
+			end)
+		end)
+		uv.await_mode(true)
+		for i = 1, 20 do
+			coroutine.wrap(function()
+				local err, st = uv.fs_stat(%q)
+				print("await", err and err:match("^%%u+"), st)
+			end)()
+		end
+	]], file, file, dir, file))
+	c:close()
+	local cmd = string.format("%q %q 2>&1", arg[-1], script)
+	local p = assert(io.popen(cmd))
+	local out = p:read("a")
+	p:close()
+	local counts = {}
+	for line in out:gmatch("[^\n]+") do
+		counts[line] = (counts[line] or 0) + 1
+	end
+	assert(counts["callback\tECANCELED\tnil"] == 50, out)
+	assert(counts["open\tECANCELED\tnil"] == 1, out)
+	assert(counts["after\tnil\tdirectory"] == 1, out)
+	assert(counts["await\tECANCELED\tnil"] == 20, out)
+end
+
+assert(uv.fs_engine("threadpool") == "threadpool")
+assert(uv.fs_stat(file).size == #content)
+os.remove(file)
+os.remove(dir .. "/child.lua")
+assert(uv.fs_rmdir(dir))
+print("OK")
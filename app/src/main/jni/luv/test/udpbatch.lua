@@ -0,0 +1,134 @@
+-- udp:recv_start(cb, {batch = n}) and udp:send_batch(list)
+local uv = require "luv"
+
+local function pair()
+	local r = uv.new_udp()
+	assert(r:bind("127.0.0.1", 0))
+	local s = uv.new_udp()
+	assert(s:bind("127.0.0.1", 0))
+	return r, s, r:getsockname().port, s:getsockname().port
+end
+
+do print("batched receive")
+	local r, s, port, sport = pair()
+	local N = 2000
+	local got, calls, most, sent = {}, 0, 0, 0
+	-- queue 64 datagrams at a time, the next ones once all have arrived
+	local function sendsome()
+		local list = {}
+		for i = 1, 64 do list[i] = { "d" .. (sent + i), "127.0.0.1", port } end
+		assert(s:send_batch(list) == 64)
+		sent = sent + 64
+	end
+	r:recv_start(function(err, list)
+		assert(not err, err)
+		calls = calls + 1
+		assert(type(list) == "table" and #list >= 1 and #list <= 64)
+		most = math.max(most, #list)
+		for _, d in ipairs(list) do
+			assert(type(d[1]) == "string")
+			assert(d[2].ip == "127.0.0.1" and d[2].port == sport)
+			assert(d.partial == nil)
+			got[#got + 1] = d[1]
+		end
+		if #got >= N then
+			r:close()
+			s:close()
+		elseif #got == sent then
+			sendsome()
+		end
+	end, { batch = 64 })
+	sendsome()
+	uv.run()
+	assert(#got >= N)
+	for i = 1, #got do assert(got[i] == "d" .. i) end
+	assert(calls < N / 4 and most > 20, most)
+end
+
+do print("large datagrams")
+	local r, s, port = pair()
+	r:recv_buffer_size(4 * 1024 * 1024)
+	local N, size = 200, 30000
+	local got, sent, most = {}, 0, 0
+	local function sendsome()
+		local list = {}
+		for i = 1, 20 do
+			list[i] = { string.rep(string.char(32 + (sent + i) % 90), size), "127.0.0.1", port }
+		end
+		assert(s:send_batch(list) == 20)
+		sent = sent + 20
+	end
+	r:recv_start(function(err, list)
+		assert(not err, err)
+		most = math.max(most, #list)
+		for _, d in ipairs(list) do got[#got + 1] = d[1] end
+		if #got >= N then
+			r:close()
+			s:close()
+		elseif #got == sent then
+			sendsome()
+		end
+	end, { batch = 64 })
+	sendsome()
+	uv.run()
+	assert(#got == N)
+	for i = 1, N do assert(got[i] == string.rep(string.char(32 + i % 90), size), i) end
+	assert(most > 16, most)  -- takes several rounds of pool blocks
+end
+
+do print("batch of one")
+	local r, s, port = pair()
+	local lists = 0
+	r:recv_start(function(err, list)
+		assert(not err, err)
+		assert(#list == 1)
+		lists = lists + 1
+		if lists == 5 then
+			r:close()
+			s:close()
+		end
+	end, { batch = 1 })
+	local list = {}
+	for i = 1, 5 do list[i] = { "x", "127.0.0.1", port } end
+	assert(s:send_batch(list) == 5)
+	uv.run()
+	assert(lists == 5)
+end
+
+do print("send_batch")
+	local r, s, port = pair()
+	local got = {}
+	r:recv_start(function(err, data)
+		assert(not err, err)
+		if data then got[#got + 1] = data end
+		if #got == 64 then
+			r:close()
+			s:close()
+		end
+	end)
+	assert(s:send_batch{} == 0)
+	local list = {}
+	for i = 1, 64 do
+		-- numbers are sent as strings only the stack refers to
+		list[i] = { i * 1000, "127.0.0.1", port }
+	end
+	collectgarbage()
+	assert(s:send_batch(list) == 64)
+	uv.run()
+	for i = 1, 64 do assert(got[i] == tostring(i * 1000)) end
+
+	s = uv.new_udp()
+	list[65] = { "x", "127.0.0.1", port }
+	assert(not pcall(s.send_batch, s, list))
+	assert(not pcall(s.send_batch, s, { "x" }))
+	assert(not pcall(s.send_batch, s, { { {}, "127.0.0.1", port } }))
+	assert(not pcall(s.send_batch, s, { { "x", "not an ip", port } }))
+	s:close()
+	s = uv.new_udp()
+	assert(not pcall(s.recv_start, s, print, { batch = 0 }))
+	assert(not pcall(s.recv_start, s, print, { batch = 65 }))
+	s:close()
+	uv.run()
+end
+
+print("OK")
@@ -4,7 +4,8 @@ include $(CLEAR_VARS)
 
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/../lua
 LOCAL_MODULE     := network
-LOCAL_SRC_FILES  := network.c
+LOCAL_SRC_FILES  := network.c \
+                    network_batch.c
 LOCAL_STATIC_LIBRARIES := lua
 LOCAL_LDLIBS    := -lz -lm
 
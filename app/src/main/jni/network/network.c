@@ -565,21 +565,14 @@ int network_get_weights(lua_State* L, Network* network) {
         lua_pushstring(L, "weights");
         lua_createtable(L, layer->output_size, 0);
         for (int j = 0; j < layer->output_size; j++) {
-            lua_createtable(L, layer->input_size, 0);
-            for (int k = 0; k < layer->input_size; k++) {
-                lua_pushnumber(L, layer->weights[j * layer->input_size + k]);
-                lua_seti(L, -2, k + 1);
-            }
+            lua_createarrayn(L, layer->weights + (size_t)j * layer->input_size,
+                             (size_t)layer->input_size);
             lua_seti(L, -2, j + 1);
         }
         lua_settable(L, -3);
         
         lua_pushstring(L, "biases");
-        lua_createtable(L, layer->output_size, 0);
-        for (int j = 0; j < layer->output_size; j++) {
-            lua_pushnumber(L, layer->biases[j]);
-            lua_seti(L, -2, j + 1);
-        }
+        lua_createarrayn(L, layer->biases, (size_t)layer->output_size);
         lua_settable(L, -3);
         
         lua_seti(L, -2, i + 1);
@@ -588,6 +581,19 @@ int network_get_weights(lua_State* L, Network* network) {
     return 1;
 }
 
+/**
+ * @brief 把表的前n个数字批量读入dst，非数字元素按0处理
+ */
+static void read_numbers(lua_State* L, int idx, double* dst, int n) {
+    idx = lua_absindex(L, idx);
+    int k = (int)lua_toarrayn(L, idx, dst, (size_t)n);
+    for (; k < n; k++) {
+        lua_geti(L, idx, k + 1);
+        dst[k] = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+    }
+}
+
 /**
  * @brief 设置网络权重
  */
@@ -615,11 +621,8 @@ int network_set_weights(Network* network, lua_State* L, int idx) {
             for (int j = 0; j < layer->output_size; j++) {
                 lua_geti(L, -1, j + 1);
                 if (lua_istable(L, -1)) {
-                    for (int k = 0; k < layer->input_size; k++) {
-                        lua_geti(L, -1, k + 1);
-                        layer->weights[j * layer->input_size + k] = lua_tonumber(L, -1);
-                        lua_pop(L, 1);
-                    }
+                    read_numbers(L, -1, layer->weights + (size_t)j * layer->input_size,
+                                 layer->input_size);
                 }
                 lua_pop(L, 1);
             }
@@ -628,11 +631,7 @@ int network_set_weights(Network* network, lua_State* L, int idx) {
         
         lua_getfield(L, -1, "biases");
         if (lua_istable(L, -1)) {
-            for (int j = 0; j < layer->output_size; j++) {
-                lua_geti(L, -1, j + 1);
-                layer->biases[j] = lua_tonumber(L, -1);
-                lua_pop(L, 1);
-            }
+            read_numbers(L, -1, layer->biases, layer->output_size);
         }
         lua_pop(L, 1);
         
@@ -725,11 +724,7 @@ int network_predict(lua_State* L, Network* network, double* input) {
     
     network_forward(network, input, outputs);
     
-    lua_createtable(L, network->output_size, 0);
-    for (int i = 0; i < network->output_size; i++) {
-        lua_pushnumber(L, outputs[i]);
-        lua_seti(L, -2, i + 1);
-    }
+    lua_createarrayn(L, outputs, (size_t)network->output_size);
     
     return 1;
 }
@@ -761,19 +756,11 @@ Dataset* dataset_create(lua_State* L, int input_size, int output_size) {
         
         lua_geti(L, 1, i + 1);
         lua_getfield(L, -1, "input");
-        for (int j = 0; j < input_size; j++) {
-            lua_geti(L, -1, j + 1);
-            dataset->pairs[i].input[j] = lua_tonumber(L, -1);
-            lua_pop(L, 1);
-        }
+        read_numbers(L, -1, dataset->pairs[i].input, input_size);
         lua_pop(L, 1);
         
         lua_getfield(L, -1, "target");
-        for (int j = 0; j < output_size; j++) {
-            lua_geti(L, -1, j + 1);
-            dataset->pairs[i].target[j] = lua_tonumber(L, -1);
-            lua_pop(L, 1);
-        }
+        read_numbers(L, -1, dataset->pairs[i].target, output_size);
         lua_pop(L, 1);
         
         lua_pop(L, 1);
@@ -887,20 +874,12 @@ static int l_network_forward(lua_State* L) {
     }
     
     double input[NETWORK_MAX_NEURONS];
-    for (int i = 0; i < network->input_size; i++) {
-        lua_geti(L, 2, i + 1);
-        input[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-    }
+    read_numbers(L, 2, input, network->input_size);
     
     double output[NETWORK_MAX_NEURONS];
     network_forward(network, input, output);
     
-    lua_createtable(L, network->output_size, 0);
-    for (int i = 0; i < network->output_size; i++) {
-        lua_pushnumber(L, output[i]);
-        lua_seti(L, -2, i + 1);
-    }
+    lua_createarrayn(L, output, (size_t)network->output_size);
     
     return 1;
 }
@@ -916,17 +895,82 @@ static int l_network_predict(lua_State* L) {
     }
     
     double input[NETWORK_MAX_NEURONS];
-    for (int i = 0; i < network->input_size; i++) {
-        lua_geti(L, 2, i + 1);
-        input[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-    }
+    read_numbers(L, 2, input, network->input_size);
     
     return network_predict(L, network, input);
 }
 
 /**
- * @brief network:train(dataset, epochs, mini_batch_size) - 训练网络
+ * @brief 从选项表读取批量训练参数
+ */
+static void read_train_options(lua_State* L, int idx, NetworkTrainOptions* opts) {
+    lua_getfield(L, idx, "optimizer");
+    if (!lua_isnil(L, -1)) {
+        const char* name = luaL_checkstring(L, -1);
+        if (strcmp(name, "adam") == 0) {
+            opts->optimizer = OPTIMIZER_ADAM;
+        } else if (strcmp(name, "sgd") == 0) {
+            opts->optimizer = OPTIMIZER_SGD;
+        } else {
+            luaL_error(L, "unknown optimizer '%s'", name);
+        }
+    }
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "precision");
+    if (!lua_isnil(L, -1)) {
+        const char* name = luaL_checkstring(L, -1);
+        if (strcmp(name, "float32") == 0) {
+            opts->use_float32 = 1;
+        } else if (strcmp(name, "float64") == 0) {
+            opts->use_float32 = 0;
+        } else {
+            luaL_error(L, "unknown precision '%s'", name);
+        }
+    }
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "shuffle");
+    if (!lua_isnil(L, -1)) opts->shuffle = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "threads");
+    if (!lua_isnil(L, -1)) opts->threads = (int)luaL_checkinteger(L, -1);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "seed");
+    if (!lua_isnil(L, -1)) opts->seed = (uint64_t)luaL_checkinteger(L, -1);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "learning_rate");
+    if (!lua_isnil(L, -1)) opts->learning_rate = luaL_checknumber(L, -1);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "momentum");
+    if (!lua_isnil(L, -1)) opts->momentum = luaL_checknumber(L, -1);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "weight_decay");
+    if (!lua_isnil(L, -1)) opts->weight_decay = luaL_checknumber(L, -1);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "beta1");
+    if (!lua_isnil(L, -1)) opts->beta1 = luaL_checknumber(L, -1);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "beta2");
+    if (!lua_isnil(L, -1)) opts->beta2 = luaL_checknumber(L, -1);
+    lua_pop(L, 1);
+    
+    lua_getfield(L, idx, "epsilon");
+    if (!lua_isnil(L, -1)) opts->epsilon = luaL_checknumber(L, -1);
+    lua_pop(L, 1);
+}
+
+/**
+ * @brief network:train(dataset, epochs[, mini_batch_size[, options]]) - 训练网络
+ * 只有给出options表时才走小批量路径（batch_size取mini_batch_size），
+ * 否则与之前一样逐样本训练
  */
 static int l_network_train(lua_State* L) {
     Network* network = luaL_check_network(L, 1);
@@ -937,6 +981,14 @@ static int l_network_train(lua_State* L) {
     
     int epochs = (int)luaL_optinteger(L, 3, 100);
     int mini_batch_size = (int)luaL_optinteger(L, 4, 1);
+    int batched = lua_istable(L, 5);
+    NetworkTrainOptions opts;
+    
+    if (batched) {
+        network_train_options_init(network, &opts);
+        opts.batch_size = mini_batch_size;
+        read_train_options(L, 5, &opts);
+    }
     
     lua_pushvalue(L, 1);
     lua_pushvalue(L, 2);
@@ -953,10 +1005,16 @@ static int l_network_train(lua_State* L) {
         return luaL_error(L, "failed to create dataset");
     }
     
-    double loss = network_train(network, dataset, epochs, mini_batch_size);
+    double loss = batched
+        ? network_train_batched(network, dataset, epochs, &opts)
+        : network_train(network, dataset, epochs, mini_batch_size);
     
     dataset_free(dataset);
     
+    if (loss < 0.0) {
+        return luaL_error(L, "training failed (out of memory or size mismatch)");
+    }
+    
     lua_pushnumber(L, loss);
     return 1;
 }
@@ -974,17 +1032,9 @@ static int l_network_train_step(lua_State* L) {
     double input[NETWORK_MAX_NEURONS];
     double target[NETWORK_MAX_NEURONS];
     
-    for (int i = 0; i < network->input_size; i++) {
-        lua_geti(L, 2, i + 1);
-        input[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-    }
+    read_numbers(L, 2, input, network->input_size);
     
-    for (int i = 0; i < network->output_size; i++) {
-        lua_geti(L, 3, i + 1);
-        target[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-    }
+    read_numbers(L, 3, target, network->output_size);
     
     double loss = network_train_step(network, input, target);
     
@@ -1101,11 +1151,8 @@ static int l_network_weights(lua_State* L) {
     
     lua_createtable(L, layer->output_size, 0);
     for (int i = 0; i < layer->output_size; i++) {
-        lua_createtable(L, layer->input_size, 0);
-        for (int j = 0; j < layer->input_size; j++) {
-            lua_pushnumber(L, layer->weights[i * layer->input_size + j]);
-            lua_seti(L, -2, j + 1);
-        }
+        lua_createarrayn(L, layer->weights + (size_t)i * layer->input_size,
+                         (size_t)layer->input_size);
         lua_seti(L, -2, i + 1);
     }
     
@@ -1327,12 +1374,13 @@ static int l_network_help(lua_State* L) {
         luaL_addstring(&b, "  示例:\n");
         luaL_addstring(&b, "    local result = net:predict({1.0, 2.0})\n\n");
         
-        luaL_addstring(&b, "[network:train(dataset, epochs, batch_size)]\n");
+        luaL_addstring(&b, "[network:train(dataset, epochs, batch_size, options)]\n");
         luaL_addstring(&b, "  功能: 训练网络\n");
         luaL_addstring(&b, "  参数:\n");
         luaL_addstring(&b, "    - dataset: 训练数据表\n");
         luaL_addstring(&b, "    - epochs: 训练轮数（默认100）\n");
         luaL_addstring(&b, "    - batch_size: 批量大小（默认1）\n");
+        luaL_addstring(&b, "    - options: 可选，小批量训练选项\n");
         luaL_addstring(&b, "  返回: 平均损失\n");
         luaL_addstring(&b, "  示例:\n");
         luaL_addstring(&b, "    local loss = net:train(data, 1000)\n\n");
@@ -1405,9 +1453,16 @@ static int l_network_help(lua_State* L) {
             luaL_addstring(&b, "参数说明:\n");
             luaL_addstring(&b, "  - dataset: 训练数据，每个元素是 {input={...}, target={...}} 格式\n");
             luaL_addstring(&b, "  - epochs: 训练轮数\n");
-            luaL_addstring(&b, "  - batch_size: 可选，小批量大小\n\n");
+            luaL_addstring(&b, "  - batch_size: 可选，小批量大小；大于1时按矩阵批量计算\n");
+            luaL_addstring(&b, "  - options: 可选，小批量训练选项表:\n");
+            luaL_addstring(&b, "      optimizer = \"sgd\" | \"adam\"（默认sgd）\n");
+            luaL_addstring(&b, "      precision = \"float64\" | \"float32\"（默认float64）\n");
+            luaL_addstring(&b, "      threads = 线程数（默认CPU核数）\n");
+            luaL_addstring(&b, "      shuffle = 每轮是否打乱（默认true）\n");
+            luaL_addstring(&b, "      seed = 打乱顺序的随机种子（默认取当前时间）\n");
+            luaL_addstring(&b, "      learning_rate, momentum, weight_decay, beta1, beta2, epsilon\n\n");
             luaL_addstring(&b, "返回值:\n");
-            luaL_addstring(&b, "  平均损失值\n\n");
+            luaL_addstring(&b, "  平均损失值（小批量训练时为最后一轮的平均损失）\n\n");
             luaL_addstring(&b, "使用示例:\n");
             luaL_addstring(&b, "  local data = {\n");
             luaL_addstring(&b, "      {input={0, 0}, target={0}},\n");
@@ -33,6 +33,32 @@ typedef enum {
     ACTIVATION_SOFTMAX
 } ActivationType;
 
+/**
+ * @brief 批量训练优化器类型
+ */
+typedef enum {
+    OPTIMIZER_SGD = 0,        // SGD（可带动量）
+    OPTIMIZER_ADAM
+} OptimizerType;
+
+/**
+ * @brief 批量训练选项
+ */
+typedef struct {
+    int batch_size;           // 小批量大小
+    int threads;              // 工作线程数（含调用线程）
+    int shuffle;              // 每轮是否打乱样本顺序
+    int use_float32;          // 是否以float32精度计算
+    OptimizerType optimizer;  // 优化器
+    double learning_rate;     // 学习率
+    double momentum;          // SGD动量
+    double weight_decay;      // L2权重衰减
+    double beta1;             // Adam一阶矩衰减
+    double beta2;             // Adam二阶矩衰减
+    double epsilon;           // Adam数值稳定项
+    uint64_t seed;            // 打乱顺序用的随机种子
+} NetworkTrainOptions;
+
 /**
  * @brief 激活函数信息
  */
@@ -200,6 +226,24 @@ double network_train_step(Network* network, double* input, double* target);
  */
 double network_train(Network* network, Dataset* dataset, int epochs, int mini_batch_size);
 
+/**
+ * @brief 网络训练（小批量，矩阵运算并按线程划分批次）
+ * @param network 网络指针
+ * @param dataset 数据集
+ * @param epochs 训练轮数
+ * @param opts 训练选项
+ * @return 所有轮次的平均损失（与network_train相同），内存不足时返回负数
+ */
+double network_train_batched(Network* network, Dataset* dataset, int epochs,
+                             const NetworkTrainOptions* opts);
+
+/**
+ * @brief 填充默认的批量训练选项
+ * @param network 网络指针
+ * @param opts 训练选项
+ */
+void network_train_options_init(Network* network, NetworkTrainOptions* opts);
+
 /**
  * @brief 网络预测
  * @param network 网络指针
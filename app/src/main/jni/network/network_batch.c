@@ -0,0 +1,220 @@
+/**
+ * @file network_batch.c
+ * @brief 小批量训练实现
+ *
+ * 每个批次作为矩阵整体做前向/反向传播，批次按行划分给线程池，
+ * 各线程累积自己的梯度，再按参数区间并行归约并由优化器更新。
+ * 计算核心在network_batch_impl.h中按double/float各实例化一次。
+ */
+
+#include "network.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+#define NETWORK_MAX_THREADS 16
+
+typedef struct BatchPool BatchPool;
+
+typedef struct {
+    BatchPool* pool;
+    int tid;
+} BatchWorker;
+
+/**
+ * @brief 简单线程池：所有线程同步执行同一个任务函数
+ */
+struct BatchPool {
+    pthread_t threads[NETWORK_MAX_THREADS];
+    BatchWorker workers[NETWORK_MAX_THREADS];
+    int count;                 // 线程总数（含调用线程）
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned int generation;   // 每派发一次任务加一
+    int pending;               // 尚未完成的工作线程数
+    int stop;
+    void (*task)(void* arg, int tid, int nthreads);
+    void* arg;
+};
+
+static void* batch_pool_main(void* p) {
+    BatchWorker* worker = (BatchWorker*)p;
+    BatchPool* pool = worker->pool;
+    unsigned int seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->stop) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->task(pool->arg, worker->tid, pool->count);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/**
+ * @brief 启动线程池，返回实际可用的线程数
+ */
+static int batch_pool_start(BatchPool* pool, int count) {
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->count = 1;
+    for (int i = 1; i < count; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].tid = i;
+        if (pthread_create(&pool->threads[i], NULL, batch_pool_main, &pool->workers[i]) != 0) {
+            break;
+        }
+        pool->count++;
+    }
+    return pool->count;
+}
+
+/**
+ * @brief 在所有线程上执行task并等待完成，调用线程承担0号分片
+ */
+static void batch_pool_run(BatchPool* pool, void (*task)(void*, int, int), void* arg) {
+    if (pool->count > 1) {
+        pthread_mutex_lock(&pool->lock);
+        pool->task = task;
+        pool->arg = arg;
+        pool->pending = pool->count - 1;
+        pool->generation++;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    task(arg, 0, pool->count);
+    if (pool->count > 1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending > 0) {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void batch_pool_stop(BatchPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+}
+
+/**
+ * @brief 把[0, n)均分为nthreads段，返回第tid段
+ */
+static void batch_split(int n, int tid, int nthreads, int* begin, int* end) {
+    int chunk = n / nthreads;
+    int extra = n % nthreads;
+    *begin = tid * chunk + (tid < extra ? tid : extra);
+    *end = *begin + chunk + (tid < extra ? 1 : 0);
+}
+
+/**
+ * @brief splitmix64，训练自带的随机数状态，不影响全局rand()
+ */
+static uint64_t batch_rand(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief 生成样本顺序，shuffle时使用Fisher-Yates打乱
+ */
+static void batch_shuffle(int* order, int count, int shuffle, uint64_t* rng) {
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    if (!shuffle) return;
+    for (int i = count - 1; i > 0; i--) {
+        int j = (int)((double)(batch_rand(rng) >> 11) * 0x1.0p-53 * (i + 1));
+        int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+}
+
+#define REAL double
+#define SUFFIX _f64
+#include "network_batch_impl.h"
+#undef REAL
+#undef SUFFIX
+
+#define REAL float
+#define SUFFIX _f32
+#include "network_batch_impl.h"
+#undef REAL
+#undef SUFFIX
+
+/**
+ * @brief 填充默认的批量训练选项
+ */
+void network_train_options_init(Network* network, NetworkTrainOptions* opts) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    opts->batch_size = 32;
+    opts->threads = ncpu > 0 ? (int)ncpu : 1;
+    if (opts->threads > NETWORK_MAX_THREADS) opts->threads = NETWORK_MAX_THREADS;
+    opts->shuffle = 1;
+    opts->use_float32 = 0;
+    opts->optimizer = OPTIMIZER_SGD;
+    opts->learning_rate = network->learning_rate;
+    opts->momentum = network->momentum;
+    opts->weight_decay = network->weight_decay;
+    opts->beta1 = 0.9;
+    opts->beta2 = 0.999;
+    opts->epsilon = 1e-8;
+    opts->seed = (uint64_t)time(NULL);
+}
+
+/**
+ * @brief 网络训练（小批量）
+ */
+double network_train_batched(Network* network, Dataset* dataset, int epochs,
+                             const NetworkTrainOptions* opts) {
+    NetworkTrainOptions o = *opts;
+    if (network->layer_count <= 0 || dataset->count <= 0 || epochs <= 0) {
+        return 0.0;
+    }
+    if (o.batch_size < 1) o.batch_size = 1;
+    if (o.batch_size > dataset->count) o.batch_size = dataset->count;
+    if (o.threads < 1) o.threads = 1;
+    if (o.threads > NETWORK_MAX_THREADS) o.threads = NETWORK_MAX_THREADS;
+    /* 每个线程至少分到8行，否则同步开销大于收益 */
+    if (o.threads > (o.batch_size + 7) / 8) o.threads = (o.batch_size + 7) / 8;
+
+    BatchPool pool;
+    o.threads = batch_pool_start(&pool, o.threads);
+    double loss = o.use_float32
+        ? train_batched_f32(network, dataset, epochs, &o, &pool)
+        : train_batched_f64(network, dataset, epochs, &o, &pool);
+    batch_pool_stop(&pool);
+
+    if (loss >= 0.0) {
+        network->epoch = epochs;
+        network->last_loss = loss;
+        network->is_trained = 1;
+    }
+    return loss;
+}
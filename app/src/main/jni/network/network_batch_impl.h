@@ -0,0 +1,399 @@
+/**
+ * @file network_batch_impl.h
+ * @brief 小批量训练计算核心
+ *
+ * 由network_batch.c在定义REAL（元素类型）与SUFFIX（函数名后缀）后包含，
+ * 每种精度实例化一次。前向、梯度和误差回传都归结为同一个分块矩阵乘，
+ * 4行×2向量的累加块保存在寄存器里，按16字节向量做乘加。
+ */
+
+#ifndef NETWORK_BATCH_CAT
+#define NETWORK_BATCH_CAT_(a, b) a##b
+#define NETWORK_BATCH_CAT(a, b) NETWORK_BATCH_CAT_(a, b)
+#endif
+
+#define FN(name) NETWORK_BATCH_CAT(name, SUFFIX)
+
+/**
+ * @brief 训练状态，所有矩阵按行优先存放
+ */
+typedef struct {
+    int layers;
+    int in[NETWORK_MAX_LAYERS];
+    int out[NETWORK_MAX_LAYERS];
+    ActivationType act[NETWORK_MAX_LAYERS];
+    int off[NETWORK_MAX_LAYERS];         // 各层参数在params中的偏移，偏置紧跟权重
+    int nparams;
+    REAL* params;                        // 权重以 input×output 转置存放
+    REAL* wrow;                          // 同一权重的 output×input 副本，用于误差回传
+    REAL* grads;                         // 每线程一份梯度，nthreads × nparams
+    REAL* m;                             // SGD速度或Adam一阶矩
+    REAL* v;                             // Adam二阶矩
+    REAL* acts[NETWORK_MAX_LAYERS + 1];  // acts[0]为批次输入，acts[l+1]为第l层输出
+    REAL* deltas[NETWORK_MAX_LAYERS];
+    REAL* x;                             // count × input_size
+    REAL* y;                             // count × output_size
+    int* order;
+    int first;                           // 当前批次在order中的起点
+    int rows;                            // 当前批次行数
+    int ngrads;
+    double loss[NETWORK_MAX_THREADS];
+    const NetworkTrainOptions* opts;
+    double step_lr;                      // 本步实际学习率（Adam含偏差修正）
+} FN(BatchTrainer);
+
+static void FN(batch_activate)(REAL* z, int n, ActivationType act) {
+    switch (act) {
+        case ACTIVATION_SIGMOID:
+            for (int i = 0; i < n; i++) z[i] = (REAL)sigmoid((double)z[i]);
+            break;
+        case ACTIVATION_RELU:
+            for (int i = 0; i < n; i++) z[i] = z[i] > 0 ? z[i] : 0;
+            break;
+        case ACTIVATION_TANH:
+            for (int i = 0; i < n; i++) z[i] = (REAL)tanh((double)z[i]);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief d *= f'(z)，导数由激活后的输出a求得
+ */
+static void FN(batch_derive)(REAL* d, const REAL* a, int n, ActivationType act) {
+    switch (act) {
+        case ACTIVATION_SIGMOID:
+            for (int i = 0; i < n; i++) d[i] *= a[i] * (1 - a[i]);
+            break;
+        case ACTIVATION_RELU:
+            for (int i = 0; i < n; i++) d[i] = a[i] > 0 ? d[i] : 0;
+            break;
+        case ACTIVATION_TANH:
+            for (int i = 0; i < n; i++) d[i] *= 1 - a[i] * a[i];
+            break;
+        default:
+            break;
+    }
+}
+
+/* 16字节向量（SSE2/NEON基线），每行一次处理两个向量宽度的列 */
+typedef REAL FN(BatchVec) __attribute__((vector_size(16)));
+#define BATCH_VLEN ((int)(16 / sizeof(REAL)))
+
+static inline FN(BatchVec) FN(batch_vload)(const REAL* p) {
+    FN(BatchVec) v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void FN(batch_vstore)(REAL* p, FN(BatchVec) v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+/**
+ * @brief C += A·B，A(i,p) = a[i*rsa + p*csa]，B与C按行优先存放
+ */
+static void FN(batch_gemm)(int m, int n, int k, const REAL* a, int rsa, int csa,
+                           const REAL* b, int ldb, REAL* c, int ldc) {
+    const int nr = 2 * BATCH_VLEN;
+    int i = 0;
+    for (; i + 4 <= m; i += 4) {
+        const REAL* a0 = a + (size_t)i * rsa;
+        const REAL* a1 = a0 + rsa;
+        const REAL* a2 = a1 + rsa;
+        const REAL* a3 = a2 + rsa;
+        REAL* c0 = c + (size_t)i * ldc;
+        REAL* c1 = c0 + ldc;
+        REAL* c2 = c1 + ldc;
+        REAL* c3 = c2 + ldc;
+        int j = 0;
+        for (; j + nr <= n; j += nr) {
+            FN(BatchVec) s00 = FN(batch_vload)(c0 + j), s01 = FN(batch_vload)(c0 + j + BATCH_VLEN);
+            FN(BatchVec) s10 = FN(batch_vload)(c1 + j), s11 = FN(batch_vload)(c1 + j + BATCH_VLEN);
+            FN(BatchVec) s20 = FN(batch_vload)(c2 + j), s21 = FN(batch_vload)(c2 + j + BATCH_VLEN);
+            FN(BatchVec) s30 = FN(batch_vload)(c3 + j), s31 = FN(batch_vload)(c3 + j + BATCH_VLEN);
+            for (int p = 0; p < k; p++) {
+                const REAL* bp = b + (size_t)p * ldb + j;
+                FN(BatchVec) b0 = FN(batch_vload)(bp);
+                FN(BatchVec) b1 = FN(batch_vload)(bp + BATCH_VLEN);
+                REAL x0 = a0[(size_t)p * csa], x1 = a1[(size_t)p * csa];
+                REAL x2 = a2[(size_t)p * csa], x3 = a3[(size_t)p * csa];
+                s00 += b0 * x0; s01 += b1 * x0;
+                s10 += b0 * x1; s11 += b1 * x1;
+                s20 += b0 * x2; s21 += b1 * x2;
+                s30 += b0 * x3; s31 += b1 * x3;
+            }
+            FN(batch_vstore)(c0 + j, s00); FN(batch_vstore)(c0 + j + BATCH_VLEN, s01);
+            FN(batch_vstore)(c1 + j, s10); FN(batch_vstore)(c1 + j + BATCH_VLEN, s11);
+            FN(batch_vstore)(c2 + j, s20); FN(batch_vstore)(c2 + j + BATCH_VLEN, s21);
+            FN(batch_vstore)(c3 + j, s30); FN(batch_vstore)(c3 + j + BATCH_VLEN, s31);
+        }
+        for (; j < n; j++) {
+            REAL s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            for (int p = 0; p < k; p++) {
+                REAL bv = b[(size_t)p * ldb + j];
+                s0 += a0[(size_t)p * csa] * bv;
+                s1 += a1[(size_t)p * csa] * bv;
+                s2 += a2[(size_t)p * csa] * bv;
+                s3 += a3[(size_t)p * csa] * bv;
+            }
+            c0[j] += s0;
+            c1[j] += s1;
+            c2[j] += s2;
+            c3[j] += s3;
+        }
+    }
+    for (; i < m; i++) {
+        const REAL* ai = a + (size_t)i * rsa;
+        REAL* ci = c + (size_t)i * ldc;
+        for (int p = 0; p < k; p++) {
+            REAL x = ai[(size_t)p * csa];
+            const REAL* bp = b + (size_t)p * ldb;
+            for (int j = 0; j < n; j++) ci[j] += x * bp[j];
+        }
+    }
+}
+
+/**
+ * @brief 对本线程分到的批次行做前向、反向传播并累积梯度
+ */
+static void FN(batch_task)(void* arg, int tid, int nthreads) {
+    FN(BatchTrainer)* tr = (FN(BatchTrainer)*)arg;
+    int r0, r1;
+    int nl = tr->layers;
+    int in0 = tr->in[0];
+    int outn = tr->out[nl - 1];
+    REAL* g = tr->grads + (size_t)tid * tr->nparams;
+    double loss = 0.0;
+
+    batch_split(tr->rows, tid, nthreads, &r0, &r1);
+    memset(g, 0, (size_t)tr->nparams * sizeof(REAL));
+
+    for (int r = r0; r < r1; r++) {
+        int s = tr->order[tr->first + r];
+        memcpy(tr->acts[0] + (size_t)r * in0, tr->x + (size_t)s * in0, in0 * sizeof(REAL));
+    }
+
+    /* 前向：Z = A·Wᵀ + b */
+    for (int l = 0; l < nl; l++) {
+        int ni = tr->in[l], no = tr->out[l];
+        const REAL* wt = tr->params + tr->off[l];
+        const REAL* b = wt + (size_t)ni * no;
+        REAL* z = tr->acts[l + 1] + (size_t)r0 * no;
+        for (int r = r0; r < r1; r++) {
+            memcpy(tr->acts[l + 1] + (size_t)r * no, b, no * sizeof(REAL));
+        }
+        FN(batch_gemm)(r1 - r0, no, ni, tr->acts[l] + (size_t)r0 * ni, ni, 1,
+                       wt, no, z, no);
+        for (int r = r0; r < r1; r++) {
+            FN(batch_activate)(tr->acts[l + 1] + (size_t)r * no, no, tr->act[l]);
+        }
+    }
+
+    /* 输出层误差（MSE） */
+    for (int r = r0; r < r1; r++) {
+        const REAL* a = tr->acts[nl] + (size_t)r * outn;
+        const REAL* y = tr->y + (size_t)tr->order[tr->first + r] * outn;
+        REAL* d = tr->deltas[nl - 1] + (size_t)r * outn;
+        double sum = 0.0;
+        for (int k = 0; k < outn; k++) {
+            d[k] = a[k] - y[k];
+            sum += (double)d[k] * d[k];
+        }
+        loss += sum / outn;
+        FN(batch_derive)(d, a, outn, tr->act[nl - 1]);
+    }
+
+    /* 反向：dWᵀ += Aᵀ·D，db += ΣD，上一层误差 = D·W */
+    for (int l = nl - 1; l >= 0 && r1 > r0; l--) {
+        int ni = tr->in[l], no = tr->out[l];
+        const REAL* a = tr->acts[l] + (size_t)r0 * ni;
+        const REAL* d = tr->deltas[l] + (size_t)r0 * no;
+        REAL* gw = g + tr->off[l];
+        REAL* gb = gw + (size_t)ni * no;
+        FN(batch_gemm)(ni, no, r1 - r0, a, 1, ni, d, no, gw, no);
+        for (int r = 0; r < r1 - r0; r++) {
+            const REAL* dr = d + (size_t)r * no;
+            for (int k = 0; k < no; k++) gb[k] += dr[k];
+        }
+        if (l > 0) {
+            REAL* dp = tr->deltas[l - 1] + (size_t)r0 * ni;
+            memset(dp, 0, (size_t)(r1 - r0) * ni * sizeof(REAL));
+            FN(batch_gemm)(r1 - r0, ni, no, d, no, 1,
+                           tr->wrow + tr->off[l], ni, dp, ni);
+            for (int r = 0; r < r1 - r0; r++) {
+                FN(batch_derive)(dp + (size_t)r * ni, a + (size_t)r * ni, ni, tr->act[l - 1]);
+            }
+        }
+    }
+
+    tr->loss[tid] = loss;
+}
+
+/**
+ * @brief 归约各线程梯度并按优化器更新本线程分到的参数区间
+ */
+static void FN(update_task)(void* arg, int tid, int nthreads) {
+    FN(BatchTrainer)* tr = (FN(BatchTrainer)*)arg;
+    const NetworkTrainOptions* o = tr->opts;
+    REAL scale = (REAL)(1.0 / tr->rows);
+    REAL wd = (REAL)o->weight_decay;
+    REAL lr = (REAL)tr->step_lr;
+    int p0, p1;
+    batch_split(tr->nparams, tid, nthreads, &p0, &p1);
+    for (int p = p0; p < p1; p++) {
+        REAL gsum = 0;
+        for (int t = 0; t < tr->ngrads; t++) {
+            gsum += tr->grads[(size_t)t * tr->nparams + p];
+        }
+        REAL grad = gsum * scale + wd * tr->params[p];
+        if (o->optimizer == OPTIMIZER_ADAM) {
+            REAL b1 = (REAL)o->beta1, b2 = (REAL)o->beta2;
+            tr->m[p] = b1 * tr->m[p] + (1 - b1) * grad;
+            tr->v[p] = b2 * tr->v[p] + (1 - b2) * grad * grad;
+            tr->params[p] -= lr * tr->m[p] / ((REAL)sqrt((double)tr->v[p]) + (REAL)o->epsilon);
+        } else if (tr->m != NULL) {
+            tr->m[p] = (REAL)o->momentum * tr->m[p] - lr * grad;
+            tr->params[p] += tr->m[p];
+        } else {
+            tr->params[p] -= lr * grad;
+        }
+    }
+    /* 同步output×input副本中本线程负责的权重 */
+    for (int l = 0; l < tr->layers; l++) {
+        int ni = tr->in[l], no = tr->out[l];
+        int w0 = tr->off[l], w1 = w0 + ni * no;
+        int q0 = p0 > w0 ? p0 : w0;
+        int q1 = p1 < w1 ? p1 : w1;
+        for (int q = q0; q < q1; q++) {
+            int j = (q - w0) / no, k = (q - w0) % no;
+            tr->wrow[w0 + k * ni + j] = tr->params[q];
+        }
+    }
+}
+
+static void FN(trainer_free)(FN(BatchTrainer)* tr) {
+    free(tr->params);
+    free(tr->wrow);
+    free(tr->grads);
+    free(tr->m);
+    free(tr->v);
+    for (int l = 0; l <= tr->layers; l++) free(tr->acts[l]);
+    for (int l = 0; l < tr->layers; l++) free(tr->deltas[l]);
+    free(tr->x);
+    free(tr->y);
+    free(tr->order);
+}
+
+static double FN(train_batched)(Network* network, Dataset* dataset, int epochs,
+                                const NetworkTrainOptions* opts, BatchPool* pool) {
+    FN(BatchTrainer) tr;
+    int nl = network->layer_count;
+    int batch = opts->batch_size;
+    int count = dataset->count;
+    int ok = 1;
+    double total_loss = 0.0;
+    long step = 0;
+
+    memset(&tr, 0, sizeof(tr));
+    tr.layers = nl;
+    tr.opts = opts;
+    tr.ngrads = pool->count;
+    for (int l = 0; l < nl; l++) {
+        Layer* layer = &network->layers[l];
+        tr.in[l] = layer->input_size;
+        tr.out[l] = layer->output_size;
+        tr.act[l] = layer->activation;
+        tr.off[l] = tr.nparams;
+        tr.nparams += layer->input_size * layer->output_size + layer->output_size;
+    }
+    if (tr.in[0] != dataset->input_size || tr.out[nl - 1] != dataset->output_size) {
+        return -1.0;
+    }
+
+    tr.params = (REAL*)malloc((size_t)tr.nparams * sizeof(REAL));
+    tr.wrow = (REAL*)malloc((size_t)tr.nparams * sizeof(REAL));
+    tr.grads = (REAL*)malloc((size_t)tr.ngrads * tr.nparams * sizeof(REAL));
+    if (opts->optimizer == OPTIMIZER_ADAM) {
+        tr.m = (REAL*)calloc(tr.nparams, sizeof(REAL));
+        tr.v = (REAL*)calloc(tr.nparams, sizeof(REAL));
+        ok = tr.m != NULL && tr.v != NULL;
+    } else if (opts->momentum != 0.0) {
+        tr.m = (REAL*)calloc(tr.nparams, sizeof(REAL));
+        ok = tr.m != NULL;
+    }
+    tr.acts[0] = (REAL*)malloc((size_t)batch * tr.in[0] * sizeof(REAL));
+    ok = ok && tr.params != NULL && tr.wrow != NULL && tr.grads != NULL && tr.acts[0] != NULL;
+    for (int l = 0; l < nl; l++) {
+        tr.acts[l + 1] = (REAL*)malloc((size_t)batch * tr.out[l] * sizeof(REAL));
+        tr.deltas[l] = (REAL*)malloc((size_t)batch * tr.out[l] * sizeof(REAL));
+        ok = ok && tr.acts[l + 1] != NULL && tr.deltas[l] != NULL;
+    }
+    tr.x = (REAL*)malloc((size_t)count * tr.in[0] * sizeof(REAL));
+    tr.y = (REAL*)malloc((size_t)count * tr.out[nl - 1] * sizeof(REAL));
+    tr.order = (int*)malloc((size_t)count * sizeof(int));
+    if (!ok || tr.x == NULL || tr.y == NULL || tr.order == NULL) {
+        FN(trainer_free)(&tr);
+        return -1.0;
+    }
+
+    /* 权重同时保存转置（input×output）与原始（output×input）两种布局 */
+    for (int l = 0; l < nl; l++) {
+        Layer* layer = &network->layers[l];
+        int ni = tr.in[l], no = tr.out[l];
+        REAL* wt = tr.params + tr.off[l];
+        REAL* w = tr.wrow + tr.off[l];
+        for (int i = 0; i < no; i++) {
+            for (int j = 0; j < ni; j++) {
+                wt[(size_t)j * no + i] = (REAL)layer->weights[(size_t)i * ni + j];
+                w[(size_t)i * ni + j] = (REAL)layer->weights[(size_t)i * ni + j];
+            }
+            wt[(size_t)ni * no + i] = (REAL)layer->biases[i];
+        }
+    }
+    for (int s = 0; s < count; s++) {
+        for (int j = 0; j < tr.in[0]; j++) {
+            tr.x[(size_t)s * tr.in[0] + j] = (REAL)dataset->pairs[s].input[j];
+        }
+        for (int k = 0; k < tr.out[nl - 1]; k++) {
+            tr.y[(size_t)s * tr.out[nl - 1] + k] = (REAL)dataset->pairs[s].target[k];
+        }
+    }
+
+    uint64_t rng = opts->seed;
+    for (int e = 0; e < epochs; e++) {
+        batch_shuffle(tr.order, count, opts->shuffle, &rng);
+        for (tr.first = 0; tr.first < count; tr.first += batch) {
+            tr.rows = count - tr.first < batch ? count - tr.first : batch;
+            batch_pool_run(pool, FN(batch_task), &tr);
+            for (int t = 0; t < pool->count; t++) total_loss += tr.loss[t];
+            step++;
+            tr.step_lr = opts->learning_rate;
+            if (opts->optimizer == OPTIMIZER_ADAM) {
+                tr.step_lr *= sqrt(1.0 - pow(opts->beta2, (double)step)) /
+                              (1.0 - pow(opts->beta1, (double)step));
+            }
+            batch_pool_run(pool, FN(update_task), &tr);
+        }
+    }
+
+    for (int l = 0; l < nl; l++) {
+        Layer* layer = &network->layers[l];
+        int ni = tr.in[l], no = tr.out[l];
+        const REAL* wt = tr.params + tr.off[l];
+        for (int i = 0; i < no; i++) {
+            for (int j = 0; j < ni; j++) {
+                layer->weights[(size_t)i * ni + j] = (double)wt[(size_t)j * no + i];
+            }
+            layer->biases[i] = (double)wt[(size_t)ni * no + i];
+        }
+    }
+
+    FN(trainer_free)(&tr);
+    /* 与network_train一致：所有轮次所有样本的平均损失 */
+    return total_loss / ((double)count * epochs);
+}
+
+#undef BATCH_VLEN
+#undef FN
@@ -0,0 +1,99 @@
+-- network:train on the per-sample and the mini-batch paths
+local nn = require "network"
+
+local xor = {
+	{ input = { 0, 0 }, target = { 0 } },
+	{ input = { 0, 1 }, target = { 1 } },
+	{ input = { 1, 0 }, target = { 1 } },
+	{ input = { 1, 1 }, target = { 0 } },
+}
+
+local function close(a, b, eps)
+	return math.abs(a - b) <= (eps or 1e-9) * math.max(1, math.abs(a), math.abs(b))
+end
+
+local function same_outputs(a, b, eps)
+	for _, s in ipairs(xor) do
+		if not close(a:predict(s.input)[1], b:predict(s.input)[1], eps) then return false end
+	end
+	return true
+end
+
+local function mse(net)
+	local sum = 0
+	for _, s in ipairs(xor) do
+		local d = net:predict(s.input)[1] - s.target[1]
+		sum = sum + d * d
+	end
+	return sum / #xor
+end
+
+do print("without options every sample is a step")
+	local a = nn.new({ 4, 1 }, 2)
+	local b = a:clone()
+	local c = a:clone()
+	local loss = a:train(xor, 5, 8)  -- the batch size alone does not batch
+	local total = 0
+	for _ = 1, 5 do
+		for _, s in ipairs(xor) do total = total + b:trainStep(s.input, s.target) end
+	end
+	assert(close(loss, total / (5 * #xor)), loss)
+	assert(same_outputs(a, b))
+	assert(c:train(xor, 5) == loss and same_outputs(a, c))
+	assert(a:info().is_trained)
+end
+
+do print("both paths return the mean loss over all epochs")
+	local opts = { optimizer = "sgd", momentum = 0, shuffle = false, threads = 1 }
+	local a = nn.new({ 4, 1 }, 2)
+	a:setLearningRate(0.5)
+	local b = a:clone()
+	local l1 = b:train(xor, 1, 2, opts)
+	local l2 = b:train(xor, 1, 2, opts)
+	local l12 = a:train(xor, 2, 2, opts)
+	assert(l1 ~= l2)
+	assert(close(l12, (l1 + l2) / 2), l12)
+	assert(same_outputs(a, b))
+
+	-- a learning rate of 0 leaves the weights alone: the loss is the plain MSE
+	local c = nn.new({ 4, 1 }, 2)
+	local before = mse(c)
+	assert(close(c:train(xor, 3, 4, { learning_rate = 0, shuffle = false }), before))
+	assert(close(mse(c), before))
+end
+
+do print("mini-batch training learns xor")
+	for _, o in ipairs{
+		{ optimizer = "sgd", learning_rate = 0.5 },
+		{ optimizer = "adam", learning_rate = 0.05 },
+		{ optimizer = "adam", learning_rate = 0.05, precision = "float32" },
+		{ optimizer = "adam", learning_rate = 0.05, threads = 4 },
+	} do
+		o.seed = 42
+		local net = nn.new({ 8, 1 }, 2)
+		local first = net:train(xor, 1, 4, o)
+		local last = net:train(xor, 2000, 4, o)
+		assert(last < first, o.optimizer)
+		assert(mse(net) < 0.05, mse(net))
+	end
+end
+
+do print("shuffling is seeded")
+	local a = nn.new({ 4, 1 }, 2)
+	local b, c = a:clone(), a:clone()
+	local o = { seed = 7, threads = 1 }
+	a:train(xor, 20, 2, o)
+	b:train(xor, 20, 2, o)
+	assert(same_outputs(a, b, 0))
+	c:train(xor, 20, 2, { seed = 8, threads = 1 })
+	assert(not same_outputs(a, c, 0))
+end
+
+do print("option errors")
+	local net = nn.new({ 2, 1 }, 2)
+	assert(not pcall(net.train, net, xor, 1, 2, { optimizer = "rmsprop" }))
+	assert(not pcall(net.train, net, xor, 1, 2, { precision = "float16" }))
+	assert(not pcall(net.train, net, xor, 1, 2, { threads = "many" }))
+end
+
+print("OK")
@@ -5,6 +5,7 @@ LOCAL_PATH := $(call my-dir)
 # and because all-in-one loader loads before Android asset loader
 include $(CLEAR_VARS)
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/../lua
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../lua-memory-2.0.0/src
 LOCAL_MODULE := socket
 LOCAL_SRC_FILES := \
 	luasocket.c \
@@ -18,7 +19,8 @@ LOCAL_SRC_FILES := \
 	udp.c \
 	except.c \
 	select.c \
-	usocket.c
+	usocket.c \
+	../lua-memory-2.0.0/src/luamem.c
 LOCAL_STATIC_LIBRARIES := LXCLuaCore
 include $(BUILD_SHARED_LIBRARY)
 
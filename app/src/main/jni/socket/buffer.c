@@ -4,6 +4,10 @@
 \*==============================================================*/
 #include "luasocket.h"
 #include "buffer.h"
+#include "luamem.h"
+
+#include <stdlib.h>
+#include <string.h>
 
 /*==============================================================*\
 * Internal function prototypes
@@ -11,9 +15,12 @@
 static int recvraw(p_buffer buf, size_t wanted, luaL_Buffer *b);
 static int recvline(p_buffer buf, luaL_Buffer *b);
 static int recvall(p_buffer buf, luaL_Buffer *b);
+static int recvinto(p_buffer buf, char *data, size_t wanted, size_t *got);
 static int buffer_get(p_buffer buf, const char **data, size_t *count);
 static void buffer_skip(p_buffer buf, size_t count);
 static int sendraw(p_buffer buf, const char *data, size_t count, size_t *sent);
+static int sendvec(p_buffer buf, t_iovec *iov, int n, size_t *sent);
+static void pushresult(lua_State *L, luaL_Buffer *b, int top);
 
 /* min and max macros */
 #ifndef MIN
@@ -39,12 +46,68 @@ int buffer_open(lua_State *L) {
 \*-------------------------------------------------------------------------*/
 void buffer_init(p_buffer buf, p_io io, p_timeout tm) {
     buf->first = buf->last = 0;
+    buf->data = buf->init;
+    buf->size = BUF_SIZE;
     buf->io = io;
     buf->tm = tm;
     buf->received = buf->sent = 0;
     buf->birthday = timeout_gettime();
 }
 
+/*-------------------------------------------------------------------------*\
+* Releases the storage allocated by buffer_setsize, if any
+\*-------------------------------------------------------------------------*/
+void buffer_destroy(p_buffer buf) {
+    if (buf->data != buf->init) free(buf->data);
+    buf->data = buf->init;
+    buf->size = BUF_SIZE;
+    buf->first = buf->last = 0;
+}
+
+/*-------------------------------------------------------------------------*\
+* Changes the capacity of the buffer, keeping any data still stored in it.
+* Sizes up to BUF_SIZE use the storage embedded in the structure.
+\*-------------------------------------------------------------------------*/
+int buffer_setsize(p_buffer buf, size_t size) {
+    size_t pending = buf->last - buf->first;
+    char *data;
+    if (size < pending) size = pending;
+    if (size == 0) size = 1;
+    if (size <= BUF_SIZE) data = buf->init;
+    else if (buf->data != buf->init && size == buf->size) return IO_DONE;
+    else if (!(data = (char *) malloc(size))) return IO_UNKNOWN;
+    memmove(data, buf->data + buf->first, pending);
+    if (buf->data != buf->init && buf->data != data) free(buf->data);
+    buf->data = data;
+    buf->size = size;
+    buf->first = 0;
+    buf->last = pending;
+    return IO_DONE;
+}
+
+/*-------------------------------------------------------------------------*\
+* object:setbuffersize() interface
+\*-------------------------------------------------------------------------*/
+int buffer_meth_setsize(lua_State *L, p_buffer buf) {
+    lua_Integer size = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, size > 0 && size <= BUF_MAXSIZE, 2, "invalid buffer size");
+    if (buffer_setsize(buf, (size_t) size) != IO_DONE) {
+        lua_pushnil(L);
+        lua_pushstring(L, "not enough memory");
+        return 2;
+    }
+    lua_pushnumber(L, 1);
+    return 1;
+}
+
+/*-------------------------------------------------------------------------*\
+* object:getbuffersize() interface
+\*-------------------------------------------------------------------------*/
+int buffer_meth_getsize(lua_State *L, p_buffer buf) {
+    lua_pushinteger(L, (lua_Integer) buf->size);
+    return 1;
+}
+
 /*-------------------------------------------------------------------------*\
 * object:getstats() interface
 \*-------------------------------------------------------------------------*/
@@ -68,12 +131,13 @@ int buffer_meth_setstats(lua_State *L, p_buffer buf) {
 
 /*-------------------------------------------------------------------------*\
 * object:send() interface
+* Data may be a string, a lua-memory object or a string buffer.
 \*-------------------------------------------------------------------------*/
 int buffer_meth_send(lua_State *L, p_buffer buf) {
     int top = lua_gettop(L);
     int err = IO_DONE;
     size_t size = 0, sent = 0;
-    const char *data = luaL_checklstring(L, 2, &size);
+    const char *data = luamem_checkarray(L, 2, &size);
     long start = (long) luaL_optnumber(L, 3, 1);
     long end = (long) luaL_optnumber(L, 4, -1);
     timeout_markstart(buf->tm);
@@ -99,6 +163,86 @@ int buffer_meth_send(lua_State *L, p_buffer buf) {
     return lua_gettop(L) - top;
 }
 
+/*-------------------------------------------------------------------------*\
+* object:sendv() interface
+* Sends a list of strings (or lua-memory objects) with as few system calls
+* as the IO driver allows, without concatenating them first.
+\*-------------------------------------------------------------------------*/
+#define SENDV_BATCH 64
+int buffer_meth_sendv(lua_State *L, p_buffer buf) {
+    int top = lua_gettop(L);
+    int err = IO_DONE;
+    size_t total = 0;
+    lua_Integer i, n;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    n = (lua_Integer) lua_rawlen(L, 2);
+    timeout_markstart(buf->tm);
+    for (i = 1; i <= n && err == IO_DONE; ) {
+        t_iovec iov[SENDV_BATCH];
+        size_t sent = 0;
+        int k = 0;
+        /* pieces stay referenced by the table while they are sent */
+        for ( ; k < SENDV_BATCH && i <= n; i++) {
+            lua_rawgeti(L, 2, i);
+            iov[k].data = luamem_toarray(L, -1, &iov[k].count);
+            if (!iov[k].data && !luamem_ismemory(L, -1))
+                luaL_error(L, "invalid value (at index %d) in table for 'sendv'", (int) i);
+            lua_pop(L, 1);
+            if (iov[k].count > 0) k++;
+        }
+        err = sendvec(buf, iov, k, &sent);
+        total += sent;
+    }
+    if (err != IO_DONE) {
+        lua_pushnil(L);
+        lua_pushstring(L, buf->io->error(buf->io->ctx, err));
+        lua_pushnumber(L, (lua_Number) total);
+    } else {
+        lua_pushnumber(L, (lua_Number) total);
+        lua_pushnil(L);
+        lua_pushnil(L);
+    }
+#ifdef LUASOCKET_DEBUG
+    /* push time elapsed during operation as the last return value */
+    lua_pushnumber(L, timeout_gettime() - timeout_getstart(buf->tm));
+#endif
+    return lua_gettop(L) - top;
+}
+
+/*-------------------------------------------------------------------------*\
+* object:receive_into() interface
+* Fills bytes i..j of a lua-memory object in place. Returns the number of
+* bytes written, or nil, the error and the number of bytes written so far.
+\*-------------------------------------------------------------------------*/
+int buffer_meth_receiveinto(lua_State *L, p_buffer buf) {
+    int top = lua_gettop(L);
+    int err = IO_DONE;
+    size_t len, got = 0;
+    char *mem = luamem_checkmemory(L, 2, &len);
+    lua_Integer i = luaL_optinteger(L, 3, 1);
+    lua_Integer j = luaL_optinteger(L, 4, -1);
+    if (i < 0) i = (lua_Integer) len + i + 1;
+    if (j < 0) j = (lua_Integer) len + j + 1;
+    if (i < 1) i = 1;
+    if (j > (lua_Integer) len) j = (lua_Integer) len;
+    timeout_markstart(buf->tm);
+    if (i <= j) err = recvinto(buf, mem + i - 1, (size_t) (j - i + 1), &got);
+    if (err != IO_DONE) {
+        lua_pushnil(L);
+        lua_pushstring(L, buf->io->error(buf->io->ctx, err));
+        lua_pushnumber(L, (lua_Number) got);
+    } else {
+        lua_pushnumber(L, (lua_Number) got);
+        lua_pushnil(L);
+        lua_pushnil(L);
+    }
+#ifdef LUASOCKET_DEBUG
+    /* push time elapsed during operation as the last return value */
+    lua_pushnumber(L, timeout_gettime() - timeout_getstart(buf->tm));
+#endif
+    return lua_gettop(L) - top;
+}
+
 /*-------------------------------------------------------------------------*\
 * object:receive() interface
 \*-------------------------------------------------------------------------*/
@@ -134,13 +278,13 @@ int buffer_meth_receive(lua_State *L, p_buffer buf) {
     if (err != IO_DONE) {
         /* we can't push anyting in the stack before pushing the
          * contents of the buffer. this is the reason for the complication */
-        luaL_pushresult(&b);
+        pushresult(L, &b, top);
         lua_pushstring(L, buf->io->error(buf->io->ctx, err));
         lua_pushvalue(L, -2);
         lua_pushnil(L);
         lua_replace(L, -4);
     } else {
-        luaL_pushresult(&b);
+        pushresult(L, &b, top);
         lua_pushnil(L);
         lua_pushnil(L);
     }
@@ -151,6 +295,17 @@ int buffer_meth_receive(lua_State *L, p_buffer buf) {
     return lua_gettop(L) - top;
 }
 
+/*-------------------------------------------------------------------------*\
+* Pushes the buffer contents as the first value above top. The core library
+* leaves a fresh placeholder under the result, so the string is moved down
+* explicitly instead of relying on the stack layout.
+\*-------------------------------------------------------------------------*/
+static void pushresult(lua_State *L, luaL_Buffer *b, int top) {
+    luaL_pushresult(b);
+    lua_copy(L, -1, top + 1);
+    lua_settop(L, top + 1);
+}
+
 /*-------------------------------------------------------------------------*\
 * Determines if there is any data in the read buffer
 \*-------------------------------------------------------------------------*/
@@ -182,23 +337,94 @@ static int sendraw(p_buffer buf, const char *data, size_t count, size_t *sent) {
 }
 
 /*-------------------------------------------------------------------------*\
-* Reads a fixed number of bytes (buffered)
+* Sends a list of pieces (unbuffered), advancing over partial writes
+\*-------------------------------------------------------------------------*/
+static int sendvec(p_buffer buf, t_iovec *iov, int n, size_t *sent) {
+    p_io io = buf->io;
+    size_t total = 0;
+    int err = IO_DONE;
+    if (!io->sendv) {
+        int k;
+        for (k = 0; k < n && err == IO_DONE; k++) {
+            size_t done = 0;
+            err = sendraw(buf, iov[k].data, iov[k].count, &done);
+            total += done;
+        }
+        *sent = total;
+        return err;
+    }
+    while (n > 0 && err == IO_DONE) {
+        size_t done = 0;
+        err = io->sendv(io->ctx, iov, n, &done, buf->tm);
+        total += done;
+        /* skip what went out, possibly ending in the middle of a piece */
+        while (n > 0 && done >= iov->count) {
+            done -= iov->count;
+            iov++; n--;
+        }
+        if (n > 0) {
+            iov->data += done;
+            iov->count -= done;
+        }
+    }
+    *sent = total;
+    buf->sent += total;
+    return err;
+}
+
+/*-------------------------------------------------------------------------*\
+* Reads a fixed number of bytes (buffered). Once the buffer is drained,
+* large requests are read straight into the Lua buffer to avoid a copy.
 \*-------------------------------------------------------------------------*/
 static int recvraw(p_buffer buf, size_t wanted, luaL_Buffer *b) {
     int err = IO_DONE;
     size_t total = 0;
     while (err == IO_DONE) {
         size_t count; const char *data;
-        err = buffer_get(buf, &data, &count);
-        count = MIN(count, wanted - total);
-        luaL_addlstring(b, data, count);
-        buffer_skip(buf, count);
+        if (buffer_isempty(buf) && wanted - total >= buf->size) {
+            size_t step = MIN(wanted - total, 16 * buf->size);
+            char *dest = luaL_prepbuffsize(b, step);
+            count = 0;
+            err = buf->io->recv(buf->io->ctx, dest, step, &count, buf->tm);
+            luaL_addsize(b, count);
+            buf->received += count;
+        } else {
+            err = buffer_get(buf, &data, &count);
+            count = MIN(count, wanted - total);
+            luaL_addlstring(b, data, count);
+            buffer_skip(buf, count);
+        }
         total += count;
         if (total >= wanted) break;
     }
     return err;
 }
 
+/*-------------------------------------------------------------------------*\
+* Reads a fixed number of bytes into caller storage (buffered), bypassing
+* the buffer for reads at least as large as it
+\*-------------------------------------------------------------------------*/
+static int recvinto(p_buffer buf, char *dest, size_t wanted, size_t *got) {
+    int err = IO_DONE;
+    size_t total = 0;
+    while (total < wanted && err == IO_DONE) {
+        size_t count = 0; const char *data;
+        if (buffer_isempty(buf) && wanted - total >= buf->size) {
+            err = buf->io->recv(buf->io->ctx, dest + total, wanted - total,
+                &count, buf->tm);
+            buf->received += count;
+        } else {
+            err = buffer_get(buf, &data, &count);
+            count = MIN(count, wanted - total);
+            memcpy(dest + total, data, count);
+            buffer_skip(buf, count);
+        }
+        total += count;
+    }
+    *got = total;
+    return err;
+}
+
 /*-------------------------------------------------------------------------*\
 * Reads everything until the connection is closed (buffered)
 \*-------------------------------------------------------------------------*/
@@ -207,6 +433,16 @@ static int recvall(p_buffer buf, luaL_Buffer *b) {
     size_t total = 0;
     while (err == IO_DONE) {
         const char *data; size_t count;
+        if (buffer_isempty(buf)) {
+            /* read straight into the Lua buffer */
+            char *dest = luaL_prepbuffsize(b, buf->size);
+            count = 0;
+            err = buf->io->recv(buf->io->ctx, dest, buf->size, &count, buf->tm);
+            luaL_addsize(b, count);
+            buf->received += count;
+            total += count;
+            continue;
+        }
         err = buffer_get(buf, &data, &count);
         total += count;
         luaL_addlstring(b, data, count);
@@ -263,7 +499,7 @@ static int buffer_get(p_buffer buf, const char **data, size_t *count) {
     p_timeout tm = buf->tm;
     if (buffer_isempty(buf)) {
         size_t got;
-        err = io->recv(io->ctx, buf->data, BUF_SIZE, &got, tm);
+        err = io->recv(io->ctx, buf->data, buf->size, &got, tm);
         buf->first = 0;
         buf->last = got;
     }
@@ -19,8 +19,10 @@
 #include "io.h"
 #include "timeout.h"
 
-/* buffer size in bytes */
+/* default buffer size in bytes */
 #define BUF_SIZE 8192
+/* largest buffer size accepted by setbuffersize */
+#define BUF_MAXSIZE (16*1024*1024)
 
 /* buffer control structure */
 typedef struct t_buffer_ {
@@ -29,7 +31,9 @@ typedef struct t_buffer_ {
     p_io io;                /* IO driver used for this buffer */
     p_timeout tm;           /* timeout management for this buffer */
     size_t first, last;     /* index of first and last bytes of stored data */
-    char data[BUF_SIZE];    /* storage space for buffer data */
+    size_t size;            /* capacity of data */
+    char *data;             /* storage in use: init or a heap block */
+    char init[BUF_SIZE];    /* default storage space for buffer data */
 } t_buffer;
 typedef t_buffer *p_buffer;
 
@@ -39,10 +43,16 @@ typedef t_buffer *p_buffer;
 
 int buffer_open(lua_State *L);
 void buffer_init(p_buffer buf, p_io io, p_timeout tm);
+void buffer_destroy(p_buffer buf);
+int buffer_setsize(p_buffer buf, size_t size);
 int buffer_meth_getstats(lua_State *L, p_buffer buf);
 int buffer_meth_setstats(lua_State *L, p_buffer buf);
 int buffer_meth_send(lua_State *L, p_buffer buf);
 int buffer_meth_receive(lua_State *L, p_buffer buf);
+int buffer_meth_receiveinto(lua_State *L, p_buffer buf);
+int buffer_meth_sendv(lua_State *L, p_buffer buf);
+int buffer_meth_setsize(lua_State *L, p_buffer buf);
+int buffer_meth_getsize(lua_State *L, p_buffer buf);
 int buffer_isempty(p_buffer buf);
 
 #ifndef _WIN32
@@ -47,12 +47,28 @@ typedef int (*p_recv) (
     p_timeout tm        /* timeout control */
 );
 
+/* one piece of data for a vectored send */
+typedef struct t_iovec_ {
+    const char *data;   /* pointer to data to send */
+    size_t count;       /* number of bytes in the piece */
+} t_iovec;
+
+/* interface to vectored send function */
+typedef int (*p_sendv) (
+    void *ctx,          /* context needed by send */
+    const t_iovec *iov, /* pieces to send, in order */
+    int n,              /* number of pieces */
+    size_t *sent,       /* number of bytes sent uppon return */
+    p_timeout tm        /* timeout control */
+);
+
 /* IO driver definition */
 typedef struct t_io_ {
     void *ctx;          /* context needed by send/recv */
     p_send send;        /* send function pointer */
     p_recv recv;        /* receive function pointer */
     p_error error;      /* strerror function */
+    p_sendv sendv;      /* vectored send, or NULL to send piece by piece */
 } t_io;
 typedef t_io *p_io;
 
@@ -4,35 +4,84 @@
 \*==============================================================*/
 #include "luasocket.h"
 
+#include "auxiliar.h"
 #include "socket.h"
 #include "timeout.h"
+#include "buffer.h"
+#include "tcp.h"
 #include "select.h"
 
 #include <string.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <poll.h>
+#if defined(__linux__) || defined(__ANDROID__)
+#define SELECT_EPOLL
+#include <sys/epoll.h>
+#endif
+#endif
 
 /*==============================================================*\
 * Internal function prototypes.
 \*==============================================================*/
 static t_socket getfd(lua_State *L);
 static int dirty(lua_State *L);
+static void make_assoc(lua_State *L, int tab);
+static int global_select(lua_State *L);
+#ifdef _WIN32
 static void collect_fd(lua_State *L, int tab, int itab,
         fd_set *set, t_socket *max_fd);
 static int check_dirty(lua_State *L, int tab, int dtab, fd_set *set);
 static void return_fd(lua_State *L, fd_set *set, t_socket max_fd,
         int itab, int tab, int start);
-static void make_assoc(lua_State *L, int tab);
-static int global_select(lua_State *L);
+#else
+static void collect_pollfd(lua_State *L, int tab, int itab,
+        struct pollfd *fds, int *nfds, short events);
+static int check_dirty_pollfd(lua_State *L, int itab, int dtab,
+        struct pollfd *fds, int nfds);
+static void return_pollfd(lua_State *L, struct pollfd *fds, int first,
+        int last, int itab, int tab, int start);
+static int global_poller(lua_State *L);
+static int poller_meth_add(lua_State *L);
+static int poller_meth_modify(lua_State *L);
+static int poller_meth_remove(lua_State *L);
+static int poller_meth_wait(lua_State *L);
+static int poller_meth_count(lua_State *L);
+static int poller_meth_close(lua_State *L);
+#endif
 
 /* functions in library namespace */
 static luaL_Reg func[] = {
     {"select", global_select},
+#ifndef _WIN32
+    {"poller", global_poller},
+#endif
     {NULL,     NULL}
 };
 
+#ifndef _WIN32
+/* poller object methods */
+static luaL_Reg poller_methods[] = {
+    {"__gc",        poller_meth_close},
+    {"__tostring",  auxiliar_tostring},
+    {"add",         poller_meth_add},
+    {"close",       poller_meth_close},
+    {"count",       poller_meth_count},
+    {"modify",      poller_meth_modify},
+    {"remove",      poller_meth_remove},
+    {"wait",        poller_meth_wait},
+    {NULL,          NULL}
+};
+#endif
+
 /*-------------------------------------------------------------------------*\
 * Initializes module
 \*-------------------------------------------------------------------------*/
 int select_open(lua_State *L) {
+#ifndef _WIN32
+    auxiliar_newclass(L, "poller{object}", poller_methods);
+#endif
     lua_pushstring(L, "_SETSIZE");
     lua_pushinteger(L, FD_SETSIZE);
     lua_rawset(L, -3);
@@ -49,6 +98,7 @@ int select_open(lua_State *L) {
 /*-------------------------------------------------------------------------*\
 * Waits for a set of sockets until a condition is met or timeout.
 \*-------------------------------------------------------------------------*/
+#ifdef _WIN32
 static int global_select(lua_State *L) {
     int rtab, wtab, itab, ret, ndirty;
     t_socket max_fd = SOCKET_INVALID;
@@ -81,6 +131,56 @@ static int global_select(lua_State *L) {
         return 3;
     }
 }
+#else
+/*-------------------------------------------------------------------------*\
+* On Unix the same interface is served by poll(), so descriptors above
+* FD_SETSIZE are accepted and the cost is proportional to the number of
+* sockets passed rather than to the largest descriptor. Servers with many
+* long-lived connections should use socket.poller() instead.
+\*-------------------------------------------------------------------------*/
+static int global_select(lua_State *L) {
+    int rtab, wtab, itab, ret, ndirty, nfds = 0, nread;
+    size_t max = 0;
+    struct pollfd *fds;
+    t_timeout tm;
+    double t = luaL_optnumber(L, 3, -1);
+    lua_settop(L, 3);
+    if (!lua_isnil(L, 1)) {
+        luaL_checktype(L, 1, LUA_TTABLE);
+        max += lua_rawlen(L, 1);
+    }
+    if (!lua_isnil(L, 2)) {
+        luaL_checktype(L, 2, LUA_TTABLE);
+        max += lua_rawlen(L, 2);
+    }
+    fds = (struct pollfd *) lua_newuserdatauv(L,
+            (max > 0? max: 1) * sizeof(struct pollfd), 0);
+    lua_newtable(L); itab = lua_gettop(L);
+    lua_newtable(L); rtab = lua_gettop(L);
+    lua_newtable(L); wtab = lua_gettop(L);
+    collect_pollfd(L, 1, itab, fds, &nfds, POLLIN);
+    nread = nfds;
+    collect_pollfd(L, 2, itab, fds, &nfds, POLLOUT);
+    ndirty = check_dirty_pollfd(L, itab, rtab, fds, nread);
+    t = ndirty > 0? 0.0: t;
+    timeout_init(&tm, t, -1);
+    timeout_markstart(&tm);
+    ret = socket_poll(fds, nfds, &tm);
+    if (ret > 0 || ndirty > 0) {
+        return_pollfd(L, fds, 0, nread, itab, rtab, ndirty);
+        return_pollfd(L, fds, nread, nfds, itab, wtab, 0);
+        make_assoc(L, rtab);
+        make_assoc(L, wtab);
+        return 2;
+    } else if (ret == 0) {
+        lua_pushstring(L, "timeout");
+        return 3;
+    } else {
+        luaL_error(L, "select failed");
+        return 3;
+    }
+}
+#endif
 
 /*==============================================================*\
 * Internal functions
@@ -114,6 +214,7 @@ static int dirty(lua_State *L) {
     return is;
 }
 
+#ifdef _WIN32
 static void collect_fd(lua_State *L, int tab, int itab,
         fd_set *set, t_socket *max_fd) {
     int i = 1, n = 0;
@@ -133,13 +234,8 @@ static void collect_fd(lua_State *L, int tab, int itab,
         fd = getfd(L);
         if (fd != SOCKET_INVALID) {
             /* make sure we don't overflow the fd_set */
-#ifdef _WIN32
             if (n >= FD_SETSIZE)
                 luaL_argerror(L, tab, "too many sockets");
-#else
-            if (fd >= FD_SETSIZE)
-                luaL_argerror(L, tab, "descriptor too large for set size");
-#endif
             FD_SET(fd, set);
             n++;
             /* keep track of the largest descriptor so far */
@@ -192,6 +288,62 @@ static void return_fd(lua_State *L, fd_set *set, t_socket max_fd,
         }
     }
 }
+#else
+/* itab maps the position of each entry in fds (1-based) to its object */
+static void collect_pollfd(lua_State *L, int tab, int itab,
+        struct pollfd *fds, int *nfds, short events) {
+    int i = 1;
+    /* nil is the same as an empty table */
+    if (lua_isnil(L, tab)) return;
+    for ( ;; ) {
+        t_socket fd;
+        lua_pushnumber(L, i);
+        lua_gettable(L, tab);
+        if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            break;
+        }
+        /* getfd figures out if this is a socket */
+        fd = getfd(L);
+        if (fd != SOCKET_INVALID) {
+            fds[*nfds].fd = fd;
+            fds[*nfds].events = events;
+            fds[*nfds].revents = 0;
+            lua_rawseti(L, itab, ++(*nfds));
+        } else lua_pop(L, 1);
+        i = i + 1;
+    }
+}
+
+static int check_dirty_pollfd(lua_State *L, int itab, int dtab,
+        struct pollfd *fds, int nfds) {
+    int ndirty = 0, i;
+    for (i = 0; i < nfds; i++) {
+        lua_rawgeti(L, itab, i+1);
+        if (dirty(L)) {
+            lua_pushnumber(L, ++ndirty);
+            lua_pushvalue(L, -2);
+            lua_settable(L, dtab);
+            /* poll ignores negative descriptors */
+            fds[i].fd = -1;
+        }
+        lua_pop(L, 1);
+    }
+    return ndirty;
+}
+
+static void return_pollfd(lua_State *L, struct pollfd *fds, int first,
+        int last, int itab, int tab, int start) {
+    int i;
+    for (i = first; i < last; i++) {
+        if (fds[i].fd >= 0 && fds[i].revents != 0 && !(fds[i].revents & POLLNVAL)) {
+            lua_pushnumber(L, ++start);
+            lua_rawgeti(L, itab, i+1);
+            lua_settable(L, tab);
+        }
+    }
+}
+#endif
 
 static void make_assoc(lua_State *L, int tab) {
     int i = 1, atab;
@@ -212,3 +364,326 @@ static void make_assoc(lua_State *L, int tab) {
         i = i+1;
     }
 }
+
+#ifndef _WIN32
+/*==============================================================*\
+* Poller object
+*
+* A poller keeps its interest set across calls, so waiting costs time
+* proportional to the number of ready sockets instead of the number of
+* registered ones. On Linux/Android it is an epoll instance; elsewhere it
+* falls back to poll() over the registered set. The registered objects are
+* kept in the uservalue of the poller, indexed by descriptor.
+\*==============================================================*/
+#define POLLER_R 1
+#define POLLER_W 2
+
+typedef struct t_poller_ {
+    int epfd;               /* epoll descriptor, or -1 when using poll() */
+    struct pollfd *fds;     /* registered descriptors, densely packed */
+    p_buffer *bufs;         /* input buffer of each tcp socket, or NULL */
+    int *slot;              /* descriptor -> index into fds, -1 if absent */
+    int n, cap, nslot;
+#ifdef SELECT_EPOLL
+    struct epoll_event *events;
+    int nevents;
+#endif
+} t_poller;
+typedef t_poller *p_poller;
+
+static p_poller poller_check(lua_State *L) {
+    p_poller p = (p_poller) auxiliar_checkclass(L, "poller{object}", 1);
+    if (p->cap < 0) luaL_argerror(L, 1, "poller is closed");
+    return p;
+}
+
+static int poller_events(lua_State *L, int idx) {
+    const char *mode = luaL_optstring(L, idx, "r");
+    int ev = 0;
+    for ( ; *mode; mode++) {
+        if (*mode == 'r') ev |= POLLER_R;
+        else if (*mode == 'w') ev |= POLLER_W;
+        else luaL_argerror(L, idx, "invalid mode, expected 'r', 'w' or 'rw'");
+    }
+    if (ev == 0) luaL_argerror(L, idx, "empty mode");
+    return ev;
+}
+
+/* descriptor of the object at idx: a socket exporting getfd() or a number */
+static t_socket poller_getfd(lua_State *L, int idx) {
+    t_socket fd;
+    if (lua_type(L, idx) == LUA_TNUMBER)
+        fd = (t_socket) lua_tointeger(L, idx);
+    else {
+        lua_pushvalue(L, idx);
+        fd = getfd(L);
+        lua_pop(L, 1);
+    }
+    if (fd == SOCKET_INVALID || fd < 0)
+        luaL_argerror(L, idx, "object has no valid descriptor");
+    return fd;
+}
+
+#ifdef SELECT_EPOLL
+static int poller_ctl(p_poller p, int op, t_socket fd, int ev) {
+    struct epoll_event e;
+    memset(&e, 0, sizeof(e));
+    e.data.fd = fd;
+    if (ev & POLLER_R) e.events |= EPOLLIN;
+    if (ev & POLLER_W) e.events |= EPOLLOUT;
+    return epoll_ctl(p->epfd, op, fd, &e) == 0? IO_DONE: errno;
+}
+#endif
+
+static int global_poller(lua_State *L) {
+    p_poller p = (p_poller) lua_newuserdatauv(L, sizeof(t_poller), 1);
+    memset(p, 0, sizeof(t_poller));
+    p->epfd = -1;
+    auxiliar_setclass(L, "poller{object}", -1);
+    lua_newtable(L);
+    lua_setiuservalue(L, -2, 1);
+#ifdef SELECT_EPOLL
+    p->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (p->epfd < 0) {
+        p->cap = -1;
+        lua_pushnil(L);
+        lua_pushstring(L, socket_strerror(errno));
+        return 2;
+    }
+#endif
+    return 1;
+}
+
+static int poller_meth_add(lua_State *L) {
+    p_poller p = poller_check(L);
+    t_socket fd = poller_getfd(L, 2);
+    int ev = poller_events(L, 3);
+    if (fd < p->nslot && p->slot[fd] >= 0)
+        luaL_argerror(L, 2, "descriptor already registered");
+    if (fd >= p->nslot) {
+        int nslot = p->nslot > 0? p->nslot: 64, i;
+        int *slot;
+        while (nslot <= fd) nslot *= 2;
+        slot = (int *) realloc(p->slot, nslot * sizeof(int));
+        if (!slot) luaL_error(L, "not enough memory");
+        for (i = p->nslot; i < nslot; i++) slot[i] = -1;
+        p->slot = slot;
+        p->nslot = nslot;
+    }
+    if (p->n == p->cap) {
+        int cap = p->cap > 0? p->cap * 2: 16;
+        struct pollfd *fds = (struct pollfd *)
+            realloc(p->fds, cap * sizeof(struct pollfd));
+        p_buffer *bufs;
+        if (!fds) luaL_error(L, "not enough memory");
+        p->fds = fds;
+        bufs = (p_buffer *) realloc(p->bufs, cap * sizeof(p_buffer));
+        if (!bufs) luaL_error(L, "not enough memory");
+        p->bufs = bufs;
+        p->cap = cap;
+    }
+#ifdef SELECT_EPOLL
+    {
+        int err = poller_ctl(p, EPOLL_CTL_ADD, fd, ev);
+        if (err != IO_DONE) {
+            lua_pushnil(L);
+            lua_pushstring(L, socket_strerror(err));
+            return 2;
+        }
+    }
+#endif
+    {
+        p_tcp tcp = lua_isuserdata(L, 2)?
+            (p_tcp) auxiliar_getgroupudata(L, "tcp{any}", 2): NULL;
+        p->fds[p->n].fd = fd;
+        p->fds[p->n].events = (short) (((ev & POLLER_R)? POLLIN: 0) |
+            ((ev & POLLER_W)? POLLOUT: 0));
+        p->fds[p->n].revents = 0;
+        p->bufs[p->n] = tcp? &tcp->buf: NULL;
+        p->slot[fd] = p->n++;
+    }
+    lua_getiuservalue(L, 1, 1);
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, -2, fd);
+    lua_pushnumber(L, 1);
+    return 1;
+}
+
+static int poller_meth_modify(lua_State *L) {
+    p_poller p = poller_check(L);
+    t_socket fd = poller_getfd(L, 2);
+    int ev = poller_events(L, 3);
+    if (fd >= p->nslot || p->slot[fd] < 0)
+        luaL_argerror(L, 2, "descriptor not registered");
+#ifdef SELECT_EPOLL
+    {
+        int err = poller_ctl(p, EPOLL_CTL_MOD, fd, ev);
+        if (err != IO_DONE) {
+            lua_pushnil(L);
+            lua_pushstring(L, socket_strerror(err));
+            return 2;
+        }
+    }
+#endif
+    p->fds[p->slot[fd]].events = (short) (((ev & POLLER_R)? POLLIN: 0) |
+        ((ev & POLLER_W)? POLLOUT: 0));
+    lua_pushnumber(L, 1);
+    return 1;
+}
+
+/* descriptor under which the object at idx was registered, or -1 */
+static t_socket poller_findfd(lua_State *L, int idx) {
+    t_socket fd = SOCKET_INVALID;
+    lua_getiuservalue(L, 1, 1);
+    lua_pushnil(L);
+    while (lua_next(L, -2)) {
+        if (lua_rawequal(L, -1, idx)) {
+            fd = (t_socket) lua_tointeger(L, -2);
+            lua_pop(L, 2);
+            break;
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+    return fd;
+}
+
+static int poller_meth_remove(lua_State *L) {
+    p_poller p = poller_check(L);
+    t_socket fd;
+    int i, last;
+    /* a socket closed before removal no longer knows its descriptor */
+    if (lua_type(L, 2) == LUA_TNUMBER) fd = poller_getfd(L, 2);
+    else {
+        lua_pushvalue(L, 2);
+        fd = getfd(L);
+        lua_pop(L, 1);
+        if (fd == SOCKET_INVALID) fd = poller_findfd(L, 2);
+    }
+    if (fd < 0 || fd >= p->nslot || p->slot[fd] < 0) {
+        lua_pushnil(L);
+        lua_pushstring(L, "not registered");
+        return 2;
+    }
+#ifdef SELECT_EPOLL
+    /* fails harmlessly if the descriptor was already closed */
+    epoll_ctl(p->epfd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+    /* move the last entry into the hole to keep the set dense */
+    i = p->slot[fd];
+    last = --p->n;
+    if (i != last) {
+        p->fds[i] = p->fds[last];
+        p->bufs[i] = p->bufs[last];
+        p->slot[p->fds[i].fd] = i;
+    }
+    p->slot[fd] = -1;
+    lua_getiuservalue(L, 1, 1);
+    lua_pushnil(L);
+    lua_rawseti(L, -2, fd);
+    lua_pushnumber(L, 1);
+    return 1;
+}
+
+static int poller_meth_count(lua_State *L) {
+    p_poller p = poller_check(L);
+    lua_pushinteger(L, p->n);
+    return 1;
+}
+
+static int poller_meth_close(lua_State *L) {
+    p_poller p = (p_poller) auxiliar_checkclass(L, "poller{object}", 1);
+#ifdef SELECT_EPOLL
+    if (p->epfd >= 0) close(p->epfd);
+    free(p->events);
+    p->events = NULL;
+#endif
+    free(p->fds);
+    free(p->bufs);
+    free(p->slot);
+    memset(p, 0, sizeof(t_poller));
+    p->epfd = -1;
+    p->cap = -1;
+    lua_pushnumber(L, 1);
+    return 1;
+}
+
+static void poller_push(lua_State *L, int otab, int tab, int *n, t_socket fd) {
+    lua_pushnumber(L, ++(*n));
+    lua_rawgeti(L, otab, fd);
+    lua_settable(L, tab);
+}
+
+/*-------------------------------------------------------------------------*\
+* Waits until a registered socket is ready or the timeout expires. Returns
+* the readable and writable sockets like socket.select does. Sockets that
+* already hold buffered input are reported as readable without blocking.
+\*-------------------------------------------------------------------------*/
+static int poller_meth_wait(lua_State *L) {
+    p_poller p = poller_check(L);
+    double t = luaL_optnumber(L, 2, -1);
+    int otab, rtab, wtab, ret, i, nr = 0, nw = 0;
+    t_timeout tm;
+    lua_settop(L, 2);
+    lua_getiuservalue(L, 1, 1); otab = lua_gettop(L);
+    lua_newtable(L); rtab = lua_gettop(L);
+    lua_newtable(L); wtab = lua_gettop(L);
+    /* data already buffered by receive() does not show up in the kernel */
+    for (i = 0; i < p->n; i++) {
+        if ((p->fds[i].events & POLLIN) && p->bufs[i] && !buffer_isempty(p->bufs[i]))
+            poller_push(L, otab, rtab, &nr, p->fds[i].fd);
+    }
+    timeout_init(&tm, nr > 0? 0.0: t, -1);
+    timeout_markstart(&tm);
+#ifdef SELECT_EPOLL
+    if (p->nevents < p->n) {
+        int nevents = p->n < 16? 16: p->n;
+        struct epoll_event *events = (struct epoll_event *)
+            realloc(p->events, nevents * sizeof(struct epoll_event));
+        if (!events) luaL_error(L, "not enough memory");
+        p->events = events;
+        p->nevents = nevents;
+    }
+    do {
+        double r = timeout_getretry(&tm);
+        ret = epoll_wait(p->epfd, p->events, p->nevents > 0? p->nevents: 1,
+            r >= 0.0? (int) (r * 1.0e3): -1);
+    } while (ret < 0 && errno == EINTR);
+    for (i = 0; i < ret; i++) {
+        t_socket fd = p->events[i].data.fd;
+        int s;
+        uint32_t e = p->events[i].events;
+        if (fd >= p->nslot || (s = p->slot[fd]) < 0) continue;
+        if ((p->fds[s].events & POLLIN) && (e & (EPOLLIN|EPOLLHUP|EPOLLERR))
+                && !(p->bufs[s] && !buffer_isempty(p->bufs[s])))
+            poller_push(L, otab, rtab, &nr, fd);
+        if ((p->fds[s].events & POLLOUT) && (e & (EPOLLOUT|EPOLLHUP|EPOLLERR)))
+            poller_push(L, otab, wtab, &nw, fd);
+    }
+#else
+    ret = socket_poll(p->fds, p->n, &tm);
+    for (i = 0; ret > 0 && i < p->n; i++) {
+        short e = p->fds[i].revents;
+        if (e == 0 || (e & POLLNVAL)) continue;
+        if ((p->fds[i].events & POLLIN) && (e & (POLLIN|POLLHUP|POLLERR))
+                && !(p->bufs[i] && !buffer_isempty(p->bufs[i])))
+            poller_push(L, otab, rtab, &nr, p->fds[i].fd);
+        if ((p->fds[i].events & POLLOUT) && (e & (POLLOUT|POLLHUP|POLLERR)))
+            poller_push(L, otab, wtab, &nw, p->fds[i].fd);
+    }
+#endif
+    if (nr > 0 || nw > 0) {
+        make_assoc(L, rtab);
+        make_assoc(L, wtab);
+        return 2;
+    } else if (ret >= 0) {
+        lua_pushstring(L, "timeout");
+        return 3;
+    } else {
+        lua_pushnil(L);
+        lua_pushnil(L);
+        lua_pushstring(L, socket_strerror(errno));
+        return 3;
+    }
+}
+#endif
@@ -120,6 +120,7 @@ static int meth_close(lua_State *L)
 {
     p_unix un = (p_unix) auxiliar_checkgroup(L, "serial{any}", 1);
     socket_destroy(&un->sock);
+    buffer_destroy(&un->buf);
     lua_pushnumber(L, 1);
     return 1;
 }
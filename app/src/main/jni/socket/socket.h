@@ -33,6 +33,20 @@
 /* convenient shorthand */
 typedef struct sockaddr SA;
 
+#ifndef _WIN32
+/* most datagrams moved by one batched send or receive */
+#define SOCKET_MAXDGRAMS 64
+
+/* one datagram for batched send and receive */
+typedef struct t_dgram_ {
+    char *data;         /* datagram contents */
+    size_t count;       /* size of the datagram (of the buffer on receive) */
+    SA *addr;           /* peer address, or NULL on connected sockets */
+    socklen_t addr_len; /* size of the address (of its buffer on receive) */
+    int truncated;      /* received datagram did not fit in the buffer */
+} t_dgram;
+#endif
+
 /*==============================================================*\
 * Functions bellow implement a comfortable platform independent 
 * interface to sockets
@@ -47,6 +61,14 @@ int socket_open(void);
 int socket_close(void);
 void socket_destroy(p_socket ps);
 int socket_select(t_socket n, fd_set *rfds, fd_set *wfds, fd_set *efds, p_timeout tm);
+#ifndef _WIN32
+struct pollfd;
+int socket_poll(struct pollfd *fds, int nfds, p_timeout tm);
+int socket_sendv(p_socket ps, const t_iovec *iov, int n, size_t *sent, p_timeout tm);
+int socket_sendfile(p_socket ps, int fd, long long offset, size_t count, size_t *sent, p_timeout tm);
+int socket_recvmmsg(p_socket ps, t_dgram *dgrams, int n, int *got, p_timeout tm);
+int socket_sendmmsg(p_socket ps, const t_dgram *dgrams, int n, int *sent, p_timeout tm);
+#endif
 int socket_create(p_socket ps, int domain, int type, int protocol);
 int socket_bind(p_socket ps, SA *addr, socklen_t addr_len); 
 int socket_listen(p_socket ps, int backlog);
@@ -10,7 +10,11 @@
 #include "options.h"
 #include "tcp.h"
 
+#include <errno.h>
 #include <string.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 /*==============================================================*\
 * Internal function prototypes
@@ -39,6 +43,13 @@ static int meth_settimeout(lua_State *L);
 static int meth_getfd(lua_State *L);
 static int meth_setfd(lua_State *L);
 static int meth_dirty(lua_State *L);
+static int meth_receiveinto(lua_State *L);
+static int meth_sendv(lua_State *L);
+static int meth_setbuffersize(lua_State *L);
+static int meth_getbuffersize(lua_State *L);
+#ifndef _WIN32
+static int meth_sendfile(lua_State *L);
+#endif
 
 /* tcp object methods */
 static luaL_Reg tcp_methods[] = {
@@ -49,6 +60,7 @@ static luaL_Reg tcp_methods[] = {
     {"close",       meth_close},
     {"connect",     meth_connect},
     {"dirty",       meth_dirty},
+    {"getbuffersize", meth_getbuffersize},
     {"getfamily",   meth_getfamily},
     {"getfd",       meth_getfd},
     {"getoption",   meth_getoption},
@@ -58,7 +70,13 @@ static luaL_Reg tcp_methods[] = {
     {"setstats",    meth_setstats},
     {"listen",      meth_listen},
     {"receive",     meth_receive},
+    {"receive_into", meth_receiveinto},
     {"send",        meth_send},
+#ifndef _WIN32
+    {"sendfile",    meth_sendfile},
+#endif
+    {"sendv",       meth_sendv},
+    {"setbuffersize", meth_setbuffersize},
     {"setfd",       meth_setfd},
     {"setoption",   meth_setoption},
     {"setpeername", meth_connect},
@@ -166,6 +184,74 @@ static int meth_receive(lua_State *L) {
     return buffer_meth_receive(L, &tcp->buf);
 }
 
+static int meth_receiveinto(lua_State *L) {
+    p_tcp tcp = (p_tcp) auxiliar_checkclass(L, "tcp{client}", 1);
+    return buffer_meth_receiveinto(L, &tcp->buf);
+}
+
+static int meth_sendv(lua_State *L) {
+    p_tcp tcp = (p_tcp) auxiliar_checkclass(L, "tcp{client}", 1);
+    return buffer_meth_sendv(L, &tcp->buf);
+}
+
+static int meth_setbuffersize(lua_State *L) {
+    p_tcp tcp = (p_tcp) auxiliar_checkgroup(L, "tcp{any}", 1);
+    return buffer_meth_setsize(L, &tcp->buf);
+}
+
+static int meth_getbuffersize(lua_State *L) {
+    p_tcp tcp = (p_tcp) auxiliar_checkgroup(L, "tcp{any}", 1);
+    return buffer_meth_getsize(L, &tcp->buf);
+}
+
+#ifndef _WIN32
+/*-------------------------------------------------------------------------*\
+* Sends a region of a file, given as a Lua file handle or a descriptor.
+* The whole rest of the file is sent when no length is given.
+\*-------------------------------------------------------------------------*/
+static int meth_sendfile(lua_State *L) {
+    p_tcp tcp = (p_tcp) auxiliar_checkclass(L, "tcp{client}", 1);
+    int top = lua_gettop(L);
+    int fd, err;
+    lua_Integer offset = luaL_optinteger(L, 3, 0);
+    size_t sent = 0, count;
+    luaL_Stream *stream = (luaL_Stream *) luaL_testudata(L, 2, LUA_FILEHANDLE);
+    if (stream) {
+        luaL_argcheck(L, stream->closef != NULL && stream->f != NULL, 2,
+            "attempt to use a closed file");
+        fd = fileno(stream->f);
+    } else fd = (int) luaL_checkinteger(L, 2);
+    luaL_argcheck(L, offset >= 0, 3, "invalid offset");
+    if (lua_isnoneornil(L, 4)) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            lua_pushnil(L);
+            lua_pushstring(L, socket_strerror(errno));
+            return 2;
+        }
+        count = st.st_size > offset? (size_t) (st.st_size - offset): 0;
+    } else {
+        lua_Integer len = luaL_checkinteger(L, 4);
+        luaL_argcheck(L, len >= 0, 4, "invalid length");
+        count = (size_t) len;
+    }
+    timeout_markstart(&tcp->tm);
+    err = socket_sendfile(&tcp->sock, fd, (long long) offset, count, &sent,
+        &tcp->tm);
+    tcp->buf.sent += sent;
+    if (err != IO_DONE) {
+        lua_pushnil(L);
+        lua_pushstring(L, socket_ioerror(&tcp->sock, err));
+        lua_pushnumber(L, (lua_Number) sent);
+    } else {
+        lua_pushnumber(L, (lua_Number) sent);
+        lua_pushnil(L);
+        lua_pushnil(L);
+    }
+    return lua_gettop(L) - top;
+}
+#endif
+
 static int meth_getstats(lua_State *L) {
     p_tcp tcp = (p_tcp) auxiliar_checkclass(L, "tcp{client}", 1);
     return buffer_meth_getstats(L, &tcp->buf);
@@ -236,6 +322,9 @@ static int meth_accept(lua_State *L)
         clnt->sock = sock;
         io_init(&clnt->io, (p_send) socket_send, (p_recv) socket_recv,
                 (p_error) socket_ioerror, &clnt->sock);
+#ifndef _WIN32
+        clnt->io.sendv = (p_sendv) socket_sendv;
+#endif
         timeout_init(&clnt->tm, -1, -1);
         buffer_init(&clnt->buf, &clnt->io, &clnt->tm);
         clnt->family = server->family;
@@ -304,6 +393,7 @@ static int meth_close(lua_State *L)
 {
     p_tcp tcp = (p_tcp) auxiliar_checkgroup(L, "tcp{any}", 1);
     socket_destroy(&tcp->sock);
+    buffer_destroy(&tcp->buf);
     lua_pushnumber(L, 1);
     return 1;
 }
@@ -407,6 +497,9 @@ static int tcp_create(lua_State *L, int family) {
     tcp->family = family;
     io_init(&tcp->io, (p_send) socket_send, (p_recv) socket_recv,
             (p_error) socket_ioerror, &tcp->sock);
+#ifndef _WIN32
+    tcp->io.sendv = (p_sendv) socket_sendv;
+#endif
     timeout_init(&tcp->tm, -1, -1);
     buffer_init(&tcp->buf, &tcp->io, &tcp->tm);
     if (family != AF_UNSPEC) {
@@ -446,6 +539,9 @@ static int global_connect(lua_State *L) {
     memset(tcp, 0, sizeof(t_tcp));
     io_init(&tcp->io, (p_send) socket_send, (p_recv) socket_recv,
             (p_error) socket_ioerror, &tcp->sock);
+#ifndef _WIN32
+    tcp->io.sendv = (p_sendv) socket_sendv;
+#endif
     timeout_init(&tcp->tm, -1, -1);
     buffer_init(&tcp->buf, &tcp->io, &tcp->tm);
     tcp->sock = SOCKET_INVALID;
@@ -0,0 +1,132 @@
+-- udp:receivebatch and udp:sendbatch
+local socket = require "socket"
+
+local function pair()
+	local a = assert(socket.udp())
+	assert(a:setsockname("127.0.0.1", 0))
+	local b = assert(socket.udp())
+	assert(b:setsockname("127.0.0.1", 0))
+	a:settimeout(1)
+	b:settimeout(1)
+	return a, b
+end
+
+do print("unconnected")
+	local a, b = pair()
+	local ip, port = a:getsockname()
+	local _, bport = b:getsockname()
+	local list = {}
+	for i = 1, 40 do list[i] = { "msg" .. i, ip, port } end
+	list[41] = { "", ip, tostring(port) }
+	list[42] = { 42, ip, port }  -- numbers are sent as strings
+	assert(b:sendbatch(list) == 42)
+	local got = {}
+	while #got < 42 do
+		local part = assert(a:receivebatch())
+		assert(#part > 0 and #part <= 64)
+		for _, d in ipairs(part) do got[#got + 1] = d end
+	end
+	for i = 1, 40 do
+		assert(got[i][1] == "msg" .. i)
+		assert(got[i][2] == "127.0.0.1" and got[i][3] == bport)
+		assert(got[i].truncated == nil)
+	end
+	assert(got[41][1] == "" and got[42][1] == "42")
+	-- nothing queued: the timeout applies to the first datagram
+	a:settimeout(0.05)
+	local none, err = a:receivebatch()
+	assert(none == nil and err == "timeout")
+	-- the batch size limits how many are taken
+	assert(b:sendbatch{ { "1", ip, port }, { "2", ip, port }, { "3", ip, port } } == 3)
+	a:settimeout(1)
+	local part = assert(a:receivebatch(2))
+	assert(#part == 2 and part[1][1] == "1" and part[2][1] == "2")
+	part = assert(a:receivebatch(2))
+	assert(#part == 1 and part[1][1] == "3")
+	a:close()
+	b:close()
+end
+
+do print("truncated datagrams")
+	local a, b = pair()
+	local ip, port = a:getsockname()
+	assert(b:sendbatch{
+		{ "short", ip, port },
+		{ string.rep("x", 100), ip, port },
+		{ "exactly16bytes!!", ip, port },
+	} == 3)
+	local got = {}
+	while #got < 3 do
+		for _, d in ipairs(assert(a:receivebatch(8, 16))) do got[#got + 1] = d end
+	end
+	assert(got[1][1] == "short" and not got[1].truncated)
+	assert(got[2][1] == string.rep("x", 16) and got[2].truncated == true)
+	assert(got[3][1] == "exactly16bytes!!" and not got[3].truncated)
+	a:close()
+	b:close()
+end
+
+do print("connected")
+	local a, b = pair()
+	local ip, port = a:getsockname()
+	local bip, bport = b:getsockname()
+	assert(b:setpeername(ip, port))
+	assert(a:setpeername(bip, bport))
+	assert(b:sendbatch{ "x", "y", 7, string.rep("z", 40) } == 4)
+	local got = {}
+	while #got < 4 do
+		for _, d in ipairs(assert(a:receivebatch(8, 32))) do got[#got + 1] = d end
+	end
+	assert(got[1][1] == "x" and got[2][1] == "y" and got[3][1] == "7")
+	assert(got[1][2] == nil)
+	assert(#got[4][1] == 32 and got[4].truncated)
+	local ok, err = pcall(b.sendbatch, b, { "a", {} })
+	assert(not ok and err:find("datagrams must be strings", 1, true))
+	a:close()
+	b:close()
+end
+
+do print("argument errors")
+	local a, b = pair()
+	local ip, port = a:getsockname()
+	local list = {}
+	for i = 1, 65 do list[i] = { "x", ip, port } end
+	assert(not pcall(b.sendbatch, b, list))
+	assert(not pcall(b.sendbatch, b, { "not a table" }))
+	assert(not pcall(b.sendbatch, b, { { {}, ip, port } }))
+	assert(not pcall(b.sendbatch, b, { { "x", {}, port } }))
+	local none, err = b:sendbatch{ { "x", "not an ip", port } }
+	assert(none == nil and err)
+	assert(not pcall(a.receivebatch, a, 0))
+	assert(not pcall(a.receivebatch, a, 65))
+	assert(not pcall(a.receivebatch, a, 1, 0))
+	a:close()
+	b:close()
+	none, err = a:receivebatch()
+	assert(none == nil and err)
+end
+
+do print("collected data stays valid while sending")
+	local a, b = pair()
+	local ip, port = a:getsockname()
+	for round = 1, 20 do
+		local list = {}
+		for i = 1, 64 do
+			-- numbers turn into fresh strings only the stack refers to
+			list[i] = { round * 1000 + i, ip, port }
+		end
+		collectgarbage()
+		assert(b:sendbatch(list) == 64)
+		local n = 0
+		while n < 64 do
+			for _, d in ipairs(assert(a:receivebatch())) do
+				n = n + 1
+				assert(d[1] == tostring(round * 1000 + n))
+			end
+		end
+	end
+	a:close()
+	b:close()
+end
+
+print("OK")
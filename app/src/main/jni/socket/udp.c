@@ -44,6 +44,10 @@ static int meth_settimeout(lua_State *L);
 static int meth_getfd(lua_State *L);
 static int meth_setfd(lua_State *L);
 static int meth_dirty(lua_State *L);
+#ifndef _WIN32
+static int meth_receivebatch(lua_State *L);
+static int meth_sendbatch(lua_State *L);
+#endif
 
 /* udp object methods */
 static luaL_Reg udp_methods[] = {
@@ -57,6 +61,10 @@ static luaL_Reg udp_methods[] = {
     {"getsockname", meth_getsockname},
     {"receive",     meth_receive},
     {"receivefrom", meth_receivefrom},
+#ifndef _WIN32
+    {"receivebatch", meth_receivebatch},
+    {"sendbatch",   meth_sendbatch},
+#endif
     {"send",        meth_send},
     {"sendto",      meth_sendto},
     {"setfd",       meth_setfd},
@@ -301,6 +309,187 @@ static int meth_receivefrom(lua_State *L) {
     return 3;
 }
 
+#ifndef _WIN32
+/*-------------------------------------------------------------------------*\
+* Pushes the numeric host and the port of a peer address
+\*-------------------------------------------------------------------------*/
+static void udp_pushaddr(lua_State *L, SA *addr) {
+    char addrstr[INET6_ADDRSTRLEN];
+    int port = 0;
+    addrstr[0] = '\0';
+    if (addr->sa_family == AF_INET) {
+        struct sockaddr_in *in = (struct sockaddr_in *) addr;
+        inet_ntop(AF_INET, &in->sin_addr, addrstr, sizeof(addrstr));
+        port = ntohs(in->sin_port);
+    } else if (addr->sa_family == AF_INET6) {
+        struct sockaddr_in6 *in6 = (struct sockaddr_in6 *) addr;
+        inet_ntop(AF_INET6, &in6->sin6_addr, addrstr, sizeof(addrstr));
+        port = ntohs(in6->sin6_port);
+    }
+    lua_pushstring(L, addrstr);
+    lua_pushinteger(L, port);
+}
+
+/*-------------------------------------------------------------------------*\
+* Receives up to n datagrams of up to size bytes each, waiting only for
+* the first. Returns a list of {data, ip, port} entries ({data} on
+* connected sockets); entries whose datagram did not fit in size bytes
+* have truncated = true.
+\*-------------------------------------------------------------------------*/
+static int meth_receivebatch(lua_State *L) {
+    p_udp udp = (p_udp) auxiliar_checkgroup(L, "udp{any}", 1);
+    int connected = auxiliar_getclassudata(L, "udp{connected}", 1) != NULL;
+    lua_Integer n = luaL_optinteger(L, 2, SOCKET_MAXDGRAMS);
+    lua_Integer size = luaL_optinteger(L, 3, UDP_DATAGRAMSIZE);
+    t_dgram dgrams[SOCKET_MAXDGRAMS];
+    struct sockaddr_storage addrs[SOCKET_MAXDGRAMS];
+    p_timeout tm = &udp->tm;
+    int i, got, err;
+    luaL_argcheck(L, n > 0 && n <= SOCKET_MAXDGRAMS, 2, "out of range");
+    luaL_argcheck(L, size > 0 && size <= 65536, 3, "out of range");
+    if (udp->batchsize < (size_t) (n * size)) {
+        char *batch = (char *) realloc(udp->batch, (size_t) (n * size));
+        if (!batch) {
+            lua_pushnil(L);
+            lua_pushliteral(L, "out of memory");
+            return 2;
+        }
+        udp->batch = batch;
+        udp->batchsize = (size_t) (n * size);
+    }
+    for (i = 0; i < n; i++) {
+        dgrams[i].data = udp->batch + i * size;
+        dgrams[i].count = (size_t) size;
+        dgrams[i].addr = connected? NULL: (SA *) &addrs[i];
+        dgrams[i].addr_len = sizeof(addrs[i]);
+    }
+    timeout_markstart(tm);
+    err = socket_recvmmsg(&udp->sock, dgrams, (int) n, &got, tm);
+    if (err != IO_DONE) {
+        lua_pushnil(L);
+        lua_pushstring(L, udp_strerror(err));
+        return 2;
+    }
+    lua_createtable(L, got, 0);
+    for (i = 0; i < got; i++) {
+        lua_createtable(L, connected? 1: 3, dgrams[i].truncated);
+        lua_pushlstring(L, dgrams[i].data, dgrams[i].count);
+        lua_rawseti(L, -2, 1);
+        if (!connected) {
+            udp_pushaddr(L, dgrams[i].addr);
+            lua_rawseti(L, -3, 3);
+            lua_rawseti(L, -2, 2);
+        }
+        if (dgrams[i].truncated) {
+            lua_pushboolean(L, 1);
+            lua_setfield(L, -2, "truncated");
+        }
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
+/*-------------------------------------------------------------------------*\
+* Sends a list of datagrams in one call: {data, ip, port} entries on
+* unconnected sockets, strings on connected ones. Returns how many were
+* sent, which can be fewer than given when the socket buffer fills up.
+\*-------------------------------------------------------------------------*/
+static int meth_sendbatch(lua_State *L) {
+    p_udp udp = (p_udp) auxiliar_checkgroup(L, "udp{any}", 1);
+    int connected = auxiliar_getclassudata(L, "udp{connected}", 1) != NULL;
+    t_dgram dgrams[SOCKET_MAXDGRAMS];
+    struct sockaddr_storage addrs[SOCKET_MAXDGRAMS];
+    p_timeout tm = &udp->tm;
+    int i, n, sent, err;
+    int top;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    n = (int) lua_rawlen(L, 2);
+    luaL_argcheck(L, n <= SOCKET_MAXDGRAMS, 2, "too many datagrams");
+    luaL_checkstack(L, n + 8, "too many datagrams");
+    /* the stack keeps the previous peer, then each data until it is sent */
+    top = lua_gettop(L);
+    lua_pushnil(L);
+    lua_pushnil(L);
+    for (i = 0; i < n; i++) {
+        t_dgram *d = &dgrams[i];
+        int e = lua_gettop(L) + 1;
+        lua_rawgeti(L, 2, i + 1);
+        if (connected) {
+            d->data = (char *) lua_tolstring(L, e, &d->count);
+            luaL_argcheck(L, d->data != NULL, 2, "datagrams must be strings");
+            d->addr = NULL;
+            d->addr_len = 0;
+            continue;
+        }
+        luaL_argcheck(L, lua_istable(L, e), 2,
+            "datagrams must be {data, ip, port} tables");
+        lua_rawgeti(L, e, 1);
+        lua_rawgeti(L, e, 2);
+        lua_rawgeti(L, e, 3);
+        d->data = (char *) lua_tolstring(L, e + 1, &d->count);
+        luaL_argcheck(L, d->data != NULL, 2, "datagram data must be a string");
+        d->addr = (SA *) &addrs[i];
+        /* runs of datagrams to the same peer resolve it once */
+        if (i > 0 && lua_rawequal(L, e + 2, top + 1)
+                && lua_rawequal(L, e + 3, top + 2)) {
+            memcpy(&addrs[i], &addrs[i - 1], dgrams[i - 1].addr_len);
+            d->addr_len = dgrams[i - 1].addr_len;
+        } else {
+            struct addrinfo aihint, *ai;
+            const char *ip, *port;
+            lua_pushvalue(L, e + 2);
+            lua_pushvalue(L, e + 3);
+            ip = lua_tostring(L, -2);
+            port = lua_tostring(L, -1);
+            luaL_argcheck(L, ip != NULL && port != NULL, 2,
+                "invalid datagram address");
+            memset(&aihint, 0, sizeof(aihint));
+            aihint.ai_family = udp->family;
+            aihint.ai_socktype = SOCK_DGRAM;
+            aihint.ai_flags = AI_NUMERICHOST;
+#ifdef AI_NUMERICSERV
+            aihint.ai_flags |= AI_NUMERICSERV;
+#endif
+            err = getaddrinfo(ip, port, &aihint, &ai);
+            if (err) {
+                lua_pushnil(L);
+                lua_pushstring(L, LUA_GAI_STRERROR(err));
+                return 2;
+            }
+            memcpy(&addrs[i], ai->ai_addr, ai->ai_addrlen);
+            d->addr_len = (socklen_t) ai->ai_addrlen;
+            freeaddrinfo(ai);
+            lua_pop(L, 2);
+        }
+        lua_replace(L, top + 2);
+        lua_replace(L, top + 1);
+        lua_remove(L, e);  /* leaves the data in its place */
+    }
+    /* create socket on first send if AF_UNSPEC was set */
+    if (udp->family == AF_UNSPEC && udp->sock == SOCKET_INVALID && n > 0
+            && !connected) {
+        const char *errstr = inet_trycreate(&udp->sock,
+            dgrams[0].addr->sa_family, SOCK_DGRAM, 0);
+        if (errstr != NULL) {
+            lua_pushnil(L);
+            lua_pushstring(L, errstr);
+            return 2;
+        }
+        socket_setnonblocking(&udp->sock);
+        udp->family = dgrams[0].addr->sa_family;
+    }
+    timeout_markstart(tm);
+    err = socket_sendmmsg(&udp->sock, dgrams, n, &sent, tm);
+    if (err != IO_DONE) {
+        lua_pushnil(L);
+        lua_pushstring(L, udp_strerror(err));
+        return 2;
+    }
+    lua_pushinteger(L, sent);
+    return 1;
+}
+#endif
+
 /*-------------------------------------------------------------------------*\
 * Returns family as string
 \*-------------------------------------------------------------------------*/
@@ -420,6 +609,9 @@ static int meth_setpeername(lua_State *L) {
 static int meth_close(lua_State *L) {
     p_udp udp = (p_udp) auxiliar_checkgroup(L, "udp{any}", 1);
     socket_destroy(&udp->sock);
+    free(udp->batch);
+    udp->batch = NULL;
+    udp->batchsize = 0;
     lua_pushnumber(L, 1);
     return 1;
 }
@@ -463,6 +655,8 @@ static int udp_create(lua_State *L, int family) {
     udp->sock = SOCKET_INVALID;
     timeout_init(&udp->tm, -1, -1);
     udp->family = family;
+    udp->batch = NULL;
+    udp->batchsize = 0;
     if (family != AF_UNSPEC) {
         const char *err = inet_trycreate(&udp->sock, family, SOCK_DGRAM, 0);
         if (err != NULL) {
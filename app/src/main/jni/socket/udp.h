@@ -25,6 +25,8 @@ typedef struct t_udp_ {
     t_socket sock;
     t_timeout tm;
     int family;
+    char *batch;        /* datagram buffers kept for receivebatch */
+    size_t batchsize;
 } t_udp;
 typedef t_udp *p_udp;
 
@@ -6,6 +6,9 @@
 * The penalty of calling select to avoid busy-wait is only paid when
 * the I/O call fail in the first place.
 \*==============================================================*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* recvmmsg and sendmmsg */
+#endif
 #include "luasocket.h"
 
 #include "socket.h"
@@ -13,6 +16,22 @@
 
 #include <string.h>
 #include <signal.h>
+#include <poll.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#if defined(__linux__) || defined(__ANDROID__)
+#include <sys/sendfile.h>
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* recvmmsg(2) and sendmmsg(2) move several datagrams per system call */
+#if defined(__linux__) && (!defined(__ANDROID__) || __ANDROID_API__ >= 21)
+#define SOCKET_MMSG
+#endif
 
 /*-------------------------------------------------------------------------*\
 * Wait for readable/writable/connected socket with timeout
@@ -117,6 +136,19 @@ int socket_select(t_socket n, fd_set *rfds, fd_set *wfds, fd_set *efds,
     return ret;
 }
 
+/*-------------------------------------------------------------------------*\
+* Poll with timeout control
+\*-------------------------------------------------------------------------*/
+int socket_poll(struct pollfd *fds, int nfds, p_timeout tm) {
+    int ret;
+    do {
+        double t = timeout_getretry(tm);
+        /* timeout = 0 means no wait */
+        ret = poll(fds, (nfds_t) nfds, t >= 0.0? (int) (t * 1.0e3): -1);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
 /*-------------------------------------------------------------------------*\
 * Creates and sets up a socket
 \*-------------------------------------------------------------------------*/
@@ -226,6 +258,209 @@ int socket_send(p_socket ps, const char *data, size_t count,
     return IO_UNKNOWN;
 }
 
+/*-------------------------------------------------------------------------*\
+* Vectored send with timeout
+\*-------------------------------------------------------------------------*/
+int socket_sendv(p_socket ps, const t_iovec *iov, int n, size_t *sent,
+        p_timeout tm)
+{
+    struct iovec vec[64];
+    int i, err;
+    *sent = 0;
+    if (*ps == SOCKET_INVALID) return IO_CLOSED;
+    if (n > 64) n = 64;
+    if (n > IOV_MAX) n = IOV_MAX;
+    for (i = 0; i < n; i++) {
+        vec[i].iov_base = (void *) iov[i].data;
+        vec[i].iov_len = iov[i].count;
+    }
+    for ( ;; ) {
+        long put = (long) writev(*ps, vec, n);
+        if (put >= 0) {
+            *sent = put;
+            return IO_DONE;
+        }
+        err = errno;
+        if (err == EPIPE) return IO_CLOSED;
+        if (err == EPROTOTYPE) continue;
+        if (err == EINTR) continue;
+        if (err != EAGAIN) return err;
+        if ((err = socket_waitfd(ps, WAITFD_W, tm)) != IO_DONE) return err;
+    }
+    return IO_UNKNOWN;
+}
+
+/*-------------------------------------------------------------------------*\
+* Receives up to n datagrams with timeout. Only the first one is waited
+* for; the others are those already queued on the socket.
+\*-------------------------------------------------------------------------*/
+int socket_recvmmsg(p_socket ps, t_dgram *dgrams, int n, int *got,
+        p_timeout tm)
+{
+    int err;
+    *got = 0;
+    if (*ps == SOCKET_INVALID) return IO_CLOSED;
+    if (n > SOCKET_MAXDGRAMS) n = SOCKET_MAXDGRAMS;
+#ifdef SOCKET_MMSG
+    {
+        struct mmsghdr msgs[SOCKET_MAXDGRAMS];
+        struct iovec vec[SOCKET_MAXDGRAMS];
+        int i;
+        memset(msgs, 0, n * sizeof(msgs[0]));
+        for (i = 0; i < n; i++) {
+            vec[i].iov_base = dgrams[i].data;
+            vec[i].iov_len = dgrams[i].count;
+            msgs[i].msg_hdr.msg_iov = &vec[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = dgrams[i].addr;
+            msgs[i].msg_hdr.msg_namelen = dgrams[i].addr? dgrams[i].addr_len: 0;
+        }
+        for ( ;; ) {
+            int taken = recvmmsg(*ps, msgs, (unsigned int) n, 0, NULL);
+            if (taken >= 0) {
+                for (i = 0; i < taken; i++) {
+                    dgrams[i].count = msgs[i].msg_len;
+                    dgrams[i].addr_len = msgs[i].msg_hdr.msg_namelen;
+                    dgrams[i].truncated =
+                        (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+                }
+                *got = taken;
+                return IO_DONE;
+            }
+            err = errno;
+            if (err == EINTR) continue;
+            /* kernel without recvmmsg: fall back to one call per datagram */
+            if (err == ENOSYS) break;
+            if (err != EAGAIN) return err;
+            if ((err = socket_waitfd(ps, WAITFD_R, tm)) != IO_DONE) return err;
+        }
+    }
+#endif
+    for ( ;; ) {
+        t_dgram *d = &dgrams[*got];
+        struct msghdr msg;
+        struct iovec vec;
+        long taken;
+        memset(&msg, 0, sizeof(msg));
+        vec.iov_base = d->data;
+        vec.iov_len = d->count;
+        msg.msg_iov = &vec;
+        msg.msg_iovlen = 1;
+        msg.msg_name = d->addr;
+        msg.msg_namelen = d->addr? d->addr_len: 0;
+        taken = (long) recvmsg(*ps, &msg, 0);
+        if (taken >= 0) {
+            d->count = (size_t) taken;
+            d->addr_len = msg.msg_namelen;
+            d->truncated = (msg.msg_flags & MSG_TRUNC) != 0;
+            if (++*got == n) return IO_DONE;
+            continue;
+        }
+        err = errno;
+        if (err == EINTR) continue;
+        if (*got > 0) return IO_DONE;
+        if (err != EAGAIN) return err;
+        if ((err = socket_waitfd(ps, WAITFD_R, tm)) != IO_DONE) return err;
+    }
+}
+
+/*-------------------------------------------------------------------------*\
+* Sends up to n datagrams with timeout. Waits only until the first one can
+* be sent; *sent tells how many went out.
+\*-------------------------------------------------------------------------*/
+int socket_sendmmsg(p_socket ps, const t_dgram *dgrams, int n, int *sent,
+        p_timeout tm)
+{
+    int err;
+    *sent = 0;
+    if (*ps == SOCKET_INVALID) return IO_CLOSED;
+    if (n > SOCKET_MAXDGRAMS) n = SOCKET_MAXDGRAMS;
+    if (n <= 0) return IO_DONE;
+#ifdef SOCKET_MMSG
+    {
+        struct mmsghdr msgs[SOCKET_MAXDGRAMS];
+        struct iovec vec[SOCKET_MAXDGRAMS];
+        int i;
+        memset(msgs, 0, n * sizeof(msgs[0]));
+        for (i = 0; i < n; i++) {
+            vec[i].iov_base = dgrams[i].data;
+            vec[i].iov_len = dgrams[i].count;
+            msgs[i].msg_hdr.msg_iov = &vec[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = dgrams[i].addr;
+            msgs[i].msg_hdr.msg_namelen = dgrams[i].addr? dgrams[i].addr_len: 0;
+        }
+        for ( ;; ) {
+            int put = sendmmsg(*ps, msgs, (unsigned int) n, 0);
+            if (put >= 0) {
+                *sent = put;
+                return IO_DONE;
+            }
+            err = errno;
+            if (err == EPIPE) return IO_CLOSED;
+            if (err == EINTR) continue;
+            if (err == ENOSYS) break;
+            if (err != EAGAIN) return err;
+            if ((err = socket_waitfd(ps, WAITFD_W, tm)) != IO_DONE) return err;
+        }
+    }
+#endif
+    for ( ;; ) {
+        const t_dgram *d = &dgrams[*sent];
+        long put = (long) sendto(*ps, d->data, d->count, 0, d->addr,
+            d->addr? d->addr_len: 0);
+        if (put >= 0) {
+            if (++*sent == n) return IO_DONE;
+            continue;
+        }
+        err = errno;
+        if (err == EINTR) continue;
+        if (*sent > 0) return IO_DONE;
+        if (err == EPIPE) return IO_CLOSED;
+        if (err != EAGAIN) return err;
+        if ((err = socket_waitfd(ps, WAITFD_W, tm)) != IO_DONE) return err;
+    }
+}
+
+/*-------------------------------------------------------------------------*\
+* Sends count bytes of file descriptor fd starting at offset, with timeout.
+* Uses sendfile(2) where available, so the data never enters user space.
+\*-------------------------------------------------------------------------*/
+int socket_sendfile(p_socket ps, int fd, long long offset, size_t count,
+        size_t *sent, p_timeout tm)
+{
+    int err;
+    *sent = 0;
+    if (*ps == SOCKET_INVALID) return IO_CLOSED;
+    while (*sent < count) {
+        long put;
+#if defined(__linux__) || defined(__ANDROID__)
+        off_t off = (off_t) (offset + (long long) *sent);
+        put = (long) sendfile(*ps, fd, &off, count - *sent);
+#else
+        char chunk[16384];
+        size_t want = count - *sent;
+        long got = (long) pread(fd, chunk, want < sizeof(chunk)? want:
+            sizeof(chunk), (off_t) (offset + (long long) *sent));
+        if (got < 0) return errno;
+        if (got == 0) return IO_DONE;
+        put = (long) send(*ps, chunk, (size_t) got, 0);
+#endif
+        if (put > 0) {
+            *sent += (size_t) put;
+            continue;
+        }
+        /* end of file reached before count bytes */
+        if (put == 0) return IO_DONE;
+        err = errno;
+        if (err == EPIPE) return IO_CLOSED;
+        if (err == EINTR) continue;
+        if (err != EAGAIN) return err;
+        if ((err = socket_waitfd(ps, WAITFD_W, tm)) != IO_DONE) return err;
+    }
+    return IO_DONE;
+}
+
 /*-------------------------------------------------------------------------*\
 * Sendto with timeout
 \*-------------------------------------------------------------------------*/
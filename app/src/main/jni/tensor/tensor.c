@@ -561,7 +561,8 @@ static Tensor* tensor_reduce(Tensor* tensor, int axis,
 }
 
 /**
- * @brief tensor.new(shape[, dtype]) - 创建张量
+ * @brief tensor.new(shape[, dtype[, data]]) - 创建张量
+ * data为可选的扁平数字表，按行优先顺序填充
  */
 static int l_tensor_new(lua_State* L) {
     int top = lua_gettop(L);
@@ -596,7 +597,26 @@ static int l_tensor_new(lua_State* L) {
         dtype_enum = TENSOR_INT64;
     }
     
-    tensor_create(L, ndims, shape, dtype_enum);
+    Tensor* tensor = tensor_create(L, ndims, shape, dtype_enum);
+    
+    if (top >= 3 && !lua_isnil(L, 3)) {
+        size_t n = (size_t)tensor->size;
+        switch (dtype_enum) {
+            case TENSOR_FLOAT64:
+                luaL_checkarrayn(L, 3, (lua_Number*)tensor->data, n);
+                break;
+            case TENSOR_INT64:
+                luaL_checkarrayi(L, 3, (lua_Integer*)tensor->data, n);
+                break;
+            default: {
+                lua_Number* tmp = (lua_Number*)lua_newuserdatauv(L, n * sizeof(lua_Number), 0);
+                luaL_checkarrayn(L, 3, tmp, n);
+                for (size_t i = 0; i < n; i++) tensor_set_value(tensor, (int64_t)i, tmp[i]);
+                lua_pop(L, 1);
+                break;
+            }
+        }
+    }
     return 1;
 }
 
@@ -1027,6 +1047,36 @@ static int l_tensor_reshape(lua_State* L) {
     return 1;
 }
 
+/**
+ * @brief 把从offset开始的n个连续元素作为数组表压栈
+ * float64/int64直接整段拷贝，其它类型先转换到临时缓冲区
+ */
+static void tensor_push_array(lua_State* L, Tensor* tensor, int64_t offset, int64_t n) {
+    switch (tensor->dtype) {
+        case TENSOR_FLOAT64:
+            lua_createarrayn(L, (const lua_Number*)tensor->data + offset, (size_t)n);
+            break;
+        case TENSOR_INT64:
+            lua_createarrayi(L, (const lua_Integer*)tensor->data + offset, (size_t)n);
+            break;
+        case TENSOR_INT32: {
+            lua_Integer* tmp = (lua_Integer*)lua_newuserdatauv(L, (size_t)n * sizeof(lua_Integer), 0);
+            const int32_t* src = (const int32_t*)tensor->data + offset;
+            for (int64_t i = 0; i < n; i++) tmp[i] = src[i];
+            lua_createarrayi(L, tmp, (size_t)n);
+            lua_remove(L, -2);
+            break;
+        }
+        default: {
+            lua_Number* tmp = (lua_Number*)lua_newuserdatauv(L, (size_t)n * sizeof(lua_Number), 0);
+            for (int64_t i = 0; i < n; i++) tmp[i] = tensor_get_value(tensor, offset + i);
+            lua_createarrayn(L, tmp, (size_t)n);
+            lua_remove(L, -2);
+            break;
+        }
+    }
+}
+
 /**
  * @brief tensor:tolist() - 转换为Lua表
  */
@@ -1034,22 +1084,11 @@ static int l_tensor_tolist(lua_State* L) {
     Tensor* tensor = luaL_check_tensor(L, 1);
     
     if (tensor->ndims == 1) {
-        lua_createtable(L, tensor->shape[0], 0);
-        for (int64_t i = 0; i < tensor->shape[0]; i++) {
-            double* ptr = (double*)tensor_get_element_ptr(tensor, i);
-            lua_pushnumber(L, *ptr);
-            lua_seti(L, -2, i + 1);
-        }
+        tensor_push_array(L, tensor, 0, tensor->shape[0]);
     } else if (tensor->ndims == 2) {
         lua_createtable(L, tensor->shape[0], 0);
         for (int64_t i = 0; i < tensor->shape[0]; i++) {
-            lua_createtable(L, tensor->shape[1], 0);
-            for (int64_t j = 0; j < tensor->shape[1]; j++) {
-                double* ptr = (double*)tensor_get_element_ptr(tensor, 
-                                                              i * tensor->shape[1] + j);
-                lua_pushnumber(L, *ptr);
-                lua_seti(L, -2, j + 1);
-            }
+            tensor_push_array(L, tensor, i * tensor->shape[1], tensor->shape[1]);
             lua_seti(L, -2, i + 1);
         }
     } else {
@@ -0,0 +1,47 @@
+/**
+ * @file tensor_types.h
+ * @brief 张量结构体与数据类型定义
+ *
+ * 只包含布局定义，不声明任何函数，其他模块（如lsqlite3）可以直接包含它
+ * 来构造与tensor模块兼容的Tensor userdata。
+ */
+
+#ifndef LUA_TENSOR_TYPES_H
+#define LUA_TENSOR_TYPES_H
+
+#include <stdint.h>
+
+#define TENSOR_MAX_DIMS 16
+
+/**
+ * @brief 张量数据类型枚举
+ */
+typedef enum {
+    TENSOR_INT8 = 0,
+    TENSOR_INT16,
+    TENSOR_INT32,
+    TENSOR_INT64,
+    TENSOR_UINT8,
+    TENSOR_UINT16,
+    TENSOR_UINT32,
+    TENSOR_UINT64,
+    TENSOR_FLOAT32,
+    TENSOR_FLOAT64,
+    TENSOR_BOOL
+} TensorDataType;
+
+/**
+ * @brief 张量结构体
+ */
+typedef struct {
+    int ndims;                          // 维度数量
+    int64_t shape[TENSOR_MAX_DIMS];     // 各维度大小
+    int64_t stride[TENSOR_MAX_DIMS];    // 各维度步长
+    TensorDataType dtype;               // 数据类型
+    void* data;                         // 数据指针
+    int64_t size;                       // 元素总数
+    int64_t itemsize;                   // 每个元素大小（字节）
+    int8_t owner;                       // 是否拥有数据所有权
+} Tensor;
+
+#endif /* LUA_TENSOR_TYPES_H */
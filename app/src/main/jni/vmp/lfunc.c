@@ -146,15 +146,12 @@ static void prepcallclosemth (lua_State *L, StkId level, TStatus status,
   TValue *errobj;
   
   switch (status){
-  	case CLOSEKTOP:
-  	errobj = &G(L)->nilvalue;  /* error object is nil */
-  	break;
-  	
     case LUA_OK:
           L->top.p = level + 1;  /* call will be at this level */
       /* FALLTHROUGH */
-    
-        break;
+  	case CLOSEKTOP:  /* don't need to change top */
+  	errobj = &G(L)->nilvalue;  /* error object is nil */
+  	break;
   default:  /* 'luaD_seterrorobj' will set top to level + 2 */
     errobj = s2v(level + 1);  /* error object goes after 'uv' */
     luaD_seterrorobj(L, status, level + 1);  /* set error object */
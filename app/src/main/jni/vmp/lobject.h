@@ -406,7 +406,7 @@ typedef struct GCObject {
 typedef struct TString {
   CommonHeader;
   lu_byte extra;  /* reserved words for short strings; "has hash" for longs */
-  lu_byte shrlen;  /* length for short strings, 0xFF for long strings */
+  lu_byte shrlen;  /* length for short strings; kind (as ls_byte) for longs */
   unsigned int hash;
   union {
     size_t lnglen;  /* length for long strings */
@@ -418,8 +418,8 @@ typedef struct TString {
 } TString;
 
 
-#define strisshr(ts)	((ts)->shrlen >= 0)
-#define isextstr(ts)	(ttislngstring(ts) && tsvalue(ts)->shrlen != LSTRREG)
+#define strisshr(ts)	(cast(ls_byte, (ts)->shrlen) >= 0)
+#define isextstr(ts)	(ttislngstring(ts) && cast(ls_byte, tsvalue(ts)->shrlen) != LSTRREG)
 
 /*
 ** Get the actual string (array of bytes) from a 'TString'. (Generic
@@ -433,7 +433,7 @@ typedef struct TString {
 
 /* get string length from 'TString *s' */
 #define tsslen(s)  \
-	((s)->shrlen != 0xFF ? (s)->shrlen : (s)->u.lnglen)
+	(strisshr(s) ? cast_sizet((s)->shrlen) : (s)->u.lnglen)
 /*
 ** Get string and length */
 #define getlstr(ts, len)  \
@@ -4,7 +4,7 @@ include $(CLEAR_VARS)
 
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/../lua
 LOCAL_MODULE     := xml
-LOCAL_SRC_FILES  := xml.c
+LOCAL_SRC_FILES  := xml.c xml_reader.c
 LOCAL_STATIC_LIBRARIES := LXCLuaCore
 
 include $(BUILD_SHARED_LIBRARY)
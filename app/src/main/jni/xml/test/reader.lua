@@ -0,0 +1,132 @@
+-- xml.reader, xml.eval/xml.load and xml.encode
+xml = require "xml.core"
+
+local function events(r)
+	local list = {}
+	for ev, v in r:events() do list[#list + 1] = ev .. ":" .. v end
+	return table.concat(list, " ")
+end
+
+local function fails(text, msg)
+	local ok, err = pcall(events, xml.reader(text))
+	assert(not ok and err:find(msg, 1, true), err)
+	ok, err = pcall(xml.eval, text)
+	assert(not ok and err:find(msg, 1, true), err)
+end
+
+do print("events")
+	local r = xml.reader('<a x="1"><b/>text<c y=\'&lt;\'>more</c></a>')
+	assert(r:next() == "start" and r:name() == "a" and r:attr("x") == "1")
+	assert(r:depth() == 1)
+	assert(r:next() == "start" and r:name() == "b" and r:depth() == 2)
+	assert(r:next() == "end" and r:name() == "b" and r:depth() == 1)
+	assert(select(2, r:next()) == "text")
+	assert(r:next() == "start" and r:attrs().y == "<")
+	assert(select(2, r:next()) == "more")
+	assert(r:next() == "end" and r:name() == "c")
+	assert(r:next() == "end" and r:name() == "a" and r:depth() == 0)
+	assert(r:next() == nil)
+	assert(events(xml.reader("<a><a><a/></a></a>")) ==
+		"start:a start:a start:a end:a end:a end:a")
+end
+
+do print("end tags match their element")
+	fails("<a></b>", "end tag does not match the open element")
+	fails("<a><b></a></b>", "end tag does not match the open element")
+	fails("<ab></a>", "end tag does not match the open element")
+	fails("<a></ab>", "end tag does not match the open element")
+	fails("<a><b/></b></a>", "end tag does not match the open element")
+	fails("</b>", "end tag without an open element")
+	-- eval stops after the root element, the reader goes on
+	local ok, err = pcall(events, xml.reader("<a></a></a>"))
+	assert(not ok and err:find("end tag without an open element", 1, true), err)
+	assert(events(xml.reader("<a ><b\t/></a >")) == "start:a start:b end:b end:a")
+end
+
+do print("skip")
+	local r = xml.reader("<a><b><c>x</c><c/></b><d/></a>")
+	assert(r:next() == "start" and r:next() == "start" and r:name() == "b")
+	r:skip()
+	assert(r:depth() == 1)
+	assert(r:next() == "start" and r:name() == "d")
+	r = xml.reader("<a><b><c></b></a>")
+	r:next()
+	r:next()
+	local ok, err = pcall(r.skip, r)
+	assert(not ok and err:find("end tag does not match the open element", 1, true), err)
+end
+
+do print("deep and long names")
+	local names = {}
+	for i = 1, 200 do names[i] = "n" .. string.rep("x", i) end
+	local open, close = {}, {}
+	for i = 1, #names do
+		open[i] = "<" .. names[i] .. ">"
+		close[#names + 1 - i] = "</" .. names[i] .. ">"
+	end
+	local text = table.concat(open) .. table.concat(close)
+	local t = xml.eval(text)
+	assert(t[0] == names[1])
+	for i = 2, #names do t = t[1] assert(t[0] == names[i]) end
+	close[1], close[2] = close[2], close[1]
+	fails(table.concat(open) .. table.concat(close), "end tag does not match the open element")
+end
+
+do print("streaming from a file")
+	local tmp = os.tmpname()
+	local f = assert(io.open(tmp, "w"))
+	f:write("<list>")
+	for i = 1, 5000 do
+		f:write(string.format('<item id="%d">value %d</item>', i, i))
+	end
+	f:write("</list>")
+	f:close()
+	f = assert(io.open(tmp))
+	local r = xml.reader(f)
+	local n = 0
+	for ev, v in r:events() do
+		if ev == "start" and v == "item" then
+			n = n + 1
+			assert(r:attr("id") == tostring(n))
+		elseif ev == "text" then
+			assert(v == "value " .. n)
+		end
+	end
+	f:close()
+	assert(n == 5000)
+	local t = xml.load(tmp)
+	assert(#t == 5000 and t[5000].id == "5000" and t[5000][1] == "value 5000")
+
+	f = assert(io.open(tmp, "w"))
+	f:write("<list>", string.rep("<item>x</item>", 5000), "</lsit>")
+	f:close()
+	f = assert(io.open(tmp))
+	local ok, err = pcall(events, xml.reader(f))
+	f:close()
+	assert(not ok and err:find("end tag does not match the open element", 1, true), err)
+	ok, err = pcall(xml.load, tmp)
+	assert(not ok and err:find("end tag does not match the open element", 1, true), err)
+	os.remove(tmp)
+end
+
+do print("numeric references are UTF-8")
+	assert(xml.eval("<a>&#228;</a>")[1] == "\xC3\xA4")
+	assert(xml.eval("<a>&#xE4;&#x20AC;&#65;</a>")[1] == "\xC3\xA4\xE2\x82\xACA")
+	assert(xml.eval("<a>&#x1F600;</a>")[1] == "\xF0\x9F\x98\x80")
+	assert(xml.eval('<a v="&#228;&amp;"/>').v == "\xC3\xA4&")
+	-- the old one-byte-per-reference form gives two characters now
+	assert(xml.eval("<a>&#195;&#164;</a>")[1] == "\xC3\x83\xC2\xA4")
+end
+
+do print("encode")
+	assert(xml.encode("a<b>&\"'") == "a&lt;b&gt;&amp;&quot;&apos;")
+	assert(xml.encode("\xC3\xA4\xE2\x82\xAC") == "&#228;&#8364;")
+	-- a byte that is not UTF-8 is taken as Latin-1
+	assert(xml.encode("\xE4") == "&#228;")
+	for _, s in ipairs{ "plain", "\xC3\xA4 & <\xF0\x9F\x98\x80>", "" } do
+		local t = xml.eval("<a>" .. xml.encode(s) .. "</a>")
+		assert((t[1] or "") == s, s)
+	end
+end
+
+print("OK")
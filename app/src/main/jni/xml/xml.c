@@ -42,191 +42,33 @@ THE SOFTWARE.
 #include <ctype.h>
 #include <stdlib.h>
 
-static const char ESC=27;
-static const char OPN=28;
-static const char CLS=29;
+#include "xml_reader.h"
 
 //--- auxliary functions -------------------------------------------
 
-static const char* char2code(unsigned char ch, char buf[8]) {
-	unsigned char i=0;
-	buf[i++]='&'; 
-	buf[i++]='#';
-	if(ch>99) buf[i++]=ch/100+48;
-	if(ch>9) buf[i++]=(ch%100)/10+48;
-	buf[i++]=ch%10+48;
-	buf[i++]=';';
-	buf[i]=0;
+static const char* char2code(unsigned long cp, char buf[16]) {
+	sprintf(buf, "&#%lu;", cp);
 	return buf;
 }
 
-static size_t find(const char* s, const char* pattern, size_t start) {
-	const char* found =strstr(s+start, pattern);
-	return found ? found-s : strlen(s);
-}
-
-//--- internal tokenizer -------------------------------------------
-
-typedef struct Tokenizer_s  {
-	/// stores string to be tokenized
-	const char* s;
-	/// stores size of string to be tokenized
-	size_t s_size;
-	/// stores current read position
-	size_t i;
-	/// stores current read context
-	int tagMode;
-	/// stores next token, if already determined
-	const char* m_next;
-	/// size of next token
-	size_t m_next_size;
-	/// pointer to current token
-	char* m_token;
-	/// size of current token
-	size_t m_token_size;
-	/// capacity of current token
-	size_t m_token_capacity;
-} Tokenizer;
-
-Tokenizer* Tokenizer_new(const char* str, size_t str_size) {
-	Tokenizer *tok = (Tokenizer*)malloc(sizeof(Tokenizer));
-	memset(tok, 0, sizeof(Tokenizer));
-	tok->s_size = str_size;
-	tok->s = str;
-	return tok;
-}
-
-void Tokenizer_delete(Tokenizer* tok) {
-	free(tok->m_token);
-	free(tok);
-}
-
-//void Tokenizer_print(Tokenizer* tok) { printf("  @%u %s\n", tok->i, !tok->m_token ? "(null)" : (tok->m_token[0]==ESC)?"(esc)" : (tok->m_token[0]==OPN)?"(open)": (tok->m_token[0]==CLS)?"(close)" : tok->m_token); fflush(stdout); }
-
-static const char* Tokenizer_set(Tokenizer* tok, const char* s, size_t size) {
-	if(!size||!s) return 0;
-	free(tok->m_token);
-	tok->m_token = (char*)malloc(size+1);
-	strncpy(tok->m_token,s, size);
-	tok->m_token[size] = 0;
-	tok->m_token_size = tok->m_token_capacity = size;
-	//Tokenizer_print(tok);
-	return tok->m_token;
-}
-
-static void Tokenizer_append(Tokenizer* tok, char ch) {
-	if(tok->m_token_size+1>=tok->m_token_capacity) {
-		tok->m_token_capacity = (tok->m_token_capacity==0) ? 16 : tok->m_token_capacity*2;
-		tok->m_token = (char*)realloc(tok->m_token, tok->m_token_capacity);
+/// code point of the UTF-8 sequence at s, its length in *len (0 if invalid)
+static unsigned long utf8code(const unsigned char* s, size_t* len) {
+	unsigned long cp;
+	size_t i, n;
+	if(s[0]>=0xC2 && s[0]<0xE0) { n=2; cp=s[0]&0x1F; }
+	else if(s[0]>=0xE0 && s[0]<0xF0) { n=3; cp=s[0]&0x0F; }
+	else if(s[0]>=0xF0 && s[0]<0xF5) { n=4; cp=s[0]&0x07; }
+	else { *len=0; return s[0]; }
+	for(i=1; i<n; ++i) {
+		if((s[i]&0xC0)!=0x80) { *len=0; return s[0]; }
+		cp=(cp<<6)|(s[i]&0x3F);
 	}
-	tok->m_token[tok->m_token_size]=ch;
-	tok->m_token[++tok->m_token_size]=0;
-}
-
-const char* Tokenizer_next(Tokenizer* tok) {
-	const char* ESC_str = "\033";
-	const char* OPEN_str = "\034";
-	const char* CLOSE_str = "\035";
-
-	
-	if(tok->m_token) {
-		free(tok->m_token);
-		tok->m_token = 0;
-		tok->m_token_size=tok->m_token_capacity = 0;
-	}
-	
-	int quotMode=0;
-	int tokenComplete = 0;
-	while(tok->m_next_size || (tok->i < tok->s_size)) {
-
-		if(tok->m_next_size) {
-			Tokenizer_set(tok, tok->m_next, tok->m_next_size);
-			tok->m_next=0;
-			tok->m_next_size=0;
-			return tok->m_token;
-		}
-
-		switch(tok->s[tok->i]) {
-		    case '"':
-		    case '\'':
-			if(tok->tagMode) {
-				if(!quotMode) quotMode=tok->s[tok->i];
-				else if(quotMode==tok->s[tok->i]) quotMode=0;
-			}
-			Tokenizer_append(tok, tok->s[tok->i]);
-			break;
-		    case '<':
-			if(!quotMode&&(tok->i+4<tok->s_size)&&(strncmp(tok->s+tok->i,"<!--",4)==0)) // strip comments
-			    tok->i=find(tok->s, "-->", tok->i+4)+2;
-			else if(!quotMode&&(tok->i+9<tok->s_size)&&(strncmp(tok->s+tok->i,"<![CDATA[",9)==0)) { // interpet CDATA
-			    size_t b=tok->i+9;
-			    tok->i=find(tok->s, "]]>",b)+3;
-			    if(!tok->m_token_size) return Tokenizer_set(tok, tok->s+b, tok->i-b-3);
-			    tokenComplete = 1;
-			    tok->m_next = tok->s+b;
-			    tok->m_next_size = tok->i-b-3;
-			    --tok->i;
-			}
-			else if(!quotMode&&(tok->i+1<tok->s_size)&&((tok->s[tok->i+1]=='?')||(tok->s[tok->i+1]=='!'))) // strip meta information
-			    tok->i=find(tok->s, ">", tok->i+2);
-			else if(!quotMode&&!tok->tagMode) {
-				if((tok->i+1<tok->s_size)&&(tok->s[tok->i+1]=='/')) {
-					tok->m_next=ESC_str;
-					tok->m_next_size = 1;
-					tok->i=find(tok->s, ">", tok->i+2);
-				}
-				else {
-					tok->m_next = OPEN_str;
-					tok->m_next_size = 1;
-					tok->tagMode=1; 
-				}
-				tokenComplete = 1;
-			}
-			else Tokenizer_append(tok, tok->s[tok->i]);
-			break;
-		    case '/': 
-			if(tok->tagMode&&!quotMode) {
-				tokenComplete = 1;
-				if((tok->i+1 < tok->s_size) && (tok->s[tok->i+1]=='>')) {
-					tok->tagMode=0;
-					tok->m_next=ESC_str;
-					tok->m_next_size = 1;
-					++tok->i;
-				}
-				else Tokenizer_append(tok, tok->s[tok->i]);
-			}                    
-			else Tokenizer_append(tok, tok->s[tok->i]);
-			break;
-		    case '>': 
-			if(!quotMode&&tok->tagMode) {
-				tok->tagMode=0;
-				tokenComplete = 1;
-				tok->m_next = CLOSE_str;
-				tok->m_next_size = 1;
-			}                    
-			else Tokenizer_append(tok, tok->s[tok->i]);
-			break;
-		    case ' ':
-		    case '\r':
-		    case '\n':
-		    case '\t':
-			if(tok->tagMode&&!quotMode) {
-			    if(tok->m_token_size) tokenComplete=1;
-			}
-			else if(tok->m_token_size) Tokenizer_append(tok, tok->s[tok->i]);
-			break;
-		    default: Tokenizer_append(tok, tok->s[tok->i]);
-		}
-		++tok->i;
-		if((tok->i>=tok->s_size)||(tokenComplete&&tok->m_token_size)) {
-			tokenComplete=0;
-			while(tok->m_token_size&&isspace(tok->m_token[tok->m_token_size-1])) // trim whitespace
-				tok->m_token[--tok->m_token_size]=0;
-			if(tok->m_token_size) break;
-		}
+	if((n==3 && cp<0x800) || (n==4 && (cp<0x10000 || cp>0x10FFFF)) || (cp>=0xD800 && cp<0xE000)) {
+		*len=0;
+		return s[0];
 	}
-	//Tokenizer_print(tok);
-	return tok->m_token;
+	*len=n;
+	return cp;
 }
 
 //--- local variables ----------------------------------------------
@@ -240,123 +82,200 @@ static char** sv_code=0;
 
 //--- public methods -----------------------------------------------
 
-static void Xml_pushDecode(lua_State* L, const char* s, size_t s_size) {
-	size_t start=0, pos;
-	if(!s_size) s_size=strlen(s);
-	luaL_Buffer b;
-	luaL_buffinit(L, &b);
-	const char* found = strstr(s, "&#");
-	if(!found) pos = s_size;
-	else pos = found-s;
-	while(found&&(pos+5<s_size)&&(*(found+5)==';')&&isdigit(*(found+2))&&isdigit(*(found+3))&&isdigit(*(found+4)) ) {
-		if(pos>start) luaL_addlstring(&b,s+start, pos-start);
-		luaL_addchar(&b, 100*(s[pos+2]-48)+10*(s[pos+3]-48)+(s[pos+4]-48));
-		start=pos+6;
-		found = strstr(found+6, "&#");
-		if(!found) pos = s_size;
-		else pos = found-s;
+static void Xml_addUtf8(luaL_Buffer* b, unsigned long cp) {
+	if(cp<0x80) luaL_addchar(b, (char)cp);
+	else if(cp<0x800) {
+		luaL_addchar(b, (char)(0xC0|(cp>>6)));
+		luaL_addchar(b, (char)(0x80|(cp&0x3F)));
 	}
-	if(pos>start) luaL_addlstring(&b,s+start, pos-start);
-	luaL_pushresult(&b);
+	else if(cp<0x10000) {
+		luaL_addchar(b, (char)(0xE0|(cp>>12)));
+		luaL_addchar(b, (char)(0x80|((cp>>6)&0x3F)));
+		luaL_addchar(b, (char)(0x80|(cp&0x3F)));
+	}
+	else {
+		luaL_addchar(b, (char)(0xF0|(cp>>18)));
+		luaL_addchar(b, (char)(0x80|((cp>>12)&0x3F)));
+		luaL_addchar(b, (char)(0x80|((cp>>6)&0x3F)));
+		luaL_addchar(b, (char)(0x80|(cp&0x3F)));
+	}
+}
+
+/// decodes one entity starting after '&' and ending before ';'.
+/// A numeric reference (&#228; or &#xE4;) is a Unicode code point and gives
+/// its UTF-8 encoding, here the two bytes "\xC3\xA4".  Before the pull parser
+/// only three-digit decimal references were decoded, each to a single byte
+/// ("\xE4"), and xml.encode wrote every byte above 0x7F as such a reference.
+/// Documents written that way ("&#195;&#164;" for a UTF-8 "\xC3\xA4") now
+/// decode to two characters and have to be re-encoded.
+static int Xml_addEntity(luaL_Buffer* b, const char* s, size_t n) {
+	static const char* const names[]={ "lt", "<", "gt", ">", "amp", "&", "quot", "\"", "apos", "'" };
 	size_t i;
-	for(i=sv_code_size-1; i<sv_code_size; i-=2) {
-		luaL_gsub(L, lua_tostring(L,-1), sv_code[i], sv_code[i-1]);
-		lua_remove(L,-2);
+	if(n>1 && s[0]=='#') {
+		unsigned long cp=0;
+		int hex=(s[1]=='x' || s[1]=='X');
+		if(hex && n<3) return 0;
+		for(i=hex ? 2 : 1; i<n; ++i) {
+			char c=s[i];
+			int d=(c>='0' && c<='9') ? c-'0' : !hex ? -1
+				: (c>='a' && c<='f') ? c-'a'+10 : (c>='A' && c<='F') ? c-'A'+10 : -1;
+			if(d<0 || cp>0x10FFFF) return 0;
+			cp=cp*(hex ? 16 : 10)+d;
+		}
+		if(cp>0x10FFFF) return 0;
+		Xml_addUtf8(b, cp);
+		return 1;
 	}
+	for(i=0; i<sizeof(names)/sizeof(names[0]); i+=2)
+		if(strlen(names[i])==n && memcmp(names[i], s, n)==0) {
+			luaL_addchar(b, names[i+1][0]);
+			return 1;
+		}
+	return 0;
 }
 
-int Xml_eval(lua_State *L) {
-	char* str = 0;
-	size_t str_size=0;
-	if(lua_isuserdata(L,1)) str = (char*)lua_touserdata(L,1);
-	else {
-		const char * sTmp = luaL_checklstring(L,1,&str_size);
-		str = (char*)malloc(str_size+1);
-		memcpy(str, sTmp, str_size);
-		str[str_size]=0;
+/// codes added by xml.registerCode follow the 5 predefined ones
+#define XML_DEFAULT_CODES 10
+
+/// decodes a registered code starting at the '&' in s, returns its length
+static size_t Xml_addCode(luaL_Buffer* b, const char* s, size_t left) {
+	size_t i;
+	for(i=sv_code_size-1; i>=XML_DEFAULT_CODES && i<sv_code_size; i-=2) {
+		size_t n=strlen(sv_code[i]);
+		if(sv_code[i][0]=='&' && n<=left && memcmp(s, sv_code[i], n)==0) {
+			luaL_addstring(b, sv_code[i-1]);
+			return n;
+		}
 	}
-	Tokenizer* tok = Tokenizer_new(str, str_size ? str_size : strlen(str));
-	lua_settop(L,0);
-	const char* token=0;
-	int firstStatement = 1;
-	while((token=Tokenizer_next(tok))!=0) if(token[0]==OPN) { // new tag found
-		if(lua_gettop(L)) {
-			int newIndex=lua_rawlen(L,-1)+1;
-			lua_pushnumber(L,newIndex);
-			lua_newtable(L);
-			lua_settable(L, -3);
-			lua_pushnumber(L,newIndex);
-			lua_gettable(L,-2);
+	return 0;
+}
+
+void Xml_pushDecode(lua_State* L, const char* s, size_t n, int amp) {
+	const char* e=s+n;
+	luaL_Buffer b;
+	int slot, plain=1;
+	size_t i;
+	for(i=XML_DEFAULT_CODES+1; i<sv_code_size; i+=2) if(sv_code[i][0]!='&') plain=0;
+	if(!amp && plain) {
+		lua_pushlstring(L, s, n);
+		return;
+	}
+	lua_pushnil(L); // result slot below the buffer
+	slot=lua_gettop(L);
+	luaL_buffinit(L, &b);
+	while(s<e) {
+		const char* a=(const char*)memchr(s, '&', e-s);
+		const char* semi;
+		if(!a) {
+			luaL_addlstring(&b, s, e-s);
+			break;
+		}
+		luaL_addlstring(&b, s, a-s);
+		if((i=Xml_addCode(&b, a, e-a))!=0) {
+			s=a+i;
+			continue;
 		}
+		semi=(const char*)memchr(a, ';', (e-a)<16 ? (size_t)(e-a) : 16);
+		if(semi && Xml_addEntity(&b, a+1, semi-a-1)) s=semi+1;
 		else {
-			if (firstStatement) {
-				lua_newtable(L); 
-				firstStatement = 0;
-			}
-			else return lua_gettop(L);
+			luaL_addchar(&b, '&');
+			s=a+1;
 		}
-		// set metatable:    
-		lua_newtable(L);
-		lua_pushliteral(L, "__index");
-		lua_getglobal(L, "xml");
-		lua_settable(L, -3);
-			
-		lua_pushliteral(L, "__tostring"); // set __tostring metamethod
-		lua_getglobal(L, "xml");
-		lua_pushliteral(L,"str");
-		lua_gettable(L, -2);
-		lua_remove(L, -2);
-		lua_settable(L, -3);			
-		lua_setmetatable(L, -2);
-		
-		// parse tag and content:
-		lua_pushnumber(L,0); // use index 0 for storing the tag
-		lua_pushstring(L, Tokenizer_next(tok));
-		lua_settable(L, -3);
-		
-		while(((token = Tokenizer_next(tok))!=0)&&(token[0]!=CLS)&&(token[0]!=ESC)) { // parse tag header
-			size_t sepPos=find(token, "=", 0);
-			if(token[sepPos]) { // regular attribute
-				const char* aVal =token+sepPos+2;
-				lua_pushlstring(L, token, sepPos);
-				Xml_pushDecode(L, aVal, strlen(aVal)-1);
+	}
+	luaL_pushresult(&b);
+	lua_copy(L, -1, slot);
+	lua_settop(L, slot);
+	if(plain) return;
+	for(i=sv_code_size-1; i>=XML_DEFAULT_CODES && i<sv_code_size; i-=2) if(sv_code[i][0]!='&') {
+		luaL_gsub(L, lua_tostring(L,slot), sv_code[i], sv_code[i-1]);
+		lua_copy(L, -1, slot);
+		lua_settop(L, slot);
+	}
+}
+
+/// builds the first root element of the document as nested tables
+static int Xml_build(lua_State* L, XmlReader* r) {
+	int ev;
+	// one shared metatable for all nodes:
+	lua_newtable(L);
+	lua_pushliteral(L, "__index");
+	lua_getglobal(L, "xml");
+	lua_settable(L, -3);
+	lua_pushliteral(L, "__tostring");
+	lua_getglobal(L, "xml");
+	lua_pushliteral(L,"str");
+	lua_gettable(L, -2);
+	lua_remove(L, -2);
+	lua_settable(L, -3);
+	int meta=lua_gettop(L);
+	while((ev=XmlReader_next(r))!=XML_EV_EOF) {
+		if(ev==XML_EV_ERROR)
+			return luaL_error(L, "LuaXml ERROR: %s at offset %d", r->error, (int)XmlReader_offset(r));
+		if(ev==XML_EV_START) { // new tag found
+			luaL_checkstack(L, 4, "LuaXml ERROR: document too deep");
+			lua_newtable(L);
+			if(lua_gettop(L)>meta+1) {
+				lua_pushvalue(L, -1);
+				lua_rawseti(L, -3, lua_rawlen(L, -3)+1);
+			}
+			lua_pushvalue(L, meta);
+			lua_setmetatable(L, -2);
+			lua_pushlstring(L, r->buf+r->name, r->name_len); // use index 0 for storing the tag
+			lua_rawseti(L, -2, 0);
+			size_t it=0, klen, vlen;
+			const char *k, *v;
+			while(XmlReader_nextAttr(r, &it, &k, &klen, &v, &vlen)) {
+				lua_pushlstring(L, k, klen);
+				if(vlen) Xml_pushDecode(L, v, vlen, memchr(v, '&', vlen)!=0);
+				else lua_pushliteral(L, "");
 				lua_settable(L, -3);
 			}
-		}            
-		if(!token||(token[0]==ESC)) {
-			if(lua_gettop(L)>1) lua_settop(L,-2); // this tag has no content, only attributes
+		}
+		else if(ev==XML_EV_END) { // previous tag is over
+			if(lua_gettop(L)>meta+1) lua_pop(L, 1);
 			else break;
 		}
+		else if(lua_gettop(L)>meta) { // read elements
+			const char* s=r->buf+r->text;
+			size_t n=r->text_len;
+			while(n&&isspace((unsigned char)*s)) ++s, --n;
+			while(n&&isspace((unsigned char)s[n-1])) --n;
+			if(!n) continue;
+			Xml_pushDecode(L, s, n, r->text_amp);
+			lua_rawseti(L, -2, lua_rawlen(L, -2)+1);
+		}
 	}
-	else if(token[0]==ESC) { // previous tag is over
-		if(lua_gettop(L)>1) lua_settop(L,-2); // pop current table
-		else break;
+	if(lua_gettop(L)==meta) return 0;
+	lua_settop(L, meta+1);
+	return 1;
+}
+
+int Xml_eval(lua_State *L) {
+	// a collected reader, so the open element names are freed on errors too
+	XmlReader* r;
+	if(lua_isuserdata(L,1)) {
+		const char* str=(const char*)lua_touserdata(L,1);
+		r=XmlReader_push(L);
+		XmlReader_initBuffer(r, str, strlen(str));
 	}
-	else { // read elements
-		lua_pushnumber(L,lua_rawlen(L,-1)+1);
-		Xml_pushDecode(L, token, 0);
-		lua_settable(L, -3);
+	else {
+		size_t str_size=0;
+		const char* str=luaL_checklstring(L,1,&str_size);
+		r=XmlReader_push(L);
+		XmlReader_initBuffer(r, str, str_size);
 	}
-	Tokenizer_delete(tok);
-	free(str);
-	return lua_gettop(L);
+	int n=Xml_build(L, r);
+	XmlReader_free(r);
+	return n;
 }
 
 int Xml_load (lua_State *L) {
 	const char * filename = luaL_checkstring(L,1);
-	FILE * file=fopen(filename,"r");
-	if(!file) return luaL_error(L,"LuaXml ERROR: \"%s\" file error or file not found!",filename);
-
-	fseek (file , 0 , SEEK_END);
-	size_t sz = ftell (file);
-	rewind (file);
-	char* buffer = (char*)malloc(sz+1);
-	fread (buffer,1,sz,file);
-	fclose(file);
-	buffer[sz]=0;
-	lua_pushlightuserdata(L,buffer);
-	lua_replace(L,1);
-	return Xml_eval(L);
+	XmlReader* r=XmlReader_push(L);
+	if(XmlReader_initMap(r, filename)!=0) return luaL_error(L,"LuaXml ERROR: \"%s\" file error or file not found!",filename);
+	int n=Xml_build(L, r);
+	XmlReader_free(r);
+	return n;
 };
 
 int Xml_registerCode(lua_State *L) {
@@ -378,22 +297,31 @@ int Xml_registerCode(lua_State *L) {
     return 0;
 }
 
+/// xml.encode(s) escapes the registered codes and writes each UTF-8 sequence
+/// as one numeric reference (see Xml_addEntity).  A byte above 0x7F that is
+/// not part of valid UTF-8 is taken as a Latin-1 character, so it comes back
+/// from eval/load UTF-8 encoded.
 int Xml_encode(lua_State *L) {
 	if(lua_gettop(L)!=1) return 0;
 	luaL_checkstring(L,-1);
 	size_t i;
 	for(i=0; i<sv_code_size; i+=2) {
-		luaL_gsub(L, lua_tostring(L,-1), sv_code[i], sv_code[i+1]);
-		lua_remove(L,-2);
+		luaL_gsub(L, lua_tostring(L,1), sv_code[i], sv_code[i+1]);
+		lua_copy(L, -1, 1);
+		lua_settop(L, 1);
 	}
-	char buf[8];
+	char buf[16];
 	const char* s=lua_tostring(L,1);
-	size_t start, pos;
+	size_t start, pos, len;
 	luaL_Buffer b;
 	luaL_buffinit(L, &b);
 	for(start=pos=0; s[pos]!=0; ++pos) if(s[pos]<0) {
 		if(pos>start) luaL_addlstring(&b,s+start, pos-start);
-		luaL_addstring(&b,char2code((unsigned char)(s[pos]),buf));
+		// a UTF-8 sequence becomes one reference to its code point, so that
+		// eval/load (which decode references to UTF-8) give it back
+		unsigned long cp=utf8code((const unsigned char*)s+pos, &len);
+		luaL_addstring(&b,char2code(cp,buf));
+		if(len) pos+=len-1;
 		start=pos+1;
 	}
 	if(pos>start) luaL_addlstring(&b,s+start, pos-start);
@@ -411,6 +339,7 @@ int _EXPORT luaopen_xml_core (lua_State* L) {
 		{NULL, NULL}
 	};
 	luaL_newlib(L, funcs);
+	XmlReader_register(L);
 	// register default codes:
 	if(!sv_code) {
 		sv_code=(char**)malloc(sv_code_capacity*sizeof(char*));
@@ -0,0 +1,549 @@
+/**
+Streaming pull parser for LuaXml.
+
+Reads from an in-memory string, a memory-mapped file or a FILE in
+chunks, and reports start/end/text events without building a document.
+Delimiters are located 16 bytes at a time with SSE2 or NEON when
+available; entities are only resolved when a value is pushed to Lua.
+*/
+
+#include "xml_reader.h"
+
+#include <lauxlib.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
+#define XML_NPOS ((size_t)-1)
+#define XML_STREAM_CHUNK 65536
+#define XML_READER "xml.reader"
+
+/// byte at offset rel from the current token start
+#define XR_AT(r,rel) ((r)->buf[(r)->mark+(rel)])
+
+//--- scanning helpers ---------------------------------------------
+
+static int Xml_isSpace(char c) {
+	return c==' ' || c=='\t' || c=='\r' || c=='\n';
+}
+
+static int Xml_isBlank(const char* s, size_t n) {
+	size_t i;
+	for(i=0; i<n; ++i) if(!Xml_isSpace(s[i])) return 0;
+	return 1;
+}
+
+/// returns the first byte in [p, e) equal to c1, c2 or c3, or NULL
+static const char* Xml_findAny(const char* p, const char* e, char c1, char c2, char c3) {
+#if defined(__SSE2__)
+	const __m128i v1=_mm_set1_epi8(c1), v2=_mm_set1_epi8(c2), v3=_mm_set1_epi8(c3);
+	while(e-p>=16) {
+		__m128i x=_mm_loadu_si128((const __m128i*)p);
+		int m=_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x,v1),
+			_mm_cmpeq_epi8(x,v2)), _mm_cmpeq_epi8(x,v3)));
+		if(m) return p+__builtin_ctz(m);
+		p+=16;
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	const uint8x16_t v1=vdupq_n_u8((uint8_t)c1), v2=vdupq_n_u8((uint8_t)c2), v3=vdupq_n_u8((uint8_t)c3);
+	while(e-p>=16) {
+		uint8x16_t x=vld1q_u8((const uint8_t*)p);
+		uint8x16_t m=vorrq_u8(vorrq_u8(vceqq_u8(x,v1), vceqq_u8(x,v2)), vceqq_u8(x,v3));
+		// narrow each byte of the mask to a nibble so it fits a 64 bit lane
+		uint64_t bits=vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+		if(bits) return p+(__builtin_ctzll(bits)>>2);
+		p+=16;
+	}
+#endif
+	for(; p<e; ++p) if(*p==c1 || *p==c2 || *p==c3) return p;
+	return 0;
+}
+
+//--- input window -------------------------------------------------
+
+static int XmlReader_fail(XmlReader* r, const char* msg) {
+	if(!r->error) r->error=msg;
+	return r->event=XML_EV_ERROR;
+}
+
+/// reads more input, moving the current token to the front of the window
+static int XmlReader_fill(XmlReader* r) {
+	size_t n;
+	if(!r->fp || r->error) return 0;
+	if(r->mark) {
+		memmove(r->own, r->own+r->mark, r->len-r->mark);
+		r->len-=r->mark;
+		r->offset+=r->mark;
+		r->pos-=r->mark;
+		r->mark=0;
+	}
+	if(r->len==r->cap) {
+		char* p=(char*)realloc(r->own, r->cap*2);
+		if(!p) { r->error="out of memory"; return 0; }
+		r->own=p;
+		r->cap*=2;
+	}
+	n=fread(r->own+r->len, 1, r->cap-r->len, r->fp);
+	r->buf=r->own;
+	r->len+=n;
+	if(!n && ferror(r->fp)) r->error="read error";
+	return n>0;
+}
+
+/// makes sure n bytes are available from the token start
+static int XmlReader_avail(XmlReader* r, size_t n) {
+	while(r->len-r->mark<n) if(!XmlReader_fill(r)) return 0;
+	return 1;
+}
+
+/// offset (from the token start) of the next c1/c2/c3 at or after rel
+static size_t XmlReader_find(XmlReader* r, size_t rel, char c1, char c2, char c3) {
+	for(;;) {
+		if(r->mark+rel<r->len) {
+			const char* hit=Xml_findAny(r->buf+r->mark+rel, r->buf+r->len, c1, c2, c3);
+			if(hit) return hit-(r->buf+r->mark);
+			rel=r->len-r->mark;
+		}
+		if(!XmlReader_fill(r)) return XML_NPOS;
+	}
+}
+
+/// offset of the next occurrence of seq at or after rel
+static size_t XmlReader_findSeq(XmlReader* r, size_t rel, const char* seq) {
+	size_t n=strlen(seq), hit;
+	char c=seq[n-1];
+	for(rel+=n-1;; rel=hit+1) {
+		hit=XmlReader_find(r, rel, c, c, c);
+		if(hit==XML_NPOS) return XML_NPOS;
+		if(memcmp(&XR_AT(r, hit-(n-1)), seq, n-1)==0) return hit-(n-1);
+	}
+}
+
+//--- open elements ------------------------------------------------
+
+static int XmlReader_pushOpen(XmlReader* r, const char* name, size_t n) {
+	size_t need=r->open_len+n+sizeof(size_t);
+	if(need>r->open_cap) {
+		size_t cap=r->open_cap ? r->open_cap : 256;
+		char* p;
+		while(cap<need) cap*=2;
+		if(!(p=(char*)realloc(r->open, cap))) return 0;
+		r->open=p;
+		r->open_cap=cap;
+	}
+	memcpy(r->open+r->open_len, name, n);
+	memcpy(r->open+r->open_len+n, &n, sizeof(size_t));
+	r->open_len=need;
+	return 1;
+}
+
+/// pops the innermost open element if it is called name
+static int XmlReader_popOpen(XmlReader* r, const char* name, size_t n) {
+	size_t top;
+	if(r->open_len<sizeof(size_t)) return 0;
+	memcpy(&top, r->open+r->open_len-sizeof(size_t), sizeof(size_t));
+	if(top!=n || memcmp(r->open+r->open_len-sizeof(size_t)-top, name, n)!=0) return 0;
+	r->open_len-=top+sizeof(size_t);
+	return 1;
+}
+
+//--- tokenizer ----------------------------------------------------
+
+static int XmlReader_scanText(XmlReader* r) {
+	size_t rel=0, hit, end;
+	int amp=0, blank=1;
+	for(;;) {
+		hit=XmlReader_find(r, rel, '<', '&', '<');
+		end=(hit==XML_NPOS) ? r->len-r->mark : hit;
+		if(blank) blank=Xml_isBlank(&XR_AT(r, rel), end-rel);
+		if(hit==XML_NPOS || XR_AT(r, hit)=='<') break;
+		amp=1;
+		rel=hit+1;
+	}
+	if(r->error) return XmlReader_fail(r, r->error);
+	r->pos=r->mark+end;
+	if(blank) return XML_EV_EOF; // whitespace between tags is not reported
+	r->text=r->mark;
+	r->text_len=end;
+	r->text_amp=amp;
+	return XML_EV_TEXT;
+}
+
+static int XmlReader_scanMarkup(XmlReader* r) {
+	size_t rel, end, n;
+	int selfClose;
+	if(!XmlReader_avail(r, 2)) return XmlReader_fail(r, "unexpected end of input");
+	switch(XR_AT(r, 1)) {
+	case '!':
+		if(XmlReader_avail(r, 4) && memcmp(&XR_AT(r, 0), "<!--", 4)==0) {
+			if((end=XmlReader_findSeq(r, 4, "-->"))==XML_NPOS)
+				return XmlReader_fail(r, "unterminated comment");
+			r->pos=r->mark+end+3;
+			return XML_EV_EOF;
+		}
+		if(XmlReader_avail(r, 9) && memcmp(&XR_AT(r, 0), "<![CDATA[", 9)==0) {
+			if((end=XmlReader_findSeq(r, 9, "]]>"))==XML_NPOS)
+				return XmlReader_fail(r, "unterminated CDATA section");
+			r->pos=r->mark+end+3;
+			if(end==9) return XML_EV_EOF;
+			r->text=r->mark+9;
+			r->text_len=end-9;
+			r->text_amp=0;
+			return XML_EV_TEXT;
+		}
+		// DOCTYPE and other declarations, with an optional internal subset
+		rel=XmlReader_find(r, 2, '>', '[', '>');
+		if(rel!=XML_NPOS && XR_AT(r, rel)=='[') {
+			rel=XmlReader_find(r, rel+1, ']', ']', ']');
+			if(rel!=XML_NPOS) rel=XmlReader_find(r, rel+1, '>', '>', '>');
+		}
+		if(rel==XML_NPOS) return XmlReader_fail(r, "unterminated declaration");
+		r->pos=r->mark+rel+1;
+		return XML_EV_EOF;
+	case '?':
+		if((end=XmlReader_findSeq(r, 2, "?>"))==XML_NPOS)
+			return XmlReader_fail(r, "unterminated processing instruction");
+		r->pos=r->mark+end+2;
+		return XML_EV_EOF;
+	case '/':
+		if((end=XmlReader_find(r, 2, '>', '>', '>'))==XML_NPOS)
+			return XmlReader_fail(r, "unterminated end tag");
+		for(n=2; n<end && !Xml_isSpace(XR_AT(r, n)); ++n);
+		if(!XmlReader_popOpen(r, &XR_AT(r, 2), n-2))
+			return XmlReader_fail(r, r->depth ? "end tag does not match the open element"
+				: "end tag without an open element");
+		r->name=r->mark+2;
+		r->name_len=n-2;
+		r->attrs_len=0;
+		r->pos=r->mark+end+1;
+		--r->depth;
+		return XML_EV_END;
+	}
+	// start tag; a '>' inside a quoted attribute value does not end it
+	for(rel=1;;) {
+		char q;
+		if((end=XmlReader_find(r, rel, '>', '"', '\''))==XML_NPOS)
+			return XmlReader_fail(r, "unterminated tag");
+		if((q=XR_AT(r, end))=='>') break;
+		if((rel=XmlReader_find(r, end+1, q, q, q))==XML_NPOS)
+			return XmlReader_fail(r, "unterminated attribute value");
+		++rel;
+	}
+	for(n=1; n<end && !Xml_isSpace(XR_AT(r, n)) && XR_AT(r, n)!='/'; ++n);
+	if(n==1) return XmlReader_fail(r, "missing tag name");
+	selfClose=(XR_AT(r, end-1)=='/' && end-1>=n);
+	if(!selfClose && !XmlReader_pushOpen(r, &XR_AT(r, 1), n-1))
+		return XmlReader_fail(r, "out of memory");
+	r->name=r->mark+1;
+	r->name_len=n-1;
+	r->attrs=r->mark+n;
+	r->attrs_len=end-selfClose-n;
+	r->pos=r->mark+end+1;
+	r->pending_end=selfClose;
+	++r->depth;
+	return XML_EV_START;
+}
+
+//--- public methods -----------------------------------------------
+
+void XmlReader_initBuffer(XmlReader* r, const char* s, size_t size) {
+	memset(r, 0, sizeof(XmlReader));
+	r->buf=s;
+	r->len=size;
+}
+
+int XmlReader_initStream(XmlReader* r, FILE* fp) {
+	memset(r, 0, sizeof(XmlReader));
+	if(!(r->own=(char*)malloc(XML_STREAM_CHUNK))) return ENOMEM;
+	r->cap=XML_STREAM_CHUNK;
+	r->buf=r->own;
+	r->fp=fp;
+	return 0;
+}
+
+int XmlReader_initMap(XmlReader* r, const char* filename) {
+	struct stat st;
+	int fd, err=0;
+	memset(r, 0, sizeof(XmlReader));
+	r->buf="";
+	if((fd=open(filename, O_RDONLY))<0) return errno;
+	if(fstat(fd, &st)<0) err=errno;
+	else if(st.st_size>0) {
+		void* p=mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p==MAP_FAILED) err=errno;
+		else {
+			madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+			r->map=p;
+			r->map_size=(size_t)st.st_size;
+			r->buf=(const char*)p;
+			r->len=r->map_size;
+		}
+	}
+	close(fd);
+	return err;
+}
+
+void XmlReader_free(XmlReader* r) {
+	free(r->own);
+	free(r->open);
+	if(r->map) munmap(r->map, r->map_size);
+	r->own=0;
+	r->open=0;
+	r->open_len=r->open_cap=0;
+	r->map=0;
+	r->fp=0;
+	r->stream=0;
+	r->buf="";
+	r->len=r->pos=r->mark=0;
+	r->pending_end=0;
+}
+
+int XmlReader_next(XmlReader* r) {
+	int ev;
+	if(r->error) return r->event=XML_EV_ERROR;
+	if(r->pending_end) {
+		r->pending_end=0;
+		--r->depth;
+		return r->event=XML_EV_END;
+	}
+	for(;;) {
+		r->mark=r->pos;
+		if(!XmlReader_avail(r, 1))
+			return r->error ? XmlReader_fail(r, r->error) : (r->event=XML_EV_EOF);
+		ev=(XR_AT(r, 0)=='<') ? XmlReader_scanMarkup(r) : XmlReader_scanText(r);
+		if(ev!=XML_EV_EOF) return r->event=ev;
+	}
+}
+
+int XmlReader_skip(XmlReader* r) {
+	int target=r->depth-1, ev;
+	while(r->depth>target) {
+		if((ev=XmlReader_next(r))==XML_EV_ERROR) return ev;
+		if(ev==XML_EV_EOF) return XmlReader_fail(r, "unexpected end of input");
+	}
+	return r->event=XML_EV_END;
+}
+
+int XmlReader_nextAttr(XmlReader* r, size_t* it, const char** key, size_t* key_len, const char** val, size_t* val_len) {
+	const char* s=r->buf+r->attrs;
+	size_t n=r->attrs_len, i=*it, k;
+	char q;
+	while(i<n && Xml_isSpace(s[i])) ++i;
+	if(i>=n) return 0;
+	for(k=i; i<n && s[i]!='=' && !Xml_isSpace(s[i]); ++i);
+	*key=s+k;
+	*key_len=i-k;
+	while(i<n && Xml_isSpace(s[i])) ++i;
+	if(i>=n || s[i++]!='=') return 0;
+	while(i<n && Xml_isSpace(s[i])) ++i;
+	if(i>=n || ((q=s[i])!='"' && q!='\'')) return 0;
+	for(k=++i; i<n && s[i]!=q; ++i);
+	if(i>=n) return 0;
+	*val=s+k;
+	*val_len=i-k;
+	*it=i+1;
+	return 1;
+}
+
+size_t XmlReader_offset(const XmlReader* r) {
+	return r->offset+r->pos;
+}
+
+//--- Lua binding --------------------------------------------------
+
+static XmlReader* Xml_checkReader(lua_State* L) {
+	return (XmlReader*)luaL_checkudata(L, 1, XML_READER);
+}
+
+/// the FILE of a Lua file is freed by f:close(), so check before reading more
+static XmlReader* Xml_checkStream(lua_State* L) {
+	XmlReader* r=Xml_checkReader(L);
+	if(r->stream && ((luaL_Stream*)r->stream)->closef==NULL) {
+		r->fp=0;
+		luaL_error(L, "attempt to use a closed file");
+	}
+	return r;
+}
+
+static int Xml_readerError(lua_State* L, XmlReader* r) {
+	return luaL_error(L, "LuaXml ERROR: %s at offset %d", r->error, (int)XmlReader_offset(r));
+}
+
+static int Xml_pushEvent(lua_State* L, XmlReader* r, int ev, int light) {
+	static const char* const names[]={ 0, "start", "end", "text" };
+	if(ev==XML_EV_ERROR) return Xml_readerError(L, r);
+	if(ev==XML_EV_EOF) return 0;
+	lua_pushstring(L, names[ev]);
+	if(light) return 1;
+	if(ev==XML_EV_TEXT) Xml_pushDecode(L, r->buf+r->text, r->text_len, r->text_amp);
+	else lua_pushlstring(L, r->buf+r->name, r->name_len);
+	return 2;
+}
+
+/// reader:next([light]) -> event, name|text; with light only the event
+static int Xml_readerNext(lua_State* L) {
+	XmlReader* r=Xml_checkStream(L);
+	return Xml_pushEvent(L, r, XmlReader_next(r), lua_toboolean(L, 2));
+}
+
+static int Xml_readerIter(lua_State* L) {
+	XmlReader* r=Xml_checkStream(L);
+	return Xml_pushEvent(L, r, XmlReader_next(r), 0);
+}
+
+/// reader:events() -> iterator for generic for
+static int Xml_readerEvents(lua_State* L) {
+	Xml_checkReader(L);
+	lua_pushcfunction(L, Xml_readerIter);
+	lua_pushvalue(L, 1);
+	return 2;
+}
+
+/// reader:skip() skips the rest of the element just started
+static int Xml_readerSkip(lua_State* L) {
+	XmlReader* r=Xml_checkStream(L);
+	if(r->event!=XML_EV_START) return luaL_error(L, "LuaXml ERROR: skip must follow a start event");
+	if(XmlReader_skip(r)==XML_EV_ERROR) return Xml_readerError(L, r);
+	return 0;
+}
+
+static int Xml_readerName(lua_State* L) {
+	XmlReader* r=Xml_checkReader(L);
+	if(r->event!=XML_EV_START && r->event!=XML_EV_END) return 0;
+	lua_pushlstring(L, r->buf+r->name, r->name_len);
+	return 1;
+}
+
+static int Xml_readerText(lua_State* L) {
+	XmlReader* r=Xml_checkReader(L);
+	if(r->event!=XML_EV_TEXT) return 0;
+	Xml_pushDecode(L, r->buf+r->text, r->text_len, r->text_amp);
+	return 1;
+}
+
+static void Xml_pushAttrValue(lua_State* L, const char* v, size_t n) {
+	Xml_pushDecode(L, v, n, memchr(v, '&', n)!=0);
+}
+
+/// reader:attr(key) -> value of an attribute of the current start tag
+static int Xml_readerAttr(lua_State* L) {
+	XmlReader* r=Xml_checkReader(L);
+	size_t len, it=0, klen, vlen;
+	const char* name=luaL_checklstring(L, 2, &len);
+	const char *k, *v;
+	if(r->event!=XML_EV_START) return 0;
+	while(XmlReader_nextAttr(r, &it, &k, &klen, &v, &vlen))
+		if(klen==len && memcmp(k, name, len)==0) {
+			Xml_pushAttrValue(L, v, vlen);
+			return 1;
+		}
+	lua_pushnil(L);
+	return 1;
+}
+
+/// reader:attrs() -> table with all attributes of the current start tag
+static int Xml_readerAttrs(lua_State* L) {
+	XmlReader* r=Xml_checkReader(L);
+	size_t it=0, klen, vlen;
+	const char *k, *v;
+	if(r->event!=XML_EV_START) return 0;
+	lua_newtable(L);
+	while(XmlReader_nextAttr(r, &it, &k, &klen, &v, &vlen)) {
+		lua_pushlstring(L, k, klen);
+		Xml_pushAttrValue(L, v, vlen);
+		lua_rawset(L, -3);
+	}
+	return 1;
+}
+
+static int Xml_readerDepth(lua_State* L) {
+	lua_pushinteger(L, Xml_checkReader(L)->depth);
+	return 1;
+}
+
+static int Xml_readerOffset(lua_State* L) {
+	lua_pushinteger(L, (lua_Integer)XmlReader_offset(Xml_checkReader(L)));
+	return 1;
+}
+
+static int Xml_readerClose(lua_State* L) {
+	XmlReader* r=Xml_checkReader(L);
+	XmlReader_free(r);
+	r->error="reader is closed";
+	return 0;
+}
+
+XmlReader* XmlReader_push(lua_State* L) {
+	XmlReader* r=(XmlReader*)lua_newuserdata(L, sizeof(XmlReader));
+	XmlReader_initBuffer(r, "", 0);
+	luaL_setmetatable(L, XML_READER);
+	return r;
+}
+
+/// xml.reader(text | file [, isPath]) -> reader
+static int Xml_reader(lua_State* L) {
+	XmlReader* r;
+	int err=0;
+	if(lua_type(L, 1)==LUA_TSTRING && lua_toboolean(L, 2)) {
+		const char* filename=lua_tostring(L, 1);
+		r=XmlReader_push(L);
+		if((err=XmlReader_initMap(r, filename))!=0)
+			return luaL_error(L, "LuaXml ERROR: \"%s\": %s", filename, strerror(err));
+		return 1;
+	}
+	if(lua_type(L, 1)==LUA_TSTRING) {
+		size_t size;
+		const char* s=lua_tolstring(L, 1, &size);
+		r=XmlReader_push(L);
+		XmlReader_initBuffer(r, s, size);
+	}
+	else {
+		luaL_Stream* f=(luaL_Stream*)luaL_checkudata(L, 1, LUA_FILEHANDLE);
+		if(!f->closef) return luaL_error(L, "attempt to use a closed file");
+		r=XmlReader_push(L);
+		if((err=XmlReader_initStream(r, f->f))!=0)
+			return luaL_error(L, "LuaXml ERROR: %s", strerror(err));
+		r->stream=f;
+	}
+	lua_pushvalue(L, 1); // keep the string or file alive
+	lua_setuservalue(L, -2);
+	return 1;
+}
+
+void XmlReader_register(lua_State* L) {
+	static const struct luaL_Reg methods[] = {
+		{"next", Xml_readerNext},
+		{"events", Xml_readerEvents},
+		{"skip", Xml_readerSkip},
+		{"name", Xml_readerName},
+		{"text", Xml_readerText},
+		{"attr", Xml_readerAttr},
+		{"attrs", Xml_readerAttrs},
+		{"depth", Xml_readerDepth},
+		{"offset", Xml_readerOffset},
+		{"close", Xml_readerClose},
+		{NULL, NULL}
+	};
+	if(luaL_newmetatable(L, XML_READER)) {
+		luaL_newlib(L, methods);
+		lua_setfield(L, -2, "__index");
+		lua_pushcfunction(L, Xml_readerClose);
+		lua_setfield(L, -2, "__gc");
+		lua_pushcfunction(L, Xml_readerClose);
+		lua_setfield(L, -2, "__close");
+	}
+	lua_pop(L, 1);
+	lua_pushcfunction(L, Xml_reader);
+	lua_setfield(L, -2, "reader");
+}
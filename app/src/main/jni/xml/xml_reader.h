@@ -0,0 +1,76 @@
+#ifndef XML_READER_H
+#define XML_READER_H
+
+#include <lua.h>
+#include <stdio.h>
+#include <stddef.h>
+
+//--- pull parser --------------------------------------------------
+
+enum {
+	XML_EV_EOF = 0,
+	XML_EV_START,
+	XML_EV_END,
+	XML_EV_TEXT,
+	XML_EV_ERROR
+};
+
+typedef struct XmlReader_s {
+	/// current input window
+	const char* buf;
+	/// bytes available in buf
+	size_t len;
+	/// read position in buf
+	size_t pos;
+	/// start of the token being scanned, kept when the window is refilled
+	size_t mark;
+	/// bytes dropped from the front of the window so far
+	size_t offset;
+	/// owned window when streaming from a FILE
+	char* own;
+	size_t cap;
+	FILE* fp;
+	/// Lua file handle (luaL_Stream) fp belongs to, if any
+	void* stream;
+	/// mapped file, if any
+	void* map;
+	size_t map_size;
+	/// names of the open elements, each followed by its length (a size_t)
+	char* open;
+	size_t open_len, open_cap;
+	/// element nesting depth after the current event
+	int depth;
+	/// a self-closing tag still owes its end event
+	int pending_end;
+	/// last event returned
+	int event;
+	/// current event data, as offsets into buf
+	size_t name, name_len;
+	size_t attrs, attrs_len;
+	size_t text, text_len;
+	/// text contains '&' and needs entity decoding
+	int text_amp;
+	/// static description of the last error
+	const char* error;
+} XmlReader;
+
+void XmlReader_initBuffer(XmlReader* r, const char* s, size_t size);
+int XmlReader_initStream(XmlReader* r, FILE* fp);
+int XmlReader_initMap(XmlReader* r, const char* filename);
+void XmlReader_free(XmlReader* r);
+
+int XmlReader_next(XmlReader* r);
+int XmlReader_skip(XmlReader* r);
+int XmlReader_nextAttr(XmlReader* r, size_t* it, const char** key, size_t* key_len, const char** val, size_t* val_len);
+size_t XmlReader_offset(const XmlReader* r);
+
+/// pushes s with the predefined, numeric and registered entities resolved;
+/// amp tells whether s may contain '&' (defined in xml.c)
+void Xml_pushDecode(lua_State* L, const char* s, size_t n, int amp);
+
+/// pushes a garbage-collected reader userdata (uninitialized input)
+XmlReader* XmlReader_push(lua_State* L);
+/// adds xml.reader to the module table on top of the stack
+void XmlReader_register(lua_State* L);
+
+#endif
@@ -137,6 +137,50 @@ static yyjson_mut_val *lua_to_yyjson(lua_State *L, int idx, yyjson_mut_doc *doc)
     }
 }
 
+#define YYJSON_BULK_MIN 16
+
+/*
+ * 元素全为整数、全为浮点数或全为字符串的数组，先收集到临时缓冲区，
+ * 再一次性拷贝进表的数组部分；其它数组返回0，由调用者逐个转换
+ */
+static int yyjson_arr_to_lua_bulk(lua_State *L, yyjson_val *arr) {
+    size_t idx, max, n = yyjson_arr_size(arr);
+    yyjson_val *elem;
+    int all_int = 1, all_real = 1, all_str = 1;
+    if (n < YYJSON_BULK_MIN) return 0;
+    yyjson_arr_foreach(arr, idx, max, elem) {
+        all_int &= yyjson_is_int(elem);
+        all_real &= yyjson_is_real(elem);
+        all_str &= yyjson_is_str(elem);
+        if (!(all_int | all_real | all_str)) return 0;
+    }
+    if (all_int) {
+        lua_Integer *buf = (lua_Integer *)lua_newuserdatauv(L, n * sizeof(lua_Integer), 0);
+        yyjson_arr_foreach(arr, idx, max, elem) {
+            buf[idx] = yyjson_is_sint(elem) ? (lua_Integer)yyjson_get_sint(elem)
+                                            : (lua_Integer)yyjson_get_uint(elem);
+        }
+        lua_createarrayi(L, buf, n);
+    } else if (all_real) {
+        lua_Number *buf = (lua_Number *)lua_newuserdatauv(L, n * sizeof(lua_Number), 0);
+        yyjson_arr_foreach(arr, idx, max, elem) {
+            buf[idx] = (lua_Number)yyjson_get_real(elem);
+        }
+        lua_createarrayn(L, buf, n);
+    } else {
+        const char **strs = (const char **)lua_newuserdatauv(L,
+                                n * (sizeof(const char *) + sizeof(size_t)), 0);
+        size_t *lens = (size_t *)(strs + n);
+        yyjson_arr_foreach(arr, idx, max, elem) {
+            strs[idx] = yyjson_get_str(elem);
+            lens[idx] = yyjson_get_len(elem);
+        }
+        lua_createarrays(L, strs, lens, n);
+    }
+    lua_remove(L, -2);
+    return 1;
+}
+
 static void yyjson_to_lua(lua_State *L, yyjson_val *val) {
     switch (yyjson_get_type(val)) {
         case YYJSON_TYPE_NULL:
@@ -163,17 +207,18 @@ static void yyjson_to_lua(lua_State *L, yyjson_val *val) {
         case YYJSON_TYPE_ARR: {
             size_t idx, max;
         yyjson_val *elem;
-        lua_newtable(L);
+        if (yyjson_arr_to_lua_bulk(L, val)) break;
+        lua_createtable(L, (int)yyjson_arr_size(val), 0);
         yyjson_arr_foreach(val, idx, max, elem) {
                 yyjson_to_lua(L, elem);
-                lua_seti(L, -2, idx + 1);
+                lua_rawseti(L, -2, idx + 1);
             }
             break;
         }
         case YYJSON_TYPE_OBJ: {
             size_t idx, max;
         yyjson_val *key, *elem;
-        lua_newtable(L);
+        lua_createtable(L, 0, (int)yyjson_obj_size(val));
         yyjson_obj_foreach(val, idx, max, key, elem) {
                 const char *k = yyjson_get_str(key);
                 size_t klen = yyjson_get_len(key);
@@ -270,7 +315,7 @@ static int lua_yyjson_read(lua_State *L) {
         return luaL_error(L, "参数必须是字符串");
     }
 
-    doc = yyjson_read_opts((char *)json_str, len, YYJSON_READ_INSITU, NULL, &err);
+    doc = yyjson_read_opts((char *)json_str, len, YYJSON_READ_NOFLAG, NULL, &err);
     if (!doc) {
         lua_pushnil(L);
         lua_pushstring(L, err.msg);
@@ -293,7 +338,7 @@ static int lua_yyjson_decode(lua_State *L) {
         return luaL_error(L, "参数必须是字符串");
     }
 
-    doc = yyjson_read_opts((char *)json_str, len, YYJSON_READ_INSITU, NULL, &err);
+    doc = yyjson_read_opts((char *)json_str, len, YYJSON_READ_NOFLAG, NULL, &err);
     if (!doc) {
         lua_pushnil(L);
         lua_pushstring(L, err.msg);
@@ -476,7 +521,7 @@ static int lua_yyjson_read_file(lua_State *L) {
         return 2;
     }
 
-    doc = yyjson_read_opts(buffer, read_size, YYJSON_READ_INSITU, NULL, &err);
+    doc = yyjson_read_opts(buffer, read_size, YYJSON_READ_NOFLAG, NULL, &err);
     free(buffer);
 
     if (!doc) {
@@ -570,7 +615,7 @@ static int lua_yyjson_validate(lua_State *L) {
         return luaL_error(L, "参数必须是字符串");
     }
 
-    doc = yyjson_read_opts((char *)json_str, len, YYJSON_READ_INSITU, NULL, &err);
+    doc = yyjson_read_opts((char *)json_str, len, YYJSON_READ_NOFLAG, NULL, &err);
     if (!doc) {
         lua_pushnil(L);
         lua_pushstring(L, err.msg);
@@ -2186,7 +2231,7 @@ static int lua_yyjson_parse_and_process_json(lua_State *L) {
     
     // 首先解析为不可变文档
     yyjson_read_err err;
-    yyjson_doc *immutable_doc = yyjson_read_opts((char *)json_str, strlen(json_str), YYJSON_READ_INSITU, NULL, &err);
+    yyjson_doc *immutable_doc = yyjson_read_opts((char *)json_str, strlen(json_str), YYJSON_READ_NOFLAG, NULL, &err);
     if (!immutable_doc) {
         lua_pushnil(L);
         lua_pushstring(L, err.msg);
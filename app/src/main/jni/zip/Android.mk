@@ -19,12 +19,14 @@ LOCAL_C_INCLUDES += $(LOCAL_PATH)/../lua
 LOCAL_MODULE    := libzip
 LOCAL_SRC_FILES :=\
 	lua_zip.c \
+	lua_zip_searcher.c \
 	mkstemp.c \
 	zip_add.c \
 	zip_add_dir.c \
 	zip_add_entry.c \
 	zip_buffer.c \
 	zip_close.c \
+	zip_close_parallel.c \
 	zip_delete.c \
 	zip_dir_add.c \
 	zip_dirent.c \
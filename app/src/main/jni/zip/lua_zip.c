@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
 
 #if LUA_VERSION_NUM == 501
 #define lua_objlen lua_rawlen
@@ -27,6 +28,7 @@
 #define absindex(L,i) ((i)>0?(i):lua_gettop(L)+(i)+1)
 
 static int S_archive_gc(lua_State* L);
+int lua_zip_register_searcher(lua_State* L);
 static int S_archive_get_num_files(lua_State* L);
 
 static void stackdump(lua_State* l)
@@ -395,6 +397,47 @@ static int S_archive_set_file_comment(lua_State* L) {
     return 0;
 }
 
+/* Configure how changed entries are deflated when the archive is
+ * closed: zlib level (-1..9) and number of threads (0 = one per CPU).
+ */
+static int S_archive_set_compression(lua_State* L) {
+    struct zip** ar      = check_archive(L, 1);
+    int          level   = luaL_checkinteger(L, 2);
+    int          threads = luaL_optinteger(L, 3, 1);
+
+    if ( ! *ar ) return 0;
+
+    if ( threads == 0 ) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = ncpu > 0 ? (int)ncpu : 1;
+    }
+    if ( threads < 0 ) luaL_argerror(L, 3, "Must be >= 0");
+
+    if ( 0 != zip_archive_set_compression(*ar, level, threads) ) {
+        lua_pushstring(L, zip_strerror(*ar));
+        lua_error(L);
+    }
+
+    return 0;
+}
+
+/* Directory for temporary files, including compressed entries that
+ * are too large to keep in memory during a parallel close.
+ */
+static int S_archive_set_tempdir(lua_State* L) {
+    struct zip** ar      = check_archive(L, 1);
+    const char*  tempdir = lua_isnoneornil(L, 2) ? NULL : luaL_checkstring(L, 2);
+
+    if ( ! *ar ) return 0;
+
+    if ( 0 != zip_archive_set_tempdir(*ar, tempdir) ) {
+        lua_pushstring(L, zip_strerror(*ar));
+        lua_error(L);
+    }
+
+    return 0;
+}
+
 static int S_archive_add_dir(lua_State* L) {
     struct zip**        ar   = check_archive(L, 1);
     const char*         path = luaL_checkstring(L, 2);
@@ -704,6 +747,12 @@ static void S_register_archive(lua_State* L) {
     lua_pushcfunction(L, S_archive_set_file_comment);
     lua_setfield(L, -2, "set_file_comment");
 
+    lua_pushcfunction(L, S_archive_set_compression);
+    lua_setfield(L, -2, "set_compression");
+
+    lua_pushcfunction(L, S_archive_set_tempdir);
+    lua_setfield(L, -2, "set_tempdir");
+
     lua_pushcfunction(L, S_archive_add_dir);
     lua_setfield(L, -2, "add_dir");
 
@@ -788,6 +837,7 @@ LUALIB_API int luaopen_zip(lua_State* L) {
     S_register_archive(L);
     S_register_archive_file(L);
     S_register_weak(L);
+    lua_zip_register_searcher(L);
 
     return 1;
 }
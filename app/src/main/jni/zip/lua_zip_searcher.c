@@ -0,0 +1,482 @@
+#include <lauxlib.h>
+#include <lua.h>
+#include <zlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* package.searchers entry that loads modules straight out of mounted
+ * zip/APK archives.  Each archive is mmap'ed once and its central
+ * directory parsed into a hash index; stored entries are handed to
+ * lua_load without copying and deflated entries are inflated in
+ * chunks as lua_load asks for them.
+ */
+
+#define MOUNT_MT        "zip{mount}"
+#define MOUNTS_KEY      "zip{mounts}"
+
+#define DEFAULT_TEMPLATES "?.lua;?/init.lua"
+
+#define EOCD_SIG        0x06054b50
+#define CDIR_SIG        0x02014b50
+#define LOCAL_SIG       0x04034b50
+#define EOCD_SIZE       22
+#define CDIR_SIZE       46
+#define LOCAL_SIZE      30
+
+#define INFLATE_CHUNK   16384
+
+typedef struct {
+    const unsigned char* name;
+    size_t               name_len;
+    uint32_t             hash;
+    uint16_t             method;
+    uint16_t             flags;
+    uint32_t             comp_size;
+    uint32_t             size;
+    uint32_t             offset;      /* local header */
+} S_entry;
+
+typedef struct {
+    unsigned char* map;
+    size_t         map_len;
+    S_entry*       entries;
+    size_t         nentries;
+    uint32_t*      slots;             /* entry index + 1, 0 = empty */
+    size_t         nslots;            /* power of two */
+    char*          path;
+    char*          root;              /* prefix inside the archive, "" or ending in '/' */
+    char*          templates;
+} S_mount;
+
+typedef struct {
+    const unsigned char* data;
+    size_t               left;
+    int                  inflating;
+    z_stream             zs;
+    unsigned char        out[INFLATE_CHUNK];
+} S_reader;
+
+static uint16_t S_get16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t S_get32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t S_hash(const unsigned char* s, size_t len) {
+    uint32_t h = 2166136261u;
+    size_t   i;
+    for ( i = 0; i < len; i++ ) {
+        h ^= s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void S_mount_release(S_mount* m) {
+    if ( m->map ) munmap(m->map, m->map_len);
+    free(m->entries);
+    free(m->slots);
+    free(m->path);
+    free(m->root);
+    free(m->templates);
+    memset(m, 0, sizeof(*m));
+}
+
+static const S_entry* S_mount_find(const S_mount* m, const char* name, size_t len) {
+    uint32_t h    = S_hash((const unsigned char*)name, len);
+    size_t   mask = m->nslots - 1;
+    size_t   i    = h & mask;
+
+    while ( m->slots[i] ) {
+        const S_entry* e = &m->entries[m->slots[i] - 1];
+        if ( e->hash == h && e->name_len == len && 0 == memcmp(e->name, name, len) ) {
+            return e;
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+/* Locate the end of central directory record and index every entry.
+ * Returns NULL on success, otherwise a static error message.
+ */
+static const char* S_mount_index(S_mount* m) {
+    const unsigned char* p;
+    const unsigned char* eocd = NULL;
+    const unsigned char* end  = m->map + m->map_len;
+    uint32_t             cd_size, cd_offset;
+    size_t               n, i;
+
+    if ( m->map_len < EOCD_SIZE ) return "not a zip archive";
+
+    /* the record is followed by a comment of at most 65535 bytes */
+    for ( p = end - EOCD_SIZE; p >= m->map && p >= end - EOCD_SIZE - 0xffff; p-- ) {
+        if ( S_get32(p) == EOCD_SIG && p + EOCD_SIZE + S_get16(p + 20) == end ) {
+            eocd = p;
+            break;
+        }
+    }
+    if ( ! eocd ) return "not a zip archive";
+
+    n         = S_get16(eocd + 10);
+    cd_size   = S_get32(eocd + 12);
+    cd_offset = S_get32(eocd + 16);
+    if ( n == 0xffff || cd_offset == 0xffffffffu ) return "zip64 archives are not supported";
+    if ( (size_t)cd_offset + cd_size > (size_t)(eocd - m->map) ) return "central directory out of range";
+
+    m->entries = (S_entry*)malloc((n ? n : 1) * sizeof(S_entry));
+    for ( m->nslots = 16; m->nslots < n * 2; m->nslots <<= 1 ) {}
+    m->slots = (uint32_t*)calloc(m->nslots, sizeof(uint32_t));
+    if ( ! m->entries || ! m->slots ) return "not enough memory";
+
+    p = m->map + cd_offset;
+    for ( i = 0; i < n; i++ ) {
+        S_entry* e = &m->entries[m->nentries];
+        size_t   name_len, skip, slot;
+
+        if ( p + CDIR_SIZE > end || S_get32(p) != CDIR_SIG ) return "corrupt central directory";
+        name_len = S_get16(p + 28);
+        skip     = CDIR_SIZE + name_len + S_get16(p + 30) + S_get16(p + 32);
+        if ( p + skip > end ) return "corrupt central directory";
+
+        e->name      = p + CDIR_SIZE;
+        e->name_len  = name_len;
+        e->hash      = S_hash(e->name, name_len);
+        e->flags     = S_get16(p + 8);
+        e->method    = S_get16(p + 10);
+        e->comp_size = S_get32(p + 20);
+        e->size      = S_get32(p + 24);
+        e->offset    = S_get32(p + 42);
+        p += skip;
+
+        /* the real values would be in a zip64 extra field */
+        if ( e->comp_size == 0xffffffffu || e->size == 0xffffffffu || e->offset == 0xffffffffu )
+            return "zip64 archives are not supported";
+
+        /* directories and duplicates never resolve to a module */
+        if ( name_len == 0 || e->name[name_len - 1] == '/' ) continue;
+        if ( S_mount_find(m, (const char*)e->name, name_len) ) continue;
+
+        slot = e->hash & (m->nslots - 1);
+        while ( m->slots[slot] ) slot = (slot + 1) & (m->nslots - 1);
+        m->slots[slot] = (uint32_t)(++m->nentries);
+    }
+    return NULL;
+}
+
+static const char* S_reader_read(lua_State* L, void* ud, size_t* size) {
+    S_reader* r = (S_reader*)ud;
+    int       ret;
+
+    (void)L;
+    if ( ! r->inflating ) {
+        *size   = r->left;
+        r->left = 0;
+        return *size ? (const char*)r->data : NULL;
+    }
+
+    r->zs.next_out  = r->out;
+    r->zs.avail_out = sizeof(r->out);
+    ret = inflate(&r->zs, Z_NO_FLUSH);
+    if ( ret != Z_OK && ret != Z_STREAM_END ) {
+        /* truncate the chunk; lua_load reports the damage */
+        *size = 0;
+        return NULL;
+    }
+    *size = sizeof(r->out) - r->zs.avail_out;
+    return *size ? (const char*)r->out : NULL;
+}
+
+/* Push the loaded chunk for entry e, or an error message.  Returns
+ * the lua_load status.
+ */
+static int S_mount_load(lua_State* L, const S_mount* m, const S_entry* e, const char* chunkname) {
+    const unsigned char* local = m->map + e->offset;
+    S_reader*            r;
+    int                  status;
+
+    if ( e->flags & 1 ) {
+        lua_pushliteral(L, "encrypted entries are not supported");
+        return LUA_ERRFILE;
+    }
+    if ( e->method != 0 && e->method != Z_DEFLATED ) {
+        lua_pushfstring(L, "unsupported compression method %d", (int)e->method);
+        return LUA_ERRFILE;
+    }
+    if ( (size_t)e->offset + LOCAL_SIZE > m->map_len || S_get32(local) != LOCAL_SIG ) {
+        lua_pushliteral(L, "corrupt local header");
+        return LUA_ERRFILE;
+    }
+    local += LOCAL_SIZE + S_get16(local + 26) + S_get16(local + 28);
+    if ( local + e->comp_size > m->map + m->map_len ) {
+        lua_pushliteral(L, "entry data out of range");
+        return LUA_ERRFILE;
+    }
+
+    /* the inflate buffer is too large for the C stack of a coroutine */
+    r = (S_reader*)lua_newuserdata(L, e->method ? sizeof(S_reader) : offsetof(S_reader, zs));
+    r->data      = local;
+    r->left      = e->comp_size;
+    r->inflating = e->method != 0;
+    if ( r->inflating ) {
+        memset(&r->zs, 0, sizeof(r->zs));
+        r->zs.next_in  = (Bytef*)local;
+        r->zs.avail_in = e->comp_size;
+        if ( inflateInit2(&r->zs, -MAX_WBITS) != Z_OK ) {
+            lua_pop(L, 1);
+            lua_pushliteral(L, "cannot initialize inflate");
+            return LUA_ERRMEM;
+        }
+    }
+
+    status = lua_load(L, S_reader_read, r, chunkname, NULL);
+
+    if ( r->inflating ) inflateEnd(&r->zs);
+    lua_remove(L, -2);
+    return status;
+}
+
+/* package.searchers entry: upvalue 1 is the list of mounts.
+ */
+static int S_searcher(lua_State* L) {
+    const char* name = luaL_checkstring(L, 1);
+    int         i, n;
+
+    /* luaL_gsub may leave buffer state below its result, so results
+     * are copied into fixed slots and the stack trimmed back */
+    lua_settop(L, 1);
+    lua_pushnil(L);                                          /* 2: name as path */
+    lua_pushliteral(L, "");                                  /* 3: "no file" messages */
+    luaL_gsub(L, name, ".", "/");
+    lua_copy(L, -1, 2);
+    lua_settop(L, 3);
+    name = lua_tostring(L, 2);
+
+    n = (int)lua_rawlen(L, lua_upvalueindex(1));
+    for ( i = 1; i <= n; i++ ) {
+        S_mount*    m;
+        const char* tmpl;
+
+        lua_rawgeti(L, lua_upvalueindex(1), i);
+        m = (S_mount*)luaL_checkudata(L, -1, MOUNT_MT);
+        lua_pop(L, 1);
+        if ( ! m->map ) continue;
+
+        for ( tmpl = m->templates; *tmpl; ) {
+            const char*    sep = strchr(tmpl, ';');
+            size_t         len = sep ? (size_t)(sep - tmpl) : strlen(tmpl);
+            const char*    entry;
+            size_t         entry_len;
+            const S_entry* e;
+
+            lua_pushnil(L);                                  /* 4: entry name */
+            lua_pushlstring(L, tmpl, len);
+            luaL_gsub(L, lua_tostring(L, -1), "?", name);
+            lua_pushstring(L, m->root);
+            lua_insert(L, -2);
+            lua_concat(L, 2);
+            lua_copy(L, -1, 4);
+            lua_settop(L, 4);
+            entry = lua_tolstring(L, 4, &entry_len);
+
+            tmpl += len;
+            if ( *tmpl == ';' ) tmpl++;
+
+            if ( ! (e = S_mount_find(m, entry, entry_len)) ) {
+                lua_pushfstring(L, "%s%sno file '%s!/%s'", lua_tostring(L, 3),
+                                *lua_tostring(L, 3) ? "\n\t" : "", m->path, entry);
+                lua_replace(L, 3);
+                lua_settop(L, 3);
+                continue;
+            }
+
+            lua_pushfstring(L, "%s!/%s", m->path, entry);   /* 5: file name */
+            lua_pushfstring(L, "@%s", lua_tostring(L, 5));  /* 6: chunk name */
+            if ( S_mount_load(L, m, e, lua_tostring(L, 6)) != LUA_OK ) {
+                return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s",
+                                  lua_tostring(L, 1), lua_tostring(L, 5), lua_tostring(L, -1));
+            }
+            lua_pushvalue(L, 5);
+            return 2;
+        }
+    }
+
+    /* require puts the separator in front of each searcher's message */
+    if ( lua_rawlen(L, 3) == 0 ) return 0;
+    lua_settop(L, 3);
+    return 1;
+}
+
+static int S_mount_gc(lua_State* L) {
+    S_mount* m = (S_mount*)luaL_checkudata(L, 1, MOUNT_MT);
+    S_mount_release(m);
+    return 0;
+}
+
+/* Remove a mount from the searcher and unmap the archive.
+ */
+static int S_mount_unmount(lua_State* L) {
+    S_mount* m = (S_mount*)luaL_checkudata(L, 1, MOUNT_MT);
+    int      i, n;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, MOUNTS_KEY);
+    n = (int)lua_rawlen(L, -1);
+    for ( i = 1; i <= n; i++ ) {
+        lua_rawgeti(L, -1, i);
+        if ( lua_rawequal(L, -1, 1) ) {
+            lua_pop(L, 1);
+            for ( ; i < n; i++ ) {
+                lua_rawgeti(L, -1, i + 1);
+                lua_rawseti(L, -2, i);
+            }
+            lua_pushnil(L);
+            lua_rawseti(L, -2, n);
+            break;
+        }
+        lua_pop(L, 1);
+    }
+
+    S_mount_release(m);
+    return 0;
+}
+
+/* Install the searcher right after the preload searcher the first
+ * time an archive is mounted.  Leaves the mounts list on the stack.
+ */
+static void S_push_mounts(lua_State* L) {
+    int n, i;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, MOUNTS_KEY);
+    if ( ! lua_isnil(L, -1) ) return;
+    lua_pop(L, 1);
+
+    lua_newtable(L);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, LUA_REGISTRYINDEX, MOUNTS_KEY);
+
+    lua_getglobal(L, "package");
+    if ( ! lua_istable(L, -1) ) luaL_error(L, "package library not loaded");
+#if LUA_VERSION_NUM == 501
+    lua_getfield(L, -1, "loaders");
+#else
+    lua_getfield(L, -1, "searchers");
+#endif
+    if ( ! lua_istable(L, -1) ) luaL_error(L, "package.searchers must be a table");
+
+    n = (int)lua_rawlen(L, -1);
+    for ( i = n; i >= 2; i-- ) {
+        lua_rawgeti(L, -1, i);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_pushvalue(L, -3);
+    lua_pushcclosure(L, S_searcher, 1);
+    lua_rawseti(L, -2, n >= 1 ? 2 : 1);
+    lua_pop(L, 2);
+}
+
+/* zip.mount(path [, root [, templates]]) mounts an archive for
+ * require.  root is a directory inside the archive, templates a
+ * ';' separated list like package.path (default "?.lua;?/init.lua").
+ * Later mounts are searched after earlier ones.
+ */
+static int S_mount_archive(lua_State* L) {
+    const char* path      = luaL_checkstring(L, 1);
+    size_t      root_len  = 0;
+    const char* root      = luaL_optlstring(L, 2, "", &root_len);
+    const char* templates = luaL_optstring(L, 3, DEFAULT_TEMPLATES);
+    S_mount*    m;
+    struct stat st;
+    const char* err;
+    int         fd;
+
+    S_push_mounts(L);
+
+    m = (S_mount*)lua_newuserdata(L, sizeof(S_mount));
+    memset(m, 0, sizeof(*m));
+    luaL_getmetatable(L, MOUNT_MT);
+    lua_setmetatable(L, -2);
+
+    fd = open(path, O_RDONLY);
+    if ( fd < 0 ) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "%s: %s", path, strerror(errno));
+        return 2;
+    }
+    if ( fstat(fd, &st) < 0 || st.st_size == 0 ) {
+        close(fd);
+        lua_pushnil(L);
+        lua_pushfstring(L, "%s: not a zip archive", path);
+        return 2;
+    }
+    m->map_len = (size_t)st.st_size;
+    m->map     = (unsigned char*)mmap(NULL, m->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( m->map == MAP_FAILED ) {
+        m->map = NULL;
+        lua_pushnil(L);
+        lua_pushfstring(L, "%s: %s", path, strerror(errno));
+        return 2;
+    }
+
+    m->path      = strdup(path);
+    m->root      = (char*)malloc(root_len + 2);
+    m->templates = strdup(templates);
+    if ( ! m->path || ! m->root || ! m->templates ) {
+        S_mount_release(m);
+        return luaL_error(L, "not enough memory");
+    }
+    memcpy(m->root, root, root_len);
+    if ( root_len > 0 && root[root_len - 1] != '/' ) m->root[root_len++] = '/';
+    m->root[root_len] = '\0';
+
+    if ( (err = S_mount_index(m)) != NULL ) {
+        S_mount_release(m);
+        lua_pushnil(L);
+        lua_pushfstring(L, "%s: %s", path, err);
+        return 2;
+    }
+
+    lua_pushvalue(L, -1);
+    lua_rawseti(L, -3, (int)lua_rawlen(L, -3) + 1);
+    return 1;
+}
+
+static int S_mount_count(lua_State* L) {
+    S_mount* m = (S_mount*)luaL_checkudata(L, 1, MOUNT_MT);
+    lua_pushinteger(L, (lua_Integer)m->nentries);
+    return 1;
+}
+
+int lua_zip_register_searcher(lua_State* L) {
+    static const luaL_Reg mount_methods[] = {
+        { "unmount", S_mount_unmount },
+        { NULL, NULL }
+    };
+
+    luaL_newmetatable(L, MOUNT_MT);
+    lua_newtable(L);
+#if LUA_VERSION_NUM > 501
+    luaL_setfuncs(L, mount_methods, 0);
+#else
+    luaL_register(L, NULL, mount_methods);
+#endif
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, S_mount_gc);
+    lua_setfield(L, -2, "__gc");
+    lua_pushcfunction(L, S_mount_count);
+    lua_setfield(L, -2, "__len");
+    lua_pop(L, 1);
+
+    lua_pushcfunction(L, S_mount_archive);
+    lua_setfield(L, -2, "mount");
+    return 0;
+}
@@ -0,0 +1,164 @@
+-- archive:set_compression(level, threads) and deflating entries in parallel on close
+local zip = require "zip"
+
+local dir = os.tmpname()
+os.remove(dir)
+assert(os.execute("mkdir " .. dir))
+
+local function readall(path)
+	local ar = assert(zip.open(path))
+	local out = {}
+	for i = 1, ar:get_num_files() do
+		local st = ar:stat(i)
+		local f = assert(ar:open(i))
+		out[st.name] = st.size > 0 and f:read(st.size) or ""
+		f:close()
+	end
+	ar:close()
+	return out
+end
+
+local function check(path, want)
+	local got, n = readall(path), 0
+	for name, data in pairs(want) do
+		n = n + 1
+		assert(got[name] == data, name)
+	end
+	for _ in pairs(got) do n = n - 1 end
+	assert(n == 0)
+end
+
+-- incompressible bytes from a fixed LCG
+local function noise(len, seed)
+	local t, x = {}, seed
+	for i = 1, len do
+		x = (x * 1103515245 + 12345) % 2147483648
+		t[i] = string.char(x >> 16 & 255)
+	end
+	return table.concat(t)
+end
+
+local function text(i, len)
+	return string.rep("entry " .. i .. " line of text\n", len // 20 + 1):sub(1, len)
+end
+
+do print("same contents as a sequential close")
+	local want = {}
+	for i = 1, 60 do
+		local len = (i * 7919) % 200000
+		want["f" .. i .. ".txt"] = i % 5 == 0 and noise(len, i) or text(i, len)
+	end
+	want["empty"] = ""
+	local disk = dir .. "/src.bin"
+	local f = assert(io.open(disk, "wb"))
+	f:write(text(0, 300000))
+	f:close()
+	want["from_file"] = text(0, 300000)
+
+	local sizes = {}
+	for _, threads in ipairs{ 1, 4 } do
+		local path = dir .. "/t" .. threads .. ".zip"
+		local ar = assert(zip.open(path, zip.CREATE))
+		ar:set_compression(6, threads)
+		for name, data in pairs(want) do
+			if name ~= "from_file" then ar:add(name, "string", data) end
+		end
+		ar:add("from_file", "file", disk)
+		ar:close()
+		check(path, want)
+		sizes[threads] = {}
+		local a = assert(zip.open(path))
+		for i = 1, a:get_num_files() do
+			local st = a:stat(i)
+			sizes[threads][st.name] = st.comp_size
+		end
+		a:close()
+	end
+	for name, data in pairs(want) do
+		local seq, par = sizes[1][name], sizes[4][name]
+		if name:match("^f%d*[05]%.txt$") then
+			-- incompressible: stored by the workers instead of growing
+			assert(par == #data and seq >= par, name)
+		else
+			assert(par == seq, name)
+		end
+	end
+	assert(sizes[4]["f1.txt"] < #want["f1.txt"] // 4)
+end
+
+do print("more threads than entries")
+	for _, n in ipairs{ 1, 2, 3 } do
+		local path = dir .. "/few" .. n .. ".zip"
+		local ar = assert(zip.open(path, zip.CREATE))
+		ar:set_compression(-1, 64)
+		local want = {}
+		for i = 1, n do
+			want["x" .. i] = text(i, 50000)
+			ar:add("x" .. i, "string", want["x" .. i])
+		end
+		ar:close()
+		check(path, want)
+	end
+end
+
+do print("many entries on few threads")
+	local path = dir .. "/many.zip"
+	local ar = assert(zip.open(path, zip.CREATE))
+	ar:set_compression(1, 3)
+	local want = {}
+	for i = 1, 500 do
+		want["m/" .. i] = text(i, i * 37)
+		ar:add("m/" .. i, "string", want["m/" .. i])
+	end
+	ar:close()
+	check(path, want)
+end
+
+do print("changing an existing archive")
+	local path = dir .. "/many.zip"
+	local want = readall(path)
+	local ar = assert(zip.open(path))
+	ar:set_compression(9, 4)
+	for i = 1, 500, 3 do
+		local name = "m/" .. i
+		want[name] = text(-i, 1000 + i)
+		ar:replace(ar:name_locate(name), "string", want[name])
+	end
+	for i = 2, 500, 50 do
+		ar:delete(ar:name_locate("m/" .. i))
+		want["m/" .. i] = nil
+	end
+	-- copied from another archive: written by the closing thread
+	local other = assert(zip.open(dir .. "/t4.zip"))
+	ar:add("copied", "zip", other, other:name_locate("f1.txt"))
+	want["copied"] = text(1, 7919)
+	ar:close()
+	other:close()
+	check(path, want)
+end
+
+do print("large entries spill to the temporary directory")
+	local path = dir .. "/big.zip"
+	local ar = assert(zip.open(path, zip.CREATE))
+	ar:set_compression(0, 2)  -- stored-size deflate output, more than the spill limit
+	ar:set_tempdir(dir)
+	local big = noise(9 * 1024 * 1024, 7)
+	ar:add("big", "string", big)
+	ar:add("small", "string", "small")
+	ar:close()
+	check(path, { big = big, small = "small" })
+end
+
+do print("argument errors")
+	local ar = assert(zip.open(dir .. "/err.zip", zip.CREATE))
+	assert(not pcall(ar.set_compression, ar, 10, 2))
+	assert(not pcall(ar.set_compression, ar, -2, 2))
+	assert(not pcall(ar.set_compression, ar, 6, -1))
+	ar:set_compression(6, 0)  -- one per CPU
+	ar:add("a", "string", "a")
+	ar:close()
+	check(dir .. "/err.zip", { a = "a" })
+end
+
+assert(os.execute("rm -r " .. dir))
+print("OK")
@@ -0,0 +1,150 @@
+-- zip.mount(path [, root [, templates]]) and the package searcher it installs
+local zip = require "zip"
+
+local dir = os.tmpname()
+os.remove(dir)
+assert(os.execute("mkdir " .. dir))
+
+-- writes an archive of stored entries by hand so headers can be damaged
+local function rawzip(path, files, patch)
+	local body, cdir = {}, {}
+	local offset = 0
+	for _, f in ipairs(files) do
+		local name, data = f[1], f[2]
+		local lh = string.pack("<I4I2I2I2I2I2I4I4I4I2I2", 0x04034b50, 20, 0, 0, 0, 0,
+			0, #data, #data, #name, 0) .. name
+		local cd = {
+			sig = 0x02014b50, comp = #data, size = #data, offset = offset,
+		}
+		if patch then patch(name, cd) end
+		cdir[#cdir + 1] = string.pack("<I4I2I2I2I2I2I2I4I4I4I2I2I2I2I2I4I4", cd.sig, 20, 20, 0, 0,
+			0, 0, 0, cd.comp, cd.size, #name, 0, 0, 0, 0, 0, cd.offset) .. name
+		body[#body + 1] = lh .. data
+		offset = offset + #lh + #data
+	end
+	local cd = table.concat(cdir)
+	local n = #files
+	local eocd = { n = n, size = #cd, offset = offset }
+	if patch then patch(nil, eocd) end
+	local f = assert(io.open(path, "wb"))
+	f:write(table.concat(body), cd,
+		string.pack("<I4I2I2I2I2I4I4I2", 0x06054b50, 0, 0, eocd.n, eocd.n, eocd.size, eocd.offset, 0))
+	f:close()
+	return path
+end
+
+local function mkzip(path, files)
+	local ar = assert(zip.open(path, zip.CREATE))
+	for _, f in ipairs(files) do ar:add(f[1], "string", f[2]) end
+	ar:close()
+	return path
+end
+
+do print("stored and deflated modules")
+	local stored = rawzip(dir .. "/stored.zip", {
+		{ "zs_a.lua", "return 'stored a'" },
+		{ "zs_pkg/", "" },
+		{ "zs_pkg/init.lua", "return { name = ..., file = select(2, ...) }" },
+	})
+	local m = assert(zip.mount(stored))
+	assert(#m == 2)  -- directories are not indexed
+	assert(require "zs_a" == "stored a")
+	local pkg = require "zs_pkg"
+	assert(pkg.name == "zs_pkg" and pkg.file == stored .. "!/zs_pkg/init.lua")
+
+	local big = {}
+	for i = 1, 5000 do big[i] = "x" .. i .. " = " .. i end
+	big[#big + 1] = "return x5000 + x1"
+	local deflated = mkzip(dir .. "/deflated.zip", {
+		{ "zd/big.lua", table.concat(big, "\n") },
+		{ "zd/small.lua", "return ..." },
+	})
+	local m2 = assert(zip.mount(deflated))
+	assert(require "zd.big" == 5001)
+	assert(require "zd.small" == "zd.small")
+	m:unmount()
+	m2:unmount()
+end
+
+do print("root and templates")
+	local path = mkzip(dir .. "/root.zip", {
+		{ "assets/lua/zr_mod.lua", "return 'under root'" },
+		{ "zr_mod.lua", "return 'top level'" },
+		{ "assets/lua/zr_mod.luac", "return 'template'" },
+	})
+	local m = assert(zip.mount(path, "assets/lua"))
+	assert(require "zr_mod" == "under root")
+	m:unmount()
+	package.loaded.zr_mod = nil
+	m = assert(zip.mount(path, "assets/lua/", "?.luac"))
+	assert(require "zr_mod" == "template")
+	m:unmount()
+end
+
+do print("search order and messages")
+	local first = mkzip(dir .. "/first.zip", { { "zo.lua", "return 1" } })
+	local second = mkzip(dir .. "/second.zip", { { "zo.lua", "return 2" }, { "zo2.lua", "return 2" } })
+	local a = assert(zip.mount(first))
+	local b = assert(zip.mount(second))
+	assert(require "zo" == 1 and require "zo2" == 2)
+	local ok, err = pcall(require, "zo_missing")
+	assert(not ok)
+	assert(err:find("no file '" .. first .. "!/zo_missing.lua'", 1, true))
+	assert(err:find("no file '" .. second .. "!/zo_missing/init.lua'", 1, true))
+	a:unmount()
+	b:unmount()
+	ok, err = pcall(require, "zo_missing")
+	assert(not ok and not err:find(first, 1, true))
+
+	local bad = mkzip(dir .. "/bad.zip", { { "zb.lua", "return +" } })
+	local m = assert(zip.mount(bad))
+	ok, err = pcall(require, "zb")
+	assert(not ok and err:find("error loading module 'zb' from file '" .. bad .. "!/zb.lua'", 1, true))
+	m:unmount()
+end
+
+do print("rejected archives")
+	local files = { { "zx.lua", "return 1" } }
+	local function fails(path, msg)
+		local m, err = zip.mount(path)
+		assert(m == nil and err == path .. ": " .. msg, err)
+	end
+	fails(dir .. "/missing.zip", "No such file or directory")
+	local f = assert(io.open(dir .. "/empty.zip", "wb"))
+	f:close()
+	fails(dir .. "/empty.zip", "not a zip archive")
+	f = assert(io.open(dir .. "/text.zip", "wb"))
+	f:write(string.rep("not a zip ", 100))
+	f:close()
+	fails(dir .. "/text.zip", "not a zip archive")
+
+	-- zip64 sentinels in the end record or in any central directory entry
+	local function zip64(field, value, entry)
+		return rawzip(dir .. "/z64.zip", files, function(name, rec)
+			if (name ~= nil) == entry then rec[field] = value end
+		end)
+	end
+	fails(zip64("n", 0xffff, false), "zip64 archives are not supported")
+	fails(zip64("offset", 0xffffffff, false), "zip64 archives are not supported")
+	fails(zip64("comp", 0xffffffff, true), "zip64 archives are not supported")
+	fails(zip64("size", 0xffffffff, true), "zip64 archives are not supported")
+	fails(zip64("offset", 0xffffffff, true), "zip64 archives are not supported")
+
+	fails(rawzip(dir .. "/cd.zip", files, function(name, rec)
+		if name == nil then rec.offset = rec.offset + 1000 end
+	end), "central directory out of range")
+	fails(rawzip(dir .. "/sig.zip", files, function(name, rec)
+		if name then rec.sig = 0 end
+	end), "corrupt central directory")
+
+	-- a damaged entry only fails when it is loaded
+	local m = assert(zip.mount(rawzip(dir .. "/local.zip", files, function(name, rec)
+		if name then rec.offset = 5 end
+	end)))
+	local ok, err = pcall(require, "zx")
+	assert(not ok and err:find("corrupt local header", 1, true))
+	m:unmount()
+end
+
+assert(os.execute("rm -r " .. dir))
+print("OK")
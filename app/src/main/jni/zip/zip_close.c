@@ -68,6 +68,7 @@ zip_close(zip_t *za)
     zip_int64_t off;
     int error;
     zip_filelist_t *filelist;
+    zip_deflate_pool_t *pool;
     int changed;
 
     if (za == NULL)
@@ -125,6 +126,9 @@ zip_close(zip_t *za)
 	free(filelist);
 	return -1;
     }
+
+    /* deflate independent entries ahead of the writer; NULL means write sequentially */
+    pool = _zip_deflate_pool_new(za, filelist, survivors);
     
     error = 0;
     for (j=0; j<survivors; j++) {
@@ -160,6 +164,15 @@ zip_close(zip_t *za)
 
 	if (new_data) {
 	    zip_source_t *zs;
+	    int ret;
+
+	    if (pool && (ret=_zip_deflate_pool_write(pool, j, de)) != 0) {
+		if (ret < 0) {
+		    error = 1;
+		    break;
+		}
+		continue;
+	    }
 
 	    zs = NULL;
 	    if (!ZIP_ENTRY_DATA_CHANGED(entry)) {
@@ -204,6 +217,8 @@ zip_close(zip_t *za)
 	}
     }
 
+    _zip_deflate_pool_free(pool);
+
     if (!error) {
 	if (write_cdir(za, filelist, survivors) < 0)
 	    error = 1;
@@ -0,0 +1,545 @@
+/*
+  zip_close_parallel.c -- deflate changed entries on worker threads for zip_close
+  Copyright (C) 1999-2015 Dieter Baron and Thomas Klausner
+
+  This file is part of libzip, a library to manipulate ZIP archives.
+  The authors can be contacted at <libzip@nih.at>
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in
+     the documentation and/or other materials provided with the
+     distribution.
+  3. The names of the authors may not be used to endorse or promote
+     products derived from this software without specific prior
+     written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS
+  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+  IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "zipint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+
+/* compressed output is kept in memory up to this size, then spilled to a temporary file */
+#define SPILL_SIZE	(8*1024*1024)
+
+/* number of finished entries that may wait for the writer per worker */
+#define JOBS_PER_THREAD	2
+
+typedef struct {
+    zip_source_t *src;
+    bool can_store;
+    zip_stat_t st;
+
+    bool done;
+    zip_error_t error;
+    zip_int32_t comp_method;
+    zip_uint32_t crc;
+    zip_uint64_t size;
+    zip_uint64_t comp_size;
+
+    zip_uint8_t *data;
+    zip_uint64_t data_alloc;
+    FILE *spill;
+} zip_deflate_job_t;
+
+struct zip_deflate_pool {
+    zip_t *za;
+    int level;
+
+    zip_deflate_job_t *jobs;
+    zip_uint64_t njobs;
+    zip_uint64_t *job_index;	/* per survivor: job number + 1, 0 if written sequentially */
+
+    pthread_mutex_t lock;
+    pthread_cond_t finished;	/* a job was finished by a worker */
+    pthread_cond_t consumed;	/* a job was written to the archive */
+    pthread_t *threads;
+    unsigned int nthreads;
+    zip_uint64_t next;		/* next job to start */
+    zip_uint64_t written;	/* jobs written to the archive */
+    zip_uint64_t window;	/* jobs that may be started ahead of the writer */
+    bool stop;
+};
+
+static void *pool_main(void *);
+static void job_compress(zip_deflate_pool_t *, zip_deflate_job_t *);
+static int job_copy(zip_deflate_pool_t *, zip_deflate_job_t *);
+static void job_discard(zip_deflate_job_t *);
+static int job_output(zip_deflate_pool_t *, zip_deflate_job_t *, const zip_uint8_t *, zip_uint64_t);
+static int job_store(zip_deflate_pool_t *, zip_deflate_job_t *);
+
+
+/* _zip_deflate_pool_new:
+   start deflating all changed entries whose data comes from a plain
+   buffer or file source on za->comp_threads threads.  Returns NULL if
+   no entry qualifies or the pool could not be set up; zip_close then
+   writes everything sequentially. */
+
+zip_deflate_pool_t *
+_zip_deflate_pool_new(zip_t *za, const zip_filelist_t *filelist, zip_uint64_t survivors)
+{
+    zip_deflate_pool_t *pool;
+    zip_uint64_t j, njobs;
+    unsigned int i, nthreads;
+
+    if (za->comp_threads <= 1)
+	return NULL;
+
+    if ((pool=(zip_deflate_pool_t *)calloc(1, sizeof(*pool))) == NULL)
+	return NULL;
+    if ((pool->job_index=(zip_uint64_t *)calloc((size_t)survivors, sizeof(pool->job_index[0]))) == NULL
+	|| (pool->jobs=(zip_deflate_job_t *)calloc((size_t)survivors, sizeof(pool->jobs[0]))) == NULL) {
+	free(pool->job_index);
+	free(pool);
+	return NULL;
+    }
+    pool->za = za;
+    pool->level = za->comp_level;
+
+    njobs = 0;
+    for (j=0; j<survivors; j++) {
+	zip_entry_t *entry = za->entry+filelist[j].idx;
+	zip_source_t *src = entry->source;
+	zip_deflate_job_t *job;
+	zip_int32_t method;
+	zip_stat_t st;
+
+	if (!ZIP_ENTRY_DATA_CHANGED(entry))
+	    continue;
+	/* layered sources and sources reading from an archive share state with other entries */
+	if (ZIP_SOURCE_IS_LAYERED(src) || src->source_archive != NULL || ZIP_SOURCE_IS_OPEN_READING(src))
+	    continue;
+
+	if (entry->changes)
+	    method = entry->changes->comp_method;
+	else if (entry->orig)
+	    method = entry->orig->comp_method;
+	else
+	    method = ZIP_CM_DEFAULT;
+	if (method != ZIP_CM_DEFLATE && !ZIP_CM_IS_DEFAULT(method))
+	    continue;
+
+	if (zip_source_stat(src, &st) < 0)
+	    continue;
+	if ((st.valid & ZIP_STAT_COMP_METHOD) && st.comp_method != ZIP_CM_STORE)
+	    continue;
+	if ((st.valid & ZIP_STAT_SIZE) && st.size == 0)
+	    continue;
+
+	job = pool->jobs+njobs;
+	job->src = src;
+	job->can_store = ZIP_CM_IS_DEFAULT(method);
+	job->st = st;
+	zip_error_init(&job->error);
+	pool->job_index[j] = ++njobs;
+    }
+
+    if (njobs == 0) {
+	free(pool->jobs);
+	free(pool->job_index);
+	free(pool);
+	return NULL;
+    }
+
+    /* no point in more threads than entries to deflate */
+    nthreads = za->comp_threads;
+    if (nthreads > njobs)
+	nthreads = (unsigned int)njobs;
+
+    pool->njobs = njobs;
+    pool->window = (zip_uint64_t)nthreads * JOBS_PER_THREAD;
+
+    if ((pool->threads=(pthread_t *)malloc(sizeof(pool->threads[0])*nthreads)) == NULL) {
+	free(pool->jobs);
+	free(pool->job_index);
+	free(pool);
+	return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+    pthread_cond_init(&pool->consumed, NULL);
+
+    for (i=0; i<nthreads; i++) {
+	if (pthread_create(&pool->threads[i], NULL, pool_main, pool) != 0)
+	    break;
+	pool->nthreads++;
+    }
+
+    if (pool->nthreads == 0) {
+	_zip_deflate_pool_free(pool);
+	return NULL;
+    }
+
+    return pool;
+}
+
+
+/* _zip_deflate_pool_write:
+   write the local header and data of survivor j if it was deflated
+   by the pool.  Returns 1 if written, 0 if the entry is not handled
+   by the pool, -1 on error. */
+
+int
+_zip_deflate_pool_write(zip_deflate_pool_t *pool, zip_uint64_t j, zip_dirent_t *de)
+{
+    zip_deflate_job_t *job;
+    int ret;
+
+    if (pool->job_index[j] == 0)
+	return 0;
+    job = pool->jobs+(pool->job_index[j]-1);
+
+    pthread_mutex_lock(&pool->lock);
+    while (!job->done)
+	pthread_cond_wait(&pool->finished, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (zip_error_code_zip(&job->error) != ZIP_ER_OK) {
+	_zip_error_copy(&pool->za->error, &job->error);
+	return -1;
+    }
+
+    if ((de->changed & ZIP_DIRENT_LAST_MOD) == 0) {
+	if (job->st.valid & ZIP_STAT_MTIME)
+	    de->last_mod = job->st.mtime;
+	else
+	    time(&de->last_mod);
+    }
+    de->comp_method = job->comp_method;
+    de->crc = job->crc;
+    de->uncomp_size = job->size;
+    de->comp_size = job->comp_size;
+    de->bitflags &= (zip_uint16_t)~ZIP_GPBF_DATA_DESCRIPTOR;
+
+    ret = 1;
+    if (_zip_dirent_write(pool->za, de, ZIP_FL_LOCAL) < 0 || job_copy(pool, job) < 0)
+	ret = -1;
+
+    job_discard(job);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->written++;
+    pthread_cond_broadcast(&pool->consumed);
+    pthread_mutex_unlock(&pool->lock);
+
+    return ret;
+}
+
+
+void
+_zip_deflate_pool_free(zip_deflate_pool_t *pool)
+{
+    zip_uint64_t i;
+
+    if (pool == NULL)
+	return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->consumed);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i=0; i<pool->nthreads; i++)
+	pthread_join(pool->threads[i], NULL);
+
+    for (i=0; i<pool->njobs; i++) {
+	job_discard(pool->jobs+i);
+	zip_error_fini(&pool->jobs[i].error);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->finished);
+    pthread_cond_destroy(&pool->consumed);
+    free(pool->threads);
+    free(pool->jobs);
+    free(pool->job_index);
+    free(pool);
+}
+
+
+static void *
+pool_main(void *ud)
+{
+    zip_deflate_pool_t *pool = (zip_deflate_pool_t *)ud;
+    zip_deflate_job_t *job;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+	/* don't run further ahead of the writer than the window allows, to bound memory */
+	while (!pool->stop && pool->next < pool->njobs && pool->next >= pool->written + pool->window)
+	    pthread_cond_wait(&pool->consumed, &pool->lock);
+	if (pool->stop || pool->next >= pool->njobs)
+	    break;
+
+	job = pool->jobs+pool->next++;
+	pthread_mutex_unlock(&pool->lock);
+
+	job_compress(pool, job);
+
+	pthread_mutex_lock(&pool->lock);
+	job->done = true;
+	pthread_cond_broadcast(&pool->finished);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+
+static void
+job_compress(zip_deflate_pool_t *pool, zip_deflate_job_t *job)
+{
+    zip_uint8_t in[BUFSIZE], out[BUFSIZE];
+    z_stream zstr;
+    zip_int64_t n;
+    uLong crc;
+    int ret, flush;
+
+    if (zip_source_open(job->src) < 0) {
+	_zip_error_set_from_source(&job->error, job->src);
+	return;
+    }
+
+    memset(&zstr, 0, sizeof(zstr));
+    /* negative value to tell zlib not to write a header */
+    if ((ret=deflateInit2(&zstr, pool->level, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY)) != Z_OK) {
+	zip_error_set(&job->error, ZIP_ER_ZLIB, ret);
+	zip_source_close(job->src);
+	return;
+    }
+
+    crc = crc32(0, NULL, 0);
+    job->size = 0;
+    do {
+	if ((n=zip_source_read(job->src, in, sizeof(in))) < 0) {
+	    _zip_error_set_from_source(&job->error, job->src);
+	    break;
+	}
+	crc = crc32(crc, in, (uInt)n);
+	job->size += (zip_uint64_t)n;
+
+	flush = (n == 0) ? Z_FINISH : Z_NO_FLUSH;
+	zstr.next_in = in;
+	zstr.avail_in = (uInt)n;
+	do {
+	    zstr.next_out = out;
+	    zstr.avail_out = sizeof(out);
+	    if ((ret=deflate(&zstr, flush)) == Z_STREAM_ERROR) {
+		zip_error_set(&job->error, ZIP_ER_ZLIB, ret);
+		break;
+	    }
+	    if (job_output(pool, job, out, sizeof(out)-zstr.avail_out) < 0)
+		break;
+	} while (zstr.avail_out == 0);
+    } while (flush != Z_FINISH && zip_error_code_zip(&job->error) == ZIP_ER_OK);
+
+    deflateEnd(&zstr);
+    zip_source_close(job->src);
+
+    if (zip_error_code_zip(&job->error) != ZIP_ER_OK)
+	return;
+
+    job->crc = (zip_uint32_t)crc;
+    job->comp_method = ZIP_CM_DEFLATE;
+
+    /* like zip_source_deflate, prefer storing for ZIP_CM_DEFAULT when deflate doesn't help */
+    if (job->can_store && job->comp_size >= job->size)
+	job_store(pool, job);
+}
+
+
+/* read the source again and keep it uncompressed */
+
+static int
+job_store(zip_deflate_pool_t *pool, zip_deflate_job_t *job)
+{
+    zip_uint8_t buf[BUFSIZE];
+    zip_int64_t n;
+
+    if (job->spill) {
+	fclose(job->spill);
+	job->spill = NULL;
+    }
+    job->comp_size = 0;
+
+    if (zip_source_open(job->src) < 0) {
+	_zip_error_set_from_source(&job->error, job->src);
+	return -1;
+    }
+    while ((n=zip_source_read(job->src, buf, sizeof(buf))) > 0) {
+	if (job_output(pool, job, buf, (zip_uint64_t)n) < 0)
+	    break;
+    }
+    if (n < 0)
+	_zip_error_set_from_source(&job->error, job->src);
+    zip_source_close(job->src);
+
+    if (zip_error_code_zip(&job->error) != ZIP_ER_OK)
+	return -1;
+
+    job->comp_method = ZIP_CM_STORE;
+    return 0;
+}
+
+
+static FILE *
+spill_open(zip_t *za, zip_error_t *error)
+{
+    const char *dir, *fname;
+    size_t dirlen;
+    char *temp;
+    FILE *fp;
+    int fd;
+
+    /* Without a tempdir, spill next to the archive like the output file
+       itself: tmpfile() needs a writable /tmp, which apps on Android
+       do not have. */
+    if ((dir=za->tempdir) != NULL)
+	dirlen = strlen(dir);
+    else if ((fname=_zip_source_file_name(za->src)) != NULL) {
+	const char *slash = strrchr(fname, '/');
+	dir = fname;
+	dirlen = slash ? (size_t)(slash - fname) : 0;
+	if (slash == fname)
+	    dirlen = 1;		/* archive in "/" */
+    }
+    else {
+	if ((fp=tmpfile()) == NULL)
+	    zip_error_set(error, ZIP_ER_TMPOPEN, errno);
+	return fp;
+    }
+
+    if ((temp=(char *)malloc(dirlen+16)) == NULL) {
+	zip_error_set(error, ZIP_ER_MEMORY, 0);
+	return NULL;
+    }
+    if (dirlen == 0)
+	strcpy(temp, ".zip.XXXXXX");
+    else
+	sprintf(temp, "%.*s/.zip.XXXXXX", (int)dirlen, dir);
+
+    if ((fd=mkstemp(temp)) == -1) {
+	zip_error_set(error, ZIP_ER_TMPOPEN, errno);
+	free(temp);
+	return NULL;
+    }
+    /* the file lives only as long as it is open */
+    (void)remove(temp);
+    free(temp);
+
+    if ((fp=fdopen(fd, "w+b")) == NULL) {
+	zip_error_set(error, ZIP_ER_TMPOPEN, errno);
+	close(fd);
+    }
+    return fp;
+}
+
+
+static int
+job_output(zip_deflate_pool_t *pool, zip_deflate_job_t *job, const zip_uint8_t *data, zip_uint64_t length)
+{
+    if (length == 0)
+	return 0;
+
+    if (job->spill == NULL && job->comp_size+length > SPILL_SIZE) {
+	if ((job->spill=spill_open(pool->za, &job->error)) == NULL)
+	    return -1;
+	if (job->comp_size > 0 && fwrite(job->data, 1, (size_t)job->comp_size, job->spill) != job->comp_size) {
+	    zip_error_set(&job->error, ZIP_ER_WRITE, errno);
+	    return -1;
+	}
+	free(job->data);
+	job->data = NULL;
+	job->data_alloc = 0;
+    }
+
+    if (job->spill) {
+	if (fwrite(data, 1, (size_t)length, job->spill) != length) {
+	    zip_error_set(&job->error, ZIP_ER_WRITE, errno);
+	    return -1;
+	}
+    }
+    else {
+	if (job->comp_size+length > job->data_alloc) {
+	    zip_uint64_t alloc = job->data_alloc ? job->data_alloc*2 : BUFSIZE*4;
+	    zip_uint8_t *p;
+
+	    while (alloc < job->comp_size+length)
+		alloc *= 2;
+	    if ((p=(zip_uint8_t *)realloc(job->data, (size_t)alloc)) == NULL) {
+		zip_error_set(&job->error, ZIP_ER_MEMORY, 0);
+		return -1;
+	    }
+	    job->data = p;
+	    job->data_alloc = alloc;
+	}
+	memcpy(job->data+job->comp_size, data, (size_t)length);
+    }
+
+    job->comp_size += length;
+    return 0;
+}
+
+
+static int
+job_copy(zip_deflate_pool_t *pool, zip_deflate_job_t *job)
+{
+    zip_uint8_t buf[BUFSIZE];
+    size_t n;
+
+    if (job->spill == NULL)
+	return _zip_write(pool->za, job->data, job->comp_size);
+
+    if (fseek(job->spill, 0, SEEK_SET) < 0) {
+	zip_error_set(&pool->za->error, ZIP_ER_SEEK, errno);
+	return -1;
+    }
+    while ((n=fread(buf, 1, sizeof(buf), job->spill)) > 0) {
+	if (_zip_write(pool->za, buf, n) < 0)
+	    return -1;
+    }
+    if (ferror(job->spill)) {
+	zip_error_set(&pool->za->error, ZIP_ER_READ, errno);
+	return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+job_discard(zip_deflate_job_t *job)
+{
+    free(job->data);
+    job->data = NULL;
+    job->data_alloc = 0;
+    if (job->spill) {
+	fclose(job->spill);
+	job->spill = NULL;
+    }
+}
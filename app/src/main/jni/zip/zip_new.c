@@ -64,6 +64,8 @@ _zip_new(zip_error_t *error)
     za->nopen_source = za->nopen_source_alloc = 0;
     za->open_source = NULL;
     za->tempdir = NULL;
+    za->comp_level = Z_BEST_COMPRESSION;
+    za->comp_threads = 1;
     
     return za;
 }
@@ -158,6 +158,24 @@ zip_open_from_source(zip_source_t *src, int _flags, zip_error_t *error)
     }
 }
 
+/* zip_archive_set_compression:
+   set the zlib level (-1 for zlib's default, 0-9) for entries deflated
+   by zip_close, and how many threads deflate them in parallel. */
+
+ZIP_EXTERN int
+zip_archive_set_compression(zip_t *za, int level, unsigned int threads)
+{
+    if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION || threads == 0) {
+	zip_error_set(&za->error, ZIP_ER_INVAL, 0);
+	return -1;
+    }
+
+    za->comp_level = level;
+    za->comp_threads = threads;
+
+    return 0;
+}
+
 ZIP_EXTERN int
 zip_archive_set_tempdir(zip_t *za, const char *tempdir)
 {
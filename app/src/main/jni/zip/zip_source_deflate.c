@@ -43,6 +43,7 @@ struct deflate {
     bool eof;
     bool can_store;
     bool is_stored;
+    int level;
     int mem_level;
     zip_uint64_t size;
     zip_uint8_t buffer[BUFSIZE];
@@ -77,6 +78,7 @@ zip_source_deflate(zip_t *za, zip_source_t *src, zip_int32_t cm, int flags)
     ctx->is_stored = false;
     ctx->can_store = ZIP_CM_IS_DEFAULT(cm);
     if (flags & ZIP_CODEC_ENCODE) {
+	ctx->level = za->comp_level;
 	ctx->mem_level = MAX_MEM_LEVEL;
     }
 
@@ -293,7 +295,7 @@ deflate_compress(zip_source_t *src, void *ud, void *data, zip_uint64_t len, zip_
 	ctx->zstr.next_out = NULL;
 
 	/* negative value to tell zlib not to write a header */
-	if ((ret=deflateInit2(&ctx->zstr, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, ctx->mem_level, Z_DEFAULT_STRATEGY)) != Z_OK) {
+	if ((ret=deflateInit2(&ctx->zstr, ctx->level, Z_DEFLATED, -MAX_WBITS, ctx->mem_level, Z_DEFAULT_STRATEGY)) != Z_OK) {
             zip_error_set(&ctx->error, ZIP_ER_ZLIB, ret);
 	    return -1;
 	}
@@ -169,6 +169,16 @@ _zip_source_file_or_p(const char *fname, FILE *file, zip_uint64_t start, zip_int
 }
 
 
+/* name of the file behind a source from zip_source_file, or NULL */
+const char *
+_zip_source_file_name(zip_source_t *src)
+{
+    if (src == NULL || src->cb.f != read_file)
+	return NULL;
+    return ((struct read_file *)src->ud)->fname;
+}
+
+
 static int
 create_temp_output(struct read_file *ctx)
 {
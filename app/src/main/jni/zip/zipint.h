@@ -256,6 +256,7 @@ typedef struct zip_entry zip_entry_t;
 typedef struct zip_extra_field zip_extra_field_t;
 typedef struct zip_string zip_string_t;
 typedef struct zip_buffer zip_buffer_t;
+typedef struct zip_deflate_pool zip_deflate_pool_t;
 
 
 /* zip archive, part of API */
@@ -283,6 +284,9 @@ struct zip {
     zip_source_t **open_source;         /* open sources using archive */
 
     char *tempdir;                      /* custom temp dir (needed e.g. for OS X sandboxing) */
+
+    int comp_level;                     /* zlib level used when deflating entries */
+    unsigned int comp_threads;          /* threads deflating entries in zip_close */
 };
 
 /* file in zip archive, part of API */
@@ -457,6 +461,10 @@ zip_cdir_t *_zip_cdir_new(zip_uint64_t, zip_error_t *);
 zip_int64_t _zip_cdir_write(zip_t *za, const zip_filelist_t *filelist, zip_uint64_t survivors);
 void _zip_deregister_source(zip_t *za, zip_source_t *src);
 
+zip_deflate_pool_t *_zip_deflate_pool_new(zip_t *za, const zip_filelist_t *filelist, zip_uint64_t survivors);
+int _zip_deflate_pool_write(zip_deflate_pool_t *pool, zip_uint64_t j, zip_dirent_t *de);
+void _zip_deflate_pool_free(zip_deflate_pool_t *pool);
+
 zip_dirent_t *_zip_dirent_clone(const zip_dirent_t *);
 void _zip_dirent_free(zip_dirent_t *);
 void _zip_dirent_finalize(zip_dirent_t *);
@@ -513,6 +521,7 @@ void _zip_set_open_error(int *zep, const zip_error_t *err, int ze);
 
 zip_int64_t _zip_source_call(zip_source_t *src, void *data, zip_uint64_t length, zip_source_cmd_t command);
 zip_source_t *_zip_source_file_or_p(const char *, FILE *, zip_uint64_t, zip_int64_t, const zip_stat_t *, zip_error_t *error);
+const char *_zip_source_file_name(zip_source_t *src);
 void _zip_source_invalidate(zip_source_t *src);
 zip_source_t *_zip_source_new(zip_error_t *error);
 int _zip_source_set_source_archive(zip_source_t *, zip_t *);